@@ -52,6 +52,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
@@ -60,7 +61,10 @@
 #  include <getopt.h>
 #endif
 
-#include "src/libzvbi.h"
+#include "src/conv.h"
+#include "src/hamm.h"
+#include "src/lang.h"
+#include "src/dtvcc_decoder.h"
 
 /* Linux DVB driver interface. */
 #include "src/dvb/dmx.h"
@@ -71,60 +75,6 @@
 #undef VERSION
 #define VERSION "0.5"
 
-#if __GNUC__ < 3
-#  define likely(expr) (expr)
-#  define unlikely(expr) (expr)
-#else
-#  define likely(expr) __builtin_expect(expr, 1)
-#  define unlikely(expr) __builtin_expect(expr, 0)
-#endif
-
-#define N_ELEMENTS(array) (sizeof (array) / sizeof ((array)[0]))
-#define CLEAR(var) memset (&(var), 0, sizeof (var))
-
-/* FIXME __typeof__ is a GCC extension. */
-#undef SWAP
-#define SWAP(x, y)							\
-do {									\
-	__typeof__ (x) _x = x;						\
-	x = y;								\
-	y = _x;								\
-} while (0)
-
-#undef MIN
-#define MIN(x, y) ({							\
-	__typeof__ (x) _x = (x);					\
-	__typeof__ (y) _y = (y);					\
-	(void)(&_x == &_y); /* warn if types do not match */		\
-	/* return */ (_x < _y) ? _x : _y;				\
-})
-
-#undef MAX
-#define MAX(x, y) ({							\
-	__typeof__ (x) _x = (x);					\
-	__typeof__ (y) _y = (y);					\
-	(void)(&_x == &_y); /* warn if types do not match */		\
-	/* return */ (_x > _y) ? _x : _y;				\
-})
-
-#undef PARENT
-#define PARENT(_ptr, _type, _member) ({					\
-	__typeof__ (&((_type *) 0)->_member) _p = (_ptr);		\
-	(_p != 0) ? (_type *)(((char *) _p) - offsetof (_type,		\
-	  _member)) : (_type *) 0;					\
-})
-
-/* These should be defined in inttypes.h. */
-#ifndef PRId64
-#  define PRId64 "lld"
-#endif
-#ifndef PRIu64
-#  define PRIu64 "llu"
-#endif
-#ifndef PRIx64
-#  define PRIx64 "llx"
-#endif
-
 /* EIA 608-B decoder. */
 
 enum field_num {
@@ -311,212 +261,6 @@ struct cc_decoder {
 	struct cc_timestamp	timestamp;
 };
 
-/* CEA 708-C decoder. */
-
-enum justify {
-	JUSTIFY_LEFT = 0,
-	JUSTIFY_RIGHT,
-	JUSTIFY_CENTER,
-	JUSTIFY_FULL
-};
-
-enum direction {
-	DIR_LEFT_RIGHT = 0,
-	DIR_RIGHT_LEFT,
-	DIR_TOP_BOTTOM,
-	DIR_BOTTOM_TOP
-};
-
-enum display_effect {
-	DISPLAY_EFFECT_SNAP = 0,
-	DISPLAY_EFFECT_FADE,
-	DISPLAY_EFFECT_WIPE
-};
-
-enum opacity {
-	OPACITY_SOLID = 0,
-	OPACITY_FLASH,
-	OPACITY_TRANSLUCENT,
-	OPACITY_TRANSPARENT
-};
-
-enum edge {
-	EDGE_NONE = 0,
-	EDGE_RAISED,
-	EDGE_DEPRESSED,
-	EDGE_UNIFORM,
-	EDGE_SHADOW_LEFT,
-	EDGE_SHADOW_RIGHT
-};
-
-enum pen_size {
-	PEN_SIZE_SMALL = 0,
-	PEN_SIZE_STANDARD,
-	PEN_SIZE_LARGE
-};
-
-enum font_style {
-	FONT_STYLE_DEFAULT = 0,
-	FONT_STYLE_MONO_SERIF,
-	FONT_STYLE_PROP_SERIF,
-	FONT_STYLE_MONO_SANS,
-	FONT_STYLE_PROP_SANS,
-	FONT_STYLE_CASUAL,
-	FONT_STYLE_CURSIVE,
-	FONT_STYLE_SMALL_CAPS
-};
-
-enum text_tag {
-	TEXT_TAG_DIALOG = 0,
-	TEXT_TAG_SOURCE_ID,
-	TEXT_TAG_DEVICE,
-	TEXT_TAG_DIALOG_2,
-	TEXT_TAG_VOICEOVER,
-	TEXT_TAG_AUDIBLE_TRANSL,
-	TEXT_TAG_SUBTITLE_TRANSL,
-	TEXT_TAG_VOICE_DESCR,
-	TEXT_TAG_LYRICS,
-	TEXT_TAG_EFFECT_DESCR,
-	TEXT_TAG_SCORE_DESCR,
-	TEXT_TAG_EXPLETIVE,
-	TEXT_TAG_NOT_DISPLAYABLE = 15
-};
-
-enum offset {
-	OFFSET_SUBSCRIPT = 0,
-	OFFSET_NORMAL,
-	OFFSET_SUPERSCRIPT
-};
-
-/* RGB 2:2:2 (lsb = B). */
-typedef uint8_t			dtvcc_color;
-
-/* Lsb = window 0, msb = window 7. */
-typedef uint8_t			dtvcc_window_map;
-
-struct dtvcc_pen_style {
-	enum pen_size			pen_size;
-	enum font_style			font_style;
-	enum offset			offset;
-	vbi_bool			italics;
-	vbi_bool			underline;
-
-	enum edge			edge_type;
-
-	dtvcc_color			fg_color;
-	enum opacity			fg_opacity;
-
-	dtvcc_color			bg_color;
-	enum opacity			bg_opacity;
-
-	dtvcc_color			edge_color;
-};
-
-struct dtvcc_pen {
-	enum text_tag			text_tag;
-	struct dtvcc_pen_style		style;
-};
-
-struct dtvcc_window_style {
-	enum justify			justify;
-	enum direction			print_direction;
-	enum direction			scroll_direction;
-	vbi_bool			wordwrap;
-
-	enum display_effect		display_effect;
-	enum direction			effect_direction;
-	unsigned int			effect_speed; /* 1/10 sec */
-
-	dtvcc_color			fill_color;
-	enum opacity			fill_opacity;
-
-	enum edge			border_type;
-	dtvcc_color			border_color;
-};
-
-struct dtvcc_window {
-	/* EIA 708-C window state. */
-
-	uint16_t			buffer[16][42];
-
-	vbi_bool			visible;
-
-	/* 0 = highest ... 7 = lowest. */
-	unsigned int			priority;
-
-	unsigned int			anchor_point;
-	unsigned int			anchor_horizontal;
-	unsigned int			anchor_vertical;
-	vbi_bool			anchor_relative;
-
-	unsigned int			row_count;
-	unsigned int			column_count;
-
-	vbi_bool			row_lock;
-	vbi_bool			column_lock;
-
-	unsigned int			curr_row;
-	unsigned int			curr_column;
-
-	struct dtvcc_pen		curr_pen;
-
-	struct dtvcc_window_style	style;
-
-	/* Our stuff. */
-
-	/**
-	 * If bit 1 << row is set we already sent a stream event for
-	 * this row.
-	 */
-	unsigned int			streamed;
-
-	/**
-	 * The time when we received the first (but not necessarily
-	 * leftmost) character in the current row. Unless a
-	 * DisplayWindow or ToggleWindow command completed the line
-	 * the next stream event will carry this timestamp.
-	 */
-	struct cc_timestamp		timestamp_c0;
-};
-
-struct dtvcc_service {
-	/* Interpretation Layer. */
-
-	struct dtvcc_window		window[8];
-
-	struct dtvcc_window *		curr_window;
-
-	dtvcc_window_map		created;
-
-	/* For debugging. */
-	unsigned int			error_line;
-
-	/* Service Layer. */
-
-	uint8_t				service_data[128];
-	unsigned int			service_data_in;
-
-	/** The time when we last received data for this service. */
-	struct cc_timestamp		timestamp;
-};
-
-struct dtvcc_decoder {
-	struct dtvcc_service		service[2];
-
-	/* Packet Layer. */
-
-	uint8_t				packet[128];
-	unsigned int			packet_size;
-
-	/* Next expected DTVCC packet sequence_number. Only the two
-	   most significant bits are valid. < 0 if no sequence_number
-	   has been received yet. */
-	int				next_sequence_number;
-
-	/** The time when we last received data. */
-	struct cc_timestamp		timestamp;
-};
-
 /* ATSC A/53 Part 4:2007 Closed Caption Data decoder. */
 
 enum cc_type {
@@ -532,6 +276,10 @@ struct cc_data_decoder {
 
 	FILE *				cc_data_tap_fp;
 
+	/* DTVCC packet assembly. */
+	uint8_t				packet[128];
+	unsigned int			packet_size;
+
 	/* For debugging. */
 	int64_t				last_pts;
 };
@@ -598,7 +346,7 @@ char usewebtv;
 
 	struct cc_decoder		cc;
 
-	struct dtvcc_decoder		dtvcc;
+	_vbi_dtvcc_decoder *		dtvcc;
 
 //XDSdecode
 unsigned int field;
@@ -951,10 +699,6 @@ enum debug {
 	DEBUG_CC_F1			= (1 << 8),
 	DEBUG_CC_F2			= (1 << 9),
 	DEBUG_CC_DECODER		= (1 << 10),
-	DEBUG_DTVCC_PACKET		= (1 << 11),
-	DEBUG_DTVCC_SE			= (1 << 12),
-	DEBUG_DTVCC_PUT_CHAR		= (1 << 13),
-	DEBUG_DTVCC_STREAM_EVENT	= (1 << 14),
 	DEBUG_CONFIG			= (1 << 15)
 };
 
@@ -1064,7 +808,7 @@ list_stations			(void);
 static void
 init_cc_decoder			(struct cc_decoder *	cd);
 static void
-init_dtvcc_decoder		(struct dtvcc_decoder *	dc);
+init_dtvcc_decoder		(struct caption_recorder *cr);
 static void
 init_cc_data_decoder		(struct cc_data_decoder *cd);
 
@@ -1338,6 +1082,7 @@ open_minicut_file		(struct program *	pr,
 	char dir_name[32];
 	size_t base_len;
 	size_t dir_len;
+	size_t buf_size;
 	char *buf;
 	struct stat st;
 	unsigned int i;
@@ -1352,9 +1097,10 @@ open_minicut_file		(struct program *	pr,
 			    tm->tm_mday,
 			    tm->tm_hour);
 
-	buf = xmalloc (base_len + dir_len
-		       + strlen (file_name) + 2
-		       + strlen (extension) + 1);
+	buf_size = (base_len + dir_len
+		    + strlen (file_name) + 2
+		    + strlen (extension) + 1);
+	buf = xmalloc (buf_size);
 
 	strcpy (buf, pr->option_minicut_dir_name);
 	if (0 != stat (buf, &st)) {
@@ -1377,13 +1123,15 @@ open_minicut_file		(struct program *	pr,
 		int fd;
 		
 		if (0 == i) {
-			sprintf (buf + base_len + dir_len,
-				 "%s%s",
-				 file_name, extension);
+			snprintf (buf + base_len + dir_len,
+				  buf_size - base_len - dir_len,
+				  "%s%s",
+				  file_name, extension);
 		} else {
-			sprintf (buf + base_len + dir_len,
-				 "%s-%u%s",
-				 file_name, i, extension);
+			snprintf (buf + base_len + dir_len,
+				  buf_size - base_len - dir_len,
+				  "%s-%u%s",
+				  file_name, i, extension);
 		}
 
 		fd = open64 (buf, (O_CREAT | O_EXCL |
@@ -1965,7 +1713,7 @@ init_caption_recorder		(struct caption_recorder *cr)
 
 	init_cc_data_decoder (&cr->ccd);
 	init_cc_decoder (&cr->cc);
-	init_dtvcc_decoder (&cr->dtvcc);
+	init_dtvcc_decoder (cr);
 
 	cr->infoptr = cr->newinfo[0][0][0];
 	cr->xds_info_prefix = "\33[33m% ";
@@ -1984,12 +1732,6 @@ cc_timestamp_reset		(struct cc_timestamp *	ts)
 	ts->pts = -1;
 }
 
-static vbi_bool
-cc_timestamp_isset		(struct cc_timestamp *	ts)
-{
-	return (ts->pts >= 0 || 0 != (ts->sys.tv_sec | ts->sys.tv_usec));
-}
-
 static const vbi_color
 cc_color_map [8] = {
 	VBI_WHITE, VBI_GREEN, VBI_BLUE, VBI_CYAN,
@@ -4163,7 +3905,7 @@ static int webtv_check(struct caption_recorder *cr, char * buf,int len)
 		sum = csum + (sum & 0xffff);
 		csum = (unsigned short)(sum >> 16);
 	}
-	sprintf(temp,"%04X\n",(int)~sum&0xffff);
+	snprintf(temp,sizeof(temp),"%04X\n",(int)~sum&0xffff);
 	buf++;
 	if(!strncmp(buf,temp,4))
 	{
@@ -4256,1800 +3998,150 @@ xds_filter_option		(struct caption_recorder *cr,
 
 /* CEA 708-C Digital TV Closed Caption decoder. */
 
-static const uint8_t
-dtvcc_c0_length [4] = {
-	1, 1, 2, 3
-};
-
-static const uint8_t
-dtvcc_c1_length [32] = {
-	/* 0x80 CW0 ... CW7 */ 1, 1, 1, 1,  1, 1, 1, 1,
-	/* 0x88 CLW */ 2,
-	/* 0x89 DSW */ 2,
-	/* 0x8A HDW */ 2,
-	/* 0x8B TGW */ 2,
-
-	/* 0x8C DLW */ 2,
-	/* 0x8D DLY */ 2,
-	/* 0x8E DLC */ 1,
-	/* 0x8F RST */ 1,
-
-	/* 0x90 SPA */ 3,
-	/* 0x91 SPC */ 4,
-	/* 0x92 SPL */ 3,
-	/* CEA 708-C Section 7.1.5.1: 0x93 ... 0x96 are
-	   reserved one byte codes. */ 1, 1, 1, 1,
-	/* 0x97 SWA */ 5,
-	/* 0x98 DF0 ... DF7 */ 7, 7, 7, 7,  7, 7, 7, 7
-};
+static void
+dtvcc_event_handler		(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct caption_recorder *cr = user_data;
+	const struct _vbi_event_dtvcc_stream *ds;
+	struct cc_timestamp ts;
+	double sec;
 
-static const uint16_t
-dtvcc_g2 [96] = {
-	/* Note Unicode defines no transparent spaces. */
-	0x0020, /* 0x1020 Transparent space */
-	0x00A0, /* 0x1021 Non-breaking transparent space */
-
-	0,      /* 0x1022 reserved */
-	0,
-	0,
-	0x2026, /* 0x1025 Horizontal ellipsis */
-	0,
-	0,
-	0,
-	0,
-	0x0160, /* 0x102A S with caron */
-	0,
-	0x0152, /* 0x102C Ligature OE */
-	0,
-	0,
-	0,
-
-	/* CEA 708-C Section 7.1.8: "The character (0x30) is a solid
-	   block which fills the entire character position with the
-	   text foreground color." */
-	0x2588, /* 0x1030 Full block */
-
-	0x2018, /* 0x1031 Left single quotation mark */
-	0x2019, /* 0x1032 Right single quotation mark */
-	0x201C, /* 0x1033 Left double quotation mark */
-	0x201D, /* 0x1034 Right double quotation mark */
-	0,
-	0,
-	0,
-	0x2122, /* 0x1039 Trademark sign */
-	0x0161, /* 0x103A s with caron */
-	0,
-	0x0153, /* 0x103C Ligature oe */
-	0x2120, /* 0x103D Service mark */
-	0,
-	0x0178, /* 0x103F Y with diaeresis */
-
-	/* Code points 0x1040 ... 0x106F reserved. */
-	0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
-	0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
-	0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
-
-	0,      /* 0x1070 reserved */
-	0,
-	0,
-	0,
-	0,
-	0,
-	0x215B, /* 0x1076 1/8 */
-	0x215C, /* 0x1077 3/8 */
-	0x215D, /* 0x1078 5/8 */
-	0x215E, /* 0x1079 7/8 */
-	0x2502, /* 0x107A Box drawings vertical */
-	0x2510, /* 0x107B Box drawings down and left */
-	0x2514, /* 0x107C Box drawings up and right */
-	0x2500, /* 0x107D Box drawings horizontal */
-	0x2518, /* 0x107E Box drawings up and left */
-	0x250C  /* 0x107F Box drawings down and right */
-};
+	ds = ev->ev._dtvcc_stream;
 
-static unsigned int
-dtvcc_unicode			(unsigned int		c)
-{
-	if (unlikely (0 == (c & 0x60))) {
-		/* C0, C1, C2, C3 */
-		return 0;
-	} else if (likely (c < 0x100)) {
-		/* G0, G1 */
-		if (unlikely (0x7F == c))
-			return 0x266A; /* music note */
-		else
-			return c;
-	} else if (c < 0x1080) {
-		if (unlikely (c < 0x1020))
-			return 0;
-		else
-			return dtvcc_g2[c - 0x1020];
-	} else if (0x10A0 == c) {
-		/* We map all G2/G3 characters which are not
-		   representable in Unicode to private code U+E900
-		   ... U+E9FF. */
-		return 0xE9A0; /* caption icon */
-	}
+	sec = floor (ds->capture_time);
+	ts.sys.tv_sec = sec;
+	ts.sys.tv_usec = lrint ((ds->capture_time - sec) * 1e6);
+	ts.pts = ds->pts;
 
-	return 0;
+	cr_new_line (cr, &ts,
+		     /* channel */ ds->service + 8,
+		     /* mode */ CC_MODE_ROLL_UP, /* FIXME */
+		     ds->text, ds->length);
 }
 
 static void
-dump_dtvcc_se			(FILE *			fp,
-				 const uint8_t *	buf,
-				 unsigned int		n_bytes)
+init_dtvcc_decoder		(struct caption_recorder *cr)
 {
-	uint16_t ucs2_str[1];
-	unsigned int se_length;
-	unsigned int c;
-	unsigned int i;
-
-	if (0 == n_bytes)
-		return;
-
-	c = buf[0];
-	if (0 != (c & 0x60)) {
-		ucs2_str[0] = dtvcc_unicode (c);
-		fprintf (fp, "G0/G1 0x%02X U+%04X '",
-			 c, ucs2_str[0]);
-		vbi_fputs_iconv_ucs2 (fp, locale_codeset,
-				      ucs2_str, 1,
-				      /* repl_char */ '?');
-		fputs ("'\n", fp);
-		return;
-	} else if ((int8_t) c < 0) {
-		static const char *mnemo [32] = {
-			"CW0", "CW1", "CW2", "CW3",
-			"CW4", "CW5", "CW6", "CW7",
-			"CLW", "DSW", "HDW", "TGW",
-			"DLW", "DLY", "DLC", "RST",
-			"SPA", "SPC", "SPL", "93",
-			"reserved", "reserved",
-			"reserved", "SWA",
-			"DF0", "DF1", "DF2", "DF3",
-			"DF4", "DF5", "DF6", "DF7"
-		};
-		static const char *opacity_name [4] = {
-			"Solid", "Flash", "Transl", "Transp"
-		};
-		static const char *edge_name [8] = {
-			"None", "Raised", "Depressed",
-			"Uniform", "ShadowL", "ShadowR",
-			"INVALID", "INVALID"
-		};
-
-		fprintf (fp, "C1 0x%02X %s", c, mnemo[c & 31]);
-
-		se_length = dtvcc_c1_length[c - 0x80];
-		if (n_bytes < se_length) {
-			fputs (" incomplete\n", fp);
-			return;
-		}
+	cr->dtvcc = _vbi_dtvcc_decoder_new ();
+	if (NULL == cr->dtvcc)
+		no_mem_exit ();
 
-		switch (c) {
-		case 0x80 ... 0x87: /* CWx */
-		case 0x8E: /* DLC */
-		case 0x8F: /* RST */
-		case 0x93 ... 0x96: /* reserved */
-			fputc ('\n', fp);
-			return;
+	if (!_vbi_dtvcc_decoder_add_event_handler (cr->dtvcc,
+						   _VBI_EVENT_DTVCC_STREAM,
+						   dtvcc_event_handler,
+						   /* user_data */ cr))
+		no_mem_exit ();
+}
 
-		case 0x88: /* CLW */
-		case 0x89: /* DSW */
-		case 0x8A: /* HDW */
-		case 0x8B: /* TGW */
-		case 0x8C: /* DLW */
-			fputs (" 0b", fp);
-			for (i = 0; i < 8; ++i) {
-				unsigned int bit;
+/* ATSC A/53 Part 4:2007 Closed Caption Data decoder */
 
-				bit = !!(buf[1] & (0x80 >> i));
-				fputc ('0' + bit, fp);
-			}
-			fputc ('\n', fp);
-			return;
+static void
+dump_cc_data_pair		(FILE *			fp,
+				 unsigned int		index,
+				 const uint8_t		buf[3])
+{
+	unsigned int one_bit;
+	unsigned int reserved;
+	unsigned int cc_valid;
+	enum cc_type cc_type;
+	unsigned int cc_data_1;
+	unsigned int cc_data_2;
 
-		case 0x8D: /* DLY */
-			fprintf (fp, " t=%u\n", buf[1]);
-			return;
+	/* Was marker_bits: "11111". */
+	one_bit = (buf[0] >> 7) & 1;
+	reserved = (buf[0] >> 3) & 15;
 
-		case 0x90: /* SPA */
-		{
-			static const char *s_name [4] = {
-				"Small", "Std", "Large", "INVALID"
-			};
-			static const char *fs_name [8] = {
-				"Default", "MonoSerif", "PropSerif",
-				"MonoSans", "PropSans", "Casual",
-				"Cursive", "SmallCaps"
-			};
-			static const char *tt_name [16] = {
-				"Dialog", "SourceID", "Device",
-				"Dialog2", "Voiceover", "AudTransl",
-				"SubTransl", "VoiceDescr", "Lyrics",
-				"EffectDescr", "ScoreDescr",
-				"Expletive", "INVALID", "INVALID",
-				"INVALID", "NotDisplayable"
-			};
-			static const char *o_name [4] = {
-				"Sub", "Normal", "Super", "INVALID"
-			};
+	cc_valid = (buf[0] >> 2) & 1;
+	cc_type = (enum cc_type)(buf[0] & 3);
+	cc_data_1 = buf[1];
+	cc_data_2 = buf[2];
 
-			fprintf (fp, " s=%s fs=%s tt=%s o=%s i=%u "
-				 "u=%u et=%s\n",
-				 s_name[buf[1] & 3],
-				 fs_name[buf[2] & 7],
-				 tt_name[(buf[1] >> 4) & 15],
-				 o_name[(buf[1] >> 2) & 3],
-				 !!(buf[2] & 0x80),
-				 !!(buf[2] & 0x40),
-				 edge_name[(buf[2] >> 3) & 7]);
-			return;
-		}
+	fprintf (fp, "  %2u '1F'=%u%X%s valid=%u type=%s "
+		 "%02x %02x '%c%c'\n",
+		 index, one_bit, reserved,
+		 (1 != one_bit || 0xF != reserved) ? "*" : "",
+		 cc_valid, cc_type_name (cc_type),
+		 cc_data_1, cc_data_2,
+		 printable (cc_data_1), printable (cc_data_2));
+}
 
-		case 0x91: /* SPC */
-		{
-			fprintf (fp, " fg=%u%u%u fo=%s bg=%u%u%u bo=%s "
-				 "edge=%u%u%u\n",
-				 (buf[1] >> 4) & 3, (buf[1] >> 2) & 3,
-				 buf[1] & 3,
-				 opacity_name[(buf[1] >> 6) & 3],
-				 (buf[2] >> 4) & 3, (buf[2] >> 2) & 3,
-				 buf[2] & 3,
-				 opacity_name[(buf[2] >> 6) & 3],
-				 (buf[3] >> 4) & 3, (buf[3] >> 2) & 3,
-				 buf[3] & 3);
-			return;
-		}
+static void
+dump_cc_data			(FILE *			fp,
+				 const uint8_t *	buf,
+				 unsigned int		n_bytes,
+				 int64_t		pts,
+				 int64_t		last_pts)
+{
+	unsigned int reserved1;
+	unsigned int process_cc_data_flag;
+	unsigned int zero_bit;
+	unsigned int cc_count;
+	unsigned int reserved2;
+	unsigned int same;
+	unsigned int marker_bits;
+	unsigned int i;
 
-		case 0x92: /* SPL */
-			fprintf (fp, " r=%u c=%u\n",
-				 buf[1] & 0x0F,
-				 buf[2] & 0x3F);
-			return;
+	/* Was process_em_data_flag: "This flag is set to
+	   indicate whether it is necessary to process the em_data. If
+	   it is set to 1, the em_data has to be parsed and its
+	   meaning has to be processed. When it is set to 0, the
+	   em_data can be discarded." */
+	reserved1 = (buf[9] >> 7) & 1;
 
-		case 0x97: /* SWA */
-		{
-			static const char *j_name [4] = {
-				"L", "R", "C", "F"
-			};
-			static const char *pd_sd_ed_name [4] = {
-				"LR", "RL", "TB", "BT"
-			};
-			static const char *de_name [4] = {
-				"Snap", "Fade", "Wipe", "INVALID"
-			};
+	process_cc_data_flag = (buf[9] >> 6) & 1;
 
-			fprintf (fp, " j=%s pd=%s sd=%s ww=%u de=%s "
-				 "ed=%s es=%u fill=%u%u%u fo=%s "
-				 "bt=%s border=%u%u%u\n",
-				 j_name [buf[3] & 3],
-				 pd_sd_ed_name [(buf[3] >> 4) & 3],
-				 pd_sd_ed_name [(buf[3] >> 2) & 3],
-				 !!(buf[3] & 0x40),
-				 de_name [buf[4] & 3],
-				 pd_sd_ed_name [(buf[4] >> 2) & 3],
-				 (buf[4] >> 4) & 15,
-				 (buf[1] >> 4) & 3, (buf[1] >> 2) & 3,
-				 buf[1] & 3,
-				 opacity_name[(buf[1] >> 6) & 3],
-				 edge_name[(buf[2] >> 6) & 3],
-				 (buf[2] >> 4) & 3, (buf[2] >> 2) & 3,
-				 buf[2] & 3);
-			return;
-		}
+	/* Was: additional_cc_data. */
+	zero_bit = (buf[9] >> 5) & 1;
 
-		case 0x98 ... 0x9F: /* DFx */
-		{
-			static const char *ap_name [16] = {
-				"TL", "TC", "TR",
-				"CL", "C", "CR",
-				"BL", "BC", "BR",
-				"INVALID", "INVALID", "INVALID",
-				"INVALID", "INVALID", "INVALID",
-				"INVALID"
-			};
-			static const char *ws_name [8] = {
-				"0", "PopUp", "TranspPopUp",
-				"CentPopUp", "RollUp", "TranspRollUp",
-				"CentRollUp", "Ticker"
-			};
-			static const char *ps_name [8] = {
-				"0", "NTSC", "NTSCMonoSerif",
-				"NTSCPropSerif", "NTSCMonoSans",
-				"NTSCPropSans", "MonoSans",
-				"PropSans"
-			};
+	cc_count = buf[9] & 0x1F;
 
-			fprintf (fp, " p=%u ap=%s rp=%u av=%u ah=%u "
-				 "rc=%u cc=%u rl=%u cl=%u v=%u "
-				 "ws=%s ps=%s\n",
-				 buf[1] & 7,
-				 ap_name[(buf[4] >> 4) & 15],
-				 !!(buf[2] & 0x80),
-				 buf[2] & 0x7F,
-				 buf[3],
-				 buf[4] & 0x0F,
-				 buf[5] & 0x3F,
-				 !!(buf[1] & 0x10),
-				 !!(buf[1] & 0x08),
-				 !!(buf[1] & 0x20),
-				 ws_name [(buf[6] >> 3) & 7],
-				 ps_name [buf[6] & 7]);
-			return;
-		}
+	/* Was em_data: "Eight bits for representing emergency
+	   message." */
+	reserved2 = buf[10];
 
-		} /* switch */
-	} else {
-		static const char *mnemo [32] = {
-			"NUL", "reserved", "reserved",
-			"ETX", "reserved", "reserved",
-			"reserved", "reserved",
-			"BS", "reserved", "reserved",
-			"reserved", "FF", "CR", "HCR",
-			"reserved", "EXT1", "reserved",
-			"reserved", "reserved",	"reserved",
-			"reserved", "reserved", "reserved",
-			"P16", "reserved", "reserved",
-			"reserved", "reserved", "reserved",
-			"reserved", "reserved"
-		};
-
-		/* C0 code. */
-
-		fprintf (fp, "C0 0x%02X %s", c, mnemo [c]);
-
-		se_length = dtvcc_c0_length[c >> 3];
-		if (n_bytes < se_length) {
-			fputs (" incomplete\n", fp);
-			return;
-		}
+	fprintf (fp, "cc_data pts=%" PRId64 " (%+" PRId64 ") "
+		 "'1'=%u%s process_cc_data_flag=%u "
+		 "'0'=%u%s cc_count=%u 'FF'=0x%02X%s:\n",
+		 pts, pts - last_pts, reserved1,
+		 (1 != reserved1) ? "*" : "", process_cc_data_flag,
+		 zero_bit, (0 != zero_bit) ? "*" : "",
+		 cc_count, reserved2,
+		 (0xFF != reserved2) ? "*" : "");
 
-		if (0x10 != c) {
-			if (se_length > 1)
-				fprintf (fp, " 0x%02X", buf[1]);
-			if (se_length > 2)
-				fprintf (fp, " 0x%02X", buf[2]);
-			fputc ('\n', fp);
-			return;
+	same = 0;
+	for (i = 0; i <= cc_count; ++i) {
+		if (i > 0 && i < cc_count
+		    && 0 == memcmp (&buf[11 + i * 3],
+				    &buf[ 8 + i * 3], 3)) {
+			++same;
+		} else {
+			if (same > 1) {
+				fprintf (fp, "  %2u-%u as above\n",
+					 i - same, i - 1);
+			} else if (same > 0) {
+				dump_cc_data_pair (fp, i - 1, &buf[8 + i * 3]);
+			}
+			if (i < cc_count)
+				dump_cc_data_pair (fp, i, &buf[11 + i * 3]);
+			same = 0;
 		}
 	}
 
-	/* Two-byte codes. */
-
-	c = buf[1];
-	if (0 != (c & 0x60)) {
-		ucs2_str[0] = dtvcc_unicode (0x1000 | c);
-		fprintf (fp, "G2/G3 0x10%02X U+%04X '",
-			 c, ucs2_str[0]);
-		vbi_fputs_iconv_ucs2 (fp, locale_codeset,
-				      ucs2_str, 1,
-				      /* repl_char */ '?');
-		fputs ("'\n", fp);
-		return;
-	} else if ((int8_t) c >= 0) {
-		/* C2 code. */
-
-		se_length = (c >> 3) + 2;
-		fprintf (fp, "C2 0x10%02X reserved", c);
-	} else if (c < 0x90) {
-		/* C3 Fixed Length Commands. */
-
-		se_length = (c >> 3) - 10;
-		fprintf (fp, "C3 0x10%02X reserved", c);
-	} else {
-		/* C3 Variable Length Commands. */
-
-		if (n_bytes < 3) {
-			fprintf (fp, "C3 0x10%02X incomplete\n", c);
-			return;
-		}
+	marker_bits = buf[11 + cc_count * 3];
 
-		/* type [2], zero_bit [1],
-		   length [5] */
-		se_length = (buf[2] & 0x1F) + 3;
+	fprintf (fp, "  marker_bits=0x%02X%s\n",
+		 marker_bits, (0xFF != marker_bits) ? "*" : "");
 
-		fprintf (fp, "C3 0x10%02X%02X reserved",
-			 c, buf[2]);
+	if (n_bytes > 12 + cc_count * 3) {
+		fprintf (fp, "  extraneous");
+		for (i = 12 + cc_count * 3; i < n_bytes; ++i)
+			fprintf (stderr, " %02x", buf[i]);
+		fputc ('\n', stderr);
 	}
-
-	for (i = 2; i < se_length; ++i)
-		fprintf (fp, " 0x%02X", buf[i]);
-
-	fputc ('\n', fp);
 }
 
-static void
-dump_dtvcc_buffer		(FILE *			fp,
-				 struct dtvcc_window *	dw)
-{
-	unsigned int row;
-	unsigned int column;
-
-	for (row = 0; row < dw->row_count; ++row) {
-		uint16_t ucs2_str[42];
-
-		fprintf (fp, "%02u '", row);
-
-		for (column = 0; column < dw->column_count; ++column) {
-			unsigned int c;
-
-			c = dw->buffer[row][column];
-			if (0 == c) {
-				ucs2_str[column] = 0x20;
-				continue;
-			}
-			c = dtvcc_unicode (c);
-			if (0 == c) {
-				ucs2_str[column] = '?';
-				continue;
-			}
-			ucs2_str[column] = c;
-		}
-
-		vbi_fputs_iconv_ucs2 (fp, locale_codeset,
-				      ucs2_str, dw->column_count,
-				      /* repl_char */ '?');
-		fputs ("'\n", fp);
-	}
-}
-
-static void
-dtvcc_reset			(struct dtvcc_decoder *	cd);
-static void
-dtvcc_reset_service		(struct dtvcc_service *	ds);
-
-static unsigned int
-dtvcc_window_id			(struct dtvcc_service *	ds,
-				 struct dtvcc_window *	dw)
-{
-	return dw - ds->window;
-}
-
-static unsigned int
-dtvcc_service_num		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds)
-{
-	return ds - dc->service + 1;
-}
-
-/* Up to eight windows can be visible at once, so which one displays
-   the caption? Let's take a guess. */
-static struct dtvcc_window *
-dtvcc_caption_window		(struct dtvcc_service *	ds)
-{
-	struct dtvcc_window *dw;
-	unsigned int max_priority;
-	unsigned int window_id;
-
-	dw = NULL;
-	max_priority = 8;
-
-	for (window_id = 0; window_id < 8; ++window_id) {
-		if (0 == (ds->created & (1 << window_id)))
-			continue;
-		if (!ds->window[window_id].visible)
-			continue;
-		if (DIR_BOTTOM_TOP
-		    != ds->window[window_id].style.scroll_direction)
-			continue;
-		if (ds->window[window_id].priority < max_priority) {
-			dw = &ds->window[window_id];
-			max_priority = ds->window[window_id].priority;
-		}
-	}
-
-	return dw;
-}
-
-static void
-dtvcc_stream_event		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 struct dtvcc_window *	dw,
-				 unsigned int		row)
-{
-	vbi_char text[48];
-	vbi_char ac;
-	unsigned int column;
-
-	if (NULL == dw || dw != dtvcc_caption_window (ds))
-		return;
-
-	if (option_debug & DEBUG_DTVCC_STREAM_EVENT) {
-		fprintf (stderr, "%s row=%u streamed=%08x\n",
-			 __FUNCTION__, row, dw->streamed);
-		dump_dtvcc_buffer (stderr, dw);
-	}
-
-	/* Note we only stream windows with scroll direction
-	   upwards. */
-	if (0 != (dw->streamed & (1 << row))
-	    || !cc_timestamp_isset (&dw->timestamp_c0))
-		return;
-
-	dw->streamed |= 1 << row;
-
-	for (column = 0; column < dw->column_count; ++column) {
-		if (0 != dw->buffer[row][column])
-			break;
-	}
-
-	/* Row contains only transparent spaces. */
-	if (column >= dw->column_count)
-		return;
-
-	/* TO DO. */
-	CLEAR (ac);
-	ac.foreground = VBI_WHITE;
-	ac.background = VBI_BLACK;
-	ac.opacity = VBI_OPAQUE;
-
-	for (column = 0; column < dw->column_count; ++column) {
-		unsigned int c;
-
-		c = dw->buffer[row][column];
-		if (0 == c) {
-			ac.unicode = 0x20;
-		} else {
-			ac.unicode = dtvcc_unicode (c);
-			if (0 == ac.unicode) {
-				ac.unicode = 0x20;
-			}
-		}
-		text[column] = ac;
-	}
-
-	{
-		struct program *pr;
-
-		pr = PARENT (dc, struct program, cr.dtvcc);
-		cr_new_line (&pr->cr, &dw->timestamp_c0,
-			     /* channel */ dtvcc_service_num (dc, ds) + 8,
-			     /* mode */ CC_MODE_ROLL_UP, /* FIXME */
-			     text, /* length */ dw->column_count);
-	}
-
-	cc_timestamp_reset (&dw->timestamp_c0);
-}
-
-static vbi_bool
-dtvcc_put_char			(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 unsigned int		c)
-{
-	struct dtvcc_window *dw;
-	unsigned int row;
-	unsigned int column;
-
-	dc = dc; /* unused */
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	row = dw->curr_row;
-	column = dw->curr_column;
-
-	/* FIXME how should we handle TEXT_TAG_NOT_DISPLAYABLE? */
-
-	dw->buffer[row][column] = c;
-
-	if (option_debug & DEBUG_DTVCC_PUT_CHAR) {
-		fprintf (stderr, "%s row=%u/%u column=%u/%u\n",
-			 __FUNCTION__,
-			 row, dw->row_count,
-			 column, dw->column_count);
-		dump_dtvcc_buffer (stderr, dw);
-	}
-
-	switch (dw->style.print_direction) {
-	case DIR_LEFT_RIGHT:
-		dw->streamed &= ~(1 << row);
-		if (!cc_timestamp_isset (&dw->timestamp_c0))
-			dw->timestamp_c0 = ds->timestamp;
-		if (++column >= dw->column_count)
-			return TRUE;
-		break;
-
-	case DIR_RIGHT_LEFT:
-		dw->streamed &= ~(1 << row);
-		if (!cc_timestamp_isset (&dw->timestamp_c0))
-			dw->timestamp_c0 = ds->timestamp;
-		if (column-- <= 0)
-			return TRUE;
-		break;
-
-	case DIR_TOP_BOTTOM:
-		dw->streamed &= ~(1 << column);
-		if (!cc_timestamp_isset (&dw->timestamp_c0))
-			dw->timestamp_c0 = ds->timestamp;
-		if (++row >= dw->row_count)
-			return TRUE;
-		break;
-
-	case DIR_BOTTOM_TOP:
-		dw->streamed &= ~(1 << column);
-		if (!cc_timestamp_isset (&dw->timestamp_c0))
-			dw->timestamp_c0 = ds->timestamp;
-		if (row-- <= 0)
-			return TRUE;
-		break;
-	}
-
-	dw->curr_row = row;
-	dw->curr_column = column;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_set_pen_location		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 const uint8_t *	buf)
-{
-	struct dtvcc_window *dw;
-	unsigned int row;
-	unsigned int column;
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	row = buf[1];
-	/* We check the top four zero bits. */
-	if (row >= 16) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	column = buf[2];
-	/* We also check the top two zero bits. */
-	if (column >= 42) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	if (row > dw->row_count)
-		row = dw->row_count - 1;
-	if (column > dw->column_count)
-		column = dw->column_count - 1;
-
-	if (row != dw->curr_row) {
-		dtvcc_stream_event (dc, ds, dw, dw->curr_row);
-	}
-
-	/* FIXME there's more. */
-	dw->curr_row = row;
-	dw->curr_column = column;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_set_pen_color		(struct dtvcc_service *	ds,
-				 const uint8_t *	buf)
-{
-	struct dtvcc_window *dw;
-	unsigned int c;
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	c = buf[3];
-	if (0 != (c & 0xC0)) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	dw->curr_pen.style.edge_color = c;
-	c = buf[1];
-	dw->curr_pen.style.fg_opacity = c >> 6;
-	dw->curr_pen.style.fg_color = c & 0x3F;
-	c = buf[2];
-	dw->curr_pen.style.bg_opacity = c >> 6;
-	dw->curr_pen.style.bg_color = c & 0x3F;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_set_pen_attributes	(struct dtvcc_service *	ds,
-				 const uint8_t *	buf)
-{
-	struct dtvcc_window *dw;
-	unsigned int c;
-	enum pen_size pen_size;
-	enum offset offset;
-	enum edge edge_type;
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	c = buf[1];
-	offset = (c >> 2) & 3;
-	pen_size = c & 3;
-	if ((offset | pen_size) >= 3) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	c = buf[2];
-	edge_type = (c >> 3) & 7;
-	if (edge_type >= 6) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	c = buf[1];
-	dw->curr_pen.text_tag = c >> 4;
-	dw->curr_pen.style.offset = offset;
-	dw->curr_pen.style.pen_size = pen_size;
-	c = buf[2];
-	dw->curr_pen.style.italics = c >> 7;
-	dw->curr_pen.style.underline = (c >> 6) & 1;
-	dw->curr_pen.style.edge_type = edge_type;
-	dw->curr_pen.style.font_style = c & 7;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_set_window_attributes	(struct dtvcc_service *	ds,
-				 const uint8_t *	buf)
-{
-	struct dtvcc_window *dw;
-	unsigned int c;
-	enum edge border_type;
-	enum display_effect display_effect;
-
-	dw = ds->curr_window;
-	if (NULL == dw)
-		return FALSE;
-
-	c = buf[2];
-	border_type = ((buf[3] >> 5) & 0x04) | (c >> 6);
-	if (border_type >= 6)
-		return FALSE;
-
-	c = buf[4];
-	display_effect = c & 3;
-	if (display_effect >= 3)
-		return FALSE;
-
-	c = buf[1];
-	dw->style.fill_opacity = c >> 6;
-	dw->style.fill_color = c & 0x3F;
-	c = buf[2];
-	dw->style.border_type = border_type;
-	dw->style.border_color = c & 0x3F;
-	c = buf[3];
-	dw->style.wordwrap = (c >> 6) & 1;
-	dw->style.print_direction = (c >> 4) & 3;
-	dw->style.scroll_direction = (c >> 2) & 3;
-	dw->style.justify = c & 3;
-	c = buf[4];
-	dw->style.effect_speed = c >> 4;
-	dw->style.effect_direction = (c >> 2) & 3;
-	dw->style.display_effect = display_effect;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_clear_windows		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 dtvcc_window_map	window_map)
-{
-	unsigned int i;
-
-	window_map &= ds->created;
-
-	for (i = 0; i < 8; ++i) {
-		struct dtvcc_window *dw;
-
-		if (0 == (window_map & (1 << i)))
-			continue;
-
-		dw = &ds->window[i];
-
-		dtvcc_stream_event (dc, ds, dw, dw->curr_row);
-
-		memset (dw->buffer, 0, sizeof (dw->buffer));
-
-		dw->streamed = 0;
-
-		/* FIXME CEA 708-C Section 7.1.4 (Form Feed)
-		   and 8.10.5.3 confuse me. */
-		if (0) {
-			dw->curr_column = 0;
-			dw->curr_row = 0;
-		}
-	}
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_define_window		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 uint8_t *		buf)
-{
-	static const struct dtvcc_window_style window_styles [7] = {
-		{
-			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
-			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
-			OPACITY_SOLID, EDGE_NONE, 0
-		}, {
-			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
-			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
-			OPACITY_TRANSPARENT, EDGE_NONE, 0
-		}, {
-			JUSTIFY_CENTER, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
-			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
-			OPACITY_SOLID, EDGE_NONE, 0
-		}, {
-			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
-			TRUE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
-			OPACITY_SOLID, EDGE_NONE, 0
-		}, {
-			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
-			TRUE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
-			OPACITY_TRANSPARENT, EDGE_NONE, 0
-		}, {
-			JUSTIFY_CENTER, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
-			TRUE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
-			OPACITY_SOLID, EDGE_NONE, 0
-		}, {
-			JUSTIFY_LEFT, DIR_TOP_BOTTOM, DIR_RIGHT_LEFT,
-			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
-			OPACITY_SOLID, EDGE_NONE, 0
-		}
-	};
-	static const struct dtvcc_pen_style pen_styles [7] = {
-		{
-			PEN_SIZE_STANDARD, 0, OFFSET_NORMAL, FALSE,
-			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
-			0x00, OPACITY_SOLID, 0
-		}, {
-			PEN_SIZE_STANDARD, 1, OFFSET_NORMAL, FALSE,
-			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
-			0x00, OPACITY_SOLID, 0
-		}, {
-			PEN_SIZE_STANDARD, 2, OFFSET_NORMAL, FALSE,
-			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
-			0x00, OPACITY_SOLID, 0
-		}, {
-			PEN_SIZE_STANDARD, 3, OFFSET_NORMAL, FALSE,
-			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
-			0x00, OPACITY_SOLID, 0
-		}, {
-			PEN_SIZE_STANDARD, 4, OFFSET_NORMAL, FALSE,
-			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
-			0x00, OPACITY_SOLID, 0
-		}, {
-			PEN_SIZE_STANDARD, 3, OFFSET_NORMAL, FALSE,
-			FALSE, EDGE_UNIFORM, 0x3F, OPACITY_SOLID,
-			0, OPACITY_TRANSPARENT, 0x00
-		}, {
-			PEN_SIZE_STANDARD, 4, OFFSET_NORMAL, FALSE,
-			FALSE, EDGE_UNIFORM, 0x3F, OPACITY_SOLID,
-			0, OPACITY_TRANSPARENT, 0x00
-		}
-	};
-	struct dtvcc_window *dw;
-	dtvcc_window_map window_map;
-	vbi_bool anchor_relative;
-	unsigned int anchor_vertical;
-	unsigned int anchor_horizontal;
-	unsigned int anchor_point;
-	unsigned int column_count_m1;
-	unsigned int window_id;
-	unsigned int window_style_id;
-	unsigned int pen_style_id;
-	unsigned int c;
-
-	if (0 != ((buf[1] | buf[6]) & 0xC0)) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	c = buf[2];
-	anchor_relative = (c >> 7) & 1;
-	anchor_vertical = c & 0x7F;
-	anchor_horizontal = buf[3];
-	if (0 == anchor_relative) {
-		if (unlikely (anchor_vertical >= 75
-			      || anchor_horizontal >= 210)) {
-			ds->error_line = __LINE__;
-			return FALSE;
-		}
-	} else {
-		if (unlikely (anchor_vertical >= 100
-			      || anchor_horizontal >= 100)) {
-			ds->error_line = __LINE__;
-			return FALSE;
-		}
-	}
-
-	c = buf[4];
-	anchor_point = c >> 4;
-	if (unlikely (anchor_point >= 9)) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	column_count_m1 = buf[5];
-	/* We also check the top two zero bits. */
-	if (unlikely (column_count_m1 >= 41)) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	window_id = buf[0] & 7;
-	dw = &ds->window[window_id];
-	window_map = 1 << window_id;
-
-	ds->curr_window = dw;
-
-	c = buf[1];
-	dw->visible = (c >> 5) & 1;
-	dw->row_lock = (c >> 4) & 1;
-	dw->column_lock = (c >> 4) & 1;
-	dw->priority = c & 7;
-
-	dw->anchor_relative = anchor_relative;
-	dw->anchor_vertical = anchor_vertical;
-	dw->anchor_horizontal = anchor_horizontal;
-	dw->anchor_point = anchor_point;
-
-	c = buf[4];
-	dw->row_count = (c & 15) + 1;
-	dw->column_count = column_count_m1 + 1;
-
-	c = buf[6];
-	window_style_id = (c >> 3) & 7;
-	pen_style_id = c & 7;
-
-	if (window_style_id > 0) {
-		dw->style = window_styles[window_style_id];
-	} else if (0 == (ds->created & window_map)) {
-		dw->style = window_styles[1];
-	}
-
-	if (pen_style_id > 0) {
-		dw->curr_pen.style = pen_styles[pen_style_id];
-	} else if (0 == (ds->created & window_map)) {
-		dw->curr_pen.style = pen_styles[1];
-	}
-
-	if (0 != (ds->created & window_map))
-		return TRUE;
-
-	/* Has to be something, no? */
-	dw->curr_pen.text_tag = TEXT_TAG_NOT_DISPLAYABLE;
-
-	dw->curr_column = 0;
-	dw->curr_row = 0;
-
-	dw->streamed = 0;
-
-	cc_timestamp_reset (&dw->timestamp_c0);
-
-	ds->created |= window_map;
-
-	return dtvcc_clear_windows (dc, ds, window_map);
-}
-
-static vbi_bool
-dtvcc_display_windows		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 unsigned int		c,
-				 dtvcc_window_map	window_map)
-{
-	unsigned int i;
-
-	window_map &= ds->created;
-
-	for (i = 0; i < 8; ++i) {
-		struct dtvcc_window *dw;
-		vbi_bool was_visible;
-
-		if (0 == (window_map & (1 << i)))
-			continue;
-
-		dw = &ds->window[i];
-		was_visible = dw->visible;
-
-		switch (c) {
-		case 0x89: /* DSW DisplayWindows */
-			dw->visible = TRUE;
-			break;
-
-		case 0x8A: /* HDW HideWindows */
-			dw->visible = FALSE;
-			break;
-
-		case 0x8B: /* TGW ToggleWindows */
-			dw->visible = was_visible ^ TRUE;
-			break;
-		}
-
-		if (!was_visible) {
-			unsigned int row;
-
-			dw->timestamp_c0 = ds->timestamp;
-			for (row = 0; row < dw->row_count; ++row) {
-				dtvcc_stream_event (dc, ds, dw, row);
-			}
-		}
-	}
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_carriage_return		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds)
-{
-	struct dtvcc_window *dw;
-	unsigned int row;
-	unsigned int column;
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	dtvcc_stream_event (dc, ds, dw, dw->curr_row);
-
-	row = dw->curr_row;
-	column = dw->curr_column;
-
-	switch (dw->style.scroll_direction) {
-	case DIR_LEFT_RIGHT:
-		dw->curr_row = 0;
-		if (column > 0) {
-			dw->curr_column = column - 1;
-			break;
-		}
-		dw->streamed = (dw->streamed << 1)
-			& ~(1 << dw->column_count);
-		for (row = 0; row < dw->row_count; ++row) {
-			for (column = dw->column_count - 1;
-			     column > 0; --column) {
-				dw->buffer[row][column] =
-					dw->buffer[row][column - 1];
-			}
-			dw->buffer[row][column] = 0;
-		}
-		break;
-
-	case DIR_RIGHT_LEFT:
-		dw->curr_row = 0;
-		if (column + 1 < dw->row_count) {
-			dw->curr_column = column + 1;
-			break;
-		}
-		dw->streamed >>= 1;
-		for (row = 0; row < dw->row_count; ++row) {
-			for (column = 0;
-			     column < dw->column_count - 1; ++column) {
-				dw->buffer[row][column] =
-					dw->buffer[row][column + 1];
-			}
-			dw->buffer[row][column] = 0;
-		}
-		break;
-
-	case DIR_TOP_BOTTOM:
-		dw->curr_column = 0;
-		if (row > 0) {
-			dw->curr_row = row - 1;
-			break;
-		}
-		dw->streamed = (dw->streamed << 1)
-			& ~(1 << dw->row_count);
-		memmove (&dw->buffer[1], &dw->buffer[0],
-			 sizeof (dw->buffer[0]) * (dw->row_count - 1));
-		memset (&dw->buffer[0], 0, sizeof (dw->buffer[0]));
-		break;
-
-	case DIR_BOTTOM_TOP:
-		dw->curr_column = 0;
-		if (row + 1 < dw->row_count) {
-			dw->curr_row = row + 1;
-			break;
-		}
-		dw->streamed >>= 1;
-		memmove (&dw->buffer[0], &dw->buffer[1],
-			 sizeof (dw->buffer[0]) * (dw->row_count - 1));
-		memset (&dw->buffer[row], 0, sizeof (dw->buffer[0]));
-		break;
-	}
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_form_feed			(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds)
-{
-	struct dtvcc_window *dw;
-	dtvcc_window_map window_map;
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	window_map = 1 << dtvcc_window_id (ds, dw);
-
-	if (!dtvcc_clear_windows (dc, ds, window_map))
-		return FALSE;
-
-	dw->curr_row = 0;
-	dw->curr_column = 0;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_backspace			(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds)
-{
-	struct dtvcc_window *dw;
-	unsigned int row;
-	unsigned int column;
-	unsigned int mask;
-
-	dc = dc; /* unused */
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	row = dw->curr_row;
-	column = dw->curr_column;
-
-	switch (dw->style.print_direction) {
-	case DIR_LEFT_RIGHT:
-		mask = 1 << row;
-		if (column-- <= 0)
-			return TRUE;
-		break;
-
-	case DIR_RIGHT_LEFT:
-		mask = 1 << row;
-		if (++column >= dw->column_count)
-			return TRUE;
-		break;
-
-	case DIR_TOP_BOTTOM:
-		mask = 1 << column;
-		if (row-- <= 0)
-			return TRUE;
-		break;
-
-	case DIR_BOTTOM_TOP:
-		mask = 1 << column;
-		if (++row >= dw->row_count)
-			return TRUE;
-		break;
-	}
-
-	if (0 != dw->buffer[row][column]) {
-		dw->streamed &= ~mask;
-		dw->buffer[row][column] = 0;
-	}
-
-	dw->curr_row = row;
-	dw->curr_column = column;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_hor_carriage_return	(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds)
-{
-	struct dtvcc_window *dw;
-	unsigned int row;
-	unsigned int column;
-	unsigned int mask;
-
-	dc = dc; /* unused */
-
-	dw = ds->curr_window;
-	if (NULL == dw) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	row = dw->curr_row;
-	column = dw->curr_column;
-
-	switch (dw->style.print_direction) {
-	case DIR_LEFT_RIGHT:
-	case DIR_RIGHT_LEFT:
-		mask = 1 << row;
-		memset (&dw->buffer[row][0], 0,
-			sizeof (dw->buffer[0]));
-		if (DIR_LEFT_RIGHT == dw->style.print_direction)
-			dw->curr_column = 0;
-		else
-			dw->curr_column = dw->column_count - 1;
-		break;
-
-	case DIR_TOP_BOTTOM:
-	case DIR_BOTTOM_TOP:
-		mask = 1 << column;
-		for (row = 0; row < dw->column_count; ++row)
-			dw->buffer[row][column] = 0;
-		if (DIR_TOP_BOTTOM == dw->style.print_direction)
-			dw->curr_row = 0;
-		else
-			dw->curr_row = dw->row_count - 1;
-		break;
-	}
-
-	dw->streamed &= ~mask;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_delete_windows		(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 dtvcc_window_map	window_map)
-{
-	struct dtvcc_window *dw;
-
-	dw = ds->curr_window;
-	if (NULL != dw) {
-		unsigned int window_id;
-		
-		window_id = dtvcc_window_id (ds, dw);
-		if (0 != (window_map & (1 << window_id))) {
-			dtvcc_stream_event (dc, ds, dw, dw->curr_row);
-			ds->curr_window = NULL;
-		}
-	}
-
-	ds->created &= ~window_map;
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_command			(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 unsigned int *		se_length,
-				 uint8_t *		buf,
-				 unsigned int		n_bytes)
-{
-	unsigned int c;
-	unsigned int window_id;
-
-	c = buf[0];
-	if ((int8_t) c < 0) {
-		*se_length = dtvcc_c1_length[c - 0x80];
-	} else {
-		*se_length = dtvcc_c0_length[c >> 3];
-	}
-
-	if (*se_length > n_bytes) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	switch (c) {
-	case 0x08: /* BS Backspace */
-		return dtvcc_backspace (dc, ds);
-
-	case 0x0C: /* FF Form Feed */
-		return dtvcc_form_feed (dc, ds);
-
-	case 0x0D: /* CR Carriage Return */
-		return dtvcc_carriage_return (dc, ds);
-
-	case 0x0E: /* HCR Horizontal Carriage Return */
-		return dtvcc_hor_carriage_return (dc, ds);
-
-	case 0x80 ... 0x87: /* CWx SetCurrentWindow */
-		window_id = c & 7;
-		if (0 == (ds->created & (1 << window_id))) {
-			ds->error_line = __LINE__;
-			return FALSE;
-		}
-		ds->curr_window = &ds->window[window_id];
-		return TRUE;
-
-	case 0x88: /* CLW ClearWindows */
-		return dtvcc_clear_windows (dc, ds, buf[1]);
-
-	case 0x89: /* DSW DisplayWindows */
-		return dtvcc_display_windows (dc, ds, c, buf[1]);
-
-	case 0x8A: /* HDW HideWindows */
-		return dtvcc_display_windows (dc, ds, c, buf[1]);
-
-	case 0x8B: /* TGW ToggleWindows */
-		return dtvcc_display_windows (dc, ds, c, buf[1]);
-
-	case 0x8C: /* DLW DeleteWindows */
-		return dtvcc_delete_windows (dc, ds, buf[1]);
-
-	case 0x8F: /* RST Reset */
-		dtvcc_reset_service (ds);
-		return TRUE;
-
-	case 0x90: /* SPA SetPenAttributes */
-		return dtvcc_set_pen_attributes (ds, buf);
-
-	case 0x91: /* SPC SetPenColor */
-		return dtvcc_set_pen_color (ds, buf);
-
-	case 0x92: /* SPL SetPenLocation */
-		return dtvcc_set_pen_location (dc, ds, buf);
-
-	case 0x97: /* SWA SetWindowAttributes */
-		return dtvcc_set_window_attributes (ds, buf);
-
-	case 0x98 ... 0x9F: /* DFx DefineWindow */
-		return dtvcc_define_window (dc, ds, buf);
-
-	default:
-		return TRUE;
-	}
-}
-
-static vbi_bool
-dtvcc_decode_se			(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 unsigned int *		se_length,
-				 uint8_t *		buf,
-				 unsigned int		n_bytes)
-{
-	unsigned int c;
-
-	c = buf[0];
-	if (likely (0 != (c & 0x60))) {
-		/* G0/G1 character. */
-		*se_length = 1;
-		return dtvcc_put_char (dc, ds, c);
-	}
-
-	if (0x10 != c) {
-		/* C0/C1 control code. */
-		return dtvcc_command (dc, ds, se_length,
-				      buf, n_bytes);
-	}
-
-	if (unlikely (n_bytes < 2)) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	c = buf[1];
-	if (likely (0 != (c & 0x60))) {
-		/* G2/G3 character. */
-		*se_length = 2;
-		return dtvcc_put_char (dc, ds, 0x1000 | c);
-	}
-
-	/* CEA 708-C defines no C2 or C3 commands. */
-
-	if ((int8_t) c >= 0) {
-		/* C2 code. */
-		*se_length = (c >> 3) + 2;
-	} else if (c < 0x90) {
-		/* C3 Fixed Length Commands. */
-		*se_length = (c >> 3) - 10;
-	} else {
-		/* C3 Variable Length Commands. */
-
-		if (unlikely (n_bytes < 3)) {
-			ds->error_line = __LINE__;
-			return FALSE;
-		}
-
-		/* type [2], zero_bit [1],
-		   length [5] */
-		*se_length = (buf[2] & 0x1F) + 3;
-	}
-
-	if (unlikely (n_bytes < *se_length)) {
-		ds->error_line = __LINE__;
-		return FALSE;
-	}
-
-	return TRUE;
-}
-
-static vbi_bool
-dtvcc_decode_syntactic_elements	(struct dtvcc_decoder *	dc,
-				 struct dtvcc_service *	ds,
-				 uint8_t *		buf,
-				 unsigned int		n_bytes)
-{
-	ds->timestamp = dc->timestamp;
-
-	while (n_bytes > 0) {
-		unsigned int se_length;
-
-		if (option_debug & DEBUG_DTVCC_SE) {
-			fprintf (stderr, "S%u ",
-				 dtvcc_service_num (dc, ds));
-			dump_dtvcc_se (stderr, buf, n_bytes);
-		}
-
-		if (0x8D /* DLY */ == *buf
-		    || 0x8E /* DLC */ == *buf) {
-			/* FIXME ignored for now. */
-			++buf;
-			--n_bytes;
-			continue;
-		}
-
-		if (!dtvcc_decode_se (dc, ds,
-				      &se_length,
-				      buf, n_bytes)) {
-			return FALSE;
-		}
-
-		buf += se_length;
-		n_bytes -= se_length;
-	}
-
-	return TRUE;
-}
-
-static void
-dtvcc_decode_packet		(struct dtvcc_decoder *	dc,
-				 const struct timeval *	tv,
-				 int64_t		pts)
-{
-	unsigned int packet_size_code;
-	unsigned int packet_size;
-	unsigned int i;
-
-	dc->timestamp.sys = *tv;
-	dc->timestamp.pts = pts;
-
-	/* Packet Layer. */
-
-	/* sequence_number [2], packet_size_code [6],
-	   packet_data [n * 8] */
-
-	if (dc->next_sequence_number >= 0
-	    && 0 != ((dc->packet[0] ^ dc->next_sequence_number) & 0xC0)) {
-		struct program *pr;
-
-		pr = PARENT (dc, struct program, cr.dtvcc);
-		log (4, "Station %u DTVCC packet lost.\n",
-		     station_num (pr));
-		dtvcc_reset (dc);
-		return;
-	}
-
-	dc->next_sequence_number = dc->packet[0] + 0x40;
-
-	packet_size_code = dc->packet[0] & 0x3F;
-	packet_size = 128;
-	if (packet_size_code > 0)
-		packet_size = packet_size_code * 2;
-
-	if (option_debug & DEBUG_DTVCC_PACKET) {
-		unsigned int sequence_number;
-
-		sequence_number = (dc->packet[0] >> 6) & 3;
-		fprintf (stderr, "DTVCC packet packet_size=%u "
-			 "(transmitted %u), sequence_number %u\n",
-			 packet_size, dc->packet_size,
-			 sequence_number);
-		dump (stderr, dc->packet, dc->packet_size);
-	}
-
-	/* CEA 708-C Section 5: Apparently packet_size need not be
-	   equal to the actually transmitted amount of data. */
-	if (packet_size > dc->packet_size) {
-		struct program *pr;
-
-		pr = PARENT (dc, struct program, cr.dtvcc);
-		log (4, "Station %u DTVCC packet incomplete (%u/%u).\n",
-		     station_num (pr),
-		     dc->packet_size, packet_size);
-		dtvcc_reset (dc);
-		return;
-	}
-
-	/* Service Layer. */
-
-	/* CEA 708-C Section 6.2.5, 6.3: Service Blocks and syntactic
-	   elements must not cross Caption Channel Packet
-	   boundaries. */
-
-	for (i = 1; i < packet_size;) {
-		unsigned int service_number;
-		unsigned int block_size;
-		unsigned int header_size;
-		unsigned int c;
-
-		header_size = 1;
-
-		/* service_number [3], block_size [5],
-		   (null_fill [2], extended_service_number [6]),
-		   (Block_data [n * 8]) */
-
-		c = dc->packet[i]; 
-		service_number = (c & 0xE0) >> 5;
-
-		/* CEA 708-C Section 6.3: Ignore block_size if
-		   service_number is zero. */
-		if (0 == service_number) {
-			/* NULL Service Block Header, no more data in
-			   this Caption Channel Packet. */
-			break;
-		}
-
-		/* CEA 708-C Section 6.2.1: Apparently block_size zero
-		   is valid, although properly it should only occur in
-		   NULL Service Block Headers. */
-		block_size = c & 0x1F;
-
-		if (7 == service_number) {
-			if (i + 1 > packet_size)
-				goto service_block_incomplete;
-
-			header_size = 2;
-			c = dc->packet[i + 1];
-
-			/* We also check the null_fill bits. */
-			if (c < 7 || c > 63)
-				goto invalid_service_block;
-
-			service_number = c;
-		}
-
-		if (i + header_size + block_size > packet_size)
-			goto service_block_incomplete;
-
-		if (service_number <= 2) {
-			struct dtvcc_service *ds;
-			unsigned int in;
-
-			ds = &dc->service[service_number - 1];
-			in = ds->service_data_in;
-			memcpy (ds->service_data + in,
-				dc->packet + i + header_size,
-				block_size);
-			ds->service_data_in = in + block_size;
-		}
-
-		i += header_size + block_size;
-	}
-
-	for (i = 0; i < 2; ++i) {
-		struct dtvcc_service *ds;
-		struct program *pr;
-		vbi_bool success;
-
-		ds = &dc->service[i];
-		if (0 == ds->service_data_in)
-			continue;
-
-		success = dtvcc_decode_syntactic_elements
-			(dc, ds, ds->service_data, ds->service_data_in);
-
-		ds->service_data_in = 0;
-
-		if (success)
-			continue;
-
-		pr = PARENT (dc, struct program, cr.dtvcc);
-		log (4, "Station %u DTVCC invalid "
-		     "syntactic element (%u).\n",
-		     station_num (pr), ds->error_line);
-
-		if (option_debug & DEBUG_DTVCC_PACKET) {
-			fprintf (stderr, "Packet (%d/%d):\n",
-				 packet_size, dc->packet_size);
-			dump (stderr, dc->packet, packet_size);
-			fprintf (stderr, "Service Data:\n");
-			dump (stderr, ds->service_data,
-			      ds->service_data_in);
-		}
-
-		dtvcc_reset_service (ds);
-	}
-
-	return;
-
- invalid_service_block:
-	{
-		struct program *pr;
-
-		pr = PARENT (dc, struct program, cr.dtvcc);
-		log (4, "Station %u DTVCC invalid "
-		     "service block (%u).\n",
-		     station_num (pr), i);
-		if (option_debug & DEBUG_DTVCC_PACKET) {
-			fprintf (stderr, "Packet (%d/%d):\n",
-				 packet_size, dc->packet_size);
-			dump (stderr, dc->packet, packet_size);
-		}
-		dtvcc_reset (dc);
-		return;
-	}
-
- service_block_incomplete:
-	{
-		struct program *pr;
-
-		pr = PARENT (dc, struct program, cr.dtvcc);
-		log (4, "Station %u DTVCC incomplete "
-		     "service block (%u).\n",
-		     station_num (pr), i);
-		if (option_debug & DEBUG_DTVCC_PACKET) {
-			fprintf (stderr, "Packet (%d/%d):\n",
-				 packet_size, dc->packet_size);
-			dump (stderr, dc->packet, packet_size);
-		}
-		dtvcc_reset (dc);
-		return;
-	}
-
-}
-
-static void
-dtvcc_reset_service		(struct dtvcc_service *	ds)
-{
-	ds->curr_window = NULL;
-	ds->created = 0;
-
-	cc_timestamp_reset (&ds->timestamp);
-}
-
-static void
-dtvcc_reset			(struct dtvcc_decoder *	dc)
-{
-	dtvcc_reset_service (&dc->service[0]);
-	dtvcc_reset_service (&dc->service[1]);
-
-	dc->packet_size = 0;
-	dc->next_sequence_number = -1;
-}
-
-static void
-init_dtvcc_decoder		(struct dtvcc_decoder *	dc)
-{
-	dtvcc_reset (dc);
-
-	cc_timestamp_reset (&dc->timestamp);
-}
-
-/* ATSC A/53 Part 4:2007 Closed Caption Data decoder */
-
-static void
-dump_cc_data_pair		(FILE *			fp,
-				 unsigned int		index,
-				 const uint8_t		buf[3])
-{
-	unsigned int one_bit;
-	unsigned int reserved;
-	unsigned int cc_valid;
-	enum cc_type cc_type;
-	unsigned int cc_data_1;
-	unsigned int cc_data_2;
-
-	/* Was marker_bits: "11111". */
-	one_bit = (buf[0] >> 7) & 1;
-	reserved = (buf[0] >> 3) & 15;
-
-	cc_valid = (buf[0] >> 2) & 1;
-	cc_type = (enum cc_type)(buf[0] & 3);
-	cc_data_1 = buf[1];
-	cc_data_2 = buf[2];
-
-	fprintf (fp, "  %2u '1F'=%u%X%s valid=%u type=%s "
-		 "%02x %02x '%c%c'\n",
-		 index, one_bit, reserved,
-		 (1 != one_bit || 0xF != reserved) ? "*" : "",
-		 cc_valid, cc_type_name (cc_type),
-		 cc_data_1, cc_data_2,
-		 printable (cc_data_1), printable (cc_data_2));
-}
-
-static void
-dump_cc_data			(FILE *			fp,
-				 const uint8_t *	buf,
-				 unsigned int		n_bytes,
-				 int64_t		pts,
-				 int64_t		last_pts)
-{
-	unsigned int reserved1;
-	unsigned int process_cc_data_flag;
-	unsigned int zero_bit;
-	unsigned int cc_count;
-	unsigned int reserved2;
-	unsigned int same;
-	unsigned int marker_bits;
-	unsigned int i;
-
-	/* Was process_em_data_flag: "This flag is set to
-	   indicate whether it is necessary to process the em_data. If
-	   it is set to 1, the em_data has to be parsed and its
-	   meaning has to be processed. When it is set to 0, the
-	   em_data can be discarded." */
-	reserved1 = (buf[9] >> 7) & 1;
-
-	process_cc_data_flag = (buf[9] >> 6) & 1;
-
-	/* Was: additional_cc_data. */
-	zero_bit = (buf[9] >> 5) & 1;
-
-	cc_count = buf[9] & 0x1F;
-
-	/* Was em_data: "Eight bits for representing emergency
-	   message." */
-	reserved2 = buf[10];
-
-	fprintf (fp, "cc_data pts=%" PRId64 " (%+" PRId64 ") "
-		 "'1'=%u%s process_cc_data_flag=%u "
-		 "'0'=%u%s cc_count=%u 'FF'=0x%02X%s:\n",
-		 pts, pts - last_pts, reserved1,
-		 (1 != reserved1) ? "*" : "", process_cc_data_flag,
-		 zero_bit, (0 != zero_bit) ? "*" : "",
-		 cc_count, reserved2,
-		 (0xFF != reserved2) ? "*" : "");
-
-	same = 0;
-	for (i = 0; i <= cc_count; ++i) {
-		if (i > 0 && i < cc_count
-		    && 0 == memcmp (&buf[11 + i * 3],
-				    &buf[ 8 + i * 3], 3)) {
-			++same;
-		} else {
-			if (same > 1) {
-				fprintf (fp, "  %2u-%u as above\n",
-					 i - same, i - 1);
-			} else if (same > 0) {
-				dump_cc_data_pair (fp, i - 1, &buf[8 + i * 3]);
-			}
-			if (i < cc_count)
-				dump_cc_data_pair (fp, i, &buf[11 + i * 3]);
-			same = 0;
-		}
-	}
-
-	marker_bits = buf[11 + cc_count * 3];
-
-	fprintf (fp, "  marker_bits=0x%02X%s\n",
-		 marker_bits, (0xFF != marker_bits) ? "*" : "");
-
-	if (n_bytes > 12 + cc_count * 3) {
-		fprintf (fp, "  extraneous");
-		for (i = 12 + cc_count * 3; i < n_bytes; ++i)
-			fprintf (stderr, " %02x", buf[i]);
-		fputc ('\n', stderr);
-	}
-}
-
-/* Note pts may be < 0 if no PTS was received. */
+/* Note pts may be < 0 if no PTS was received. */
 static void
 decode_cc_data			(struct program *	pr,
 				 int64_t		pts,
@@ -6060,6 +4152,7 @@ decode_cc_data			(struct program *	pr,
 	unsigned int cc_count;
 	unsigned int i;
 	vbi_bool dtvcc;
+	double capture_time;
 
 	if (NULL == buf || n_bytes < 10)
 		return;
@@ -6084,6 +4177,8 @@ decode_cc_data			(struct program *	pr,
 	cc_count = buf[9] & 0x1F;
 	dtvcc = FALSE;
 
+	capture_time = pr->now.tv_sec + pr->now.tv_usec * (1 / 1e6);
+
 	if (NULL != pr->cr.ccd.cc_data_tap_fp) {
 		static uint8_t output_buffer [8 + 11 + 31 * 3];
 		unsigned int in;
@@ -6161,41 +4256,45 @@ decode_cc_data			(struct program *	pr,
 			break;
 
 		case DTVCC_DATA:
-			j = pr->cr.dtvcc.packet_size;
+			j = pr->cr.ccd.packet_size;
 			if (j <= 0) {
 				/* Missed packet start. */
 				break;
 			} else if (!cc_valid) {
 				/* End of DTVCC packet. */
-				dtvcc_decode_packet (&pr->cr.dtvcc,
-						     &pr->now, pr->cc_pts);
-				pr->cr.dtvcc.packet_size = 0;
+				_vbi_dtvcc_decoder_feed (pr->cr.dtvcc,
+							 pr->cr.ccd.packet, j,
+							 capture_time,
+							 pr->cc_pts);
+				pr->cr.ccd.packet_size = 0;
 			} else if (j >= 128) {
 				/* Packet buffer overflow. */
-				dtvcc_reset (&pr->cr.dtvcc);
-				pr->cr.dtvcc.packet_size = 0;
+				_vbi_dtvcc_decoder_reset (pr->cr.dtvcc);
+				pr->cr.ccd.packet_size = 0;
 			} else {
-				pr->cr.dtvcc.packet[j] = cc_data_1;
-				pr->cr.dtvcc.packet[j + 1] = cc_data_2;
-				pr->cr.dtvcc.packet_size = j + 2;
+				pr->cr.ccd.packet[j] = cc_data_1;
+				pr->cr.ccd.packet[j + 1] = cc_data_2;
+				pr->cr.ccd.packet_size = j + 2;
 			}
 			break;
 
 		case DTVCC_START:
 			dtvcc = TRUE;
-			j = pr->cr.dtvcc.packet_size;
+			j = pr->cr.ccd.packet_size;
 			if (j > 0) {
 				/* End of DTVCC packet. */
-				dtvcc_decode_packet (&pr->cr.dtvcc,
-						     &pr->now, pr->cc_pts);
+				_vbi_dtvcc_decoder_feed (pr->cr.dtvcc,
+							 pr->cr.ccd.packet, j,
+							 capture_time,
+							 pr->cc_pts);
 			}
 			if (!cc_valid) {
 				/* No new data. */
-				pr->cr.dtvcc.packet_size = 0;
+				pr->cr.ccd.packet_size = 0;
 			} else {
-				pr->cr.dtvcc.packet[0] = cc_data_1;
-				pr->cr.dtvcc.packet[1] = cc_data_2;
-				pr->cr.dtvcc.packet_size = 2;
+				pr->cr.ccd.packet[0] = cc_data_1;
+				pr->cr.ccd.packet[1] = cc_data_2;
+				pr->cr.ccd.packet_size = 2;
 			}
 			break;
 		}
@@ -9382,10 +7481,6 @@ debug_option			(const char *		optarg)
 		{ "ccf1",		DEBUG_CC_F1 },
 		{ "ccf2",		DEBUG_CC_F2 },
 		{ "conf",		DEBUG_CONFIG },
-		{ "dtvccp",		DEBUG_DTVCC_PACKET },
-		{ "dtvccpc",		DEBUG_DTVCC_PUT_CHAR },
-		{ "dtvccse",		DEBUG_DTVCC_SE },
-		{ "dtvccsev",		DEBUG_DTVCC_STREAM_EVENT },
 		{ "vesdcc",		DEBUG_VESD_CC_DATA },
 		{ "vesdpe",		DEBUG_VESD_PIC_EXT },
 		{ "vesdph",		DEBUG_VESD_PIC_HDR },
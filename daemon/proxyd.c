@@ -97,6 +97,7 @@ static const char rcsid[] = "$Id: proxyd.c,v 1.20 2013-08-28 14:45:58 mschimek E
 #include <signal.h>
 #include <assert.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "src/vbi.h"
 #include "src/io.h"
@@ -123,23 +124,45 @@ do {									\
 #define  PVOID2INT(X)    ((int)((long)(X)))
 #define  INT2PVOID(X)    ((void *)((long)(X)))
 
+/* Synchronization of the lock-free slicer output ring (see PROXY_RING) */
+#ifdef __ATOMIC_ACQUIRE
+#define RING_LOAD_ACQUIRE(P)     __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define RING_LOAD_RELAXED(P)     __atomic_load_n((P), __ATOMIC_RELAXED)
+#define RING_STORE_RELEASE(P,V)  __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+#define RING_STORE_RELAXED(P,V)  __atomic_store_n((P), (V), __ATOMIC_RELAXED)
+#define RING_FENCE_ACQUIRE()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define RING_FENCE_RELEASE()     __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define RING_LOAD_ACQUIRE(P)     ({ uint32_t v_ = *(volatile uint32_t *)(P); __sync_synchronize(); v_; })
+#define RING_LOAD_RELAXED(P)     (*(volatile uint32_t *)(P))
+#define RING_STORE_RELEASE(P,V)  do { __sync_synchronize(); *(volatile uint32_t *)(P) = (V); } while (0)
+#define RING_STORE_RELAXED(P,V)  do { *(volatile uint32_t *)(P) = (V); } while (0)
+#define RING_FENCE_ACQUIRE()     __sync_synchronize()
+#define RING_FENCE_RELEASE()     __sync_synchronize()
+#endif
+
 /* ----------------------------------------------------------------------------
-** This struct is one element in the slicer data queue
+** This struct is one slot in the slicer output ring
 */
-typedef struct PROXY_QUEUE_s
+typedef struct
 {
-        struct PROXY_QUEUE_s  * p_next;
-        unsigned int            ref_count;
-        unsigned int            use_count;
-
-        int                     max_lines;
         int                     line_count;
         double                  timestamp;
-        void                  * p_raw_data;
-        vbi_sliced              lines[1];
-} PROXY_QUEUE;
+        vbi_sliced            * p_lines;
+        uint8_t               * p_raw_data;
+} PROXY_RING_SLOT;
 
-#define QUEUE_ELEM_SIZE(Q,C)  (sizeof(PROXY_QUEUE) + (sizeof(vbi_sliced) * ((C) - 1)))
+/* Slicer output ring: single producer, one read position per client */
+typedef struct
+{
+        PROXY_RING_SLOT       * p_slots;
+        unsigned int            size;           /* power of two */
+        int                     max_lines;
+        vbi_bool                has_raw;
+
+        uint32_t                head;           /* number of frames written */
+        uint32_t                claim;          /* head + 1 while a slot is written */
+} PROXY_RING;
 
 /* ----------------------------------------------------------------------------
 ** Declaration of types of internal state variables
@@ -148,8 +171,9 @@ typedef struct PROXY_QUEUE_s
 /* Note mutex conventions:
 ** - mutex are only required for v4l devices which do not support select(2),
 **   because only then a separate thread is started which blocks in read(2)
-** - when both the client chain and a slicer queue mutex is required, the
-**   client mutex is acquired first; order is important to prevent deadlocks
+** - the acquisition thread and the master thread exchange slicer output
+**   through a lock-free ring; the acquisition thread does not access the
+**   client chain
 ** - the master thread locks the client chain mutex only for write access,
 **   i.e. if a client is added or removed
 */
@@ -185,13 +209,26 @@ typedef enum
         REQ_STATE_CLOSED,
 } REQ_STATE;
 
-#define SRV_MAX_DEVICES                 4
 #define VBI_MAX_BUFFER_COUNT           32
+#define SRV_RING_MIN_SIZE              16
+#define SRV_RING_MAX_SIZE            1024
 #define VBI_MIN_STRICT                 -1
 #define VBI_MAX_STRICT                  2
 #define VBI_GET_SERVICE_P(PREQ,STRICT)  ((PREQ)->services + (signed)(STRICT) - VBI_MIN_STRICT)
 #define VBI_RAW_SERVICES(SRV)           (((SRV) & (VBI_SLICED_VBI_625 | VBI_SLICED_VBI_525)) != 0)
 
+/* histogram of durations in microseconds: log-linear buckets with four
+** sub-buckets per power of two, i.e. the resolution is 25% at worst */
+#define PROXY_HIST_SUB_BITS     2
+#define PROXY_HIST_BUCKETS      ((32 - 1) << PROXY_HIST_SUB_BITS)
+typedef struct
+{
+        uint32_t                count;
+        uint32_t                max;
+        double                  sum;
+        uint32_t                bucket[PROXY_HIST_BUCKETS];
+} PROXY_HIST;
+
 /* this struct holds client-specific state and parameters */
 typedef struct PROXY_CLNT_s
 {
@@ -211,7 +248,13 @@ typedef struct PROXY_CLNT_s
         int                     vbi_count[2];
         int                     buffer_count;
         vbi_bool                buffer_overflow;
-        PROXY_QUEUE           * p_sliced;
+        uint32_t                ring_pos;
+        unsigned int            drop_count;
+
+        char                    client_name[VBIPROXY_CLIENT_NAME_MAX_LENGTH];
+        int                     pid;
+        uint32_t                frames_forwarded;
+        PROXY_HIST              latency;
 
         vbi_channel_profile     chn_profile;
         VBIPROXY_CHN_STATE      chn_state;
@@ -235,12 +278,22 @@ typedef struct
         unsigned int            all_services;
         unsigned int            scanning;
         int                     max_lines;
-        PROXY_QUEUE           * p_sliced;
-        PROXY_QUEUE           * p_free;
-        PROXY_QUEUE           * p_tmp_buf;
+        PROXY_RING              ring;
 
         VBI_CHN_PRIO            chn_prio;
 
+        /* statistics: captured frames are counted by the ring head;
+        ** errors, losses and slicing times are counted by the worker
+        ** thread, all others by the master thread */
+        uint32_t                read_errors;
+        uint32_t                frames_lost;
+        double                  last_timestamp;
+        PROXY_HIST              slicing;
+        uint32_t                frames_forwarded;
+        uint32_t                frames_dropped;
+        PROXY_HIST              latency;
+
+        int                     cpu;
         vbi_bool                use_thread;
         int                     wr_fd;
         vbi_bool                wait_for_exit;
@@ -248,7 +301,6 @@ typedef struct
         pthread_t               thread_id;
         pthread_cond_t          start_cond;
         pthread_mutex_t         start_mutex;
-        pthread_mutex_t         queue_mutex;
 
 } PROXY_DEV;
 
@@ -267,7 +319,7 @@ typedef struct
         int                     clnt_count;
         pthread_mutex_t         clnt_mutex;
 
-        PROXY_DEV               dev[4];
+        PROXY_DEV             * dev;
         int                     dev_count;
 
 } PROXY_SRV;
@@ -275,6 +327,8 @@ typedef struct
 #define SRV_CONNECT_TIMEOUT     60
 #define SRV_STALLED_STATS_INTV  15
 #define SRV_QUEUE_BUFFER_COUNT  10
+#define SRV_ACQ_READ_TIMEOUT    1000
+#define SRV_STATS_MAX_READ      (256 * 1024)
 
 #define DEFAULT_MAX_CLIENTS     10
 #define DEFAULT_VBI_DEV_PATH    "/dev/vbi"
@@ -294,429 +348,368 @@ static int            opt_log_level = -1;
 static int            opt_syslog_level = -1;
 static vbi_bool       opt_no_detach = FALSE;
 static vbi_bool       opt_kill_daemon = FALSE;
+static vbi_bool       opt_query_stats = FALSE;
 static unsigned int   opt_max_clients = DEFAULT_MAX_CLIENTS;
 static unsigned int   opt_debug_level = 0;
 static unsigned int   opt_buffer_count = DEFAULT_BUFFER_COUNT;
 
 /* ----------------------------------------------------------------------------
-** Add one buffer to the tail of a queue
-** - slicer queue is organized so that new data is appended to the tail,
-**   forwarded data is taken from the head
-** - note that a buffer is not released from the slicer queue until all
-**   clients have processed it's data; client structs hold a pointer to
-**   the first unprocessed (by the respective client) buffer in the queue
+** Slicer output ring
+** - the ring has a fixed number of slots which are written by the acquisition
+**   thread (or by the master thread for devices which support select) and
+**   read by the master thread on behalf of all clients of the device
+** - each client has its own read position, hence buffers are never held
+**   back until all clients have processed them
+** - the producer announces the frame it is about to overwrite in "claim"
+**   before writing the slot and publishes the frame in "head" afterwards;
+**   readers copy a slot and check afterwards that it was not claimed in the
+**   meantime (i.e. a sequence lock), so neither side takes a mutex
+** - a client falling behind by the size of the ring skips ahead; the skipped
+**   frames are counted as dropped
 */
-static void vbi_proxy_queue_add_tail( PROXY_QUEUE ** q, PROXY_QUEUE * p_buf )
+static void vbi_proxy_ring_free( PROXY_RING * p_ring )
 {
-   PROXY_QUEUE * p_last;
-
-   dprintf(DBG_QU, "queue_add_tail: buffer 0x%lX\n", (long)p_buf);
-   p_buf->p_next = NULL;
-
-   if (*q != NULL)
+   if (p_ring->p_slots != NULL)
    {
-      assert(*q != p_buf);
-      p_last = *q;
-      while (p_last->p_next != NULL)
-         p_last = p_last->p_next;
-
-      p_last->p_next = p_buf;
-   }
-   else
-      *q = p_buf;
-
-   assert((*q != NULL) && ((*q)->p_next != *q));
-}
-
-/* ----------------------------------------------------------------------------
-** Retrieve one buffer from the queue of unused buffers
-** - checks if the buffer size still matches the current VBI format
-**   if not, the buffer is re-allocated
-*/
-static PROXY_QUEUE * vbi_proxy_queue_get_free( PROXY_DEV * p_proxy_dev )
-{
-   PROXY_QUEUE * p_buf;
-
-   pthread_mutex_lock(&p_proxy_dev->queue_mutex);
-
-   p_buf = p_proxy_dev->p_free;
-   if (p_buf != NULL)
-   {
-      p_proxy_dev->p_tmp_buf = p_buf;
-      p_proxy_dev->p_free    = p_buf->p_next;
-
-      pthread_mutex_unlock(&p_proxy_dev->queue_mutex);
-
-      if (p_buf->max_lines != p_proxy_dev->max_lines)
-      {
-         /* max line parameter changed -> re-alloc the buffer */
-         p_proxy_dev->p_tmp_buf = NULL;
-         if (p_buf->p_raw_data != NULL)
-            free(p_buf->p_raw_data);
-         free(p_buf);
-
-         p_buf = malloc(QUEUE_ELEM_SIZE(p_buf, p_proxy_dev->max_lines));
-         p_buf->p_raw_data = NULL;
-         p_buf->max_lines = p_proxy_dev->max_lines;
-         p_proxy_dev->p_tmp_buf = p_buf;
-      }
-
-      /* add/remove "sub-buffer" for raw data */
-      if (VBI_RAW_SERVICES(p_proxy_dev->all_services))
-      {
-         if (p_buf->p_raw_data == NULL)
-            p_buf->p_raw_data = malloc(p_proxy_dev->max_lines * VBIPROXY_RAW_LINE_SIZE);
-      }
-      else
-      {
-         if (p_buf->p_raw_data != NULL)
-            free(p_buf->p_raw_data);
-         p_buf->p_raw_data = NULL;
-      }
-
-      p_buf->p_next     = NULL;
-      p_buf->ref_count  = 0;
-      p_buf->use_count  = 0;
+      free(p_ring->p_slots[0].p_lines);
+      if (p_ring->p_slots[0].p_raw_data != NULL)
+         free(p_ring->p_slots[0].p_raw_data);
+      free(p_ring->p_slots);
+      p_ring->p_slots = NULL;
    }
-   else
-      pthread_mutex_unlock(&p_proxy_dev->queue_mutex);
-
-   dprintf(DBG_QU, "queue_get_free: buffer 0x%lX\n", (long)p_buf);
-   return p_buf;
+   p_ring->size = 0;
 }
 
 /* ----------------------------------------------------------------------------
-** Add a buffer to the queue of unused buffers
-** - there's no ordering between buffers in the free queue, hence we don't
-**   care if the buffer is inserted at head or tail of the queue
+** Set the read position of a client to the newest frame
 */
-static void vbi_proxy_queue_add_free( PROXY_DEV * p_proxy_dev, PROXY_QUEUE * p_buf )
+static void vbi_proxy_ring_sync_clnt( PROXY_CLNT * req )
 {
-   dprintf(DBG_QU, "queue_add_free: buffer 0x%lX\n", (long)p_buf);
-
-   p_buf->p_next = p_proxy_dev->p_free;
-   p_proxy_dev->p_free = p_buf;
+   req->ring_pos = RING_LOAD_ACQUIRE(&proxy.dev[req->dev_idx].ring.head);
 }
 
 /* ----------------------------------------------------------------------------
-** Decrease reference counter on a buffer, add back to free queue upon zero
-** - called when a buffer has been processed for one client
+** Discard all unprocessed frames of all clients of a device
+** - called after channel changes
 */
-static void vbi_proxy_queue_release_sliced( PROXY_CLNT * req )
+static void vbi_proxy_ring_flush( int dev_idx )
 {
-   PROXY_QUEUE * p_buf;
-   PROXY_DEV   * p_proxy_dev;
-
-   p_proxy_dev = proxy.dev + req->dev_idx;
-
-   p_buf = req->p_sliced;
-   req->p_sliced = p_buf->p_next;
-
-   if (p_buf->ref_count > 0)
-      p_buf->ref_count -= 1;
-
-   if (p_buf->ref_count == 0)
-   {
-      assert(p_proxy_dev->p_sliced == p_buf);
-      p_proxy_dev->p_sliced = p_buf->p_next;
-
-      /* add the buffer to the free queue */
-      p_buf->p_next = p_proxy_dev->p_free;
-      p_proxy_dev->p_free = p_buf;
-   }
-}
-
-/* ----------------------------------------------------------------------------
-** Free all resources of all buffers in a queue
-** - called upon stop of acquisition for all queues
-*/
-static void vbi_proxy_queue_release_all( int dev_idx )
-{
-   PROXY_DEV   * p_proxy_dev;
    PROXY_CLNT  * req;
-   PROXY_QUEUE * p_next;
-
-   p_proxy_dev = proxy.dev + dev_idx;
-
-   pthread_mutex_lock(&p_proxy_dev->queue_mutex);
-   while (p_proxy_dev->p_sliced != NULL)
-   {
-      p_next = p_proxy_dev->p_sliced->p_next;
-
-      vbi_proxy_queue_add_free(p_proxy_dev, p_proxy_dev->p_sliced);
-
-      p_proxy_dev->p_sliced = p_next;
-   }
 
    for (req = proxy.p_clnts; req != NULL; req = req->p_next)
    {
       if (req->dev_idx == dev_idx)
       {
-         req->p_sliced    = NULL;
+         vbi_proxy_ring_sync_clnt(req);
       }
    }
-   pthread_mutex_unlock(&p_proxy_dev->queue_mutex);
 }
 
 /* ----------------------------------------------------------------------------
-** Free all resources of all buffers in a queue
-** - called upon stop of acquisition for all queues
+** Check if there are frames to be forwarded to a client
+** - clients which do not receive data just follow the producer
 */
-static void vbi_proxy_queue_free_all( PROXY_QUEUE ** q )
+static vbi_bool vbi_proxy_ring_pending( PROXY_CLNT * req )
 {
-   PROXY_QUEUE * p_next;
+   PROXY_RING  * p_ring = &proxy.dev[req->dev_idx].ring;
 
-   while (*q != NULL)
+   if ( (req->state != REQ_STATE_FORWARD) ||
+        (req->all_services == 0) ||
+        (p_ring->p_slots == NULL) )
    {
-      p_next = (*q)->p_next;
-
-      if ((*q)->p_raw_data != NULL)
-         free((*q)->p_raw_data);
-
-      free(*q);
-
-      *q = p_next;
+      vbi_proxy_ring_sync_clnt(req);
+      return FALSE;
    }
+
+   return (req->ring_pos != RING_LOAD_ACQUIRE(&p_ring->head));
 }
 
 /* ----------------------------------------------------------------------------
-** Allocate buffers
-** - determines number of required buffers and adds or removes buffers from queue
-** - buffer count depends on
-**   (i) minimum which is always allocated (>= number of raw buffers)
-**   (ii) max. requested buffer count of all connected clients
-**   (iii) number of clients (one spare for each client)
+** Allocate the ring
+** - the size depends on the max. requested buffer count of all connected
+**   clients; slow clients only determine how many frames they can lag behind
+** - slots are re-allocated when the VBI format changed; must not be called
+**   while the acquisition thread is running
 */
-static vbi_bool vbi_proxy_queue_allocate( int dev_idx )
+static vbi_bool vbi_proxy_ring_allocate( int dev_idx )
 {
    PROXY_DEV    * p_proxy_dev;
+   PROXY_RING   * p_ring;
    PROXY_CLNT   * p_walk;
-   PROXY_QUEUE  * p_buf;
-   int  client_count;
-   int  buffer_count;
-   int  buffer_free;
-   int  buffer_used;
+   vbi_sliced   * p_lines;
+   uint8_t      * p_raw_data;
+   vbi_bool       has_raw;
+   unsigned int   buffer_count;
+   unsigned int   size;
+   unsigned int   idx;
 
    p_proxy_dev = proxy.dev + dev_idx;
+   p_ring = &p_proxy_dev->ring;
 
    buffer_count = opt_buffer_count;
-   client_count = 0;
    for (p_walk = proxy.p_clnts; p_walk != NULL; p_walk = p_walk->p_next)
    {
-      if (p_walk->dev_idx == dev_idx)
+      if ( (p_walk->dev_idx == dev_idx) &&
+           (p_walk->buffer_count > 0) &&
+           (buffer_count < (unsigned int) p_walk->buffer_count) )
       {
-         client_count += 1;
-         if (buffer_count < p_walk->buffer_count)
-            buffer_count = p_walk->buffer_count;
+         buffer_count = p_walk->buffer_count;
       }
    }
-   buffer_count += client_count;
 
-   pthread_mutex_lock(&p_proxy_dev->queue_mutex);
+   /* power of two, with room for a client to lag behind by its buffer count
+   ** while the producer writes the next frames */
+   size = SRV_RING_MIN_SIZE;
+   while ((size < 2 * buffer_count) && (size < SRV_RING_MAX_SIZE))
+      size *= 2;
+
+   has_raw = VBI_RAW_SERVICES(p_proxy_dev->all_services);
 
-   /* count buffers in sliced data output queue */
-   buffer_used = 0;
-   for (p_buf = p_proxy_dev->p_sliced; p_buf != NULL; p_buf = p_buf->p_next)
+   if ( (p_ring->p_slots != NULL) &&
+        (p_ring->size == size) &&
+        (p_ring->max_lines == p_proxy_dev->max_lines) &&
+        (p_ring->has_raw == has_raw) )
    {
-      buffer_used += 1;
+      return TRUE;
    }
-   /* count buffers in free queue */
-   buffer_free = 0;
-   for (p_buf = p_proxy_dev->p_free; p_buf != NULL; p_buf = p_buf->p_next)
+
+   dprintf(DBG_MSG, "ring_allocate: %u slots of %d lines (was %u), raw %d\n", size, p_proxy_dev->max_lines, p_ring->size, has_raw);
+
+   vbi_proxy_ring_free(p_ring);
+
+   p_ring->p_slots = calloc(size, sizeof(*p_ring->p_slots));
+   p_lines = malloc(size * MAX(p_proxy_dev->max_lines, 1) * sizeof(vbi_sliced));
+   p_raw_data = NULL;
+   if (has_raw)
+      p_raw_data = malloc(size * p_proxy_dev->max_lines * VBIPROXY_RAW_LINE_SIZE);
+
+   if ( (p_ring->p_slots == NULL) || (p_lines == NULL) ||
+        (has_raw && (p_raw_data == NULL)) )
    {
-      buffer_free += 1;
+      dprintf(DBG_MSG, "ring_allocate: failed to allocate %u slots (errno %d)\n", size, errno);
+      if (p_ring->p_slots != NULL)
+         free(p_ring->p_slots);
+      if (p_lines != NULL)
+         free(p_lines);
+      if (p_raw_data != NULL)
+         free(p_raw_data);
+      p_ring->p_slots = NULL;
+      return FALSE;
    }
 
-   dprintf(DBG_MSG, "queue_allocate: need %d buffers, have %d+%d (free+used)\n", buffer_count, buffer_free, buffer_used);
-
-   if (buffer_free + buffer_used > buffer_count)
+   for (idx = 0; idx < size; idx++)
    {
-      /* too many buffers: first reclaim from free queue (possibly too many) */
-      vbi_proxy_queue_free_all(&p_proxy_dev->p_free);
-      buffer_free = 0;
+      p_ring->p_slots[idx].p_lines = p_lines + idx * MAX(p_proxy_dev->max_lines, 1);
+      if (has_raw)
+         p_ring->p_slots[idx].p_raw_data = p_raw_data + idx * p_proxy_dev->max_lines * VBIPROXY_RAW_LINE_SIZE;
    }
-   /* XXX we could also force-free more buffers in out queue, but that may be overkill */
 
-   while (buffer_free + buffer_used < buffer_count)
+   p_ring->size      = size;
+   p_ring->max_lines = p_proxy_dev->max_lines;
+   p_ring->has_raw   = has_raw;
+   p_ring->claim     = p_ring->head;
+
+   /* slot contents are lost */
+   vbi_proxy_ring_flush(dev_idx);
+
+   return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** Add a duration to a histogram
+** - values are in seconds; negative or implausibly large values are ignored
+**   (i.e. when the system time was changed)
+*/
+static void vbi_proxyd_hist_add( PROXY_HIST * p_hist, double value )
+{
+   uint32_t us;
+   int msb;
+   int idx;
+
+   if ((value >= 0) && (value < 60))
    {
-      p_buf = malloc(QUEUE_ELEM_SIZE(p_buf, p_proxy_dev->max_lines));
-      if (p_buf != NULL)
-      {
-         p_buf->p_raw_data = NULL;
-         p_buf->max_lines = p_proxy_dev->max_lines;
+      us = (uint32_t) (value * 1e6);
 
-         vbi_proxy_queue_add_free(p_proxy_dev, p_buf);
-         buffer_free += 1;
-      }
+      if (us < (1 << PROXY_HIST_SUB_BITS))
+         idx = us;
       else
       {
-         dprintf(DBG_MSG, "queue_allocate: failed to allocate buffer (errno %d)\n", errno);
-         break;
+         for (msb = PROXY_HIST_SUB_BITS; (us >> (msb + 1)) != 0; msb++)
+            ;
+         idx = ((msb - PROXY_HIST_SUB_BITS + 1) << PROXY_HIST_SUB_BITS) +
+               ((us >> (msb - PROXY_HIST_SUB_BITS)) & ((1 << PROXY_HIST_SUB_BITS) - 1));
       }
+      p_hist->bucket[idx] += 1;
+      p_hist->count += 1;
+      p_hist->sum   += value;
+      if (us > p_hist->max)
+         p_hist->max = us;
    }
-
-   pthread_mutex_unlock(&p_proxy_dev->queue_mutex);
-
-   return ((unsigned int)(buffer_free + buffer_used)
-	   >= opt_buffer_count + client_count);
 }
 
 /* ----------------------------------------------------------------------------
-** Free the first buffer in the output queue by force
-** - required if one client is blocked but others still active
-** - client(s) will lose this frame's data
+** Summarize a histogram for a statistics query
+** - percentiles are reported as the upper bound of their bucket
+** - may be called while another thread adds values: the result is
+**   approximate then, but always within bounds
 */
-static PROXY_QUEUE * vbi_proxy_queue_force_free( PROXY_DEV * p_proxy_dev )
+static void vbi_proxyd_hist_get( const PROXY_HIST * p_hist, VBIPROXY_TIME_STATS * p_stats )
 {
-   PROXY_CLNT   * req;
+   static const unsigned int percentiles[3] = { 50, 90, 99 };
+   uint32_t * p_result[3];
+   uint32_t count;
+   uint32_t sum;
+   uint32_t limit;
+   int msb;
+   int idx;
+   int pct_idx;
 
-   pthread_mutex_lock(&proxy.clnt_mutex);
-   pthread_mutex_lock(&p_proxy_dev->queue_mutex);
+   p_result[0] = &p_stats->p50;
+   p_result[1] = &p_stats->p90;
+   p_result[2] = &p_stats->p99;
 
-   if ((p_proxy_dev->p_free == NULL) && (p_proxy_dev->p_sliced != NULL))
+   count = p_hist->count;
+   p_stats->count = count;
+   p_stats->max   = p_hist->max;
+   if (count > 0)
+      p_stats->avg = (uint32_t) (1e6 * p_hist->sum / count);
+
+   sum = 0;
+   idx = 0;
+   for (pct_idx = 0; (pct_idx < 3) && (count > 0); pct_idx++)
    {
-      dprintf(DBG_MSG, "queue_force_free: buffer 0x%lX\n", (long)p_proxy_dev->p_sliced);
+      limit = ((uint64_t) count * percentiles[pct_idx] + 99) / 100;
+      while ((idx < PROXY_HIST_BUCKETS - 1) && (sum + p_hist->bucket[idx] < limit))
+      {
+         sum += p_hist->bucket[idx];
+         idx += 1;
+      }
 
-      for (req = proxy.p_clnts; req != NULL; req = req->p_next)
+      if (idx < (1 << PROXY_HIST_SUB_BITS))
+         *p_result[pct_idx] = idx;
+      else
       {
-         if (req->p_sliced == p_proxy_dev->p_sliced)
-         {
-            vbi_proxy_queue_release_sliced(req);
-         }
+         msb = (idx >> PROXY_HIST_SUB_BITS) + PROXY_HIST_SUB_BITS - 1;
+         *p_result[pct_idx] = (((uint64_t) (1 << PROXY_HIST_SUB_BITS) + (idx & ((1 << PROXY_HIST_SUB_BITS) - 1)) + 1)
+                               << (msb - PROXY_HIST_SUB_BITS)) - 1;
       }
+      if (*p_result[pct_idx] > p_stats->max)
+         *p_result[pct_idx] = p_stats->max;
    }
-
-   pthread_mutex_unlock(&p_proxy_dev->queue_mutex);
-   pthread_mutex_unlock(&proxy.clnt_mutex);
-
-   return vbi_proxy_queue_get_free(p_proxy_dev);
 }
 
 /* ----------------------------------------------------------------------------
-** Read sliced data and forward it to all clients
+** Read sliced data into the next ring slot
+** - the frame becomes visible to all clients at once
+** - blocks until a frame was captured or the read timed out; returns TRUE
+**   if a frame was added to the ring
+** - if the device supports select(), the thread waits for data before
+**   reading, so that the duration of the read measures the time spent in
+**   copying and slicing only
 */
-static void vbi_proxyd_forward_data( int dev_idx )
+static vbi_bool vbi_proxyd_forward_data( int dev_idx )
 {
-   PROXY_QUEUE    * p_buf;
-   PROXY_CLNT     * req;
+   PROXY_RING_SLOT * p_slot;
+   PROXY_RING     * p_ring;
    PROXY_DEV      * p_proxy_dev;
    struct timeval timeout;
+   struct timeval tv_start;
+   struct timeval tv_end;
+   fd_set   rd;
+   double   frame_period;
+   double   gap;
+   uint32_t pos;
+   int    cap_fd;
    int    res;
+   vbi_bool result = FALSE;
 
    p_proxy_dev = proxy.dev + dev_idx;
+   p_ring = &p_proxy_dev->ring;
+
+   if (p_ring->p_slots != NULL)
+   {
+      timeout.tv_sec  = SRV_ACQ_READ_TIMEOUT / 1000;
+      timeout.tv_usec = (SRV_ACQ_READ_TIMEOUT % 1000) * 1000;
+
+      if (vbi_capture_get_fd_flags(p_proxy_dev->p_capture) & VBI_FD_HAS_SELECT)
+         cap_fd = vbi_capture_fd(p_proxy_dev->p_capture);
+      else
+         cap_fd = -1;
+      if (cap_fd != -1)
+      {
+         FD_ZERO(&rd);
+         FD_SET(cap_fd, &rd);
+         res = select(cap_fd + 1, &rd, NULL, NULL, &timeout);
+         if (res <= 0)
+         {
+            if ((res < 0) && (errno != EINTR))
+               perror("VBI select");
+            return FALSE;
+         }
+         /* data is ready: the read should not block */
+         timeout.tv_sec  = SRV_ACQ_READ_TIMEOUT / 1000;
+         timeout.tv_usec = (SRV_ACQ_READ_TIMEOUT % 1000) * 1000;
+      }
 
-   /* unlink a buffer from the free queue */
-   p_buf = vbi_proxy_queue_get_free(p_proxy_dev);
+      /* only this thread writes the head */
+      pos = RING_LOAD_RELAXED(&p_ring->head);
+      p_slot = p_ring->p_slots + (pos & (p_ring->size - 1));
 
-   if (p_buf == NULL)
-      p_buf = vbi_proxy_queue_force_free(p_proxy_dev);
+      /* announce that the oldest frame is overwritten */
+      RING_STORE_RELAXED(&p_ring->claim, pos + 1);
+      RING_FENCE_RELEASE();
 
-   if (p_buf != NULL)
-   {
-      timeout.tv_sec  = 0;
-      timeout.tv_usec = 0;
+      gettimeofday(&tv_start, NULL);
 
-      if (VBI_RAW_SERVICES(p_proxy_dev->all_services) == FALSE)
+      if (p_ring->has_raw == FALSE)
       {
-         res = vbi_capture_read_sliced(p_proxy_dev->p_capture, p_buf->lines,
-                                       &p_buf->line_count, &p_buf->timestamp, &timeout);
+         res = vbi_capture_read_sliced(p_proxy_dev->p_capture, p_slot->p_lines,
+                                       &p_slot->line_count, &p_slot->timestamp, &timeout);
       }
       else
       {
          res = vbi_capture_read(p_proxy_dev->p_capture,
-                                p_buf->p_raw_data, p_buf->lines,
-                                &p_buf->line_count, &p_buf->timestamp, &timeout);
+                                p_slot->p_raw_data, p_slot->p_lines,
+                                &p_slot->line_count, &p_slot->timestamp, &timeout);
       }
 
       if (res > 0)
       {
-         assert(p_buf->line_count < p_buf->max_lines);
-         pthread_mutex_lock(&proxy.clnt_mutex);
-         pthread_mutex_lock(&p_proxy_dev->queue_mutex);
+         assert(p_slot->line_count < p_ring->max_lines);
 
-         for (req = proxy.p_clnts; req != NULL; req = req->p_next)
+         if (cap_fd != -1)
          {
-            if ( (req->dev_idx == dev_idx) &&
-                 (req->state == REQ_STATE_FORWARD) &&
-                 (req->all_services != 0) )
-            {
-               p_buf->ref_count += 1;
+            gettimeofday(&tv_end, NULL);
+            vbi_proxyd_hist_add(&p_proxy_dev->slicing,
+                                (tv_end.tv_sec - tv_start.tv_sec) +
+                                (tv_end.tv_usec - tv_start.tv_usec) * (1 / 1e6));
+         }
 
-               if (req->p_sliced == NULL)
-                  req->p_sliced = p_buf;
-            }
+         /* frames lost in the driver show as gaps between capture timestamps */
+         frame_period = (p_proxy_dev->scanning == 525) ? (1001 / 30000.0) : (1 / 25.0);
+         gap = p_slot->timestamp - p_proxy_dev->last_timestamp;
+         if ( (p_proxy_dev->last_timestamp != 0) &&
+              (gap > 1.5 * frame_period) && (gap < 60) )
+         {
+            RING_STORE_RELAXED(&p_proxy_dev->frames_lost,
+                               p_proxy_dev->frames_lost + (uint32_t) (gap / frame_period + 0.5) - 1);
          }
+         p_proxy_dev->last_timestamp = p_slot->timestamp;
 
-         pthread_mutex_unlock(&p_proxy_dev->queue_mutex);
-         pthread_mutex_unlock(&proxy.clnt_mutex);
+         RING_STORE_RELEASE(&p_ring->head, pos + 1);
+         result = TRUE;
       }
       else if (res < 0)
       {
          /* XXX abort upon error (esp. EBUSY) */
          perror("VBI read");
+         RING_STORE_RELAXED(&p_proxy_dev->read_errors, p_proxy_dev->read_errors + 1);
       }
-
-      pthread_mutex_lock(&p_proxy_dev->queue_mutex);
-
-      if (p_buf->ref_count > 0)
-         vbi_proxy_queue_add_tail(&p_proxy_dev->p_sliced, p_buf);
-      else
-         vbi_proxy_queue_add_free(p_proxy_dev, p_buf);
-
-      p_proxy_dev->p_tmp_buf = NULL;
-      pthread_mutex_unlock(&p_proxy_dev->queue_mutex);
    }
    else
-      dprintf(DBG_MSG, "forward_data: queue overflow\n");
-}
-
-/* ----------------------------------------------------------------------------
-** Process a norm change notification
-** - query driver for new norm: if sucessful, this overrides information
-**   provided by the client (client may also provide 0)
-** - trigger sending of norm change indication to all clients if scanning changes:
-**   -> clients must re-apply for their services; note norm changes which don't
-**   affect the scanning (e.g. PAL<->SECAM) are ignored
-*/
-static void vbi_proxyd_update_scanning( int dev_idx, PROXY_CLNT * req, int scanning )
-{
-   PROXY_DEV    * p_proxy_dev;
-   PROXY_CLNT   * p_walk;
-   unsigned int new_scanning;
-
-   p_proxy_dev = proxy.dev + dev_idx;
-
-   if (p_proxy_dev->p_capture != NULL)
-   {
-      /* if the info is coming from a client verify it */
-      if (req != NULL)
-      {
-         new_scanning = vbi_capture_get_scanning(p_proxy_dev->p_capture);
-         if (new_scanning <= 0)
-         {
-            if ((scanning == 525) || (scanning == 625))
-               new_scanning = scanning;
-         }
-      }
-      else
-         new_scanning = scanning;
+      dprintf(DBG_MSG, "forward_data: no ring buffer\n");
 
-      if (new_scanning != p_proxy_dev->scanning)
-      {
-         dprintf(DBG_MSG, "update_scanning: changed from %d to %d\n", p_proxy_dev->scanning, new_scanning);
-         p_proxy_dev->scanning = new_scanning;
-
-         /* trigger sending of change indication to all clients except the caller */
-         for (p_walk = proxy.p_clnts; p_walk != NULL; p_walk = p_walk->p_next)
-         {
-            if ( (p_walk->dev_idx == dev_idx) &&
-                 ((p_walk->client_flags & VBI_PROXY_CLIENT_NO_STATUS_IND) == 0) )
-            {
-               p_walk->chn_status_ind |= VBI_PROXY_CHN_NORM;
-            }
-         }
-      }
-   }
+   return result;
 }
 
 /* ----------------------------------------------------------------------------
@@ -755,17 +748,14 @@ static void vbi_proxyd_acq_thread_cleanup( void * pvoid_arg )
    {
       pthread_cond_signal(&p_proxy_dev->start_cond);
    }
-   if (p_proxy_dev->p_tmp_buf != NULL)
-   {
-      vbi_proxy_queue_add_free(p_proxy_dev, p_proxy_dev->p_tmp_buf);
-      p_proxy_dev->p_tmp_buf = NULL;
-   }
    p_proxy_dev->thread_active = FALSE;
    pthread_mutex_unlock(&p_proxy_dev->start_mutex);
 }
 
 /* ----------------------------------------------------------------------------
-** Main loop for acquisition thread for devices that don't support select(2)
+** Main loop for the acquisition thread of a device
+** - each device has its own thread which captures and slices VBI data;
+**   forwarding to clients remains in the master thread
 */
 static void * vbi_proxyd_acq_thread( void * pvoid_arg )
 {
@@ -785,6 +775,18 @@ static void * vbi_proxyd_acq_thread( void * pvoid_arg )
    sigaddset(&sigmask, SIGTERM);
    pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
 
+#ifdef CPU_SET
+   if (p_proxy_dev->cpu >= 0)
+   {
+      cpu_set_t cpus;
+
+      CPU_ZERO(&cpus);
+      CPU_SET(p_proxy_dev->cpu, &cpus);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+         dprintf(DBG_MSG, "acq_thread: failed to bind device #%d to CPU %d\n", dev_idx, p_proxy_dev->cpu);
+   }
+#endif
+
    pthread_cleanup_push(vbi_proxyd_acq_thread_cleanup, pvoid_arg);
    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
@@ -797,11 +799,12 @@ static void * vbi_proxyd_acq_thread( void * pvoid_arg )
 
    while (p_proxy_dev->wait_for_exit == FALSE)
    {
-      /* read data from the VBI device and append the buffer to all client queues
+      /* read data from the VBI device into the slicer output ring
       ** note: this function blocks in read(2) until data is available */
-      vbi_proxyd_forward_data(dev_idx);
+      if (vbi_proxyd_forward_data(dev_idx) == FALSE)
+         continue;
 
-      /* wake up the master thread to process client queues */
+      /* wake up the master thread to forward the frame to clients */
       ret = write(p_proxy_dev->wr_fd, byte_buf, 1);
 
       if ((ret < 0) && (errno != EAGAIN))
@@ -868,7 +871,7 @@ static void vbi_proxyd_stop_acq_thread( PROXY_DEV * p_proxy_dev )
 }
 
 /* ----------------------------------------------------------------------------
-** Start a thread to block in read(2) for devices that don't support select(2)
+** Start the acquisition thread of a device
 */
 static vbi_bool vbi_proxyd_start_acq_thread( int dev_idx )
 {
@@ -932,8 +935,7 @@ static void vbi_proxy_stop_acquisition( PROXY_DEV * p_proxy_dev )
       p_proxy_dev->p_decoder = NULL;
       p_proxy_dev->vbi_fd = -1;
 
-      vbi_proxy_queue_free_all(&p_proxy_dev->p_free);
-      vbi_proxy_queue_free_all(&p_proxy_dev->p_sliced);
+      vbi_proxy_ring_free(&p_proxy_dev->ring);
    }
 }
 
@@ -970,19 +972,14 @@ static vbi_bool vbi_proxy_start_acquisition( int dev_idx, char ** pp_errorstr )
       p_proxy_dev->p_decoder = vbi_capture_parameters(p_proxy_dev->p_capture);
       if (p_proxy_dev->p_decoder != NULL)
       {
-         /* allocate buffer queue for sliced output data */
-         vbi_proxy_queue_allocate(dev_idx);
+         /* allocate ring for sliced output data */
+         vbi_proxy_ring_allocate(dev_idx);
 
          p_proxy_dev->chn_prio = VBI_CHN_PRIO_INTERACTIVE;
 
-         /* get file handle for select() to wait for VBI data */
-         if ((vbi_capture_get_fd_flags(p_proxy_dev->p_capture) & VBI_FD_HAS_SELECT) != 0)
-         {
-            p_proxy_dev->vbi_fd = vbi_capture_fd(p_proxy_dev->p_capture);
-            result = (p_proxy_dev->vbi_fd != -1);
-         }
-         else
-            result = vbi_proxyd_start_acq_thread(dev_idx);
+         /* capture and slice in a separate thread, which wakes up the
+         ** master thread through a pipe when a frame was captured */
+         result = vbi_proxyd_start_acq_thread(dev_idx);
       }
       else
          dprintf(DBG_MSG, "start_acquisition: capture device has no slicer!?\n");
@@ -999,6 +996,112 @@ static vbi_bool vbi_proxy_start_acquisition( int dev_idx, char ** pp_errorstr )
    return result;
 }
 
+/* ----------------------------------------------------------------------------
+** Suspend the acquisition thread while the master thread accesses the
+** capture context, which must not be used by two threads at the same time
+** - returns TRUE if the thread was running and must be resumed afterwards
+*/
+static vbi_bool vbi_proxyd_suspend_acq_thread( PROXY_DEV * p_proxy_dev )
+{
+   if (p_proxy_dev->use_thread)
+   {
+      vbi_proxyd_stop_acq_thread(p_proxy_dev);
+      return TRUE;
+   }
+   return FALSE;
+}
+
+/* ----------------------------------------------------------------------------
+** Restart the acquisition thread after vbi_proxyd_suspend_acq_thread()
+** - acquisition is stopped if the thread cannot be restarted
+*/
+static vbi_bool vbi_proxyd_resume_acq_thread( int dev_idx, vbi_bool was_active )
+{
+   PROXY_DEV * p_proxy_dev;
+
+   p_proxy_dev = proxy.dev + dev_idx;
+
+   if (was_active && (vbi_proxyd_start_acq_thread(dev_idx) == FALSE))
+   {
+      dprintf(DBG_MSG, "resume_acq_thread: failed to restart thread of device #%d\n", dev_idx);
+      vbi_proxy_stop_acquisition(p_proxy_dev);
+      return FALSE;
+   }
+   return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** Flush the capture buffers and the slicer output of a device
+** - frames discarded by the flush must not be counted as lost
+*/
+static void vbi_proxyd_flush_capture( int dev_idx )
+{
+   PROXY_DEV * p_proxy_dev;
+   vbi_bool    was_active;
+
+   p_proxy_dev = proxy.dev + dev_idx;
+
+   was_active = vbi_proxyd_suspend_acq_thread(p_proxy_dev);
+   vbi_capture_flush(p_proxy_dev->p_capture);
+   p_proxy_dev->last_timestamp = 0;
+   vbi_proxy_ring_flush(dev_idx);
+   vbi_proxyd_resume_acq_thread(dev_idx, was_active);
+}
+
+/* ----------------------------------------------------------------------------
+** Process a norm change notification
+** - query driver for new norm: if sucessful, this overrides information
+**   provided by the client (client may also provide 0)
+** - trigger sending of norm change indication to all clients if scanning changes:
+**   -> clients must re-apply for their services; note norm changes which don't
+**   affect the scanning (e.g. PAL<->SECAM) are ignored
+*/
+static void vbi_proxyd_update_scanning( int dev_idx, PROXY_CLNT * req, int scanning )
+{
+   PROXY_DEV    * p_proxy_dev;
+   PROXY_CLNT   * p_walk;
+   unsigned int new_scanning;
+   vbi_bool     was_active;
+
+   p_proxy_dev = proxy.dev + dev_idx;
+
+   if (p_proxy_dev->p_capture != NULL)
+   {
+      /* if the info is coming from a client verify it */
+      if (req != NULL)
+      {
+         was_active = vbi_proxyd_suspend_acq_thread(p_proxy_dev);
+         new_scanning = vbi_capture_get_scanning(p_proxy_dev->p_capture);
+         if (vbi_proxyd_resume_acq_thread(dev_idx, was_active) == FALSE)
+            return;
+
+         if (new_scanning <= 0)
+         {
+            if ((scanning == 525) || (scanning == 625))
+               new_scanning = scanning;
+         }
+      }
+      else
+         new_scanning = scanning;
+
+      if (new_scanning != p_proxy_dev->scanning)
+      {
+         dprintf(DBG_MSG, "update_scanning: changed from %d to %d\n", p_proxy_dev->scanning, new_scanning);
+         p_proxy_dev->scanning = new_scanning;
+
+         /* trigger sending of change indication to all clients except the caller */
+         for (p_walk = proxy.p_clnts; p_walk != NULL; p_walk = p_walk->p_next)
+         {
+            if ( (p_walk->dev_idx == dev_idx) &&
+                 ((p_walk->client_flags & VBI_PROXY_CLIENT_NO_STATUS_IND) == 0) )
+            {
+               p_walk->chn_status_ind |= VBI_PROXY_CHN_NORM;
+            }
+         }
+      }
+   }
+}
+
 /* ----------------------------------------------------------------------------
 ** Update service mask after a client was added or closed
 ** - TODO: update buffer_count
@@ -1114,17 +1217,12 @@ static vbi_bool vbi_proxyd_update_services( int dev_idx, PROXY_CLNT * p_new_req,
          p_proxy_dev->max_lines = p_proxy_dev->p_decoder->count[0]
                                 + p_proxy_dev->p_decoder->count[1];
 
-         /* grow/shrink buffer queue for sliced output data */
-         vbi_proxy_queue_allocate(dev_idx);
+         /* grow/shrink ring for sliced output data */
+         vbi_proxy_ring_allocate(dev_idx);
 
          dprintf(DBG_MSG, "service_update: new service mask 0x%X, max.lines=%d, scanning=%d\n", dev_services, p_proxy_dev->max_lines, p_proxy_dev->scanning);
 
-         if ((vbi_capture_get_fd_flags(p_proxy_dev->p_capture) & VBI_FD_HAS_SELECT) != 0)
-         {
-            result = TRUE;
-         }
-         else
-            result = vbi_proxyd_start_acq_thread(dev_idx);
+         result = vbi_proxyd_start_acq_thread(dev_idx);
       }
       else
       {  /* no services set: not an error if clien't didn't request any */
@@ -1583,7 +1681,7 @@ vbi_proxyd_channel_update( int dev_idx, PROXY_CLNT * req, vbi_bool forced_switch
       /* flush-only flag: assume client has already done the switch -> must flush VBI buffers */
       if (forced_switch)
       {
-         vbi_capture_flush(p_proxy_dev->p_capture);
+         vbi_proxyd_flush_capture(dev_idx);
       }
    }
 
@@ -1607,11 +1705,8 @@ static void vbi_proxyd_channel_flush( int dev_idx, PROXY_CLNT * req )
 
    if (p_proxy_dev->p_capture != NULL)
    {
-      /* flush capture buffers */
-      vbi_capture_flush(p_proxy_dev->p_capture);
-
-      /* flush slicer output buffer queues */
-      vbi_proxy_queue_release_all(dev_idx);
+      /* flush capture buffers and slicer output of all clients */
+      vbi_proxyd_flush_capture(dev_idx);
    }
 
    /* trigger sending of change indication to all clients except the caller */
@@ -1742,14 +1837,8 @@ static void vbi_proxyd_close( PROXY_CLNT * req, vbi_bool close_all )
 
       vbi_proxy_msg_close_io(&req->io);
 
-      pthread_mutex_lock(&proxy.dev[req->dev_idx].queue_mutex);
-
-      while (req->p_sliced != NULL)
-      {
-         vbi_proxy_queue_release_sliced(req);
-      }
-
-      pthread_mutex_unlock(&proxy.dev[req->dev_idx].queue_mutex);
+      if (req->drop_count > 0)
+         dprintf(DBG_MSG, "close: fd %d: %u frames dropped\n", req->io.sock_fd, req->drop_count);
 
       req->state = REQ_STATE_CLOSED;
    }
@@ -1806,90 +1895,190 @@ static void vbi_proxyd_add_connection( int listen_fd, int dev_idx, vbi_bool isLo
 
 /* ----------------------------------------------------------------------------
 ** Initialize state for a new device
+** - only called while parsing the command line, i.e. before any threads are
+**   started, as the device table may move in memory
 */
 static void vbi_proxyd_add_device( const char * p_dev_name )
 {
    PROXY_DEV  * p_proxy_dev;
 
-   if (proxy.dev_count < SRV_MAX_DEVICES)
+   p_proxy_dev = realloc(proxy.dev, (proxy.dev_count + 1) * sizeof(PROXY_DEV));
+   if (p_proxy_dev != NULL)
    {
+      proxy.dev = p_proxy_dev;
       p_proxy_dev = proxy.dev + proxy.dev_count;
+      memset(p_proxy_dev, 0, sizeof(*p_proxy_dev));
 
       p_proxy_dev->p_dev_name  = p_dev_name;
       p_proxy_dev->p_sock_path = vbi_proxy_msg_get_socket_name(p_dev_name);
       p_proxy_dev->pipe_fd = -1;
       p_proxy_dev->vbi_fd  = -1;
       p_proxy_dev->wr_fd   = -1;
-
-      /* initialize synchonization facilities */
-      pthread_cond_init(&p_proxy_dev->start_cond, NULL);
-      pthread_mutex_init(&p_proxy_dev->start_mutex, NULL);
-      pthread_mutex_init(&p_proxy_dev->queue_mutex, NULL);
+      p_proxy_dev->cpu     = -1;
 
       proxy.dev_count += 1;
    }
+   else
+   {
+      fprintf(stderr, "Virtual memory exhausted.\n");
+      exit(1);
+   }
+}
+
+/* ----------------------------------------------------------------------------
+** Update delivery statistics of a client and its device for a frame sent
+** - latency is measured from capture until the frame is handed to the socket
+*/
+static void vbi_proxyd_count_forward( PROXY_CLNT * req, double timestamp )
+{
+   PROXY_DEV * p_proxy_dev = proxy.dev + req->dev_idx;
+   struct timeval tv;
+   double latency;
+
+   gettimeofday(&tv, NULL);
+   latency = (tv.tv_sec + tv.tv_usec * (1 / 1e6)) - timestamp;
+
+   req->frames_forwarded += 1;
+   vbi_proxyd_hist_add(&req->latency, latency);
+
+   p_proxy_dev->frames_forwarded += 1;
+   vbi_proxyd_hist_add(&p_proxy_dev->latency, latency);
 }
 
 /* ----------------------------------------------------------------------------
-** Transmit one buffer of sliced data
+** Transmit the next frame in the slicer output ring
 ** - returns FALSE upon I/O error
 ** - also returns a "blocked" flag which is TRUE if not all data could be written
 **   can be used by the caller to "stuff" the pipe, i.e. write a series of messages
 **   until the pipe is full
-** - XXX optimization required: don't copy the block (required however if client
-**   doesn't want all services)
+** - the slot is copied into the message, which is required anyways if the client
+**   doesn't want all services; if the producer overwrote the slot meanwhile the
+**   copy is discarded and the frame counted as dropped
 */
 static vbi_bool vbi_proxyd_send_sliced( PROXY_CLNT * req, vbi_bool * p_blocked )
 {
    VBIPROXY_MSG * p_msg;
+   VBIPROXY_MSG_TYPE msg_type;
+   PROXY_RING_SLOT * p_slot;
+   PROXY_RING * p_ring;
    uint32_t  msg_size;
+   uint32_t  raw_size;
+   double    timestamp;
+   uint32_t  pos;
+   uint32_t  head;
    vbi_bool  result = FALSE;
+   int line_count;
    int max_lines;
    int idx;
 
-   if ((req != NULL) && (p_blocked != NULL) && (req->p_sliced != NULL))
+   if ((req != NULL) && (p_blocked != NULL) && (proxy.dev[req->dev_idx].ring.p_slots != NULL))
    {
-      if (VBI_RAW_SERVICES(req->all_services))
-         msg_size = VBIPROXY_SLICED_IND_SIZE(0, req->p_sliced->max_lines);
+      p_ring = &proxy.dev[req->dev_idx].ring;
+      pos  = req->ring_pos;
+      head = RING_LOAD_ACQUIRE(&p_ring->head);
+
+      if ((uint32_t)(head - pos) >= p_ring->size)
+      {  /* client fell behind: oldest frames are overwritten; skip to half the ring */
+         dprintf(DBG_MSG, "send_sliced: fd %d: dropping %u frames\n", req->io.sock_fd, head - pos - p_ring->size / 2);
+         req->drop_count += head - pos - p_ring->size / 2;
+         proxy.dev[req->dev_idx].frames_dropped += head - pos - p_ring->size / 2;
+         pos = head - p_ring->size / 2;
+      }
+      p_slot = p_ring->p_slots + (pos & (p_ring->size - 1));
+
+      /* the line count may be overwritten concurrently; result is checked below */
+      timestamp  = p_slot->timestamp;
+      line_count = p_slot->line_count;
+      if ((line_count < 0) || (line_count > p_ring->max_lines))
+         line_count = 0;
+
+      raw_size = 0;
+      if ( VBI_RAW_SERVICES(req->all_services) &&
+           (p_slot->p_raw_data != NULL) &&
+           (proxy.dev[req->dev_idx].p_decoder != NULL) )
+      {
+         raw_size = proxy.dev[req->dev_idx].p_decoder->bytes_per_line * p_ring->max_lines;
+         if (raw_size > VBIPROXY_RAW_LINE_SIZE * p_ring->max_lines)
+            raw_size = VBIPROXY_RAW_LINE_SIZE * p_ring->max_lines;
+      }
+
+      if (req->client_flags & VBIPROXY_CLIENT_COMPACT_SLICED)
+         msg_size = VBIPROXY_SLICED_COMPACT_IND_MAX_SIZE(line_count, raw_size);
+      else if (VBI_RAW_SERVICES(req->all_services))
+         msg_size = VBIPROXY_SLICED_IND_SIZE(0, p_ring->max_lines);
       else
-         msg_size = VBIPROXY_SLICED_IND_SIZE(req->p_sliced->line_count, 0);
+         msg_size = VBIPROXY_SLICED_IND_SIZE(line_count, 0);
 
       msg_size += sizeof(VBIPROXY_MSG_HEADER);
       p_msg = malloc(msg_size);
+      if (p_msg == NULL)
+      {
+         dprintf(DBG_MSG, "send_sliced: failed to allocate %u bytes\n", msg_size);
+         return FALSE;
+      }
 
       /* filter for services requested by this client */
       max_lines = req->vbi_count[0] + req->vbi_count[1];
-      p_msg->body.sliced_ind.timestamp = req->p_sliced->timestamp;
-      p_msg->body.sliced_ind.sliced_lines = 0;
-      p_msg->body.sliced_ind.raw_lines = 0;
 
-      /* XXX TODO allow both raw and sliced in the same message */
-      if (VBI_RAW_SERVICES(req->all_services) == FALSE)
+      if (req->client_flags & VBIPROXY_CLIENT_COMPACT_SLICED)
+      {
+         msg_type = MSG_TYPE_SLICED_COMPACT_IND;
+         p_msg->body.sliced_compact_ind.timestamp = timestamp;
+         msg_size = vbi_proxy_msg_encode_sliced(&p_msg->body.sliced_compact_ind,
+                                                p_slot->p_lines, line_count, max_lines,
+                                                req->all_services,
+                                                p_slot->p_raw_data, raw_size);
+      }
+      else
       {
-         for (idx = 0; (idx < req->p_sliced->line_count) && (idx < max_lines); idx++)
+         msg_type = MSG_TYPE_SLICED_IND;
+         p_msg->body.sliced_ind.timestamp = timestamp;
+         p_msg->body.sliced_ind.sliced_lines = 0;
+         p_msg->body.sliced_ind.raw_lines = 0;
+
+         /* XXX TODO allow both raw and sliced in the same message */
+         if (VBI_RAW_SERVICES(req->all_services) == FALSE)
          {
-            if ((req->p_sliced->lines[idx].id & req->all_services) != 0)
+            for (idx = 0; (idx < line_count) && (idx < max_lines); idx++)
             {
-               memcpy(p_msg->body.sliced_ind.u.sliced + p_msg->body.sliced_ind.sliced_lines,
-                      req->p_sliced->lines + idx, sizeof(vbi_sliced));
-               p_msg->body.sliced_ind.sliced_lines += 1;
+               if ((p_slot->p_lines[idx].id & req->all_services) != 0)
+               {
+                  memcpy(p_msg->body.sliced_ind.u.sliced + p_msg->body.sliced_ind.sliced_lines,
+                         p_slot->p_lines + idx, sizeof(vbi_sliced));
+                  p_msg->body.sliced_ind.sliced_lines += 1;
+               }
             }
          }
-      }
-      else
-      {
-         if (req->p_sliced->p_raw_data != NULL)
+         else
          {
-            memcpy(p_msg->body.sliced_ind.u.raw,
-                   req->p_sliced->p_raw_data,
-                   VBIPROXY_RAW_LINE_SIZE * req->p_sliced->max_lines);
-            p_msg->body.sliced_ind.raw_lines = req->p_sliced->max_lines;
+            if (p_slot->p_raw_data != NULL)
+            {
+               memcpy(p_msg->body.sliced_ind.u.raw,
+                      p_slot->p_raw_data,
+                      VBIPROXY_RAW_LINE_SIZE * p_ring->max_lines);
+               p_msg->body.sliced_ind.raw_lines = p_ring->max_lines;
+            }
          }
+         msg_size = VBIPROXY_SLICED_IND_SIZE(p_msg->body.sliced_ind.sliced_lines,
+                                             p_msg->body.sliced_ind.raw_lines);
       }
-      msg_size = VBIPROXY_SLICED_IND_SIZE(p_msg->body.sliced_ind.sliced_lines,
-                                          p_msg->body.sliced_ind.raw_lines);
 
-      vbi_proxy_msg_write(&req->io, MSG_TYPE_SLICED_IND, msg_size, p_msg, TRUE);
+      req->ring_pos = pos + 1;
+
+      /* check if the producer started overwriting the slot while copying */
+      RING_FENCE_ACQUIRE();
+      if ((uint32_t)(RING_LOAD_RELAXED(&p_ring->claim) - pos) > p_ring->size)
+      {
+         dprintf(DBG_MSG, "send_sliced: fd %d: frame #%u overwritten\n", req->io.sock_fd, pos);
+         req->drop_count += 1;
+         proxy.dev[req->dev_idx].frames_dropped += 1;
+         free(p_msg);
+         return TRUE;
+      }
+
+      vbi_proxyd_count_forward(req, timestamp);
+
+      vbi_proxy_msg_write(&req->io, msg_type, msg_size, p_msg, TRUE);
 
       if (vbi_proxy_msg_handle_write(&req->io, p_blocked))
       {
@@ -1908,6 +2097,89 @@ static vbi_bool vbi_proxyd_send_sliced( PROXY_CLNT * req, vbi_bool * p_blocked )
    return result;
 }
 
+/* ----------------------------------------------------------------------------
+** Collect statistics of all devices and clients for a statistics query
+** - counters of the acquisition threads are read without locking; they are
+**   only ever incremented, so a query may at worst miss the latest frame
+** - returns a message buffer to be freed by the caller or NULL
+*/
+static VBIPROXY_MSG * vbi_proxyd_get_stats( void )
+{
+   VBIPROXY_MSG        * p_msg;
+   VBIPROXY_DEV_STATS  * p_stats;
+   VBIPROXY_CLNT_STATS * p_clnt_stats;
+   PROXY_DEV           * p_proxy_dev;
+   PROXY_CLNT          * req;
+   uint32_t  head;
+   uint32_t  depth;
+   int  clnt_count;
+   int  dev_idx;
+
+   clnt_count = 0;
+   for (req = proxy.p_clnts; req != NULL; req = req->p_next)
+      if (req->state == REQ_STATE_FORWARD)
+         clnt_count += 1;
+
+   p_msg = calloc(1, sizeof(VBIPROXY_MSG_HEADER) + VBIPROXY_STATS_CNF_SIZE(proxy.dev_count, clnt_count));
+   if (p_msg != NULL)
+   {
+      vbi_proxy_msg_fill_magics(&p_msg->body.stats_cnf.magics);
+      p_msg->body.stats_cnf.dev_count  = proxy.dev_count;
+      p_msg->body.stats_cnf.clnt_count = clnt_count;
+
+      for (dev_idx = 0; dev_idx < proxy.dev_count; dev_idx++)
+      {
+         p_proxy_dev = proxy.dev + dev_idx;
+         p_stats = p_msg->body.stats_cnf.dev + dev_idx;
+
+         strlcpy((char *) p_stats->dev_vbi_name, p_proxy_dev->p_dev_name, VBIPROXY_DEV_NAME_MAX_LENGTH);
+         p_stats->dev_vbi_name[VBIPROXY_DEV_NAME_MAX_LENGTH - 1] = 0;
+         p_stats->cpu              = p_proxy_dev->cpu;
+         p_stats->frames_captured  = RING_LOAD_RELAXED(&p_proxy_dev->ring.head);
+         p_stats->frames_lost      = RING_LOAD_RELAXED(&p_proxy_dev->frames_lost);
+         p_stats->read_errors      = RING_LOAD_RELAXED(&p_proxy_dev->read_errors);
+         p_stats->frames_forwarded = p_proxy_dev->frames_forwarded;
+         p_stats->frames_dropped   = p_proxy_dev->frames_dropped;
+         p_stats->queue_size       = p_proxy_dev->ring.size;
+         vbi_proxyd_hist_get(&p_proxy_dev->slicing, &p_stats->slicing);
+         vbi_proxyd_hist_get(&p_proxy_dev->latency, &p_stats->latency);
+      }
+
+      p_clnt_stats = VBIPROXY_STATS_CNF_CLNT(&p_msg->body.stats_cnf);
+      for (req = proxy.p_clnts; req != NULL; req = req->p_next)
+      {
+         if (req->state == REQ_STATE_FORWARD)
+         {
+            p_proxy_dev = proxy.dev + req->dev_idx;
+            p_stats = p_msg->body.stats_cnf.dev + req->dev_idx;
+
+            head  = RING_LOAD_RELAXED(&p_proxy_dev->ring.head);
+            depth = head - req->ring_pos;
+            if (depth > p_proxy_dev->ring.size)
+               depth = p_proxy_dev->ring.size;
+
+            p_stats->client_count += 1;
+            if (depth > p_stats->queue_depth)
+               p_stats->queue_depth = depth;
+
+            strlcpy((char *) p_clnt_stats->client_name, req->client_name, VBIPROXY_CLIENT_NAME_MAX_LENGTH);
+            p_clnt_stats->pid              = req->pid;
+            p_clnt_stats->dev_idx          = req->dev_idx;
+            p_clnt_stats->services         = req->all_services;
+            p_clnt_stats->frames_forwarded = req->frames_forwarded;
+            p_clnt_stats->frames_dropped   = req->drop_count;
+            p_clnt_stats->queue_depth      = depth;
+            vbi_proxyd_hist_get(&req->latency, &p_clnt_stats->latency);
+            p_clnt_stats += 1;
+         }
+      }
+   }
+   else
+      dprintf(DBG_MSG, "get_stats: virtual memory exhausted\n");
+
+   return p_msg;
+}
+
 /* ----------------------------------------------------------------------------
 ** Checks the size of a message from client to server
 */
@@ -1977,11 +2249,18 @@ static vbi_bool vbi_proxyd_check_msg( VBIPROXY_MSG * pMsg, vbi_bool * pEndianSwa
          result = (len == sizeof(VBIPROXY_MSG_HEADER) + sizeof(pBody->daemon_pid_cnf));
          break;
 
+      case MSG_TYPE_STATS_REQ:
+         result = ( (len == sizeof(VBIPROXY_MSG_HEADER) + sizeof(pBody->stats_req)) &&
+                    (memcmp(pBody->stats_req.magics.protocol_magic, VBIPROXY_MAGIC_STR, VBIPROXY_MAGIC_LEN) == 0) &&
+                    (pBody->stats_req.magics.endian_magic == VBIPROXY_ENDIAN_MAGIC) );
+         break;
+
       case MSG_TYPE_CONNECT_CNF:
       case MSG_TYPE_CONNECT_REJ:
       case MSG_TYPE_SERVICE_CNF:
       case MSG_TYPE_SERVICE_REJ:
       case MSG_TYPE_SLICED_IND:
+      case MSG_TYPE_SLICED_COMPACT_IND:
       case MSG_TYPE_CHN_TOKEN_CNF:
       case MSG_TYPE_CHN_TOKEN_IND:
       case MSG_TYPE_CHN_NOTIFY_CNF:
@@ -1991,6 +2270,7 @@ static vbi_bool vbi_proxyd_check_msg( VBIPROXY_MSG * pMsg, vbi_bool * pEndianSwa
       case MSG_TYPE_CHN_IOCTL_REJ:
       case MSG_TYPE_CHN_RECLAIM_REQ:
       case MSG_TYPE_CHN_CHANGE_IND:
+      case MSG_TYPE_STATS_CNF:
          dprintf(DBG_MSG, "check_msg: recv client msg %d (%s) at server side\n", pHead->type, vbi_proxy_msg_debug_get_type_str(pHead->type));
          result = FALSE;
          break;
@@ -2032,12 +2312,17 @@ static vbi_bool vbi_proxyd_take_message( PROXY_CLNT *req, VBIPROXY_MSG * pMsg )
             {
                dprintf(DBG_MSG, "New client: fd %d: '%s' pid=%d services=0x%X\n", req->io.sock_fd, pBody->connect_req.client_name, pBody->connect_req.pid, pBody->connect_req.services);
 
+               strlcpy(req->client_name, (char *) pBody->connect_req.client_name, sizeof(req->client_name));
+               req->client_name[sizeof(req->client_name) - 1] = 0;
+               req->pid = pBody->connect_req.pid;
+
                /* if provided, update norm hint (used for first client on ancient v4l1 drivers only) */
                if (pBody->connect_req.scanning != 0)
                   proxy.dev[req->dev_idx].scanning = pBody->connect_req.scanning;
 
                /* enable forwarding of captured data (must be set before processing request!) */
                req->state = REQ_STATE_FORWARD;
+               vbi_proxy_ring_sync_clnt(req);
 
                req->buffer_count = pBody->connect_req.buffer_count;
                req->client_flags = pBody->connect_req.client_flags;  /* XXX TODO (timeout supression) */
@@ -2060,6 +2345,9 @@ static vbi_bool vbi_proxyd_take_message( PROXY_CLNT *req, VBIPROXY_MSG * pMsg )
                   req->msg_buf.body.connect_cnf.pid = getpid();
                   req->msg_buf.body.connect_cnf.vbi_api_revision = proxy.dev[req->dev_idx].vbi_api;
                   req->msg_buf.body.connect_cnf.daemon_flags = ((opt_debug_level > 0) ? VBI_PROXY_DAEMON_NO_TIMEOUTS : 0);
+                  /* confirm the compact slicer data encoding if requested */
+                  if (req->client_flags & VBIPROXY_CLIENT_COMPACT_SLICED)
+                     req->msg_buf.body.connect_cnf.daemon_flags |= VBIPROXY_DAEMON_COMPACT_SLICED;
 
                   req->msg_buf.body.connect_cnf.services = req->all_services;
                   if (proxy.dev[req->dev_idx].p_decoder != NULL)
@@ -2121,6 +2409,22 @@ static vbi_bool vbi_proxyd_take_message( PROXY_CLNT *req, VBIPROXY_MSG * pMsg )
          }
          break;
 
+      case MSG_TYPE_STATS_REQ:
+         if (req->state == REQ_STATE_WAIT_CON_REQ)
+         {  /* this message can be sent instead of a connect request */
+            VBIPROXY_MSG * p_msg = vbi_proxyd_get_stats();
+            if (p_msg != NULL)
+            {
+               vbi_proxy_msg_write(&req->io, MSG_TYPE_STATS_CNF,
+                                   VBIPROXY_STATS_CNF_SIZE(p_msg->body.stats_cnf.dev_count,
+                                                           p_msg->body.stats_cnf.clnt_count),
+                                   p_msg, TRUE);
+               req->state = REQ_STATE_WAIT_CLOSE;
+               result = TRUE;
+            }
+         }
+         break;
+
       case MSG_TYPE_SERVICE_REQ:
          if (req->state == REQ_STATE_FORWARD)
          {
@@ -2129,13 +2433,8 @@ static vbi_bool vbi_proxyd_take_message( PROXY_CLNT *req, VBIPROXY_MSG * pMsg )
 
             dprintf(DBG_MSG, "Update client: fd %d services: 0x%X (was %X)\n", req->io.sock_fd, pBody->service_req.services, req->all_services);
 
-            /* flush all buffers in this client's queue */
-            pthread_mutex_lock(&proxy.dev[req->dev_idx].queue_mutex);
-            while (req->p_sliced != NULL)
-            {
-               vbi_proxy_queue_release_sliced(req);
-            }
-            pthread_mutex_unlock(&proxy.dev[req->dev_idx].queue_mutex);
+            /* discard all frames not yet forwarded to this client */
+            vbi_proxy_ring_sync_clnt(req);
 
             if ( vbi_proxyd_take_service_req(req, pBody->service_req.services,
 					     pBody->service_req.strict,
@@ -2370,7 +2669,7 @@ static int vbi_proxyd_get_fd_set( fd_set * rd, fd_set * wr )
       }
       else
       if ( (vbi_proxy_msg_write_idle(&req->io) == FALSE) ||
-           (req->p_sliced != NULL) || (req->chn_status_ind != VBI_PROXY_CHN_NONE) )
+           vbi_proxy_ring_pending(req) || (req->chn_status_ind != VBI_PROXY_CHN_NONE) )
       {
          FD_SET(req->io.sock_fd, wr);
       }
@@ -2473,17 +2772,11 @@ static void vbi_proxyd_handle_client_sockets( fd_set * rd, fd_set * wr )
          }
          else
          {
-            /* forward data from slicer out queue */
-            while ((req->p_sliced != NULL) && (io_blocked == FALSE))
+            /* forward data from slicer output ring */
+            while (vbi_proxy_ring_pending(req) && (io_blocked == FALSE))
             {
-               dprintf(DBG_QU, "handle_sockets: fd %d: forward sliced frame with %d lines (of max %d)\n", req->io.sock_fd, req->p_sliced->line_count, req->p_sliced->max_lines);
-               if (vbi_proxyd_send_sliced(req, &io_blocked) )
-               {  /* only in success case because close releases all buffers */
-                  pthread_mutex_lock(&proxy.dev[req->dev_idx].queue_mutex);
-                  vbi_proxy_queue_release_sliced(req);
-                  pthread_mutex_unlock(&proxy.dev[req->dev_idx].queue_mutex);
-               }
-               else
+               dprintf(DBG_QU, "handle_sockets: fd %d: forward sliced frame #%u\n", req->io.sock_fd, req->ring_pos);
+               if (vbi_proxyd_send_sliced(req, &io_blocked) == FALSE)
                {  /* I/O error */
                   vbi_proxyd_close(req, FALSE);
                   io_blocked = TRUE;
@@ -2648,8 +2941,10 @@ static void vbi_proxyd_destroy( void )
 
       pthread_cond_destroy(&proxy.dev[dev_idx].start_cond);
       pthread_mutex_destroy(&proxy.dev[dev_idx].start_mutex);
-      pthread_mutex_destroy(&proxy.dev[dev_idx].queue_mutex);
    }
+   free(proxy.dev);
+   proxy.dev = NULL;
+   proxy.dev_count = 0;
 
    if (proxy.tcp_ip_fd != -1)
    {
@@ -2692,6 +2987,7 @@ static void vbi_proxyd_signal_handler( int sigval )
 static void vbi_proxyd_init( void )
 {
    struct sigaction  act;
+   int  dev_idx;
 
    if (opt_no_detach == FALSE)
    {
@@ -2711,6 +3007,13 @@ static void vbi_proxyd_init( void )
       }
    }
 
+   /* initialize synchonization facilities of all devices */
+   for (dev_idx = 0; dev_idx < proxy.dev_count; dev_idx++)
+   {
+      pthread_cond_init(&proxy.dev[dev_idx].start_cond, NULL);
+      pthread_mutex_init(&proxy.dev[dev_idx].start_mutex, NULL);
+   }
+
    /* ignore broken pipes (handled by select/read) */
    memset(&act, 0, sizeof(act));
    act.sa_handler = SIG_IGN;
@@ -2816,23 +3119,16 @@ static void vbi_proxyd_main_loop( void )
                vbi_proxyd_add_connection(proxy.dev[dev_idx].pipe_fd, dev_idx, TRUE);
             }
 
-            /* check for incoming data on VBI device */
+            /* check for new frames from the acquisition thread */
             if ((proxy.dev[dev_idx].vbi_fd != -1) && (FD_ISSET(proxy.dev[dev_idx].vbi_fd, &rd)))
-            {
-               if (proxy.dev[dev_idx].use_thread == FALSE)
-               {
-                  vbi_proxyd_forward_data(dev_idx);
-               }
-               else
-               {  /* message from acq thread slave:
-                  ** sent data is only a trigger to wake up from select() above -> discard it */
-                  char dummy_buf[100];
-                  int  rd_count;
-                  do {
-                     rd_count = read(proxy.dev[dev_idx].vbi_fd, dummy_buf, sizeof(dummy_buf));
-                     dprintf(DBG_QU, "main_loop: read from acq thread dev #%d pipe fd %d: %d errno=%d\n", dev_idx, proxy.dev[dev_idx].vbi_fd, sel_cnt, errno);
-                  } while (rd_count == 100);
-               }
+            {  /* message from acq thread slave:
+               ** sent data is only a trigger to wake up from select() above -> discard it */
+               char dummy_buf[100];
+               int  rd_count;
+               do {
+                  rd_count = read(proxy.dev[dev_idx].vbi_fd, dummy_buf, sizeof(dummy_buf));
+                  dprintf(DBG_QU, "main_loop: read from acq thread dev #%d pipe fd %d: %d errno=%d\n", dev_idx, proxy.dev[dev_idx].vbi_fd, sel_cnt, errno);
+               } while (rd_count == 100);
             }
          }
 
@@ -2956,6 +3252,148 @@ failure:
    exit(1);
 }
 
+/* ---------------------------------------------------------------------------
+** Print a duration summary of a statistics reply
+*/
+static void vbi_proxyd_print_time_stats( const char * p_label, const VBIPROXY_TIME_STATS * p_stats )
+{
+   if (p_stats->count > 0)
+      printf("  %-9s avg %6u  p50 %6u  p90 %6u  p99 %6u  max %6u us\n",
+             p_label, p_stats->avg, p_stats->p50, p_stats->p90, p_stats->p99, p_stats->max);
+   else
+      printf("  %-9s n/a\n", p_label);
+}
+
+/* ----------------------------------------------------------------------------
+** Check the daemon's reply to a statistics query
+** - replies are rejected by vbi_proxyd_check_msg() which checks messages
+**   received from clients
+*/
+static vbi_bool vbi_proxyd_check_stats_cnf( VBIPROXY_MSG * pMsg )
+{
+   VBIPROXY_MSG_BODY   * pBody = &pMsg->body;
+   unsigned int len = pMsg->head.len;
+
+   return ( (pMsg->head.type == MSG_TYPE_STATS_CNF) &&
+            (len >= sizeof(VBIPROXY_MSG_HEADER) + sizeof(pBody->stats_cnf)) &&
+            (pBody->stats_cnf.dev_count >= 1) &&
+            (pBody->stats_cnf.dev_count <= len / sizeof(VBIPROXY_DEV_STATS)) &&
+            (pBody->stats_cnf.clnt_count <= len / sizeof(VBIPROXY_CLNT_STATS)) &&
+            (len == sizeof(VBIPROXY_MSG_HEADER) + VBIPROXY_STATS_CNF_SIZE(pBody->stats_cnf.dev_count,
+                                                                          pBody->stats_cnf.clnt_count)) );
+}
+
+/* ---------------------------------------------------------------------------
+** Connect to running daemon, query and print its statistics, exit.
+*/
+static void vbi_proxyd_query_stats( void )
+{
+   struct sigaction  act;
+   char * p_errorstr;
+   char * p_srv_port;
+   vbi_bool     io_blocked;
+   VBIPROXY_MSG * p_msg;
+   VBIPROXY_MSG_STATE io;
+   VBIPROXY_DEV_STATS  * p_stats;
+   VBIPROXY_CLNT_STATS * p_clnt_stats;
+   unsigned int idx;
+
+   memset(&io, 0, sizeof(io));
+   io.sock_fd  = -1;
+   p_errorstr = NULL;
+   p_msg = malloc(SRV_STATS_MAX_READ);
+   if (p_msg == NULL)
+   {
+      asprintf(&p_errorstr, "%s", "Virtual memory exhausted");
+      goto failure;
+   }
+   p_srv_port = vbi_proxy_msg_get_socket_name(proxy.dev[0].p_dev_name);
+   if (p_srv_port == NULL)
+      goto failure;
+
+   io.sock_fd = vbi_proxy_msg_connect_to_server(FALSE, NULL, p_srv_port, &p_errorstr);
+   if (io.sock_fd == -1)
+      goto failure;
+
+   memset(&act, 0, sizeof(act));
+   act.sa_handler = vbi_proxyd_kill_timeout;
+   sigaction(SIGALRM, &act, NULL);
+
+   /* use blocking I/O and alarm timer for timeout handling (simpler than select) */
+   alarm(4);
+   fcntl(io.sock_fd, F_SETFL, 0);
+
+   /* wait for socket to reach connected state */
+   if (vbi_proxy_msg_finish_connect(io.sock_fd, &p_errorstr) == FALSE)
+      goto failure;
+
+   vbi_proxy_msg_fill_magics(&p_msg->body.stats_req.magics);
+   vbi_proxy_msg_write(&io, MSG_TYPE_STATS_REQ, sizeof(p_msg->body.stats_req),
+                       p_msg, FALSE);
+
+   if (vbi_proxy_msg_handle_write(&io, &io_blocked) == FALSE)
+      goto io_error;
+
+   if (vbi_proxy_msg_handle_read(&io, &io_blocked, TRUE, p_msg, SRV_STATS_MAX_READ) == FALSE)
+      goto io_error;
+
+   if (vbi_proxyd_check_stats_cnf(p_msg) == FALSE)
+   {
+      asprintf(&p_errorstr, "%s", "Proxy protocol error");
+      goto failure;
+   }
+   close(io.sock_fd);
+
+   for (idx = 0; idx < p_msg->body.stats_cnf.dev_count; idx++)
+   {
+      p_stats = p_msg->body.stats_cnf.dev + idx;
+      p_stats->dev_vbi_name[VBIPROXY_DEV_NAME_MAX_LENGTH - 1] = 0;
+
+      printf("device #%u %s: %u client(s)", idx, p_stats->dev_vbi_name, p_stats->client_count);
+      if (p_stats->cpu >= 0)
+         printf(", CPU %d", p_stats->cpu);
+      printf("\n  captured %u  lost %u  read errors %u  forwarded %u  dropped %u\n"
+             "  queue depth %u of %u\n",
+             p_stats->frames_captured, p_stats->frames_lost, p_stats->read_errors,
+             p_stats->frames_forwarded, p_stats->frames_dropped,
+             p_stats->queue_depth, p_stats->queue_size);
+      vbi_proxyd_print_time_stats("slicing", &p_stats->slicing);
+      vbi_proxyd_print_time_stats("latency", &p_stats->latency);
+   }
+
+   p_clnt_stats = VBIPROXY_STATS_CNF_CLNT(&p_msg->body.stats_cnf);
+   for (idx = 0; idx < p_msg->body.stats_cnf.clnt_count; idx++, p_clnt_stats++)
+   {
+      p_clnt_stats->client_name[VBIPROXY_CLIENT_NAME_MAX_LENGTH - 1] = 0;
+
+      printf("client '%s' pid %d on device #%u: services 0x%X\n"
+             "  forwarded %u  dropped %u  queue depth %u\n",
+             p_clnt_stats->client_name, p_clnt_stats->pid, p_clnt_stats->dev_idx,
+             p_clnt_stats->services, p_clnt_stats->frames_forwarded,
+             p_clnt_stats->frames_dropped, p_clnt_stats->queue_depth);
+      vbi_proxyd_print_time_stats("latency", &p_clnt_stats->latency);
+   }
+
+   free(p_msg);
+   exit(0);
+
+io_error:
+   if (p_errorstr == NULL)
+      asprintf(&p_errorstr, "Lost connection to proxy (I/O error)");
+
+failure:
+   if (io.sock_fd != -1)
+      close(io.sock_fd);
+   if (p_msg != NULL)
+      free(p_msg);
+   if (p_errorstr != NULL)
+   {
+      fprintf(stderr, "%s\n", p_errorstr);
+      free(p_errorstr);
+   }
+   exit(1);
+}
+
 /* ---------------------------------------------------------------------------
 ** Print usage and exit
 */
@@ -2964,9 +3402,11 @@ static void proxy_usage_exit( const char *argv0, const char *argvn, const char *
    fprintf(stderr, "%s: %s: %s\n"
                    "Options:\n"
                    "       -dev <path>         : VBI device path (allowed repeatedly)\n"
+                   "       -cpu <number>       : bind capturing of the preceding device to a CPU\n"
                    "       -buffers <count>    : number of raw capture buffers (v4l2 only)\n"
                    "       -nodetach           : process remains connected to tty\n"
                    "       -kill               : kill running daemon process, then exit\n"
+                   "       -stats              : print statistics of running daemon, then exit\n"
                    "       -debug <level>      : enable debug output: 1=warnings, 2=all\n"
                    "       -syslog <level>     : enable syslog output\n"
                    "       -loglevel <level>   : log file level\n"
@@ -3010,8 +3450,6 @@ static void vbi_proxyd_parse_argv( int argc, char * argv[] )
       {
          if (arg_idx + 1 < argc)
          {
-            if (proxy.dev_count >= SRV_MAX_DEVICES)
-               proxy_usage_exit(argv[0], argv[arg_idx], "too many device paths");
             if (stat(argv[arg_idx + 1], &stb) == -1)
                proxy_usage_exit(argv[0], argv[arg_idx +1], strerror(errno));
             if (!S_ISCHR(stb.st_mode))
@@ -3025,6 +3463,24 @@ static void vbi_proxyd_parse_argv( int argc, char * argv[] )
          else
             proxy_usage_exit(argv[0], argv[arg_idx], "missing mode keyword after");
       }
+      else if (strcasecmp(argv[arg_idx], "-cpu") == 0)
+      {
+         if ((arg_idx + 1 < argc) && proxy_parse_argv_numeric(argv[arg_idx + 1], &arg_val))
+         {
+            if (proxy.dev_count == 0)
+               proxy_usage_exit(argv[0], argv[arg_idx], "must follow a device path given with -dev");
+#ifdef CPU_SETSIZE
+            if ((arg_val < 0) || (arg_val >= CPU_SETSIZE))
+#else
+            if (arg_val < 0)
+#endif
+               proxy_usage_exit(argv[0], argv[arg_idx], "CPU number out of range");
+            proxy.dev[proxy.dev_count - 1].cpu = arg_val;
+            arg_idx += 2;
+         }
+         else
+            proxy_usage_exit(argv[0], argv[arg_idx], "missing CPU number after");
+      }
       else if (strcasecmp(argv[arg_idx], "-buffers") == 0)
       {
          if ((arg_idx + 1 < argc) && proxy_parse_argv_numeric(argv[arg_idx + 1], &arg_val))
@@ -3059,6 +3515,11 @@ static void vbi_proxyd_parse_argv( int argc, char * argv[] )
          opt_kill_daemon = TRUE;
          arg_idx += 1;
       }
+      else if (strcasecmp(argv[arg_idx], "-stats") == 0)
+      {
+         opt_query_stats = TRUE;
+         arg_idx += 1;
+      }
       else if (strcasecmp(argv[arg_idx], "-syslog") == 0)
       {
          if ((arg_idx + 1 < argc) && proxy_parse_argv_numeric(argv[arg_idx + 1], &arg_val))
@@ -3138,6 +3599,11 @@ int main( int argc, char ** argv )
       vbi_proxyd_kill_daemon();
       exit(0);
    }
+   if (opt_query_stats)
+   {
+      vbi_proxyd_query_stats();
+      exit(0);
+   }
 
    dprintf(DBG_MSG, "proxy daemon starting, rev.\n%s\n", rcsid);
 
@@ -0,0 +1,1529 @@
+/*
+ *  libzvbi - ATSC transport stream caption demultiplexer
+ *
+ *  Copyright (C) 2008 Michael H. Schimek
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* This code is experimental and not yet part of the library API.
+   The video elementary stream decoder was derived from
+   contrib/atsc-cc.c. */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <pthread.h>
+
+#include "misc.h"
+#include "dtvcc_decoder.h"
+#include "atsc_cc_demux.h"
+
+/* Maximum number of programs we decode at once. */
+#define MAX_PROGRAMS 64
+
+enum pid_type {
+	PID_NONE = 0,
+	PID_PAT,
+	PID_PMT,
+	PID_VIDEO
+};
+
+enum start_code {
+	PICTURE_START_CODE = 0x00,
+	/* 0x01 ... 0xAF slice_start_code */
+	USER_DATA_START_CODE = 0xB2,
+	EXTENSION_START_CODE = 0xB5,
+	VIDEO_STREAM_0 = 0xE0,
+	VIDEO_STREAM_15 = 0xEF,
+};
+
+enum extension_start_code_identifier {
+	PICTURE_CODING_EXTENSION_ID = 0x8,
+};
+
+enum picture_coding_type {
+	/* 0 forbidden */
+	I_TYPE = 1,
+	P_TYPE = 2,
+	B_TYPE = 3,
+	D_TYPE = 4,
+	/* 5 ... 7 reserved */
+};
+
+enum picture_structure {
+	/* 0 reserved */
+	TOP_FIELD = 1,
+	BOTTOM_FIELD = 2,
+	FRAME_PICTURE = 3
+};
+
+enum received_blocks {
+	RECEIVED_PES_PACKET		= (1 << 0),
+	RECEIVED_PICTURE		= (1 << 1),
+	RECEIVED_PICTURE_EXT		= (1 << 2),
+	RECEIVED_MPEG_CC_DATA		= (1 << 3)
+};
+
+struct pid {
+	/* enum pid_type. */
+	uint8_t				type;
+
+	/* Index into the program table. */
+	uint8_t				program;
+
+	/* Next expected continuity_counter. Only the lowest four
+	   bits are valid. < 0 if no continuity_counter has been
+	   received yet. */
+	int8_t				next_cc;
+};
+
+/* A PSI section under construction. */
+struct section {
+	unsigned int			size;
+	unsigned int			total_size;
+	uint8_t				buffer[1024];
+};
+
+struct video_es {
+	/* Start code of the block in block[], < 0 if we are
+	   skipping data up to the next start code. */
+	int				start_code;
+
+	/* The first bytes of the current block, starting with the
+	   start code prefix. We only look at the headers and
+	   picture user data, so unlike atsc-cc we never buffer
+	   picture data. */
+	uint8_t				block[128];
+	unsigned int			block_size;
+
+	/* The last three bytes of the previous TS packet payload,
+	   to find start codes crossing packet boundaries. */
+	uint8_t				tail[3];
+
+	/* One or more TS packets were lost. */
+	vbi_bool			data_lost;
+
+	/* The presentation time stamp of the current picture. Only
+	   the lowest 33 bits are valid. < 0 if no PTS was received
+	   or the PES packet header was malformed. */
+	int64_t				pts;
+
+	/* Parameters of the current picture. */
+	enum picture_coding_type	picture_coding_type;
+	enum picture_structure		picture_structure;
+
+	/* Set of the data blocks we received so far. */
+	enum received_blocks		received_blocks;
+
+	/* Describes the contents of the reorder_buffer[]:
+	   Bit 0 - a top field in reorder_buffer[0],
+	   Bit 1 - a bottom field in reorder_buffer[1],
+	   Bit 2 - a frame in reorder_buffer[0]. Only the
+	   combinations 0, 1, 2, 3, 4 are valid. */
+	unsigned int			reorder_pictures;
+
+	/* The PTS (as above) of the data in the reorder_buffer. */
+	int64_t				reorder_pts[2];
+
+	unsigned int			reorder_n_bytes[2];
+
+	/* Buffer to convert picture user data from coded
+	   order to display order, for the top and bottom
+	   field. Maximum size required: 11 + cc_count * 3,
+	   where cc_count = 0 ... 31. */
+	uint8_t				reorder_buffer[2][128];
+};
+
+struct program {
+	_vbi_atsc_cc_demux *		dx;
+
+	unsigned int			program_number;
+
+	/* TS PID of the program map table and the video
+	   elementary stream, zero if unknown. */
+	unsigned int			pmt_pid;
+	unsigned int			video_pid;
+
+	/* Version of the last PMT we decoded, < 0 if none. */
+	int				pmt_version;
+
+	/* Listed in the current PAT. */
+	vbi_bool			in_pat;
+
+	struct section			pmt;
+
+	struct video_es			ves;
+
+	_vbi_cc_data_decoder *		cd;
+};
+
+struct _vbi_atsc_cc_demux {
+	/* Maps TS PIDs to programs. */
+	struct pid			pid[0x2000];
+
+	struct program *		program[MAX_PROGRAMS];
+
+	struct section			pat;
+
+	/* Version of the current PAT, < 0 if none. */
+	int				pat_version;
+	vbi_bool			pat_complete;
+
+	/* Incomplete TS packet from the previous
+	   _vbi_atsc_cc_demux_feed() call. */
+	uint8_t				partial[188];
+	unsigned int			partial_size;
+
+	/* Scratch buffer for the video ES decoder, shared by all
+	   programs. Holds the tail of the previous and the payload
+	   of the current TS packet. */
+	uint8_t				scratch[3 + 184];
+
+	double				capture_time;
+
+	unsigned int			event_mask;
+	_vbi_atsc_cc_demux_cb *		callback;
+	void *				user_data;
+
+	_vbi_log_hook			log;
+};
+
+static pthread_once_t		crc_table_once = PTHREAD_ONCE_INIT;
+static uint32_t			crc_table[256];
+
+static void
+init_crc_table			(void)
+{
+	const unsigned int poly =
+		((1 << 26) | (1 << 23) | (1 << 22) | (1 << 16) |
+		 (1 << 12) | (1 << 11) | (1 << 10) | (1 << 8) |
+		 (1 << 7) | (1 << 5) | (1 << 4) | (1 << 2) |
+		 (1 << 1) | 1);
+	unsigned int i, j;
+
+	/* ISO 13818-1 Annex B. */
+
+	for (i = 0; i < 256; ++i) {
+		unsigned int c;
+
+		c = i << 24;
+		for (j = 0; j < 8; ++j) {
+			if (c & (1U << 31))
+				c = (c << 1) ^ poly;
+			else
+				c <<= 1;
+		}
+		crc_table[i] = c;
+	}
+}
+
+static unsigned int
+mpeg2_crc			(const uint8_t *	buf,
+				 unsigned int		n_bytes)
+{
+	unsigned int crc;
+	unsigned int i;
+
+	crc = -1;
+	for (i = 0; i < n_bytes; ++i)
+		crc = crc_table[(buf[i] ^ (crc >> 24)) & 0xFF] ^ (crc << 8);
+
+	return crc & 0xFFFFFFFFUL;
+}
+
+static vbi_bool
+decode_time_stamp		(int64_t *		ts,
+				 const uint8_t *	buf,
+				 unsigned int		marker)
+{
+	unsigned int a, b, c;
+
+	/* ISO 13818-1 Section 2.4.3.6 */
+
+	if (0 != ((marker ^ buf[0]) & 0xF1))
+		return FALSE;
+
+	/* marker [4], TS [32..30], marker_bit,
+	   TS [29..15], marker_bit,
+	   TS [14..0], marker_bit */
+	a = (buf[0] >> 1) & 0x7;
+	b = (buf[1] * 256 + buf[2]) >> 1;
+	c = (buf[3] * 256 + buf[4]) >> 1;
+
+	*ts = ((int64_t) a << 30) + (b << 15) + (c << 0);
+
+	return TRUE;
+}
+
+/* Video elementary stream decoder. */
+
+static void
+decode_cc_data			(struct program *	pr,
+				 int64_t		pts,
+				 const uint8_t *	buf,
+				 unsigned int		n_bytes)
+{
+	if (n_bytes < 11)
+		return;
+
+	/* start_code_prefix [24], start_code [8],
+	   ATSC_identifier [32], user_data_type_code [8],
+	   cc_data () */
+	if (!_vbi_cc_data_decoder_feed (pr->cd, buf + 9, n_bytes - 9,
+					pr->dx->capture_time, pts)) {
+		debug1 (&pr->dx->log,
+			"Program %u cc_data error.",
+			pr->program_number);
+	}
+}
+
+static void
+ves_reorder_decode_cc_data	(struct program *	pr,
+				 const uint8_t *	buf,
+				 unsigned int		n_bytes)
+{
+	struct video_es *ves = &pr->ves;
+
+	n_bytes = MIN (n_bytes, (unsigned int)
+		       sizeof (ves->reorder_buffer[0]));
+
+	switch (ves->picture_structure) {
+	case FRAME_PICTURE:
+		if (0 != ves->reorder_pictures) {
+			if (ves->reorder_pictures & 5) {
+				/* Top field or top and bottom field. */
+				decode_cc_data (pr, ves->reorder_pts[0],
+						ves->reorder_buffer[0],
+						ves->reorder_n_bytes[0]);
+			}
+			if (ves->reorder_pictures & 2) {
+				/* Bottom field. */
+				decode_cc_data (pr, ves->reorder_pts[1],
+						ves->reorder_buffer[1],
+						ves->reorder_n_bytes[1]);
+			}
+		}
+
+		memcpy (ves->reorder_buffer[0], buf, n_bytes);
+		ves->reorder_n_bytes[0] = n_bytes;
+		ves->reorder_pts[0] = ves->pts;
+
+		/* We have a frame. */
+		ves->reorder_pictures = 4;
+
+		break;
+
+	case TOP_FIELD:
+		if (ves->reorder_pictures >= 3) {
+			/* Top field or top and bottom field. */
+			decode_cc_data (pr, ves->reorder_pts[0],
+					ves->reorder_buffer[0],
+					ves->reorder_n_bytes[0]);
+
+			ves->reorder_pictures &= 2;
+		}
+
+		memcpy (ves->reorder_buffer[0], buf, n_bytes);
+		ves->reorder_n_bytes[0] = n_bytes;
+		ves->reorder_pts[0] = ves->pts;
+
+		/* We have a top field. */
+		ves->reorder_pictures |= 1;
+
+		break;
+
+	case BOTTOM_FIELD:
+		if (ves->reorder_pictures >= 3) {
+			if (ves->reorder_pictures >= 4) {
+				/* Top and bottom field. */
+				decode_cc_data (pr, ves->reorder_pts[0],
+						ves->reorder_buffer[0],
+						ves->reorder_n_bytes[0]);
+			} else {
+				/* Bottom field. */
+				decode_cc_data (pr, ves->reorder_pts[1],
+						ves->reorder_buffer[1],
+						ves->reorder_n_bytes[1]);
+			}
+
+			ves->reorder_pictures &= 1;
+		}
+
+		memcpy (ves->reorder_buffer[1], buf, n_bytes);
+		ves->reorder_n_bytes[1] = n_bytes;
+		ves->reorder_pts[1] = ves->pts;
+
+		/* We have a bottom field. */
+		ves->reorder_pictures |= 2;
+
+		break;
+
+	default: /* invalid */
+		break;
+	}
+}
+
+static void
+ves_user_data			(struct program *	pr,
+				 const uint8_t *	buf,
+				 unsigned int		min_bytes_valid)
+{
+	struct video_es *ves = &pr->ves;
+	unsigned int ATSC_identifier;
+	unsigned int user_data_type_code;
+	unsigned int cc_count;
+
+	/* ATSC A/53 Part 4:2007 Section 6.2.2 */
+
+	/* NB. the PES packet header is optional and we may receive
+	   more than one user_data structure. */
+	if ((RECEIVED_PICTURE |
+	     RECEIVED_PICTURE_EXT)
+	    != (ves->received_blocks & (RECEIVED_PICTURE |
+					RECEIVED_PICTURE_EXT))) {
+		/* Either sequence or group user_data, or we missed
+		   the picture_header. */
+		ves->received_blocks &= ~RECEIVED_PES_PACKET;
+		return;
+	}
+
+	if (NULL != buf) {
+		/* start_code_prefix [24], start_code [8],
+		   ATSC_identifier [32], user_data_type_code [8] */
+		if (min_bytes_valid < 9)
+			return;
+
+		ATSC_identifier = ((buf[4] << 24) | (buf[5] << 16) |
+				   (buf[6] << 8) | buf[7]);
+		if (0x47413934 != ATSC_identifier)
+			return;
+
+		user_data_type_code = buf[8];
+		if (0x03 != user_data_type_code)
+			return;
+
+		/* ATSC A/53 Part 4:2007 Section 6.2.1: "No more than
+		   one user_data() structure using the same
+		   user_data_type_code [...] shall be present following
+		   any given picture header." */
+		if (ves->received_blocks & RECEIVED_MPEG_CC_DATA) {
+			/* Too much data lost. */
+			return;
+		}
+
+		ves->received_blocks |= RECEIVED_MPEG_CC_DATA;
+
+		/* reserved, process_cc_data_flag, zero_bit,
+		   cc_count [5], reserved [8] */
+		if (min_bytes_valid < 11)
+			return;
+
+		/* one_bit, reserved [4], cc_valid, cc_type [2],
+		   cc_data_1 [8], cc_data_2 [8] */
+		cc_count = buf[9] & 0x1F;
+
+		/* CEA 708-C Section 4.4 permits padding, so we have
+		   to see all cc_data elements. */
+		if (min_bytes_valid < 11 + cc_count * 3)
+			return;
+	} else {
+		/* No user_data received on this field or frame. */
+		static const uint8_t dummy[1];
+
+		buf = dummy;
+		min_bytes_valid = 0;
+	}
+
+	/* CEA 708-C Section 4.4.1.1 */
+
+	switch (ves->picture_coding_type) {
+	case I_TYPE:
+	case P_TYPE:
+		ves_reorder_decode_cc_data (pr, buf, min_bytes_valid);
+		break;
+
+	case B_TYPE:
+		/* To prevent a gap in the caption stream we must not
+		   decode B pictures until we have buffered both
+		   fields of the temporally following I or P picture. */
+		if (ves->reorder_pictures < 3) {
+			ves->reorder_pictures = 0;
+			break;
+		}
+
+		decode_cc_data (pr, ves->pts, buf, min_bytes_valid);
+
+		break;
+
+	default: /* invalid */
+		break;
+	}
+}
+
+static void
+ves_extension			(struct video_es *	ves,
+				 const uint8_t *	buf,
+				 unsigned int		min_bytes_valid)
+{
+	enum extension_start_code_identifier extension_start_code_identifier;
+
+	/* extension_start_code [32],
+	   extension_start_code_identifier [4],
+	   f_code [4][4], intra_dc_precision [2],
+	   picture_structure [2], ... */
+	if (min_bytes_valid < 7)
+		return;
+
+	extension_start_code_identifier =
+		(enum extension_start_code_identifier)(buf[4] >> 4);
+	if (PICTURE_CODING_EXTENSION_ID
+	    != extension_start_code_identifier)
+		return;
+
+	if (0 == (ves->received_blocks & RECEIVED_PICTURE)) {
+		/* We missed the picture_header. */
+		ves->received_blocks = 0;
+		return;
+	}
+
+	ves->picture_structure = (enum picture_structure)(buf[6] & 3);
+
+	ves->received_blocks |= RECEIVED_PICTURE_EXT;
+}
+
+static void
+ves_picture_header		(struct video_es *	ves,
+				 const uint8_t *	buf,
+				 unsigned int		min_bytes_valid)
+{
+	unsigned int c;
+
+	/* picture_start_code [32],
+	   picture_temporal_reference [10],
+	   picture_coding_type [3], ... */
+ 	if (min_bytes_valid < 6) {
+		/* Too much data lost. */
+		ves->received_blocks = 0;
+		return;
+	}
+
+	c = buf[4] * 256 + buf[5];
+	ves->picture_coding_type = (enum picture_coding_type)((c >> 3) & 7);
+
+	ves->received_blocks |= RECEIVED_PICTURE;
+}
+
+static void
+ves_pes_packet_header		(struct video_es *	ves,
+				 const uint8_t *	buf,
+				 unsigned int		min_bytes_valid)
+{
+	unsigned int PES_packet_length;
+	unsigned int PTS_DTS_flags;
+
+	ves->pts = -1;
+
+	ves->received_blocks = 0;
+
+	/* packet_start_code_prefix [24], stream_id [8],
+	   PES_packet_length [16],
+
+	   '10', PES_scrambling_control [2], PES_priority,
+	   data_alignment_indicator, copyright, original_or_copy,
+
+	   PTS_DTS_flags [2], ESCR_flag, ES_rate_flag,
+	   DSM_trick_mode_flag, additional_copy_info_flag,
+	   PES_CRC_flag, PES_extension_flag,
+
+	   PES_header_data_length [8] */
+	if (min_bytes_valid < 9)
+		return;
+
+	PES_packet_length = buf[4] * 256 + buf[5];
+	PTS_DTS_flags = (buf[7] & 0xC0) >> 6;
+
+	/* ISO 13818-1 Section 2.4.3.7: In transport streams video PES
+	   packets do not carry data, they only contain the DTS/PTS of
+	   the following picture and PES_packet_length must be
+	   zero. */
+	if (0 != PES_packet_length)
+		return;
+
+	switch (PTS_DTS_flags) {
+	case 0: /* no timestamps */
+	case 1: /* forbidden */
+		return;
+
+	case 2: /* PTS only */
+		if (min_bytes_valid < 14)
+			return;
+		if (!decode_time_stamp (&ves->pts, &buf[9], 0x21))
+			return;
+		break;
+
+	case 3: /* PTS and DTS */
+		if (min_bytes_valid < 19)
+			return;
+		if (!decode_time_stamp (&ves->pts, &buf[9], 0x31))
+			return;
+		break;
+	}
+
+	ves->received_blocks = RECEIVED_PES_PACKET;
+}
+
+static void
+ves_decode_block		(struct program *	pr,
+				 vbi_bool		data_lost)
+{
+	struct video_es *ves = &pr->ves;
+	unsigned int start_code;
+	const uint8_t *buf;
+	unsigned int min_bytes_valid;
+
+	start_code = ves->start_code;
+	buf = ves->block;
+	min_bytes_valid = ves->block_size;
+
+	/* The CEA 608-C and 708-C Close Caption data is encoded in
+	   picture user data fields. ISO 13818-2 requires the start
+	   code sequence 0x00, 0xB5/8, (0xB5?, 0xB2?)*. To properly
+	   convert from coded order to display order we also need the
+	   picture_coding_type and picture_structure fields. */
+
+	if (likely (start_code <= 0xAF)) {
+		if (!data_lost
+		    && (ves->received_blocks == (RECEIVED_PICTURE |
+						 RECEIVED_PICTURE_EXT)
+			|| ves->received_blocks == (RECEIVED_PES_PACKET |
+						    RECEIVED_PICTURE |
+						    RECEIVED_PICTURE_EXT))) {
+			/* No user data received for this picture. */
+			ves_user_data (pr, NULL, 0);
+		}
+
+		if (unlikely (PICTURE_START_CODE == start_code)
+		    && !data_lost) {
+			ves_picture_header (ves, buf, min_bytes_valid);
+		} else {
+			/* slice_start_code, or data lost in or after
+			   the picture_header. We need an uninterrupted
+			   sequence from the PES packet header to the
+			   picture user data to ensure the PTS,
+			   picture_coding_type, picture_structure and
+			   cc_data belong together. */
+			ves->received_blocks = 0;
+			ves->pts = -1;
+		}
+	} else if (USER_DATA_START_CODE == start_code) {
+		ves_user_data (pr, buf, min_bytes_valid);
+	} else if (data_lost) {
+		/* Data lost in or after this block. */
+		ves->received_blocks = 0;
+	} else if (EXTENSION_START_CODE == start_code) {
+		ves_extension (ves, buf, min_bytes_valid);
+	} else if (start_code >= VIDEO_STREAM_0
+		   && start_code <= VIDEO_STREAM_15) {
+		if (ves->received_blocks == (RECEIVED_PICTURE |
+					     RECEIVED_PICTURE_EXT)
+		    || ves->received_blocks == (RECEIVED_PES_PACKET |
+						RECEIVED_PICTURE |
+						RECEIVED_PICTURE_EXT)) {
+			/* No user data received for previous picture. */
+			ves_user_data (pr, NULL, 0);
+		}
+
+		/* Start of a new picture. */
+		ves_pes_packet_header (ves, buf, min_bytes_valid);
+	} else {
+		/* Should be a sequence_header or
+		   group_of_pictures_header. */
+		ves->received_blocks &= RECEIVED_PES_PACKET;
+	}
+}
+
+static void
+ves_append			(struct video_es *	ves,
+				 const uint8_t *	s,
+				 unsigned int		n_bytes)
+{
+	unsigned int size;
+
+	/* Slices are just filler for us. */
+	if (ves->start_code > 0x00 && ves->start_code <= 0xAF)
+		return;
+
+	size = ves->block_size;
+	n_bytes = MIN (n_bytes, (unsigned int) sizeof (ves->block) - size);
+	memcpy (ves->block + size, s, n_bytes);
+	ves->block_size = size + n_bytes;
+}
+
+static void
+video_es_packet			(_vbi_atsc_cc_demux *	dx,
+				 struct program *	pr,
+				 const uint8_t *	payload,
+				 unsigned int		payload_size,
+				 vbi_bool		data_lost)
+{
+	struct video_es *ves = &pr->ves;
+	const uint8_t *s;
+	const uint8_t *e;
+	const uint8_t *b;
+
+	if (unlikely (data_lost | ves->data_lost)) {
+		if (ves->start_code >= 0)
+			ves_decode_block (pr, /* data_lost */ TRUE);
+
+		/* Skip to the next start code. */
+		ves->start_code = -1;
+		ves->block_size = 0;
+		memset (ves->tail, 0xFF, sizeof (ves->tail));
+		ves->data_lost = FALSE;
+	}
+
+	/* This code searches for start codes and decodes the data
+	   between the previous and the current start code. Bytes
+	   before the last three of the scratch buffer are final,
+	   the rest may be part of a start code prefix and is
+	   examined again with the next packet. */
+
+	memcpy (dx->scratch, ves->tail, 3);
+	memcpy (dx->scratch + 3, payload, payload_size);
+
+	s = dx->scratch;
+	e = dx->scratch + 3 + payload_size - 3;
+	b = s;
+
+	for (;;) {
+		while (s < e) {
+			if (likely (0 != (s[2] & ~1))) {
+				/* Not 000001 or xx0000 or xxxx00. */
+				s += 3;
+			} else if (0 != (s[0] | s[1]) || 1 != s[2]) {
+				++s;
+			} else {
+				break;
+			}
+		}
+
+		if (s >= e)
+			break;
+
+		if (ves->start_code >= 0) {
+			ves_append (ves, b, s - b);
+			ves_decode_block (pr, /* data_lost */ FALSE);
+		}
+
+		ves->start_code = s[3];
+		ves->block_size = 0;
+
+		b = s;
+		s += 4;
+	}
+
+	if (ves->start_code >= 0 && e > b)
+		ves_append (ves, b, e - b);
+
+	memcpy (ves->tail, e, 3);
+}
+
+static void
+reset_video_es			(struct video_es *	ves)
+{
+	ves->start_code = -1;
+	ves->block_size = 0;
+	memset (ves->tail, 0xFF, sizeof (ves->tail));
+	ves->data_lost = FALSE;
+
+	ves->pts = -1;
+	ves->picture_coding_type = (enum picture_coding_type) -1;
+	ves->picture_structure = (enum picture_structure) -1;
+	ves->received_blocks = 0;
+	ves->reorder_pictures = 0;
+}
+
+/* Program Specific Information. */
+
+static void
+program_event_handler		(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct program *pr = (struct program *) user_data;
+	_vbi_atsc_cc_demux *dx = pr->dx;
+
+	dx->callback (dx, dx->user_data, pr->program_number, ev);
+}
+
+static void
+unmap_pid			(_vbi_atsc_cc_demux *	dx,
+				 unsigned int		pid,
+				 unsigned int		program_index)
+{
+	struct pid *p;
+	enum pid_type type;
+	unsigned int i;
+
+	p = &dx->pid[pid];
+
+	type = (enum pid_type) p->type;
+	if ((PID_PMT != type && PID_VIDEO != type)
+	    || program_index != p->program)
+		return;
+
+	p->type = PID_NONE;
+	p->program = 0;
+	p->next_cc = -1;
+
+	if (PID_PMT != type)
+		return;
+
+	/* Several programs may share one PMT PID. */
+	for (i = 0; i < MAX_PROGRAMS; ++i) {
+		struct program *pr = dx->program[i];
+
+		if (i != program_index && NULL != pr
+		    && pid == pr->pmt_pid) {
+			p->type = PID_PMT;
+			p->program = i;
+			break;
+		}
+	}
+}
+
+static void
+delete_program			(_vbi_atsc_cc_demux *	dx,
+				 unsigned int		program_index)
+{
+	struct program *pr;
+
+	pr = dx->program[program_index];
+	if (NULL == pr)
+		return;
+
+	if (0 != pr->video_pid)
+		unmap_pid (dx, pr->video_pid, program_index);
+	unmap_pid (dx, pr->pmt_pid, program_index);
+
+	_vbi_cc_data_decoder_delete (pr->cd);
+
+	dx->program[program_index] = NULL;
+
+	vbi_free (pr);
+}
+
+static struct program *
+add_program			(_vbi_atsc_cc_demux *	dx,
+				 unsigned int		program_number,
+				 unsigned int		pmt_pid)
+{
+	struct program *pr;
+	unsigned int i;
+
+	for (i = 0; i < MAX_PROGRAMS; ++i) {
+		if (NULL == dx->program[i])
+			break;
+	}
+
+	if (i >= MAX_PROGRAMS) {
+		debug1 (&dx->log, "Too many programs, "
+			"ignoring program %u.", program_number);
+		return NULL;
+	}
+
+	pr = vbi_malloc (sizeof (*pr));
+	if (NULL == pr)
+		return NULL;
+
+	CLEAR (*pr);
+
+	pr->cd = _vbi_cc_data_decoder_new ();
+	if (NULL == pr->cd)
+		goto failure;
+
+	if (!_vbi_cc_data_decoder_add_event_handler
+	    (pr->cd, dx->event_mask, program_event_handler, pr))
+		goto failure;
+
+	pr->dx = dx;
+	pr->program_number = program_number;
+	pr->pmt_pid = pmt_pid;
+	pr->pmt_version = -1;
+
+	reset_video_es (&pr->ves);
+
+	dx->program[i] = pr;
+
+	if (PID_NONE == dx->pid[pmt_pid].type) {
+		dx->pid[pmt_pid].type = PID_PMT;
+		dx->pid[pmt_pid].program = i;
+	}
+
+	return pr;
+
+ failure:
+	_vbi_cc_data_decoder_delete (pr->cd);
+	vbi_free (pr);
+
+	return NULL;
+}
+
+static struct program *
+find_program			(_vbi_atsc_cc_demux *	dx,
+				 unsigned int *		program_index,
+				 unsigned int		program_number)
+{
+	unsigned int i;
+
+	for (i = 0; i < MAX_PROGRAMS; ++i) {
+		struct program *pr = dx->program[i];
+
+		if (NULL != pr && program_number == pr->program_number) {
+			if (NULL != program_index)
+				*program_index = i;
+			return pr;
+		}
+	}
+
+	return NULL;
+}
+
+static vbi_bool
+valid_section			(const uint8_t *	buf,
+				 unsigned int		n_bytes)
+{
+	/* table_id [8], section_syntax_indicator, '0',
+	   reserved [2], section_length [12], table_id_extension
+	   [16], reserved [2], version_number [5],
+	   current_next_indicator, section_number [8],
+	   last_section_number [8], ..., CRC_32 [32] */
+	if (n_bytes < 12 || 0 == (buf[1] & 0x80))
+		return FALSE;
+
+	/* A section which is not yet applicable. */
+	if (0 == (buf[5] & 0x01))
+		return FALSE;
+
+	return (0 == mpeg2_crc (buf, n_bytes));
+}
+
+static void
+decode_pmt			(_vbi_atsc_cc_demux *	dx,
+				 const uint8_t *	buf,
+				 unsigned int		n_bytes)
+{
+	struct program *pr;
+	unsigned int program_index;
+	unsigned int program_number;
+	unsigned int program_info_length;
+	unsigned int video_pid;
+	int version;
+	unsigned int i;
+
+	/* ISO 13818-1 Section 2.4.4.8. */
+
+	if (0x02 != buf[0] || !valid_section (buf, n_bytes))
+		return;
+
+	program_number = buf[3] * 256 + buf[4];
+
+	pr = find_program (dx, &program_index, program_number);
+	if (NULL == pr)
+		return;
+
+	version = (buf[5] >> 1) & 0x1F;
+	if (version == pr->pmt_version)
+		return;
+
+	pr->pmt_version = version;
+
+	/* reserved [3], PCR_PID [13], reserved [4],
+	   program_info_length [12] */
+	program_info_length = (buf[10] * 256 + buf[11]) & 0xFFF;
+
+	video_pid = 0;
+
+	for (i = 12 + program_info_length; i + 5 <= n_bytes - 4;) {
+		unsigned int stream_type;
+		unsigned int elementary_pid;
+
+		/* stream_type [8], reserved [3], elementary_PID [13],
+		   reserved [4], ES_info_length [12] */
+		stream_type = buf[i];
+		elementary_pid = (buf[i + 1] * 256 + buf[i + 2]) & 0x1FFF;
+
+		/* MPEG-1 video, MPEG-2 video, DigiCipher II video. */
+		if (0x01 == stream_type
+		    || 0x02 == stream_type
+		    || 0x80 == stream_type) {
+			video_pid = elementary_pid;
+			break;
+		}
+
+		i += 5 + ((buf[i + 3] * 256 + buf[i + 4]) & 0xFFF);
+	}
+
+	if (video_pid == pr->video_pid)
+		return;
+
+	if (0 != pr->video_pid)
+		unmap_pid (dx, pr->video_pid, program_index);
+
+	pr->video_pid = 0;
+
+	reset_video_es (&pr->ves);
+	_vbi_cc_data_decoder_reset (pr->cd);
+
+	if (0 == video_pid)
+		return;
+
+	/* Note two or more programs may share one elementary stream
+	   (e.g. radio programs with a dummy video stream). We
+	   decode the captions only once. */
+	if (PID_NONE != dx->pid[video_pid].type) {
+		debug1 (&dx->log, "Program %u video PID 0x%04x "
+			"already in use.", program_number, video_pid);
+		return;
+	}
+
+	pr->video_pid = video_pid;
+
+	dx->pid[video_pid].type = PID_VIDEO;
+	dx->pid[video_pid].program = program_index;
+	dx->pid[video_pid].next_cc = -1;
+}
+
+static void
+decode_pat			(_vbi_atsc_cc_demux *	dx,
+				 const uint8_t *	buf,
+				 unsigned int		n_bytes)
+{
+	unsigned int section_number;
+	unsigned int last_section_number;
+	int version;
+	unsigned int i;
+
+	/* ISO 13818-1 Section 2.4.4.3. */
+
+	if (0x00 != buf[0] || !valid_section (buf, n_bytes))
+		return;
+
+	version = (buf[5] >> 1) & 0x1F;
+	if (version == dx->pat_version && dx->pat_complete)
+		return;
+
+	if (version != dx->pat_version) {
+		dx->pat_version = version;
+		dx->pat_complete = FALSE;
+
+		for (i = 0; i < MAX_PROGRAMS; ++i) {
+			if (NULL != dx->program[i])
+				dx->program[i]->in_pat = FALSE;
+		}
+	}
+
+	for (i = 8; i + 4 <= n_bytes - 4; i += 4) {
+		struct program *pr;
+		unsigned int program_index;
+		unsigned int program_number;
+		unsigned int pmt_pid;
+
+		/* program_number [16], reserved [3],
+		   program_map_PID [13] */
+		program_number = buf[i] * 256 + buf[i + 1];
+		pmt_pid = (buf[i + 2] * 256 + buf[i + 3]) & 0x1FFF;
+
+		/* Network PID. */
+		if (0 == program_number)
+			continue;
+
+		pr = find_program (dx, &program_index, program_number);
+		if (NULL != pr && pmt_pid != pr->pmt_pid) {
+			delete_program (dx, program_index);
+			pr = NULL;
+		}
+
+		if (NULL == pr) {
+			if (PID_NONE != dx->pid[pmt_pid].type
+			    && PID_PMT != dx->pid[pmt_pid].type)
+				continue;
+
+			pr = add_program (dx, program_number, pmt_pid);
+			if (NULL == pr)
+				continue;
+		}
+
+		pr->in_pat = TRUE;
+	}
+
+	section_number = buf[6];
+	last_section_number = buf[7];
+
+	if (section_number < last_section_number)
+		return;
+
+	for (i = 0; i < MAX_PROGRAMS; ++i) {
+		if (NULL != dx->program[i] && !dx->program[i]->in_pat)
+			delete_program (dx, i);
+	}
+
+	dx->pat_complete = TRUE;
+}
+
+/* Returns the number of bytes consumed. */
+static unsigned int
+section_add			(struct section *	sec,
+				 const uint8_t *	s,
+				 unsigned int		n_bytes)
+{
+	unsigned int consumed;
+	unsigned int n;
+
+	consumed = 0;
+
+	if (sec->size < 3) {
+		n = MIN (n_bytes, 3 - sec->size);
+		memcpy (sec->buffer + sec->size, s, n);
+		sec->size += n;
+		if (sec->size < 3)
+			return n;
+
+		sec->total_size = 3 + (((sec->buffer[1] & 0x0F) << 8)
+				       | sec->buffer[2]);
+		if (sec->total_size > sizeof (sec->buffer)) {
+			/* Invalid, skip the rest. */
+			sec->size = 0;
+			return n_bytes;
+		}
+
+		consumed = n;
+		s += n;
+		n_bytes -= n;
+	}
+
+	n = MIN (n_bytes, sec->total_size - sec->size);
+	memcpy (sec->buffer + sec->size, s, n);
+	sec->size += n;
+
+	return consumed + n;
+}
+
+static void
+section_packet			(_vbi_atsc_cc_demux *	dx,
+				 struct section *	sec,
+				 const uint8_t *	s,
+				 unsigned int		n_bytes,
+				 vbi_bool		unit_start,
+				 vbi_bool		data_lost,
+				 void			(* decode)
+				 (_vbi_atsc_cc_demux *, const uint8_t *,
+				  unsigned int))
+{
+	if (unlikely (data_lost))
+		sec->size = 0;
+
+	if (unit_start) {
+		unsigned int pointer_field;
+
+		pointer_field = s[0];
+		++s;
+		--n_bytes;
+
+		if (pointer_field >= n_bytes) {
+			sec->size = 0;
+			return;
+		}
+
+		if (sec->size > 0) {
+			section_add (sec, s, pointer_field);
+			if (sec->size >= 3 && sec->size == sec->total_size)
+				decode (dx, sec->buffer, sec->size);
+		}
+
+		sec->size = 0;
+
+		s += pointer_field;
+		n_bytes -= pointer_field;
+
+		/* Stuffing bytes follow the last section. */
+		while (n_bytes > 0 && 0xFF != s[0]) {
+			unsigned int n;
+
+			n = section_add (sec, s, n_bytes);
+			s += n;
+			n_bytes -= n;
+
+			if (sec->size >= 3
+			    && sec->size == sec->total_size) {
+				decode (dx, sec->buffer, sec->size);
+				sec->size = 0;
+			}
+		}
+	} else if (sec->size > 0) {
+		section_add (sec, s, n_bytes);
+		if (sec->size >= 3 && sec->size == sec->total_size) {
+			decode (dx, sec->buffer, sec->size);
+			sec->size = 0;
+		}
+	}
+}
+
+/* Transport stream decoder. */
+
+static void
+transport_error			(_vbi_atsc_cc_demux *	dx)
+{
+	unsigned int i;
+
+	/* The PID may be wrong, we don't know how much data
+	   was lost, and continuity counters match by chance
+	   with 1:16 probability. */
+
+	dx->pat.size = 0;
+
+	for (i = 0; i < MAX_PROGRAMS; ++i) {
+		struct program *pr = dx->program[i];
+
+		if (NULL != pr) {
+			pr->pmt.size = 0;
+			pr->ves.data_lost = TRUE;
+		}
+	}
+}
+
+static void
+ts_packet			(_vbi_atsc_cc_demux *	dx,
+				 const uint8_t		buf[188])
+{
+	struct pid *p;
+	unsigned int pid;
+	unsigned int adaptation_field_control;
+	unsigned int header_length;
+	vbi_bool data_lost;
+
+	if (unlikely (buf[1] & 0x80)) {
+		debug1 (&dx->log, "TS transmission error.");
+		transport_error (dx);
+		return;
+	}
+
+	pid = (buf[1] * 256 + buf[2]) & 0x1FFF;
+
+	p = &dx->pid[pid];
+	if (likely (PID_NONE == p->type))
+		return;
+
+	adaptation_field_control = (buf[3] & 0x30) >> 4;
+	if (likely (1 == adaptation_field_control)) {
+		header_length = 4;
+	} else if (3 == adaptation_field_control) {
+		unsigned int adaptation_field_length;
+
+		adaptation_field_length = buf[4];
+
+		/* Zero length is used for stuffing. */
+		if (adaptation_field_length > 0) {
+			/* ISO 13818-1 Section 2.4.3.5. */
+			if (adaptation_field_length > 182) {
+				debug1 (&dx->log, "Invalid TS header "
+					"on PID 0x%04x.", pid);
+				transport_error (dx);
+				return;
+			}
+
+			/* discontinuity_indicator */
+			if (buf[5] & 0x80)
+				p->next_cc = -1;
+		}
+
+		header_length = 5 + adaptation_field_length;
+	} else {
+		/* 0 == adaptation_field_control: invalid;
+		   2 == adaptation_field_control: no payload. */
+		/* ISO 13818-1 Section 2.4.3.3:
+		   continuity_counter shall not increment. */
+		return;
+	}
+
+	data_lost = FALSE;
+
+	if (unlikely (0 != ((p->next_cc ^ buf[3]) & 0x0F))) {
+		/* Continuity counter mismatch. */
+
+		if (p->next_cc < 0) {
+			/* First TS packet. */
+		} else if (0 == (((p->next_cc - 1) ^ buf[3]) & 0x0F)) {
+			/* ISO 13818-1 Section 2.4.3.3:
+			   Repeated packet. */
+			return;
+		} else {
+			debug1 (&dx->log, "TS continuity error "
+				"on PID 0x%04x.", pid);
+			data_lost = TRUE;
+		}
+	}
+
+	p->next_cc = (buf[3] + 1) & 0x0F;
+
+	switch ((enum pid_type) p->type) {
+	case PID_NONE:
+		break;
+
+	case PID_PAT:
+		section_packet (dx, &dx->pat,
+				buf + header_length, 188 - header_length,
+				/* unit_start */ !!(buf[1] & 0x40),
+				data_lost, decode_pat);
+		break;
+
+	case PID_PMT:
+		section_packet (dx, &dx->program[p->program]->pmt,
+				buf + header_length, 188 - header_length,
+				/* unit_start */ !!(buf[1] & 0x40),
+				data_lost, decode_pmt);
+		break;
+
+	case PID_VIDEO:
+		video_es_packet (dx, dx->program[p->program],
+				 buf + header_length, 188 - header_length,
+				 data_lost);
+		break;
+	}
+}
+
+/**
+ * @param dx ATSC caption demultiplexer allocated with
+ *   _vbi_atsc_cc_demux_new().
+ * @param buffer MPEG-2 transport stream data.
+ * @param buffer_size Number of bytes in the @a buffer.
+ * @param capture_time System time in seconds when the data was
+ *   received.
+ *
+ * Demultiplexes the transport stream, decodes the caption data of
+ * all programs listed in the Program Association Table and calls
+ * the callback function given to _vbi_atsc_cc_demux_new() with the
+ * resulting events. The TS packets need not be aligned to
+ * @a buffer boundaries.
+ *
+ * @returns
+ * @c FALSE if the demultiplexer lost TS packet synchronization.
+ */
+vbi_bool
+_vbi_atsc_cc_demux_feed		(_vbi_atsc_cc_demux *	dx,
+				 const uint8_t *	buffer,
+				 unsigned int		buffer_size,
+				 double			capture_time)
+{
+	vbi_bool in_sync;
+
+	assert (NULL != dx);
+	assert (NULL != buffer);
+
+	dx->capture_time = capture_time;
+
+	in_sync = TRUE;
+
+	if (dx->partial_size > 0) {
+		unsigned int n;
+
+		n = MIN (buffer_size, 188 - dx->partial_size);
+		memcpy (dx->partial + dx->partial_size, buffer, n);
+		dx->partial_size += n;
+
+		if (dx->partial_size < 188)
+			return TRUE;
+
+		ts_packet (dx, dx->partial);
+		dx->partial_size = 0;
+
+		buffer += n;
+		buffer_size -= n;
+	}
+
+	while (buffer_size > 0) {
+		if (unlikely (0x47 != buffer[0])) {
+			if (in_sync) {
+				debug1 (&dx->log, "Lost TS sync.");
+				transport_error (dx);
+				in_sync = FALSE;
+			}
+
+			++buffer;
+			--buffer_size;
+
+			continue;
+		}
+
+		if (buffer_size < 188) {
+			memcpy (dx->partial, buffer, buffer_size);
+			dx->partial_size = buffer_size;
+			break;
+		}
+
+		ts_packet (dx, buffer);
+
+		buffer += 188;
+		buffer_size -= 188;
+	}
+
+	return in_sync;
+}
+
+/**
+ * @param dx ATSC caption demultiplexer allocated with
+ *   _vbi_atsc_cc_demux_new().
+ * @param program_numbers Program numbers will be stored here.
+ * @param max_programs Size of the @a program_numbers array.
+ *
+ * Returns the numbers of the programs currently decoded, in no
+ * particular order.
+ *
+ * @returns
+ * Number of programs stored in @a program_numbers.
+ */
+unsigned int
+_vbi_atsc_cc_demux_get_programs	(_vbi_atsc_cc_demux *	dx,
+				 unsigned int *		program_numbers,
+				 unsigned int		max_programs)
+{
+	unsigned int n_programs;
+	unsigned int i;
+
+	assert (NULL != dx);
+	assert (NULL != program_numbers);
+
+	n_programs = 0;
+
+	for (i = 0; i < MAX_PROGRAMS && n_programs < max_programs; ++i) {
+		if (NULL != dx->program[i]) {
+			program_numbers[n_programs++] =
+				dx->program[i]->program_number;
+		}
+	}
+
+	return n_programs;
+}
+
+/**
+ * @param dx ATSC caption demultiplexer allocated with
+ *   _vbi_atsc_cc_demux_new().
+ *
+ * Resets the demultiplexer and forgets all programs, useful for
+ * example after a channel change.
+ */
+void
+_vbi_atsc_cc_demux_reset	(_vbi_atsc_cc_demux *	dx)
+{
+	unsigned int i;
+
+	assert (NULL != dx);
+
+	for (i = 0; i < MAX_PROGRAMS; ++i)
+		delete_program (dx, i);
+
+	CLEAR (dx->pid);
+
+	for (i = 0; i < N_ELEMENTS (dx->pid); ++i)
+		dx->pid[i].next_cc = -1;
+
+	dx->pid[0x0000].type = PID_PAT;
+
+	dx->pat.size = 0;
+	dx->pat_version = -1;
+	dx->pat_complete = FALSE;
+
+	dx->partial_size = 0;
+}
+
+/**
+ * @param dx ATSC caption demultiplexer allocated with
+ *   _vbi_atsc_cc_demux_new(), can be @c NULL.
+ *
+ * Frees all resources associated with @a dx.
+ */
+void
+_vbi_atsc_cc_demux_delete	(_vbi_atsc_cc_demux *	dx)
+{
+	unsigned int i;
+
+	if (NULL == dx)
+		return;
+
+	for (i = 0; i < MAX_PROGRAMS; ++i)
+		delete_program (dx, i);
+
+	CLEAR (*dx);
+
+	vbi_free (dx);
+}
+
+/**
+ * @param event_mask Set of events the @a callback is waiting for,
+ *   _VBI_EVENT_CC608, _VBI_EVENT_CC608_STREAM and
+ *   _VBI_EVENT_DTVCC_STREAM.
+ * @param callback Function to be called by _vbi_atsc_cc_demux_feed()
+ *   on caption events.
+ * @param user_data User pointer passed through to the @a callback
+ *   function.
+ *
+ * Allocates a demultiplexer which decodes the EIA 608 and CEA 708-C
+ * captions of all programs in an ATSC transport stream at once.
+ * Compared to one transport stream demultiplexer per program all
+ * programs share one scan of the stream and one video elementary
+ * stream buffer, and only the PSI tables and picture headers of
+ * each program are retained.
+ *
+ * @returns
+ * Pointer to a newly allocated demultiplexer which must be freed
+ * with _vbi_atsc_cc_demux_delete() when no longer needed. @c NULL
+ * on failure (out of memory).
+ */
+_vbi_atsc_cc_demux *
+_vbi_atsc_cc_demux_new		(unsigned int		event_mask,
+				 _vbi_atsc_cc_demux_cb *callback,
+				 void *			user_data)
+{
+	_vbi_atsc_cc_demux *dx;
+
+	assert (NULL != callback);
+
+	pthread_once (&crc_table_once, init_crc_table);
+
+	dx = vbi_malloc (sizeof (*dx));
+	if (NULL == dx) {
+		return NULL;
+	}
+
+	CLEAR (*dx);
+
+	dx->event_mask = event_mask;
+	dx->callback = callback;
+	dx->user_data = user_data;
+
+	_vbi_atsc_cc_demux_reset (dx);
+
+	return dx;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
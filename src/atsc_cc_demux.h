@@ -0,0 +1,83 @@
+/*
+ *  libzvbi - ATSC transport stream caption demultiplexer
+ *
+ *  Copyright (C) 2008 Michael H. Schimek
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* This code is experimental and not yet part of the library API. */
+
+#ifndef __ZVBI_ATSC_CC_DEMUX_H__
+#define __ZVBI_ATSC_CC_DEMUX_H__
+
+#include "event.h"
+
+VBI_BEGIN_DECLS
+
+/* Public */
+
+typedef struct _vbi_atsc_cc_demux _vbi_atsc_cc_demux;
+
+/**
+ * @param dx ATSC caption demultiplexer allocated with
+ *   _vbi_atsc_cc_demux_new().
+ * @param user_data User data pointer given to _vbi_atsc_cc_demux_new().
+ * @param program_number The MPEG-2 program the captions belong to.
+ * @param ev A _VBI_EVENT_CC608, _VBI_EVENT_CC608_STREAM or
+ *   _VBI_EVENT_DTVCC_STREAM event.
+ *
+ * The _vbi_atsc_cc_demux_feed() function calls a function of this
+ * type when a caption decoder of one of the programs in the transport
+ * stream sends an event.
+ */
+typedef void
+_vbi_atsc_cc_demux_cb		(_vbi_atsc_cc_demux *	dx,
+				 void *			user_data,
+				 unsigned int		program_number,
+				 vbi_event *		ev);
+
+extern vbi_bool
+_vbi_atsc_cc_demux_feed		(_vbi_atsc_cc_demux *	dx,
+				 const uint8_t *	buffer,
+				 unsigned int		buffer_size,
+				 double			capture_time);
+extern unsigned int
+_vbi_atsc_cc_demux_get_programs	(_vbi_atsc_cc_demux *	dx,
+				 unsigned int *		program_numbers,
+				 unsigned int		max_programs);
+extern void
+_vbi_atsc_cc_demux_reset	(_vbi_atsc_cc_demux *	dx);
+extern void
+_vbi_atsc_cc_demux_delete	(_vbi_atsc_cc_demux *	dx);
+extern _vbi_atsc_cc_demux *
+_vbi_atsc_cc_demux_new		(unsigned int		event_mask,
+				 _vbi_atsc_cc_demux_cb *callback,
+				 void *			user_data);
+
+/* Private */
+
+VBI_END_DECLS
+
+#endif /* __ZVBI_ATSC_CC_DEMUX_H__ */
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
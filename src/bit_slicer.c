@@ -201,6 +201,7 @@ do {									\
 			cl -= bs->oversampling_rate;			\
 			c = c * 2 + b;					\
 			if ((c & bs->cri_mask) == bs->cri) {		\
+				bs->cri_lock = raw - raw_start;		\
 				PAYLOAD ();				\
 				if (collect_points) {			\
 					*n_points = points		\
@@ -365,6 +366,7 @@ low_pass_bit_slicer_Y8		(vbi3_bit_slicer *	bs,
 				cl -= bs->oversampling_rate;
 				c = c * 2 + b;
 				if ((c & bs->cri_mask) == bs->cri) {
+					bs->cri_lock = raw - raw_start;
 					break;
 				}
 			}
@@ -627,6 +629,258 @@ vbi3_bit_slicer_slice		(vbi3_bit_slicer *	bs,
 			 raw);
 }
 
+/**
+ * @internal
+ * @param bs Pointer to vbi3_bit_slicer object allocated with
+ *   vbi3_bit_slicer_new(). You must also call
+ *   vbi3_bit_slicer_set_params() before calling this function.
+ * @param buffer Output data, as with vbi3_bit_slicer_slice().
+ * @param buffer_size Size of the output buffer.
+ * @param raw Input data.
+ * @param first First sample to search for the CRI, counting from
+ *   the @a sample_offset given to vbi3_bit_slicer_set_params().
+ * @param count Number of samples to search. The function does not
+ *   search beyond the range searched by vbi3_bit_slicer_slice().
+ * @param lock When the function succeeds the sample where the
+ *   CRI and FRC bits matched, counting like @a first, is stored here.
+ *
+ * Like vbi3_bit_slicer_slice() but searches the CRI only in a part of
+ * the line, for example near the position where the previous frame
+ * had it.
+ *
+ * @returns
+ * @c FALSE if the @a buffer is too small or the CRI/FRC has not been
+ * found in the window.
+ */
+vbi_bool
+_vbi3_bit_slicer_slice_window	(vbi3_bit_slicer *	bs,
+				 uint8_t *		buffer,
+				 unsigned int		buffer_size,
+				 const uint8_t *	raw,
+				 unsigned int		first,
+				 unsigned int		count,
+				 unsigned int *		lock)
+{
+	unsigned int skip;
+	unsigned int cri_samples;
+	vbi_bool success;
+
+	assert (NULL != bs);
+	assert (NULL != buffer);
+	assert (NULL != raw);
+	assert (NULL != lock);
+
+	if (bs->payload > buffer_size * 8) {
+		warning (&bs->log,
+			 "buffer_size %u < %u bits of payload.",
+			 buffer_size * 8, bs->payload);
+		return FALSE;
+	}
+
+	skip = bs->skip;
+	cri_samples = bs->cri_samples;
+
+	if (first >= cri_samples)
+		return FALSE;
+
+	/* CRI, FRC and payload still fit. */
+	bs->skip += first * bs->bytes_per_sample;
+	bs->cri_samples = MIN (count, cri_samples - first);
+
+	success = bs->func (bs, buffer,
+			    /* points */ NULL,
+			    /* n_points */ NULL,
+			    raw);
+
+	bs->skip = skip;
+	bs->cri_samples = cri_samples;
+
+	if (success)
+		*lock = (bs->cri_lock - skip) / bs->bytes_per_sample;
+
+	return success;
+}
+
+/* Whether samples are bytes we can read without conversion. */
+static vbi_bool
+has_8bit_samples		(const vbi3_bit_slicer *bs)
+{
+	return (bit_slicer_Y8 == bs->func
+		|| low_pass_bit_slicer_Y8 == bs->func
+		|| bit_slicer_YUYV == bs->func
+		|| bit_slicer_RGB24_LE == bs->func
+		|| bit_slicer_RGBA24_LE == bs->func);
+}
+
+/**
+ * @internal
+ * @param bs Pointer to vbi3_bit_slicer object allocated with
+ *   vbi3_bit_slicer_new(). You must also call
+ *   vbi3_bit_slicer_set_params() before calling this function.
+ * @param raw Input data.
+ * @param first First sample to examine, counting from the
+ *   @a sample_offset given to vbi3_bit_slicer_set_params().
+ * @param count Number of samples to examine.
+ *
+ * Determines the peak-to-peak amplitude of the signal in a part of
+ * the line. This is much faster than searching for a CRI, so the
+ * raw decoder uses it to skip lines which carry no signal at all.
+ *
+ * @returns
+ * Amplitude in range 0 to 255. For sample formats with less than
+ * eight bits of luma or green the function returns 255.
+ */
+unsigned int
+_vbi3_bit_slicer_amplitude	(const vbi3_bit_slicer *bs,
+				 const uint8_t *	raw,
+				 unsigned int		first,
+				 unsigned int		count)
+{
+	const uint8_t *end;
+	unsigned int bps;
+	unsigned int min;
+	unsigned int max;
+
+	assert (NULL != bs);
+	assert (NULL != raw);
+
+	if (!has_8bit_samples (bs))
+		return 255;
+
+	if (first >= bs->cri_samples)
+		return 0;
+
+	count = MIN (count, bs->cri_samples - first);
+
+	bps = bs->bytes_per_sample;
+	raw += bs->skip + first * bps;
+	end = raw + count * bps;
+
+	min = 255;
+	max = 0;
+
+	for (; raw < end; raw += bps) {
+		unsigned int r = *raw;
+
+		min = MIN (min, r);
+		max = MAX (max, r);
+	}
+
+	return (max >= min) ? max - min : 0;
+}
+
+/**
+ * @internal
+ * @param bs Pointer to vbi3_bit_slicer object allocated with
+ *   vbi3_bit_slicer_new().
+ * @param raw The input data passed to the last successful call of
+ *   vbi3_bit_slicer_slice() or _vbi3_bit_slicer_slice_window().
+ * @param max_bits Examine at most this number of payload bits.
+ * @param eye The eye opening, the distance between the lowest
+ *   '1' and the highest '0' sample, is stored here in percent of
+ *   @a amplitude.
+ * @param amplitude The difference between the average level of
+ *   '1' and '0' samples is stored here, in range 0 to 255.
+ *
+ * Measures the quality of the signal the bit slicer decoded last,
+ * sampling the payload bits again. The FRC is skipped.
+ *
+ * @returns
+ * @c FALSE if the sample format has less than eight bits of luma
+ * or green, or all examined bits had the same value.
+ */
+vbi_bool
+_vbi3_bit_slicer_eye		(const vbi3_bit_slicer *bs,
+				 const uint8_t *	raw,
+				 unsigned int		max_bits,
+				 unsigned int *		eye,
+				 unsigned int *		amplitude)
+{
+	uint8_t level[64];
+	unsigned int n_bits;
+	unsigned int bps;
+	unsigned int i, k;
+	unsigned int min, max, mid;
+	unsigned int hi_min, hi_sum, n_hi;
+	unsigned int lo_max, lo_sum, n_lo;
+
+	assert (NULL != bs);
+	assert (NULL != raw);
+	assert (NULL != eye);
+	assert (NULL != amplitude);
+
+	if (!has_8bit_samples (bs))
+		return FALSE;
+
+	n_bits = (bs->endian >= 2) ? bs->payload : bs->payload * 8;
+	n_bits = MIN (n_bits, MIN (max_bits,
+				   (unsigned int) N_ELEMENTS (level)));
+
+	bps = bs->bytes_per_sample;
+
+	raw += bs->cri_lock;
+	if (low_pass_bit_slicer_Y8 == bs->func) {
+		/* Center of the averaged samples. */
+		raw += (1 << (LP_AVG - 1)) * bps;
+	}
+
+	min = 255;
+	max = 0;
+
+	/* Current bit position << 8. Like PAYLOAD() we start at the
+	   CRI lock position, but skip the FRC bits. */
+	i = bs->phase_shift + bs->frc_bits * bs->step;
+
+	for (k = 0; k < n_bits; ++k) {
+		const uint8_t *r = raw + (i >> 8) * bps;
+		unsigned int l;
+
+		/* Linear interpolated as in SAMPLE(). */
+		l = (r[0] * (256 - (i & 255)) + r[bps] * (i & 255)) >> 8;
+
+		level[k] = l;
+		min = MIN (min, l);
+		max = MAX (max, l);
+
+		i += bs->step;
+	}
+
+	mid = (min + max + 1) >> 1;
+
+	hi_min = 255;
+	hi_sum = 0;
+	n_hi = 0;
+
+	lo_max = 0;
+	lo_sum = 0;
+	n_lo = 0;
+
+	for (k = 0; k < n_bits; ++k) {
+		unsigned int l = level[k];
+
+		if (l >= mid) {
+			hi_min = MIN (hi_min, l);
+			hi_sum += l;
+			++n_hi;
+		} else {
+			lo_max = MAX (lo_max, l);
+			lo_sum += l;
+			++n_lo;
+		}
+	}
+
+	if (0 == n_hi || 0 == n_lo)
+		return FALSE;
+
+	*amplitude = hi_sum / n_hi - lo_sum / n_lo;
+	if (0 == *amplitude)
+		return FALSE;
+
+	*eye = MIN ((hi_min - lo_max) * 100 / *amplitude, 100U);
+
+	return TRUE;
+}
+
 /**
  * @param bs Pointer to vbi3_bit_slicer object allocated with
  *   vbi3_bit_slicer_new().
@@ -1034,6 +1288,7 @@ vbi3_bit_slicer_set_params	(vbi3_bit_slicer *	bs,
 	cri_end = MIN (cri_end, samples_per_line - data_samples);
 
 	bs->cri_samples = cri_end - sample_offset;
+	bs->cri_span = cri_samples;
 	bs->cri_rate = cri_rate;
 
 	bs->oversampling_rate = sampling_rate * oversampling;
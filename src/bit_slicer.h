@@ -160,6 +160,8 @@ struct _vbi3_bit_slicer {
 	unsigned int		thresh;
 	unsigned int		thresh_frac;
 	unsigned int		cri_samples;
+	unsigned int		cri_span;	/* samples of cri_bits */
+	unsigned int		cri_lock;	/* byte offset of last match */
 	unsigned int		cri_rate;
 	unsigned int		oversampling_rate;
 	unsigned int		phase_shift;
@@ -182,6 +184,28 @@ _vbi3_bit_slicer_destroy	(vbi3_bit_slicer *	bs)
 extern vbi_bool
 _vbi3_bit_slicer_init		(vbi3_bit_slicer *	bs)
   _vbi_nonnull ((1));
+extern vbi_bool
+_vbi3_bit_slicer_slice_window	(vbi3_bit_slicer *	bs,
+				 uint8_t *		buffer,
+				 unsigned int		buffer_size,
+				 const uint8_t *	raw,
+				 unsigned int		first,
+				 unsigned int		count,
+				 unsigned int *		lock)
+  _vbi_nonnull ((1, 2, 4, 7));
+extern unsigned int
+_vbi3_bit_slicer_amplitude	(const vbi3_bit_slicer *bs,
+				 const uint8_t *	raw,
+				 unsigned int		first,
+				 unsigned int		count)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+_vbi3_bit_slicer_eye		(const vbi3_bit_slicer *bs,
+				 const uint8_t *	raw,
+				 unsigned int		max_bits,
+				 unsigned int *		eye,
+				 unsigned int *		amplitude)
+  _vbi_nonnull ((1, 2, 4, 5));
 
 /** @} */
 
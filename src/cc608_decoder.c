@@ -28,6 +28,8 @@
 #  include "config.h"
 #endif
 
+#include <pthread.h>
+
 #include "hamm.h"
 #include "lang.h"
 #include "conv.h"
@@ -182,7 +184,7 @@ struct _vbi_cc608_decoder {
 	 * Caption control codes (two bytes) may repeat once for error
 	 * correction. -1 if no repeated control code can be expected.
 	 */
-	int			expect_ctrl[MAX_FIELDS][2];
+	int			expect_ctrl[MAX_FIELDS];
 
 	/**
 	 * Receiving XDS data, as opposed to caption / ITV data.
@@ -1734,134 +1736,169 @@ switch_channel			(_vbi_cc608_decoder *	cd,
 	return new_ch;
 }
 
-/* Note ch is invalid if UNKNOWN_CHANNEL == cd->cc.curr_ch_num[f]. */
-static void
-misc_control_code		(_vbi_cc608_decoder *	cd,
-				 struct channel *	ch,
-				 unsigned int		c2,
-				 unsigned int		ch_num0,
-				 enum field_num		f)
-{
-	unsigned int new_ch_num;
-
-	/* Misc Control Codes -- 001 c10f  010 xxxx */
-
-	/* c = channel (0 -> CC1/CC3/T1/T3, 1 -> CC2/CC4/T2/T4)
-	     -- 47 CFR Section 15.119, EIA 608-B Section 7.7.
-	   f = field (0 -> F1, 1 -> F2)
-	     -- EIA 608-B Section 8.4, 8.5. */
-
-	/* XXX The f flag is intended to detect accidential field
-	   swapping and we should use it for that purpose. */
-
-	switch (c2 & 15) {
-	case 0:	/* RCL Resume Caption Loading -- 001 c10f  010 0000 */
-		/* 47 CFR 15.119 (f)(2) and EIA 608-B Section 7.7. */
-		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
-		ch = switch_channel (cd, ch, new_ch_num, f);
-		resume_caption_loading (cd, ch);
-		break;
-
-	case 1: /* BS Backspace -- 001 c10f  010 0001 */
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
-		    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
-			break;
-		backspace (cd, ch);
-		break;
-
-	case 2: /* reserved (formerly AOF Alarm Off) */
-	case 3: /* reserved (formerly AON Alarm On) */
-		break;
-
-	case 4: /* DER Delete To End Of Row -- 001 c10f  010 0100 */
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
-		    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
-			break;
-		delete_to_end_of_row (cd, ch);
-		break;
-
-	case 5: /* RU2 */
-	case 6: /* RU3 */
-	case 7: /* RU4 Roll-Up Captions -- 001 c10f  010 01xx */
-		/* 47 CFR 15.119 (f)(1) and EIA 608-B Section 7.7. */
-		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
-		ch = switch_channel (cd, ch, new_ch_num, f);
-		roll_up_caption (cd, ch, c2);
-		break;
+/* Actions on a Closed Caption byte pair, see pair_action[]. */
+enum pair_action {
+	/* Parity error in the first byte. */
+	ACTION_PARITY_ERROR,
+
+	/* Caption control code with parity error or invalid second
+	   byte. */
+	ACTION_BAD_CONTROL_CODE,
+
+	/* Two characters. The first byte is 0x00 or 0x20 ... 0x7F,
+	   the second byte may have a parity error. */
+	ACTION_CHARACTERS,
+
+	/* The first byte is 0x01 ... 0x0F. On field 1 this byte is
+	   ignored and the second byte is a character, on field 2
+	   the pair starts, continues or terminates an XDS packet. */
+	ACTION_XDS_OR_CHARACTER,
+
+	/* Caption control codes -- 001 cxxx  01x xxxx. */
+
+	/* Undefined and reserved codes. */
+	ACTION_UNDEFINED,
+
+	/* Preamble Address Codes -- 001 crrr  1ri xxxu */
+	ACTION_PAC,
+
+	/* Backgr. Attr. Codes -- 001 c000  010 xxxt */
+	ACTION_BACKGROUND_ATTR,
+
+	/* Mid-Row Codes -- 001 c001  010 xxxu */
+	ACTION_MID_ROW,
+
+	/* Special Characters -- 001 c001  011 xxxx */
+	ACTION_SPECIAL_CHAR,
+	ACTION_TRANSPARENT_SPACE,
+
+	/* Extended Character Set -- 001 c01x  01x xxxx */
+	ACTION_EXT_CHAR,
+
+	/* Misc. Control Codes -- 001 c10f  010 xxxx */
+	ACTION_RCL,
+	ACTION_BS,
+	ACTION_DER,
+	ACTION_RU,
+	ACTION_FON,
+	ACTION_RDC,
+	ACTION_TR,
+	ACTION_RTD,
+	ACTION_EDM,
+	ACTION_CR,
+	ACTION_ENM,
+	ACTION_EOC,
+
+	/* Extended control codes -- 001 c111  01x xxxx */
+	ACTION_EXT_CONTROL
+};
 
-	case 8: /* FON Flash On -- 001 c10f  010 1000 */
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
-		    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
-			break;
+/* Misc. Control Codes -- 001 c10f  010 xxxx */
+static const uint8_t
+misc_action [16] = {
+	ACTION_RCL,		/* Resume Caption Loading */
+	ACTION_BS,		/* Backspace */
+	ACTION_UNDEFINED,	/* reserved (formerly AOF Alarm Off) */
+	ACTION_UNDEFINED,	/* reserved (formerly AON Alarm On) */
+	ACTION_DER,		/* Delete To End Of Row */
+	ACTION_RU,		/* RU2 Roll-Up Captions */
+	ACTION_RU,		/* RU3 */
+	ACTION_RU,		/* RU4 */
+	ACTION_FON,		/* Flash On */
+	ACTION_RDC,		/* Resume Direct Captioning */
+	ACTION_TR,		/* Text Restart */
+	ACTION_RTD,		/* Resume Text Display */
+	ACTION_EDM,		/* Erase Displayed Memory */
+	ACTION_CR,		/* Carriage Return */
+	ACTION_ENM,		/* Erase Non-Displayed Memory */
+	ACTION_EOC		/* End Of Caption */
+};
 
-		/* 47 CFR 15.119 (h)(1)(i): Spacing attribute. */
-		put_char (cd, ch, 0x1428,
-			  /* displayable */ FALSE,
-			  /* backspace */ FALSE);
-		break;
+/* The action for each byte pair as received, with parity bits, the
+   first byte in the high bits of the index. This replaces several
+   levels of branches for each byte pair by a single lookup and
+   switch. The channel and field number do not change the action,
+   they are evaluated when the action is performed. */
+static uint8_t			pair_action [1 << 16];
 
-	case 9: /* RDC Resume Direct Captioning -- 001 c10f  010 1001 */
-		/* 47 CFR 15.119 (f)(3) and EIA 608-B Section 7.7. */
-		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
-		ch = switch_channel (cd, ch, new_ch_num, f);
-		resume_direct_captioning (cd, ch);
-		break;
+static pthread_once_t		pair_action_once = PTHREAD_ONCE_INIT;
 
-	case 10: /* TR Text Restart -- 001 c10f  010 1010 */
-		/* EIA 608-B Section 7.4. */
-		new_ch_num = VBI_CAPTION_T1 + (ch_num0 & 3);
-		ch = switch_channel (cd, ch, new_ch_num, f);
-		text_restart (cd, ch);
-		break;
+static enum pair_action
+control_code_action		(unsigned int		c1,
+				 unsigned int		c2)
+{
+	if (c2 >= 0x40) {
+		/* Preamble Address Codes -- 001 crrr  1ri xxxu */
+		if (pac_row_map[(c1 & 7) * 2 + ((c2 >> 5) & 1)] < 0)
+			return ACTION_UNDEFINED;
+		return ACTION_PAC;
+	}
 
-	case 11: /* RTD Resume Text Display -- 001 c10f  010 1011 */
-		/* EIA 608-B Section 7.4. */
-		new_ch_num = VBI_CAPTION_T1 + (ch_num0 & 3);
-		ch = switch_channel (cd, ch, new_ch_num, f);
-		/* ch->mode is invariably VBI_CC608_MODE_TEXT. */
+	switch (c1 & 7) {
+	case 0:
+		if (c2 < 0x30)
+			return ACTION_BACKGROUND_ATTR;
 		break;
 
-	case 12: /* EDM Erase Displayed Memory -- 001 c10f  010 1100 */
-		/* 47 CFR 15.119 (f). EIA 608-B Section 7.7 and Annex
-		   B.7: "[The] command shall be acted upon as
-		   appropriate for caption processing without
-		   terminating the Text Mode data stream." */
-
-		/* We need not check cd->curr_ch_num because bit 2 is
-		   implied, bit 1 is the known field number and bit 0
-		   is coded in the control code. */
-		ch = &cd->channel[ch_num0 & 3];
+	case 1:
+		if (c2 < 0x30)
+			return ACTION_MID_ROW;
+		else if (0x39 == c2)
+			return ACTION_TRANSPARENT_SPACE;
+		else
+			return ACTION_SPECIAL_CHAR;
 
-		erase_displayed_memory (cd, ch);
+	case 2:
+	case 3:
+		return ACTION_EXT_CHAR;
 
+	case 4:
+	case 5:
+		if (c2 < 0x30)
+			return misc_action[c2 & 15];
 		break;
 
-	case 13: /* CR Carriage Return -- 001 c10f  010 1101 */
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f])
-			break;
-		carriage_return (cd, ch);
+	case 6: /* reserved */
 		break;
 
-	case 14: /* ENM Erase Non-Displayed Memory -- 001 c10f  010 1110 */
-		/* 47 CFR 15.119 (f)(2)(v). EIA 608-B Section 7.7 and
-		   Annex B.7: "[The] command shall be acted upon as
-		   appropriate for caption processing without
-		   terminating the Text Mode data stream." */
+	case 7:
+		return ACTION_EXT_CONTROL;
+	}
 
-		/* See EDM. */
-		ch = &cd->channel[ch_num0 & 3];
+	return ACTION_UNDEFINED;
+}
 
-		erase_memory (cd, ch, ch->displayed_buffer ^ 1);
+static void
+init_pair_action		(void)
+{
+	unsigned int i;
 
-		break;
+	for (i = 0; i < N_ELEMENTS (pair_action); ++i) {
+		enum pair_action action;
+		int c1, c2;
+
+		c1 = vbi_unpar8 (i >> 8);
+		c2 = vbi_unpar8 (i & 0xFF);
+
+		if (c1 < 0) {
+			action = ACTION_PARITY_ERROR;
+		} else if (c1 >= 0x10 && c1 < 0x20) {
+			/* 47 CFR Section 15.119 (i)(1), (i)(2). */
+			if (c2 < 0x20) {
+				/* Parity error or invalid control
+				   code. Let's hope this code will
+				   repeat. */
+				action = ACTION_BAD_CONTROL_CODE;
+			} else {
+				action = control_code_action (c1, c2);
+			}
+		} else if (c1 >= 0x01 && c1 < 0x10) {
+			action = ACTION_XDS_OR_CHARACTER;
+		} else {
+			action = ACTION_CHARACTERS;
+		}
 
-	case 15: /* EOC End Of Caption -- 001 c10f  010 1111 */
-		/* 47 CFR 15.119 (f), (f)(2), (f)(3)(iv) and EIA 608-B
-		   Section 7.7, Annex C.11. */
-		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
-		ch = switch_channel (cd, ch, new_ch_num, f);
-		end_of_caption (cd, ch);
-		break;
+		pair_action[i] = action;
 	}
 }
 
@@ -1992,12 +2029,14 @@ preamble_address_code		(_vbi_cc608_decoder *	cd,
 
 static void
 control_code			(_vbi_cc608_decoder *	cd,
+				 enum pair_action	action,
 				 unsigned int		c1,
 				 unsigned int		c2,
 				 enum field_num		f)
 {
 	struct channel *ch;
 	unsigned int ch_num0;
+	unsigned int new_ch_num;
 
 	if (CC608_DECODER_LOG_INPUT) {
 		fprintf (stdout, "%s:%u: %s c1=%02x c2=%02x f=%d\n",
@@ -2016,91 +2055,162 @@ control_code			(_vbi_cc608_decoder *	cd,
 	   cd->curr_ch_num[f]. */
 	ch = &cd->channel[ch_num0];
 
-	if (c2 >= 0x40) {
-		/* Preamble Address Codes -- 001 crrr  1ri xxxu */
+	/* In Misc. Control Codes -- 001 c10f  010 xxxx
+	   c = channel (0 -> CC1/CC3/T1/T3, 1 -> CC2/CC4/T2/T4)
+	     -- 47 CFR Section 15.119, EIA 608-B Section 7.7.
+	   f = field (0 -> F1, 1 -> F2)
+	     -- EIA 608-B Section 8.4, 8.5. */
+
+	/* XXX The f flag is intended to detect accidential field
+	   swapping and we should use it for that purpose. */
+
+	switch (action) {
+	case ACTION_PAC:
 		if (UNKNOWN_CHANNEL != cd->curr_ch_num[f])
 			preamble_address_code (cd, ch, c1, c2);
 		return;
-	}
 
-	switch (c1 & 7) {
-	case 0:
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
-		    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
-			break;
+	case ACTION_RCL: /* Resume Caption Loading -- 001 c10f  010 0000 */
+		/* 47 CFR 15.119 (f)(2) and EIA 608-B Section 7.7. */
+		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
+		ch = switch_channel (cd, ch, new_ch_num, f);
+		resume_caption_loading (cd, ch);
+		return;
 
-		if (c2 < 0x30) {
-			/* Backgr. Attr. Codes -- 001 c000  010 xxxt */
-			/* EIA 608-B Section 6.2. */
-			put_char (cd, ch, 0x1000 | c2,
-				  /* displayable */ FALSE,
-				  /* backspace */ TRUE);
-		} else {
-			/* Undefined. */
-		}
+	case ACTION_RU: /* Roll-Up Captions -- 001 c10f  010 01xx */
+		/* 47 CFR 15.119 (f)(1) and EIA 608-B Section 7.7. */
+		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
+		ch = switch_channel (cd, ch, new_ch_num, f);
+		roll_up_caption (cd, ch, c2);
+		return;
+
+	case ACTION_RDC: /* Resume Direct Captioning -- 001 c10f  010 1001 */
+		/* 47 CFR 15.119 (f)(3) and EIA 608-B Section 7.7. */
+		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
+		ch = switch_channel (cd, ch, new_ch_num, f);
+		resume_direct_captioning (cd, ch);
+		return;
+
+	case ACTION_TR: /* Text Restart -- 001 c10f  010 1010 */
+		/* EIA 608-B Section 7.4. */
+		new_ch_num = VBI_CAPTION_T1 + (ch_num0 & 3);
+		ch = switch_channel (cd, ch, new_ch_num, f);
+		text_restart (cd, ch);
+		return;
 
+	case ACTION_RTD: /* Resume Text Display -- 001 c10f  010 1011 */
+		/* EIA 608-B Section 7.4. */
+		new_ch_num = VBI_CAPTION_T1 + (ch_num0 & 3);
+		ch = switch_channel (cd, ch, new_ch_num, f);
+		/* ch->mode is invariably VBI_CC608_MODE_TEXT. */
+		return;
+
+	case ACTION_EDM: /* Erase Displayed Memory -- 001 c10f  010 1100 */
+		/* 47 CFR 15.119 (f). EIA 608-B Section 7.7 and Annex
+		   B.7: "[The] command shall be acted upon as
+		   appropriate for caption processing without
+		   terminating the Text Mode data stream." */
+
+		/* We need not check cd->curr_ch_num because bit 2 is
+		   implied, bit 1 is the known field number and bit 0
+		   is coded in the control code. */
+		ch = &cd->channel[ch_num0 & 3];
+
+		erase_displayed_memory (cd, ch);
+
+		return;
+
+	case ACTION_CR: /* Carriage Return -- 001 c10f  010 1101 */
+		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f])
+			return;
+		carriage_return (cd, ch);
+		return;
+
+	case ACTION_ENM: /* Erase Non-Displayed Memory -- 001 c10f  010 1110 */
+		/* 47 CFR 15.119 (f)(2)(v). EIA 608-B Section 7.7 and
+		   Annex B.7: "[The] command shall be acted upon as
+		   appropriate for caption processing without
+		   terminating the Text Mode data stream." */
+
+		/* See EDM. */
+		ch = &cd->channel[ch_num0 & 3];
+
+		erase_memory (cd, ch, ch->displayed_buffer ^ 1);
+
+		return;
+
+	case ACTION_EOC: /* End Of Caption -- 001 c10f  010 1111 */
+		/* 47 CFR 15.119 (f), (f)(2), (f)(3)(iv) and EIA 608-B
+		   Section 7.7, Annex C.11. */
+		new_ch_num = VBI_CAPTION_CC1 + (ch_num0 & 3);
+		ch = switch_channel (cd, ch, new_ch_num, f);
+		end_of_caption (cd, ch);
+		return;
+
+	default:
 		break;
+	}
 
-	case 1:
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
-		    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
-			break;
+	/* The remaining codes apply to the current channel. */
+	if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
+	    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
+		return;
 
-		if (c2 < 0x30) {
-			/* Mid-Row Codes -- 001 c001  010 xxxu */
-			/* 47 CFR 15.119 (h)(1)(i): Spacing attribute. */
-			put_char (cd, ch, 0x1100 | c2,
-				  /* displayable */ FALSE,
-				  /* backspace */ FALSE);
-		} else {
-			/* Special Characters -- 001 c001  011 xxxx */
-			if (0x39 == c2) {
-				/* Transparent space. */
-				put_char (cd, ch, 0,
-					  /* displayable */ FALSE,
-					  /* backspace */ FALSE);
-			} else {
-				put_char (cd, ch, 0x1100 | c2,
-					  /* displayable */ TRUE,
-					  /* backspace */ FALSE);
-			}
-		}
+	switch (action) {
+	case ACTION_BACKGROUND_ATTR:
+		/* EIA 608-B Section 6.2. */
+		put_char (cd, ch, 0x1000 | c2,
+			  /* displayable */ FALSE,
+			  /* backspace */ TRUE);
+		break;
 
+	case ACTION_MID_ROW:
+		/* 47 CFR 15.119 (h)(1)(i): Spacing attribute. */
+		put_char (cd, ch, 0x1100 | c2,
+			  /* displayable */ FALSE,
+			  /* backspace */ FALSE);
 		break;
 
-	case 2:
-	case 3: /* Extended Character Set -- 001 c01x  01x xxxx */
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
-		    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
-			break;
+	case ACTION_SPECIAL_CHAR:
+		put_char (cd, ch, 0x1100 | c2,
+			  /* displayable */ TRUE,
+			  /* backspace */ FALSE);
+		break;
+
+	case ACTION_TRANSPARENT_SPACE:
+		put_char (cd, ch, 0,
+			  /* displayable */ FALSE,
+			  /* backspace */ FALSE);
+		break;
 
+	case ACTION_EXT_CHAR:
 		/* EIA 608-B Section 6.4.2. */
 		put_char (cd, ch, (c1 * 256 + c2) & 0x777F,
 			  /* displayable */ TRUE,
 			  /* backspace */ TRUE);
 		break;
 
-	case 4:
-	case 5:
-		if (c2 < 0x30) {
-			/* Misc. Control Codes -- 001 c10f  010 xxxx */
-			misc_control_code (cd, ch, c2, ch_num0, f);
-		} else {
-			/* Undefined. */
-		}
-
+	case ACTION_BS: /* Backspace -- 001 c10f  010 0001 */
+		backspace (cd, ch);
 		break;
 
-	case 6: /* reserved */
+	case ACTION_DER: /* Delete To End Of Row -- 001 c10f  010 0100 */
+		delete_to_end_of_row (cd, ch);
 		break;
 
-	case 7:	/* Extended control codes -- 001 c111  01x xxxx */
-		if (UNKNOWN_CHANNEL == cd->curr_ch_num[f]
-		    || _VBI_CC608_MODE_UNKNOWN == ch->mode)
-			break;
+	case ACTION_FON: /* Flash On -- 001 c10f  010 1000 */
+		/* 47 CFR 15.119 (h)(1)(i): Spacing attribute. */
+		put_char (cd, ch, 0x1428,
+			  /* displayable */ FALSE,
+			  /* backspace */ FALSE);
+		break;
 
+	case ACTION_EXT_CONTROL:
 		ext_control_code (cd, ch, c2);
+		break;
 
+	default:
+		/* Undefined. */
 		break;
 	}
 }
@@ -2176,7 +2286,9 @@ _vbi_cc608_decoder_feed		(_vbi_cc608_decoder *	cd,
 				 double			capture_time,
 				 int64_t		pts)
 {
-	int c1, c2;
+	enum pair_action action;
+	unsigned int code;
+	unsigned int c1;
 	enum field_num f;
 	vbi_bool all_successful;
 
@@ -2224,8 +2336,7 @@ _vbi_cc608_decoder_feed		(_vbi_cc608_decoder *	cd,
 		_vbi_cc608_dump (stderr, buffer[0], buffer[1]);
 	}
 
-	c1 = vbi_unpar8 (buffer[0]);
-	c2 = vbi_unpar8 (buffer[1]);
+	code = buffer[0] * 256 + buffer[1];
 
 	all_successful = TRUE;
 
@@ -2233,30 +2344,60 @@ _vbi_cc608_decoder_feed		(_vbi_cc608_decoder *	cd,
 	   control codes on field 2 may repeat as on field 1. Section
 	   8.6.2: XDS control codes shall not repeat. */
 
-	if (unlikely (c1 < 0)) {
-		goto parity_error;
-	} else if (c1 == cd->expect_ctrl[f][0]
-		   && c2 == cd->expect_ctrl[f][1]) {
+	if (code == cd->expect_ctrl[f]) {
 		/* Already acted upon. */
-		cd->expect_ctrl[f][0] = -1;
+		cd->expect_ctrl[f] = -1;
 		goto finish;
 	}
 
-	if (c1 >= 0x10 && c1 < 0x20) {
+	action = pair_action[code];
+
+	c1 = buffer[0] & 0x7F;
+
+	switch (action) {
+	case ACTION_PARITY_ERROR:
+		goto parity_error;
+
+	case ACTION_BAD_CONTROL_CODE:
+		cd->in_xds[f] = FALSE;
+		goto parity_error;
+
+	case ACTION_CHARACTERS:
+		break;
+
+	case ACTION_XDS_OR_CHARACTER:
+		if (FIELD_1 == f) {
+			/* 47 CFR Section 15.119 (i)(1): "If the
+			   non-printing character in the pair is
+			   in the range 00h to 0Fh, that character
+			   alone will be ignored and the second
+			   character will be treated normally." */
+			c1 = 0;
+		} else if (0x0F == c1) {
+			/* XDS packet terminator. */
+			cd->in_xds[FIELD_2] = FALSE;
+			cd->expect_ctrl[f] = -1;
+			goto finish;
+		} else {
+			/* XDS packet start or continuation.
+			   EIA 608-B Section 7.7, 8.5: Also
+			   interrupts a Text mode
+			   transmission. */
+			cd->in_xds[FIELD_2] = TRUE;
+			cd->expect_ctrl[f] = -1;
+			goto finish;
+		}
+
+		break;
+
+	default:
 		/* Caption control code. */
 
 		/* There's no XDS on field 1, we just
 		   use an array to save a branch. */
 		cd->in_xds[f] = FALSE;
 
-		/* 47 CFR Section 15.119 (i)(1), (i)(2). */
-		if (c2 < 0x20) {
-			/* Parity error or invalid control code.
-			   Let's hope this code will repeat. */
-			goto parity_error;
-		}
-
-		control_code (cd, c1, c2, f);
+		control_code (cd, action, c1, buffer[1] & 0x7F, f);
 
 		if (cd->event_pending) {
 			display_event (cd, cd->event_pending,
@@ -2264,52 +2405,32 @@ _vbi_cc608_decoder_feed		(_vbi_cc608_decoder *	cd,
 			cd->event_pending = NULL;
 		}
 
-		cd->expect_ctrl[f][0] = c1;
-		cd->expect_ctrl[f][1] = c2;
-	} else {
-		cd->expect_ctrl[f][0] = -1;
-
-		if (c1 < 0x10) {
-			if (FIELD_1 == f) {
-				/* 47 CFR Section 15.119 (i)(1): "If the
-				   non-printing character in the pair is
-				   in the range 00h to 0Fh, that character
-				   alone will be ignored and the second
-				   character will be treated normally." */
-				c1 = 0;
-			} else if (0x0F == c1) {
-				/* XDS packet terminator. */
-				cd->in_xds[FIELD_2] = FALSE;
-				goto finish;
-			} else if (c1 >= 0x01) {
-				/* XDS packet start or continuation.
-				   EIA 608-B Section 7.7, 8.5: Also
-				   interrupts a Text mode
-				   transmission. */
-				cd->in_xds[FIELD_2] = TRUE;
-				goto finish;
-			}
-		}
+		cd->expect_ctrl[f] = code;
 
-		{
-			struct channel *ch;
-			vbi_pgno ch_num;
+		goto finish;
+	}
 
-			ch_num = cd->curr_ch_num[f];
-			if (UNKNOWN_CHANNEL == ch_num)
-				goto finish;
+	cd->expect_ctrl[f] = -1;
 
-			ch_num = ((ch_num - VBI_CAPTION_CC1) & 5) + f * 2;
-			ch = &cd->channel[ch_num];
+	{
+		struct channel *ch;
+		vbi_pgno ch_num;
 
-			all_successful &= characters (cd, ch, c1);
-			all_successful &= characters (cd, ch, c2);
+		ch_num = cd->curr_ch_num[f];
+		if (UNKNOWN_CHANNEL == ch_num)
+			goto finish;
 
-			if (cd->event_pending) {
-				display_event (cd, cd->event_pending,
-					       /* flags */ 0);
-				cd->event_pending = NULL;
-			}
+		ch_num = ((ch_num - VBI_CAPTION_CC1) & 5) + f * 2;
+		ch = &cd->channel[ch_num];
+
+		all_successful &= characters (cd, ch, c1);
+		all_successful &= characters (cd, ch,
+					      vbi_unpar8 (buffer[1]));
+
+		if (cd->event_pending) {
+			display_event (cd, cd->event_pending,
+				       /* flags */ 0);
+			cd->event_pending = NULL;
 		}
 	}
 
@@ -2319,7 +2440,7 @@ _vbi_cc608_decoder_feed		(_vbi_cc608_decoder *	cd,
 	return all_successful;
 
  parity_error:
-	cd->expect_ctrl[f][0] = -1;
+	cd->expect_ctrl[f] = -1;
 
 	/* XXX Some networks stupidly transmit 0x0000 instead of
 	   0x8080 as filler. Perhaps we shouldn't take that as a
@@ -2520,6 +2641,8 @@ _vbi_cc608_decoder_init		(_vbi_cc608_decoder *	cd)
 {
 	assert (NULL != cd);
 
+	pthread_once (&pair_action_once, init_pair_action);
+
 	CLEAR (*cd);
 
 	_vbi_event_handler_list_init (&cd->handlers);
@@ -266,6 +266,18 @@ _vbi_iconv_open			(const char *		dst_codeset,
 	return cd;
 }
 
+/** @internal */
+static int
+codeset_char			(int			c)
+{
+	/* Not tolower(), codeset names are ASCII regardless
+	   of the locale. */
+	if (c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+	else
+		return c;
+}
+
 /** @internal */
 static vbi_bool
 same_codeset			(const char *		dst_codeset,
@@ -277,8 +289,8 @@ same_codeset			(const char *		dst_codeset,
 	for (;;) {
 		char d, s;
 
-		d = *dst_codeset;
-		s = *src_codeset;
+		d = codeset_char (*dst_codeset);
+		s = codeset_char (*src_codeset);
 
 		if (d == s) {
 			if (0 == d)
@@ -296,6 +308,248 @@ same_codeset			(const char *		dst_codeset,
 	}
 }
 
+/**
+ * @internal
+ * @param codeset Character set name for iconv() conversion,
+ *   for example "ISO-8859-1". When @c NULL the default is UTF-8.
+ *
+ * Identifies the character sets _vbi_convert_ucs2() can convert to
+ * without iconv().
+ *
+ * @returns
+ * A _vbi_codeset, @c _VBI_CODESET_UNKNOWN if iconv() is needed.
+ *
+ * @since 0.2.36
+ */
+_vbi_codeset
+_vbi_codeset_from_name		(const char *		codeset)
+{
+	static const struct {
+		const char *		name;
+		_vbi_codeset		codeset;
+	} names[] = {
+		{ "UTF8",		_VBI_CODESET_UTF8 },
+		{ "ASCII",		_VBI_CODESET_ASCII },
+		{ "US-ASCII",		_VBI_CODESET_ASCII },
+		{ "ANSI_X3.4-1968",	_VBI_CODESET_ASCII },
+		{ "ISO-8859-1",		_VBI_CODESET_LATIN1 },
+		{ "ISO_8859-1",		_VBI_CODESET_LATIN1 },
+		{ "LATIN1",		_VBI_CODESET_LATIN1 },
+		{ "UCS-2",		_VBI_CODESET_UCS2 },
+		{ "UTF-16LE",		_VBI_CODESET_UTF16LE },
+		{ "UCS-2LE",		_VBI_CODESET_UTF16LE },
+		{ "UTF-16BE",		_VBI_CODESET_UTF16BE },
+		{ "UCS-2BE",		_VBI_CODESET_UTF16BE },
+	};
+	unsigned int i;
+
+	if (NULL == codeset)
+		return _VBI_CODESET_UTF8;
+
+	for (i = 0; i < N_ELEMENTS (names); ++i) {
+		if (same_codeset (codeset, names[i].name))
+			return names[i].codeset;
+	}
+
+	return _VBI_CODESET_UNKNOWN;
+}
+
+/**
+ * @internal
+ * @param dst_codeset Target character set.
+ * @param src_length Number of characters to convert.
+ *
+ * @returns
+ * The number of bytes _vbi_convert_ucs2() stores at most when
+ * converting @a src_length characters.
+ *
+ * @since 0.2.36
+ */
+unsigned long
+_vbi_convert_ucs2_max_size	(_vbi_codeset		dst_codeset,
+				 unsigned long		src_length)
+{
+	switch (dst_codeset) {
+	case _VBI_CODESET_ASCII:
+	case _VBI_CODESET_LATIN1:
+		return src_length;
+
+	case _VBI_CODESET_UTF8:
+		return src_length * 3;
+
+	case _VBI_CODESET_UCS2:
+	case _VBI_CODESET_UTF16LE:
+	case _VBI_CODESET_UTF16BE:
+		return src_length * 2;
+
+	case _VBI_CODESET_UNKNOWN:
+		break;
+	}
+
+	assert (0);
+
+	return 0;
+}
+
+/** @internal */
+static char *
+convert_ucs2_utf8		(char *			d,
+				 const uint16_t *	src,
+				 const uint16_t *	end)
+{
+	while (src < end) {
+		unsigned int c;
+
+		/* Copy runs of ASCII characters four at a time. */
+		while (end - src >= 4) {
+			uint32_t w[2];
+
+			memcpy (w, src, sizeof (w));
+			if (0 != ((w[0] | w[1]) & 0xFF80FF80))
+				break;
+
+			d[0] = src[0];
+			d[1] = src[1];
+			d[2] = src[2];
+			d[3] = src[3];
+
+			d += 4;
+			src += 4;
+		}
+
+		if (src >= end)
+			break;
+
+		c = *src++;
+
+		if (c < 0x80) {
+			*d++ = c;
+		} else if (c < 0x800) {
+			d[0] = 0xC0 | (c >> 6);
+			d[1] = 0x80 | (c & 0x3F);
+			d += 2;
+		} else {
+			d[0] = 0xE0 | (c >> 12);
+			d[1] = 0x80 | ((c >> 6) & 0x3F);
+			d[2] = 0x80 | (c & 0x3F);
+			d += 3;
+		}
+	}
+
+	return d;
+}
+
+/** @internal */
+static char *
+convert_ucs2_8bit		(char *			d,
+				 const uint16_t *	src,
+				 const uint16_t *	end,
+				 unsigned int		max_char,
+				 int			repl_char)
+{
+	for (; src < end; ++src) {
+		unsigned int c = *src;
+
+		if (unlikely (c > max_char)) {
+			if ((unsigned int) repl_char - 1 >= max_char) {
+				/* No or unrepresentable replacement. */
+				errno = EILSEQ;
+				return NULL;
+			}
+
+			c = repl_char;
+		}
+
+		*d++ = c;
+	}
+
+	return d;
+}
+
+/**
+ * @internal
+ * @param dst Output buffer of at least
+ *   _vbi_convert_ucs2_max_size(@a dst_codeset, @a src_length) bytes.
+ * @param dst_codeset Target character set, not
+ *   @c _VBI_CODESET_UNKNOWN.
+ * @param src Source string in UCS-2 format.
+ * @param src_length Number of characters (not bytes) in the source
+ *   string.
+ * @param repl_char UCS-2 replacement for characters which are not
+ *   representable in @a dst_codeset. When zero the function will
+ *   fail if the source buffer contains unrepresentable characters.
+ *
+ * Converts a UCS-2 string without iconv() and without allocating
+ * memory. No terminating NUL is stored. Unlike iconv() this
+ * function never writes a byte order mark.
+ *
+ * @returns
+ * The number of bytes stored in @a dst, or -1 if the source string
+ * contains unrepresentable characters (errno EILSEQ). In this case
+ * @a dst may contain incomplete data.
+ *
+ * @since 0.2.36
+ */
+long
+_vbi_convert_ucs2		(char *			dst,
+				 _vbi_codeset		dst_codeset,
+				 const uint16_t *	src,
+				 unsigned long		src_length,
+				 int			repl_char)
+{
+	const uint16_t *end;
+	char *d;
+
+	assert (NULL != dst);
+	assert (NULL != src || 0 == src_length);
+
+	end = src + src_length;
+	d = dst;
+
+	switch (dst_codeset) {
+	case _VBI_CODESET_UTF8:
+		d = convert_ucs2_utf8 (d, src, end);
+		break;
+
+	case _VBI_CODESET_ASCII:
+		d = convert_ucs2_8bit (d, src, end, 0x7F, repl_char);
+		break;
+
+	case _VBI_CODESET_LATIN1:
+		d = convert_ucs2_8bit (d, src, end, 0xFF, repl_char);
+		break;
+
+	case _VBI_CODESET_UCS2:
+		memcpy (d, src, src_length * 2);
+		d += src_length * 2;
+		break;
+
+	case _VBI_CODESET_UTF16LE:
+		for (; src < end; ++src) {
+			d[0] = *src;
+			d[1] = *src >> 8;
+			d += 2;
+		}
+		break;
+
+	case _VBI_CODESET_UTF16BE:
+		for (; src < end; ++src) {
+			d[0] = *src >> 8;
+			d[1] = *src;
+			d += 2;
+		}
+		break;
+
+	case _VBI_CODESET_UNKNOWN:
+		assert (0);
+	}
+
+	if (NULL == d)
+		return -1;
+
+	return d - dst;
+}
+
 /**
  * @ingroup Conv
  * @param src NUL-terminated UCS-2 string.
@@ -365,29 +619,36 @@ strndup_identity		(unsigned long *	out_size,
  * @internal
  * @param out_size If not @c NULL the actual number of bytes stored
  *   in the buffer (excluding the terminating NUL) will be stored here.
+ * @param dst_codeset Target character set, not @c _VBI_CODESET_UNKNOWN.
  * @param src Source string in UCS-2 format, can be @c NULL.
  * @param src_length Number of characters (not bytes) in the source
  *   string. Can be -1 if the string is NUL terminated.
+ * @param repl_char UCS-2 replacement for characters which are not
+ *   representable in @a dst_codeset. When zero the function will
+ *   fail if the source buffer contains unrepresentable characters.
  *
- * Converts a string from UCS-2 to UTF-8 format and writes the
- * result with a terminating NUL character into a newly allocated
- * buffer. Note the buffer may be larger than necessary.
+ * Converts a string from UCS-2 format with _vbi_convert_ucs2() and
+ * writes the result with a terminating NUL character (4 bytes) into
+ * a newly allocated buffer. Note the buffer may be larger than
+ * necessary.
  *
  * @returns
  * A pointer to the allocated buffer. You must free() the buffer
  * when it is no longer needed. The function returns @c NULL when
- * it runs out of memory, or when @a src is @c NULL.
+ * the conversion fails, when it runs out of memory or when @a src
+ * is @c NULL.
  *
  * @since 0.2.23
  */
 static char *
-strndup_utf8_ucs2		(unsigned long *	out_size,
+strndup_convert_ucs2		(unsigned long *	out_size,
+				 _vbi_codeset		dst_codeset,
 				 const uint16_t *	src,
-				 long			src_length)
+				 long			src_length,
+				 int			repl_char)
 {
-	char *d;
 	char *buffer;
-	const uint16_t *end;
+	long size;
 
 	if (NULL != out_size)
 		*out_size = 0;
@@ -398,33 +659,22 @@ strndup_utf8_ucs2		(unsigned long *	out_size,
 	if (src_length < 0)
 		src_length = vbi_strlen_ucs2 (src);
 
-	buffer = vbi_malloc (src_length * 3 + 1);
+	buffer = vbi_malloc (_vbi_convert_ucs2_max_size (dst_codeset,
+							 src_length) + 4);
 	if (NULL == buffer)
 		return NULL;
 
-	d = buffer;
-
-	for (end = src + src_length; src < end; ++src) {
-		unsigned int c = *src;
-
-		if (c < 0x80) {
-			*d++ = c;
-		} else if (c < 0x800) {
-			d[0] = 0xC0 | (c >> 6);
-			d[1] = 0x80 | (c & 0x3F);
-			d += 2;
-		} else {
-			d[0] = 0xE0 | (c >> 12);
-			d[1] = 0x80 | ((c >> 6) & 0x3F);
-			d[2] = 0x80 | (c & 0x3F);
-			d += 3;
-		}
+	size = _vbi_convert_ucs2 (buffer, dst_codeset,
+				  src, src_length, repl_char);
+	if (size < 0) {
+		vbi_free (buffer);
+		return NULL;
 	}
 
 	if (NULL != out_size)
-		*out_size = d - buffer;
+		*out_size = size;
 
-	*d = 0;
+	memset (buffer + size, 0, 4);
 
 	return buffer;
 }
@@ -461,14 +711,14 @@ strndup_iconv_from_ucs2		(unsigned long *	out_size,
 				 long			src_length,
 				 int			repl_char)
 {
+	_vbi_codeset codeset;
 	char *buffer;
 	unsigned long buffer_size;
 
-	if (NULL == dst_codeset || same_codeset (dst_codeset, "UTF8")) {
-		return strndup_utf8_ucs2 (out_size, src, src_length);
-	} else if (same_codeset (dst_codeset, "UCS2")) {
-		return strndup_identity (out_size, (const char *) src,
-					 src_length * 2);
+	codeset = _vbi_codeset_from_name (dst_codeset);
+	if (_VBI_CODESET_UNKNOWN != codeset) {
+		return strndup_convert_ucs2 (out_size, codeset,
+					     src, src_length, repl_char);
 	}
 
 	if (NULL != out_size)
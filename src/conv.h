@@ -101,6 +101,34 @@ vbi_locale_codeset		(void);
 
 typedef struct _vbi_iconv_t vbi_iconv_t;
 
+/**
+ * @internal
+ * Character sets _vbi_convert_ucs2() converts to without iconv().
+ */
+typedef enum {
+	_VBI_CODESET_UNKNOWN = 0,
+	_VBI_CODESET_UTF8,
+	_VBI_CODESET_ASCII,
+	_VBI_CODESET_LATIN1,
+	/** Host byte order, like the iconv() "UCS-2" codeset. */
+	_VBI_CODESET_UCS2,
+	_VBI_CODESET_UTF16LE,
+	_VBI_CODESET_UTF16BE
+} _vbi_codeset;
+
+extern _vbi_codeset
+_vbi_codeset_from_name		(const char *		codeset);
+extern unsigned long
+_vbi_convert_ucs2_max_size	(_vbi_codeset		dst_codeset,
+				 unsigned long		src_length);
+extern long
+_vbi_convert_ucs2		(char *			dst,
+				 _vbi_codeset		dst_codeset,
+				 const uint16_t *	src,
+				 unsigned long		src_length,
+				 int			repl_char)
+  _vbi_nonnull ((1));
+
 extern char *
 _vbi_strndup_iconv		(unsigned long *	out_size,
 				 const char *		dst_codeset,
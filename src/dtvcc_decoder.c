@@ -0,0 +1,2031 @@
+/*
+ *  libzvbi - CEA 708-C Digital TV Closed Caption decoder
+ *
+ *  Copyright (C) 2008 Michael H. Schimek
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* This code is experimental and not yet part of the library API.
+   The decoder was moved from contrib/atsc-cc.c, which now uses
+   this one. */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "misc.h"
+#include "event-priv.h"
+#include "cc608_decoder.h"
+#include "dtvcc_decoder.h"
+
+struct timestamp {
+	/* System time when the event occured, zero if no event
+	   occured yet. */
+	double			sys;
+
+	/* ISO 13818-1 Presentation Time Stamp of the event. Unit is
+	   1/90000 second. Only the 33 least significant bits are
+	   valid. < 0 if no event occured yet. */
+	int64_t			pts;
+};
+
+enum justify {
+	JUSTIFY_LEFT = 0,
+	JUSTIFY_RIGHT,
+	JUSTIFY_CENTER,
+	JUSTIFY_FULL
+};
+
+enum direction {
+	DIR_LEFT_RIGHT = 0,
+	DIR_RIGHT_LEFT,
+	DIR_TOP_BOTTOM,
+	DIR_BOTTOM_TOP
+};
+
+enum display_effect {
+	DISPLAY_EFFECT_SNAP = 0,
+	DISPLAY_EFFECT_FADE,
+	DISPLAY_EFFECT_WIPE
+};
+
+enum opacity {
+	OPACITY_SOLID = 0,
+	OPACITY_FLASH,
+	OPACITY_TRANSLUCENT,
+	OPACITY_TRANSPARENT
+};
+
+enum edge {
+	EDGE_NONE = 0,
+	EDGE_RAISED,
+	EDGE_DEPRESSED,
+	EDGE_UNIFORM,
+	EDGE_SHADOW_LEFT,
+	EDGE_SHADOW_RIGHT
+};
+
+enum pen_size {
+	PEN_SIZE_SMALL = 0,
+	PEN_SIZE_STANDARD,
+	PEN_SIZE_LARGE
+};
+
+enum font_style {
+	FONT_STYLE_DEFAULT = 0,
+	FONT_STYLE_MONO_SERIF,
+	FONT_STYLE_PROP_SERIF,
+	FONT_STYLE_MONO_SANS,
+	FONT_STYLE_PROP_SANS,
+	FONT_STYLE_CASUAL,
+	FONT_STYLE_CURSIVE,
+	FONT_STYLE_SMALL_CAPS
+};
+
+enum text_tag {
+	TEXT_TAG_DIALOG = 0,
+	TEXT_TAG_SOURCE_ID,
+	TEXT_TAG_DEVICE,
+	TEXT_TAG_DIALOG_2,
+	TEXT_TAG_VOICEOVER,
+	TEXT_TAG_AUDIBLE_TRANSL,
+	TEXT_TAG_SUBTITLE_TRANSL,
+	TEXT_TAG_VOICE_DESCR,
+	TEXT_TAG_LYRICS,
+	TEXT_TAG_EFFECT_DESCR,
+	TEXT_TAG_SCORE_DESCR,
+	TEXT_TAG_EXPLETIVE,
+	TEXT_TAG_NOT_DISPLAYABLE = 15
+};
+
+enum offset {
+	OFFSET_SUBSCRIPT = 0,
+	OFFSET_NORMAL,
+	OFFSET_SUPERSCRIPT
+};
+
+/* RGB 2:2:2 (lsb = B). */
+typedef uint8_t			dtvcc_color;
+
+/* Lsb = window 0, msb = window 7. */
+typedef uint8_t			dtvcc_window_map;
+
+struct dtvcc_pen_style {
+	enum pen_size			pen_size;
+	enum font_style			font_style;
+	enum offset			offset;
+	vbi_bool			italics;
+	vbi_bool			underline;
+
+	enum edge			edge_type;
+
+	dtvcc_color			fg_color;
+	enum opacity			fg_opacity;
+
+	dtvcc_color			bg_color;
+	enum opacity			bg_opacity;
+
+	dtvcc_color			edge_color;
+};
+
+struct dtvcc_pen {
+	enum text_tag			text_tag;
+	struct dtvcc_pen_style		style;
+};
+
+struct dtvcc_window_style {
+	enum justify			justify;
+	enum direction			print_direction;
+	enum direction			scroll_direction;
+	vbi_bool			wordwrap;
+
+	enum display_effect		display_effect;
+	enum direction			effect_direction;
+	unsigned int			effect_speed; /* 1/10 sec */
+
+	dtvcc_color			fill_color;
+	enum opacity			fill_opacity;
+
+	enum edge			border_type;
+	dtvcc_color			border_color;
+};
+
+struct dtvcc_window {
+	/* EIA 708-C window state. */
+
+	uint16_t			buffer[16][42];
+
+	vbi_bool			visible;
+
+	/* 0 = highest ... 7 = lowest. */
+	unsigned int			priority;
+
+	unsigned int			anchor_point;
+	unsigned int			anchor_horizontal;
+	unsigned int			anchor_vertical;
+	vbi_bool			anchor_relative;
+
+	unsigned int			row_count;
+	unsigned int			column_count;
+
+	vbi_bool			row_lock;
+	vbi_bool			column_lock;
+
+	unsigned int			curr_row;
+	unsigned int			curr_column;
+
+	struct dtvcc_pen		curr_pen;
+
+	struct dtvcc_window_style	style;
+
+	/* Our stuff. */
+
+	/**
+	 * If bit 1 << row is set we already sent a stream event for
+	 * this row.
+	 */
+	unsigned int			streamed;
+
+	/**
+	 * The time when we received the first (but not necessarily
+	 * leftmost) character in the current row. Unless a
+	 * DisplayWindow or ToggleWindow command completed the line
+	 * the next stream event will carry this timestamp.
+	 */
+	struct timestamp		timestamp_c0;
+};
+
+struct dtvcc_service {
+	/* Interpretation Layer. */
+
+	struct dtvcc_window		window[8];
+
+	struct dtvcc_window *		curr_window;
+
+	dtvcc_window_map		created;
+
+	/* For debugging. */
+	unsigned int			error_line;
+
+	/* Service Layer. */
+
+	uint8_t				service_data[128];
+	unsigned int			service_data_in;
+
+	/** The time when we last received data for this service. */
+	struct timestamp		timestamp;
+};
+
+struct _vbi_dtvcc_decoder {
+	struct dtvcc_service		service[2];
+
+	/* Packet Layer. */
+
+	/* Next expected DTVCC packet sequence_number. Only the two
+	   most significant bits are valid. < 0 if no sequence_number
+	   has been received yet. */
+	int				next_sequence_number;
+
+	/** The time when we last received data. */
+	struct timestamp		timestamp;
+
+	_vbi_event_handler_list		handlers;
+
+	_vbi_log_hook			log;
+};
+
+
+static void
+timestamp_reset			(struct timestamp *	ts)
+{
+	ts->sys = 0.0;
+	ts->pts = -1;
+}
+
+static vbi_bool
+timestamp_is_set		(const struct timestamp *ts)
+{
+	return (ts->pts >= 0 || ts->sys > 0.0);
+}
+
+static const uint8_t
+dtvcc_c0_length [4] = {
+	1, 1, 2, 3
+};
+
+static const uint8_t
+dtvcc_c1_length [32] = {
+	/* 0x80 CW0 ... CW7 */ 1, 1, 1, 1,  1, 1, 1, 1,
+	/* 0x88 CLW */ 2,
+	/* 0x89 DSW */ 2,
+	/* 0x8A HDW */ 2,
+	/* 0x8B TGW */ 2,
+
+	/* 0x8C DLW */ 2,
+	/* 0x8D DLY */ 2,
+	/* 0x8E DLC */ 1,
+	/* 0x8F RST */ 1,
+
+	/* 0x90 SPA */ 3,
+	/* 0x91 SPC */ 4,
+	/* 0x92 SPL */ 3,
+	/* CEA 708-C Section 7.1.5.1: 0x93 ... 0x96 are
+	   reserved one byte codes. */ 1, 1, 1, 1,
+	/* 0x97 SWA */ 5,
+	/* 0x98 DF0 ... DF7 */ 7, 7, 7, 7,  7, 7, 7, 7
+};
+
+static const uint16_t
+dtvcc_g2 [96] = {
+	/* Note Unicode defines no transparent spaces. */
+	0x0020, /* 0x1020 Transparent space */
+	0x00A0, /* 0x1021 Non-breaking transparent space */
+
+	0,      /* 0x1022 reserved */
+	0,
+	0,
+	0x2026, /* 0x1025 Horizontal ellipsis */
+	0,
+	0,
+	0,
+	0,
+	0x0160, /* 0x102A S with caron */
+	0,
+	0x0152, /* 0x102C Ligature OE */
+	0,
+	0,
+	0,
+
+	/* CEA 708-C Section 7.1.8: "The character (0x30) is a solid
+	   block which fills the entire character position with the
+	   text foreground color." */
+	0x2588, /* 0x1030 Full block */
+
+	0x2018, /* 0x1031 Left single quotation mark */
+	0x2019, /* 0x1032 Right single quotation mark */
+	0x201C, /* 0x1033 Left double quotation mark */
+	0x201D, /* 0x1034 Right double quotation mark */
+	0,
+	0,
+	0,
+	0x2122, /* 0x1039 Trademark sign */
+	0x0161, /* 0x103A s with caron */
+	0,
+	0x0153, /* 0x103C Ligature oe */
+	0x2120, /* 0x103D Service mark */
+	0,
+	0x0178, /* 0x103F Y with diaeresis */
+
+	/* Code points 0x1040 ... 0x106F reserved. */
+	0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
+	0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
+	0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
+
+	0,      /* 0x1070 reserved */
+	0,
+	0,
+	0,
+	0,
+	0,
+	0x215B, /* 0x1076 1/8 */
+	0x215C, /* 0x1077 3/8 */
+	0x215D, /* 0x1078 5/8 */
+	0x215E, /* 0x1079 7/8 */
+	0x2502, /* 0x107A Box drawings vertical */
+	0x2510, /* 0x107B Box drawings down and left */
+	0x2514, /* 0x107C Box drawings up and right */
+	0x2500, /* 0x107D Box drawings horizontal */
+	0x2518, /* 0x107E Box drawings up and left */
+	0x250C  /* 0x107F Box drawings down and right */
+};
+
+static unsigned int
+dtvcc_unicode			(unsigned int		c)
+{
+	if (unlikely (0 == (c & 0x60))) {
+		/* C0, C1, C2, C3 */
+		return 0;
+	} else if (likely (c < 0x100)) {
+		/* G0, G1 */
+		if (unlikely (0x7F == c))
+			return 0x266A; /* music note */
+		else
+			return c;
+	} else if (c < 0x1080) {
+		if (unlikely (c < 0x1020))
+			return 0;
+		else
+			return dtvcc_g2[c - 0x1020];
+	} else if (0x10A0 == c) {
+		/* We map all G2/G3 characters which are not
+		   representable in Unicode to private code U+E900
+		   ... U+E9FF. */
+		return 0xE9A0; /* caption icon */
+	}
+
+	return 0;
+}
+
+static void
+dtvcc_reset_service		(struct dtvcc_service *	ds)
+{
+	ds->curr_window = NULL;
+	ds->created = 0;
+
+	timestamp_reset (&ds->timestamp);
+}
+
+static void
+dtvcc_reset			(_vbi_dtvcc_decoder *	dc)
+{
+	dtvcc_reset_service (&dc->service[0]);
+	dtvcc_reset_service (&dc->service[1]);
+
+	dc->next_sequence_number = -1;
+}
+
+static unsigned int
+dtvcc_window_id			(struct dtvcc_service *	ds,
+				 struct dtvcc_window *	dw)
+{
+	return dw - ds->window;
+}
+
+static unsigned int
+dtvcc_service_num		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds)
+{
+	return ds - dc->service + 1;
+}
+
+/* Up to eight windows can be visible at once, so which one displays
+   the caption? Let's take a guess. */
+static struct dtvcc_window *
+dtvcc_caption_window		(struct dtvcc_service *	ds)
+{
+	struct dtvcc_window *dw;
+	unsigned int max_priority;
+	unsigned int window_id;
+
+	dw = NULL;
+	max_priority = 8;
+
+	for (window_id = 0; window_id < 8; ++window_id) {
+		if (0 == (ds->created & (1 << window_id)))
+			continue;
+		if (!ds->window[window_id].visible)
+			continue;
+		if (DIR_BOTTOM_TOP
+		    != ds->window[window_id].style.scroll_direction)
+			continue;
+		if (ds->window[window_id].priority < max_priority) {
+			dw = &ds->window[window_id];
+			max_priority = ds->window[window_id].priority;
+		}
+	}
+
+	return dw;
+}
+
+static void
+dtvcc_stream_event		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 struct dtvcc_window *	dw,
+				 unsigned int		row)
+{
+	vbi_event ev;
+	struct _vbi_event_dtvcc_stream dtvcc_stream;
+	vbi_char ac;
+	unsigned int column;
+
+	if (NULL == dw || dw != dtvcc_caption_window (ds))
+		return;
+
+	/* Note we only stream windows with scroll direction
+	   upwards. */
+	if (0 != (dw->streamed & (1 << row))
+	    || !timestamp_is_set (&dw->timestamp_c0))
+		return;
+
+	dw->streamed |= 1 << row;
+
+	for (column = 0; column < dw->column_count; ++column) {
+		if (0 != dw->buffer[row][column])
+			break;
+	}
+
+	/* Row contains only transparent spaces. */
+	if (column >= dw->column_count)
+		return;
+
+	CLEAR (ev);
+
+	ev.type = _VBI_EVENT_DTVCC_STREAM;
+	ev.ev._dtvcc_stream = &dtvcc_stream;
+
+	dtvcc_stream.capture_time = dw->timestamp_c0.sys;
+	dtvcc_stream.pts = dw->timestamp_c0.pts;
+	dtvcc_stream.service = dtvcc_service_num (dc, ds);
+	dtvcc_stream.length = dw->column_count;
+
+	/* TO DO. */
+	CLEAR (ac);
+	ac.foreground = VBI_WHITE;
+	ac.background = VBI_BLACK;
+	ac.opacity = VBI_OPAQUE;
+
+	for (column = 0; column < dw->column_count; ++column) {
+		unsigned int c;
+
+		c = dw->buffer[row][column];
+		if (0 == c) {
+			ac.unicode = 0x20;
+		} else {
+			ac.unicode = dtvcc_unicode (c);
+			if (0 == ac.unicode) {
+				ac.unicode = 0x20;
+			}
+		}
+		dtvcc_stream.text[column] = ac;
+	}
+
+	_vbi_event_handler_list_send (&dc->handlers, &ev);
+
+	timestamp_reset (&dw->timestamp_c0);
+}
+
+static vbi_bool
+dtvcc_put_char			(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 unsigned int		c)
+{
+	struct dtvcc_window *dw;
+	unsigned int row;
+	unsigned int column;
+
+	dc = dc; /* unused */
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	row = dw->curr_row;
+	column = dw->curr_column;
+
+	/* FIXME how should we handle TEXT_TAG_NOT_DISPLAYABLE? */
+
+	dw->buffer[row][column] = c;
+
+	switch (dw->style.print_direction) {
+	case DIR_LEFT_RIGHT:
+		dw->streamed &= ~(1 << row);
+		if (!timestamp_is_set (&dw->timestamp_c0))
+			dw->timestamp_c0 = ds->timestamp;
+		if (++column >= dw->column_count)
+			return TRUE;
+		break;
+
+	case DIR_RIGHT_LEFT:
+		dw->streamed &= ~(1 << row);
+		if (!timestamp_is_set (&dw->timestamp_c0))
+			dw->timestamp_c0 = ds->timestamp;
+		if (column-- <= 0)
+			return TRUE;
+		break;
+
+	case DIR_TOP_BOTTOM:
+		dw->streamed &= ~(1 << row);
+		if (!timestamp_is_set (&dw->timestamp_c0))
+			dw->timestamp_c0 = ds->timestamp;
+		if (++row >= dw->row_count)
+			return TRUE;
+		break;
+
+	case DIR_BOTTOM_TOP:
+		dw->streamed &= ~(1 << row);
+		if (!timestamp_is_set (&dw->timestamp_c0))
+			dw->timestamp_c0 = ds->timestamp;
+		if (row-- <= 0)
+			return TRUE;
+		break;
+	}
+
+	dw->curr_row = row;
+	dw->curr_column = column;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_set_pen_location		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 const uint8_t *	buf)
+{
+	struct dtvcc_window *dw;
+	unsigned int row;
+	unsigned int column;
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	row = buf[1];
+	/* We check the top four zero bits. */
+	if (row >= 16) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	column = buf[2];
+	/* We also check the top two zero bits. */
+	if (column >= 42) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	if (row > dw->row_count)
+		row = dw->row_count - 1;
+	if (column > dw->column_count)
+		column = dw->column_count - 1;
+
+	if (row != dw->curr_row) {
+		dtvcc_stream_event (dc, ds, dw, dw->curr_row);
+	}
+
+	/* FIXME there's more. */
+	dw->curr_row = row;
+	dw->curr_column = column;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_set_pen_color		(struct dtvcc_service *	ds,
+				 const uint8_t *	buf)
+{
+	struct dtvcc_window *dw;
+	unsigned int c;
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	c = buf[3];
+	if (0 != (c & 0xC0)) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	dw->curr_pen.style.edge_color = c;
+	c = buf[1];
+	dw->curr_pen.style.fg_opacity = c >> 6;
+	dw->curr_pen.style.fg_color = c & 0x3F;
+	c = buf[2];
+	dw->curr_pen.style.bg_opacity = c >> 6;
+	dw->curr_pen.style.bg_color = c & 0x3F;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_set_pen_attributes	(struct dtvcc_service *	ds,
+				 const uint8_t *	buf)
+{
+	struct dtvcc_window *dw;
+	unsigned int c;
+	enum pen_size pen_size;
+	enum offset offset;
+	enum edge edge_type;
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	c = buf[1];
+	offset = (c >> 2) & 3;
+	pen_size = c & 3;
+	if ((offset | pen_size) >= 3) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	c = buf[2];
+	edge_type = (c >> 3) & 7;
+	if (edge_type >= 6) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	c = buf[1];
+	dw->curr_pen.text_tag = c >> 4;
+	dw->curr_pen.style.offset = offset;
+	dw->curr_pen.style.pen_size = pen_size;
+	c = buf[2];
+	dw->curr_pen.style.italics = c >> 7;
+	dw->curr_pen.style.underline = (c >> 6) & 1;
+	dw->curr_pen.style.edge_type = edge_type;
+	dw->curr_pen.style.font_style = c & 7;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_set_window_attributes	(struct dtvcc_service *	ds,
+				 const uint8_t *	buf)
+{
+	struct dtvcc_window *dw;
+	unsigned int c;
+	enum edge border_type;
+	enum display_effect display_effect;
+
+	dw = ds->curr_window;
+	if (NULL == dw)
+		return FALSE;
+
+	c = buf[2];
+	border_type = ((buf[3] >> 5) & 0x04) | (c >> 6);
+	if (border_type >= 6)
+		return FALSE;
+
+	c = buf[4];
+	display_effect = c & 3;
+	if (display_effect >= 3)
+		return FALSE;
+
+	c = buf[1];
+	dw->style.fill_opacity = c >> 6;
+	dw->style.fill_color = c & 0x3F;
+	c = buf[2];
+	dw->style.border_type = border_type;
+	dw->style.border_color = c & 0x3F;
+	c = buf[3];
+	dw->style.wordwrap = (c >> 6) & 1;
+	dw->style.print_direction = (c >> 4) & 3;
+	dw->style.scroll_direction = (c >> 2) & 3;
+	dw->style.justify = c & 3;
+	c = buf[4];
+	dw->style.effect_speed = c >> 4;
+	dw->style.effect_direction = (c >> 2) & 3;
+	dw->style.display_effect = display_effect;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_clear_windows		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 dtvcc_window_map	window_map)
+{
+	unsigned int i;
+
+	window_map &= ds->created;
+
+	for (i = 0; i < 8; ++i) {
+		struct dtvcc_window *dw;
+
+		if (0 == (window_map & (1 << i)))
+			continue;
+
+		dw = &ds->window[i];
+
+		dtvcc_stream_event (dc, ds, dw, dw->curr_row);
+
+		memset (dw->buffer, 0, sizeof (dw->buffer));
+
+		dw->streamed = 0;
+
+		/* FIXME CEA 708-C Section 7.1.4 (Form Feed)
+		   and 8.10.5.3 confuse me. */
+		if (0) {
+			dw->curr_column = 0;
+			dw->curr_row = 0;
+		}
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_define_window		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 uint8_t *		buf)
+{
+	static const struct dtvcc_window_style window_styles [7] = {
+		{
+			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
+			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
+			OPACITY_SOLID, EDGE_NONE, 0
+		}, {
+			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
+			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
+			OPACITY_TRANSPARENT, EDGE_NONE, 0
+		}, {
+			JUSTIFY_CENTER, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
+			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
+			OPACITY_SOLID, EDGE_NONE, 0
+		}, {
+			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
+			TRUE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
+			OPACITY_SOLID, EDGE_NONE, 0
+		}, {
+			JUSTIFY_LEFT, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
+			TRUE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
+			OPACITY_TRANSPARENT, EDGE_NONE, 0
+		}, {
+			JUSTIFY_CENTER, DIR_LEFT_RIGHT, DIR_BOTTOM_TOP,
+			TRUE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
+			OPACITY_SOLID, EDGE_NONE, 0
+		}, {
+			JUSTIFY_LEFT, DIR_TOP_BOTTOM, DIR_RIGHT_LEFT,
+			FALSE, DISPLAY_EFFECT_SNAP, 0, 0, 0,
+			OPACITY_SOLID, EDGE_NONE, 0
+		}
+	};
+	static const struct dtvcc_pen_style pen_styles [7] = {
+		{
+			PEN_SIZE_STANDARD, 0, OFFSET_NORMAL, FALSE,
+			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
+			0x00, OPACITY_SOLID, 0
+		}, {
+			PEN_SIZE_STANDARD, 1, OFFSET_NORMAL, FALSE,
+			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
+			0x00, OPACITY_SOLID, 0
+		}, {
+			PEN_SIZE_STANDARD, 2, OFFSET_NORMAL, FALSE,
+			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
+			0x00, OPACITY_SOLID, 0
+		}, {
+			PEN_SIZE_STANDARD, 3, OFFSET_NORMAL, FALSE,
+			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
+			0x00, OPACITY_SOLID, 0
+		}, {
+			PEN_SIZE_STANDARD, 4, OFFSET_NORMAL, FALSE,
+			FALSE, EDGE_NONE, 0x3F, OPACITY_SOLID,
+			0x00, OPACITY_SOLID, 0
+		}, {
+			PEN_SIZE_STANDARD, 3, OFFSET_NORMAL, FALSE,
+			FALSE, EDGE_UNIFORM, 0x3F, OPACITY_SOLID,
+			0, OPACITY_TRANSPARENT, 0x00
+		}, {
+			PEN_SIZE_STANDARD, 4, OFFSET_NORMAL, FALSE,
+			FALSE, EDGE_UNIFORM, 0x3F, OPACITY_SOLID,
+			0, OPACITY_TRANSPARENT, 0x00
+		}
+	};
+	struct dtvcc_window *dw;
+	dtvcc_window_map window_map;
+	vbi_bool anchor_relative;
+	unsigned int anchor_vertical;
+	unsigned int anchor_horizontal;
+	unsigned int anchor_point;
+	unsigned int column_count_m1;
+	unsigned int window_id;
+	unsigned int window_style_id;
+	unsigned int pen_style_id;
+	unsigned int c;
+
+	if (0 != ((buf[1] | buf[6]) & 0xC0)) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	c = buf[2];
+	anchor_relative = (c >> 7) & 1;
+	anchor_vertical = c & 0x7F;
+	anchor_horizontal = buf[3];
+	if (0 == anchor_relative) {
+		if (unlikely (anchor_vertical >= 75
+			      || anchor_horizontal >= 210)) {
+			ds->error_line = __LINE__;
+			return FALSE;
+		}
+	} else {
+		if (unlikely (anchor_vertical >= 100
+			      || anchor_horizontal >= 100)) {
+			ds->error_line = __LINE__;
+			return FALSE;
+		}
+	}
+
+	c = buf[4];
+	anchor_point = c >> 4;
+	if (unlikely (anchor_point >= 9)) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	column_count_m1 = buf[5];
+	/* We also check the top two zero bits. */
+	if (unlikely (column_count_m1 >= 41)) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	window_id = buf[0] & 7;
+	dw = &ds->window[window_id];
+	window_map = 1 << window_id;
+
+	ds->curr_window = dw;
+
+	c = buf[1];
+	dw->visible = (c >> 5) & 1;
+	dw->row_lock = (c >> 4) & 1;
+	dw->column_lock = (c >> 4) & 1;
+	dw->priority = c & 7;
+
+	dw->anchor_relative = anchor_relative;
+	dw->anchor_vertical = anchor_vertical;
+	dw->anchor_horizontal = anchor_horizontal;
+	dw->anchor_point = anchor_point;
+
+	c = buf[4];
+	dw->row_count = (c & 15) + 1;
+	dw->column_count = column_count_m1 + 1;
+
+	c = buf[6];
+	window_style_id = (c >> 3) & 7;
+	pen_style_id = c & 7;
+
+	if (window_style_id > 0) {
+		dw->style = window_styles[window_style_id - 1];
+	} else if (0 == (ds->created & window_map)) {
+		dw->style = window_styles[0];
+	}
+
+	if (pen_style_id > 0) {
+		dw->curr_pen.style = pen_styles[pen_style_id - 1];
+	} else if (0 == (ds->created & window_map)) {
+		dw->curr_pen.style = pen_styles[0];
+	}
+
+	if (0 != (ds->created & window_map))
+		return TRUE;
+
+	/* Has to be something, no? */
+	dw->curr_pen.text_tag = TEXT_TAG_NOT_DISPLAYABLE;
+
+	dw->curr_column = 0;
+	dw->curr_row = 0;
+
+	dw->streamed = 0;
+
+	timestamp_reset (&dw->timestamp_c0);
+
+	ds->created |= window_map;
+
+	return dtvcc_clear_windows (dc, ds, window_map);
+}
+
+static vbi_bool
+dtvcc_display_windows		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 unsigned int		c,
+				 dtvcc_window_map	window_map)
+{
+	unsigned int i;
+
+	window_map &= ds->created;
+
+	for (i = 0; i < 8; ++i) {
+		struct dtvcc_window *dw;
+		vbi_bool was_visible;
+
+		if (0 == (window_map & (1 << i)))
+			continue;
+
+		dw = &ds->window[i];
+		was_visible = dw->visible;
+
+		switch (c) {
+		case 0x89: /* DSW DisplayWindows */
+			dw->visible = TRUE;
+			break;
+
+		case 0x8A: /* HDW HideWindows */
+			dw->visible = FALSE;
+			break;
+
+		case 0x8B: /* TGW ToggleWindows */
+			dw->visible = was_visible ^ TRUE;
+			break;
+		}
+
+		if (!was_visible) {
+			unsigned int row;
+
+			dw->timestamp_c0 = ds->timestamp;
+			for (row = 0; row < dw->row_count; ++row) {
+				dtvcc_stream_event (dc, ds, dw, row);
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_carriage_return		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds)
+{
+	struct dtvcc_window *dw;
+	unsigned int row;
+	unsigned int column;
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	dtvcc_stream_event (dc, ds, dw, dw->curr_row);
+
+	row = dw->curr_row;
+	column = dw->curr_column;
+
+	switch (dw->style.scroll_direction) {
+	case DIR_LEFT_RIGHT:
+		dw->curr_row = 0;
+		if (column > 0) {
+			dw->curr_column = column - 1;
+			break;
+		}
+		dw->streamed = (dw->streamed << 1)
+			& ~(1 << dw->column_count);
+		for (row = 0; row < dw->row_count; ++row) {
+			for (column = dw->column_count - 1;
+			     column > 0; --column) {
+				dw->buffer[row][column] =
+					dw->buffer[row][column - 1];
+			}
+			dw->buffer[row][column] = 0;
+		}
+		break;
+
+	case DIR_RIGHT_LEFT:
+		dw->curr_row = 0;
+		if (column + 1 < dw->row_count) {
+			dw->curr_column = column + 1;
+			break;
+		}
+		dw->streamed >>= 1;
+		for (row = 0; row < dw->row_count; ++row) {
+			for (column = 0;
+			     column < dw->column_count - 1; ++column) {
+				dw->buffer[row][column] =
+					dw->buffer[row][column + 1];
+			}
+			dw->buffer[row][column] = 0;
+		}
+		break;
+
+	case DIR_TOP_BOTTOM:
+		dw->curr_column = 0;
+		if (row > 0) {
+			dw->curr_row = row - 1;
+			break;
+		}
+		dw->streamed = (dw->streamed << 1)
+			& ~(1 << dw->row_count);
+		memmove (&dw->buffer[1], &dw->buffer[0],
+			 sizeof (dw->buffer[0]) * (dw->row_count - 1));
+		memset (&dw->buffer[0], 0, sizeof (dw->buffer[0]));
+		break;
+
+	case DIR_BOTTOM_TOP:
+		dw->curr_column = 0;
+		if (row + 1 < dw->row_count) {
+			dw->curr_row = row + 1;
+			break;
+		}
+		dw->streamed >>= 1;
+		memmove (&dw->buffer[0], &dw->buffer[1],
+			 sizeof (dw->buffer[0]) * (dw->row_count - 1));
+		memset (&dw->buffer[row], 0, sizeof (dw->buffer[0]));
+		break;
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_form_feed			(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds)
+{
+	struct dtvcc_window *dw;
+	dtvcc_window_map window_map;
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	window_map = 1 << dtvcc_window_id (ds, dw);
+
+	if (!dtvcc_clear_windows (dc, ds, window_map))
+		return FALSE;
+
+	dw->curr_row = 0;
+	dw->curr_column = 0;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_backspace			(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds)
+{
+	struct dtvcc_window *dw;
+	unsigned int row;
+	unsigned int column;
+
+	dc = dc; /* unused */
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	row = dw->curr_row;
+	column = dw->curr_column;
+
+	switch (dw->style.print_direction) {
+	case DIR_LEFT_RIGHT:
+		if (column-- <= 0)
+			return TRUE;
+		break;
+
+	case DIR_RIGHT_LEFT:
+		if (++column >= dw->column_count)
+			return TRUE;
+		break;
+
+	case DIR_TOP_BOTTOM:
+		if (row-- <= 0)
+			return TRUE;
+		break;
+
+	case DIR_BOTTOM_TOP:
+		if (++row >= dw->row_count)
+			return TRUE;
+		break;
+
+	default:
+		return TRUE;
+	}
+
+	if (0 != dw->buffer[row][column]) {
+		dw->streamed &= ~(1 << row);
+		dw->buffer[row][column] = 0;
+	}
+
+	dw->curr_row = row;
+	dw->curr_column = column;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_hor_carriage_return	(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds)
+{
+	struct dtvcc_window *dw;
+	unsigned int row;
+	unsigned int column;
+	unsigned int mask;
+
+	dc = dc; /* unused */
+
+	dw = ds->curr_window;
+	if (NULL == dw) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	row = dw->curr_row;
+	column = dw->curr_column;
+
+	switch (dw->style.print_direction) {
+	case DIR_LEFT_RIGHT:
+	case DIR_RIGHT_LEFT:
+		mask = 1 << row;
+		memset (&dw->buffer[row][0], 0,
+			sizeof (dw->buffer[0]));
+		if (DIR_LEFT_RIGHT == dw->style.print_direction)
+			dw->curr_column = 0;
+		else
+			dw->curr_column = dw->column_count - 1;
+		break;
+
+	case DIR_TOP_BOTTOM:
+	case DIR_BOTTOM_TOP:
+		/* The streamed bits are per row, and clearing a
+		   column changes all of them. */
+		mask = (1 << dw->row_count) - 1;
+		for (row = 0; row < dw->row_count; ++row)
+			dw->buffer[row][column] = 0;
+		if (DIR_TOP_BOTTOM == dw->style.print_direction)
+			dw->curr_row = 0;
+		else
+			dw->curr_row = dw->row_count - 1;
+		break;
+
+	default:
+		return TRUE;
+	}
+
+	dw->streamed &= ~mask;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_delete_windows		(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 dtvcc_window_map	window_map)
+{
+	struct dtvcc_window *dw;
+
+	dw = ds->curr_window;
+	if (NULL != dw) {
+		unsigned int window_id;
+		
+		window_id = dtvcc_window_id (ds, dw);
+		if (0 != (window_map & (1 << window_id))) {
+			dtvcc_stream_event (dc, ds, dw, dw->curr_row);
+			ds->curr_window = NULL;
+		}
+	}
+
+	ds->created &= ~window_map;
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_command			(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 unsigned int *		se_length,
+				 uint8_t *		buf,
+				 unsigned int		n_bytes)
+{
+	unsigned int c;
+	unsigned int window_id;
+
+	c = buf[0];
+	if ((int8_t) c < 0) {
+		*se_length = dtvcc_c1_length[c - 0x80];
+	} else {
+		*se_length = dtvcc_c0_length[c >> 3];
+	}
+
+	if (*se_length > n_bytes) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	switch (c) {
+	case 0x08: /* BS Backspace */
+		return dtvcc_backspace (dc, ds);
+
+	case 0x0C: /* FF Form Feed */
+		return dtvcc_form_feed (dc, ds);
+
+	case 0x0D: /* CR Carriage Return */
+		return dtvcc_carriage_return (dc, ds);
+
+	case 0x0E: /* HCR Horizontal Carriage Return */
+		return dtvcc_hor_carriage_return (dc, ds);
+
+	case 0x80 ... 0x87: /* CWx SetCurrentWindow */
+		window_id = c & 7;
+		if (0 == (ds->created & (1 << window_id))) {
+			ds->error_line = __LINE__;
+			return FALSE;
+		}
+		ds->curr_window = &ds->window[window_id];
+		return TRUE;
+
+	case 0x88: /* CLW ClearWindows */
+		return dtvcc_clear_windows (dc, ds, buf[1]);
+
+	case 0x89: /* DSW DisplayWindows */
+		return dtvcc_display_windows (dc, ds, c, buf[1]);
+
+	case 0x8A: /* HDW HideWindows */
+		return dtvcc_display_windows (dc, ds, c, buf[1]);
+
+	case 0x8B: /* TGW ToggleWindows */
+		return dtvcc_display_windows (dc, ds, c, buf[1]);
+
+	case 0x8C: /* DLW DeleteWindows */
+		return dtvcc_delete_windows (dc, ds, buf[1]);
+
+	case 0x8F: /* RST Reset */
+		dtvcc_reset_service (ds);
+		return TRUE;
+
+	case 0x90: /* SPA SetPenAttributes */
+		return dtvcc_set_pen_attributes (ds, buf);
+
+	case 0x91: /* SPC SetPenColor */
+		return dtvcc_set_pen_color (ds, buf);
+
+	case 0x92: /* SPL SetPenLocation */
+		return dtvcc_set_pen_location (dc, ds, buf);
+
+	case 0x97: /* SWA SetWindowAttributes */
+		return dtvcc_set_window_attributes (ds, buf);
+
+	case 0x98 ... 0x9F: /* DFx DefineWindow */
+		return dtvcc_define_window (dc, ds, buf);
+
+	default:
+		return TRUE;
+	}
+}
+
+static vbi_bool
+dtvcc_decode_se			(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 unsigned int *		se_length,
+				 uint8_t *		buf,
+				 unsigned int		n_bytes)
+{
+	unsigned int c;
+
+	c = buf[0];
+	if (likely (0 != (c & 0x60))) {
+		/* G0/G1 character. */
+		*se_length = 1;
+		return dtvcc_put_char (dc, ds, c);
+	}
+
+	if (0x10 != c) {
+		/* C0/C1 control code. */
+		return dtvcc_command (dc, ds, se_length,
+				      buf, n_bytes);
+	}
+
+	if (unlikely (n_bytes < 2)) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	c = buf[1];
+	if (likely (0 != (c & 0x60))) {
+		/* G2/G3 character. */
+		*se_length = 2;
+		return dtvcc_put_char (dc, ds, 0x1000 | c);
+	}
+
+	/* CEA 708-C defines no C2 or C3 commands. */
+
+	if ((int8_t) c >= 0) {
+		/* C2 code. */
+		*se_length = (c >> 3) + 2;
+	} else if (c < 0x90) {
+		/* C3 Fixed Length Commands. */
+		*se_length = (c >> 3) - 10;
+	} else {
+		/* C3 Variable Length Commands. */
+
+		if (unlikely (n_bytes < 3)) {
+			ds->error_line = __LINE__;
+			return FALSE;
+		}
+
+		/* type [2], zero_bit [1],
+		   length [5] */
+		*se_length = (buf[2] & 0x1F) + 3;
+	}
+
+	if (unlikely (n_bytes < *se_length)) {
+		ds->error_line = __LINE__;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_decode_syntactic_elements	(_vbi_dtvcc_decoder *	dc,
+				 struct dtvcc_service *	ds,
+				 uint8_t *		buf,
+				 unsigned int		n_bytes)
+{
+	ds->timestamp = dc->timestamp;
+
+	while (n_bytes > 0) {
+		unsigned int se_length;
+
+		if (0x8D /* DLY */ == *buf
+		    || 0x8E /* DLC */ == *buf) {
+			/* FIXME ignored for now. */
+			++buf;
+			--n_bytes;
+			continue;
+		}
+
+		if (!dtvcc_decode_se (dc, ds,
+				      &se_length,
+				      buf, n_bytes)) {
+			return FALSE;
+		}
+
+		buf += se_length;
+		n_bytes -= se_length;
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+dtvcc_decode_packet		(_vbi_dtvcc_decoder *	dc,
+				 const uint8_t *	packet,
+				 unsigned int		packet_size,
+				 double			capture_time,
+				 int64_t		pts)
+{
+	unsigned int packet_size_code;
+	unsigned int size;
+	unsigned int i;
+	vbi_bool all_successful;
+
+	dc->timestamp.sys = capture_time;
+	dc->timestamp.pts = pts;
+
+	/* Packet Layer. */
+
+	/* sequence_number [2], packet_size_code [6],
+	   packet_data [n * 8] */
+
+	if (dc->next_sequence_number >= 0
+	    && 0 != ((packet[0] ^ dc->next_sequence_number) & 0xC0)) {
+		debug1 (&dc->log, "DTVCC packet lost.");
+		dtvcc_reset (dc);
+		return FALSE;
+	}
+
+	dc->next_sequence_number = packet[0] + 0x40;
+
+	packet_size_code = packet[0] & 0x3F;
+	size = 128;
+	if (packet_size_code > 0)
+		size = packet_size_code * 2;
+
+	/* CEA 708-C Section 5: Apparently packet_size need not be
+	   equal to the actually transmitted amount of data. */
+	if (size > packet_size) {
+		debug1 (&dc->log, "DTVCC packet incomplete (%u/%u).",
+			packet_size, size);
+		dtvcc_reset (dc);
+		return FALSE;
+	}
+
+	/* Service Layer. */
+
+	/* CEA 708-C Section 6.2.5, 6.3: Service Blocks and syntactic
+	   elements must not cross Caption Channel Packet
+	   boundaries. */
+
+	for (i = 1; i < size;) {
+		unsigned int service_number;
+		unsigned int block_size;
+		unsigned int header_size;
+		unsigned int c;
+
+		header_size = 1;
+
+		/* service_number [3], block_size [5],
+		   (null_fill [2], extended_service_number [6]),
+		   (Block_data [n * 8]) */
+
+		c = packet[i];
+		service_number = (c & 0xE0) >> 5;
+
+		/* CEA 708-C Section 6.3: Ignore block_size if
+		   service_number is zero. */
+		if (0 == service_number) {
+			/* NULL Service Block Header, no more data in
+			   this Caption Channel Packet. */
+			break;
+		}
+
+		/* CEA 708-C Section 6.2.1: Apparently block_size zero
+		   is valid, although properly it should only occur in
+		   NULL Service Block Headers. */
+		block_size = c & 0x1F;
+
+		if (7 == service_number) {
+			if (i + 1 >= size)
+				goto service_block_incomplete;
+
+			header_size = 2;
+			c = packet[i + 1];
+
+			/* We also check the null_fill bits. */
+			if (c < 7 || c > 63)
+				goto invalid_service_block;
+
+			service_number = c;
+		}
+
+		if (i + header_size + block_size > size)
+			goto service_block_incomplete;
+
+		if (service_number <= 2) {
+			struct dtvcc_service *ds;
+			unsigned int in;
+
+			ds = &dc->service[service_number - 1];
+			in = ds->service_data_in;
+			memcpy (ds->service_data + in,
+				packet + i + header_size,
+				block_size);
+			ds->service_data_in = in + block_size;
+		}
+
+		i += header_size + block_size;
+	}
+
+	all_successful = TRUE;
+
+	for (i = 0; i < 2; ++i) {
+		struct dtvcc_service *ds;
+		vbi_bool success;
+
+		ds = &dc->service[i];
+		if (0 == ds->service_data_in)
+			continue;
+
+		success = dtvcc_decode_syntactic_elements
+			(dc, ds, ds->service_data, ds->service_data_in);
+
+		ds->service_data_in = 0;
+
+		if (success)
+			continue;
+
+		debug1 (&dc->log,
+			"DTVCC invalid syntactic element (%u).",
+			ds->error_line);
+
+		dtvcc_reset_service (ds);
+
+		all_successful = FALSE;
+	}
+
+	return all_successful;
+
+ invalid_service_block:
+	debug1 (&dc->log, "DTVCC invalid service block (%u).", i);
+	dtvcc_reset (dc);
+	return FALSE;
+
+ service_block_incomplete:
+	debug1 (&dc->log, "DTVCC incomplete service block (%u).", i);
+	dtvcc_reset (dc);
+	return FALSE;
+}
+
+/**
+ * @param dc DTVCC decoder allocated with _vbi_dtvcc_decoder_new().
+ * @param packet One CEA 708-C Caption Channel Packet.
+ * @param packet_size Number of bytes in the @a packet buffer.
+ * @param capture_time System time in seconds when the packet was
+ *   received.
+ * @param pts ISO 13818-1 Presentation Time Stamp of the packet,
+ *   or a negative value if unknown.
+ *
+ * Decodes a Caption Channel Packet as assembled by the ATSC A/53
+ * cc_data() transport layer, and sends @c _VBI_EVENT_DTVCC_STREAM
+ * events to the registered event handlers when a caption row is
+ * complete.
+ *
+ * @returns
+ * @c FALSE if the packet was incomplete or invalid. The decoder
+ * resets the affected services in this case.
+ */
+vbi_bool
+_vbi_dtvcc_decoder_feed		(_vbi_dtvcc_decoder *	dc,
+				 const uint8_t *	packet,
+				 unsigned int		packet_size,
+				 double			capture_time,
+				 int64_t		pts)
+{
+	assert (NULL != dc);
+	assert (NULL != packet);
+
+	if (0 == packet_size || packet_size > 128)
+		return FALSE;
+
+	return dtvcc_decode_packet (dc, packet, packet_size,
+				    capture_time, pts);
+}
+
+/**
+ * @param dc DTVCC decoder allocated with _vbi_dtvcc_decoder_new().
+ * @param callback Function to be called on events.
+ * @param user_data User pointer passed through to the @a callback
+ *   function.
+ *
+ * Removes an event handler from the DTVCC decoder, if a handler with
+ * this @a callback and @a user_data has been registered.
+ */
+void
+_vbi_dtvcc_decoder_remove_event_handler
+				(_vbi_dtvcc_decoder *	dc,
+				 vbi_event_handler	callback,
+				 void *			user_data)
+{
+	_vbi_event_handler_list_remove_by_callback (&dc->handlers,
+						    callback,
+						    user_data);
+}
+
+/**
+ * @param dc DTVCC decoder allocated with _vbi_dtvcc_decoder_new().
+ * @param event_mask Set of events the handler is waiting for,
+ *   currently only _VBI_EVENT_DTVCC_STREAM.
+ * @param callback Function to be called on events by
+ *   _vbi_dtvcc_decoder_feed().
+ * @param user_data User pointer passed through to the @a callback
+ *   function.
+ *
+ * Adds a new event handler to the DTVCC decoder, or changes the set
+ * of events an already registered handler will receive.
+ *
+ * @returns
+ * @c FALSE on failure (out of memory).
+ */
+vbi_bool
+_vbi_dtvcc_decoder_add_event_handler
+				(_vbi_dtvcc_decoder *	dc,
+				 unsigned int		event_mask,
+				 vbi_event_handler	callback,
+				 void *			user_data)
+{
+	event_mask &= _VBI_EVENT_DTVCC_STREAM;
+
+	if (0 == event_mask) {
+		_vbi_event_handler_list_remove_by_callback (&dc->handlers,
+							    callback,
+							    user_data);
+		return TRUE;
+	}
+
+	if (NULL != _vbi_event_handler_list_add (&dc->handlers,
+						 event_mask,
+						 callback,
+						 user_data)) {
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * @param dc DTVCC decoder allocated with _vbi_dtvcc_decoder_new().
+ *
+ * Resets the DTVCC decoder, useful for example after a channel
+ * change.
+ */
+void
+_vbi_dtvcc_decoder_reset	(_vbi_dtvcc_decoder *	dc)
+{
+	assert (NULL != dc);
+
+	dtvcc_reset (dc);
+}
+
+static void
+_vbi_dtvcc_decoder_destroy	(_vbi_dtvcc_decoder *	dc)
+{
+	assert (NULL != dc);
+
+	_vbi_event_handler_list_destroy (&dc->handlers);
+
+	CLEAR (*dc);
+}
+
+static void
+_vbi_dtvcc_decoder_init		(_vbi_dtvcc_decoder *	dc)
+{
+	assert (NULL != dc);
+
+	CLEAR (*dc);
+
+	_vbi_event_handler_list_init (&dc->handlers);
+
+	dtvcc_reset (dc);
+
+	timestamp_reset (&dc->timestamp);
+}
+
+/**
+ * @param dc DTVCC decoder allocated with _vbi_dtvcc_decoder_new(),
+ *   can be @a NULL.
+ *
+ * Frees all resources associated with @a dc.
+ */
+void
+_vbi_dtvcc_decoder_delete	(_vbi_dtvcc_decoder *	dc)
+{
+	if (NULL == dc)
+		return;
+
+	_vbi_dtvcc_decoder_destroy (dc);
+
+	vbi_free (dc);
+}
+
+/**
+ * Allocates a new CEA 708-C Digital TV Closed Caption decoder.
+ *
+ * To decode captions call the _vbi_dtvcc_decoder_feed() function
+ * with each Caption Channel Packet. To receive decoded captions
+ * register an event handler with
+ * _vbi_dtvcc_decoder_add_event_handler().
+ *
+ * @returns
+ * Pointer to a newly allocated DTVCC decoder which must be
+ * freed with _vbi_dtvcc_decoder_delete() when no longer
+ * needed. @c NULL on failure (out of memory).
+ */
+_vbi_dtvcc_decoder *
+_vbi_dtvcc_decoder_new		(void)
+{
+	_vbi_dtvcc_decoder *dc;
+
+	dc = vbi_malloc (sizeof (*dc));
+	if (NULL == dc) {
+		return NULL;
+	}
+
+	_vbi_dtvcc_decoder_init (dc);
+
+	return dc;
+}
+
+/* ATSC A/53 Part 4:2007 Closed Caption Data decoder. */
+
+enum cc_type {
+	NTSC_F1 = 0,
+	NTSC_F2 = 1,
+	DTVCC_DATA = 2,
+	DTVCC_START = 3,
+};
+
+struct _vbi_cc_data_decoder {
+	/* NTSC (EIA 608) byte pairs go here. */
+	_vbi_cc608_decoder *		cc608;
+
+	/* DTVCC Caption Channel Packets go here. */
+	_vbi_dtvcc_decoder		dtvcc;
+
+	/* DTVCC packet assembly. */
+	uint8_t				packet[128];
+	unsigned int			packet_size;
+
+	/* PTS of the last cc_data() with a valid PTS, the DTVCC
+	   packets are decoded with this timestamp. */
+	int64_t				pts;
+};
+
+/**
+ * @param cd cc_data decoder allocated with _vbi_cc_data_decoder_new().
+ * @param buf ATSC A/53 cc_data() structure, starting at the byte
+ *   containing the process_cc_data_flag and cc_count.
+ * @param n_bytes Number of bytes in the @a buf.
+ * @param capture_time System time in seconds when the data was
+ *   received.
+ * @param pts ISO 13818-1 Presentation Time Stamp of the picture
+ *   carrying the cc_data(), or a negative value if unknown.
+ *
+ * Splits the cc_data() into NTSC (EIA 608) byte pairs and CEA 708-C
+ * Caption Channel Packets and passes them to an EIA 608 and a DTVCC
+ * decoder respectively. The decoders send @c _VBI_EVENT_CC608,
+ * @c _VBI_EVENT_CC608_STREAM and @c _VBI_EVENT_DTVCC_STREAM events
+ * to the handlers registered with
+ * _vbi_cc_data_decoder_add_event_handler().
+ *
+ * @returns
+ * @c FALSE if the cc_data() structure was truncated or contained
+ * errors.
+ */
+vbi_bool
+_vbi_cc_data_decoder_feed	(_vbi_cc_data_decoder *	cd,
+				 const uint8_t *	buf,
+				 unsigned int		n_bytes,
+				 double			capture_time,
+				 int64_t		pts)
+{
+	unsigned int process_cc_data_flag;
+	unsigned int cc_count;
+	unsigned int i;
+	vbi_bool dtvcc;
+	vbi_bool all_successful;
+
+	assert (NULL != cd);
+	assert (NULL != buf);
+
+	if (n_bytes < 2)
+		return FALSE;
+
+	if (pts >= 0)
+		cd->pts = pts;
+
+	/* process_em_data_flag [1], process_cc_data_flag [1],
+	   additional_data_flag [1], cc_count [5], em_data [8],
+	   cc_count * (marker_bits [5], cc_valid [1], cc_type [2],
+	   cc_data_1 [8], cc_data_2 [8]) */
+
+	process_cc_data_flag = buf[0] & 0x40;
+	if (!process_cc_data_flag)
+		return TRUE;
+
+	cc_count = buf[0] & 0x1F;
+	if (n_bytes < 2 + cc_count * 3)
+		return FALSE;
+
+	dtvcc = FALSE;
+	all_successful = TRUE;
+
+	for (i = 0; i < cc_count; ++i) {
+		unsigned int b0;
+		unsigned int cc_valid;
+		enum cc_type cc_type;
+		unsigned int j;
+
+		b0 = buf[2 + i * 3];
+		cc_valid = b0 & 4;
+		cc_type = (enum cc_type)(b0 & 3);
+
+		switch (cc_type) {
+		case NTSC_F1:
+		case NTSC_F2:
+			/* Note CEA 708-C Table 4: Only one NTSC pair
+			   will be present in field picture user_data
+			   or in progressive video pictures, and up to
+			   three can occur if the frame rate < 30 Hz
+			   or repeat_first_field = 1. */
+			if (!cc_valid || i >= 3 || dtvcc) {
+				/* Illegal, invalid or filler. */
+				break;
+			}
+
+			all_successful &= _vbi_cc608_decoder_feed
+				(cd->cc608, &buf[3 + i * 3],
+				 /* line */ (NTSC_F1 == cc_type) ? 21 : 284,
+				 capture_time, pts);
+			break;
+
+		case DTVCC_DATA:
+			j = cd->packet_size;
+			if (j <= 0) {
+				/* Missed packet start. */
+				break;
+			} else if (!cc_valid) {
+				/* End of DTVCC packet. */
+				all_successful &= _vbi_dtvcc_decoder_feed
+					(&cd->dtvcc, cd->packet, j,
+					 capture_time, cd->pts);
+				cd->packet_size = 0;
+			} else if (j >= 128) {
+				/* Packet buffer overflow. */
+				dtvcc_reset (&cd->dtvcc);
+				cd->packet_size = 0;
+				all_successful = FALSE;
+			} else {
+				cd->packet[j] = buf[3 + i * 3];
+				cd->packet[j + 1] = buf[4 + i * 3];
+				cd->packet_size = j + 2;
+			}
+			break;
+
+		case DTVCC_START:
+			dtvcc = TRUE;
+			j = cd->packet_size;
+			if (j > 0) {
+				/* End of DTVCC packet. */
+				all_successful &= _vbi_dtvcc_decoder_feed
+					(&cd->dtvcc, cd->packet, j,
+					 capture_time, cd->pts);
+			}
+			if (!cc_valid) {
+				/* No new data. */
+				cd->packet_size = 0;
+			} else {
+				cd->packet[0] = buf[3 + i * 3];
+				cd->packet[1] = buf[4 + i * 3];
+				cd->packet_size = 2;
+			}
+			break;
+		}
+	}
+
+	return all_successful;
+}
+
+/**
+ * @param cd cc_data decoder allocated with _vbi_cc_data_decoder_new().
+ * @param callback Function to be called on events.
+ * @param user_data User pointer passed through to the @a callback
+ *   function.
+ *
+ * Removes an event handler from the EIA 608 and the DTVCC decoder.
+ */
+void
+_vbi_cc_data_decoder_remove_event_handler
+				(_vbi_cc_data_decoder *	cd,
+				 vbi_event_handler	callback,
+				 void *			user_data)
+{
+	_vbi_cc608_decoder_remove_event_handler (cd->cc608,
+						 callback, user_data);
+	_vbi_dtvcc_decoder_remove_event_handler (&cd->dtvcc,
+						 callback, user_data);
+}
+
+/**
+ * @param cd cc_data decoder allocated with _vbi_cc_data_decoder_new().
+ * @param event_mask Set of events the handler is waiting for,
+ *   _VBI_EVENT_CC608, _VBI_EVENT_CC608_STREAM and
+ *   _VBI_EVENT_DTVCC_STREAM.
+ * @param callback Function to be called on events by
+ *   _vbi_cc_data_decoder_feed().
+ * @param user_data User pointer passed through to the @a callback
+ *   function.
+ *
+ * Adds a new event handler to the EIA 608 and the DTVCC decoder,
+ * or changes the set of events an already registered handler will
+ * receive.
+ *
+ * @returns
+ * @c FALSE on failure (out of memory).
+ */
+vbi_bool
+_vbi_cc_data_decoder_add_event_handler
+				(_vbi_cc_data_decoder *	cd,
+				 unsigned int		event_mask,
+				 vbi_event_handler	callback,
+				 void *			user_data)
+{
+	if (!_vbi_cc608_decoder_add_event_handler (cd->cc608,
+						   event_mask,
+						   callback, user_data))
+		return FALSE;
+
+	if (!_vbi_dtvcc_decoder_add_event_handler (&cd->dtvcc,
+						   event_mask,
+						   callback, user_data)) {
+		_vbi_cc608_decoder_remove_event_handler (cd->cc608,
+							 callback,
+							 user_data);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * @param cd cc_data decoder allocated with _vbi_cc_data_decoder_new().
+ *
+ * Resets the cc_data decoder, useful for example after a channel
+ * change.
+ */
+void
+_vbi_cc_data_decoder_reset	(_vbi_cc_data_decoder *	cd)
+{
+	assert (NULL != cd);
+
+	_vbi_cc608_decoder_reset (cd->cc608);
+	dtvcc_reset (&cd->dtvcc);
+
+	cd->packet_size = 0;
+	cd->pts = -1;
+}
+
+/**
+ * @param cd cc_data decoder allocated with _vbi_cc_data_decoder_new(),
+ *   can be @a NULL.
+ *
+ * Frees all resources associated with @a cd.
+ */
+void
+_vbi_cc_data_decoder_delete	(_vbi_cc_data_decoder *	cd)
+{
+	if (NULL == cd)
+		return;
+
+	_vbi_cc608_decoder_delete (cd->cc608);
+	_vbi_dtvcc_decoder_destroy (&cd->dtvcc);
+
+	vbi_free (cd);
+}
+
+/**
+ * Allocates a new ATSC A/53 cc_data() decoder. It contains an EIA 608
+ * and a CEA 708-C decoder.
+ *
+ * @returns
+ * Pointer to a newly allocated cc_data decoder which must be
+ * freed with _vbi_cc_data_decoder_delete() when no longer
+ * needed. @c NULL on failure (out of memory).
+ */
+_vbi_cc_data_decoder *
+_vbi_cc_data_decoder_new	(void)
+{
+	_vbi_cc_data_decoder *cd;
+
+	cd = vbi_malloc (sizeof (*cd));
+	if (NULL == cd) {
+		return NULL;
+	}
+
+	CLEAR (*cd);
+
+	cd->cc608 = _vbi_cc608_decoder_new ();
+	if (NULL == cd->cc608) {
+		vbi_free (cd);
+		return NULL;
+	}
+
+	_vbi_dtvcc_decoder_init (&cd->dtvcc);
+
+	cd->pts = -1;
+
+	return cd;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
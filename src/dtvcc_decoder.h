@@ -0,0 +1,112 @@
+/*
+ *  libzvbi - CEA 708-C Digital TV Closed Caption decoder
+ *
+ *  Copyright (C) 2008 Michael H. Schimek
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* This code is experimental and not yet part of the library API. */
+
+#ifndef __ZVBI_DTVCC_DECODER_H__
+#define __ZVBI_DTVCC_DECODER_H__
+
+#include "format.h"
+#include "event.h"
+
+VBI_BEGIN_DECLS
+
+/* Public */
+
+/** @internal */
+struct _vbi_event_dtvcc_stream {
+	double				capture_time;
+	int64_t				pts;
+
+	/** CEA 708-C caption service number 1 or 2. */
+	int				service;
+
+	/** Number of valid characters in @a text. */
+	unsigned int			length;
+
+	vbi_char			text[42];
+};
+
+typedef struct _vbi_dtvcc_decoder _vbi_dtvcc_decoder;
+
+extern vbi_bool
+_vbi_dtvcc_decoder_feed		(_vbi_dtvcc_decoder *	dc,
+				 const uint8_t *	packet,
+				 unsigned int		packet_size,
+				 double			capture_time,
+				 int64_t		pts);
+extern void
+_vbi_dtvcc_decoder_remove_event_handler
+				(_vbi_dtvcc_decoder *	dc,
+				 vbi_event_handler	callback,
+				 void *			user_data);
+extern vbi_bool
+_vbi_dtvcc_decoder_add_event_handler
+				(_vbi_dtvcc_decoder *	dc,
+				 unsigned int		event_mask,
+				 vbi_event_handler	callback,
+				 void *			user_data);
+extern void
+_vbi_dtvcc_decoder_reset	(_vbi_dtvcc_decoder *	dc);
+extern void
+_vbi_dtvcc_decoder_delete	(_vbi_dtvcc_decoder *	dc);
+extern _vbi_dtvcc_decoder *
+_vbi_dtvcc_decoder_new		(void);
+
+typedef struct _vbi_cc_data_decoder _vbi_cc_data_decoder;
+
+extern vbi_bool
+_vbi_cc_data_decoder_feed	(_vbi_cc_data_decoder *	cd,
+				 const uint8_t *	buf,
+				 unsigned int		n_bytes,
+				 double			capture_time,
+				 int64_t		pts);
+extern void
+_vbi_cc_data_decoder_remove_event_handler
+				(_vbi_cc_data_decoder *	cd,
+				 vbi_event_handler	callback,
+				 void *			user_data);
+extern vbi_bool
+_vbi_cc_data_decoder_add_event_handler
+				(_vbi_cc_data_decoder *	cd,
+				 unsigned int		event_mask,
+				 vbi_event_handler	callback,
+				 void *			user_data);
+extern void
+_vbi_cc_data_decoder_reset	(_vbi_cc_data_decoder *	cd);
+extern void
+_vbi_cc_data_decoder_delete	(_vbi_cc_data_decoder *	cd);
+extern _vbi_cc_data_decoder *
+_vbi_cc_data_decoder_new	(void);
+
+/* Private */
+
+VBI_END_DECLS
+
+#endif /* __ZVBI_DTVCC_DECODER_H__ */
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -719,6 +719,10 @@ typedef struct {
 struct _vbi_event_cc608_page;
 struct _vbi_event_cc608_stream;
 
+/* Experimental CEA 708 decoder. */
+#define _VBI_EVENT_DTVCC_STREAM 0x4000
+struct _vbi_event_dtvcc_stream;
+
 /**
  * @example examples/network.c
  * Network identification example.
@@ -758,6 +762,7 @@ typedef struct vbi_event {
 		/* Experimental. */
 		struct _vbi_event_cc608_page *		_cc608;
 		struct _vbi_event_cc608_stream *	_cc608_stream;
+		struct _vbi_event_dtvcc_stream *	_dtvcc_stream;
 	}			ev;
 } vbi_event;
 
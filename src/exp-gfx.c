@@ -55,6 +55,16 @@
 
 #define CCPL (ccfont2_width / CCW * ccfont2_height / CCH)
 
+/* Pixel masks for expand_row(), in memory order. expand_8[n] has
+   byte i set to 0xFF if bit i of n is set, expand_8x2[n] has bytes
+   2i and 2i + 1 set if bit i of n is set, and expand_16[n] has
+   16 bit pixel i set if bit i of n is set. expand_32[n][i] is
+   the mask of 32 bit pixel i. */
+static uint32_t expand_8[16];
+static uint32_t expand_8x2[4];
+static uint32_t expand_16[4];
+static uint32_t expand_32[16][4];
+
 static void init_gfx(void) __attribute__ ((constructor));
 
 static void
@@ -63,6 +73,28 @@ init_gfx(void)
 	uint8_t *t, *p;
 	int i, j;
 
+	for (i = 0; i < 16; i++) {
+		uint8_t b[4];
+		uint16_t h[2];
+
+		for (j = 0; j < 4; j++) {
+			b[j] = (i & (1 << j)) ? 0xFF : 0x00;
+			expand_32[i][j] = (i & (1 << j)) ? 0xFFFFFFFF : 0;
+		}
+		memcpy(&expand_8[i], b, 4);
+
+		if (i >= 4)
+			continue;
+
+		for (j = 0; j < 4; j++)
+			b[j] = (i & (1 << (j >> 1))) ? 0xFF : 0x00;
+		memcpy(&expand_8x2[i], b, 4);
+
+		for (j = 0; j < 2; j++)
+			h[j] = (i & (1 << j)) ? 0xFFFF : 0x0000;
+		memcpy(&expand_16[i], h, 4);
+	}
+
 	/* de-interleave font image (puts all chars in row 0) */
 
 	if (!(t = malloc(wstfont2_width * wstfont2_height / 8)))
@@ -238,6 +270,83 @@ slant:
     ((canvas_type == sizeof(uint16_t)) ? (((uint16_t *)(p))[i] = (v)) :	\
 	(((uint32_t *)(p))[i] = (v))))
 
+/**
+ * @internal
+ * @param canvas_type sizeof(char, short, int).
+ * @param canvas Pointer to the image row where the pixels are to be drawn.
+ * @param bits Glyph row, first pixel in bit 0, bit '1' is foreground.
+ * @param n_pixels Number of bits in @a bits, a multiple of four.
+ * @param bg Background color value of @a canvas_type.
+ * @param fg Foreground color value of @a canvas_type.
+ * @param double_width Draw each pixel twice.
+ *
+ * Expands one glyph row to @a canvas. Instead of storing pixels one
+ * at a time, this selects between @a fg and @a bg with masks covering
+ * 32 bits of the row, so 8 and 16 bit canvases get four or two
+ * pixels per store.
+ */
+static inline void
+expand_row(int canvas_type, uint8_t *canvas, unsigned int bits,
+	   int n_pixels, unsigned int bg, unsigned int fg,
+	   vbi_bool double_width)
+{
+	uint32_t bgw, xorw, v;
+	int x;
+
+	if (canvas_type == sizeof(uint8_t)) {
+		bgw = bg * 0x01010101;
+		xorw = (fg * 0x01010101) ^ bgw;
+
+		if (double_width) {
+			for (x = 0; x < n_pixels * 2; bits >>= 2, x += 4) {
+				v = bgw ^ (xorw & expand_8x2[bits & 3]);
+				memcpy(canvas + x, &v, 4);
+			}
+		} else {
+			for (x = 0; x < n_pixels; bits >>= 4, x += 4) {
+				v = bgw ^ (xorw & expand_8[bits & 15]);
+				memcpy(canvas + x, &v, 4);
+			}
+		}
+	} else if (canvas_type == sizeof(uint16_t)) {
+		bgw = bg * 0x00010001;
+		xorw = (fg * 0x00010001) ^ bgw;
+
+		if (double_width) {
+			for (x = 0; x < n_pixels * 4; bits >>= 1, x += 4) {
+				v = bgw ^ (xorw & -(bits & 1));
+				memcpy(canvas + x, &v, 4);
+			}
+		} else {
+			for (x = 0; x < n_pixels * 2; bits >>= 2, x += 4) {
+				v = bgw ^ (xorw & expand_16[bits & 3]);
+				memcpy(canvas + x, &v, 4);
+			}
+		}
+	} else {
+		uint32_t *d = (uint32_t *) canvas;
+
+		xorw = fg ^ bg;
+
+		if (double_width) {
+			for (x = 0; x < n_pixels * 2; bits >>= 1, x += 2) {
+				v = bg ^ (xorw & -(bits & 1));
+				d[x + 0] = v;
+				d[x + 1] = v;
+			}
+		} else {
+			for (x = 0; x < n_pixels; bits >>= 4, x += 4) {
+				const uint32_t *m = expand_32[bits & 15];
+
+				d[x + 0] = bg ^ (xorw & m[0]);
+				d[x + 1] = bg ^ (xorw & m[1]);
+				d[x + 2] = bg ^ (xorw & m[2]);
+				d[x + 3] = bg ^ (xorw & m[3]);
+			}
+		}
+	}
+}
+
 /**
  * @internal
  * @param canvas_type sizeof(char, short, int).
@@ -269,99 +378,74 @@ draw_char(int canvas_type, uint8_t *canvas, int rowstride,
 	  int glyph, int bold, unsigned int underline, vbi_size size)
 {
 	uint8_t *src;
+	unsigned int bg, fg;
+	vbi_bool double_width, double_height;
 	int shift, x, y;
 
 	bold = !!bold;
-	assert(cw >= 8 && cw <= 16);
+	assert(cw >= 8 && cw <= 16 && 0 == (cw & 3));
 	assert(ch >= 1 && cw <= 31);
 
 	x = glyph * cw;
 	shift = x & 7;
 	src = font + (x >> 3);
 
+	double_width = FALSE;
+	double_height = FALSE;
+
 	switch (size) {
-	case VBI_DOUBLE_HEIGHT2:
+	case VBI_NORMAL_SIZE:
+		break;
+
+	case VBI_DOUBLE_WIDTH:
+		double_width = TRUE;
+		break;
+
 	case VBI_DOUBLE_SIZE2:
+		double_width = TRUE;
+		/* fall through */
+
+	case VBI_DOUBLE_HEIGHT2:
 		src += cpl * cw / 8 * ch / 2;
 		underline >>= ch / 2;
+		double_height = TRUE;
+		ch >>= 1;
+		break;
+
+	case VBI_DOUBLE_SIZE:
+		double_width = TRUE;
+		/* fall through */
 
 	case VBI_DOUBLE_HEIGHT:
-	case VBI_DOUBLE_SIZE: 
+		double_height = TRUE;
 		ch >>= 1;
+		break;
 
 	default:
-		break;
+		return;
 	}
 
+	bg = peek(pen, 0);
+	fg = peek(pen, 1);
+
 	for (y = 0; y < ch; underline >>= 1, y++) {
-		int bits = ~0;
+		unsigned int bits = ~0;
 
 		if (!(underline & 1)) {
-#ifdef __GNUC__
-/* FIXME #cpu is deprecated
-#if #cpu (i386)
-			bits = (*((uint16_t *) src) >> shift);
-#else*/
-                        /* unaligned/little endian */
-			bits = ((src[1] * 256 + src[0]) >> shift);
-/*#endif*/
-#else
+			/* unaligned/little endian */
 			bits = ((src[1] * 256 + src[0]) >> shift);
-#endif
 			bits |= bits << bold;
 		}
 
-		switch (size) {
-		case VBI_NORMAL_SIZE:
-			for (x = 0; x < cw; bits >>= 1, x++)
-				poke(canvas, x, peek(pen, bits & 1));
-
-			canvas += rowstride;
-
-			break;
-
-		case VBI_DOUBLE_HEIGHT:
-		case VBI_DOUBLE_HEIGHT2:
-			for (x = 0; x < cw; bits >>= 1, x++) {
-				unsigned int col = peek(pen, bits & 1);
-
-				poke(canvas, x, col);
-				poke(canvas, x + rowstride / canvas_type, col);
-			}
+		expand_row(canvas_type, canvas, bits, cw,
+			   bg, fg, double_width);
 
+		if (double_height) {
+			memcpy(canvas + rowstride, canvas,
+			       cw * canvas_type << double_width);
 			canvas += rowstride * 2;
-
-			break;
-
-		case VBI_DOUBLE_WIDTH:
-			for (x = 0; x < cw * 2; bits >>= 1, x += 2) {
-				unsigned int col = peek(pen, bits & 1);
-
-				poke(canvas, x + 0, col);
-				poke(canvas, x + 1, col);
-			}
-
+		} else {
 			canvas += rowstride;
-
-			break;
-
-		case VBI_DOUBLE_SIZE:
-		case VBI_DOUBLE_SIZE2:
-			for (x = 0; x < cw * 2; bits >>= 1, x += 2) {
-				unsigned int col = peek(pen, bits & 1);
-
-				poke(canvas, x + 0, col);
-				poke(canvas, x + 1, col);
-				poke(canvas, x + rowstride / canvas_type + 0, col);
-				poke(canvas, x + rowstride / canvas_type + 1, col);
-			}
-
-			canvas += rowstride * 2;
-
-			break;
-
-		default:
-			break;
 		}
 
 		src += cpl * cw / 8;
@@ -395,71 +479,72 @@ draw_drcs(int canvas_type, uint8_t *canvas, unsigned int rowstride,
 {
 	uint8_t *src;
 	unsigned int col;
-	int x, y;
+	vbi_bool double_width, double_height;
+	int x, y, ch;
 
 	src = font + glyph * 60;
 	pen = pen + color * canvas_type;
 
+	double_width = FALSE;
+	double_height = FALSE;
+	ch = TCH;
+
 	switch (size) {
 	case VBI_NORMAL_SIZE:
-		for (y = 0; y < TCH; canvas += rowstride, y++)
-			for (x = 0; x < 12; src++, x += 2) {
-				poke(canvas, x + 0, peek(pen, *src & 15));
-				poke(canvas, x + 1, peek(pen, *src >> 4));
-			}
 		break;
 
-	case VBI_DOUBLE_HEIGHT2:
-		src += 30;
+	case VBI_DOUBLE_WIDTH:
+		double_width = TRUE;
+		break;
 
-	case VBI_DOUBLE_HEIGHT:
-		for (y = 0; y < TCH / 2; canvas += rowstride * 2, y++)
-			for (x = 0; x < 12; src++, x += 2) {
-				col = peek(pen, *src & 15);
-				poke(canvas, x + 0, col);
-				poke(canvas, x + rowstride / canvas_type + 0, col);
+	case VBI_DOUBLE_SIZE2:
+		double_width = TRUE;
+		/* fall through */
 
-				col = peek(pen, *src >> 4);
-				poke(canvas, x + 1, col);
-				poke(canvas, x + rowstride / canvas_type + 1, col);
-			}
+	case VBI_DOUBLE_HEIGHT2:
+		src += 30;
+		double_height = TRUE;
+		ch = TCH / 2;
 		break;
 
-	case VBI_DOUBLE_WIDTH:
-		for (y = 0; y < TCH; canvas += rowstride, y++)
-			for (x = 0; x < 12 * 2; src++, x += 4) {
-				col = peek(pen, *src & 15);
-				poke(canvas, x + 0, col);
-				poke(canvas, x + 1, col);
+	case VBI_DOUBLE_SIZE:
+		double_width = TRUE;
+		/* fall through */
 
-				col = peek(pen, *src >> 4);
-				poke(canvas, x + 2, col);
-				poke(canvas, x + 3, col);
-			}
+	case VBI_DOUBLE_HEIGHT:
+		double_height = TRUE;
+		ch = TCH / 2;
 		break;
 
-	case VBI_DOUBLE_SIZE2:
-		src += 30;
+	default:
+		return;
+	}
 
-	case VBI_DOUBLE_SIZE:
-		for (y = 0; y < TCH / 2; canvas += rowstride * 2, y++)
+	for (y = 0; y < ch; y++) {
+		if (double_width) {
 			for (x = 0; x < 12 * 2; src++, x += 4) {
 				col = peek(pen, *src & 15);
 				poke(canvas, x + 0, col);
 				poke(canvas, x + 1, col);
-				poke(canvas, x + rowstride / canvas_type + 0, col);
-				poke(canvas, x + rowstride / canvas_type + 1, col);
 
 				col = peek(pen, *src >> 4);
 				poke(canvas, x + 2, col);
 				poke(canvas, x + 3, col);
-				poke(canvas, x + rowstride / canvas_type + 2, col);
-				poke(canvas, x + rowstride / canvas_type + 3, col);
 			}
-		break;
+		} else {
+			for (x = 0; x < 12; src++, x += 2) {
+				poke(canvas, x + 0, peek(pen, *src & 15));
+				poke(canvas, x + 1, peek(pen, *src >> 4));
+			}
+		}
 
-	default:
-		break;
+		if (double_height) {
+			memcpy(canvas + rowstride, canvas,
+			       TCW * canvas_type << double_width);
+			canvas += rowstride * 2;
+		} else {
+			canvas += rowstride;
+		}
 	}
 }
 
@@ -480,33 +565,19 @@ draw_blank(int canvas_type, uint8_t *canvas, unsigned int rowstride,
 {
 	int x, y;
 
-	for (y = 0; y < ch; y++) {
-		for (x = 0; x < cw; x++)
-			poke(canvas, x, color);
+	for (x = 0; x < cw; x++)
+		poke(canvas, x, color);
 
+	for (y = 1; y < ch; y++) {
+		memcpy(canvas + rowstride, canvas, cw * canvas_type);
 		canvas += rowstride;
 	}
 }
 
-/**
- * @param pg Source vbi_page, see vbi_fetch_cc_page().
- * @param fmt Target format. For now only VBI_PIXFMT_RGBA32_LE (vbi_rgba) permitted.
- * @param canvas Pointer to destination image (currently an array of vbi_rgba), this
- *   must be at least @a rowstride * @a height * 26 bytes large.
- * @param rowstride @a canvas <em>byte</em> distance from line to line.
- *   If this is -1, pg->columns * 16 * sizeof(vbi_rgba) bytes will be assumed.
- * @param column First source column, 0 ... pg->columns - 1.
- * @param row First source row, 0 ... pg->rows - 1.
- * @param width Number of columns to draw, 1 ... pg->columns.
- * @param height Number of rows to draw, 1 ... pg->rows.
- * 
- * Draw a subsection of a Closed Caption vbi_page. In this mode one
- * character occupies 16 x 26 pixels.
- */
-void
-vbi_draw_cc_page_region(vbi_page *pg,
-			vbi_pixfmt fmt, void *canvas, int rowstride,
-			int column, int row, int width, int height)
+static inline void
+draw_cc_page_region(int canvas_type, vbi_page *pg,
+		    void *canvas, int rowstride,
+		    int column, int row, int width, int height)
 {
         union {
 	        vbi_rgba        rgba[2];
@@ -514,15 +585,6 @@ vbi_draw_cc_page_region(vbi_page *pg,
         } pen;
 	int count, row_adv;
 	vbi_char *ac;
-        int canvas_type;
-
-	if (fmt == VBI_PIXFMT_RGBA32_LE) {
-                canvas_type = 4;
-	} else if (fmt == VBI_PIXFMT_PAL8) {
-                canvas_type = 1;
-        } else {
-		return;
-        }
 
 	if (0) {
 		int i, j;
@@ -577,32 +639,255 @@ vbi_draw_cc_page_region(vbi_page *pg,
 }
 
 /**
- * @param pg Source page.
- * @param fmt Target format. For now only VBI_PIXFMT_RGBA32_LE (vbi_rgba) and
- *   VBI_PIXFMT_PAL8 (1-byte palette indices) are permitted.
- * @param canvas Pointer to destination image (depending on the format, either
- *   an array of vbi_rgba or uint8_t), this must be at least
- *   @a rowstride * @a height * 10 bytes large.
+ * @param pg Source vbi_page, see vbi_fetch_cc_page().
+ * @param fmt Target format. For now only VBI_PIXFMT_RGBA32_LE (vbi_rgba) permitted.
+ * @param canvas Pointer to destination image (currently an array of vbi_rgba), this
+ *   must be at least @a rowstride * @a height * 26 bytes large.
  * @param rowstride @a canvas <em>byte</em> distance from line to line.
- *   If this is -1, pg->columns * 12 * sizeof(vbi_rgba) bytes will be assumed.
+ *   If this is -1, pg->columns * 16 * sizeof(vbi_rgba) bytes will be assumed.
  * @param column First source column, 0 ... pg->columns - 1.
  * @param row First source row, 0 ... pg->rows - 1.
  * @param width Number of columns to draw, 1 ... pg->columns.
  * @param height Number of rows to draw, 1 ... pg->rows.
- * @param reveal If FALSE, draw characters flagged 'concealed' (see vbi_char) as
- *   space (U+0020).
- * @param flash_on If FALSE, draw characters flagged 'blink' (see vbi_char) as
- *   space (U+0020).
  * 
- * Draw a subsection of a Teletext vbi_page. In this mode one
- * character occupies 12 x 10 pixels.  Note this function does
- * not consider transparency (e.g. on boxed pages)
+ * Draw a subsection of a Closed Caption vbi_page. In this mode one
+ * character occupies 16 x 26 pixels.
  */
 void
-vbi_draw_vt_page_region(vbi_page *pg,
+vbi_draw_cc_page_region(vbi_page *pg,
 			vbi_pixfmt fmt, void *canvas, int rowstride,
-			int column, int row, int width, int height,
-			int reveal, int flash_on)
+			int column, int row, int width, int height)
+{
+	/* Constant canvas_type, so the compiler can specialize
+	   draw_char() for each format. */
+	if (fmt == VBI_PIXFMT_RGBA32_LE) {
+		draw_cc_page_region(sizeof(vbi_rgba), pg, canvas, rowstride,
+				    column, row, width, height);
+	} else if (fmt == VBI_PIXFMT_PAL8) {
+		draw_cc_page_region(sizeof(uint8_t), pg, canvas, rowstride,
+				    column, row, width, height);
+	}
+}
+
+/*
+ *  Glyph atlas
+ */
+
+struct glyph_tile {
+	/* Key. */
+	uint32_t		fg;
+	uint32_t		bg;
+	uint16_t		glyph;
+	uint8_t			attr;
+
+	/* Zero if the entry is unused. */
+	uint8_t			used;
+
+	/* Offset of the tile in vbi_glyph_atlas->tiles. */
+	unsigned int		offset;
+};
+
+struct _vbi_glyph_atlas {
+	/* sizeof(char, int), see draw_char(). */
+	int			canvas_type;
+
+	/* TCW * TCH pixels of canvas_type. */
+	unsigned int		tile_size;
+
+	/* Open addressing hash table, a power of two entries. */
+	struct glyph_tile *	table;
+	unsigned int		table_mask;
+
+	uint8_t *		tiles;
+	unsigned int		n_tiles;
+	unsigned int		max_tiles;
+
+	vbi_bool		read_only;
+};
+
+/**
+ * @internal
+ * @param atlas Glyph atlas.
+ * @param glyph Glyph number in wstfont2 image.
+ * @param attr Bit 0 bold, bit 1 underline.
+ * @param pen Pen of @a atlas->canvas_type, index 0 background,
+ *   index 1 foreground.
+ *
+ * Returns a pointer to the pre-rendered normal size character cell
+ * or @c NULL if not in the atlas. Unless the atlas is read-only,
+ * renders and adds missing cells while space is available.
+ */
+static inline const uint8_t *
+glyph_atlas_tile(vbi_glyph_atlas *atlas, int canvas_type,
+		 unsigned int glyph, unsigned int attr, uint8_t *pen)
+{
+	struct glyph_tile *t;
+	uint32_t bg, fg, hash;
+	uint8_t *tile;
+
+	bg = peek(pen, 0);
+	fg = peek(pen, 1);
+
+	hash = (glyph * 4 + attr) * 0x9E3779B1;
+	hash ^= (fg * 0x85EBCA6B) ^ (bg * 0xC2B2AE35);
+	hash ^= hash >> 15;
+
+	for (;; hash++) {
+		t = &atlas->table[hash & atlas->table_mask];
+
+		if (!t->used)
+			break;
+
+		if (t->glyph == glyph && t->attr == attr
+		    && t->fg == fg && t->bg == bg)
+			return atlas->tiles + t->offset;
+	}
+
+	if (atlas->read_only || atlas->n_tiles >= atlas->max_tiles)
+		return NULL;
+
+	tile = atlas->tiles + atlas->n_tiles * atlas->tile_size;
+
+	draw_char(canvas_type, tile, TCW * canvas_type, pen,
+		  (uint8_t *) wstfont2_bits, TCPL, TCW, TCH,
+		  glyph, attr & 1, (attr & 2) << 8 /* cell row 9 */,
+		  VBI_NORMAL_SIZE);
+
+	t->fg = fg;
+	t->bg = bg;
+	t->glyph = glyph;
+	t->attr = attr;
+	t->used = 1;
+	t->offset = tile - atlas->tiles;
+
+	++atlas->n_tiles;
+
+	return tile;
+}
+
+/**
+ * @param atlas Glyph atlas allocated with vbi_glyph_atlas_new().
+ * @param read_only @c TRUE to stop adding glyphs to the atlas.
+ *
+ * By default vbi_draw_vt_page_region_cached() adds glyphs missing in
+ * the atlas as it draws. In read-only mode it renders missing glyphs
+ * directly into the canvas instead, never modifying the atlas, so
+ * multiple threads can draw with the same atlas concurrently.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_glyph_atlas_set_read_only(vbi_glyph_atlas *atlas, vbi_bool read_only)
+{
+	assert(NULL != atlas);
+
+	atlas->read_only = !!read_only;
+}
+
+/**
+ * @param atlas Glyph atlas allocated with vbi_glyph_atlas_new().
+ *
+ * Returns the number of character cells stored in the atlas.
+ *
+ * @since 0.2.36
+ */
+unsigned int
+vbi_glyph_atlas_num_tiles(const vbi_glyph_atlas *atlas)
+{
+	assert(NULL != atlas);
+
+	return atlas->n_tiles;
+}
+
+/**
+ * @param atlas Glyph atlas allocated with vbi_glyph_atlas_new(),
+ *   can be @c NULL.
+ *
+ * Frees all resources associated with @a atlas.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_glyph_atlas_delete(vbi_glyph_atlas *atlas)
+{
+	if (NULL == atlas)
+		return;
+
+	free(atlas->tiles);
+	free(atlas->table);
+
+	CLEAR(*atlas);
+
+	free(atlas);
+}
+
+/**
+ * @param fmt Pixel format of the pre-rendered glyphs. For now only
+ *   VBI_PIXFMT_RGBA32_LE (vbi_rgba) and VBI_PIXFMT_PAL8 (1-byte palette
+ *   indices) are permitted.
+ * @param max_tiles Maximum number of character cells to store. Each
+ *   cell of a Teletext page with a distinct glyph, foreground and
+ *   background color, bold and underline attribute needs one
+ *   12 x 10 pixel tile. Zero selects a default of 4096.
+ *
+ * Allocates a glyph atlas for vbi_draw_vt_page_region_cached(). The
+ * atlas caches rendered Teletext characters, so drawing a character
+ * again becomes a block copy. Since tiles are keyed by the actual
+ * color values rather than vbi_color indices, one atlas can be
+ * used with pages of different palettes.
+ *
+ * @returns
+ * @c NULL on failure (invalid @a fmt or out of memory).
+ *
+ * @since 0.2.36
+ */
+vbi_glyph_atlas *
+vbi_glyph_atlas_new(vbi_pixfmt fmt, unsigned int max_tiles)
+{
+	vbi_glyph_atlas *atlas;
+	unsigned int table_size;
+
+	if (0 == max_tiles)
+		max_tiles = 4096;
+	else if (max_tiles > (1 << 20))
+		return NULL;
+
+	if (!(atlas = calloc(1, sizeof(*atlas))))
+		return NULL;
+
+	if (fmt == VBI_PIXFMT_RGBA32_LE) {
+		atlas->canvas_type = sizeof(vbi_rgba);
+	} else if (fmt == VBI_PIXFMT_PAL8) {
+		atlas->canvas_type = sizeof(uint8_t);
+	} else {
+		free(atlas);
+		return NULL;
+	}
+
+	/* At most half full. */
+	for (table_size = 16; table_size < max_tiles * 2;)
+		table_size *= 2;
+
+	atlas->tile_size = TCW * TCH * atlas->canvas_type;
+	atlas->table_mask = table_size - 1;
+	atlas->max_tiles = max_tiles;
+
+	atlas->table = calloc(table_size, sizeof(*atlas->table));
+	atlas->tiles = malloc(max_tiles * atlas->tile_size);
+
+	if (!atlas->table || !atlas->tiles) {
+		vbi_glyph_atlas_delete(atlas);
+		return NULL;
+	}
+
+	return atlas;
+}
+
+static inline void
+draw_vt_page_region(int canvas_type, vbi_glyph_atlas *atlas, vbi_page *pg,
+		    void *canvas, int rowstride,
+		    int column, int row, int width, int height,
+		    int reveal, int flash_on)
 {
         union {
 	        vbi_rgba        rgba[64];
@@ -611,17 +896,8 @@ vbi_draw_vt_page_region(vbi_page *pg,
 	int count, row_adv;
 	int conceal, off, unicode;
 	vbi_char *ac;
-        int canvas_type;
 	int i;
 
-	if (fmt == VBI_PIXFMT_RGBA32_LE) {
-                canvas_type = 4;
-	} else if (fmt == VBI_PIXFMT_PAL8) {
-                canvas_type = 1;
-        } else {
-		return;
-        }
-
 	if (0) {
 		int i, j;
 
@@ -684,16 +960,33 @@ vbi_draw_vt_page_region(vbi_page *pg,
 							   ((canvas_type == 1) ? pen.pal8[0]: pen.rgba[0]),
                                                            TCW, TCH);
 				} else {
-					draw_char (canvas_type,
-						   canvas,
-						   rowstride,
-						   (uint8_t *) &pen,
-						   (uint8_t *) wstfont2_bits,
-						   TCPL, TCW, TCH,
-						   unicode_wstfont2 (unicode, ac->italic),
-						   ac->bold,
-						   ac->underline << 9 /* cell row 9 */,
-						   ac->size);
+					unsigned int glyph =
+						unicode_wstfont2 (unicode, ac->italic);
+					const uint8_t *tile = NULL;
+
+					if (atlas && VBI_NORMAL_SIZE == ac->size)
+						tile = glyph_atlas_tile (atlas, canvas_type,
+									 glyph,
+									 ac->bold
+									 | (ac->underline << 1),
+									 (uint8_t *) &pen);
+					if (tile) {
+						for (i = 0; i < TCH; i++)
+							memcpy ((uint8_t *) canvas + i * rowstride,
+								tile + i * TCW * canvas_type,
+								TCW * canvas_type);
+					} else {
+						draw_char (canvas_type,
+							   canvas,
+							   rowstride,
+							   (uint8_t *) &pen,
+							   (uint8_t *) wstfont2_bits,
+							   TCPL, TCW, TCH,
+							   glyph,
+							   ac->bold,
+							   ac->underline << 9 /* cell row 9 */,
+							   ac->size);
+					}
 				}
 			}
 
@@ -704,6 +997,386 @@ vbi_draw_vt_page_region(vbi_page *pg,
 	}
 }
 
+/**
+ * @param pg Source page.
+ * @param fmt Target format. For now only VBI_PIXFMT_RGBA32_LE (vbi_rgba) and
+ *   VBI_PIXFMT_PAL8 (1-byte palette indices) are permitted.
+ * @param canvas Pointer to destination image (depending on the format, either
+ *   an array of vbi_rgba or uint8_t), this must be at least
+ *   @a rowstride * @a height * 10 bytes large.
+ * @param rowstride @a canvas <em>byte</em> distance from line to line.
+ *   If this is -1, pg->columns * 12 * sizeof(vbi_rgba) bytes will be assumed.
+ * @param column First source column, 0 ... pg->columns - 1.
+ * @param row First source row, 0 ... pg->rows - 1.
+ * @param width Number of columns to draw, 1 ... pg->columns.
+ * @param height Number of rows to draw, 1 ... pg->rows.
+ * @param reveal If FALSE, draw characters flagged 'concealed' (see vbi_char) as
+ *   space (U+0020).
+ * @param flash_on If FALSE, draw characters flagged 'blink' (see vbi_char) as
+ *   space (U+0020).
+ * 
+ * Draw a subsection of a Teletext vbi_page. In this mode one
+ * character occupies 12 x 10 pixels.  Note this function does
+ * not consider transparency (e.g. on boxed pages)
+ */
+void
+vbi_draw_vt_page_region(vbi_page *pg,
+			vbi_pixfmt fmt, void *canvas, int rowstride,
+			int column, int row, int width, int height,
+			int reveal, int flash_on)
+{
+	if (fmt == VBI_PIXFMT_RGBA32_LE) {
+		draw_vt_page_region(sizeof(vbi_rgba), NULL, pg, canvas, rowstride,
+				    column, row, width, height,
+				    reveal, flash_on);
+	} else if (fmt == VBI_PIXFMT_PAL8) {
+		draw_vt_page_region(sizeof(uint8_t), NULL, pg, canvas, rowstride,
+				    column, row, width, height,
+				    reveal, flash_on);
+	}
+}
+
+/**
+ * @param atlas Glyph atlas allocated with vbi_glyph_atlas_new(). The
+ *   format of the canvas is the format of the atlas.
+ * @param pg Source page.
+ * @param canvas Pointer to destination image.
+ * @param rowstride @a canvas <em>byte</em> distance from line to line.
+ *   If this is -1, pg->columns * 12 * bytes per pixel will be assumed.
+ * @param column First source column, 0 ... pg->columns - 1.
+ * @param row First source row, 0 ... pg->rows - 1.
+ * @param width Number of columns to draw, 1 ... pg->columns.
+ * @param height Number of rows to draw, 1 ... pg->rows.
+ * @param reveal If FALSE, draw characters flagged 'concealed' (see vbi_char) as
+ *   space (U+0020).
+ * @param flash_on If FALSE, draw characters flagged 'blink' (see vbi_char) as
+ *   space (U+0020).
+ *
+ * Like vbi_draw_vt_page_region(), but copies normal size characters
+ * from @a atlas instead of rendering them, adding missing characters
+ * to the atlas unless it is read-only. DRCS and double size
+ * characters are always rendered directly.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_draw_vt_page_region_cached(vbi_glyph_atlas *atlas, vbi_page *pg,
+			       void *canvas, int rowstride,
+			       int column, int row, int width, int height,
+			       int reveal, int flash_on)
+{
+	assert(NULL != atlas);
+
+	if (atlas->canvas_type == sizeof(vbi_rgba)) {
+		draw_vt_page_region(sizeof(vbi_rgba), atlas, pg,
+				    canvas, rowstride,
+				    column, row, width, height,
+				    reveal, flash_on);
+	} else {
+		draw_vt_page_region(sizeof(uint8_t), atlas, pg,
+				    canvas, rowstride,
+				    column, row, width, height,
+				    reveal, flash_on);
+	}
+}
+
+static vbi_bool
+vt_drcs_clut_changed(int canvas_type,
+		     const vbi_page *old_pg, const vbi_page *pg)
+{
+	int i;
+
+	if (old_pg->drcs_clut == pg->drcs_clut)
+		return FALSE;
+
+	if (!old_pg->drcs_clut || !pg->drcs_clut)
+		return TRUE;
+
+	/* PAL8 canvases contain the CLUT entries themselves,
+	   RGBA canvases the colors they refer to. */
+	for (i = 2; i < 2 + 8 + 32; i++) {
+		if (canvas_type == 1) {
+			if (old_pg->drcs_clut[i] != pg->drcs_clut[i])
+				return TRUE;
+		} else {
+			if (old_pg->color_map[old_pg->drcs_clut[i]]
+			    != pg->color_map[pg->drcs_clut[i]])
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * @internal
+ * @return
+ * TRUE if the character cell @a ac of @a pg renders differently than
+ * @a oc of @a old_pg, considering the effective conceal and flash
+ * state of each page.
+ */
+static vbi_bool
+vt_cell_changed(const vbi_page *old_pg, const vbi_char *oc,
+		int old_conceal, int old_off,
+		const vbi_page *pg, const vbi_char *ac,
+		int conceal, int off, vbi_bool drcs_clut_changed)
+{
+	unsigned int old_unicode, unicode;
+
+	if ((oc->conceal & old_conceal) || (oc->flash & old_off))
+		old_unicode = 0x0020;
+	else
+		old_unicode = oc->unicode;
+
+	if ((ac->conceal & conceal) || (ac->flash & off))
+		unicode = 0x0020;
+	else
+		unicode = ac->unicode;
+
+	if (old_unicode != unicode
+	    || oc->size != ac->size
+	    || oc->opacity != ac->opacity
+	    || oc->underline != ac->underline
+	    || oc->bold != ac->bold
+	    || oc->italic != ac->italic
+	    || oc->foreground != ac->foreground
+	    || oc->background != ac->background
+	    || oc->drcs_clut_offs != ac->drcs_clut_offs)
+		return TRUE;
+
+	if (old_pg->color_map[oc->foreground] != pg->color_map[ac->foreground]
+	    || old_pg->color_map[oc->background] != pg->color_map[ac->background])
+		return TRUE;
+
+	if (vbi_is_drcs(unicode)) {
+		const uint8_t *old_font = old_pg->drcs[(unicode >> 6) & 0x1F];
+		const uint8_t *font = pg->drcs[(unicode >> 6) & 0x1F];
+
+		if (drcs_clut_changed)
+			return TRUE;
+
+		if (old_font != font) {
+			if (!old_font || !font)
+				return TRUE;
+
+			return (0 != memcmp(old_font + (unicode & 0x3F) * 60,
+					    font + (unicode & 0x3F) * 60, 60));
+		}
+	}
+
+	return FALSE;
+}
+
+static int
+add_damage_rect(vbi_rect *rects, int n_rects, int max_rects,
+		int x, int y, int width, int height)
+{
+	vbi_rect *r;
+
+	if (max_rects <= 0)
+		return 0;
+
+	if (n_rects > 0) {
+		r = &rects[n_rects - 1];
+
+		/* Merge with the same columns of the row above. */
+		if (r->x == x && r->width == width && r->y + r->height == y) {
+			r->height += height;
+			return n_rects;
+		}
+
+		/* Out of space, grow the last rectangle instead. */
+		if (n_rects >= max_rects) {
+			int x2 = MAX(r->x + r->width, x + width);
+			int y2 = MAX(r->y + r->height, y + height);
+
+			r->x = MIN(r->x, x);
+			r->y = MIN(r->y, y);
+			r->width = x2 - r->x;
+			r->height = y2 - r->y;
+
+			return n_rects;
+		}
+	}
+
+	r = &rects[n_rects];
+
+	r->x = x;
+	r->y = y;
+	r->width = width;
+	r->height = height;
+
+	return n_rects + 1;
+}
+
+/**
+ * @param old_pg The page previously drawn into @a canvas with
+ *   vbi_draw_vt_page() or this function. Can be @c NULL.
+ * @param old_reveal The @a reveal value used to draw @a old_pg.
+ * @param old_flash_on The @a flash_on value used to draw @a old_pg.
+ * @param pg The new page.
+ * @param fmt Target format. For now only VBI_PIXFMT_RGBA32_LE (vbi_rgba) and
+ *   VBI_PIXFMT_PAL8 (1-byte palette indices) are permitted.
+ * @param canvas Pointer to the destination image containing the
+ *   rendered @a old_pg, as in vbi_draw_vt_page_region() with
+ *   @a column and @a row zero.
+ * @param rowstride @a canvas <em>byte</em> distance from line to line.
+ *   If this is -1, pg->columns * 12 * sizeof(vbi_rgba) bytes will be assumed.
+ * @param reveal If FALSE, draw characters flagged 'concealed' (see vbi_char) as
+ *   space (U+0020).
+ * @param flash_on If FALSE, draw characters flagged 'blink' (see vbi_char) as
+ *   space (U+0020).
+ * @param rects The function stores the damaged areas of @a canvas here,
+ *   in pixels. Can be @c NULL if @a max_rects is zero.
+ * @param max_rects Capacity of the @a rects array. When more
+ *   rectangles are needed the last one grows to cover the rest.
+ *
+ * Incrementally updates a Teletext page image. Compares the character
+ * cells of @a old_pg and @a pg, including the effect of the reveal and
+ * flash state, and redraws only the cells which changed. This is much
+ * faster than redrawing the entire page when only a few characters
+ * change, as on clock or ticker pages.
+ *
+ * When @a old_pg is @c NULL or has a different size than @a pg the
+ * entire page is redrawn.
+ *
+ * @returns
+ * The number of rectangles stored in @a rects, zero if nothing
+ * changed.
+ *
+ * @since 0.2.36
+ */
+int
+vbi_draw_vt_page_update(const vbi_page *old_pg,
+			int old_reveal, int old_flash_on,
+			vbi_page *pg, vbi_pixfmt fmt,
+			void *canvas, int rowstride,
+			int reveal, int flash_on,
+			vbi_rect *rects, int max_rects)
+{
+	uint8_t dirty[N_ELEMENTS(pg->text)];
+	vbi_bool drcs_clut_changed;
+	int canvas_type;
+	int n_rects;
+	int row, column;
+
+	if (fmt == VBI_PIXFMT_RGBA32_LE) {
+		canvas_type = sizeof(vbi_rgba);
+	} else if (fmt == VBI_PIXFMT_PAL8) {
+		canvas_type = sizeof(uint8_t);
+	} else {
+		return 0;
+	}
+
+	if (rowstride == -1)
+		rowstride = pg->columns * TCW * canvas_type;
+
+	if (!old_pg
+	    || old_pg->rows != pg->rows
+	    || old_pg->columns != pg->columns) {
+		vbi_draw_vt_page_region(pg, fmt, canvas, rowstride,
+					0, 0, pg->columns, pg->rows,
+					reveal, flash_on);
+
+		return add_damage_rect(rects, 0, max_rects, 0, 0,
+				       pg->columns * TCW, pg->rows * TCH);
+	}
+
+	drcs_clut_changed = vt_drcs_clut_changed(canvas_type,
+							  old_pg, pg);
+
+	memset(dirty, 0, pg->rows * pg->columns);
+
+	for (row = 0; row < pg->rows; row++) {
+		const vbi_char *oc = &old_pg->text[row * pg->columns];
+		const vbi_char *ac = &pg->text[row * pg->columns];
+		uint8_t *d = &dirty[row * pg->columns];
+
+		for (column = 0; column < pg->columns; column++) {
+			if (!vt_cell_changed(old_pg, &oc[column],
+					     !old_reveal, !old_flash_on,
+					     pg, &ac[column],
+					     !reveal, !flash_on,
+					     drcs_clut_changed))
+				continue;
+
+			d[column] = 1;
+
+			/* Double width and height characters also
+			   cover the next column and/or row. */
+			switch (ac[column].size) {
+			case VBI_DOUBLE_SIZE:
+				if (row + 1 < pg->rows
+				    && column + 1 < pg->columns)
+					d[pg->columns + column + 1] = 1;
+				/* fall through */
+
+			case VBI_DOUBLE_HEIGHT:
+				if (row + 1 < pg->rows)
+					d[pg->columns + column] = 1;
+				if (VBI_DOUBLE_HEIGHT == ac[column].size)
+					break;
+				/* fall through */
+
+			case VBI_DOUBLE_WIDTH:
+				if (column + 1 < pg->columns)
+					d[column + 1] = 1;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	n_rects = 0;
+
+	for (row = 0; row < pg->rows; row++) {
+		const uint8_t *d = &dirty[row * pg->columns];
+
+		for (column = 0; column < pg->columns;) {
+			int first;
+
+			if (!d[column]) {
+				column++;
+				continue;
+			}
+
+			first = column;
+
+			while (column < pg->columns && d[column])
+				column++;
+
+			if (canvas_type == sizeof(vbi_rgba)) {
+				draw_vt_page_region(sizeof(vbi_rgba), NULL, pg,
+						    (uint8_t *) canvas
+						    + row * TCH * rowstride
+						    + first * TCW
+						    * sizeof(vbi_rgba),
+						    rowstride,
+						    first, row,
+						    column - first, 1,
+						    reveal, flash_on);
+			} else {
+				draw_vt_page_region(sizeof(uint8_t), NULL, pg,
+						    (uint8_t *) canvas
+						    + row * TCH * rowstride
+						    + first * TCW,
+						    rowstride,
+						    first, row,
+						    column - first, 1,
+						    reveal, flash_on);
+			}
+
+			n_rects = add_damage_rect(rects, n_rects, max_rects,
+						  first * TCW, row * TCH,
+						  (column - first) * TCW, TCH);
+		}
+	}
+
+	return n_rects;
+}
+
 /*
  *  This won't scale with proportional spacing or custom fonts,
  *  to be removed.
@@ -770,6 +1443,18 @@ typedef struct gfx_instance
          *  use transparent background for boxed pages. This option
          *  can be used to define transparent areas as black.
          */
+
+	/* PNG only options */
+	int			png_level;
+	unsigned int		png_filter;
+	unsigned int		png_strategy;
+	unsigned		png_compact : 1;
+
+	/* Image and row pointer buffers retained across pages. */
+	uint8_t *		image;
+	size_t			image_size;
+	void **			row_pointer;
+	size_t			row_pointer_size;
 } gfx_instance;
 
 static vbi_export *
@@ -786,7 +1471,11 @@ gfx_new(void)
 static void
 gfx_delete(vbi_export *e)
 {
-	free(PARENT(e, gfx_instance, export));
+	gfx_instance *gfx = PARENT(e, gfx_instance, export);
+
+	free(gfx->row_pointer);
+	free(gfx->image);
+	free(gfx);
 }
 
 
@@ -820,6 +1509,62 @@ option_enum(vbi_export *e, int index)
 		return gfx_options + index;
 }
 
+static const char *
+png_filters[] = {
+	/* TRANSLATORS: PNG row filter menu. */
+	N_("Default"), N_("None"), N_("Sub"), N_("Up"),
+	N_("Average"), N_("Paeth"), N_("Adaptive")
+};
+
+static const char *
+png_strategies[] = {
+	/* TRANSLATORS: zlib compression strategy menu. */
+	N_("Default"), N_("Filtered"), N_("Huffman only"), N_("RLE")
+};
+
+#ifdef HAVE_LIBPNG
+
+static vbi_option_info
+png_options[] = {
+	VBI_OPTION_INT_RANGE_INITIALIZER
+	  ("compression", N_("Compression level"),
+	   6, 0, 9, 1, N_("Zlib compression level from 0 (fastest) "
+			  "to 9 (smallest files).")),
+	VBI_OPTION_MENU_INITIALIZER
+	  ("filter", N_("Row filter"),
+	   0, png_filters, elements(png_filters),
+	   N_("Row filter applied before compression. "
+	      "Palette images usually compress best without.")),
+	VBI_OPTION_MENU_INITIALIZER
+	  ("strategy", N_("Compression strategy"),
+	   0, png_strategies, elements(png_strategies),
+	   N_("RLE is much faster and works well on Teletext pages.")),
+	VBI_OPTION_BOOL_INITIALIZER
+	  ("compact", N_("Compact palette"),
+	   FALSE, N_("Store only the colors used in the image, with "
+		     "the smallest possible bit depth."))
+};
+
+static vbi_option_info *
+option_enum_png(vbi_export *e, int index)
+{
+	e = e;
+
+	if (index < 0)
+		return NULL;
+	else if (index < (int) elements(gfx_options))
+		return gfx_options + index;
+
+	index -= elements(gfx_options);
+
+	if (index >= (int) elements(png_options))
+		return NULL;
+	else
+		return png_options + index;
+}
+
+#endif /* HAVE_LIBPNG */
+
 static vbi_option_info *
 option_enum_ppm(vbi_export *e, int index)
 {
@@ -842,6 +1587,14 @@ option_get(vbi_export *e, const char *keyword, vbi_option_value *value)
 		value->num = gfx->titled;
 	} else if (strcmp(keyword, "transparency") == 0) {
 		value->num = gfx->transparency;
+	} else if (strcmp(keyword, "compression") == 0) {
+		value->num = gfx->png_level;
+	} else if (strcmp(keyword, "filter") == 0) {
+		value->num = gfx->png_filter;
+	} else if (strcmp(keyword, "strategy") == 0) {
+		value->num = gfx->png_strategy;
+	} else if (strcmp(keyword, "compact") == 0) {
+		value->num = gfx->png_compact;
 	} else {
 		vbi_export_unknown_option(e, keyword);
 		return FALSE;
@@ -861,6 +1614,32 @@ option_set(vbi_export *e, const char *keyword, va_list args)
 		gfx->titled = !!va_arg(args, int);
 	} else if (strcmp(keyword, "transparency") == 0) {
 		gfx->transparency = !!va_arg(args, int);
+	} else if (strcmp(keyword, "compression") == 0) {
+		int level = va_arg(args, int);
+
+		if (level < 0 || level > 9) {
+			vbi_export_invalid_option(e, keyword, level);
+			return FALSE;
+		}
+		gfx->png_level = level;
+	} else if (strcmp(keyword, "filter") == 0) {
+		unsigned int filter = va_arg(args, unsigned int);
+
+		if (filter >= elements(png_filters)) {
+			vbi_export_invalid_option(e, keyword, filter);
+			return FALSE;
+		}
+		gfx->png_filter = filter;
+	} else if (strcmp(keyword, "strategy") == 0) {
+		unsigned int strategy = va_arg(args, unsigned int);
+
+		if (strategy >= elements(png_strategies)) {
+			vbi_export_invalid_option(e, keyword, strategy);
+			return FALSE;
+		}
+		gfx->png_strategy = strategy;
+	} else if (strcmp(keyword, "compact") == 0) {
+		gfx->png_compact = !!va_arg(args, int);
 	} else {
 		vbi_export_unknown_option(e, keyword);
 		return FALSE;
@@ -1637,6 +2416,7 @@ VBI_AUTOREG_EXPORT_MODULE(vbi_export_class_xpm)
 
 #include "png.h"
 #include "setjmp.h"
+#include "zlib.h"
 
 /* Starting from libpng version 1.5 it is not possible
    to access inside the PNG struct directly. */
@@ -1676,12 +2456,22 @@ write_png			(gfx_instance *		gfx,
 				 png_bytep *		row_pointer,
 				 unsigned int		ww,
 				 unsigned int		wh,
-				 unsigned int		scale)
+				 unsigned int		scale,
+				 const uint8_t *	colors,
+				 unsigned int		n_colors)
 {
+	static const int filters[] = {
+		0, PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP,
+		PNG_FILTER_AVG, PNG_FILTER_PAETH, PNG_ALL_FILTERS
+	};
+	static const int strategies[] = {
+		Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE
+	};
 	png_color palette[80];
 	png_byte alpha[80];
 	png_text text[4];
 	char title[80];
+	unsigned int bit_depth;
 	unsigned int i;
 
 	if (PNG_SETJMP(png_ptr))
@@ -1692,37 +2482,52 @@ write_png			(gfx_instance *		gfx,
 			  write_data,
 			  flush_data);
 
+	png_set_compression_level (png_ptr, gfx->png_level);
+	png_set_compression_strategy (png_ptr,
+				      strategies[gfx->png_strategy]);
+
+	if (0 != gfx->png_filter)
+		png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE,
+				filters[gfx->png_filter]);
+
+	if (n_colors <= 2)
+		bit_depth = 1;
+	else if (n_colors <= 4)
+		bit_depth = 2;
+	else if (n_colors <= 16)
+		bit_depth = 4;
+	else
+		bit_depth = 8;
+
 	png_set_IHDR (png_ptr,
 		      info_ptr,
 		      ww,
 		      (wh << scale) >> 1,
-		      /* bit_depth */ 8,
+		      bit_depth,
 		PNG_COLOR_TYPE_PALETTE,
 		      gfx->double_height ?
 			PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
 		PNG_COMPRESSION_TYPE_DEFAULT,
 		PNG_FILTER_TYPE_DEFAULT);
 
-	/* Could be optimized (or does libpng?) */
-	for (i = 0; i < 40; i++) {
-		/* opaque */
-		palette[i].red   = pg->color_map[i] & 0xFF;
-		palette[i].green = (pg->color_map[i] >> 8) & 0xFF;
-		palette[i].blue	 = (pg->color_map[i] >> 16) & 0xFF;
-		alpha[i]	 = 255;
-
-		/* translucent */
-		palette[i + 40]  = palette[i];
-		alpha[i + 40]	 = 128;
-	}
+	/* Colors 0 ... 39 opaque, 40 ... 79 translucent. */
+	for (i = 0; i < n_colors; i++) {
+		vbi_rgba color = pg->color_map[colors[i] % 40];
+
+		palette[i].red   = color & 0xFF;
+		palette[i].green = (color >> 8) & 0xFF;
+		palette[i].blue	 = (color >> 16) & 0xFF;
 
-	alpha[VBI_TRANSPARENT_BLACK] = 0;
-	alpha[40 + VBI_TRANSPARENT_BLACK] = 0;
+		if (VBI_TRANSPARENT_BLACK == colors[i] % 40)
+			alpha[i] = 0;
+		else
+			alpha[i] = (colors[i] >= 40) ? 128 : 255;
+	}
 
-	png_set_PLTE (png_ptr, info_ptr, palette, 80);
+	png_set_PLTE (png_ptr, info_ptr, palette, n_colors);
 
         if (gfx->transparency)
-	        png_set_tRNS (png_ptr, info_ptr, alpha, 80, NULL);
+	        png_set_tRNS (png_ptr, info_ptr, alpha, n_colors, NULL);
 
 	png_set_gAMA (png_ptr, info_ptr, 1.0 / 2.2);
 
@@ -1747,6 +2552,10 @@ write_png			(gfx_instance *		gfx,
 
 	png_write_info (png_ptr, info_ptr);
 
+	/* The image has one pixel per byte. */
+	if (bit_depth < 8)
+		png_set_packing (png_ptr);
+
 	switch (scale) {
 	case 0:
 		for (i = 0; i < wh / 2; i++)
@@ -1772,6 +2581,48 @@ write_png			(gfx_instance *		gfx,
 	return TRUE;
 }
 
+/**
+ * @internal
+ * @param image Image with one palette index 0 ... 79 per byte.
+ * @param size Size of the image in bytes.
+ * @param colors The function stores the palette indices used in the
+ *   image here, in ascending order.
+ *
+ * Replaces the pixels of @a image by indices into @a colors.
+ *
+ * @returns
+ * Number of colors in @a colors.
+ */
+static unsigned int
+compact_palette			(uint8_t *		image,
+				 size_t			size,
+				 uint8_t		colors[80])
+{
+	uint8_t map[256];
+	uint8_t used[256];
+	unsigned int n_colors;
+	size_t i;
+
+	CLEAR (used);
+
+	for (i = 0; i < size; i++)
+		used[image[i]] = 1;
+
+	n_colors = 0;
+
+	for (i = 0; i < 80; i++) {
+		if (used[i]) {
+			map[i] = n_colors;
+			colors[n_colors++] = i;
+		}
+	}
+
+	for (i = 0; i < size; i++)
+		image[i] = map[image[i]];
+
+	return n_colors;
+}
+
 static vbi_bool
 png_export(vbi_export *e, vbi_page *pg)
 {
@@ -1779,8 +2630,11 @@ png_export(vbi_export *e, vbi_page *pg)
 	png_structp png_ptr;
 	png_infop info_ptr;
         uint8_t pen[128];
+	uint8_t colors[80];
+	unsigned int n_colors;
 	png_bytep *row_pointer;
 	png_bytep image;
+	size_t size;
 	int ww, wh, rowstride, row_adv, scale;
 	int row;
 	int i;
@@ -1803,19 +2657,40 @@ png_export(vbi_export *e, vbi_page *pg)
 
 	rowstride = ww * sizeof(*image);
 
-	if (!(row_pointer = malloc(sizeof(*row_pointer) * wh * 2))) {
-		vbi_export_error_printf(e, _("Unable to allocate %d byte buffer."),
-					sizeof(*row_pointer) * wh * 2);
-		return FALSE;
+	/* The buffers are kept for the next page. */
+
+	size = sizeof(*row_pointer) * wh * 2;
+	if (size > gfx->row_pointer_size) {
+		free(gfx->row_pointer);
+		gfx->row_pointer_size = 0;
+
+		if (!(gfx->row_pointer = malloc(size))) {
+			vbi_export_error_printf(e, _("Unable to allocate %d byte buffer."),
+						size);
+			return FALSE;
+		}
+
+		gfx->row_pointer_size = size;
 	}
 
-	if (!(image = malloc(wh * ww * sizeof(*image)))) {
-		vbi_export_error_printf(e, _("Unable to allocate %d KB image buffer."),
-					wh * ww * sizeof(*image) / 1024);
-	free(row_pointer);
-		return FALSE;
+	row_pointer = (png_bytep *) gfx->row_pointer;
+
+	size = wh * ww * sizeof(*image);
+	if (size > gfx->image_size) {
+		free(gfx->image);
+		gfx->image_size = 0;
+
+		if (!(gfx->image = malloc(size))) {
+			vbi_export_error_printf(e, _("Unable to allocate %d KB image buffer."),
+						size / 1024);
+			return FALSE;
+		}
+
+		gfx->image_size = size;
 	}
 
+	image = gfx->image;
+
         /* draw the image */
 
         if (pg->drcs_clut) {
@@ -1831,7 +2706,16 @@ png_export(vbi_export *e, vbi_page *pg)
                                  !e->reveal, pg->columns < 40);
 	}
 
-	/* Now save the image */
+	if (gfx->png_compact) {
+		n_colors = compact_palette (image, size, colors);
+	} else {
+		for (i = 0; i < 80; i++)
+			colors[i] = i;
+		n_colors = 80;
+	}
+
+	/* Now save the image. Note libpng cannot reuse a write
+	   struct after png_write_end(). */
 
 	if (!(png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
 						NULL, NULL, NULL)))
@@ -1843,7 +2727,8 @@ png_export(vbi_export *e, vbi_page *pg)
 	}
 
 	if (!write_png (gfx, pg, png_ptr, info_ptr,
-			image, row_pointer, ww, wh, scale)) {
+			image, row_pointer, ww, wh, scale,
+			colors, n_colors)) {
 		png_destroy_write_struct (&png_ptr, &info_ptr);
 		goto write_error;
 	}
@@ -1853,10 +2738,6 @@ png_export(vbi_export *e, vbi_page *pg)
 	if (gfx->export.write_error)
 		goto failed;
 
-	free (row_pointer);
-
-	free (image);
-
 	return TRUE;
 
 write_error:
@@ -1864,10 +2745,6 @@ write_error:
 
 unknown_error:
 failed:
-	free (row_pointer);
-
-	free (image);
-
 	return FALSE;
 }
 
@@ -1886,7 +2763,7 @@ vbi_export_class_png = {
 	._public	= &info_png,
 	._new		= gfx_new,
 	._delete	= gfx_delete,
-	.option_enum	= option_enum,
+	.option_enum	= option_enum_png,
 	.option_get	= option_get,
 	.option_set	= option_set,
 	.export		= png_export
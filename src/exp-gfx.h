@@ -59,6 +59,48 @@ vbi_draw_vt_page(vbi_page *pg, vbi_pixfmt fmt, void *canvas,
 				pg->columns, pg->rows, reveal, flash_on);
 }
 
+/**
+ * @brief A rectangle in a rendered page image.
+ *
+ * Coordinates and size are given in pixels, see
+ * vbi_draw_vt_page_update().
+ */
+typedef struct {
+	int			x;
+	int			y;
+	int			width;
+	int			height;
+} vbi_rect;
+
+extern int		vbi_draw_vt_page_update(const vbi_page *old_pg,
+						int old_reveal,
+						int old_flash_on,
+						vbi_page *pg, vbi_pixfmt fmt,
+						void *canvas, int rowstride,
+						int reveal, int flash_on,
+						vbi_rect *rects,
+						int max_rects);
+
+/**
+ * @brief Opaque glyph atlas, see vbi_glyph_atlas_new().
+ */
+typedef struct _vbi_glyph_atlas vbi_glyph_atlas;
+
+extern vbi_glyph_atlas *	vbi_glyph_atlas_new(vbi_pixfmt fmt,
+						    unsigned int max_tiles);
+extern void		vbi_glyph_atlas_delete(vbi_glyph_atlas *atlas);
+extern void		vbi_glyph_atlas_set_read_only(vbi_glyph_atlas *atlas,
+						      vbi_bool read_only);
+extern unsigned int	vbi_glyph_atlas_num_tiles(const vbi_glyph_atlas *atlas);
+extern void		vbi_draw_vt_page_region_cached(vbi_glyph_atlas *atlas,
+						       vbi_page *pg,
+						       void *canvas,
+						       int rowstride,
+						       int column, int row,
+						       int width, int height,
+						       int reveal,
+						       int flash_on);
+
 extern void		vbi_draw_cc_page_region(vbi_page *pg, vbi_pixfmt fmt,
 						void *canvas, int rowstride,
 						int column, int row,
@@ -32,6 +32,7 @@
 #include <unistd.h>
 #include <iconv.h>
 
+#include "conv.h"
 #include "lang.h"
 #include "export.h"
 #include "teletext_decoder.h"
@@ -52,6 +53,9 @@ typedef struct html_instance {
 	unsigned		color : 1;
 	unsigned		headerless : 1;
 
+	/* Conversion to cd_charset, kept for the next page. */
+	const char *		cd_charset;
+	_vbi_codeset		codeset;
 	iconv_t			cd;
 
 	int			foreground;
@@ -65,6 +69,9 @@ typedef struct html_instance {
 
 	style *			styles;
 	style			def;
+
+	/* Unused styles for the next page. */
+	style *			free_styles;
 } html_instance;
 
 static void
@@ -77,8 +84,10 @@ free_styles			(html_instance *	html)
 
 	while ((s = html->styles)) {
 		html->styles = s->next;
-		if (s != &html->def)
-			free (s);
+		if (s != &html->def) {
+			s->next = html->free_styles;
+			html->free_styles = s;
+		}
 	}
 
 	html->foreground	= 0;
@@ -101,6 +110,8 @@ html_new(void)
 	if (!(html = calloc(1, sizeof(*html))))
 		return NULL;
 
+	html->cd = (iconv_t) -1;
+
 	return &html->export;
 }
 
@@ -108,11 +119,52 @@ static void
 html_delete(vbi_export *e)
 {
 	html_instance *html = PARENT(e, html_instance, export);
+	style *s;
 
 	free_styles (html);
+
+	while ((s = html->free_styles)) {
+		html->free_styles = s->next;
+		free (s);
+	}
+
+	if ((iconv_t) -1 != html->cd)
+		iconv_close (html->cd);
+
 	free (html);
 }
 
+static vbi_bool
+open_charset			(html_instance *	html,
+				 const char *		charset)
+{
+	if (charset == html->cd_charset) {
+		/* Reset the conversion state. */
+		if ((iconv_t) -1 != html->cd)
+			iconv (html->cd, NULL, NULL, NULL, NULL);
+		return TRUE;
+	}
+
+	if ((iconv_t) -1 != html->cd) {
+		iconv_close (html->cd);
+		html->cd = (iconv_t) -1;
+	}
+
+	html->cd_charset = NULL;
+
+	html->codeset = _vbi_codeset_from_name (charset);
+
+	if (_VBI_CODESET_UNKNOWN == html->codeset) {
+		html->cd = iconv_open (charset, "UCS-2");
+		if ((iconv_t) -1 == html->cd)
+			return FALSE;
+	}
+
+	html->cd_charset = charset;
+
+	return TRUE;
+}
+
 static vbi_option_info
 html_options[] = {
 	VBI_OPTION_STRING_INITIALIZER
@@ -385,8 +437,7 @@ header(html_instance *html, vbi_page *pg)
 		break;
 	}
 
-	html->cd = iconv_open (charset, "UCS-2");
-	if ((iconv_t) -1 == html->cd) {
+	if (!open_charset (html, charset)) {
 		vbi_export_error_printf (&html->export,
 					 _("Character conversion "
 					   "Unicode (UCS-2) "
@@ -568,7 +619,13 @@ export(vbi_export *e, vbi_page *pgp)
 			}
 
 			if (!s) {
-				s = calloc(1, sizeof(style));
+				if ((s = html->free_styles)) {
+					html->free_styles = s->next;
+					CLEAR (*s);
+				} else if (!(s = calloc(1, sizeof(style)))) {
+					_vbi_export_malloc_error (e);
+					goto failed;
+				}
 				*sp = s;
 				s->foreground = ac.foreground;
 				s->background = ac.background;
@@ -697,7 +754,17 @@ export(vbi_export *e, vbi_page *pgp)
 				puts(html_italic[html->italic]);
 			}
 
-			if (vbi_is_print(acp[j].unicode)) {
+			if (vbi_is_print(acp[j].unicode)
+			    && _VBI_CODESET_UNKNOWN != html->codeset) {
+				uint16_t uc = acp[j].unicode;
+				char out[4];
+
+				if (1 == _vbi_convert_ucs2 (out, html->codeset,
+							    &uc, 1, 0))
+					escaped_putc(html, out[0]);
+				else
+					printf("&#%u;", acp[j].unicode);
+			} else if (vbi_is_print(acp[j].unicode)) {
 				char in[2], out[1], *ip = in, *op = out;
 				size_t li = sizeof(in), lo = sizeof(out), r;
 
@@ -744,9 +811,6 @@ export(vbi_export *e, vbi_page *pgp)
 
 	putc('\n');
 
-	iconv_close(html->cd);
-	html->cd = (iconv_t) -1;
-
 	if (html->export.write_error)
 		goto failed;
 
@@ -755,11 +819,6 @@ export(vbi_export *e, vbi_page *pgp)
  failed:
 	free_styles (html);
 
-	if ((iconv_t) -1 != html->cd) {
-		iconv_close (html->cd);
-		html->cd = (iconv_t) -1;
-	}
-
 	return FALSE;
 }
 
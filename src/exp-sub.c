@@ -0,0 +1,811 @@
+/*
+ *  libzvbi - Subtitle export functions
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "misc.h"
+#include "conv.h"
+#include "lang.h"
+#include "export.h"
+#include "cc608_decoder.h"
+
+/* Closed Caption rows have 32 columns, Teletext rows 40 or 41. */
+#define MAX_ROWS 25
+#define MAX_COLUMNS 48
+
+enum sub_format {
+	SUB_FORMAT_SRT,
+	SUB_FORMAT_WEBVTT,
+	SUB_FORMAT_TTML
+};
+
+/* Text of a subtitle cue. Only the characters and the attributes
+   the formats can represent are significant. */
+struct cue {
+	/* When the text appeared. */
+	double			start;
+
+	/* Caption channel or 0. */
+	int			channel;
+
+	unsigned int		n_rows;
+	unsigned int		length[MAX_ROWS];
+	vbi_char		text[MAX_ROWS][MAX_COLUMNS];
+};
+
+typedef struct sub_instance {
+	vbi_export		export;
+
+	enum sub_format		format;
+
+	/* Options */
+	int			channel;
+	unsigned int		max_duration;
+
+	/* Stream state. The header has been written. */
+	vbi_bool		in_stream;
+
+	/* Number of cues written so far. */
+	unsigned int		n_cues;
+
+	/* Cue times are relative to the first timestamp. */
+	vbi_bool		have_time_base;
+	double			time_base;
+
+	/* Unwrapping of 33 bit PTS. */
+	int64_t			last_pts;
+	int64_t			pts_offset;
+
+	/* The pending cue, n_rows zero if none, and the next
+	   cue when converting pages. */
+	struct cue *		cue;
+	struct cue *		next;
+	struct cue		cues[2];
+} sub_instance;
+
+static vbi_export *
+sub_new				(enum sub_format	format)
+{
+	sub_instance *sub;
+
+	if (!(sub = calloc(1, sizeof(*sub))))
+		return NULL;
+
+	sub->format = format;
+
+	sub->cue = &sub->cues[0];
+	sub->next = &sub->cues[1];
+
+	return &sub->export;
+}
+
+static vbi_export *
+srt_new(void)
+{
+	return sub_new (SUB_FORMAT_SRT);
+}
+
+static vbi_export *
+webvtt_new(void)
+{
+	return sub_new (SUB_FORMAT_WEBVTT);
+}
+
+static vbi_export *
+ttml_new(void)
+{
+	return sub_new (SUB_FORMAT_TTML);
+}
+
+static void
+sub_delete(vbi_export *e)
+{
+	free(PARENT(e, sub_instance, export));
+}
+
+static vbi_option_info
+sub_options[] = {
+	VBI_OPTION_INT_RANGE_INITIALIZER
+	  ("channel", N_("Caption channel"),
+	   0, 0, 8, 1, N_("Export only this Closed Caption channel: "
+			  "CC1 ... CC4 (1 ... 4), T1 ... T4 (5 ... 8) "
+			  "or all (0)")),
+	VBI_OPTION_INT_RANGE_INITIALIZER
+	  ("max_duration", N_("Maximum duration"),
+	   10, 1, 3600, 1, N_("Time in seconds a subtitle remains "
+			      "visible when no new subtitle follows"))
+};
+
+#define elements(array) (sizeof(array) / sizeof(array[0]))
+
+static vbi_option_info *
+option_enum(vbi_export *e, int index)
+{
+	e = e;
+
+	if (index < 0 || index >= (int) elements(sub_options))
+		return NULL;
+	else
+		return sub_options + index;
+}
+
+static vbi_bool
+option_get(vbi_export *e, const char *keyword, vbi_option_value *value)
+{
+	sub_instance *sub = PARENT(e, sub_instance, export);
+
+	if (strcmp(keyword, "channel") == 0) {
+		value->num = sub->channel;
+	} else if (strcmp(keyword, "max_duration") == 0) {
+		value->num = sub->max_duration;
+	} else {
+		vbi_export_unknown_option(e, keyword);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+option_set(vbi_export *e, const char *keyword, va_list args)
+{
+	sub_instance *sub = PARENT(e, sub_instance, export);
+
+	if (strcmp(keyword, "channel") == 0) {
+		int channel = va_arg(args, int);
+
+		if (channel < 0 || channel > 8) {
+			vbi_export_invalid_option(e, keyword, channel);
+			return FALSE;
+		}
+		sub->channel = channel;
+	} else if (strcmp(keyword, "max_duration") == 0) {
+		int duration = va_arg(args, int);
+
+		if (duration < 1 || duration > 3600) {
+			vbi_export_invalid_option(e, keyword, duration);
+			return FALSE;
+		}
+		sub->max_duration = duration;
+	} else {
+		vbi_export_unknown_option(e, keyword);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Copies a row of text into dst, replacing all characters which are
+   not visible by spaces, and removing leading and trailing spaces.
+   Returns the number of characters stored in dst. */
+static unsigned int
+convert_row			(vbi_char *		dst,
+				 const vbi_char *	src,
+				 unsigned int		n_columns,
+				 vbi_bool		reveal)
+{
+	unsigned int length;
+	unsigned int end;
+	unsigned int i;
+
+	length = 0;
+	end = 0;
+
+	for (i = 0; i < n_columns && length < MAX_COLUMNS; ++i) {
+		vbi_char ac = src[i];
+
+		switch (ac.size) {
+		case VBI_OVER_TOP:
+		case VBI_OVER_BOTTOM:
+			continue;
+
+		case VBI_DOUBLE_HEIGHT2:
+		case VBI_DOUBLE_SIZE2:
+			/* Lower half of the row above. */
+			ac.unicode = 0x0020;
+			break;
+
+		default:
+			break;
+		}
+
+		if (VBI_TRANSPARENT_SPACE == ac.opacity
+		    || (ac.conceal && !reveal)
+		    || !vbi_is_print (ac.unicode)) {
+			ac.unicode = 0x0020;
+		}
+
+		if (0x0020 == ac.unicode) {
+			if (0 == length)
+				continue;
+		} else {
+			end = length + 1;
+		}
+
+		dst[length++] = ac;
+	}
+
+	return end;
+}
+
+static vbi_bool
+same_text			(const struct cue *	cue1,
+				 const struct cue *	cue2)
+{
+	unsigned int row;
+
+	if (cue1->n_rows != cue2->n_rows)
+		return FALSE;
+
+	for (row = 0; row < cue1->n_rows; ++row) {
+		const vbi_char *s1 = cue1->text[row];
+		const vbi_char *s2 = cue2->text[row];
+		unsigned int i;
+
+		if (cue1->length[row] != cue2->length[row])
+			return FALSE;
+
+		for (i = 0; i < cue1->length[row]; ++i) {
+			if (s1[i].unicode != s2[i].unicode
+			    || s1[i].italic != s2[i].italic
+			    || s1[i].underline != s2[i].underline)
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+page_cue			(struct cue *		cue,
+				 const vbi_page *	pg,
+				 vbi_bool		reveal)
+{
+	unsigned int n_rows;
+	unsigned int row;
+
+	n_rows = MIN ((unsigned int) pg->rows, (unsigned int) MAX_ROWS);
+
+	cue->channel = 0;
+	cue->n_rows = 0;
+
+	for (row = 0; row < n_rows; ++row) {
+		unsigned int length;
+
+		length = convert_row (cue->text[cue->n_rows],
+				      &pg->text[row * pg->columns],
+				      pg->columns, reveal);
+		if (length > 0)
+			cue->length[cue->n_rows++] = length;
+	}
+}
+
+static vbi_bool
+put_ucs2			(vbi_export *		e,
+				 const uint16_t *	src,
+				 unsigned int		length)
+{
+	long n;
+
+	if (0 == length)
+		return TRUE;
+
+	if (!_vbi_export_grow_buffer_space
+	    (e, _vbi_convert_ucs2_max_size (_VBI_CODESET_UTF8, length)))
+		return FALSE;
+
+	n = _vbi_convert_ucs2 (e->buffer.data + e->buffer.offset,
+			       _VBI_CODESET_UTF8, src, length,
+			       /* repl_char */ 0x20);
+	if (n < 0)
+		return FALSE;
+
+	e->buffer.offset += n;
+
+	return TRUE;
+}
+
+static const char *
+escape_char			(enum sub_format	format,
+				 unsigned int		c)
+{
+	/* SubRip has no escape sequences. */
+	if (SUB_FORMAT_SRT == format)
+		return NULL;
+
+	switch (c) {
+	case '<':	return "&lt;";
+	case '>':	return "&gt;";
+	case '&':	return "&amp;";
+	default:	return NULL;
+	}
+}
+
+static void
+put_style			(sub_instance *		sub,
+				 unsigned int		old_style,
+				 unsigned int		new_style)
+{
+	vbi_export *e = &sub->export;
+
+	if (SUB_FORMAT_TTML == sub->format) {
+		if (0 != old_style)
+			vbi_export_puts (e, "</span>");
+		if (0 != new_style) {
+			vbi_export_puts (e, "<span");
+			if (new_style & 1)
+				vbi_export_puts (e, " tts:fontStyle="
+						 "\"italic\"");
+			if (new_style & 2)
+				vbi_export_puts (e, " tts:textDecoration="
+						 "\"underline\"");
+			vbi_export_putc (e, '>');
+		}
+	} else {
+		if (old_style & 2)
+			vbi_export_puts (e, "</u>");
+		if (old_style & 1)
+			vbi_export_puts (e, "</i>");
+		if (new_style & 1)
+			vbi_export_puts (e, "<i>");
+		if (new_style & 2)
+			vbi_export_puts (e, "<u>");
+	}
+}
+
+static vbi_bool
+put_row				(sub_instance *		sub,
+				 const vbi_char *	text,
+				 unsigned int		length)
+{
+	vbi_export *e = &sub->export;
+	uint16_t run[MAX_COLUMNS];
+	unsigned int run_length;
+	unsigned int style;
+	unsigned int i;
+
+	run_length = 0;
+	style = 0;
+
+	for (i = 0; i < length; ++i) {
+		unsigned int new_style;
+		const char *escape;
+
+		new_style = text[i].italic | (text[i].underline << 1);
+		escape = escape_char (sub->format, text[i].unicode);
+
+		if (new_style != style || NULL != escape) {
+			if (!put_ucs2 (e, run, run_length))
+				return FALSE;
+			run_length = 0;
+
+			if (new_style != style) {
+				put_style (sub, style, new_style);
+				style = new_style;
+			}
+
+			if (NULL != escape) {
+				vbi_export_puts (e, escape);
+				continue;
+			}
+		}
+
+		run[run_length++] = text[i].unicode;
+	}
+
+	if (!put_ucs2 (e, run, run_length))
+		return FALSE;
+
+	put_style (sub, style, 0);
+
+	return !e->write_error;
+}
+
+static void
+put_time			(sub_instance *		sub,
+				 double			t)
+{
+	unsigned long ms;
+
+	if (t > 0.0)
+		ms = (unsigned long)(t * 1000 + 0.5);
+	else
+		ms = 0;
+
+	vbi_export_printf (&sub->export, "%02lu:%02lu:%02lu%c%03lu",
+			   ms / 3600000, ms / 60000 % 60, ms / 1000 % 60,
+			   (SUB_FORMAT_SRT == sub->format) ? ',' : '.',
+			   ms % 1000);
+}
+
+/* Writes a cue visible from start to end seconds. */
+static vbi_bool
+put_cue				(sub_instance *		sub,
+				 const struct cue *	cue,
+				 double			start,
+				 double			end,
+				 unsigned int		index)
+{
+	vbi_export *e = &sub->export;
+	unsigned int row;
+
+	switch (sub->format) {
+	case SUB_FORMAT_SRT:
+	case SUB_FORMAT_WEBVTT:
+		if (SUB_FORMAT_SRT == sub->format)
+			vbi_export_printf (e, "%u\n", index);
+		put_time (sub, start);
+		vbi_export_puts (e, " --> ");
+		put_time (sub, end);
+		vbi_export_putc (e, '\n');
+
+		for (row = 0; row < cue->n_rows; ++row) {
+			if (!put_row (sub, cue->text[row], cue->length[row]))
+				return FALSE;
+			vbi_export_putc (e, '\n');
+		}
+
+		vbi_export_putc (e, '\n');
+
+		break;
+
+	case SUB_FORMAT_TTML:
+		vbi_export_puts (e, "<p begin=\"");
+		put_time (sub, start);
+		vbi_export_puts (e, "\" end=\"");
+		put_time (sub, end);
+		vbi_export_puts (e, "\">");
+
+		for (row = 0; row < cue->n_rows; ++row) {
+			if (row > 0)
+				vbi_export_puts (e, "<br/>");
+			if (!put_row (sub, cue->text[row], cue->length[row]))
+				return FALSE;
+		}
+
+		vbi_export_puts (e, "</p>\n");
+
+		break;
+	}
+
+	return !e->write_error;
+}
+
+static vbi_bool
+put_header			(sub_instance *		sub)
+{
+	vbi_export *e = &sub->export;
+
+	switch (sub->format) {
+	case SUB_FORMAT_SRT:
+		break;
+
+	case SUB_FORMAT_WEBVTT:
+		vbi_export_puts (e, "WEBVTT\n\n");
+		break;
+
+	case SUB_FORMAT_TTML:
+		vbi_export_puts (e, "<?xml version=\"1.0\" "
+				 "encoding=\"UTF-8\"?>\n"
+				 "<tt xmlns=\"http://www.w3.org/ns/ttml\" "
+				 "xmlns:tts=\"http://www.w3.org/ns/"
+				 "ttml#styling\" xml:lang=\"\">\n"
+				 "<body>\n<div>\n");
+		break;
+	}
+
+	return !e->write_error;
+}
+
+static vbi_bool
+put_footer			(sub_instance *		sub)
+{
+	vbi_export *e = &sub->export;
+
+	if (SUB_FORMAT_TTML == sub->format)
+		vbi_export_puts (e, "</div>\n</body>\n</tt>\n");
+
+	return !e->write_error;
+}
+
+static vbi_bool
+export(vbi_export *e, vbi_page *pg)
+{
+	sub_instance *sub = PARENT(e, sub_instance, export);
+
+	/* A document with one cue, visible for max_duration. */
+
+	page_cue (sub->next, pg, e->reveal);
+
+	if (!put_header (sub))
+		return FALSE;
+
+	if (sub->next->n_rows > 0) {
+		if (!put_cue (sub, sub->next, 0.0,
+			      sub->max_duration, /* index */ 1))
+			return FALSE;
+	}
+
+	return put_footer (sub);
+}
+
+static vbi_bool
+begin_stream			(sub_instance *		sub)
+{
+	if (sub->in_stream)
+		return TRUE;
+
+	sub->in_stream = TRUE;
+
+	sub->n_cues = 0;
+	sub->have_time_base = FALSE;
+	sub->last_pts = 0;
+	sub->pts_offset = 0;
+	sub->cue->n_rows = 0;
+
+	return put_header (sub);
+}
+
+/* Writes the pending cue, if any, which disappeared at time end. */
+static vbi_bool
+flush_cue			(sub_instance *		sub,
+				 double			end)
+{
+	struct cue *cue = sub->cue;
+	double start;
+	vbi_bool success;
+
+	if (0 == cue->n_rows)
+		return TRUE;
+
+	start = cue->start - sub->time_base;
+	end -= sub->time_base;
+
+	end = MIN (end, start + sub->max_duration);
+	end = MAX (end, start);
+
+	success = put_cue (sub, cue, start, end, ++sub->n_cues);
+
+	cue->n_rows = 0;
+
+	return success;
+}
+
+static double
+stream_time			(sub_instance *		sub,
+				 double			t)
+{
+	if (!sub->have_time_base) {
+		sub->time_base = t;
+		sub->have_time_base = TRUE;
+	}
+
+	return t;
+}
+
+static double
+event_time			(sub_instance *		sub,
+				 const struct _vbi_event_cc608_stream *s)
+{
+	int64_t pts;
+
+	if (s->pts < 0)
+		return stream_time (sub, s->capture_time);
+
+	pts = s->pts + sub->pts_offset;
+
+	/* PTS are 33 bits wide and wrap around after 26.5 hours. */
+	if (pts < sub->last_pts - ((int64_t) 1 << 32)) {
+		sub->pts_offset += (int64_t) 1 << 33;
+		pts += (int64_t) 1 << 33;
+	}
+
+	sub->last_pts = pts;
+
+	return stream_time (sub, pts / 90000.0);
+}
+
+static vbi_bool
+stream_page			(vbi_export *		e,
+				 const vbi_page *	pg,
+				 double			timestamp)
+{
+	sub_instance *sub = PARENT(e, sub_instance, export);
+	struct cue *cue;
+
+	if (!begin_stream (sub))
+		return FALSE;
+
+	page_cue (sub->next, pg, e->reveal);
+
+	/* Teletext pages are retransmitted periodically. */
+	if (same_text (sub->cue, sub->next))
+		return TRUE;
+
+	timestamp = stream_time (sub, timestamp);
+
+	if (!flush_cue (sub, timestamp))
+		return FALSE;
+
+	cue = sub->next;
+	cue->start = timestamp;
+
+	sub->next = sub->cue;
+	sub->cue = cue;
+
+	return TRUE;
+}
+
+static vbi_bool
+stream_event			(vbi_export *		e,
+				 const vbi_event *	ev)
+{
+	sub_instance *sub = PARENT(e, sub_instance, export);
+	const struct _vbi_event_cc608_stream *s;
+	struct cue *cue;
+	unsigned int length;
+	double t;
+
+	if (!begin_stream (sub))
+		return FALSE;
+
+	if (_VBI_EVENT_CC608_STREAM != ev->type)
+		return TRUE;
+
+	s = ev->ev._cc608_stream;
+
+	if (0 != sub->channel && s->channel != sub->channel)
+		return TRUE;
+
+	t = event_time (sub, s);
+
+	cue = sub->cue;
+
+	/* Rows of a pop-on caption appear at the same time. */
+	if (cue->n_rows > 0
+	    && (t != cue->start
+		|| s->channel != cue->channel
+		|| cue->n_rows >= MAX_ROWS)) {
+		if (!flush_cue (sub, t))
+			return FALSE;
+	}
+
+	length = convert_row (cue->text[cue->n_rows],
+			      s->text, N_ELEMENTS (s->text),
+			      e->reveal);
+	if (0 == length)
+		return TRUE;
+
+	if (0 == cue->n_rows) {
+		cue->start = t;
+		cue->channel = s->channel;
+	}
+
+	cue->length[cue->n_rows++] = length;
+
+	return TRUE;
+}
+
+static vbi_bool
+stream_end			(vbi_export *		e)
+{
+	sub_instance *sub = PARENT(e, sub_instance, export);
+	vbi_bool success;
+
+	if (!sub->in_stream)
+		return TRUE;
+
+	sub->in_stream = FALSE;
+
+	success = flush_cue (sub, sub->cue->start + sub->max_duration);
+
+	return put_footer (sub) && success;
+}
+
+static vbi_export_info
+info_srt = {
+	.keyword	= "srt",
+	.label		= N_("SubRip"),
+	.tooltip	= N_("Export subtitles as SubRip file"),
+
+	.mime_type	= "application/x-subrip",
+	.extension	= "srt",
+};
+
+static vbi_export_info
+info_webvtt = {
+	.keyword	= "webvtt",
+	.label		= N_("WebVTT"),
+	.tooltip	= N_("Export subtitles as WebVTT file"),
+
+	.mime_type	= "text/vtt",
+	.extension	= "vtt",
+};
+
+static vbi_export_info
+info_ttml = {
+	.keyword	= "ttml",
+	.label		= N_("TTML"),
+	.tooltip	= N_("Export subtitles as Timed Text "
+			     "Markup Language file"),
+
+	.mime_type	= "application/ttml+xml",
+	.extension	= "ttml,xml",
+};
+
+vbi_export_class
+vbi_export_class_srt = {
+	._public		= &info_srt,
+	._new			= srt_new,
+	._delete		= sub_delete,
+	.option_enum		= option_enum,
+	.option_get		= option_get,
+	.option_set		= option_set,
+	.export			= export,
+	.stream_page		= stream_page,
+	.stream_event		= stream_event,
+	.stream_end		= stream_end
+};
+
+vbi_export_class
+vbi_export_class_webvtt = {
+	._public		= &info_webvtt,
+	._new			= webvtt_new,
+	._delete		= sub_delete,
+	.option_enum		= option_enum,
+	.option_get		= option_get,
+	.option_set		= option_set,
+	.export			= export,
+	.stream_page		= stream_page,
+	.stream_event		= stream_event,
+	.stream_end		= stream_end
+};
+
+vbi_export_class
+vbi_export_class_ttml = {
+	._public		= &info_ttml,
+	._new			= ttml_new,
+	._delete		= sub_delete,
+	.option_enum		= option_enum,
+	.option_get		= option_get,
+	.option_set		= option_set,
+	.export			= export,
+	.stream_page		= stream_page,
+	.stream_event		= stream_event,
+	.stream_end		= stream_end
+};
+
+VBI_AUTOREG_EXPORT_MODULE(vbi_export_class_srt)
+VBI_AUTOREG_EXPORT_MODULE(vbi_export_class_webvtt)
+VBI_AUTOREG_EXPORT_MODULE(vbi_export_class_ttml)
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -31,6 +31,7 @@
 #include "misc.h"
 #include "lang.h"
 #include "export.h"
+#include "conv.h"
 #include "exp-txt.h"
 
 typedef struct text_instance {
@@ -45,7 +46,11 @@ typedef struct text_instance {
 	int			def_fg;
 	int			def_bg;
 
+	/* Conversion to cd_charset, kept for the next page. */
+	char *			cd_charset;
+	_vbi_codeset		codeset;
 	iconv_t			cd;
+
 	char			buf[32];
 } text_instance;
 
@@ -57,14 +62,58 @@ text_new(void)
 	if (!(text = calloc(1, sizeof(*text))))
 		return NULL;
 
+	text->cd = (iconv_t) -1;
+
 	return &text->export;
 }
 
+static void
+close_charset(text_instance *text)
+{
+	if ((iconv_t) -1 != text->cd) {
+		iconv_close(text->cd);
+		text->cd = (iconv_t) -1;
+	}
+
+	free(text->cd_charset);
+	text->cd_charset = NULL;
+}
+
+static vbi_bool
+open_charset(text_instance *text, const char *charset)
+{
+	if (text->cd_charset && 0 == strcmp(text->cd_charset, charset)) {
+		/* Reset the conversion state. */
+		if ((iconv_t) -1 != text->cd)
+			iconv(text->cd, NULL, NULL, NULL, NULL);
+		return TRUE;
+	}
+
+	close_charset(text);
+
+	text->codeset = _vbi_codeset_from_name (charset);
+
+	if (_VBI_CODESET_UNKNOWN == text->codeset) {
+		text->cd = iconv_open (charset, "UCS-2");
+		if ((iconv_t) -1 == text->cd)
+			return FALSE;
+	}
+
+	if (!(text->cd_charset = strdup(charset))) {
+		close_charset(text);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static void
 text_delete(vbi_export *e)
 {
 	text_instance *text = PARENT(e, text_instance, export);
 
+	close_charset(text);
+
 	if (text->charset)
 		free(text->charset);
 
@@ -275,11 +324,28 @@ match_color8(vbi_rgba color)
 }
 
 static vbi_bool
-print_unicode(iconv_t cd, int endian, int unicode, char **p, int n)
+print_unicode(iconv_t cd, _vbi_codeset codeset, int endian,
+	      int unicode, char **p, int n)
 {
 	char in[2], *ip, *op;
 	size_t li, lo, r;
 
+	if (_VBI_CODESET_UNKNOWN != codeset) {
+		uint16_t uc = unicode;
+		char out[4];
+		long size;
+
+		/* Replace unrepresentable characters by a space. */
+		size = _vbi_convert_ucs2 (out, codeset, &uc, 1, 0x0020);
+		if (size < 0 || size > n)
+			return FALSE;
+
+		memcpy (*p, out, size);
+		*p += size;
+
+		return TRUE;
+	}
+
 	in[0 + endian] = unicode;
 	in[1 - endian] = unicode >> 8;
 	ip = in; op = *p;
@@ -350,6 +416,7 @@ vbi_print_page_region(vbi_page *pg, char *buf, int size,
 	int endian = vbi_ucs2be();
 	int column0, column1, row0, row1;
 	int x, y, spaces, doubleh, doubleh0;
+	_vbi_codeset codeset;
 	iconv_t cd;
 	char *p;
 
@@ -371,7 +438,11 @@ vbi_print_page_region(vbi_page *pg, char *buf, int size,
 	    || endian < 0)
 		return 0;
 
-	if ((cd = iconv_open(format, "UCS-2")) == (iconv_t) -1)
+	codeset = _vbi_codeset_from_name (format);
+
+	cd = (iconv_t) -1;
+	if (_VBI_CODESET_UNKNOWN == codeset
+	    && (cd = iconv_open(format, "UCS-2")) == (iconv_t) -1)
 		return 0;
 
 	p = buf;
@@ -435,7 +506,7 @@ vbi_print_page_region(vbi_page *pg, char *buf, int size,
 				} else {
 					if (spaces < (x - x0) || y == row0) {
 						for (; spaces > 0; spaces--)
-							if (!print_unicode(cd, endian, 0x0020,
+							if (!print_unicode(cd, codeset, endian, 0x0020,
 									   &p, buf + size - p))
 								goto failure;
 					} else /* discard leading spaces */
@@ -443,7 +514,7 @@ vbi_print_page_region(vbi_page *pg, char *buf, int size,
 				}
 			}
 
-			if (!print_unicode(cd, endian, ac.unicode, &p, buf + size - p))
+			if (!print_unicode(cd, codeset, endian, ac.unicode, &p, buf + size - p))
 				goto failure;
 		}
 
@@ -461,7 +532,7 @@ vbi_print_page_region(vbi_page *pg, char *buf, int size,
 				; /* suppress blank line */
 			} else {
 				/* exactly one space between adjacent rows */
-				if (!print_unicode(cd, endian, 0x0020, &p, left))
+				if (!print_unicode(cd, codeset, endian, 0x0020, &p, left))
 					goto failure;
 			}
 		} else {
@@ -469,17 +540,19 @@ vbi_print_page_region(vbi_page *pg, char *buf, int size,
 				; /* prentend this is a blank double height lower row */
 			} else {
 				for (; spaces > 0; spaces--)
-					if (!print_unicode(cd, endian, 0x0020, &p, buf + size - p))
+					if (!print_unicode(cd, codeset, endian, 0x0020, &p, buf + size - p))
 						goto failure;
 			}
 		}
 	}
 
-	iconv_close(cd);
+	if ((iconv_t) -1 != cd)
+		iconv_close(cd);
 	return p - buf;
 
  failure:
-	iconv_close(cd);
+	if ((iconv_t) -1 != cd)
+		iconv_close(cd);
 	return 0;
 }
 
@@ -582,7 +655,7 @@ print_char(text_instance *text, int endian, vbi_page *pg, vbi_char old, vbi_char
 			this.unicode = 0x0020;
 	}
 
-	if (!print_unicode(text->cd, endian, this.unicode, &p,
+	if (!print_unicode(text->cd, text->codeset, endian, this.unicode, &p,
 			   text->buf + sizeof(text->buf) - p)) {
 		vbi_export_write_error(&text->export);
 		return 0;
@@ -607,16 +680,11 @@ export				(vbi_export *		e,
 	else
 		charset = iconv_formats[text->format];
 
-	text->cd = iconv_open (charset, "UCS-2");
-	if ((iconv_t) -1 == text->cd || endian < 0) {
+	if (endian < 0 || !open_charset(text, charset)) {
 		vbi_export_error_printf(&text->export,
 					_("Character conversion Unicode "
 					  "(UCS-2) to %s not supported."),
 			charset);
-
-		if ((iconv_t) -1 != text->cd)
-			iconv_close (text->cd);
-
 		return FALSE;
 	}
 
@@ -633,7 +701,6 @@ export				(vbi_export *		e,
 			if (n < 0) {
 				; /* skipped */
 			} else if (n == 0) {
-				iconv_close(text->cd);
 				return FALSE;
 			} else if (n == 1) {
 				vbi_export_putc (e, text->buf[0]);
@@ -657,8 +724,6 @@ export				(vbi_export *		e,
 		}
 	}
 
-	iconv_close(text->cd);
-
 	return !e->write_error;
 }
 
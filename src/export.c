@@ -129,6 +129,9 @@ extern vbi_export_class vbi_export_class_png;
 extern vbi_export_class vbi_export_class_html;
 extern vbi_export_class vbi_export_class_tmpl;
 extern vbi_export_class vbi_export_class_text;
+extern vbi_export_class vbi_export_class_srt;
+extern vbi_export_class vbi_export_class_ttml;
+extern vbi_export_class vbi_export_class_webvtt;
 /* Temporarily disabled, see exp-vtx.c.
 extern vbi_export_class vbi_export_class_vtx;
 */
@@ -145,6 +148,9 @@ initialize(void)
 #endif
 		&vbi_export_class_html,
 		&vbi_export_class_text,
+		&vbi_export_class_srt,
+		&vbi_export_class_ttml,
+		&vbi_export_class_webvtt,
 /* Temporarily disabled, see exp-vtx.c.
 		&vbi_export_class_vtx,
 */
@@ -608,6 +614,11 @@ vbi_export_delete(vbi_export *export)
 	if (!export)
 		return;
 
+	if (0 != export->target)
+		vbi_export_end(export);
+
+	free(export->_spare_buffer.data);
+
 	if (export->errstr)
 		free(export->errstr);
 
@@ -1339,6 +1350,7 @@ vbi_export_puts_iconv		(vbi_export *		e,
 				 unsigned long		src_size,
 				 int			repl_char)
 {
+	_vbi_codeset codeset;
 	char *buffer;
 	unsigned long out_size;
 	vbi_bool success;
@@ -1348,7 +1360,58 @@ vbi_export_puts_iconv		(vbi_export *		e,
 	if (unlikely (e->write_error))
 		return FALSE;
 
-	/* Inefficient, but shall suffice for now. */
+	codeset = _vbi_codeset_from_name (dst_codeset);
+
+	if (_VBI_CODESET_UNKNOWN != codeset
+	    && _VBI_CODESET_UCS2 == _vbi_codeset_from_name (src_codeset)
+	    && NULL != src && 0 == (src_size & 1)) {
+		uint16_t ucs2[256];
+		size_t offset;
+
+		/* Common case, convert directly into the buffer. */
+
+		out_size = _vbi_convert_ucs2_max_size (codeset,
+						       src_size / 2);
+		if (unlikely (!_vbi_export_grow_buffer_space (e, out_size))) {
+			e->write_error = TRUE;
+			return FALSE;
+		}
+
+		offset = e->buffer.offset;
+
+		/* src may not be suitably aligned for 16 bit
+		   access, so we convert a copy in chunks. */
+		while (src_size > 0) {
+			unsigned long n_bytes;
+			long size;
+
+			n_bytes = MIN (src_size,
+				       (unsigned long) sizeof (ucs2));
+			memcpy (ucs2, src, n_bytes);
+
+			size = _vbi_convert_ucs2
+				(e->buffer.data + e->buffer.offset,
+				 codeset, ucs2, n_bytes / 2, repl_char);
+			if (unlikely (size < 0)) {
+				vbi_export_error_printf
+					(e, _("Character conversion Unicode "
+					      "(UCS-2) to %s failed."),
+					 (NULL == dst_codeset) ?
+					 "UTF-8" : dst_codeset);
+				e->buffer.offset = offset;
+				e->write_error = TRUE;
+				return FALSE;
+			}
+
+			e->buffer.offset += size;
+
+			src += n_bytes;
+			src_size -= n_bytes;
+		}
+
+		return TRUE;
+	}
+
 	buffer = _vbi_strndup_iconv (&out_size,
 				     dst_codeset, src_codeset,
 				     src, src_size, repl_char);
@@ -1585,6 +1648,9 @@ vbi_export_mem			(vbi_export *		e,
 
 	assert (NULL != e);
 
+	if (unlikely (0 != e->target))
+		return -1; /* in export session */
+
 	reset_error (e);
 
 	e->target = VBI_EXPORT_TARGET_MEM;
@@ -1666,6 +1732,9 @@ vbi_export_alloc		(vbi_export *		e,
 
 	assert (NULL != e);
 
+	if (unlikely (0 != e->target))
+		return NULL; /* in export session */
+
 	reset_error (e);
 
 	e->target = VBI_EXPORT_TARGET_ALLOC;
@@ -1707,64 +1776,33 @@ vbi_export_alloc		(vbi_export *		e,
 	return result;
 }
 
-/**
- * @param e Initialized vbi_export object.
- * @param fp Buffered i/o stream to write to.
- * @param pg Page to be exported.
- * 
- * This function writes the @a pg contents, converted to the format
- * selected with the vbi_export_new() function, into the stream @a fp.
- * The caller is responsible for opening and closing the stream. Don't
- * forget to check for i/o errors after closing. Note this function
- * may write incomplete files when an error occurs.
- *
- * You can call this function repeatedly, it does not change the state
- * of the vbi_export or vbi_page structure.
- * 
- * @returns
- * @c FALSE on failure, @c TRUE on success.
- */
-vbi_bool
-vbi_export_stdio		(vbi_export *		e,
-				 FILE *			fp,
-				 vbi_page *		pg)
-{
-	vbi_bool success;
-	int saved_errno;
-
-	if (NULL == e || NULL == fp || NULL == pg)
-		return FALSE;
+/* Output buffer retention. Exports to a file or stream keep the
+   buffer for the next export, the buffer of vbi_export_alloc() is
+   given to the client and vbi_export_mem() uses the client's. */
 
-	reset_error (e);
-
-	e->target = VBI_EXPORT_TARGET_FP;
-	e->_write = write_fp;
-
-	e->_handle.fp = fp;
-	clearerr (fp);
-
-	CLEAR (e->buffer);
-
-	e->write_error = FALSE;
+static void
+take_spare_buffer		(vbi_export *		e)
+{
+	e->buffer.data = e->_spare_buffer.data;
+	e->buffer.offset = 0;
+	e->buffer.capacity = e->_spare_buffer.capacity;
 
-	success = e->_class->export (e, pg);
+	CLEAR (e->_spare_buffer);
+}
 
-	if (success)
-		success = vbi_export_flush (e);
+static void
+keep_spare_buffer		(vbi_export *		e)
+{
+	/* Don't hog memory after exporting some huge image. */
+	if (e->buffer.capacity > (1 << 20)) {
+		free (e->buffer.data);
+		CLEAR (e->buffer);
+	}
 
-	saved_errno = errno;
+	e->_spare_buffer.data = e->buffer.data;
+	e->_spare_buffer.capacity = e->buffer.capacity;
 
-	free (e->buffer.data);
 	CLEAR (e->buffer);
-
-	memset (&e->_handle, -1, sizeof (e->_handle));
-
-	e->_write = NULL;
-	e->target = 0;
-
-	errno = saved_errno;
-
-	return success;
 }
 
 static int
@@ -1803,81 +1841,320 @@ xopen				(const char *		name,
 
 /**
  * @param e Initialized vbi_export object.
- * @param name File to be created.
- * @param pg Page to be exported.
- * 
- * Writes the @a pg contents, converted to the format selected with
- * vbi_export_new(), into a new file with the given @a name. When an
- * error occurs after the file was opened, the function deletes the file.
- * 
- * You can call this function repeatedly, it does not change the state
- * of the vbi_export or vbi_page structure.
- * 
+ * @param fp Buffered i/o stream to write to.
+ *
+ * Starts an export session. Subsequent calls to vbi_export_pages()
+ * write pages, converted to the format selected with vbi_export_new(),
+ * one after another into the stream @a fp until you call
+ * vbi_export_end(). The caller is responsible for opening and closing
+ * the stream.
+ *
+ * Exporting many pages this way is faster than calling
+ * vbi_export_stdio() for each page because output is collected in a
+ * buffer and written in larger blocks.
+ *
  * @returns
- * @c FALSE on failure, @c TRUE on success.
+ * @c FALSE if an export session has already been started with this
+ * vbi_export object, @c TRUE on success.
+ *
+ * @since 0.2.36
  */
 vbi_bool
-vbi_export_file			(vbi_export *		e,
-				 const char *		name,
-				 vbi_page *		pg)
+vbi_export_begin_stdio		(vbi_export *		e,
+				 FILE *			fp)
 {
-	vbi_bool success;
-	int saved_errno;
+	assert (NULL != e);
+	assert (NULL != fp);
 
-	if (NULL == e || NULL == name || NULL == pg)
+	if (unlikely (0 != e->target))
 		return FALSE;
 
 	reset_error (e);
 
+	e->target = VBI_EXPORT_TARGET_FP;
+	e->_write = write_fp;
+
+	e->_handle.fp = fp;
+	clearerr (fp);
+
+	take_spare_buffer (e);
+
+	e->write_error = FALSE;
+
+	return TRUE;
+}
+
+/**
+ * @param e Initialized vbi_export object.
+ * @param name File to be created. The string must remain valid
+ *   until the session ends.
+ *
+ * Starts an export session like vbi_export_begin_stdio(), but writes
+ * into a new file with the given @a name. When an error occurs the
+ * vbi_export_end() function deletes the file.
+ *
+ * @returns
+ * @c FALSE if an export session has already been started with this
+ * vbi_export object or the file could not be created, @c TRUE on
+ * success.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_export_begin_file		(vbi_export *		e,
+				 const char *		name)
+{
+	int fd;
+
+	assert (NULL != e);
+	assert (NULL != name);
+
+	if (unlikely (0 != e->target))
+		return FALSE;
+
+	reset_error (e);
+
+	fd = xopen (name,
+		    O_WRONLY | O_CREAT | O_TRUNC,
+		    (S_IRUSR | S_IWUSR |
+		     S_IRGRP | S_IWGRP |
+		     S_IROTH | S_IWOTH));
+	if (-1 == fd) {
+		vbi_export_error_printf
+			(e, _("Cannot create file '%s': %s."),
+			 name, strerror (errno));
+		return FALSE;
+	}
+
 	/* For error messages. */
 	e->name = name;
 
 	e->target = VBI_EXPORT_TARGET_FILE;
 	e->_write = write_fd;
 
-	e->_handle.fd = xopen (name,
-			       O_WRONLY | O_CREAT | O_TRUNC,
-			       (S_IRUSR | S_IWUSR |
-				S_IRGRP | S_IWGRP |
-				S_IROTH | S_IWOTH));
-	if (-1 == e->_handle.fd) {
+	e->_handle.fd = fd;
+
+	take_spare_buffer (e);
+
+	e->write_error = FALSE;
+
+	return TRUE;
+}
+
+/**
+ * @param e Initialized vbi_export object.
+ * @param pg Vector of pointers to the pages to be exported.
+ * @param n_pages Number of pages in the @a pg vector.
+ *
+ * Writes the contents of the pages, converted to the format
+ * selected with vbi_export_new(), into the stream or file of the
+ * export session started with vbi_export_begin_stdio() or
+ * vbi_export_begin_file(). Pages are written in the order given,
+ * without separator. The function does not change the state of
+ * the vbi_page structures.
+ *
+ * @returns
+ * @c FALSE on failure, @c TRUE on success. After a failure you
+ * should end the session with vbi_export_end().
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_export_pages		(vbi_export *		e,
+				 const vbi_page * const *pg,
+				 unsigned int		n_pages)
+{
+	unsigned int i;
+
+	assert (NULL != e);
+	assert (NULL != pg);
+
+	if (unlikely (0 == e->target || e->write_error))
+		return FALSE;
+
+	for (i = 0; i < n_pages; ++i) {
+		/* Const cast because page formatting may alter private
+		   fields of pg. */
+		if (unlikely (!e->_class->export (e, (vbi_page *) pg[i]))) {
+			/* We may have written an incomplete page. */
+			e->write_error = TRUE;
+			return FALSE;
+		}
+
+		/* Collect small pages, write large blocks. */
+		if (e->buffer.offset >= 65536) {
+			if (unlikely (!vbi_export_flush (e)))
+				return FALSE;
+		}
+	}
+
+	return !e->write_error;
+}
+
+static vbi_bool
+stream_supported		(vbi_export *		e,
+				 vbi_bool		supported)
+{
+	if (unlikely (0 == e->target || e->write_error))
+		return FALSE;
+
+	if (unlikely (!supported)) {
 		vbi_export_error_printf
-			(e, _("Cannot create file '%s': %s."),
-			 name, strerror (errno));
+			(e, _("The %s format cannot be written "
+			      "incrementally."),
+			 e->_class->_public->label ?
+			 _(e->_class->_public->label) :
+			 e->_class->_public->keyword);
 		return FALSE;
 	}
 
-	CLEAR (e->buffer);
+	return TRUE;
+}
 
-	e->write_error = FALSE;
+static vbi_bool
+stream_written			(vbi_export *		e,
+				 vbi_bool		success)
+{
+	if (unlikely (!success)) {
+		e->write_error = TRUE;
+		return FALSE;
+	}
+
+	/* Collect small cues, write large blocks. */
+	if (e->buffer.offset >= 65536) {
+		if (unlikely (!vbi_export_flush (e)))
+			return FALSE;
+	}
+
+	return !e->write_error;
+}
+
+/**
+ * @param e Initialized vbi_export object.
+ * @param pg The page currently displayed.
+ * @param timestamp The time in seconds when @a pg was displayed,
+ *   for example the capture time of the last packet of a Teletext
+ *   subtitle page.
+ *
+ * Export modules for subtitle formats (such as "srt", "webvtt" and
+ * "ttml") can write the text of a sequence of pages as timed cues
+ * into the stream or file of the export session started with
+ * vbi_export_begin_stdio() or vbi_export_begin_file().
+ *
+ * Call this function whenever the displayed page changes, for
+ * instance when you received a @c VBI_EVENT_TTX_PAGE event for the
+ * subtitle page and formatted it for display. The text of @a pg
+ * becomes visible at @a timestamp and remains visible until the
+ * next call with a different text. Pages with no visible text end
+ * the previous cue. Timestamps must not decrease within a session.
+ * vbi_export_end() writes out the last cue.
+ *
+ * @returns
+ * @c FALSE if the export module cannot write cues or an error
+ * occurred, @c TRUE on success.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_export_stream_page		(vbi_export *		e,
+				 const vbi_page *	pg,
+				 double			timestamp)
+{
+	assert (NULL != e);
+	assert (NULL != pg);
+
+	if (!stream_supported (e, NULL != e->_class->stream_page))
+		return FALSE;
+
+	return stream_written (e, e->_class->stream_page
+			       (e, pg, timestamp));
+}
+
+/**
+ * @param e Initialized vbi_export object.
+ * @param ev An event from the Closed Caption decoder.
+ *
+ * Like vbi_export_stream_page(), but converts Closed Caption stream
+ * events carrying one completed row of caption text and the time it
+ * was received. The events can be passed through from an event
+ * handler, other events are ignored.
+ *
+ * @returns
+ * @c FALSE if the export module cannot write cues or an error
+ * occurred, @c TRUE on success.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_export_stream_event		(vbi_export *		e,
+				 const vbi_event *	ev)
+{
+	assert (NULL != e);
+	assert (NULL != ev);
+
+	if (!stream_supported (e, NULL != e->_class->stream_event))
+		return FALSE;
+
+	return stream_written (e, e->_class->stream_event (e, ev));
+}
+
+/**
+ * @param e Initialized vbi_export object.
+ *
+ * Ends an export session started with vbi_export_begin_stdio() or
+ * vbi_export_begin_file(), writing any buffered data. A file
+ * opened by vbi_export_begin_file() is closed, and deleted if
+ * an error occurred during the session.
+ *
+ * @returns
+ * @c FALSE if any error occurred during the session, @c TRUE on
+ * success.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_export_end			(vbi_export *		e)
+{
+	vbi_bool success;
+	int saved_errno;
+
+	assert (NULL != e);
+
+	if (unlikely (0 == e->target))
+		return FALSE;
 
-	success = e->_class->export (e, pg);
+	success = TRUE;
 
-	if (success)
-		success = vbi_export_flush (e);
+	if (NULL != e->_class->stream_end && !e->write_error)
+		success = e->_class->stream_end (e);
+
+	if (!vbi_export_flush (e))
+		success = FALSE;
 
 	saved_errno = errno;
 
-	free (e->buffer.data);
-	CLEAR (e->buffer);
+	keep_spare_buffer (e);
 
-	if (!success) {
-		struct stat st;
+	if (VBI_EXPORT_TARGET_FILE == e->target) {
+		if (!success) {
+			struct stat st;
 
-		/* There might be a race if we attempt to delete the
-		   file after closing it, so we mark it for deletion
-		   here or leave it alone when close() fails. Also
-		   delete only if @a name is regular file. */
-		if (0 == stat (name, &st)
-		    && S_ISREG (st.st_mode))
-			unlink (name);
-	}
+			/* There might be a race if we attempt to delete
+			   the file after closing it, so we mark it for
+			   deletion here or leave it alone when close()
+			   fails. Also delete only if @a name is regular
+			   file. */
+			if (0 == stat (e->name, &st)
+			    && S_ISREG (st.st_mode))
+				unlink (e->name);
+		}
 
-	if (-1 == xclose (e->_handle.fd)) {
-		if (success) {
-			saved_errno = errno;
-			vbi_export_write_error (e);
-			success = FALSE;
+		if (-1 == xclose (e->_handle.fd)) {
+			if (success) {
+				saved_errno = errno;
+				vbi_export_write_error (e);
+				success = FALSE;
+			}
 		}
 	}
 
@@ -1893,6 +2170,80 @@ vbi_export_file			(vbi_export *		e,
 	return success;
 }
 
+/**
+ * @param e Initialized vbi_export object.
+ * @param fp Buffered i/o stream to write to.
+ * @param pg Page to be exported.
+ * 
+ * This function writes the @a pg contents, converted to the format
+ * selected with the vbi_export_new() function, into the stream @a fp.
+ * The caller is responsible for opening and closing the stream. Don't
+ * forget to check for i/o errors after closing. Note this function
+ * may write incomplete files when an error occurs.
+ *
+ * You can call this function repeatedly, it does not change the state
+ * of the vbi_export or vbi_page structure.
+ * 
+ * @returns
+ * @c FALSE on failure, @c TRUE on success.
+ */
+vbi_bool
+vbi_export_stdio		(vbi_export *		e,
+				 FILE *			fp,
+				 vbi_page *		pg)
+{
+	const vbi_page *pgv[1];
+	vbi_bool success;
+
+	if (NULL == e || NULL == fp || NULL == pg)
+		return FALSE;
+
+	if (!vbi_export_begin_stdio (e, fp))
+		return FALSE;
+
+	pgv[0] = pg;
+
+	success = vbi_export_pages (e, pgv, 1);
+
+	return vbi_export_end (e) && success;
+}
+
+/**
+ * @param e Initialized vbi_export object.
+ * @param name File to be created.
+ * @param pg Page to be exported.
+ * 
+ * Writes the @a pg contents, converted to the format selected with
+ * vbi_export_new(), into a new file with the given @a name. When an
+ * error occurs after the file was opened, the function deletes the file.
+ * 
+ * You can call this function repeatedly, it does not change the state
+ * of the vbi_export or vbi_page structure.
+ * 
+ * @returns
+ * @c FALSE on failure, @c TRUE on success.
+ */
+vbi_bool
+vbi_export_file			(vbi_export *		e,
+				 const char *		name,
+				 vbi_page *		pg)
+{
+	const vbi_page *pgv[1];
+	vbi_bool success;
+
+	if (NULL == e || NULL == name || NULL == pg)
+		return FALSE;
+
+	if (!vbi_export_begin_file (e, name))
+		return FALSE;
+
+	pgv[0] = pg;
+
+	success = vbi_export_pages (e, pgv, 1);
+
+	return vbi_export_end (e) && success;
+}
+
 /**
  * @param export Pointer to a initialized vbi_export object.
  * @param templ See printf().
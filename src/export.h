@@ -28,6 +28,11 @@
 #include "event.h" /* vbi_network */
 #include "format.h" /* vbi_page */
 
+#ifndef VBI_DECODER
+#define VBI_DECODER
+typedef struct vbi_decoder vbi_decoder;
+#endif
+
 /* Public */
 
 #include <stdio.h> /* FILE */
@@ -279,6 +284,71 @@ vbi_export_alloc		(vbi_export *		e,
 extern vbi_bool			vbi_export_stdio(vbi_export *, FILE *fp, vbi_page *pg);
 extern vbi_bool			vbi_export_file(vbi_export *, const char *name, vbi_page *pg);
 
+extern vbi_bool
+vbi_export_begin_stdio		(vbi_export *		e,
+				 FILE *			fp)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_begin_file		(vbi_export *		e,
+				 const char *		name)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_pages		(vbi_export *		e,
+				 const vbi_page * const *pg,
+				 unsigned int		n_pages)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_end			(vbi_export *		e)
+  _vbi_nonnull ((1));
+extern vbi_bool
+vbi_export_stream_page		(vbi_export *		e,
+				 const vbi_page *	pg,
+				 double			timestamp)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_stream_event		(vbi_export *		e,
+				 const vbi_event *	ev)
+  _vbi_nonnull ((1, 2));
+
+/**
+ * @param pg The page just written.
+ * @param n_pages_done Number of pages written so far, including
+ *   this one.
+ * @param n_pages_total Estimated number of pages to be written.
+ * @param user_data User pointer passed to vbi_export_cache_dir()
+ *   or vbi_export_cache_stdio().
+ *
+ * Progress callback of the vbi_export_cache_dir() and
+ * vbi_export_cache_stdio() functions.
+ *
+ * @returns
+ * @c FALSE to cancel the export.
+ *
+ * @since 0.2.36
+ */
+typedef vbi_bool
+vbi_export_cache_progress_cb	(const vbi_page *	pg,
+				 unsigned int		n_pages_done,
+				 unsigned int		n_pages_total,
+				 void *			user_data);
+
+extern vbi_bool
+vbi_export_cache_dir		(vbi_export *		e,
+				 vbi_decoder *		vbi,
+				 const char *		dir_name,
+				 unsigned int		n_threads,
+				 vbi_export_cache_progress_cb *callback,
+				 void *			user_data)
+  _vbi_nonnull ((1, 2, 3));
+extern vbi_bool
+vbi_export_cache_stdio		(vbi_export *		e,
+				 vbi_decoder *		vbi,
+				 FILE *			fp,
+				 unsigned int		n_threads,
+				 vbi_export_cache_progress_cb *callback,
+				 void *			user_data)
+  _vbi_nonnull ((1, 2, 3));
+
 extern char *			vbi_export_errstr(vbi_export *);
 /** @} */
 
@@ -417,6 +487,16 @@ struct vbi_export {
 
 	/** A write error occurred (like ferror()). */
 	vbi_bool		write_error;
+
+	/**
+	 * Output buffer kept for the next export to a file or stream.
+	 *
+	 * Private field. Not to be accessed by export modules.
+	 */
+	struct {
+		char *			data;
+		size_t			capacity;
+	}			_spare_buffer;
 };
 
 /**
@@ -443,6 +523,20 @@ struct vbi_export_class {
 					       vbi_option_value *value);
 
 	vbi_bool		(* export)(vbi_export *, vbi_page *pg);
+
+	/**
+	 * Optional functions of modules which convert a sequence of
+	 * timed pages or events, see vbi_export_stream_page() and
+	 * vbi_export_stream_event(). @a stream_end is called by
+	 * vbi_export_end() to write out any pending data, also when
+	 * no stream functions were called in this session.
+	 */
+	vbi_bool		(* stream_page)(vbi_export *,
+						const vbi_page *pg,
+						double timestamp);
+	vbi_bool		(* stream_event)(vbi_export *,
+						 const vbi_event *ev);
+	vbi_bool		(* stream_end)(vbi_export *);
 };
 
 /**
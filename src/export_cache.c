@@ -0,0 +1,635 @@
+/*
+ *  libzvbi -- Exporting all cached Teletext pages
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "misc.h"
+#include "intl-priv.h"
+#include "export.h"
+#include "cache-priv.h"
+#include "vbi.h"
+#include "teletext_decoder.h"
+
+/* The calling thread enumerates and formats the pages, because
+   formatting accesses the cache which is not thread safe. Worker
+   threads convert the formatted pages with their own vbi_export
+   instance, which is the expensive part. The calling thread then
+   writes the results out in page number order. */
+
+enum job_state {
+	/* Slot can be reused. */
+	JOB_FREE,
+
+	/* Page formatted, waiting for a worker. */
+	JOB_READY,
+
+	/* A worker is exporting the page. */
+	JOB_BUSY,
+
+	/* Exported, waiting to be written out. */
+	JOB_DONE
+};
+
+struct job {
+	enum job_state		state;
+
+	/* Order in which the pages were formatted. */
+	unsigned int		seq;
+
+	vbi_page		pg;
+
+	/* Result of a stream export. */
+	void *			buffer;
+	size_t			buffer_size;
+
+	vbi_bool		success;
+	char *			errstr;
+};
+
+struct export_cache;
+
+struct worker {
+	struct export_cache *	ec;
+	vbi_export *		e;
+	pthread_t		thread;
+};
+
+struct export_cache {
+	pthread_mutex_t		mutex;
+
+	/* Signaled when a job becomes JOB_READY, or on quit. */
+	pthread_cond_t		job_ready;
+
+	/* Signaled when a job becomes JOB_DONE. */
+	pthread_cond_t		job_done;
+
+	struct job *		jobs;
+	unsigned int		n_jobs;
+
+	struct worker *		workers;
+	unsigned int		n_workers;
+
+	vbi_bool		quit;
+
+	/* Next sequence number to be formatted and written out. */
+	unsigned int		next_seq;
+	unsigned int		next_retire;
+
+	/* Stop exporting, but wait for busy workers. Written by the
+	   client thread with mutex locked, read by workers with mutex
+	   locked. */
+	vbi_bool		stop;
+
+	/* The vbi_export of the client, for error messages. */
+	vbi_export *		e;
+
+	vbi_decoder *		vbi;
+
+	/* Either dir_name and extension, or fp. */
+	const char *		dir_name;
+	char *			extension;
+	FILE *			fp;
+
+	unsigned int		n_pages_done;
+	unsigned int		n_pages_total;
+
+	vbi_export_cache_progress_cb *callback;
+	void *			user_data;
+};
+
+static char *
+page_file_name			(const struct export_cache *ec,
+				 const vbi_page *	pg)
+{
+	size_t size;
+	char *name;
+
+	size = strlen (ec->dir_name) + strlen (ec->extension) + 16;
+
+	name = malloc (size);
+	if (NULL == name)
+		return NULL;
+
+	snprintf (name, size, "%s/%03x_%04x%s%s",
+		  ec->dir_name,
+		  (unsigned int) pg->pgno,
+		  (unsigned int) pg->subno & 0xFFFF,
+		  (0 != ec->extension[0]) ? "." : "",
+		  ec->extension);
+
+	return name;
+}
+
+static void
+export_job			(struct worker *	w,
+				 struct job *		job)
+{
+	const struct export_cache *ec = w->ec;
+
+	if (NULL != ec->fp) {
+		job->buffer = vbi_export_alloc (w->e,
+						&job->buffer,
+						&job->buffer_size,
+						&job->pg);
+		job->success = (NULL != job->buffer);
+	} else {
+		char *name;
+
+		name = page_file_name (ec, &job->pg);
+		if (NULL == name) {
+			_vbi_export_malloc_error (w->e);
+			job->success = FALSE;
+		} else {
+			job->success = vbi_export_file (w->e, name, &job->pg);
+			free (name);
+		}
+	}
+
+	if (!job->success) {
+		const char *errstr = vbi_export_errstr (w->e);
+
+		job->errstr = strdup (errstr ? errstr : "");
+	}
+}
+
+static void *
+worker_thread			(void *			user_data)
+{
+	struct worker *w = (struct worker *) user_data;
+	struct export_cache *ec = w->ec;
+
+	pthread_mutex_lock (&ec->mutex);
+
+	for (;;) {
+		struct job *job;
+		vbi_bool stop;
+		unsigned int i;
+
+		/* Oldest page first. */
+		job = NULL;
+		for (i = 0; i < ec->n_jobs; ++i) {
+			if (JOB_READY == ec->jobs[i].state
+			    && (NULL == job || ec->jobs[i].seq < job->seq))
+				job = &ec->jobs[i];
+		}
+
+		if (NULL == job) {
+			if (ec->quit)
+				break;
+			pthread_cond_wait (&ec->job_ready, &ec->mutex);
+			continue;
+		}
+
+		job->state = JOB_BUSY;
+		stop = ec->stop;
+
+		pthread_mutex_unlock (&ec->mutex);
+
+		if (stop)
+			job->success = FALSE;
+		else
+			export_job (w, job);
+
+		pthread_mutex_lock (&ec->mutex);
+
+		job->state = JOB_DONE;
+
+		pthread_cond_broadcast (&ec->job_done);
+	}
+
+	pthread_mutex_unlock (&ec->mutex);
+
+	return NULL;
+}
+
+/* Called by the client thread with ec->mutex unlocked. */
+static void
+stop_export			(struct export_cache *	ec)
+{
+	pthread_mutex_lock (&ec->mutex);
+	ec->stop = TRUE;
+	pthread_mutex_unlock (&ec->mutex);
+}
+
+/* Writes out the result of a JOB_DONE, called with ec->mutex
+   unlocked. */
+static void
+retire_job			(struct export_cache *	ec,
+				 struct job *		job)
+{
+	assert (job->seq == ec->next_retire);
+
+	++ec->next_retire;
+
+	if (ec->stop) {
+		/* Discard. */
+	} else if (!job->success) {
+		vbi_export_error_printf (ec->e, "%s", job->errstr);
+		stop_export (ec);
+	} else {
+		if (NULL != ec->fp
+		    && job->buffer_size != fwrite (job->buffer, 1,
+						   job->buffer_size, ec->fp)) {
+			vbi_export_write_error (ec->e);
+			stop_export (ec);
+		} else {
+			++ec->n_pages_done;
+
+			if (NULL != ec->callback
+			    && !ec->callback (&job->pg,
+					      ec->n_pages_done,
+					      MAX (ec->n_pages_done,
+						   ec->n_pages_total),
+					      ec->user_data)) {
+				vbi_export_error_printf
+					(ec->e, _("Export canceled."));
+				stop_export (ec);
+			}
+		}
+	}
+
+	free (job->buffer);
+	job->buffer = NULL;
+	job->buffer_size = 0;
+
+	free (job->errstr);
+	job->errstr = NULL;
+}
+
+/* Waits until the job is JOB_FREE, writing out its previous
+   result if necessary. */
+static void
+free_job			(struct export_cache *	ec,
+				 struct job *		job)
+{
+	pthread_mutex_lock (&ec->mutex);
+
+	while (JOB_FREE != job->state) {
+		if (JOB_DONE == job->state) {
+			pthread_mutex_unlock (&ec->mutex);
+			retire_job (ec, job);
+			pthread_mutex_lock (&ec->mutex);
+
+			job->state = JOB_FREE;
+		} else {
+			pthread_cond_wait (&ec->job_done, &ec->mutex);
+		}
+	}
+
+	pthread_mutex_unlock (&ec->mutex);
+}
+
+static int
+count_page			(cache_page *		cp,
+				 vbi_bool		wrapped,
+				 void *			user_data)
+{
+	struct export_cache *ec = (struct export_cache *) user_data;
+
+	if (wrapped)
+		return 1; /* done */
+
+	if (PAGE_FUNCTION_LOP == cp->function)
+		++ec->n_pages_total;
+
+	return 0; /* next */
+}
+
+static int
+format_page			(cache_page *		cp,
+				 vbi_bool		wrapped,
+				 void *			user_data)
+{
+	struct export_cache *ec = (struct export_cache *) user_data;
+	struct job *job;
+
+	if (wrapped)
+		return 1; /* done */
+
+	if (PAGE_FUNCTION_LOP != cp->function)
+		return 0; /* next */
+
+	job = &ec->jobs[ec->next_seq % ec->n_jobs];
+
+	free_job (ec, job);
+
+	if (ec->stop)
+		return -1; /* abort */
+
+	if (!vbi_format_vt_page (ec->vbi, &job->pg, cp,
+				 ec->vbi->vt.max_level,
+				 /* display_rows */ 25,
+				 /* navigation */ TRUE))
+		return 0; /* skip */
+
+	pthread_mutex_lock (&ec->mutex);
+
+	job->seq = ec->next_seq++;
+	job->state = JOB_READY;
+
+	pthread_cond_signal (&ec->job_ready);
+
+	pthread_mutex_unlock (&ec->mutex);
+
+	return 0; /* next */
+}
+
+/* Copies the options of export module instance @a e. */
+static vbi_export *
+clone_export			(vbi_export *		e)
+{
+	vbi_export *e2;
+	vbi_option_info *oi;
+	int i;
+
+	e2 = vbi_export_new (e->_class->_public->keyword, NULL);
+	if (NULL == e2)
+		return NULL;
+
+	for (i = 0; (oi = vbi_export_option_info_enum (e, i)); ++i) {
+		vbi_option_value value;
+		vbi_bool success;
+
+		if (!vbi_export_option_get (e, oi->keyword, &value))
+			goto failed;
+
+		switch (oi->type) {
+		case VBI_OPTION_BOOL:
+		case VBI_OPTION_INT:
+		case VBI_OPTION_MENU:
+			success = vbi_export_option_set (e2, oi->keyword,
+							 value.num);
+			break;
+
+		case VBI_OPTION_REAL:
+			success = vbi_export_option_set (e2, oi->keyword,
+							 value.dbl);
+			break;
+
+		case VBI_OPTION_STRING:
+			success = vbi_export_option_set (e2, oi->keyword,
+							 value.str);
+			free (value.str);
+			break;
+
+		default:
+			success = FALSE;
+			break;
+		}
+
+		if (!success)
+			goto failed;
+	}
+
+	return e2;
+
+ failed:
+	vbi_export_delete (e2);
+
+	return NULL;
+}
+
+static vbi_bool
+export_cache			(struct export_cache *	ec,
+				 unsigned int		n_threads)
+{
+	vbi_decoder *vbi = ec->vbi;
+	vbi_bool success;
+	unsigned int i;
+	int err;
+
+	if (0 == n_threads) {
+		long n_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+
+		n_threads = (n_cpus > 0) ? n_cpus : 1;
+	}
+
+	n_threads = MIN (n_threads, 64U);
+
+	pthread_mutex_init (&ec->mutex, NULL);
+	pthread_cond_init (&ec->job_ready, NULL);
+	pthread_cond_init (&ec->job_done, NULL);
+
+	success = FALSE;
+
+	/* Two pages per thread so they need not wait for the
+	   calling thread. */
+	ec->n_jobs = n_threads * 2;
+	ec->jobs = calloc (ec->n_jobs, sizeof (*ec->jobs));
+	ec->workers = calloc (n_threads, sizeof (*ec->workers));
+	if (NULL == ec->jobs || NULL == ec->workers) {
+		_vbi_export_malloc_error (ec->e);
+		goto finish;
+	}
+
+	for (i = 0; i < n_threads; ++i) {
+		struct worker *w = &ec->workers[i];
+
+		w->ec = ec;
+		w->e = clone_export (ec->e);
+		if (NULL == w->e) {
+			_vbi_export_malloc_error (ec->e);
+			goto finish;
+		}
+
+		err = pthread_create (&w->thread, NULL, worker_thread, w);
+		if (0 != err) {
+			vbi_export_delete (w->e);
+			vbi_export_error_printf
+				(ec->e, _("Cannot create thread: %s."),
+				 strerror (err));
+			goto finish;
+		}
+
+		++ec->n_workers;
+	}
+
+	if (0 != vbi->cn->n_cached_pages) {
+		_vbi_cache_foreach_page (vbi->ca, vbi->cn,
+					 0x100, 0, +1,
+					 count_page, ec);
+
+		_vbi_cache_foreach_page (vbi->ca, vbi->cn,
+					 0x100, 0, +1,
+					 format_page, ec);
+	}
+
+	/* Write out the remaining pages. */
+	while (ec->next_retire < ec->next_seq)
+		free_job (ec, &ec->jobs[ec->next_retire % ec->n_jobs]);
+
+	success = !ec->stop;
+
+ finish:
+	pthread_mutex_lock (&ec->mutex);
+	ec->quit = TRUE;
+	pthread_cond_broadcast (&ec->job_ready);
+	pthread_mutex_unlock (&ec->mutex);
+
+	for (i = 0; i < ec->n_workers; ++i) {
+		pthread_join (ec->workers[i].thread, NULL);
+		vbi_export_delete (ec->workers[i].e);
+	}
+
+	free (ec->workers);
+	free (ec->jobs);
+
+	pthread_cond_destroy (&ec->job_done);
+	pthread_cond_destroy (&ec->job_ready);
+	pthread_mutex_destroy (&ec->mutex);
+
+	return success;
+}
+
+/**
+ * @param e Initialized vbi_export object. The pages will be
+ *   exported with the format and options of this object.
+ * @param vbi Initialized vbi_decoder context.
+ * @param dir_name Name of an existing directory.
+ * @param n_threads Number of threads converting pages. When zero
+ *   the function starts one thread for each CPU.
+ * @param callback Function called after each page was written,
+ *   can be @c NULL.
+ * @param user_data User pointer passed through to the @a callback.
+ *
+ * Exports all Teletext pages of the current network in the
+ * @a vbi cache, one file per page, into the directory @a dir_name.
+ * The files are named after the page and subpage number and the
+ * preferred filename extension of the export module, for example
+ * "100_0000.html".
+ *
+ * Pages are formatted as with vbi_fetch_vt_page() at the
+ * implementation level selected with vbi_teletext_set_level(),
+ * in the calling thread, then converted by a pool of worker
+ * threads. Regardless of the number of threads the @a callback
+ * is called in the calling thread, in ascending order of page and
+ * subpage numbers. As with vbi_fetch_vt_page() the function is
+ * not supposed to be called from a vbi_decoder event handler.
+ *
+ * @returns
+ * @c FALSE on failure or if the @a callback canceled the export,
+ * @c TRUE on success. The vbi_export_errstr() function returns a
+ * description of the error. Note the function may have written
+ * some files before an error occurred.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_export_cache_dir		(vbi_export *		e,
+				 vbi_decoder *		vbi,
+				 const char *		dir_name,
+				 unsigned int		n_threads,
+				 vbi_export_cache_progress_cb *callback,
+				 void *			user_data)
+{
+	struct export_cache ec;
+	const char *ext;
+	vbi_bool success;
+
+	assert (NULL != e);
+	assert (NULL != vbi);
+	assert (NULL != dir_name);
+
+	CLEAR (ec);
+
+	ec.e = e;
+	ec.vbi = vbi;
+	ec.dir_name = dir_name;
+	ec.callback = callback;
+	ec.user_data = user_data;
+
+	/* The first of a comma separated list. */
+	ext = e->_class->_public->extension;
+	if (NULL == ext)
+		ext = "";
+	ec.extension = strndup (ext, strcspn (ext, ","));
+	if (NULL == ec.extension) {
+		_vbi_export_malloc_error (e);
+		return FALSE;
+	}
+
+	success = export_cache (&ec, n_threads);
+
+	free (ec.extension);
+
+	return success;
+}
+
+/**
+ * @param e Initialized vbi_export object. The pages will be
+ *   exported with the format and options of this object.
+ * @param vbi Initialized vbi_decoder context.
+ * @param fp Buffered i/o stream to write to.
+ * @param n_threads Number of threads converting pages. When zero
+ *   the function starts one thread for each CPU.
+ * @param callback Function called after each page was written,
+ *   can be @c NULL.
+ * @param user_data User pointer passed through to the @a callback.
+ *
+ * Like vbi_export_cache_dir(), but writes all pages one after
+ * another into the stream @a fp, as vbi_export_pages() does, in
+ * ascending order of page and subpage numbers.
+ *
+ * @returns
+ * @c FALSE on failure or if the @a callback canceled the export,
+ * @c TRUE on success.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_export_cache_stdio		(vbi_export *		e,
+				 vbi_decoder *		vbi,
+				 FILE *			fp,
+				 unsigned int		n_threads,
+				 vbi_export_cache_progress_cb *callback,
+				 void *			user_data)
+{
+	struct export_cache ec;
+
+	assert (NULL != e);
+	assert (NULL != vbi);
+	assert (NULL != fp);
+
+	CLEAR (ec);
+
+	ec.e = e;
+	ec.vbi = vbi;
+	ec.fp = fp;
+	ec.callback = callback;
+	ec.user_data = user_data;
+
+	return export_cache (&ec, n_threads);
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
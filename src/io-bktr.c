@@ -119,9 +119,7 @@ bktr_read			(vbi_capture *		vc,
 			return -1;
 	}
 
-	gettimeofday(&tv, NULL);
-
-	(*raw)->timestamp = tv.tv_sec + tv.tv_usec * (1 / 1e6);
+	vbi_capture_io_stamp_buffer (*raw);
 
 	if (sliced) {
 		int lines;
@@ -136,7 +134,7 @@ bktr_read			(vbi_capture *		vc,
 		}
 
 		(*sliced)->size = lines * sizeof(vbi_sliced);
-		(*sliced)->timestamp = (*raw)->timestamp;
+		vbi_capture_io_copy_times (*sliced, *raw);
 	}
 
 	return 1;
@@ -27,7 +27,8 @@
 
 #include <unistd.h>		/* read() */
 #include <errno.h>
-#include <sys/select.h>
+#include <limits.h>		/* INT_MAX */
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -44,13 +45,19 @@ typedef uint64_t __u64;
 #include "vbi.h"		/* vbi_init_once */
 #include "dvb_demux.h"
 
+/* Default size of the read buffer, enough for one or two frames
+   at once. See vbi_capture_dvb_set_buffer_size(). */
+#define DEFAULT_BUFFER_SIZE (8 * 1024)
+#define MAX_BUFFER_SIZE (64 * 1024 * 1024)
+
 typedef struct {
 	vbi_capture		capture;
 
 	int			fd;
+	vbi_bool		is_device;
 
-	/* FIXME This may be too small? */
-	uint8_t			pes_buffer[1024 * 8];
+	uint8_t *		pes_buffer;
+	unsigned int		pes_buffer_size;
 	const uint8_t *		bp;
 	unsigned int		b_left;
 
@@ -61,6 +68,15 @@ typedef struct {
 	double			sample_time;
 	int64_t			last_pts;
 
+	/* System and monotonic time when the last read() returned,
+	   and the PTS of the last frame returned, or -1. */
+	double			block_time;
+	double			block_monotonic_time;
+	int64_t			prev_pts;
+
+	/* Frame counter derived from the PTS. */
+	int64_t			sequence;
+
 	vbi_bool		do_trace;
 	vbi_bool		bug_compatible;
 } vbi_capture_dvb;
@@ -124,25 +140,30 @@ select_read			(vbi_capture_dvb *	dvb,
 
 	/* Shortcut: don't wait if timeout is zero or elapsed. */
 	if ((tv.tv_sec | tv.tv_usec) > 0) {
-		fd_set set;
+		struct pollfd pfd;
+		int timeout_ms;
 		int r;
 
  select_again_with_timeout:
-		FD_ZERO (&set);
-		FD_SET (dvb->fd, &set);
+		pfd.fd = dvb->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
 
-		/* Note Linux select() may change tv. */
-		r = select (dvb->fd + 1,
-			    /* readable */ &set,
-			    /* writeable */ NULL,
-			    /* in exception */ NULL,
-			    &tv);
+		/* Round up, we must not return before the
+		   timeout expired. */
+		if (tv.tv_sec >= INT_MAX / 1000 - 1)
+			timeout_ms = INT_MAX;
+		else
+			timeout_ms = tv.tv_sec * 1000
+				+ (tv.tv_usec + 999) / 1000;
+
+		r = poll (&pfd, 1, timeout_ms);
 
 		switch (r) {
 		case -1: /* error */
 			switch (errno) {
 			case EINTR:
-				gettimeofday (now, /* timezone */ NULL);
+				vbi_capture_io_monotonic_time (now);
 				goto select_again;
 
 			default:
@@ -164,7 +185,7 @@ select_read			(vbi_capture_dvb *	dvb,
 	/* Non-blocking. */
 	actual = read (dvb->fd,
 		       dvb->pes_buffer,
-		       sizeof (dvb->pes_buffer));
+		       dvb->pes_buffer_size);
 
 	switch (actual) {
 	case -1: /* error */
@@ -176,7 +197,7 @@ select_read			(vbi_capture_dvb *	dvb,
 			if ((timeout->tv_sec | timeout->tv_usec) <= 0)
 				return 0; /* timeout */
 
-			gettimeofday (now, /* timezone */ NULL);
+			vbi_capture_io_monotonic_time (now);
 			timeout_subtract_elapsed (&tv, timeout, now, start);
 
 			if ((tv.tv_sec | tv.tv_usec) <= 0)
@@ -205,6 +226,46 @@ select_read			(vbi_capture_dvb *	dvb,
 	return actual;
 }
 
+/* A large read buffer can return many frames at once. We derive the
+   capture time of a frame from the time of the previous frame and
+   their presentation time stamps, but no frame can be captured after
+   the read() which returned it. So the sample times follow the PTS
+   clock and converge to the earliest time consistent with all reads. */
+static void
+timestamp_frame			(vbi_capture_dvb *	dvb,
+				 int64_t		pts)
+{
+	double t;
+
+	t = dvb->block_time;
+
+	if (dvb->prev_pts >= 0 && pts >= 0) {
+		int64_t delta;
+
+		/* PTS are 33 bits wide and wrap around. */
+		delta = (pts - dvb->prev_pts) & (((int64_t) 1 << 33) - 1);
+
+		/* Otherwise a discontinuity. */
+		if (delta < 90000) {
+			t = dvb->sample_time + delta * (1 / 90000.0);
+
+			/* EN 301 775 covers only 625 line systems,
+			   3600 ticks per frame. */
+			dvb->sequence += MAX ((delta + 1800) / 3600,
+					      (int64_t) 1);
+		} else {
+			/* Let the decoder resynchronize as if frames
+			   were dropped. */
+			dvb->sequence += 2;
+		}
+	} else {
+		dvb->sequence += 2;
+	}
+
+	dvb->sample_time = MIN (t, dvb->block_time);
+	dvb->prev_pts = pts;
+}
+
 static int
 dvb_read			(vbi_capture *		cap,
 				 vbi_capture_buffer **	raw,
@@ -228,25 +289,31 @@ dvb_read			(vbi_capture *		cap,
 
 	/* When timeout is zero elapsed time doesn't matter. */
 	if ((timeout->tv_sec | timeout->tv_usec) > 0)
-		gettimeofday (&start, /* timezone */ NULL);
+		vbi_capture_io_monotonic_time (&start);
 
 	now = start;
 
 	for (;;) {
 		if (0 == dvb->b_left) {
+			struct timeval tv;
 			ssize_t actual;
 
 			actual = select_read (dvb, &now, &start, timeout);
 			if (actual <= 0)
 				return actual;
 
-			gettimeofday (&now, /* timezone */ NULL);
+			if ((timeout->tv_sec | timeout->tv_usec) > 0)
+				vbi_capture_io_monotonic_time (&now);
 
 			/* XXX inaccurate. Should be the time when we
 			   received the first byte of the first packet
 			   containing data of the returned frame. Or so. */
-			dvb->sample_time = now.tv_sec
-				+ now.tv_usec * (1 / 1e6);
+			gettimeofday (&tv, /* timezone */ NULL);
+			dvb->block_time = tv.tv_sec
+				+ tv.tv_usec * (1 / 1e6);
+			vbi_capture_io_monotonic_time (&tv);
+			dvb->block_monotonic_time = tv.tv_sec
+				+ tv.tv_usec * (1 / 1e6);
 
 			dvb->bp = dvb->pes_buffer;
 			dvb->b_left = actual;
@@ -265,8 +332,10 @@ dvb_read			(vbi_capture *		cap,
 					     &pts,
 					     &dvb->bp,
 					     &dvb->b_left);
-		if (n_lines > 0)
+		if (n_lines > 0) {
+			timestamp_frame (dvb, pts);
 			break;
+		}
 
 		if (dvb->bug_compatible) {
 			/* Only one read(), timeout ignored. */
@@ -277,13 +346,14 @@ dvb_read			(vbi_capture *		cap,
 		}
 	}
 
+	sb->timestamp = dvb->sample_time;
+	sb->monotonic_time = dvb->sample_time
+		- dvb->block_time + dvb->block_monotonic_time;
+	sb->sequence = dvb->sequence;
+	sb->stream_time = pts; /* of the first sliced line */
+
 	if (sliced) {
 		sb->size = n_lines * sizeof (vbi_sliced);
-		sb->timestamp = dvb->sample_time;
-
-		/* XXX PTS needs an API change.
-		   sb->sample_time = dvb->sample_time;
-		   sb->stream_time = pts; (first sliced line) */
 		dvb->last_pts = pts;
 
 		*sliced = sb;
@@ -291,8 +361,8 @@ dvb_read			(vbi_capture *		cap,
 
 	if (raw && *raw) {
 		/* Not implemented yet. */
-		sb = *raw;
-		sb->size = 0;
+		(*raw)->size = 0;
+		vbi_capture_io_copy_times (*raw, sb);
 	}
 
 	return 1; /* success */
@@ -342,15 +412,20 @@ dvb_flush			(vbi_capture *		cap)
 
 	dvb->bp = dvb->pes_buffer;
 	dvb->b_left = 0;
+
+	dvb->prev_pts = -1;
 }
 
 static VBI_CAPTURE_FD_FLAGS
 dvb_get_fd_flags		(vbi_capture *		cap)
 {
-	cap = cap; /* unused, no warning please */
+	vbi_capture_dvb *dvb = PARENT (cap, vbi_capture_dvb, capture);
 
-	return (VBI_FD_HAS_SELECT |
-		VBI_FD_IS_DEVICE);
+	if (dvb->is_device)
+		return (VBI_FD_HAS_SELECT |
+			VBI_FD_IS_DEVICE);
+	else
+		return VBI_FD_HAS_SELECT;
 }
 
 static int
@@ -393,6 +468,66 @@ vbi_capture_dvb_filter		(vbi_capture *		cap,
 	return 0;
 }
 
+int
+vbi_capture_dvb_set_buffer_size	(vbi_capture *		cap,
+				 unsigned int		size)
+{
+	vbi_capture_dvb *dvb = PARENT (cap, vbi_capture_dvb, capture);
+	uint8_t *buffer;
+
+	if (size > MAX_BUFFER_SIZE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	size = MAX (size, (unsigned int) DEFAULT_BUFFER_SIZE);
+
+	if (dvb->is_device) {
+		if (-1 == ioctl (dvb->fd, DMX_SET_BUFFER_SIZE,
+				 (unsigned long) size)) {
+			if (EBUSY != errno)
+				return -1;
+
+			/* Older kernels cannot resize the buffer
+			   while the filter is running. */
+			if (-1 == ioctl (dvb->fd, DMX_STOP))
+				return -1;
+
+			if (-1 == ioctl (dvb->fd, DMX_SET_BUFFER_SIZE,
+					 (unsigned long) size)) {
+				int saved_errno = errno;
+
+				ioctl (dvb->fd, DMX_START);
+				errno = saved_errno;
+				return -1;
+			}
+
+			if (-1 == ioctl (dvb->fd, DMX_START))
+				return -1;
+		}
+	}
+
+	/* Keep data not demultiplexed yet. */
+	buffer = vbi_malloc (MAX (size, dvb->b_left));
+	if (NULL == buffer) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if (dvb->b_left > 0)
+		memcpy (buffer, dvb->bp, dvb->b_left);
+
+	vbi_free (dvb->pes_buffer);
+
+	dvb->pes_buffer = buffer;
+	dvb->pes_buffer_size = size;
+	dvb->bp = buffer;
+
+	printv ("Demultiplexer and read buffer size %u bytes\n", size);
+
+	return 0;
+}
+
 static void
 dvb_delete			(vbi_capture *		cap)
 {
@@ -410,6 +545,8 @@ dvb_delete			(vbi_capture *		cap)
 
 	vbi_dvb_demux_delete (dvb->demux);
 
+	vbi_free (dvb->pes_buffer);
+
 	/* Make unusable. */
 	CLEAR (*dvb);
 
@@ -427,7 +564,11 @@ open_device			(vbi_capture_dvb *	dvb,
 	if (-1 == stat (device_name, &st))
 		goto io_error;
 
-	if (!S_ISCHR (st.st_mode)) {
+	/* A pipe or file containing a PES stream can stand in
+	   for the device, e.g. for tests. */
+	if (S_ISCHR (st.st_mode)) {
+		dvb->is_device = TRUE;
+	} else if (!S_ISFIFO (st.st_mode) && !S_ISREG (st.st_mode)) {
 		asprintf (errstr, _("%s is not a device."),
 			  device_name);
 		saved_errno = 0;
@@ -504,6 +645,11 @@ vbi_capture_dvb_new2		(const char *		device_name,
 	if (NULL == dvb->demux)
 		goto no_memory;
 
+	dvb->pes_buffer_size = DEFAULT_BUFFER_SIZE;
+	dvb->pes_buffer = vbi_malloc (dvb->pes_buffer_size);
+	if (NULL == dvb->pes_buffer)
+		goto no_memory;
+
 	if (!open_device (dvb, device_name, errstr)) {
 		saved_errno = errno;
 		goto failed;
@@ -642,6 +788,37 @@ vbi_capture_dvb_filter		(vbi_capture *		cap,
 	return -1;
 }
 
+/**
+ * @param cap Initialized DVB vbi_capture context.
+ * @param size Buffer size in bytes, at most 64 MiB.
+ *
+ * Sets the size of the kernel demultiplexer buffer of the DVB device
+ * and of the buffer the capture context reads into. The default size
+ * suffices for one or two frames of VBI data. At high data rates, or
+ * when the application reads in bursts, a larger buffer prevents
+ * overflows in the device and lets the context demultiplex many
+ * frames per read() call. Capture timestamps of frames returned from
+ * the same read() are then derived from their presentation time
+ * stamps.
+ *
+ * When the context reads from a pipe or file instead of a device,
+ * only the read buffer is resized.
+ *
+ * @returns
+ * -1 on failure with errno set, 0 on success.
+ *
+ * @since 0.2.36
+ */
+int
+vbi_capture_dvb_set_buffer_size	(vbi_capture *		cap,
+				 unsigned int		size)
+{
+	cap = cap; /* unused, no warning please */
+	size = size;
+
+	return -1;
+}
+
 /**
  * @param device_name Name of the DVB device to open.
  * @param pid Filter out a stream with this PID. You can pass 0 here
@@ -651,6 +828,9 @@ vbi_capture_dvb_filter		(vbi_capture *		cap,
  * @param trace If @c TRUE print progress and warning messages on stderr.
  *
  * Initializes a vbi_capture context reading from a Linux DVB device.
+ * Since version 0.2.36 @a device_name can also name a pipe or file
+ * containing a PES stream with VBI data, in which case @a pid must
+ * be 0.
  * 
  * @returns
  * Initialized vbi_capture context, @c NULL on failure.
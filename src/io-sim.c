@@ -1429,6 +1429,7 @@ typedef struct {
 
 	double			capture_time;
 	int64_t			stream_time;
+	int64_t			sequence;
 
 	vbi_capture_buffer	sliced_buffer;
 	vbi_sliced		sliced[50];
@@ -2307,6 +2308,17 @@ delay_raw_data			(vbi_capture_sim *	sim,
 	sim->desync_i = i ^ 1;
 }
 
+static void
+sim_buffer_times		(vbi_capture_sim *	sim,
+				 vbi_capture_buffer *	b)
+{
+	/* Simulated time never jumps. */
+	b->timestamp = sim->capture_time;
+	b->monotonic_time = sim->capture_time;
+	b->sequence = sim->sequence;
+	b->stream_time = -1;
+}
+
 static vbi_bool
 sim_read			(vbi_capture *		cap,
 				 vbi_capture_buffer **	raw,
@@ -2344,7 +2356,7 @@ sim_read			(vbi_capture *		cap,
 			(*raw)->size = sim->raw_buffer.size;
 		}
 
-		(*raw)->timestamp = sim->capture_time;
+		sim_buffer_times (sim, *raw);
 
 		memset (raw_data, 0x80, sim->raw_buffer.size);
 
@@ -2399,7 +2411,7 @@ sim_read			(vbi_capture *		cap,
 		}
 
 		(*sliced)->size = n_lines * sizeof (sim->sliced[0]);
-		(*sliced)->timestamp = sim->capture_time;
+		sim_buffer_times (sim, *sliced);
 	}
 
 	if (SYSTEM_525 (&sim->sp)) {
@@ -2408,6 +2420,8 @@ sim_read			(vbi_capture *		cap,
 		sim->capture_time += 1 / 25.0;
 	}
 
+	++sim->sequence;
+
 	return TRUE;
 }
 
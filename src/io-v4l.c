@@ -263,8 +263,7 @@ v4l_read(vbi_capture *vc, vbi_capture_buffer **raw,
 			break;
 	}
 
-	gettimeofday(&tv, NULL);
-	(*raw)->timestamp = tv.tv_sec + tv.tv_usec * (1 / 1e6);
+	vbi_capture_io_stamp_buffer (*raw);
 
 	if (sliced) {
 		int lines;
@@ -279,7 +278,7 @@ v4l_read(vbi_capture *vc, vbi_capture_buffer **raw,
 		}
 
 		(*sliced)->size = lines * sizeof(vbi_sliced);
-		(*sliced)->timestamp = (*raw)->timestamp;
+		vbi_capture_io_copy_times (*sliced, *raw);
 	}
 
 	return 1;
@@ -88,6 +88,12 @@ typedef uint64_t __u64;
 
 #define FLUSH_FRAME_COUNT       2
 
+/* Linux 3.9 and later. */
+#ifndef V4L2_BUF_FLAG_TIMESTAMP_MASK
+#  define V4L2_BUF_FLAG_TIMESTAMP_MASK		0xE000
+#  define V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC	0x2000
+#endif
+
 typedef struct vbi_capture_v4l2 {
 	vbi_capture		capture;
 
@@ -115,6 +121,11 @@ typedef struct vbi_capture_v4l2 {
 	vbi_capture_buffer	sliced_buffer;
 	int			flush_frame_count;
 
+	/* Driver frame counter, extended to 64 bits. */
+	int64_t			sequence;
+	unsigned int		n_frames;
+	vbi_bool		sequence_broken;
+
 	vbi_bool		pal_start1_fix;
 	vbi_bool		saa7134_ntsc_fix;
 	vbi_bool		bttv_offset_fix;
@@ -155,7 +166,71 @@ vbi_sliced_data_from_raw	(vbi_capture_v4l2 *	v,
 					   (uint8_t *) raw->data);
 
 	b->size = n_lines * sizeof (vbi_sliced);
-	b->timestamp = raw->timestamp;
+	vbi_capture_io_copy_times (b, raw);
+}
+
+/* Stores the capture times and frame counter of the buffer
+   v->vbuf in b. */
+static void
+stream_buffer_times		(vbi_capture_v4l2 *	v,
+				 vbi_capture_buffer *	b)
+{
+	struct timeval tv;
+	double offset;
+	double t;
+
+	t = v->vbuf.timestamp.tv_sec
+		+ v->vbuf.timestamp.tv_usec * (1 / 1e6);
+
+	/* Older drivers read the system time, newer ones the
+	   monotonic clock. We return both, converting with the
+	   current offset between the clocks. */
+	gettimeofday (&tv, /* timezone */ NULL);
+	offset = tv.tv_sec + tv.tv_usec * (1 / 1e6);
+	vbi_capture_io_monotonic_time (&tv);
+	offset -= tv.tv_sec + tv.tv_usec * (1 / 1e6);
+
+	if (V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+	    == (v->vbuf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK)) {
+		b->monotonic_time = t;
+		b->timestamp = t + offset;
+	} else {
+		b->timestamp = t;
+		b->monotonic_time = t - offset;
+	}
+
+	/* The counter is 32 bits wide and wraps around. When the
+	   stream restarts reset_sequence() starts over. Some drivers
+	   do not count at all. */
+	if (v->n_frames > 0) {
+		uint32_t last = (uint32_t) v->sequence;
+
+		if (v->vbuf.sequence == last)
+			v->sequence_broken = TRUE;
+		else if (v->vbuf.sequence < last)
+			v->sequence += (int64_t) 1 << 32;
+	}
+
+	v->sequence = (v->sequence & ~(int64_t) 0xFFFFFFFF)
+		| v->vbuf.sequence;
+	++v->n_frames;
+
+	b->sequence = v->sequence_broken ? -1 : v->sequence;
+	b->stream_time = -1;
+}
+
+/* Called when the stream stops. The driver restarts its frame
+   counter at zero with the next VIDIOC_STREAMON. We continue at the
+   next multiple of 2**32 so our counter never goes backwards and
+   shows a gap. */
+static void
+reset_sequence			(vbi_capture_v4l2 *	v)
+{
+	if (v->n_frames > 0)
+		v->sequence = (v->sequence | 0xFFFFFFFF) + 1;
+
+	v->n_frames = 0;
+	v->sequence_broken = FALSE;
 }
 
 
@@ -168,6 +243,8 @@ v4l2_stream_stop(vbi_capture_v4l2 *v)
 		if (-1 == xioctl (v, VIDIOC_STREAMOFF, &v->btype)) {
 			/* Error ignored. */
 		}
+
+		reset_sequence (v);
 	}
 
 	for (; v->num_raw_buffers > 0; v->num_raw_buffers--) {
@@ -341,6 +418,8 @@ restart_stream			(vbi_capture_v4l2 *	v)
 	if (-1 == xioctl (v, VIDIOC_STREAMOFF, &v->btype))
 		return FALSE;
 
+	reset_sequence (v);
+
 	for (i = 0; i < v->num_raw_buffers; ++i) {
 		struct v4l2_buffer vbuf;
 
@@ -458,8 +537,7 @@ v4l2_stream(vbi_capture *vc, vbi_capture_buffer **raw,
 	assert (v->vbuf.index < v->num_raw_buffers);
 
 	b = &v->raw_buffer[v->vbuf.index];
-	b->timestamp = v->vbuf.timestamp.tv_sec
-		+ v->vbuf.timestamp.tv_usec * (1 / 1e6);
+	stream_buffer_times (v, b);
 
 	if (NULL != raw) {
 		vbi_capture_buffer *r;
@@ -479,7 +557,7 @@ v4l2_stream(vbi_capture *vc, vbi_capture_buffer **raw,
 			/* FIXME client should pass max buffer size. */
 			r->size = b->size;
 
-			r->timestamp = b->timestamp; 
+			vbi_capture_io_copy_times (r, b);
 		}
 	}
 
@@ -712,9 +790,7 @@ v4l2_read(vbi_capture *vc, vbi_capture_buffer **raw,
 			break;
 	}
 
-	gettimeofday(&tv, NULL);
-
-	(*raw)->timestamp = tv.tv_sec + tv.tv_usec * (1 / 1e6);
+	vbi_capture_io_stamp_buffer (*raw);
 
 	if (sliced) {
 		vbi_sliced_data_from_raw (v, sliced, *raw);
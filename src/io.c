@@ -33,6 +33,12 @@
 #include <sys/time.h>		/* struct timeval */
 #include <sys/types.h>
 #include <errno.h>
+#include <limits.h>		/* INT_MAX */
+#include <poll.h>
+#include <time.h>		/* clock_gettime() */
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
 
 #include "misc.h"
 #include "io.h"
@@ -555,6 +561,625 @@ vbi_capture_io_select		(int			fd,
 	}
 }
 
+/**
+ * @internal
+ *
+ * @param tv The current time is stored here.
+ *
+ * @brief Reads a clock to measure elapsed time.
+ *
+ * Unlike gettimeofday() the monotonic clock does not jump when the
+ * system time is set, e.g. by NTP. Where it is not available the
+ * function falls back to gettimeofday().
+ */
+void
+vbi_capture_io_monotonic_time	(struct timeval *	tv)
+{
+#if defined (HAVE_CLOCK_GETTIME) && defined (CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (0 == clock_gettime (CLOCK_MONOTONIC, &ts)) {
+		tv->tv_sec = ts.tv_sec;
+		tv->tv_usec = ts.tv_nsec / 1000;
+		return;
+	}
+#endif
+	gettimeofday (tv, /* timezone */ NULL);
+}
+
+/**
+ * @internal
+ *
+ * @param b Buffer to stamp.
+ *
+ * @brief Stores the current system and monotonic time in a buffer.
+ *
+ * For drivers which cannot tell when they captured a frame. The
+ * buffer has no frame counter and stream time.
+ */
+void
+vbi_capture_io_stamp_buffer	(vbi_capture_buffer *	b)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, /* timezone */ NULL);
+	b->timestamp = tv.tv_sec + tv.tv_usec * (1 / 1e6);
+
+	vbi_capture_io_monotonic_time (&tv);
+	b->monotonic_time = tv.tv_sec + tv.tv_usec * (1 / 1e6);
+
+	b->sequence = -1;
+	b->stream_time = -1;
+}
+
+/**
+ * @internal
+ *
+ * @param dst Destination buffer.
+ * @param src Source buffer.
+ *
+ * @brief Copies capture times and the frame counter, e.g. from a
+ *   raw to a sliced buffer.
+ */
+void
+vbi_capture_io_copy_times	(vbi_capture_buffer *	dst,
+				 const vbi_capture_buffer *src)
+{
+	dst->timestamp = src->timestamp;
+	dst->monotonic_time = src->monotonic_time;
+	dst->sequence = src->sequence;
+	dst->stream_time = src->stream_time;
+}
+
+/* Capture groups. */
+
+/* Sources which cannot be waited on are read in this interval (ms). */
+#define GROUP_POLL_INTERVAL 10
+
+struct group_source {
+	vbi_capture *		capture;
+	void *			user_data;
+	int			priority;
+	vbi_bool		raw;
+
+	/* -1 if the source cannot be waited on. */
+	int			fd;
+
+	vbi_bool		ready;
+	vbi_bool		failed;
+
+	/* Serial number of the last frame, for round robin
+	   between sources of equal priority. */
+	unsigned int		last_served;
+};
+
+struct vbi_capture_group {
+	struct group_source **	sources;
+	unsigned int		n_sources;
+	unsigned int		capacity;
+
+	unsigned int		serial;
+
+#ifdef HAVE_SYS_EPOLL_H
+	int			epoll_fd;
+#else
+	struct pollfd *		pfd;
+#endif
+};
+
+static int
+timeval_to_ms			(const struct timeval *	tv)
+{
+	if ((tv->tv_sec | tv->tv_usec) <= 0)
+		return 0;
+	else if (tv->tv_sec >= INT_MAX / 1000 - 1)
+		return INT_MAX;
+
+	/* Round up, we must not return before the timeout expired. */
+	return tv->tv_sec * 1000 + (tv->tv_usec + 999) / 1000;
+}
+
+static vbi_bool
+group_watch			(vbi_capture_group *	g,
+				 struct group_source *	src)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+
+	CLEAR (ev);
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = src;
+
+	/* Fails with EPERM for regular files, which are always
+	   readable. We just read those periodically. */
+	if (-1 == epoll_ctl (g->epoll_fd, EPOLL_CTL_ADD, src->fd, &ev)) {
+		if (EPERM != errno)
+			return FALSE;
+
+		src->fd = -1;
+	}
+#else
+	g = g; /* unused, no warning please */
+	src = src;
+#endif
+
+	return TRUE;
+}
+
+static void
+group_unwatch			(vbi_capture_group *	g,
+				 struct group_source *	src)
+{
+	if (-1 == src->fd)
+		return;
+
+#ifdef HAVE_SYS_EPOLL_H
+	/* Error ignored. Older kernels require a non-NULL event. */
+	{
+		struct epoll_event ev;
+
+		CLEAR (ev);
+		epoll_ctl (g->epoll_fd, EPOLL_CTL_DEL, src->fd, &ev);
+	}
+#else
+	g = g; /* unused, no warning please */
+#endif
+
+	src->fd = -1;
+}
+
+/* Waits until a source becomes readable or the timeout expires,
+   and sets the ready flag of readable sources. */
+static vbi_bool
+group_wait			(vbi_capture_group *	g,
+				 int			timeout_ms)
+{
+	unsigned int i;
+	int n;
+
+	for (i = 0; i < g->n_sources; ++i)
+		g->sources[i]->ready = FALSE;
+
+#ifdef HAVE_SYS_EPOLL_H
+	{
+		struct epoll_event events[16];
+
+		/* Level triggered, sources not reported here will
+		   be reported again on the next call. */
+		n = epoll_wait (g->epoll_fd, events,
+				N_ELEMENTS (events), timeout_ms);
+		if (-1 == n)
+			return (EINTR == errno);
+
+		while (n-- > 0) {
+			struct group_source *src = events[n].data.ptr;
+
+			src->ready = TRUE;
+		}
+	}
+#else
+	{
+		unsigned int n_fds = 0;
+
+		for (i = 0; i < g->n_sources; ++i) {
+			if (-1 == g->sources[i]->fd)
+				continue;
+
+			g->pfd[n_fds].fd = g->sources[i]->fd;
+			g->pfd[n_fds].events = POLLIN;
+			g->pfd[n_fds].revents = 0;
+			++n_fds;
+		}
+
+		n = poll (g->pfd, n_fds, timeout_ms);
+		if (-1 == n)
+			return (EINTR == errno);
+
+		n_fds = 0;
+
+		for (i = 0; i < g->n_sources; ++i) {
+			if (-1 == g->sources[i]->fd)
+				continue;
+
+			if (g->pfd[n_fds++].revents != 0)
+				g->sources[i]->ready = TRUE;
+		}
+	}
+#endif
+
+	return TRUE;
+}
+
+/* Reads one frame from each ready source in order of priority,
+   until max_frames are stored. */
+static unsigned int
+group_serve			(vbi_capture_group *	g,
+				 vbi_capture_group_frame *frames,
+				 unsigned int		max_frames)
+{
+	unsigned int n_frames;
+
+	n_frames = 0;
+
+	while (n_frames < max_frames) {
+		struct group_source *src;
+		vbi_capture_group_frame *f;
+		struct timeval zero;
+		unsigned int i;
+		int r;
+
+		src = NULL;
+
+		for (i = 0; i < g->n_sources; ++i) {
+			struct group_source *s = g->sources[i];
+
+			if (!s->ready || s->failed)
+				continue;
+
+			if (NULL == src
+			    || s->priority > src->priority
+			    || (s->priority == src->priority
+				&& (int)(s->last_served
+					 - src->last_served) < 0))
+				src = s;
+		}
+
+		if (NULL == src)
+			break;
+
+		src->ready = FALSE;
+
+		f = frames + n_frames;
+
+		f->capture = src->capture;
+		f->user_data = src->user_data;
+		f->raw = NULL;
+		f->sliced = NULL;
+		f->error = 0;
+
+		/* Don't block, the source may have returned
+		   an incomplete frame. */
+		zero.tv_sec = 0;
+		zero.tv_usec = 0;
+
+		r = vbi_capture_pull (src->capture,
+				      src->raw ? &f->raw : NULL,
+				      &f->sliced, &zero);
+		if (r > 0) {
+			src->last_served = ++g->serial;
+			++n_frames;
+		} else if (r < 0) {
+			/* Stop reading from this source, we would
+			   only get the same error again. */
+			f->error = errno;
+			f->raw = NULL;
+			f->sliced = NULL;
+			src->failed = TRUE;
+			group_unwatch (g, src);
+			++n_frames;
+		}
+	}
+
+	return n_frames;
+}
+
+/**
+ * @param g Capture group allocated with vbi_capture_group_new().
+ * @param frames Frames are stored here.
+ * @param max_frames Capacity of the @a frames array.
+ * @param timeout Wait timeout, will be read only.
+ *
+ * Waits until any capture context in the group has data, then reads
+ * one frame from each context which is ready, without blocking again.
+ * When more contexts are ready than fit into the @a frames array,
+ * those with higher priority come first, and contexts of the same
+ * priority take turns. The frames are stored in order of priority.
+ *
+ * When reading from a context fails the function stores a frame with
+ * @c NULL data and the error code, and no longer reads from this
+ * context. You can remove it and add it again to resume reading.
+ *
+ * Contexts which do not support select() are read every few
+ * milliseconds while the function waits.
+ *
+ * The returned data remains valid until the next
+ * vbi_capture_group_pull() call and must be read only.
+ *
+ * @returns
+ * The number of frames stored in @a frames, 0 on timeout, -1 if
+ * waiting failed. Examine @c errno for details.
+ *
+ * @since 0.2.36
+ */
+int
+vbi_capture_group_pull		(vbi_capture_group *	g,
+				 vbi_capture_group_frame *frames,
+				 unsigned int		max_frames,
+				 struct timeval *	timeout)
+{
+	struct timeval start;
+	struct timeval now;
+	struct timeval left;
+	vbi_bool first;
+
+	assert (NULL != g);
+	assert (NULL != frames);
+	assert (NULL != timeout);
+
+	if (0 == max_frames)
+		return 0;
+
+	vbi_capture_io_monotonic_time (&start);
+
+	left = *timeout;
+	first = TRUE;
+
+	for (;;) {
+		unsigned int n_frames;
+		vbi_bool have_polled;
+		unsigned int i;
+		int timeout_ms;
+
+		have_polled = FALSE;
+
+		for (i = 0; i < g->n_sources; ++i) {
+			if (-1 == g->sources[i]->fd
+			    && !g->sources[i]->failed)
+				have_polled = TRUE;
+		}
+
+		timeout_ms = timeval_to_ms (&left);
+
+		if (have_polled) {
+			if (first)
+				timeout_ms = 0;
+			else
+				timeout_ms = MIN (timeout_ms,
+						  GROUP_POLL_INTERVAL);
+		}
+
+		if (!group_wait (g, timeout_ms))
+			return -1;
+
+		for (i = 0; i < g->n_sources; ++i) {
+			if (-1 == g->sources[i]->fd)
+				g->sources[i]->ready = TRUE;
+		}
+
+		n_frames = group_serve (g, frames, max_frames);
+		if (n_frames > 0)
+			return n_frames;
+
+		vbi_capture_io_monotonic_time (&now);
+
+		/* left = timeout - (now - start). */
+		timeval_subtract (&left, &now, &start);
+		timeval_subtract (&left, timeout, &left);
+
+		if ((left.tv_sec | left.tv_usec) <= 0)
+			return 0; /* timeout */
+
+		first = FALSE;
+	}
+}
+
+/**
+ * @param g Capture group allocated with vbi_capture_group_new().
+ * @param capture Initialized vbi capture context.
+ * @param priority Priority of this context relative to others in
+ *   the group, higher values come first.
+ * @param raw If @c TRUE vbi_capture_group_pull() returns raw VBI
+ *   data along with the sliced data of this context, as
+ *   vbi_capture_pull() does.
+ * @param user_data Pointer stored in the frames of this context.
+ *
+ * Adds a capture context to the group. The group does not take
+ * ownership of the context, you must remove it from the group before
+ * you delete it.
+ *
+ * @returns
+ * @c FALSE if the context is already in the group or
+ * on failure, errno set.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_capture_group_add		(vbi_capture_group *	g,
+				 vbi_capture *		capture,
+				 int			priority,
+				 vbi_bool		raw,
+				 void *			user_data)
+{
+	struct group_source *src;
+	unsigned int i;
+
+	assert (NULL != g);
+	assert (NULL != capture);
+
+	for (i = 0; i < g->n_sources; ++i) {
+		if (capture == g->sources[i]->capture) {
+			errno = EEXIST;
+			return FALSE;
+		}
+	}
+
+	if (g->n_sources >= g->capacity) {
+		struct group_source **sources;
+		unsigned int capacity;
+
+		capacity = MAX (g->capacity * 2, 4U);
+
+		sources = vbi_realloc (g->sources,
+				       capacity * sizeof (*sources));
+		if (NULL == sources) {
+			errno = ENOMEM;
+			return FALSE;
+		}
+
+		g->sources = sources;
+
+#ifndef HAVE_SYS_EPOLL_H
+		{
+			struct pollfd *pfd;
+
+			pfd = vbi_realloc (g->pfd, capacity * sizeof (*pfd));
+			if (NULL == pfd) {
+				errno = ENOMEM;
+				return FALSE;
+			}
+
+			g->pfd = pfd;
+		}
+#endif
+		g->capacity = capacity;
+	}
+
+	src = vbi_malloc (sizeof (*src));
+	if (NULL == src) {
+		errno = ENOMEM;
+		return FALSE;
+	}
+
+	CLEAR (*src);
+
+	src->capture = capture;
+	src->user_data = user_data;
+	src->priority = priority;
+	src->raw = !!raw;
+
+	if (vbi_capture_get_fd_flags (capture) & VBI_FD_HAS_SELECT)
+		src->fd = vbi_capture_fd (capture);
+	else
+		src->fd = -1;
+
+	/* Sources added later take their turn last. */
+	src->last_served = g->serial;
+
+	if (-1 != src->fd && !group_watch (g, src)) {
+		vbi_free (src);
+		return FALSE;
+	}
+
+	g->sources[g->n_sources++] = src;
+
+	return TRUE;
+}
+
+/**
+ * @param g Capture group allocated with vbi_capture_group_new().
+ * @param capture Capture context in the group.
+ *
+ * Removes a capture context from the group.
+ *
+ * @returns
+ * @c FALSE if the context is not in the group.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_capture_group_remove	(vbi_capture_group *	g,
+				 vbi_capture *		capture)
+{
+	unsigned int i;
+
+	assert (NULL != g);
+
+	for (i = 0; i < g->n_sources; ++i) {
+		struct group_source *src = g->sources[i];
+
+		if (capture != src->capture)
+			continue;
+
+		group_unwatch (g, src);
+
+		vbi_free (src);
+
+		memmove (&g->sources[i], &g->sources[i + 1],
+			 (g->n_sources - i - 1) * sizeof (*g->sources));
+		--g->n_sources;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * @param g Capture group allocated with vbi_capture_group_new(),
+ *   can be @c NULL.
+ *
+ * Frees all resources associated with the group. The capture contexts
+ * in the group are not deleted.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_capture_group_delete	(vbi_capture_group *	g)
+{
+	unsigned int i;
+
+	if (NULL == g)
+		return;
+
+	for (i = 0; i < g->n_sources; ++i)
+		vbi_free (g->sources[i]);
+
+	vbi_free (g->sources);
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (-1 != g->epoll_fd)
+		close (g->epoll_fd);
+#else
+	vbi_free (g->pfd);
+#endif
+
+	CLEAR (*g);
+
+	vbi_free (g);
+}
+
+/**
+ * Allocates a capture group. Applications capturing from several
+ * devices at once can add the capture contexts to a group and wait
+ * for data from all of them with vbi_capture_group_pull(), instead
+ * of calling vbi_capture_pull() on each context.
+ *
+ * @returns
+ * Pointer to a newly allocated capture group, which must be freed
+ * with vbi_capture_group_delete() when no longer needed. @c NULL on
+ * failure, errno set.
+ *
+ * @since 0.2.36
+ */
+vbi_capture_group *
+vbi_capture_group_new		(void)
+{
+	vbi_capture_group *g;
+
+	g = vbi_malloc (sizeof (*g));
+	if (NULL == g) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	CLEAR (*g);
+
+#ifdef HAVE_SYS_EPOLL_H
+	/* The size argument is ignored by newer kernels. */
+	g->epoll_fd = epoll_create (16);
+	if (-1 == g->epoll_fd) {
+		vbi_free (g);
+		return NULL;
+	}
+
+	/* Don't leak into child processes. */
+	fcntl (g->epoll_fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+	return g;
+}
+
 /* Helper functions to log the communication between the library and drivers.
    FIXME remove fp arg, call user log function instead (0.3). */
 
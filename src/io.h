@@ -38,7 +38,37 @@
 typedef struct vbi_capture_buffer {
 	void *			data;
 	int			size;
+
+	/**
+	 * Capture time of the frame in seconds since 1970-01-01 00:00,
+	 * as gettimeofday() would return. This time jumps when the
+	 * system time is set.
+	 */
 	double			timestamp;
+
+	/**
+	 * Capture time of the frame in seconds on the monotonic clock
+	 * (CLOCK_MONOTONIC), where available taken by the driver. Unlike
+	 * @a timestamp this time never jumps. Zero if unknown.
+	 * @since 0.2.36
+	 */
+	double			monotonic_time;
+
+	/**
+	 * Frame counter of the driver. When it advances by more than one
+	 * the driver dropped frames. -1 if the driver provides no
+	 * reliable frame counter. You can pass this number to
+	 * vbi_decode_frame().
+	 * @since 0.2.36
+	 */
+	int64_t			sequence;
+
+	/**
+	 * Presentation time stamp of the frame (90 kHz) if it was
+	 * received from a DVB stream, otherwise -1.
+	 * @since 0.2.36
+	 */
+	int64_t			stream_time;
 } vbi_capture_buffer;
 
 /**
@@ -120,6 +150,9 @@ vbi_capture_dvb_new2		(const char *		device_name,
 				 unsigned int		pid,
 				 char **		errstr,
 				 vbi_bool		trace);
+extern int
+vbi_capture_dvb_set_buffer_size	(vbi_capture *		cap,
+				 unsigned int		size);
 
 struct vbi_proxy_client;
  
@@ -154,6 +187,56 @@ extern void		vbi_capture_delete(vbi_capture *capture);
 
 extern vbi_bool         vbi_capture_set_video_path(vbi_capture *capture, const char * p_dev_video);
 extern VBI_CAPTURE_FD_FLAGS vbi_capture_get_fd_flags(vbi_capture *capture);
+
+/**
+ * @brief A frame returned by vbi_capture_group_pull().
+ */
+typedef struct {
+	/** The capture context which returned the frame. */
+	vbi_capture *		capture;
+
+	/** The @a user_data passed to vbi_capture_group_add(). */
+	void *			user_data;
+
+	/**
+	 * Raw VBI data, @c NULL unless requested with
+	 * vbi_capture_group_add().
+	 */
+	vbi_capture_buffer *	raw;
+
+	/** Sliced VBI data, @c NULL if reading failed. */
+	vbi_capture_buffer *	sliced;
+
+	/**
+	 * When reading failed the @c errno value of the failure,
+	 * for example zero at the end of a file.
+	 */
+	int			error;
+} vbi_capture_group_frame;
+
+/**
+ * @brief Opaque capture group handle.
+ */
+typedef struct vbi_capture_group vbi_capture_group;
+
+extern int
+vbi_capture_group_pull		(vbi_capture_group *	g,
+				 vbi_capture_group_frame *frames,
+				 unsigned int		max_frames,
+				 struct timeval *	timeout);
+extern vbi_bool
+vbi_capture_group_add		(vbi_capture_group *	g,
+				 vbi_capture *		capture,
+				 int			priority,
+				 vbi_bool		raw,
+				 void *			user_data);
+extern vbi_bool
+vbi_capture_group_remove	(vbi_capture_group *	g,
+				 vbi_capture *		capture);
+extern void
+vbi_capture_group_delete	(vbi_capture_group *	g);
+extern vbi_capture_group *
+vbi_capture_group_new		(void);
 /** @} */
 
 /* Private */
@@ -283,6 +366,13 @@ vbi_capture_io_update_timeout	(struct timeval *	timeout,
 extern int
 vbi_capture_io_select		(int			fd,
 				 struct timeval *	timeout);
+extern void
+vbi_capture_io_monotonic_time	(struct timeval *	tv);
+extern void
+vbi_capture_io_stamp_buffer	(vbi_capture_buffer *	b);
+extern void
+vbi_capture_io_copy_times	(vbi_capture_buffer *	dst,
+				 const vbi_capture_buffer *src);
 
 #endif /* IO_H */
 
@@ -703,6 +703,10 @@ typedef struct {
 struct _vbi_event_cc608_page;
 struct _vbi_event_cc608_stream;
 
+/* Experimental CEA 708 decoder. */
+#define _VBI_EVENT_DTVCC_STREAM 0x4000
+struct _vbi_event_dtvcc_stream;
+
 
 #include <inttypes.h>
 
@@ -734,6 +738,7 @@ typedef struct vbi_event {
 		/* Experimental. */
 		struct _vbi_event_cc608_page *		_cc608;
 		struct _vbi_event_cc608_stream *	_cc608_stream;
+		struct _vbi_event_dtvcc_stream *	_dtvcc_stream;
 	}			ev;
 } vbi_event;
 
@@ -953,6 +958,55 @@ vbi_export_alloc		(vbi_export *		e,
 extern vbi_bool			vbi_export_stdio(vbi_export *, FILE *fp, vbi_page *pg);
 extern vbi_bool			vbi_export_file(vbi_export *, const char *name, vbi_page *pg);
 
+extern vbi_bool
+vbi_export_begin_stdio		(vbi_export *		e,
+				 FILE *			fp)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_begin_file		(vbi_export *		e,
+				 const char *		name)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_pages		(vbi_export *		e,
+				 const vbi_page * const *pg,
+				 unsigned int		n_pages)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_end			(vbi_export *		e)
+  _vbi_nonnull ((1));
+extern vbi_bool
+vbi_export_stream_page		(vbi_export *		e,
+				 const vbi_page *	pg,
+				 double			timestamp)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+vbi_export_stream_event		(vbi_export *		e,
+				 const vbi_event *	ev)
+  _vbi_nonnull ((1, 2));
+
+typedef vbi_bool
+vbi_export_cache_progress_cb	(const vbi_page *	pg,
+				 unsigned int		n_pages_done,
+				 unsigned int		n_pages_total,
+				 void *			user_data);
+
+extern vbi_bool
+vbi_export_cache_dir		(vbi_export *		e,
+				 vbi_decoder *		vbi,
+				 const char *		dir_name,
+				 unsigned int		n_threads,
+				 vbi_export_cache_progress_cb *callback,
+				 void *			user_data)
+  _vbi_nonnull ((1, 2, 3));
+extern vbi_bool
+vbi_export_cache_stdio		(vbi_export *		e,
+				 vbi_decoder *		vbi,
+				 FILE *			fp,
+				 unsigned int		n_threads,
+				 vbi_export_cache_progress_cb *callback,
+				 void *			user_data)
+  _vbi_nonnull ((1, 2, 3));
+
 extern char *			vbi_export_errstr(vbi_export *);
 
 
@@ -1543,6 +1597,15 @@ vbi_xds_demux_cb		(vbi_xds_demux *	xd,
 				 const vbi_xds_packet *	xp,
 				 void *			user_data);
 
+typedef enum {
+	VBI_XDS_DEMUX_CHANGES_ONLY = (1 << 0)
+} vbi_xds_demux_flags;
+
+extern void
+vbi_xds_demux_set_flags		(vbi_xds_demux *	xd,
+				 unsigned int		flags);
+extern unsigned int
+vbi_xds_demux_get_flags		(vbi_xds_demux *	xd);
 extern void
 vbi_xds_demux_reset		(vbi_xds_demux *	xd);
 extern vbi_bool
@@ -1568,7 +1631,14 @@ vbi_xds_demux_new		(vbi_xds_demux_cb *	callback,
 typedef struct vbi_capture_buffer {
 	void *			data;
 	int			size;
+
 	double			timestamp;
+
+	double			monotonic_time;
+
+	int64_t			sequence;
+
+	int64_t			stream_time;
 } vbi_capture_buffer;
 
 typedef struct vbi_capture vbi_capture;
@@ -1622,6 +1692,9 @@ vbi_capture_dvb_new2		(const char *		device_name,
 				 unsigned int		pid,
 				 char **		errstr,
 				 vbi_bool		trace);
+extern int
+vbi_capture_dvb_set_buffer_size	(vbi_capture *		cap,
+				 unsigned int		size);
 
 struct vbi_proxy_client;
  
@@ -1657,6 +1730,42 @@ extern void		vbi_capture_delete(vbi_capture *capture);
 extern vbi_bool         vbi_capture_set_video_path(vbi_capture *capture, const char * p_dev_video);
 extern VBI_CAPTURE_FD_FLAGS vbi_capture_get_fd_flags(vbi_capture *capture);
 
+typedef struct {
+	
+	vbi_capture *		capture;
+
+	
+	void *			user_data;
+
+	vbi_capture_buffer *	raw;
+
+	
+	vbi_capture_buffer *	sliced;
+
+	int			error;
+} vbi_capture_group_frame;
+
+typedef struct vbi_capture_group vbi_capture_group;
+
+extern int
+vbi_capture_group_pull		(vbi_capture_group *	g,
+				 vbi_capture_group_frame *frames,
+				 unsigned int		max_frames,
+				 struct timeval *	timeout);
+extern vbi_bool
+vbi_capture_group_add		(vbi_capture_group *	g,
+				 vbi_capture *		capture,
+				 int			priority,
+				 vbi_bool		raw,
+				 void *			user_data);
+extern vbi_bool
+vbi_capture_group_remove	(vbi_capture_group *	g,
+				 vbi_capture *		capture);
+extern void
+vbi_capture_group_delete	(vbi_capture_group *	g);
+extern vbi_capture_group *
+vbi_capture_group_new		(void);
+
 
 /* io-sim.h */
 
@@ -1877,6 +1986,39 @@ vbi_draw_vt_page(vbi_page *pg, vbi_pixfmt fmt, void *canvas,
 				pg->columns, pg->rows, reveal, flash_on);
 }
 
+typedef struct {
+	int			x;
+	int			y;
+	int			width;
+	int			height;
+} vbi_rect;
+
+extern int		vbi_draw_vt_page_update(const vbi_page *old_pg,
+						int old_reveal,
+						int old_flash_on,
+						vbi_page *pg, vbi_pixfmt fmt,
+						void *canvas, int rowstride,
+						int reveal, int flash_on,
+						vbi_rect *rects,
+						int max_rects);
+
+typedef struct _vbi_glyph_atlas vbi_glyph_atlas;
+
+extern vbi_glyph_atlas *	vbi_glyph_atlas_new(vbi_pixfmt fmt,
+						    unsigned int max_tiles);
+extern void		vbi_glyph_atlas_delete(vbi_glyph_atlas *atlas);
+extern void		vbi_glyph_atlas_set_read_only(vbi_glyph_atlas *atlas,
+						      vbi_bool read_only);
+extern unsigned int	vbi_glyph_atlas_num_tiles(const vbi_glyph_atlas *atlas);
+extern void		vbi_draw_vt_page_region_cached(vbi_glyph_atlas *atlas,
+						       vbi_page *pg,
+						       void *canvas,
+						       int rowstride,
+						       int column, int row,
+						       int width, int height,
+						       int reveal,
+						       int flash_on);
+
 extern void		vbi_draw_cc_page_region(vbi_page *pg, vbi_pixfmt fmt,
 						void *canvas, int rowstride,
 						int column, int row,
@@ -2144,6 +2286,9 @@ extern vbi_decoder *	vbi_decoder_new(void);
 extern void		vbi_decoder_delete(vbi_decoder *vbi);
 extern void		vbi_decode(vbi_decoder *vbi, vbi_sliced *sliced,
 				   int lines, double timestamp);
+extern void		vbi_decode_frame(vbi_decoder *vbi, vbi_sliced *sliced,
+					 int lines, double timestamp,
+					 int64_t sequence);
 extern void             vbi_channel_switched(vbi_decoder *vbi, vbi_nuid nuid);
 extern vbi_page_type	vbi_classify_page(vbi_decoder *vbi, vbi_pgno pgno,
 					  vbi_subno *subno, char **language);
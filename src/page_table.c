@@ -46,8 +46,11 @@
  * example by the vbi_sliced_filter to remember the Teletext pages
  * the caller wishes to keep or drop.
  *
- * The vbi_page_table is optimized for fast queries, while adding or
- * removing pages and especially subpages may take longer.
+ * The vbi_page_table is optimized for fast queries. Whole pages are
+ * stored in a bitmap, so page lookups take constant time. Subpage
+ * ranges are kept in a sorted vector, which is only searched for
+ * pages flagged in a second bitmap. Adding or removing subpages may
+ * take longer.
  */
 
 /* 0 ... 0x3F7E; 0x3F7F == VBI_ANY_SUBNO. */
@@ -79,8 +82,18 @@ struct _vbi_page_table {
 	/* Number of set bits in the pages[] array. */
 	unsigned int		pages_popcnt;
 
+	/* One bit for each Teletext page with at least one entry
+	   in the subpages vector, same layout as pages[]. A page
+	   is never in both arrays. */
+	uint32_t		partial_pages[(0x900 - 0x100) / 32];
+
+	/* Number of set bits in the partial_pages[] array. */
+	unsigned int		partial_pages_popcnt;
+
 	/* A vector of subpages, current size and capacity
-	   (counting struct subpage_range). */
+	   (counting struct subpage_range). The ranges are sorted
+	   by pgno and first subno, and ranges of the same page
+	   neither overlap nor touch. */
 	struct subpage_range *	subpages;
 	unsigned int		subpages_size;
 	unsigned int		subpages_capacity;
@@ -92,17 +105,168 @@ valid_pgno			(vbi_pgno		pgno)
 	return ((unsigned int) pgno - 0x100 < 0x800);
 }
 
+static __inline__ vbi_bool
+test_pgno_bit			(const uint32_t		bitmap[0x800 / 32],
+				 vbi_pgno		pgno)
+{
+	uint32_t mask;
+	unsigned int offset;
+
+	mask = 1 << (pgno & 31);
+	offset = (pgno - 0x100) >> 5;
+
+	return (0 != (bitmap[offset] & mask));
+}
+
 static vbi_bool
 contains_all_subpages		(const vbi_page_table *pt,
 				 vbi_pgno		pgno)
+{
+	return test_pgno_bit (pt->pages, pgno);
+}
+
+static vbi_bool
+contains_some_subpages		(const vbi_page_table *pt,
+				 vbi_pgno		pgno)
+{
+	return test_pgno_bit (pt->partial_pages, pgno);
+}
+
+/* Sets the bits of pages first_pgno ... last_pgno inclusive in
+   bitmap[] and updates *popcnt accordingly. */
+static void
+set_pgno_bits			(uint32_t		bitmap[0x800 / 32],
+				 unsigned int *		popcnt,
+				 vbi_pgno		first_pgno,
+				 vbi_pgno		last_pgno)
+{
+	uint32_t first_mask;
+	uint32_t last_mask;
+	uint32_t old_mask;
+	unsigned int first_offset;
+	unsigned int last_offset;
+
+	/* 0 -> 0xFFFF FFFF, 1 -> 0xFFFF FFFE, 31 -> 0x8000 0000. */
+	first_mask = -1 << (first_pgno & 31);
+	first_offset = (first_pgno - 0x100) >> 5;
+
+	/* 0 -> 0x01, 1 -> 0x03, 31 -> 0xFFFF FFFF. */
+	last_mask = ~(-2 << (last_pgno & 31));
+	last_offset = (last_pgno - 0x100) >> 5;
+
+	if (first_offset != last_offset) {
+		old_mask = bitmap[first_offset];
+		*popcnt += popcnt (first_mask & ~old_mask);
+		bitmap[first_offset] = first_mask | old_mask;
+		first_mask = -1;
+
+		while (++first_offset < last_offset) {
+			old_mask = bitmap[first_offset];
+			*popcnt += 32 - popcnt (old_mask);
+			bitmap[first_offset] = -1;
+		}
+	}
+
+	old_mask = bitmap[last_offset];
+	last_mask &= first_mask;
+	*popcnt += popcnt (last_mask & ~old_mask);
+	bitmap[last_offset] = last_mask | old_mask;
+}
+
+/* Clears the bits of pages first_pgno ... last_pgno inclusive in
+   bitmap[] and updates *popcnt accordingly. */
+static void
+clear_pgno_bits			(uint32_t		bitmap[0x800 / 32],
+				 unsigned int *		popcnt,
+				 vbi_pgno		first_pgno,
+				 vbi_pgno		last_pgno)
+{
+	uint32_t first_mask;
+	uint32_t last_mask;
+	uint32_t old_mask;
+	unsigned int first_offset;
+	unsigned int last_offset;
+
+	first_mask = -1 << (first_pgno & 31);
+	first_offset = (first_pgno - 0x100) >> 5;
+
+	last_mask = ~(-2 << (last_pgno & 31));
+	last_offset = (last_pgno - 0x100) >> 5;
+
+	if (first_offset != last_offset) {
+		old_mask = bitmap[first_offset];
+		*popcnt -= popcnt (old_mask & first_mask);
+		bitmap[first_offset] = old_mask & ~first_mask;
+		first_mask = -1;
+
+		while (++first_offset < last_offset) {
+			old_mask = bitmap[first_offset];
+			*popcnt -= popcnt (old_mask);
+			bitmap[first_offset] = 0;
+		}
+	}
+
+	old_mask = bitmap[last_offset];
+	last_mask &= first_mask;
+	*popcnt -= popcnt (old_mask & last_mask);
+	bitmap[last_offset] = old_mask & ~last_mask;
+}
+
+/* Returns the lowest page number >= pgno which is in pages[] or
+   partial_pages[], or 0x900 if there is none. pgno must be in
+   range 0x100 ... 0x8FF. */
+static vbi_pgno
+next_pgno_bit			(const vbi_page_table *pt,
+				 vbi_pgno		pgno)
 {
 	uint32_t mask;
 	unsigned int offset;
 
-	mask = 1 << (pgno & 31);
+	mask = -1 << (pgno & 31);
 	offset = (pgno - 0x100) >> 5;
+	mask &= pt->pages[offset] | pt->partial_pages[offset];
+
+	pgno &= ~31;
+
+	while (0 == mask) {
+		pgno += 32;
+		if (pgno >= 0x900)
+			return 0x900;
+
+		++offset;
+		mask = pt->pages[offset] | pt->partial_pages[offset];
+	}
 
-	return (0 != (pt->pages[offset] & mask));
+	return pgno + ffs (mask) - 1;
+}
+
+/* Returns the index of the first subpage range which belongs to a
+   page higher than pgno, or to page pgno and ends at or after subno.
+   Returns subpages_size if there is no such range. */
+static unsigned int
+lower_bound			(const vbi_page_table *pt,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno)
+{
+	unsigned int first;
+	unsigned int last;
+
+	first = 0;
+	last = pt->subpages_size;
+
+	while (first < last) {
+		unsigned int mid = (first + last) >> 1;
+		const struct subpage_range *r = &pt->subpages[mid];
+
+		if (r->pgno < pgno
+		    || (r->pgno == pgno && r->last < subno)) {
+			first = mid + 1;
+		} else {
+			last = mid;
+		}
+	}
+
+	return first;
 }
 
 /**
@@ -151,21 +315,17 @@ vbi_page_table_contains_subpage	(const vbi_page_table *pt,
 	if (contains_all_subpages (pt, pgno))
 		return TRUE;
 
-	if (VBI_ANY_SUBNO == subno) {
-		for (i = 0; i < pt->subpages_size; ++i) {
-			if (pgno == pt->subpages[i].pgno)
-				return TRUE;
-		}
-	} else {
-		for (i = 0; i < pt->subpages_size; ++i) {
-			if (pgno == pt->subpages[i].pgno
-			    && subno >= pt->subpages[i].first
-			    && subno <= pt->subpages[i].last)
-				return TRUE;
-		}
-	}
+	if (likely (!contains_some_subpages (pt, pgno)))
+		return FALSE;
 
-	return FALSE;
+	if (VBI_ANY_SUBNO == subno)
+		return TRUE;
+
+	i = lower_bound (pt, pgno, subno);
+
+	return (i < pt->subpages_size
+		&& pgno == pt->subpages[i].pgno
+		&& subno >= pt->subpages[i].first);
 }
 
 /**
@@ -214,13 +374,8 @@ vbi_page_table_next_subpage	(const vbi_page_table *pt,
 				 vbi_subno *		subno)
 {
 	vbi_pgno last_pgno;
-	vbi_pgno last_subno;
+	vbi_subno last_subno;
 	vbi_pgno next_pgno;
-	vbi_pgno next_subno;
-	vbi_pgno min_pgno;
-	vbi_subno min_subno;
-	uint32_t mask;
-	unsigned int offset;
 	unsigned int i;
 
 	assert (NULL != pt);
@@ -230,75 +385,39 @@ vbi_page_table_next_subpage	(const vbi_page_table *pt,
 	last_pgno = *pgno;
 	last_subno = *subno;
 
-	if (last_pgno >= 0x8FF) {
+	if (last_pgno > 0x8FF) {
 		return FALSE;
 	} else if (last_pgno < 0x100) {
 		next_pgno = 0x100;
 	} else {
-		if (last_subno <= MAX_SUBNO /* not ANY */) {
-			next_subno = last_subno + 1;
-			min_subno = MAX_SUBNO + 1;
-
-			for (i = 0; i < pt->subpages_size; ++i) {
-				if (last_pgno != pt->subpages[i].pgno)
-					continue;
-
-				if (next_subno > pt->subpages[i].last)
-					continue;
-
-				if (next_subno >= pt->subpages[i].first) {
-					*subno = next_subno;
-					return TRUE;
-				}
-
-				if (pt->subpages[i].first < min_subno)
-					min_subno = pt->subpages[i].first;
-			}
-
-			if (min_subno <= MAX_SUBNO) {
-				*subno = min_subno;
+		if ((unsigned int) last_subno < MAX_SUBNO /* not ANY */
+		    && contains_some_subpages (pt, last_pgno)) {
+			i = lower_bound (pt, last_pgno, last_subno + 1);
+
+			if (i < pt->subpages_size
+			    && last_pgno == pt->subpages[i].pgno) {
+				*subno = MAX (last_subno + 1,
+					      pt->subpages[i].first);
 				return TRUE;
 			}
 		}
 
 		next_pgno = last_pgno + 1;
-	}
-
-	min_pgno = 0x900;
-
-	for (i = 0; i < pt->subpages_size; ++i) {
-		if (next_pgno <= pt->subpages[i].pgno
-		    && next_pgno < min_pgno) {
-			min_pgno = pt->subpages[i].pgno;
-			min_subno = pt->subpages[i].first;
-		}
-	}
-
-	mask = -1 << (next_pgno & 31);
-	offset = (next_pgno - 0x100) >> 5;
-	mask &= pt->pages[offset];
-
-	next_pgno &= ~31;
-
-	for (;;) {
-		if (0 != mask)
-			break;
-
-		next_pgno += 32;
-		if (next_pgno >= 0x900)
+		if (next_pgno > 0x8FF)
 			return FALSE;
-
-		mask = pt->pages[++offset];
 	}
 
-	next_pgno += ffs (mask) - 1;
+	next_pgno = next_pgno_bit (pt, next_pgno);
+	if (next_pgno > 0x8FF)
+		return FALSE;
+
+	*pgno = next_pgno;
 
-	if (min_pgno < next_pgno) {
-		*pgno = min_pgno;
-		*subno = min_subno;
-	} else {
-		*pgno = next_pgno;
+	if (contains_all_subpages (pt, next_pgno)) {
 		*subno = VBI_ANY_SUBNO;
+	} else {
+		i = lower_bound (pt, next_pgno, 0);
+		*subno = pt->subpages[i].first;
 	}
 
 	return TRUE;
@@ -350,7 +469,7 @@ vbi_page_table_num_pages	(const vbi_page_table *pt)
 {
 	assert (NULL != pt);
 
-	return pt->pages_popcnt + pt->subpages_size;
+	return pt->pages_popcnt + pt->partial_pages_popcnt;
 }
 
 static void
@@ -402,7 +521,7 @@ extend_vector			(void **		vector,
 	if (unlikely (new_capacity > (max_capacity / 2))) {
 		new_capacity = max_capacity;
 	} else {
-		new_capacity = MIN (min_capacity, new_capacity * 2);
+		new_capacity = MAX (min_capacity, new_capacity * 2);
 	}
 
 	new_vec = vbi_realloc (*vector, new_capacity * element_size);
@@ -462,6 +581,63 @@ valid_subpage_range		(vbi_pgno		pgno,
 	return TRUE;
 }
 
+static vbi_bool
+insert_subpage_range		(vbi_page_table *	pt,
+				 unsigned int		i,
+				 vbi_pgno		pgno,
+				 vbi_subno		first_subno,
+				 vbi_subno		last_subno)
+{
+	if (!extend_subpages_vector (pt, pt->subpages_size + 1))
+		return FALSE;
+
+	memmove (&pt->subpages[i + 1],
+		 &pt->subpages[i],
+		 (pt->subpages_size - i) * sizeof (*pt->subpages));
+
+	pt->subpages[i].pgno = pgno;
+	pt->subpages[i].first = first_subno;
+	pt->subpages[i].last = last_subno;
+
+	++pt->subpages_size;
+
+	return TRUE;
+}
+
+static void
+delete_subpage_ranges		(vbi_page_table *	pt,
+				 unsigned int		i,
+				 unsigned int		n)
+{
+	if (0 == n)
+		return;
+
+	memmove (&pt->subpages[i],
+		 &pt->subpages[i + n],
+		 (pt->subpages_size - i - n) * sizeof (*pt->subpages));
+
+	pt->subpages_size -= n;
+}
+
+static void
+remove_subpages_in_page_range	(vbi_page_table *	pt,
+				 vbi_pgno		first_pgno,
+				 vbi_pgno		last_pgno)
+{
+	unsigned int i;
+	unsigned int j;
+
+	i = lower_bound (pt, first_pgno, 0);
+	j = lower_bound (pt, last_pgno + 1, 0);
+
+	delete_subpage_ranges (pt, i, j - i);
+
+	clear_pgno_bits (pt->partial_pages, &pt->partial_pages_popcnt,
+			 first_pgno, last_pgno);
+
+	shrink_subpages_vector (pt);
+}
+
 /**
  * @param pt Teletext page table allocated with vbi_page_table_new().
  * @param pgno The page in question. Must be in range 0x100 to 0x8FF
@@ -485,8 +661,6 @@ vbi_page_table_remove_subpages	(vbi_page_table *	pt,
 				 vbi_subno		first_subno,
 				 vbi_subno		last_subno)
 {
-	uint32_t mask;
-	unsigned int offset;
 	unsigned int i;
 
 	assert (NULL != pt);
@@ -501,80 +675,69 @@ vbi_page_table_remove_subpages	(vbi_page_table *	pt,
 	if (first_subno > last_subno)
 		SWAP (first_subno, last_subno);
 
-	mask = 1 << (pgno & 31);
-	offset = (pgno - 0x100) >> 5;
-
-	if (0 != (pt->pages[offset] & mask)) {
-		i = pt->subpages_size;
-
-		if (!extend_subpages_vector (pt, i + 2))
+	if (contains_all_subpages (pt, pgno)) {
+		/* The subpages vector contains no ranges of this page. */
+		if (!extend_subpages_vector (pt, pt->subpages_size + 2))
 			return FALSE;
 
-		--pt->pages_popcnt;
-		pt->pages[offset] &= ~mask;
+		clear_pgno_bits (pt->pages, &pt->pages_popcnt, pgno, pgno);
+
+		i = lower_bound (pt, pgno, 0);
 
 		if (first_subno > 0) {
-			pt->subpages[i].pgno = pgno;
-			pt->subpages[i].first = 0;
-			pt->subpages[i++].last = first_subno - 1;
+			insert_subpage_range (pt, i++, pgno,
+					      0, first_subno - 1);
 		}
 
 		if (last_subno < MAX_SUBNO) {
-			pt->subpages[i].pgno = pgno;
-			pt->subpages[i].first = last_subno + 1;
-			pt->subpages[i++].last = MAX_SUBNO;
+			insert_subpage_range (pt, i, pgno,
+					      last_subno + 1, MAX_SUBNO);
 		}
 
-		pt->subpages_size = i;
+		if (0 != first_subno || MAX_SUBNO != last_subno) {
+			set_pgno_bits (pt->partial_pages,
+				       &pt->partial_pages_popcnt,
+				       pgno, pgno);
+		}
 
 		return TRUE;
 	}
 
-	for (i = 0; i < pt->subpages_size; ++i) {
-		if (pgno != pt->subpages[i].pgno)
-			continue;
+	if (!contains_some_subpages (pt, pgno))
+		return TRUE;
 
-		if (first_subno > pt->subpages[i].last)
-			continue;
+	i = lower_bound (pt, pgno, first_subno);
 
-		if (last_subno < pt->subpages[i].first)
-			continue;
+	while (i < pt->subpages_size
+	       && pgno == pt->subpages[i].pgno
+	       && last_subno >= pt->subpages[i].first) {
+		struct subpage_range *r = &pt->subpages[i];
 
-		if (first_subno > pt->subpages[i].first
-		    && last_subno < pt->subpages[i].last) {
-			if (!extend_subpages_vector (pt,
-						     pt->subpages_size + 1))
+		if (first_subno > r->first && last_subno < r->last) {
+			if (!insert_subpage_range (pt, i + 1, pgno,
+						   last_subno + 1, r->last))
 				return FALSE;
 
-			memmove (&pt->subpages[i + 1],
-				 &pt->subpages[i],
-				 (pt->subpages_size - i)
-				 * sizeof (*pt->subpages));
+			/* r may have moved. */
+			pt->subpages[i].last = first_subno - 1;
 
-			pt->subpages[i].last = first_subno;
-			pt->subpages[i + 1].first = last_subno + 1;
-
-			++pt->subpages_size;
+			break;
+		} else if (first_subno > r->first) {
+			r->last = first_subno - 1;
 			++i;
-
-			continue;
+		} else if (last_subno < r->last) {
+			r->first = last_subno + 1;
+			break;
+		} else {
+			delete_subpage_ranges (pt, i, 1);
 		}
+	}
 
-		if (first_subno > pt->subpages[i].first)
-			pt->subpages[i].first = first_subno;
-
-		if (last_subno < pt->subpages[i].last)
-			pt->subpages[i].last = last_subno;
-
-		if (pt->subpages[i].first > pt->subpages[i].last) {
-			memmove (&pt->subpages[i],
-				 &pt->subpages[i + 1],
-				 (pt->subpages_size - i)
-				 * sizeof (*pt->subpages));
-
-			--pt->subpages_size;
-			--i;
-		}
+	i = lower_bound (pt, pgno, 0);
+	if (i >= pt->subpages_size || pgno != pt->subpages[i].pgno) {
+		clear_pgno_bits (pt->partial_pages,
+				 &pt->partial_pages_popcnt,
+				 pgno, pgno);
 	}
 
 	shrink_subpages_vector (pt);
@@ -606,6 +769,7 @@ vbi_page_table_add_subpages	(vbi_page_table *	pt,
 				 vbi_subno		last_subno)
 {
 	unsigned int i;
+	unsigned int j;
 
 	assert (NULL != pt);
 
@@ -616,62 +780,54 @@ vbi_page_table_add_subpages	(vbi_page_table *	pt,
 	if (unlikely (!valid_subpage_range (pgno, first_subno, last_subno)))
 		return FALSE;
 
-	if (vbi_page_table_contains_page (pt, pgno))
+	if (contains_all_subpages (pt, pgno))
 		return TRUE;
 
 	if (first_subno > last_subno)
 		SWAP (first_subno, last_subno);
 
-	for (i = 0; i < pt->subpages_size; ++i) {
-		if (pgno == pt->subpages[i].pgno
-		    && last_subno >= pt->subpages[i].first
-		    && first_subno <= pt->subpages[i].last) {
-			if (first_subno < pt->subpages[i].first)
-				pt->subpages[i].first = first_subno;
+	/* Merge with all ranges of this page which overlap or
+	   adjoin first_subno ... last_subno. */
+	i = lower_bound (pt, pgno, (first_subno > 0) ? first_subno - 1 : 0);
 
-			if (last_subno > pt->subpages[i].last)
-				pt->subpages[i].last = last_subno;
+	for (j = i; j < pt->subpages_size; ++j) {
+		if (pgno != pt->subpages[j].pgno
+		    || last_subno + 1 < pt->subpages[j].first)
+			break;
 
-			return TRUE;
-		}
+		first_subno = MIN (first_subno, pt->subpages[j].first);
+		last_subno = MAX (last_subno, pt->subpages[j].last);
 	}
 
-	if (!extend_subpages_vector (pt, i + 1))
-		return FALSE;
+	if (0 == first_subno && MAX_SUBNO == last_subno) {
+		/* Move the page to pages[]. */
+		delete_subpage_ranges (pt, i, j - i);
 
-	pt->subpages[i].pgno = pgno;
-	pt->subpages[i].first = first_subno;
-	pt->subpages[i].last = last_subno;
+		clear_pgno_bits (pt->partial_pages,
+				 &pt->partial_pages_popcnt,
+				 pgno, pgno);
+		set_pgno_bits (pt->pages, &pt->pages_popcnt, pgno, pgno);
 
-	pt->subpages_size = i + 1;
+		shrink_subpages_vector (pt);
 
-	return TRUE;
-}
+		return TRUE;
+	}
 
-static void
-remove_subpages_in_page_range	(vbi_page_table *	pt,
-				 vbi_pgno		first_pgno,
-				 vbi_pgno		last_pgno)
-{
-	unsigned int i;
-	unsigned int j;
+	if (i == j) {
+		if (!insert_subpage_range (pt, i, pgno,
+					   first_subno, last_subno))
+			return FALSE;
 
-	for (i = 0, j = 0; i < pt->subpages_size; ++i) {
-		if (pt->subpages[i].pgno < first_pgno
-		    || pt->subpages[i].pgno > last_pgno) {
-			if (j < i) {
-				memcpy (&pt->subpages[j],
-					&pt->subpages[i],
-					sizeof (*pt->subpages));
-			}
+		set_pgno_bits (pt->partial_pages, &pt->partial_pages_popcnt,
+			       pgno, pgno);
+	} else {
+		pt->subpages[i].first = first_subno;
+		pt->subpages[i].last = last_subno;
 
-			++j;
-		}
+		delete_subpage_ranges (pt, i + 1, j - i - 1);
 	}
 
-	pt->subpages_size = j;
-
-	shrink_subpages_vector (pt);
+	return TRUE;
 }
 
 static vbi_bool
@@ -706,12 +862,6 @@ vbi_page_table_remove_pages	(vbi_page_table *	pt,
 				 vbi_pgno		first_pgno,
 				 vbi_pgno		last_pgno)
 {
-	uint32_t first_mask;
-	uint32_t last_mask;
-	uint32_t old_mask;
-	unsigned int first_offset;
-	unsigned int last_offset;
-
 	assert (NULL != pt);
 
 	if (unlikely (!valid_pgno_range (first_pgno, last_pgno)))
@@ -720,44 +870,10 @@ vbi_page_table_remove_pages	(vbi_page_table *	pt,
 	if (first_pgno > last_pgno)
 		SWAP (first_pgno, last_pgno);
 
-	if (0x8FF == last_pgno && 0x100 == first_pgno) {
-		pt->subpages_size = 0;
-
-		shrink_subpages_vector (pt);
-
-		memset (pt->pages, 0, sizeof (pt->pages));
-		pt->pages_popcnt = 0;
-
-		return TRUE;
-	}
-
 	remove_subpages_in_page_range (pt, first_pgno, last_pgno);
 
-	/* 0 -> 0xFFFF FFFF, 1 -> 0xFFFF FFFE, 31 -> 0x8000 0000. */
-	first_mask = -1 << (first_pgno & 31);
-	first_offset = (first_pgno - 0x100) >> 5;
-
-	/* 0 -> 0x01, 1 -> 0x03, 31 -> 0xFFFF FFFF. */
-	last_mask = ~(-2 << (last_pgno & 31));
-	last_offset = (last_pgno - 0x100) >> 5;
-
-	if (first_offset != last_offset) {
-		old_mask = pt->pages[first_offset];
-		pt->pages_popcnt -= popcnt (old_mask & first_mask);
-		pt->pages[first_offset] = old_mask & ~first_mask;
-		first_mask = -1;
-
-		while (++first_offset < last_offset) {
-			old_mask = pt->pages[first_offset];
-			pt->pages_popcnt -= popcnt (old_mask);
-			pt->pages[first_offset] = 0;
-		}
-	}
-
-	old_mask = pt->pages[last_offset];
-	last_mask &= first_mask;
-	pt->pages_popcnt -= popcnt (old_mask & last_mask);
-	pt->pages[last_offset] = old_mask & ~last_mask;
+	clear_pgno_bits (pt->pages, &pt->pages_popcnt,
+			 first_pgno, last_pgno);
 
 	return TRUE;
 }
@@ -781,12 +897,6 @@ vbi_page_table_add_pages	(vbi_page_table *	pt,
 				 vbi_pgno		first_pgno,
 				 vbi_pgno		last_pgno)
 {
-	uint32_t first_mask;
-	uint32_t last_mask;
-	uint32_t old_mask;
-	unsigned int first_offset;
-	unsigned int last_offset;
-
 	assert (NULL != pt);
 
 	if (unlikely (!valid_pgno_range (first_pgno, last_pgno)))
@@ -795,45 +905,11 @@ vbi_page_table_add_pages	(vbi_page_table *	pt,
 	if (first_pgno > last_pgno)
 		SWAP (first_pgno, last_pgno);
 
-	if (0x8FF == last_pgno && 0x100 == first_pgno) {
-		pt->subpages_size = 0;
-
-		shrink_subpages_vector (pt);
-
-		memset (pt->pages, -1, sizeof (pt->pages));
-		pt->pages_popcnt = 0x800;
-
-		return TRUE;
-	}
-
 	/* Remove duplicates of pages[] in subpages. */
 	remove_subpages_in_page_range (pt, first_pgno, last_pgno);
 
-	/* 0 -> 0xFFFF FFFF, 1 -> 0xFFFF FFFE, 31 -> 0x8000 0000. */
-	first_mask = -1 << (first_pgno & 31);
-	first_offset = (first_pgno - 0x100) >> 5;
-
-	/* 0 -> 0x01, 1 -> 0x03, 31 -> 0xFFFF FFFF. */
-	last_mask = ~(-2 << (last_pgno & 31));
-	last_offset = (last_pgno - 0x100) >> 5;
-
-	if (first_offset != last_offset) {
-		old_mask = pt->pages[first_offset];
-		pt->pages_popcnt += popcnt (first_mask & ~old_mask);
-		pt->pages[first_offset] = first_mask | old_mask;
-		first_mask = -1;
-
-		while (++first_offset < last_offset) {
-			old_mask = pt->pages[first_offset];
-			pt->pages_popcnt += 32 - popcnt (old_mask);
-			pt->pages[first_offset] = -1;
-		}
-	}
-
-	old_mask = pt->pages[last_offset];
-	last_mask &= first_mask;
-	pt->pages_popcnt += popcnt (last_mask & ~old_mask);
-	pt->pages[last_offset] = last_mask | old_mask;
+	set_pgno_bits (pt->pages, &pt->pages_popcnt,
+		       first_pgno, last_pgno);
 
 	return TRUE;
 }
@@ -177,7 +177,7 @@ vbi_page_table_add_pages	(vbi_page_table *	pt,
  * subpages. Do not explicitely add subpage zero of page @a pgno
  * (with vbi_page_table_add_subpage()) unless you want to match
  * @a pgno only if it has no subpages, as subpage lookups are
- * considerably less efficient.
+ * less efficient.
  *
  * @a returns
  * @c FALSE on failure (invalid page number or out of memory).
@@ -83,6 +83,13 @@ struct vbi_proxy_client
    vbi_bool                has_token;
 
    vbi_bool                sliced_ind;
+   double                  ind_timestamp;
+   const vbi_sliced      * p_ind_sliced;
+   unsigned int            ind_sliced_lines;
+   const void            * p_ind_raw;
+   unsigned int            ind_raw_size;
+   vbi_sliced            * p_compact_lines;
+   int                     compact_max_lines;
    vbi_capture_buffer      raw_buf;
    vbi_capture_buffer      slice_buf;
    vbi_capture             capt_api;
@@ -165,6 +172,7 @@ static vbi_bool proxy_client_alloc_msg_buf( vbi_proxy_client * vpc )
 {
    vbi_bool result;
    size_t msg_size;
+   size_t compact_size;
 
    msg_size = sizeof(VBIPROXY_MSG_BODY);
 
@@ -177,12 +185,40 @@ static vbi_bool proxy_client_alloc_msg_buf( vbi_proxy_client * vpc )
       else
          msg_size = VBIPROXY_SLICED_IND_SIZE(vpc->dec.count[0] + vpc->dec.count[1], 0);
 
+      if (vpc->daemon_flags & VBIPROXY_DAEMON_COMPACT_SLICED)
+      {  /* compact encoding may carry both sliced and raw lines */
+         compact_size = VBIPROXY_SLICED_COMPACT_IND_MAX_SIZE(
+                           vpc->dec.count[0] + vpc->dec.count[1],
+                           (VBI_RAW_SERVICES(vpc->services) ?
+                              VBIPROXY_RAW_LINE_SIZE * (vpc->dec.count[0] + vpc->dec.count[1]) : 0));
+         if (msg_size < compact_size)
+            msg_size = compact_size;
+      }
+
       if (msg_size < sizeof(VBIPROXY_MSG_BODY))
          msg_size = sizeof(VBIPROXY_MSG_BODY);
    }
    else
       msg_size = sizeof(VBIPROXY_MSG_BODY);
 
+   /* buffer for lines decoded from compact messages */
+   if ( (vpc->state == CLNT_STATE_CAPTURING) &&
+        (vpc->daemon_flags & VBIPROXY_DAEMON_COMPACT_SLICED) &&
+        (vpc->dec.count[0] + vpc->dec.count[1] != vpc->compact_max_lines) )
+   {
+      if (vpc->p_compact_lines != NULL)
+         free(vpc->p_compact_lines);
+
+      vpc->compact_max_lines = vpc->dec.count[0] + vpc->dec.count[1];
+      vpc->p_compact_lines = malloc(MAX(vpc->compact_max_lines, 1) * sizeof(vbi_sliced));
+      if (vpc->p_compact_lines == NULL)
+      {
+         vpc->compact_max_lines = 0;
+         asprintf(&vpc->p_errorstr, _("Virtual memory exhausted."));
+         return FALSE;
+      }
+   }
+
    msg_size += VBIPROXY_MSG_BODY_OFFSET;
 
    if (((int) msg_size != vpc->max_client_msg_size)
@@ -252,6 +288,13 @@ static vbi_bool proxy_client_check_msg( vbi_proxy_client * vpc, uint len,
                           VBIPROXY_SLICED_IND_SIZE(pBody->sliced_ind.sliced_lines, pBody->sliced_ind.raw_lines));
          break;
 
+      case MSG_TYPE_SLICED_COMPACT_IND:
+         /* the line encoding is checked while decoding */
+         result = ( (vpc->daemon_flags & VBIPROXY_DAEMON_COMPACT_SLICED) &&
+                    (len >= sizeof(VBIPROXY_MSG_HEADER) + VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE) &&
+                    (len - sizeof(VBIPROXY_MSG_HEADER) - VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE >= pBody->sliced_compact_ind.raw_size) );
+         break;
+
       case MSG_TYPE_SERVICE_CNF:
          result = (len == sizeof(VBIPROXY_MSG_HEADER) + sizeof(pBody->service_cnf));
          break;
@@ -310,6 +353,8 @@ static vbi_bool proxy_client_check_msg( vbi_proxy_client * vpc, uint len,
       case MSG_TYPE_CHN_IOCTL_REQ:
       case MSG_TYPE_DAEMON_PID_REQ:
       case MSG_TYPE_DAEMON_PID_CNF:
+      case MSG_TYPE_STATS_REQ:
+      case MSG_TYPE_STATS_CNF:
          dprintf1("check_msg: recv server msg type %d (%s)\n", pHead->type, vbi_proxy_msg_debug_get_type_str(pHead->type));
          result = FALSE;
          break;
@@ -349,9 +394,45 @@ static vbi_bool proxy_client_take_message( vbi_proxy_client * vpc )
                pMsg->sliced_ind.sliced_lines = vpc->dec.count[0] + vpc->dec.count[1];
             }
             /*assert(vpc->sliced_ind == FALSE);*/
-            vpc->sliced_ind = TRUE;
+            vpc->sliced_ind       = TRUE;
+            vpc->ind_timestamp    = pMsg->sliced_ind.timestamp;
+            vpc->p_ind_sliced     = pMsg->sliced_ind.u.sliced;
+            vpc->ind_sliced_lines = pMsg->sliced_ind.sliced_lines;
+            vpc->p_ind_raw        = pMsg->sliced_ind.u.raw;
+            vpc->ind_raw_size     = pMsg->sliced_ind.raw_lines * VBIPROXY_RAW_LINE_SIZE;
+            result = TRUE;
+         }
+         else if ( (vpc->state == CLNT_STATE_WAIT_IDLE) ||
+                   (vpc->state == CLNT_STATE_WAIT_SRV_CNF) ||
+                   (vpc->state == CLNT_STATE_WAIT_RPC_REPLY) )
+         {
+            /* discard incoming data during service changes */
             result = TRUE;
          }
+         break;
+
+      case MSG_TYPE_SLICED_COMPACT_IND:
+         if ((vpc->state == CLNT_STATE_CAPTURING) && (vpc->p_compact_lines != NULL))
+         {
+            const uint8_t * p_raw;
+
+            /* lines beyond the allocated slicer buffer are discarded by the decoder */
+            if (vbi_proxy_msg_decode_sliced(&pMsg->sliced_compact_ind,
+                                            vpc->p_client_msg->head.len - sizeof(VBIPROXY_MSG_HEADER),
+                                            vpc->p_compact_lines,
+                                            vpc->dec.count[0] + vpc->dec.count[1],
+                                            &vpc->ind_sliced_lines, &p_raw))
+            {
+               vpc->sliced_ind     = TRUE;
+               vpc->ind_timestamp  = pMsg->sliced_compact_ind.timestamp;
+               vpc->p_ind_sliced   = vpc->p_compact_lines;
+               vpc->p_ind_raw      = p_raw;
+               vpc->ind_raw_size   = pMsg->sliced_compact_ind.raw_size;
+               result = TRUE;
+            }
+            else
+               dprintf1("take_message: SLICED_COMPACT_IND: malformed message\n");
+         }
          else if ( (vpc->state == CLNT_STATE_WAIT_IDLE) ||
                    (vpc->state == CLNT_STATE_WAIT_SRV_CNF) ||
                    (vpc->state == CLNT_STATE_WAIT_RPC_REPLY) )
@@ -728,7 +809,8 @@ static vbi_bool proxy_client_start_acq( vbi_proxy_client * vpc )
    p_req_msg->client_name[VBIPROXY_CLIENT_NAME_MAX_LENGTH - 1] = 0;
    p_req_msg->pid = getpid();
 
-   p_req_msg->client_flags = vpc->client_flags;
+   /* always offer the compact slicer data encoding; older daemons ignore the flag */
+   p_req_msg->client_flags = vpc->client_flags | VBIPROXY_CLIENT_COMPACT_SLICED;
    p_req_msg->scanning     = vpc->scanning;
    p_req_msg->services     = vpc->services;
    p_req_msg->strict       = vpc->strict;
@@ -1244,43 +1326,48 @@ vbi_proxy_client_read( vbi_capture * vc,
          {
             if (pp_raw_buf != NULL)
             {
-               lines = vpc->p_client_msg->body.sliced_ind.raw_lines;
-
                if (*pp_raw_buf != NULL)
                {
                   /* XXX optimization possible: read sliced msg into buffer to avoid memcpy */
                   memcpy( (*pp_raw_buf)->data,
-                          vpc->p_client_msg->body.sliced_ind.u.raw,
-                          lines * VBIPROXY_RAW_LINE_SIZE );
+                          vpc->p_ind_raw,
+                          vpc->ind_raw_size );
                }
                else
                {
                   *pp_raw_buf = &vpc->raw_buf;
-                  (*pp_raw_buf)->data = vpc->p_client_msg->body.sliced_ind.u.raw;
+                  (*pp_raw_buf)->data = (void *) vpc->p_ind_raw;
                }
-               (*pp_raw_buf)->size      = lines * VBIPROXY_RAW_LINE_SIZE;
-               (*pp_raw_buf)->timestamp = vpc->p_client_msg->body.sliced_ind.timestamp;
+               (*pp_raw_buf)->size      = vpc->ind_raw_size;
+               (*pp_raw_buf)->timestamp = vpc->ind_timestamp;
+               /* the protocol carries only the system time */
+               (*pp_raw_buf)->monotonic_time = 0;
+               (*pp_raw_buf)->sequence       = -1;
+               (*pp_raw_buf)->stream_time    = -1;
             }
 
             if (pp_slice_buf != NULL)
             {
-               lines = vpc->p_client_msg->body.sliced_ind.sliced_lines;
+               lines = vpc->ind_sliced_lines;
 
                if (*pp_slice_buf != NULL)
                {
                   /* XXX optimization possible: read sliced msg into buffer to avoid memcpy */
                   memcpy( (*pp_slice_buf)->data,
-                          vpc->p_client_msg->body.sliced_ind.u.sliced,
+                          vpc->p_ind_sliced,
                           lines * sizeof(vbi_sliced) );
                }
                else
                {
                   *pp_slice_buf = &vpc->slice_buf;
-                  (*pp_slice_buf)->data = vpc->p_client_msg->body.sliced_ind.u.sliced;
+                  (*pp_slice_buf)->data = (void *) vpc->p_ind_sliced;
                }
 
                (*pp_slice_buf)->size      = lines * sizeof(vbi_sliced);
-               (*pp_slice_buf)->timestamp = vpc->p_client_msg->body.sliced_ind.timestamp;
+               (*pp_slice_buf)->timestamp = vpc->ind_timestamp;
+               (*pp_slice_buf)->monotonic_time = 0;
+               (*pp_slice_buf)->sequence       = -1;
+               (*pp_slice_buf)->stream_time    = -1;
             }
          }
          else
@@ -1511,6 +1598,9 @@ vbi_proxy_client_destroy( vbi_proxy_client * vpc )
       if (vpc->p_client_msg != NULL)
          free(vpc->p_client_msg);
 
+      if (vpc->p_compact_lines != NULL)
+         free(vpc->p_compact_lines);
+
       if (vpc->p_errorstr != NULL)
          free(vpc->p_errorstr);
 
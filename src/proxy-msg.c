@@ -365,6 +365,11 @@ const char * vbi_proxy_msg_debug_get_type_str( VBIPROXY_MSG_TYPE type )
 
       DEBUG_STR_MSG_TYPE(MSG_TYPE_DAEMON_PID_REQ)
       DEBUG_STR_MSG_TYPE(MSG_TYPE_DAEMON_PID_CNF)
+
+      DEBUG_STR_MSG_TYPE(MSG_TYPE_SLICED_COMPACT_IND)
+
+      DEBUG_STR_MSG_TYPE(MSG_TYPE_STATS_REQ)
+      DEBUG_STR_MSG_TYPE(MSG_TYPE_STATS_CNF)
 #undef DEBUG_STR_MSG_TYPE
    };
    assert(MSG_TYPE_COUNT == (sizeof(names)/sizeof(names[0])));
@@ -643,6 +648,184 @@ void vbi_proxy_msg_write( VBIPROXY_MSG_STATE * p_io, VBIPROXY_MSG_TYPE type,
    pMsg->head.type    = htonl(type);
 }
 
+/* ----------------------------------------------------------------------------
+** Compact slicer data encoding
+** - each line is coded as a service code, the line number (two bytes, little
+**   endian) and the payload, cut to the actual payload size of the service,
+**   e.g. 2 bytes for Closed Caption, 13 for VPS and 42 for Teletext
+** - code 0 escapes services not listed in the table: the service ID follows
+**   as four bytes (little endian)
+** - must be kept in sync on both sides, so only append to the table
+*/
+static const unsigned int compact_service_ids[] =
+{
+   0,   /* escape */
+   VBI_SLICED_TELETEXT_B,
+   VBI_SLICED_TELETEXT_B_L10_625,
+   VBI_SLICED_TELETEXT_B_L25_625,
+   VBI_SLICED_VPS,
+   VBI_SLICED_VPS_F2,
+   VBI_SLICED_CAPTION_625_F1,
+   VBI_SLICED_CAPTION_625_F2,
+   VBI_SLICED_CAPTION_625,
+   VBI_SLICED_CAPTION_525_F1,
+   VBI_SLICED_CAPTION_525_F2,
+   VBI_SLICED_CAPTION_525,
+   VBI_SLICED_2xCAPTION_525,
+   VBI_SLICED_WSS_625,
+   VBI_SLICED_WSS_CPR1204,
+   VBI_SLICED_TELETEXT_A,
+   VBI_SLICED_TELETEXT_C_625,
+   VBI_SLICED_TELETEXT_D_625,
+   VBI_SLICED_TELETEXT_B_525,
+   VBI_SLICED_TELETEXT_C_525,
+   VBI_SLICED_TELETEXT_D_525,
+   VBI_SLICED_TELETEXT_BD_525,
+};
+#define COMPACT_SERVICE_COUNT  (sizeof(compact_service_ids) / sizeof(compact_service_ids[0]))
+
+static unsigned int vbi_proxy_msg_compact_payload_size( unsigned int id )
+{
+   unsigned int bits;
+
+   bits = vbi_sliced_payload_bits(id);
+   if ((bits == 0) || (bits > 8 * sizeof(((vbi_sliced *)0)->data)))
+      return sizeof(((vbi_sliced *)0)->data);
+   else
+      return (bits + 7) / 8;
+}
+
+/* ----------------------------------------------------------------------------
+** Encode sliced lines (filtered for the given services) and raw data
+** - the buffer must have room for VBIPROXY_SLICED_COMPACT_IND_MAX_SIZE(line_count, raw_size)
+** - returns the size of the message body
+*/
+uint32_t vbi_proxy_msg_encode_sliced( VBIPROXY_SLICED_COMPACT_IND * p_ind,
+                                      const vbi_sliced * p_lines, unsigned int line_count,
+                                      unsigned int max_lines, unsigned int services,
+                                      const uint8_t * p_raw, uint32_t raw_size )
+{
+   uint8_t * p;
+   unsigned int size;
+   unsigned int code;
+   unsigned int idx;
+
+   p = p_ind->data;
+   p_ind->sliced_lines = 0;
+
+   for (idx = 0; (idx < line_count) && (p_ind->sliced_lines < max_lines); idx++)
+   {
+      if ((p_lines[idx].id & services) != 0)
+      {
+         for (code = 1; code < COMPACT_SERVICE_COUNT; code++)
+            if (compact_service_ids[code] == p_lines[idx].id)
+               break;
+
+         if (code < COMPACT_SERVICE_COUNT)
+         {
+            *p++ = code;
+         }
+         else
+         {
+            *p++ = 0;
+            *p++ = p_lines[idx].id;
+            *p++ = p_lines[idx].id >> 8;
+            *p++ = p_lines[idx].id >> 16;
+            *p++ = p_lines[idx].id >> 24;
+         }
+         *p++ = p_lines[idx].line;
+         *p++ = p_lines[idx].line >> 8;
+
+         size = vbi_proxy_msg_compact_payload_size(p_lines[idx].id);
+         memcpy(p, p_lines[idx].data, size);
+         p += size;
+
+         p_ind->sliced_lines += 1;
+      }
+   }
+
+   p_ind->raw_size = 0;
+   if ((p_raw != NULL) && (raw_size > 0))
+   {
+      memcpy(p, p_raw, raw_size);
+      p += raw_size;
+      p_ind->raw_size = raw_size;
+   }
+
+   return p - (uint8_t *) p_ind;
+}
+
+/* ----------------------------------------------------------------------------
+** Decode a compact slicer data message
+** - lines beyond max_lines are skipped
+** - returns a pointer to the raw data (if any) inside the message
+** - returns FALSE if the message is malformed
+*/
+vbi_bool vbi_proxy_msg_decode_sliced( const VBIPROXY_SLICED_COMPACT_IND * p_ind, uint32_t body_size,
+                                      vbi_sliced * p_lines, unsigned int max_lines,
+                                      unsigned int * p_line_count, const uint8_t ** pp_raw )
+{
+   const uint8_t * p;
+   const uint8_t * p_end;
+   unsigned int id;
+   unsigned int line;
+   unsigned int size;
+   unsigned int idx;
+
+   if ( (body_size < VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE) ||
+        (p_ind->raw_size > body_size - VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE) )
+      return FALSE;
+
+   p = p_ind->data;
+   p_end = (const uint8_t *) p_ind + body_size - p_ind->raw_size;
+   *p_line_count = 0;
+
+   for (idx = 0; idx < p_ind->sliced_lines; idx++)
+   {
+      if (p >= p_end)
+         return FALSE;
+
+      if (*p != 0)
+      {
+         if (*p >= COMPACT_SERVICE_COUNT)
+            return FALSE;
+         id = compact_service_ids[*p];
+         p += 1;
+      }
+      else
+      {
+         if (p_end - p < 5)
+            return FALSE;
+         id = p[1] | (p[2] << 8) | (p[3] << 16) | ((unsigned int) p[4] << 24);
+         p += 5;
+      }
+
+      size = vbi_proxy_msg_compact_payload_size(id);
+      if (p_end - p < (long) (2 + size))
+         return FALSE;
+      line = p[0] | (p[1] << 8);
+      p += 2;
+
+      if (*p_line_count < max_lines)
+      {
+         p_lines[*p_line_count].id   = id;
+         p_lines[*p_line_count].line = line;
+         memcpy(p_lines[*p_line_count].data, p, size);
+         memset(p_lines[*p_line_count].data + size, 0,
+                sizeof(p_lines[0].data) - size);
+         *p_line_count += 1;
+      }
+      p += size;
+   }
+
+   if (p != p_end)
+      return FALSE;
+
+   *pp_raw = ((p_ind->raw_size > 0) ? p_end : NULL);
+
+   return TRUE;
+}
+
 /* ----------------------------------------------------------------------------
 ** Implementation of the C library address handling functions
 ** - for platforms which to not have them in libc
@@ -345,6 +345,11 @@ typedef enum
    MSG_TYPE_DAEMON_PID_REQ,
    MSG_TYPE_DAEMON_PID_CNF,
 
+   MSG_TYPE_SLICED_COMPACT_IND,
+
+   MSG_TYPE_STATS_REQ,
+   MSG_TYPE_STATS_CNF,
+
    MSG_TYPE_COUNT
 
 } VBIPROXY_MSG_TYPE;
@@ -363,6 +368,12 @@ typedef struct
 #define VBIPROXY_DEV_NAME_MAX_LENGTH      128
 #define VBIPROXY_ERROR_STR_MAX_LENGTH     128
 
+/* Negotiation of the compact slicer data encoding (MSG_TYPE_SLICED_COMPACT_IND):
+** the client sets the flag in client_flags of CONNECT_REQ, the daemon confirms
+** in daemon_flags of CONNECT_CNF; older peers never set these bits */
+#define VBIPROXY_CLIENT_COMPACT_SLICED    (1<<16)
+#define VBIPROXY_DAEMON_COMPACT_SLICED    (1<<16)
+
 typedef struct
 {
         uint8_t                 protocol_magic[VBIPROXY_MAGIC_LEN];
@@ -423,6 +434,24 @@ typedef struct
                                         + ((S) * sizeof(vbi_sliced)) \
                                         + ((R) * VBIPROXY_RAW_LINE_SIZE) )
 
+/* Compact encoding of slicer data: only requested services, each line packed
+** to the payload size of its service; raw data follows the sliced lines
+** without padding; see vbi_proxy_msg_encode_sliced() */
+typedef struct
+{
+        double                  timestamp;
+        uint32_t                sliced_lines;
+        uint32_t                raw_size;       /* bytes of raw data following the lines */
+        uint8_t                 data[1];
+} VBIPROXY_SLICED_COMPACT_IND;
+
+/* max. size of one encoded line: service code, ID escape, line number, payload */
+#define VBIPROXY_COMPACT_LINE_MAX_SIZE  (1 + 4 + 2 + sizeof(((vbi_sliced *)0)->data))
+#define VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE  ((long)&(((VBIPROXY_SLICED_COMPACT_IND*)NULL)->data))
+#define VBIPROXY_SLICED_COMPACT_IND_MAX_SIZE(S,R) ( VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE \
+                                        + ((S) * VBIPROXY_COMPACT_LINE_MAX_SIZE) \
+                                        + (R) )
+
 typedef struct
 {
         uint8_t                 reset;
@@ -539,6 +568,68 @@ typedef struct
         int32_t                 pid;
 } VBIPROXY_DAEMON_PID_CNF;
 
+typedef struct
+{
+        VBIPROXY_MAGICS         magics;
+} VBIPROXY_STATS_REQ;
+
+/* distribution of a duration, in microseconds */
+typedef struct
+{
+        uint32_t                count;
+        uint32_t                avg;
+        uint32_t                p50;
+        uint32_t                p90;
+        uint32_t                p99;
+        uint32_t                max;
+} VBIPROXY_TIME_STATS;
+
+/* statistics of one device, counting since the daemon was started */
+typedef struct
+{
+        uint8_t                 dev_vbi_name[VBIPROXY_DEV_NAME_MAX_LENGTH];
+        int32_t                 cpu;            /* CPU of the capture thread or -1 */
+        uint32_t                client_count;
+        uint32_t                frames_captured;
+        uint32_t                frames_lost;    /* gaps in capture timestamps */
+        uint32_t                read_errors;
+        uint32_t                frames_forwarded; /* sum over all clients */
+        uint32_t                frames_dropped; /* skipped by clients which fell behind */
+        uint32_t                queue_size;     /* frames in the slicer output ring */
+        uint32_t                queue_depth;    /* max. frames pending for a client */
+        VBIPROXY_TIME_STATS     slicing;        /* read and decode once data is ready */
+        VBIPROXY_TIME_STATS     latency;        /* capture to socket write */
+        uint32_t                reserved[8];    /* set to zero */
+} VBIPROXY_DEV_STATS;
+
+/* statistics of one client connection */
+typedef struct
+{
+        uint8_t                 client_name[VBIPROXY_CLIENT_NAME_MAX_LENGTH];
+        int32_t                 pid;
+        uint32_t                dev_idx;
+        uint32_t                services;
+        uint32_t                frames_forwarded;
+        uint32_t                frames_dropped;
+        uint32_t                queue_depth;    /* frames pending in the ring */
+        VBIPROXY_TIME_STATS     latency;
+        uint32_t                reserved[4];    /* set to zero */
+} VBIPROXY_CLNT_STATS;
+
+/* device records are followed by clnt_count client records */
+typedef struct
+{
+        VBIPROXY_MAGICS         magics;
+        uint32_t                dev_count;
+        uint32_t                clnt_count;
+        VBIPROXY_DEV_STATS      dev[1];
+} VBIPROXY_STATS_CNF;
+
+#define VBIPROXY_STATS_CNF_SIZE(D,C)  ( sizeof(VBIPROXY_STATS_CNF) \
+                                        + (((D) - 1) * sizeof(VBIPROXY_DEV_STATS)) \
+                                        + ((C) * sizeof(VBIPROXY_CLNT_STATS)) )
+#define VBIPROXY_STATS_CNF_CLNT(P)    ((VBIPROXY_CLNT_STATS *) ((P)->dev + (P)->dev_count))
+
 typedef union
 {
         VBIPROXY_CONNECT_REQ            connect_req;
@@ -546,6 +637,7 @@ typedef union
         VBIPROXY_CONNECT_REJ            connect_rej;
 
         VBIPROXY_SLICED_IND             sliced_ind;
+        VBIPROXY_SLICED_COMPACT_IND     sliced_compact_ind;
 
         VBIPROXY_SERVICE_REQ            service_req;
         VBIPROXY_SERVICE_CNF            service_cnf;
@@ -569,6 +661,9 @@ typedef union
         VBIPROXY_DAEMON_PID_REQ         daemon_pid_req;
         VBIPROXY_DAEMON_PID_CNF         daemon_pid_cnf;
 
+        VBIPROXY_STATS_REQ              stats_req;
+        VBIPROXY_STATS_CNF              stats_cnf;
+
 } VBIPROXY_MSG_BODY;
 
 typedef struct
@@ -618,6 +713,13 @@ void     vbi_proxy_msg_close_io( VBIPROXY_MSG_STATE * pIO );
 void     vbi_proxy_msg_fill_magics( VBIPROXY_MAGICS * p_magic );
 void     vbi_proxy_msg_write( VBIPROXY_MSG_STATE * p_io, VBIPROXY_MSG_TYPE type,
                               uint32_t msgLen, VBIPROXY_MSG * pMsg, vbi_bool freeBuf );
+uint32_t vbi_proxy_msg_encode_sliced( VBIPROXY_SLICED_COMPACT_IND * p_ind,
+                                      const vbi_sliced * p_lines, unsigned int line_count,
+                                      unsigned int max_lines, unsigned int services,
+                                      const uint8_t * p_raw, uint32_t raw_size );
+vbi_bool vbi_proxy_msg_decode_sliced( const VBIPROXY_SLICED_COMPACT_IND * p_ind, uint32_t body_size,
+                                      vbi_sliced * p_lines, unsigned int max_lines,
+                                      unsigned int * p_line_count, const uint8_t ** pp_raw );
 
 int      vbi_proxy_msg_listen_socket( vbi_bool is_tcp_ip, const char * listen_ip, const char * listen_port );
 void     vbi_proxy_msg_stop_listen( vbi_bool is_tcp_ip, int sock_fd, char * pSrvPort );
@@ -31,14 +31,26 @@
 #include <errno.h>
 
 #include "misc.h"
+#include "hamm.h"
 #include "raw_decoder.h"
 
 #ifndef RAW_DECODER_PATTERN_DUMP
 #  define RAW_DECODER_PATTERN_DUMP 0
 #endif
 
+/* In adaptive mode the bit slicer skips lines with a smaller
+   peak-to-peak amplitude, in 8 bit sample units. The CRI of all
+   data services has a much larger amplitude. */
+#define MIN_CRI_AMPLITUDE 24
+
 #if 2 == VBI_VERSION_MINOR
 #  define sp_sample_format sampling_format
+#  define VBI_PIXFMT_RGB24_LE VBI_PIXFMT_RGB24
+#  define VBI_PIXFMT_BGR24_LE VBI_PIXFMT_BGR24
+#  define VBI_PIXFMT_RGBA24_LE VBI_PIXFMT_RGBA32_LE
+#  define VBI_PIXFMT_BGRA24_LE VBI_PIXFMT_BGRA32_LE
+#  define VBI_PIXFMT_RGBA24_BE VBI_PIXFMT_RGBA32_BE
+#  define VBI_PIXFMT_BGRA24_BE VBI_PIXFMT_BGRA32_BE
 #else
 #  define sp_sample_format sample_format
 #endif
@@ -427,6 +439,97 @@ cpr1204_crc			(const vbi_sliced *	sliced)
 	return crc;
 }
 
+/* Searches the CRI in samples first ... first + count - 1,
+   remembering where it was found and updating the statistics. */
+static vbi_bool
+slice_window			(_vbi3_raw_decoder_line *line,
+				 vbi_sliced *		sliced,
+				 _vbi3_raw_decoder_job *job,
+				 unsigned int		job_num,
+				 const uint8_t *	raw,
+				 unsigned int		first,
+				 unsigned int		count)
+{
+	vbi3_bit_slicer *bs = &job->slicer;
+	unsigned int lock;
+
+	count = MIN (count, bs->cri_samples - first);
+
+	if (_vbi3_bit_slicer_slice_window (bs, sliced->data,
+					   sizeof (sliced->data),
+					   raw, first, count, &lock)) {
+		line->cri_lock[job_num] = lock + 1;
+		line->stats.cri_samples += lock - first + 1;
+		return TRUE;
+	}
+
+	line->stats.cri_samples += count;
+
+	return FALSE;
+}
+
+static vbi_bool
+slice_adaptive			(_vbi3_raw_decoder_line *line,
+				 vbi_sliced *		sliced,
+				 _vbi3_raw_decoder_job *job,
+				 unsigned int		job_num,
+				 const uint8_t *	raw)
+{
+	vbi3_bit_slicer *bs = &job->slicer;
+	unsigned int lock;
+	unsigned int amplitude;
+
+	lock = line->cri_lock[job_num];
+
+	if (lock > 0) {
+		unsigned int margin;
+		unsigned int first;
+		unsigned int count;
+
+		/* The CRI and FRC bits end at lock - 1. Allow for
+		   some jitter and the threshold to settle. */
+		margin = bs->cri_span / 4 + 2;
+		first = lock - 1;
+		first -= MIN (first, bs->cri_span + margin);
+		count = lock - 1 - first + margin + 1;
+
+		if (first < bs->cri_samples) {
+			count = MIN (count, bs->cri_samples - first);
+			amplitude = _vbi3_bit_slicer_amplitude
+				(bs, raw, first, count);
+			line->stats.check_samples += count;
+
+			if (amplitude >= MIN_CRI_AMPLITUDE) {
+				if (slice_window (line, sliced, job, job_num,
+						  raw, first, count)) {
+					++line->stats.n_window_hits;
+					return TRUE;
+				}
+
+				/* The CRI moved or was lost in noise,
+				   fall back to a full search. */
+				++line->stats.n_full_searches;
+				return slice_window (line, sliced,
+						     job, job_num, raw,
+						     0, bs->cri_samples);
+			}
+		}
+	}
+
+	amplitude = _vbi3_bit_slicer_amplitude (bs, raw, 0, bs->cri_samples);
+	line->stats.check_samples += bs->cri_samples;
+
+	if (amplitude < MIN_CRI_AMPLITUDE) {
+		++line->stats.n_rejected;
+		return FALSE;
+	}
+
+	++line->stats.n_full_searches;
+
+	return slice_window (line, sliced, job, job_num,
+			     raw, 0, bs->cri_samples);
+}
+
 static vbi_bool
 slice				(vbi3_raw_decoder *	rd,
 				 vbi_sliced *		sliced,
@@ -443,6 +546,18 @@ slice				(vbi3_raw_decoder *	rd,
 			 &rd->sp_lines[i].n_points,
 			 N_ELEMENTS (rd->sp_lines[i].points),
 			 raw);
+	} else if (NULL != rd->lines) {
+		_vbi3_raw_decoder_line *line = &rd->lines[i];
+		unsigned int job_num = job - rd->jobs;
+
+		if (rd->adaptive)
+			return slice_adaptive (line, sliced, job,
+					       job_num, raw);
+
+		++line->stats.n_full_searches;
+
+		return slice_window (line, sliced, job, job_num,
+				     raw, 0, job->slicer.cri_samples);
 	} else {
 		return vbi3_bit_slicer_slice
 			(&job->slicer,
@@ -452,6 +567,310 @@ slice				(vbi3_raw_decoder *	rd,
 	}
 }
 
+/* Signal quality metrics. */
+
+#define NO_BIN 0xFF
+
+/* Returns the number of bytes with Hamming or parity errors, and
+   the number of bytes checked in *n_bytes. */
+static unsigned int
+byte_errors			(vbi_service_set	service,
+				 const uint8_t *	data,
+				 unsigned int *		n_bytes)
+{
+	unsigned int n_errors;
+	unsigned int first_par;
+	int d0, d1;
+	int packet;
+	unsigned int i;
+
+	if (service & (VBI_SLICED_CAPTION_525 | VBI_SLICED_CAPTION_625)) {
+		*n_bytes = 2;
+		return (vbi_unpar8 (data[0]) < 0) + (vbi_unpar8 (data[1]) < 0);
+	}
+
+	if (!(service & VBI_SLICED_TELETEXT_B)) {
+		*n_bytes = 0;
+		return 0;
+	}
+
+	/* Packet address, EN 300 706 Section 7.1.2. Hamming 8/4
+	   corrects single bit errors, we count them too. */
+	d0 = vbi_unham8 (data[0]);
+	d1 = vbi_unham8 (data[1]);
+
+	n_errors = (d0 < 0 || vbi_ham8 (d0) != data[0]);
+	n_errors += (d1 < 0 || vbi_ham8 (d1) != data[1]);
+
+	if ((d0 | d1) < 0) {
+		*n_bytes = 2;
+		return n_errors;
+	}
+
+	packet = (d0 >> 3) | (d1 << 1);
+
+	if (0 == packet) {
+		/* Page header, Hamming 8/4 coded page address and
+		   control bits, then odd parity. */
+		for (i = 2; i < 10; ++i) {
+			int d = vbi_unham8 (data[i]);
+
+			n_errors += (d < 0 || vbi_ham8 (d) != data[i]);
+		}
+
+		first_par = 10;
+	} else if (packet <= 25) {
+		first_par = 2;
+	} else {
+		/* Designation code, other coding depends on
+		   the packet. */
+		int d = vbi_unham8 (data[2]);
+
+		*n_bytes = 3;
+		return n_errors + (d < 0 || vbi_ham8 (d) != data[2]);
+	}
+
+	for (i = first_par; i < 42; ++i)
+		n_errors += (vbi_unpar8 (data[i]) < 0);
+
+	*n_bytes = 42;
+
+	return n_errors;
+}
+
+static void
+ring_count			(vbi3_raw_decoder_metrics *m,
+				 const _vbi3_raw_decoder_sample *s,
+				 int			d)
+{
+	m->n_lost += d * s->lost;
+
+	if (NO_BIN != s->eye)
+		m->eye[s->eye] += d;
+	if (NO_BIN != s->amplitude)
+		m->amplitude[s->amplitude] += d;
+	if (NO_BIN != s->jitter)
+		m->jitter[s->jitter] += d;
+
+	m->n_bytes += d * s->n_bytes;
+	m->n_byte_errors += d * s->n_byte_errors;
+}
+
+/* Adds a sample to the ring, replacing the oldest one. */
+static void
+ring_add			(_vbi3_raw_decoder_ring *ring,
+				 const _vbi3_raw_decoder_sample *s)
+{
+	_vbi3_raw_decoder_sample *old = &ring->samples[ring->head];
+
+	if (ring->metrics.n_frames >= _VBI3_RAW_DECODER_RING_SIZE)
+		ring_count (&ring->metrics, old, -1);
+	else
+		++ring->metrics.n_frames;
+
+	*old = *s;
+	ring_count (&ring->metrics, s, +1);
+
+	ring->head = (ring->head + 1) % _VBI3_RAW_DECODER_RING_SIZE;
+}
+
+static void
+measure_lost			(vbi3_raw_decoder *	rd,
+				 unsigned int		job_num,
+				 unsigned int		i)
+{
+	_vbi3_raw_decoder_ring *ring;
+	_vbi3_raw_decoder_sample s;
+
+	ring = &rd->rings[i * _VBI3_RAW_DECODER_MAX_JOBS + job_num];
+
+	s.eye = NO_BIN;
+	s.amplitude = NO_BIN;
+	s.jitter = NO_BIN;
+	/* Only if found in the previous frame, otherwise the line
+	   may just not carry this service. */
+	s.lost = (ring->prev_lock > 0);
+	s.n_bytes = 0;
+	s.n_byte_errors = 0;
+
+	ring_add (ring, &s);
+
+	ring->prev_lock = 0;
+}
+
+static void
+measure				(vbi3_raw_decoder *	rd,
+				 const vbi_sliced *	sliced,
+				 _vbi3_raw_decoder_job *job,
+				 unsigned int		i,
+				 const uint8_t *	raw)
+{
+	const vbi3_bit_slicer *bs = &job->slicer;
+	_vbi3_raw_decoder_ring *ring;
+	_vbi3_raw_decoder_sample s;
+	unsigned int eye;
+	unsigned int amplitude;
+	unsigned int n_bytes;
+	unsigned int lock;
+
+	ring = &rd->rings[i * _VBI3_RAW_DECODER_MAX_JOBS
+			  + (job - rd->jobs)];
+
+	/* The first 64 bits suffice for an estimate. */
+	if (_vbi3_bit_slicer_eye (bs, raw, 64, &eye, &amplitude)) {
+		s.eye = MIN (eye * VBI3_RAW_DECODER_HIST_BINS / 100,
+			     VBI3_RAW_DECODER_HIST_BINS - 1U);
+		s.amplitude = amplitude * VBI3_RAW_DECODER_HIST_BINS / 256;
+	} else {
+		s.eye = NO_BIN;
+		s.amplitude = NO_BIN;
+	}
+
+	lock = bs->cri_lock / bs->bytes_per_sample + 1;
+
+	if (ring->prev_lock > 0) {
+		unsigned int d;
+
+		d = (lock > ring->prev_lock) ?
+			lock - ring->prev_lock : ring->prev_lock - lock;
+		s.jitter = MIN (d, VBI3_RAW_DECODER_HIST_BINS - 1U);
+	} else {
+		s.jitter = NO_BIN;
+	}
+
+	ring->prev_lock = lock;
+
+	s.lost = 0;
+	s.n_byte_errors = byte_errors (job->id, sliced->data, &n_bytes);
+	s.n_bytes = n_bytes;
+
+	ring_add (ring, &s);
+}
+
+/* Luma pre-pass. */
+
+/* Returns TRUE if lines in this format are converted to 8 bit
+   samples before slicing. */
+static vbi_bool
+luma_format			(vbi_pixfmt		sample_format)
+{
+	switch (sample_format) {
+	case VBI_PIXFMT_YUYV:
+	case VBI_PIXFMT_YVYU:
+	case VBI_PIXFMT_UYVY:
+	case VBI_PIXFMT_VYUY:
+	case VBI_PIXFMT_RGBA24_LE:
+	case VBI_PIXFMT_BGRA24_LE:
+	case VBI_PIXFMT_RGBA24_BE:
+	case VBI_PIXFMT_BGRA24_BE:
+	case VBI_PIXFMT_RGB24_LE:
+	case VBI_PIXFMT_BGR24_LE:
+	case VBI_PIXFMT_RGB16_LE:
+	case VBI_PIXFMT_BGR16_LE:
+	case VBI_PIXFMT_RGB16_BE:
+	case VBI_PIXFMT_BGR16_BE:
+	case VBI_PIXFMT_RGBA15_LE:
+	case VBI_PIXFMT_BGRA15_LE:
+	case VBI_PIXFMT_RGBA15_BE:
+	case VBI_PIXFMT_BGRA15_BE:
+	case VBI_PIXFMT_ARGB15_LE:
+	case VBI_PIXFMT_ABGR15_LE:
+	case VBI_PIXFMT_ARGB15_BE:
+	case VBI_PIXFMT_ABGR15_BE:
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
+
+/* Templates to avoid a pixel format switch within the loop. The
+   compiler can vectorize these. */
+#define LUMA8(offset, bpp)						\
+	for (i = 0; i < n_samples; ++i)					\
+		dst[i] = src[i * (bpp) + (offset)];
+
+/* Green component of 16 bit RGB scaled to 8 bits. */
+#define LUMA16(lsb, msb, mask, shift)					\
+	for (i = 0; i < n_samples; ++i) {				\
+		unsigned int v = src[i * 2 + (lsb)]			\
+			+ src[i * 2 + (msb)] * 256;			\
+		dst[i] = (v & (mask)) >> (shift);			\
+	}
+
+/* Extracts the component the bit slicer would look at from all
+   samples of one raw line, in one sweep. All jobs slicing this line
+   can then use the Y8 bit slicer, which reads a third to a quarter
+   of the data and needs no shifting and masking per sample. */
+static void
+convert_line			(uint8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n_samples,
+				 vbi_pixfmt		sample_format)
+{
+	unsigned int i;
+
+	switch (sample_format) {
+	case VBI_PIXFMT_YUYV:
+	case VBI_PIXFMT_YVYU:
+		LUMA8 (0, 2);
+		break;
+
+	case VBI_PIXFMT_UYVY:
+	case VBI_PIXFMT_VYUY:
+		LUMA8 (1, 2);
+		break;
+
+	case VBI_PIXFMT_RGBA24_LE:
+	case VBI_PIXFMT_BGRA24_LE:
+		LUMA8 (1, 4);
+		break;
+
+	case VBI_PIXFMT_RGBA24_BE:
+	case VBI_PIXFMT_BGRA24_BE:
+		LUMA8 (2, 4);
+		break;
+
+	case VBI_PIXFMT_RGB24_LE:
+	case VBI_PIXFMT_BGR24_LE:
+		LUMA8 (1, 3);
+		break;
+
+	case VBI_PIXFMT_RGB16_LE:
+	case VBI_PIXFMT_BGR16_LE:
+		LUMA16 (0, 1, 0x07E0, 3);
+		break;
+
+	case VBI_PIXFMT_RGB16_BE:
+	case VBI_PIXFMT_BGR16_BE:
+		LUMA16 (1, 0, 0x07E0, 3);
+		break;
+
+	case VBI_PIXFMT_RGBA15_LE:
+	case VBI_PIXFMT_BGRA15_LE:
+		LUMA16 (0, 1, 0x03E0, 2);
+		break;
+
+	case VBI_PIXFMT_RGBA15_BE:
+	case VBI_PIXFMT_BGRA15_BE:
+		LUMA16 (1, 0, 0x03E0, 2);
+		break;
+
+	case VBI_PIXFMT_ARGB15_LE:
+	case VBI_PIXFMT_ABGR15_LE:
+		LUMA16 (0, 1, 0x07C0, 3);
+		break;
+
+	case VBI_PIXFMT_ARGB15_BE:
+	case VBI_PIXFMT_ABGR15_BE:
+		LUMA16 (1, 0, 0x07C0, 3);
+		break;
+
+	default:
+		assert (!"reached");
+	}
+}
+
 _vbi_inline vbi_sliced *
 decode_pattern			(vbi3_raw_decoder *	rd,
 				 vbi_sliced *		sliced,
@@ -475,6 +894,10 @@ decode_pattern			(vbi3_raw_decoder *	rd,
 			job = rd->jobs + j - 1;
 
 			if (!slice (rd, sliced, job, i, raw)) {
+				/* The data service found last time. */
+				if (NULL != rd->rings && pat == pattern)
+					measure_lost (rd, j - 1, i);
+
 				continue; /* no match, try next data service */
 			}
 
@@ -520,6 +943,9 @@ decode_pattern			(vbi3_raw_decoder *	rd,
 					 sliced->line,
 					 vbi_sliced_name (sliced->id));
 
+			if (NULL != rd->rings)
+				measure (rd, sliced, job, i, raw);
+
 			++sliced;
 
 			/* Predict line as non-blank, force testing for
@@ -625,7 +1051,20 @@ vbi3_raw_decoder_decode		(vbi3_raw_decoder *	rd,
 		if (sp->interlaced && i == (unsigned int) sp->count[0])
 			raw = raw1 + sp->bytes_per_line;
 
-		sliced = decode_pattern (rd, sliced, pattern, i, raw);
+		if (NULL != rd->lines)
+			++rd->lines[i].stats.n_frames;
+
+		/* Lines predicted as blank are not sliced, so we
+		   don't convert them either. */
+		if (NULL != rd->luma && pattern[0] > 0) {
+			convert_line (rd->luma, raw, rd->n_luma_samples,
+				      sp->sp_sample_format);
+			sliced = decode_pattern (rd, sliced, pattern,
+						 i, rd->luma);
+		} else {
+			sliced = decode_pattern (rd, sliced, pattern,
+						 i, raw);
+		}
 
 		pattern += _VBI3_RAW_DECODER_MAX_WAYS;
 		raw += pitch;
@@ -653,6 +1092,23 @@ vbi3_raw_decoder_reset		(vbi3_raw_decoder *	rd)
 		rd->pattern = NULL;
 	}
 
+	if (rd->lines) {
+		vbi_free (rd->lines);
+		rd->lines = NULL;
+	}
+
+	if (rd->rings) {
+		vbi_free (rd->rings);
+		rd->rings = NULL;
+	}
+
+	if (rd->luma) {
+		vbi_free (rd->luma);
+		rd->luma = NULL;
+	}
+
+	rd->n_luma_samples = 0;
+
 	rd->services = 0;
 	rd->n_jobs = 0;
 
@@ -700,6 +1156,61 @@ remove_job_from_pattern		(vbi3_raw_decoder *	rd,
 	}
 }
 
+static void
+remove_job_from_lines		(vbi3_raw_decoder *	rd,
+				 unsigned int		job_num)
+{
+	unsigned int scan_lines;
+	unsigned int i;
+
+	scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+
+	/* Jobs above job_num move down in rd->jobs. */
+	for (i = 0; i < scan_lines; ++i) {
+		unsigned int *cri_lock = rd->lines[i].cri_lock;
+
+		memmove (&cri_lock[job_num], &cri_lock[job_num + 1],
+			 (_VBI3_RAW_DECODER_MAX_JOBS - job_num - 1)
+			 * sizeof (*cri_lock));
+
+		cri_lock[_VBI3_RAW_DECODER_MAX_JOBS - 1] = 0;
+	}
+
+	if (NULL == rd->rings)
+		return;
+
+	for (i = 0; i < scan_lines; ++i) {
+		_vbi3_raw_decoder_ring *rings;
+
+		rings = rd->rings + i * _VBI3_RAW_DECODER_MAX_JOBS;
+
+		memmove (&rings[job_num], &rings[job_num + 1],
+			 (_VBI3_RAW_DECODER_MAX_JOBS - job_num - 1)
+			 * sizeof (*rings));
+
+		CLEAR (rings[_VBI3_RAW_DECODER_MAX_JOBS - 1]);
+	}
+}
+
+static vbi_bool
+alloc_rings			(vbi3_raw_decoder *	rd)
+{
+	unsigned int n;
+
+	n = (rd->sampling.count[0] + rd->sampling.count[1])
+		* _VBI3_RAW_DECODER_MAX_JOBS;
+
+	rd->rings = vbi_malloc (n * sizeof (*rd->rings));
+	if (NULL == rd->rings) {
+		error (&rd->log, "Out of memory.");
+		return FALSE;
+	}
+
+	memset (rd->rings, 0, n * sizeof (*rd->rings));
+
+	return TRUE;
+}
+
 /**
  * $param rd Pointer to vbi3_raw_decoder object allocated with
  *   vbi3_raw_decoder_new().
@@ -728,6 +1239,8 @@ vbi3_raw_decoder_remove_services
 		if (job->id & services) {
 			if (rd->pattern)
                                 remove_job_from_pattern (rd, job_num);
+			if (rd->lines)
+				remove_job_from_lines (rd, job_num);
 
 			memmove (job, job + 1,
 				 (rd->n_jobs - job_num - 1) * sizeof (*job));
@@ -942,6 +1455,43 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 		memset (rd->pattern, 0, scan_ways * sizeof (rd->pattern[0]));
 	}
 
+	if (!rd->lines) {
+		unsigned int scan_lines;
+
+		scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+
+		rd->lines = vbi_malloc (scan_lines * sizeof (*rd->lines));
+		if (NULL == rd->lines) {
+			error (&rd->log, "Out of memory.");
+			return rd->services;
+		}
+
+		memset (rd->lines, 0, scan_lines * sizeof (*rd->lines));
+	}
+
+	if (rd->metrics && !rd->rings) {
+		if (!alloc_rings (rd))
+			return rd->services;
+	}
+
+	if (!rd->luma && luma_format (rd->sampling.sp_sample_format)) {
+		unsigned int n_samples;
+
+#if 2 == VBI_VERSION_MINOR
+		n_samples = rd->sampling.bytes_per_line
+			/ VBI_PIXFMT_BPP (rd->sampling.sp_sample_format);
+#else
+		n_samples = rd->sampling.samples_per_line;
+#endif
+		rd->luma = vbi_malloc (n_samples);
+		if (NULL == rd->luma) {
+			error (&rd->log, "Out of memory.");
+			return rd->services;
+		}
+
+		rd->n_luma_samples = n_samples;
+	}
+
 #if 2 == VBI_VERSION_MINOR
 	if (525 == rd->sampling.scanning) {
 #else
@@ -1036,9 +1586,12 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 			assert (!"bit_slicer_init");
 		}
 
+		/* Lines are converted to 8 bit samples first if
+		   NULL != rd->luma. */
 		if (!vbi3_bit_slicer_set_params
 		    (&job->slicer,
-		     sp->sp_sample_format,
+		     (NULL != rd->luma) ?
+		     VBI_PIXFMT_YUV420 : sp->sp_sample_format,
 		     sp->sampling_rate,
 		     sample_offset,
 		     samples_per_line,
@@ -1081,6 +1634,160 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 	return rd->services;
 }
 
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param enable $c TRUE to enable adaptive mode.
+ *
+ * In adaptive mode the decoder remembers for each line and data
+ * service where the bit slicer found the clock run-in last, and
+ * searches only near that position in the next frame. If the CRI is
+ * not found there it searches the whole line again. Lines are skipped
+ * entirely when their amplitude is too small to contain data.
+ * Adaptive mode is disabled by default.
+ */
+void
+vbi3_raw_decoder_set_adaptive	(vbi3_raw_decoder *	rd,
+				 vbi_bool		enable)
+{
+	assert (NULL != rd);
+
+	rd->adaptive = !!enable;
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param stats Statistics will be stored here.
+ * $param row Scan line, counting from zero like the lines of the
+ *   raw VBI image.
+ *
+ * Returns how many samples the decoder examined on a line since
+ * services were added or vbi3_raw_decoder_reset_stats() was called.
+ *
+ * $returns
+ * $c FALSE if $a row is out of bounds or no services were added.
+ */
+vbi_bool
+vbi3_raw_decoder_get_line_stats	(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_line_stats *stats,
+				 unsigned int		row)
+{
+	assert (NULL != rd);
+	assert (NULL != stats);
+
+	if (NULL == rd->lines
+	    || row >= (unsigned int)(rd->sampling.count[0]
+				     + rd->sampling.count[1]))
+		return FALSE;
+
+	*stats = rd->lines[row].stats;
+
+	return TRUE;
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ *
+ * Resets the statistics of all lines to zero.
+ */
+void
+vbi3_raw_decoder_reset_stats	(vbi3_raw_decoder *	rd)
+{
+	unsigned int scan_lines;
+	unsigned int i;
+
+	assert (NULL != rd);
+
+	if (NULL == rd->lines)
+		return;
+
+	scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+
+	for (i = 0; i < scan_lines; ++i)
+		CLEAR (rd->lines[i].stats);
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param enable $c TRUE to measure the signal quality.
+ *
+ * Enables or disables signal quality measurements. The decoder then
+ * examines every line where it found data once more, and records the
+ * eye opening, amplitude, CRI phase jitter and Hamming and parity
+ * errors of the last 128 frames. Call vbi3_raw_decoder_get_metrics()
+ * to read the results. Disabling discards all measurements.
+ *
+ * $returns
+ * $c FALSE if out of memory.
+ */
+vbi_bool
+vbi3_raw_decoder_set_metrics	(vbi3_raw_decoder *	rd,
+				 vbi_bool		enable)
+{
+	assert (NULL != rd);
+
+	rd->metrics = !!enable;
+
+	if (!enable) {
+		vbi_free (rd->rings);
+		rd->rings = NULL;
+	} else if (NULL == rd->rings && NULL != rd->lines) {
+		/* Services have been added already. */
+		if (!alloc_rings (rd)) {
+			rd->metrics = FALSE;
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param metrics Histograms will be stored here.
+ * $param row Scan line, counting from zero like the lines of the
+ *   raw VBI image.
+ * $param service Data service.
+ *
+ * Returns histograms of the signal quality of $a service on a
+ * line over the last frames. The measurements must be enabled with
+ * vbi3_raw_decoder_set_metrics().
+ *
+ * $returns
+ * $c FALSE if measurements are disabled, $a row is out of bounds or
+ * the decoder does not decode $a service.
+ */
+vbi_bool
+vbi3_raw_decoder_get_metrics	(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_metrics *metrics,
+				 unsigned int		row,
+				 vbi_service_set	service)
+{
+	unsigned int job_num;
+
+	assert (NULL != rd);
+	assert (NULL != metrics);
+
+	if (NULL == rd->rings
+	    || row >= (unsigned int)(rd->sampling.count[0]
+				     + rd->sampling.count[1]))
+		return FALSE;
+
+	for (job_num = 0; job_num < rd->n_jobs; ++job_num) {
+		if (rd->jobs[job_num].id & service) {
+			*metrics = rd->rings[row * _VBI3_RAW_DECODER_MAX_JOBS
+					     + job_num].metrics;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 vbi_bool
 vbi3_raw_decoder_sampling_point	(vbi3_raw_decoder *	rd,
 				 vbi3_bit_slicer_point *point,
@@ -41,6 +41,69 @@ VBI_BEGIN_DECLS
  */
 typedef struct _vbi3_raw_decoder vbi3_raw_decoder;
 
+/*
+ * $ingroup RawDecoder
+ * $brief Raw VBI decoder statistics of one scan line.
+ */
+typedef struct {
+	/* Number of raw VBI images decoded. */
+	unsigned int		n_frames;
+
+	/* Samples examined in search of a CRI, in all frames. */
+	uint64_t		cri_samples;
+
+	/* Samples examined by the amplitude check in adaptive mode. */
+	uint64_t		check_samples;
+
+	/* Searches in adaptive mode which found the CRI near the
+	   position where it was found before. */
+	unsigned int		n_window_hits;
+
+	/* Searches of the whole line. */
+	unsigned int		n_full_searches;
+
+	/* Searches skipped in adaptive mode because the line
+	   carried no signal. */
+	unsigned int		n_rejected;
+} vbi3_raw_decoder_line_stats;
+
+/* Number of bins of the vbi3_raw_decoder_metrics histograms. */
+#define VBI3_RAW_DECODER_HIST_BINS 16
+
+/*
+ * $ingroup RawDecoder
+ * $brief Signal quality of one data service on one scan line,
+ *   over the last frames.
+ */
+typedef struct {
+	/* Number of frames measured, at most 128. */
+	unsigned int		n_frames;
+
+	/* Frames where the bit slicer did not find the service on
+	   the line although it did in the previous frame. */
+	unsigned int		n_lost;
+
+	/* Histogram of the eye opening. Bin n counts frames with
+	   an opening of 100 * n / 16 to 100 * (n + 1) / 16 percent
+	   of the amplitude. */
+	unsigned int		eye[VBI3_RAW_DECODER_HIST_BINS];
+
+	/* Histogram of the amplitude, the difference between the
+	   average level of '1' and '0' bits. Bin n counts
+	   frames with an amplitude of 16 * n to 16 * n + 15. */
+	unsigned int		amplitude[VBI3_RAW_DECODER_HIST_BINS];
+
+	/* Histogram of the CRI phase jitter, how many samples the
+	   position of the CRI moved since the previous frame. The
+	   last bin counts 15 or more samples. */
+	unsigned int		jitter[VBI3_RAW_DECODER_HIST_BINS];
+
+	/* Number of bytes protected by a Hamming code or parity bit,
+	   and how many of them had errors. */
+	unsigned int		n_bytes;
+	unsigned int		n_byte_errors;
+} vbi3_raw_decoder_metrics;
+
 /*
  * $addtogroup RawDecoder
  * ${
@@ -70,6 +133,23 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 extern vbi_bool
 vbi3_raw_decoder_debug		(vbi3_raw_decoder *	rd,
 				 vbi_bool		enable);
+extern void
+vbi3_raw_decoder_set_adaptive	(vbi3_raw_decoder *	rd,
+				 vbi_bool		enable);
+extern vbi_bool
+vbi3_raw_decoder_get_line_stats	(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_line_stats *stats,
+				 unsigned int		row);
+extern void
+vbi3_raw_decoder_reset_stats	(vbi3_raw_decoder *	rd);
+extern vbi_bool
+vbi3_raw_decoder_set_metrics	(vbi3_raw_decoder *	rd,
+				 vbi_bool		enable);
+extern vbi_bool
+vbi3_raw_decoder_get_metrics	(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_metrics *metrics,
+				 unsigned int		row,
+				 vbi_service_set	service);
 extern vbi_service_set
 vbi3_raw_decoder_set_sampling_par
 				(vbi3_raw_decoder *	rd,
@@ -110,6 +190,44 @@ typedef struct {
 	unsigned int		n_points;
 } _vbi3_raw_decoder_sp_line;
 
+/** @internal */
+typedef struct {
+	/* Per job: one plus the sample where the bit slicer found
+	   the CRI last, zero if unknown. */
+	unsigned int		cri_lock[_VBI3_RAW_DECODER_MAX_JOBS];
+
+	vbi3_raw_decoder_line_stats stats;
+} _vbi3_raw_decoder_line;
+
+/** @internal */
+#define _VBI3_RAW_DECODER_RING_SIZE 128
+
+/** @internal */
+typedef struct {
+	/* Histogram bins or 0xFF if unknown. */
+	uint8_t			eye;
+	uint8_t			amplitude;
+	uint8_t			jitter;
+
+	uint8_t			lost;
+	uint8_t			n_bytes;
+	uint8_t			n_byte_errors;
+} _vbi3_raw_decoder_sample;
+
+/** @internal */
+typedef struct {
+	/* Measurements of the last frames. */
+	_vbi3_raw_decoder_sample samples[_VBI3_RAW_DECODER_RING_SIZE];
+	unsigned int		head;
+
+	/* One plus the sample where the CRI was found in the
+	   previous frame, zero if unknown. */
+	unsigned int		prev_lock;
+
+	/* Histograms of the samples in the ring. */
+	vbi3_raw_decoder_metrics metrics;
+} _vbi3_raw_decoder_ring;
+
 /**
  * @internal
  * Don't dereference pointers to this structure.
@@ -129,6 +247,12 @@ struct _vbi3_raw_decoder {
 	int8_t *		pattern;	/* n scan lines * MAX_WAYS */
 	_vbi3_raw_decoder_job	jobs[_VBI3_RAW_DECODER_MAX_JOBS];
 	_vbi3_raw_decoder_sp_line *sp_lines;
+	_vbi3_raw_decoder_line *lines;		/* n scan lines */
+	vbi_bool		adaptive;
+	vbi_bool		metrics;
+	_vbi3_raw_decoder_ring *rings;		/* n scan lines * MAX_JOBS */
+	uint8_t *		luma;		/* one line of 8 bit samples */
+	unsigned int		n_luma_samples;
 };
 
 /** @internal */
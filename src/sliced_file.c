@@ -0,0 +1,2719 @@
+/*
+ *  libzvbi - Sliced VBI recording reader, writer and index
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* This code is experimental and not yet part of the library API. */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <ctype.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>		/* mmap(), munmap() */
+
+#include "misc.h"
+#include "hamm.h"		/* vbi_unham16p() */
+#include "vps.h"		/* vbi_decode_vps_cni() */
+#include "packet-830.h"		/* vbi_decode_teletext_8301_cni() */
+#include "dvb_demux.h"		/* _vbi_dvb_demultiplex_sliced() */
+#include "sliced_file.h"
+
+/* XXX Later. */
+#undef _
+#define _(x) (x)
+
+/* Largest frame we need to see in one piece when reading through a
+   buffer: an old sliced frame header and 255 Teletext lines, or a
+   PES packet. */
+#define BUFFER_SIZE (6 + 65535 + 4096)
+
+/* Capture time jumps larger than this (in seconds) count as
+   channel switch. */
+#define MAX_FRAME_GAP 1.0
+
+#define INDEX_MAGIC "ZVBIIDX"
+#define INDEX_VERSION 1
+#define INDEX_HEADER_SIZE (8 + 4 + 4 + 8 + 4)
+#define INDEX_ENTRY_SIZE (8 + 8 + 8 + 4 + 4)
+
+/* Compact format: file header, blocks of frames which can be
+   decoded independently, an index of the blocks and a footer
+   pointing to the index. */
+#define COMPACT_MAGIC _VBI_SLICED_FILE_COMPACT_MAGIC
+#define COMPACT_BLOCK_MAGIC "VBLK"
+#define COMPACT_INDEX_MAGIC "VIDX"
+#define COMPACT_FOOTER_MAGIC "VIDXEND"
+#define COMPACT_BLOCK_HEADER_SIZE (4 + 4 + 4 + 4 + 8 + 8 + 4)
+#define COMPACT_FOOTER_SIZE (8 + 8)
+
+/* Start a new block at least when it grows this large. */
+#define COMPACT_MAX_BLOCK_SIZE (1 << 20)
+
+/* Dictionary of recently stored lines. Lines repeated within a block
+   are stored as a reference. */
+#define DICT_SIZE 4096
+#define HASH_SIZE 8192
+
+/* Line tag: bits 0-3 service number as in the old sliced format or
+   TAG_OTHER_SERVICE, TAG_REF if a dictionary reference follows
+   instead of the payload, TAG_NEXT_LINE if the line number is that
+   of the previous line in the frame plus one. */
+#define TAG_SERVICE_MASK 0x0F
+#define TAG_OTHER_SERVICE 0x0F
+#define TAG_REF 0x10
+#define TAG_NEXT_LINE 0x20
+
+#define w32(p, n) ((p)[0] = (n), (p)[1] = (n) >> 8,			\
+		   (p)[2] = (n) >> 16, (p)[3] = (n) >> 24)
+#define w64(p, n) (w32 (p, (uint32_t)(n)),				\
+		   w32 ((p) + 4, (uint32_t)((uint64_t)(n) >> 32)))
+#define r32(p) ((p)[0] | ((p)[1] << 8) | ((p)[2] << 16)			\
+		| ((uint32_t)(p)[3] << 24))
+#define r64(p) (r32 (p) | ((uint64_t) r32 ((p) + 4) << 32))
+
+/* Only lines with a payload of at least this size enter the
+   dictionary, a reference would not be shorter. */
+#define DICT_MIN_BYTES 8
+
+struct dict_entry {
+	vbi_service_set		id;
+	unsigned int		n_bytes;
+	uint8_t			data[56];
+};
+
+struct _vbi_sliced_index {
+	_vbi_sliced_index_entry *entries;
+	unsigned int		n_entries;
+	unsigned int		capacity;
+
+	/* Capture times are monotonic except at channel switches,
+	   where the recording may have started anew. These are the
+	   first entries of runs with non-decreasing capture times. */
+	unsigned int *		segments;
+	unsigned int		n_segments;
+
+	_vbi_sliced_file_format	format;
+
+	/* Size of the indexed recording in bytes. */
+	int64_t			file_size;
+};
+
+struct _vbi_sliced_file {
+	_vbi_sliced_file_format	format;
+
+	int			fd;
+	vbi_bool		close_fd;
+
+	/* Read buffer, or the file mapped into memory. */
+	uint8_t *		buffer;
+
+	/* Size of the mapping, zero if we read() the file. */
+	size_t			map_size;
+
+	/* Unread data in the buffer. */
+	const uint8_t *		bp;
+	const uint8_t *		end;
+
+	/* File offset of buffer[0]. */
+	int64_t			buffer_offset;
+
+	/* Capture time of the previous frame, old sliced format. */
+	double			sample_time;
+
+	/* After seeking, capture time of the next frame. */
+	double			seek_time;
+	vbi_bool		seek_time_valid;
+
+	/* Number of the next frame. */
+	unsigned int		frame_number;
+
+	/* Offset of the first frame. */
+	int64_t			data_offset;
+
+	/* Compact format. End of the current block, zero if the next
+	   frame starts a new block. */
+	int64_t			block_end;
+	double			block_time;
+	int64_t			block_us;
+	int64_t			block_pts;
+	struct dict_entry *	dict;
+	unsigned int		dict_next;
+	unsigned int		dict_count;
+
+	/* Scratch buffer for index building and seeking. */
+	vbi_sliced		sliced[256];
+
+	/* _vbi_sliced_file_seek_time() read this frame into sliced[]
+	   already. */
+	vbi_bool		pending;
+	int64_t			pending_offset;
+	unsigned int		pending_lines;
+	double			pending_time;
+	int64_t			pending_pts;
+
+	char *			errstr;
+};
+
+static void
+set_errstr			(_vbi_sliced_file *	sf,
+				 const char *		templ,
+				 ...)
+{
+	va_list ap;
+
+	vbi_free (sf->errstr);
+	sf->errstr = NULL;
+
+	va_start (ap, templ);
+
+	/* Error ignored. */
+	vasprintf (&sf->errstr, templ, ap);
+
+	va_end (ap);
+}
+
+static void
+no_mem_error			(_vbi_sliced_file *	sf)
+{
+	vbi_free (sf->errstr);
+
+	/* Error ignored. */
+	sf->errstr = strdup (_("Out of memory."));
+
+	errno = ENOMEM;
+}
+
+static void
+bad_format_error		(_vbi_sliced_file *	sf)
+{
+	set_errstr (sf, _("Invalid data at offset %" PRId64 "."),
+		    sf->buffer_offset + (sf->bp - sf->buffer));
+
+	errno = EINVAL;
+}
+
+static void
+io_error			(_vbi_sliced_file *	sf)
+{
+	int saved_errno = errno;
+
+	set_errstr (sf, _("Read error: %s."), strerror (saved_errno));
+
+	errno = saved_errno;
+}
+
+static void
+put_index_entry			(uint8_t		buffer[INDEX_ENTRY_SIZE],
+				 const _vbi_sliced_index_entry *e)
+{
+	uint64_t t;
+
+	/* Bit exact, so seeking yields the same capture
+	   times as reading sequentially. */
+	memcpy (&t, &e->sample_time, sizeof (t));
+
+	w64 (buffer + 0, e->offset);
+	w64 (buffer + 8, t);
+	w64 (buffer + 16, e->stream_time);
+	w32 (buffer + 24, e->frame_number);
+	w32 (buffer + 28, e->flags);
+}
+
+static void
+get_index_entry			(_vbi_sliced_index_entry *e,
+				 const uint8_t		buffer[INDEX_ENTRY_SIZE])
+{
+	uint64_t t;
+
+	e->offset = (int64_t) r64 (buffer + 0);
+	t = r64 (buffer + 8);
+	memcpy (&e->sample_time, &t, sizeof (t));
+	e->stream_time = (int64_t) r64 (buffer + 16);
+	e->frame_number = r32 (buffer + 24);
+	e->flags = r32 (buffer + 28);
+}
+
+/* Makes sure at least n_bytes of unread data are in the buffer.
+   Returns FALSE with errno 0 at the end of the file. */
+static vbi_bool
+need				(_vbi_sliced_file *	sf,
+				 unsigned int		n_bytes)
+{
+	unsigned int available;
+
+	assert (n_bytes <= BUFFER_SIZE);
+
+	available = sf->end - sf->bp;
+	if (likely (available >= n_bytes))
+		return TRUE;
+
+	if (0 != sf->map_size) {
+		/* The whole file is in the buffer. */
+		errno = 0;
+		return FALSE;
+	}
+
+	if (sf->bp > sf->buffer) {
+		memmove (sf->buffer, sf->bp, available);
+		sf->buffer_offset += sf->bp - sf->buffer;
+		sf->bp = sf->buffer;
+		sf->end = sf->buffer + available;
+	}
+
+	while (available < n_bytes) {
+		ssize_t actual;
+
+		actual = read (sf->fd, sf->buffer + available,
+			       BUFFER_SIZE - available);
+		if (0 == actual) {
+			errno = 0;
+			return FALSE;
+		} else if (actual < 0) {
+			if (EINTR == errno)
+				continue;
+			io_error (sf);
+			return FALSE;
+		}
+
+		available += actual;
+		sf->end = sf->buffer + available;
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+seek_to				(_vbi_sliced_file *	sf,
+				 int64_t		offset)
+{
+	int64_t buffer_end;
+
+	buffer_end = sf->buffer_offset + (sf->end - sf->buffer);
+
+	if (offset >= sf->buffer_offset && offset <= buffer_end) {
+		sf->bp = sf->buffer + (offset - sf->buffer_offset);
+		return TRUE;
+	}
+
+	if (0 != sf->map_size) {
+		set_errstr (sf, _("Offset %" PRId64 " is beyond the "
+				  "end of the file."), offset);
+		errno = EINVAL;
+		return FALSE;
+	}
+
+	if ((off_t) -1 == lseek (sf->fd, (off_t) offset, SEEK_SET)) {
+		io_error (sf);
+		return FALSE;
+	}
+
+	sf->buffer_offset = offset;
+	sf->bp = sf->buffer;
+	sf->end = sf->buffer;
+
+	return TRUE;
+}
+
+static vbi_bool
+skip				(_vbi_sliced_file *	sf,
+				 unsigned int		n_bytes)
+{
+	if (n_bytes <= (unsigned int)(sf->end - sf->bp)) {
+		sf->bp += n_bytes;
+		return TRUE;
+	}
+
+	return seek_to (sf, sf->buffer_offset
+			+ (sf->bp - sf->buffer) + n_bytes);
+}
+
+static const struct {
+	vbi_service_set		id;
+	unsigned int		n_bytes;
+} old_sliced_services[] = {
+	{ VBI_SLICED_TELETEXT_B,	42 },
+	{ VBI_SLICED_CAPTION_625,	2 },
+	{ VBI_SLICED_VPS,		13 },
+	{ VBI_SLICED_WSS_625,		2 },
+	{ VBI_SLICED_WSS_CPR1204,	3 },
+	{ 0,				0 },
+	{ 0,				0 },
+	{ VBI_SLICED_CAPTION_525,	2 },
+};
+
+/* Compact format integers: unsigned LEB128, signed values zigzag
+   encoded. */
+static vbi_bool
+get_varint			(uint64_t *		value,
+				 const uint8_t **	pp,
+				 const uint8_t *	end)
+{
+	const uint8_t *p = *pp;
+	uint64_t v;
+	unsigned int shift;
+
+	v = 0;
+
+	for (shift = 0; shift < 64; shift += 7) {
+		if (unlikely (p >= end))
+			return FALSE;
+
+		v |= (uint64_t)(*p & 0x7F) << shift;
+
+		if (0 == (*p++ & 0x80)) {
+			*value = v;
+			*pp = p;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static int64_t
+unzigzag			(uint64_t		value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* Returns the size of the block payload. */
+static unsigned int
+parse_block_header		(_vbi_sliced_index_entry *e,
+				 const uint8_t		p[COMPACT_BLOCK_HEADER_SIZE])
+{
+	uint64_t t;
+
+	t = r64 (p + 16);
+	memcpy (&e->sample_time, &t, sizeof (t));
+	e->stream_time = (int64_t) r64 (p + 24);
+	e->frame_number = r32 (p + 32);
+	e->flags = r32 (p + 12);
+
+	return r32 (p + 4);
+}
+
+static vbi_bool
+read_block_header_compact	(_vbi_sliced_file *	sf)
+{
+	_vbi_sliced_index_entry e;
+	const uint8_t *p;
+	unsigned int size;
+
+	if (!need (sf, 4))
+		return FALSE; /* EOF or error */
+
+	/* The index follows the last block. */
+	if (0 == memcmp (sf->bp, COMPACT_INDEX_MAGIC, 4)) {
+		errno = 0;
+		return FALSE;
+	}
+
+	if (!need (sf, COMPACT_BLOCK_HEADER_SIZE)) {
+		if (0 == errno) {
+			set_errstr (sf, _("Premature end of file."));
+			errno = EINVAL;
+		}
+		return FALSE;
+	}
+
+	p = sf->bp;
+
+	if (0 != memcmp (p, COMPACT_BLOCK_MAGIC, 4)) {
+		bad_format_error (sf);
+		return FALSE;
+	}
+
+	size = parse_block_header (&e, p);
+
+	sf->block_end = _vbi_sliced_file_tell (sf)
+		+ COMPACT_BLOCK_HEADER_SIZE + size;
+
+	sf->block_time = e.sample_time;
+	sf->block_pts = e.stream_time;
+	sf->block_us = 0;
+
+	sf->frame_number = e.frame_number;
+
+	/* Blocks can be decoded independently. */
+	sf->dict_count = 0;
+
+	sf->bp += COMPACT_BLOCK_HEADER_SIZE;
+
+	return TRUE;
+}
+
+static vbi_bool
+read_frame_compact		(_vbi_sliced_file *	sf,
+				 vbi_sliced *		sliced,
+				 unsigned int *		n_lines,
+				 unsigned int		max_lines,
+				 double *		sample_time,
+				 int64_t *		stream_time)
+{
+	const uint8_t *p;
+	const uint8_t *end;
+	int64_t offset;
+	uint64_t dt;
+	uint64_t dpts;
+	uint64_t count;
+	unsigned int line;
+	unsigned int i;
+
+	offset = _vbi_sliced_file_tell (sf);
+
+	if (offset >= sf->block_end) {
+		if (!read_block_header_compact (sf))
+			return FALSE; /* EOF or error */
+
+		offset = _vbi_sliced_file_tell (sf);
+	}
+
+	/* The writer limits frames to a size which fits into
+	   the buffer. */
+	if (!need (sf, MIN (sf->block_end - offset,
+			    (int64_t) BUFFER_SIZE))) {
+		if (0 == errno) {
+			set_errstr (sf, _("Premature end of file."));
+			errno = EINVAL;
+		}
+		return FALSE;
+	}
+
+	p = sf->bp;
+	end = sf->bp + MIN (sf->block_end - offset,
+			    (int64_t)(sf->end - sf->bp));
+
+	/* Capture time in microseconds and PTS relative to the
+	   previous frame, then the number of lines. */
+	if (!get_varint (&dt, &p, end)
+	    || !get_varint (&dpts, &p, end)
+	    || !get_varint (&count, &p, end)
+	    || count > 255)
+		goto bad_format;
+
+	if (count > max_lines) {
+		set_errstr (sf, _("Frame at offset %" PRId64 " has "
+				  "%u lines, more than fit into the "
+				  "buffer."),
+			    offset, (unsigned int) count);
+		errno = ENOSPC;
+		return FALSE;
+	}
+
+	line = 0;
+
+	for (i = 0; i < count; ++i) {
+		const struct dict_entry *d;
+		struct dict_entry *e;
+		unsigned int n_bytes;
+		unsigned int tag;
+		uint64_t v;
+
+		if (unlikely (p >= end))
+			goto bad_format;
+
+		tag = *p++;
+
+		if (tag & TAG_NEXT_LINE) {
+			++line;
+		} else {
+			if (!get_varint (&v, &p, end))
+				goto bad_format;
+			line = (unsigned int) v;
+		}
+
+		sliced[i].line = line;
+
+		if (tag & TAG_REF) {
+			/* Distance to a line stored earlier in
+			   this block. */
+			if (!get_varint (&v, &p, end)
+			    || 0 == v
+			    || v > MIN (sf->dict_count,
+					(unsigned int) DICT_SIZE))
+				goto bad_format;
+
+			d = &sf->dict[(sf->dict_next - (unsigned int) v)
+				      % DICT_SIZE];
+
+			sliced[i].id = d->id;
+			memcpy (sliced[i].data, d->data, d->n_bytes);
+		} else {
+			unsigned int index = tag & TAG_SERVICE_MASK;
+
+			if (TAG_OTHER_SERVICE == index) {
+				if (!get_varint (&v, &p, end))
+					goto bad_format;
+				sliced[i].id = (vbi_service_set) v;
+				n_bytes = sizeof (sliced[i].data);
+			} else if (index < N_ELEMENTS (old_sliced_services)
+				   && 0 != old_sliced_services[index].n_bytes) {
+				sliced[i].id = old_sliced_services[index].id;
+				n_bytes = old_sliced_services[index].n_bytes;
+			} else {
+				goto bad_format;
+			}
+
+			if (unlikely ((unsigned int)(end - p) < n_bytes))
+				goto bad_format;
+
+			memcpy (sliced[i].data, p, n_bytes);
+			p += n_bytes;
+
+			if (n_bytes < DICT_MIN_BYTES)
+				continue;
+
+			d = NULL;
+		}
+
+		/* References re-enter the dictionary, so lines
+		   repeated regularly remain in reach. */
+		e = &sf->dict[sf->dict_next % DICT_SIZE];
+		if (NULL == d) {
+			e->id = sliced[i].id;
+			e->n_bytes = n_bytes;
+			memcpy (e->data, sliced[i].data, n_bytes);
+		} else if (e != d) {
+			*e = *d;
+		}
+		++sf->dict_next;
+		++sf->dict_count;
+	}
+
+	sf->bp = p;
+	sf->seek_time_valid = FALSE;
+
+	sf->block_us += unzigzag (dt);
+	sf->block_pts += unzigzag (dpts);
+
+	*n_lines = count;
+
+	/* Division for exact results if the capture times are
+	   multiples of a power of two fraction of a second. */
+	*sample_time = sf->block_time + sf->block_us / 1e6;
+	*stream_time = sf->block_pts;
+
+	return TRUE;
+
+ bad_format:
+	bad_format_error (sf);
+	return FALSE;
+}
+
+static vbi_bool
+read_frame_old_sliced		(_vbi_sliced_file *	sf,
+				 vbi_sliced *		sliced,
+				 unsigned int *		n_lines,
+				 unsigned int		max_lines,
+				 double *		sample_time)
+{
+	char time_buffer[32];
+	unsigned int count;
+	unsigned int n_sliced;
+	unsigned int i;
+	double dt;
+
+	/* Time in seconds since the last frame, terminated by a
+	   newline, then the number of lines. */
+
+	if (!need (sf, 1))
+		return FALSE; /* EOF or error */
+
+	if (!need (sf, sizeof (time_buffer) + 1)) {
+		if (0 != errno)
+			return FALSE;
+	}
+
+	for (i = 0; i < sizeof (time_buffer); ++i) {
+		int c;
+
+		if (sf->bp + i >= sf->end)
+			goto bad_format;
+
+		c = sf->bp[i];
+
+		if ('\n' == c)
+			break;
+
+		if ('-' != c && '.' != c && !isdigit (c))
+			goto bad_format;
+
+		time_buffer[i] = c;
+	}
+
+	if (0 == i || i >= sizeof (time_buffer)
+	    || sf->bp + i + 1 >= sf->end)
+		goto bad_format;
+
+	time_buffer[i] = 0;
+	dt = strtod (time_buffer, NULL);
+
+	count = sf->bp[i + 1];
+
+	if (count > max_lines) {
+		set_errstr (sf, _("Frame at offset %" PRId64 " has "
+				  "%u lines, more than fit into the "
+				  "buffer."),
+			    _vbi_sliced_file_tell (sf), count);
+		errno = ENOSPC;
+		return FALSE;
+	}
+
+	sf->bp += i + 2;
+
+	n_sliced = 0;
+
+	for (; count > 0; --count) {
+		unsigned int index;
+		unsigned int line;
+		unsigned int n_bytes;
+
+		if (!need (sf, 3))
+			goto premature_end;
+
+		index = sf->bp[0];
+		line = sf->bp[1] + (sf->bp[2] & 15) * 256;
+
+		sf->bp += 3;
+
+		if (255 == index) {
+			unsigned int bytes_per_line;
+			unsigned int n_raw_lines;
+
+			/* Raw VBI data. We skip the sampling
+			   parameters and the samples. */
+
+			if (!need (sf, 22))
+				goto premature_end;
+
+			bytes_per_line = sf->bp[8] | (sf->bp[9] << 8);
+			n_raw_lines = ((sf->bp[16] | (sf->bp[17] << 8))
+				       + (sf->bp[18] | (sf->bp[19] << 8)));
+
+			if (!skip (sf, 22 + bytes_per_line * n_raw_lines))
+				return FALSE;
+
+			continue;
+		}
+
+		if (index >= N_ELEMENTS (old_sliced_services)
+		    || 0 == old_sliced_services[index].n_bytes) {
+			sf->bp -= 3;
+			goto bad_format;
+		}
+
+		n_bytes = old_sliced_services[index].n_bytes;
+
+		if (!need (sf, n_bytes))
+			goto premature_end;
+
+		sliced[n_sliced].id = old_sliced_services[index].id;
+		sliced[n_sliced].line = line;
+		memcpy (sliced[n_sliced].data, sf->bp, n_bytes);
+
+		sf->bp += n_bytes;
+		++n_sliced;
+	}
+
+	if (sf->seek_time_valid) {
+		sf->sample_time = sf->seek_time;
+		sf->seek_time_valid = FALSE;
+	} else {
+		/* The capture tool wrote negative deltas
+		   occasionally. */
+		sf->sample_time += fabs (dt);
+	}
+
+	*n_lines = n_sliced;
+	*sample_time = sf->sample_time;
+
+	return TRUE;
+
+ bad_format:
+	bad_format_error (sf);
+	return FALSE;
+
+ premature_end:
+	if (0 == errno) {
+		set_errstr (sf, _("Premature end of file."));
+		errno = EINVAL;
+	}
+
+	return FALSE;
+}
+
+static vbi_bool
+read_frame_pes			(_vbi_sliced_file *	sf,
+				 vbi_sliced *		sliced,
+				 unsigned int *		n_lines,
+				 unsigned int		max_lines,
+				 double *		sample_time,
+				 int64_t *		stream_time)
+{
+	const uint8_t *p;
+	unsigned int packet_size;
+	unsigned int header_size;
+	unsigned int left;
+	int64_t pts;
+
+	/* We assume each PES packet contains one frame, as
+	   vbi_dvb_mux and all known encoders do. */
+
+	if (!need (sf, 9))
+		return FALSE; /* EOF or error */
+
+	p = sf->bp;
+
+	if (0x00 != p[0] || 0x00 != p[1]
+	    || 0x01 != p[2] || 0xBD != p[3])
+		goto bad_format;
+
+	/* PES_packet_length [16] */
+	packet_size = 6 + (p[4] * 256 + p[5]);
+
+	/* PES_header_data_length [8] */
+	header_size = 9 + p[8];
+
+	/* EN 300 472 section 4.2: PES_packet_length shall not be
+	   zero, data_identifier follows the header. */
+	if (6 == packet_size || header_size + 1 > packet_size)
+		goto bad_format;
+
+	if (!need (sf, packet_size)) {
+		if (0 == errno) {
+			set_errstr (sf, _("Premature end of file."));
+			errno = EINVAL;
+		}
+		return FALSE;
+	}
+
+	p = sf->bp;
+
+	pts = -1;
+
+	/* PTS_DTS_flags [2] */
+	if ((p[7] & 0x80) && header_size >= 9 + 5) {
+		pts = (((int64_t) p[9] & 0x0E) << 29)
+			| (p[10] << 22) | ((p[11] & ~1) << 14)
+			| (p[12] << 7) | (p[13] >> 1);
+	}
+
+	/* Skip the PES header and the data_identifier. */
+	p += header_size + 1;
+	left = packet_size - (header_size + 1);
+
+	*n_lines = 0;
+
+	while (left >= 2) {
+		unsigned int n;
+
+		if (_vbi_dvb_demultiplex_sliced (sliced + *n_lines, &n,
+						 max_lines - *n_lines,
+						 &p, &left)) {
+			*n_lines += n;
+			break;
+		}
+
+		*n_lines += n;
+
+		if (*n_lines >= max_lines) {
+			set_errstr (sf, _("Frame at offset %" PRId64
+					  " has more lines than fit "
+					  "into the buffer."),
+				    _vbi_sliced_file_tell (sf));
+			errno = ENOSPC;
+			return FALSE;
+		}
+
+		/* Broken data unit. */
+		if (!_vbi_dvb_skip_data_unit (&p, &left))
+			break;
+	}
+
+	sf->bp += packet_size;
+	sf->seek_time_valid = FALSE;
+
+	*stream_time = pts;
+	*sample_time = pts * (1 / 90000.0);
+
+	return TRUE;
+
+ bad_format:
+	bad_format_error (sf);
+	return FALSE;
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ * @param sliced The sliced VBI data of the next frame will be
+ *   stored here.
+ * @param n_lines The number of lines stored in @a sliced will be
+ *   stored here.
+ * @param max_lines Size of the @a sliced array. Old sliced files
+ *   may contain up to 255 lines per frame.
+ * @param sample_time The capture time of the frame in seconds will
+ *   be stored here.
+ * @param stream_time The presentation time stamp of the frame, if
+ *   any, will be stored here. For old sliced files this is
+ *   @a sample_time converted to 90 kHz.
+ *
+ * Reads the next frame from the recording.
+ *
+ * @returns
+ * @c TRUE on success. @c FALSE at the end of the file, with errno
+ * zero, or if an error occurred. The error can be queried with
+ * _vbi_sliced_file_errstr(). If the frame does not fit into the
+ * @a sliced array errno is ENOSPC, nothing is consumed in the
+ * old sliced and compact format.
+ */
+vbi_bool
+_vbi_sliced_file_read_frame	(_vbi_sliced_file *	sf,
+				 vbi_sliced *		sliced,
+				 unsigned int *		n_lines,
+				 unsigned int		max_lines,
+				 double *		sample_time,
+				 int64_t *		stream_time)
+{
+	assert (NULL != sf);
+	assert (NULL != sliced);
+	assert (NULL != n_lines);
+	assert (NULL != sample_time);
+	assert (NULL != stream_time);
+
+	if (unlikely (sf->pending)) {
+		if (sf->pending_lines > max_lines) {
+			set_errstr (sf, _("Frame at offset %" PRId64 " has "
+					  "%u lines, more than fit into the "
+					  "buffer."),
+				    sf->pending_offset, sf->pending_lines);
+			errno = ENOSPC;
+			return FALSE;
+		}
+
+		if (sliced != sf->sliced) {
+			memcpy (sliced, sf->sliced,
+				sf->pending_lines * sizeof (*sliced));
+		}
+
+		*n_lines = sf->pending_lines;
+		*sample_time = sf->pending_time;
+		*stream_time = sf->pending_pts;
+
+		sf->pending = FALSE;
+		++sf->frame_number;
+
+		return TRUE;
+	}
+
+	switch (sf->format) {
+	case _VBI_SLICED_FILE_FORMAT_OLD_SLICED:
+		if (!read_frame_old_sliced (sf, sliced, n_lines,
+					    max_lines, sample_time))
+			return FALSE;
+		*stream_time = (int64_t)(*sample_time * 90000);
+		break;
+
+	case _VBI_SLICED_FILE_FORMAT_DVB_PES:
+		if (!read_frame_pes (sf, sliced, n_lines, max_lines,
+				     sample_time, stream_time))
+			return FALSE;
+		break;
+
+	case _VBI_SLICED_FILE_FORMAT_COMPACT:
+		if (!read_frame_compact (sf, sliced, n_lines, max_lines,
+					 sample_time, stream_time))
+			return FALSE;
+		break;
+
+	default:
+		assert (0);
+	}
+
+	++sf->frame_number;
+
+	return TRUE;
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ * @param sliced A pointer to the sliced VBI data of the next frame
+ *   will be stored here.
+ * @param n_lines The number of lines in the frame will be stored here.
+ * @param sample_time The capture time of the frame in seconds will
+ *   be stored here.
+ * @param stream_time The presentation time stamp of the frame will
+ *   be stored here.
+ *
+ * Like _vbi_sliced_file_read_frame(), but the frame is decoded
+ * directly from the file mapping into a buffer owned by the reader,
+ * which saves scanning applications a copy. The data remains valid
+ * until the next call of a _vbi_sliced_file function.
+ *
+ * @returns
+ * @c TRUE on success. @c FALSE at the end of the file, with errno
+ * zero, or if an error occurred.
+ */
+vbi_bool
+_vbi_sliced_file_get_frame	(_vbi_sliced_file *	sf,
+				 const vbi_sliced **	sliced,
+				 unsigned int *		n_lines,
+				 double *		sample_time,
+				 int64_t *		stream_time)
+{
+	assert (NULL != sf);
+	assert (NULL != sliced);
+
+	if (!_vbi_sliced_file_read_frame (sf, sf->sliced, n_lines,
+					 N_ELEMENTS (sf->sliced),
+					 sample_time, stream_time))
+		return FALSE;
+
+	*sliced = sf->sliced;
+
+	return TRUE;
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ *
+ * @returns
+ * The offset of the next frame in the file, in bytes.
+ */
+int64_t
+_vbi_sliced_file_tell		(_vbi_sliced_file *	sf)
+{
+	assert (NULL != sf);
+
+	if (unlikely (sf->pending))
+		return sf->pending_offset;
+
+	return sf->buffer_offset + (sf->bp - sf->buffer);
+}
+
+static vbi_bool
+rewind_file			(_vbi_sliced_file *	sf)
+{
+	if (!seek_to (sf, sf->data_offset))
+		return FALSE;
+
+	sf->pending = FALSE;
+	sf->block_end = 0;
+
+	sf->sample_time = 0.0;
+	sf->seek_time_valid = FALSE;
+	sf->frame_number = 0;
+
+	return TRUE;
+}
+
+static vbi_bool
+seek_frame			(_vbi_sliced_file *	sf,
+				 int64_t		offset,
+				 double			sample_time,
+				 unsigned int		frame_number)
+{
+	if (!seek_to (sf, offset))
+		return FALSE;
+
+	sf->pending = FALSE;
+
+	/* Compact format index entries point to blocks. */
+	sf->block_end = 0;
+
+	/* The old sliced format stores time differences, we take
+	   the capture time of the next frame from the index. */
+	sf->seek_time = sample_time;
+	sf->seek_time_valid = TRUE;
+
+	sf->frame_number = frame_number;
+
+	return TRUE;
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ * @param entry Entry of an index of this file, as returned by
+ *   _vbi_sliced_index_find() or _vbi_sliced_index_split().
+ *
+ * Continues reading at the frame described by @a entry. The frame
+ * is read next with the same capture time as when reading the
+ * file sequentially.
+ *
+ * @returns
+ * @c FALSE on error.
+ */
+vbi_bool
+_vbi_sliced_file_seek		(_vbi_sliced_file *	sf,
+				 const _vbi_sliced_index_entry *entry)
+{
+	assert (NULL != sf);
+	assert (NULL != entry);
+
+	return seek_frame (sf, entry->offset,
+			   entry->sample_time,
+			   entry->frame_number);
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ * @param idx Index of this file.
+ * @param sample_time Capture time in seconds.
+ *
+ * Continues reading at the first frame with a capture time greater
+ * than or equal to @a sample_time. The function looks up the
+ * closest preceding index entry with _vbi_sliced_index_find(), then
+ * reads forward. If the capture time goes backwards before
+ * @a sample_time is reached it stops at that frame.
+ *
+ * @returns
+ * @c FALSE on error.
+ */
+vbi_bool
+_vbi_sliced_file_seek_time	(_vbi_sliced_file *	sf,
+				 const _vbi_sliced_index *idx,
+				 double			sample_time)
+{
+	const _vbi_sliced_index_entry *entry;
+	double last_time;
+
+	assert (NULL != sf);
+	assert (NULL != idx);
+
+	entry = _vbi_sliced_index_find (idx, sample_time);
+	if (NULL == entry)
+		return rewind_file (sf);
+
+	if (!_vbi_sliced_file_seek (sf, entry))
+		return FALSE;
+
+	last_time = entry->sample_time;
+
+	for (;;) {
+		unsigned int frame_number;
+		unsigned int n_lines;
+		int64_t offset;
+		int64_t stream_time;
+		double t;
+
+		offset = _vbi_sliced_file_tell (sf);
+		frame_number = sf->frame_number;
+
+		if (!_vbi_sliced_file_read_frame (sf, sf->sliced, &n_lines,
+						 N_ELEMENTS (sf->sliced),
+						 &t, &stream_time))
+			return (0 == errno);
+
+		/* Stop at the end of the segment containing entry
+		   if sample_time lies beyond it. */
+		if (t >= sample_time || t < last_time) {
+			/* Frames within a compact block cannot be
+			   decoded without their predecessors, so we
+			   keep this one instead of seeking back. */
+			sf->pending = TRUE;
+			sf->pending_offset = offset;
+			sf->pending_lines = n_lines;
+			sf->pending_time = t;
+			sf->pending_pts = stream_time;
+			sf->frame_number = frame_number;
+
+			return TRUE;
+		}
+
+		last_time = t;
+	}
+}
+
+static vbi_bool
+append_entry			(_vbi_sliced_index *	idx,
+				 const _vbi_sliced_index_entry *entry)
+{
+	if (idx->n_entries >= idx->capacity) {
+		_vbi_sliced_index_entry *entries;
+		unsigned int capacity;
+
+		capacity = MAX (idx->capacity * 2, 256u);
+		entries = vbi_realloc (idx->entries,
+				       capacity * sizeof (*entries));
+		if (NULL == entries)
+			return FALSE;
+
+		idx->entries = entries;
+		idx->capacity = capacity;
+	}
+
+	idx->entries[idx->n_entries++] = *entry;
+
+	return TRUE;
+}
+
+/* Builds the idx->segments table after all entries have been
+   added. */
+static vbi_bool
+find_segments			(_vbi_sliced_index *	idx)
+{
+	unsigned int n;
+	unsigned int i;
+
+	vbi_free (idx->segments);
+	idx->segments = NULL;
+	idx->n_segments = 0;
+
+	if (0 == idx->n_entries)
+		return TRUE;
+
+	n = 1;
+	for (i = 1; i < idx->n_entries; ++i) {
+		if (idx->entries[i].sample_time
+		    < idx->entries[i - 1].sample_time)
+			++n;
+	}
+
+	idx->segments = vbi_malloc (n * sizeof (*idx->segments));
+	if (NULL == idx->segments)
+		return FALSE;
+
+	idx->segments[0] = 0;
+	n = 1;
+
+	for (i = 1; i < idx->n_entries; ++i) {
+		if (idx->entries[i].sample_time
+		    < idx->entries[i - 1].sample_time)
+			idx->segments[n++] = i;
+	}
+
+	idx->n_segments = n;
+
+	return TRUE;
+}
+
+struct cni_state {
+	unsigned int		cni;
+	unsigned int		candidate;
+};
+
+/* Returns TRUE if the CNI changed. CNIs are not error protected,
+   we accept a new one after two identical transmissions. */
+static vbi_bool
+cni_changed			(struct cni_state *	cs,
+				 unsigned int		cni)
+{
+	if (0 == cni || cni == cs->cni) {
+		cs->candidate = 0;
+		return FALSE;
+	}
+
+	if (cni != cs->candidate) {
+		cs->candidate = cni;
+		return FALSE;
+	}
+
+	cs->candidate = 0;
+
+	if (0 == cs->cni) {
+		cs->cni = cni;
+		return FALSE;
+	}
+
+	cs->cni = cni;
+
+	return TRUE;
+}
+
+static unsigned int
+frame_flags			(struct cni_state *	vps,
+				 struct cni_state *	p830,
+				 const vbi_sliced *	sliced,
+				 unsigned int		n_lines)
+{
+	unsigned int flags;
+	unsigned int i;
+
+	flags = 0;
+
+	for (i = 0; i < n_lines; ++i) {
+		unsigned int cni;
+		int mpag;
+
+		if (sliced[i].id & VBI_SLICED_VPS) {
+			vbi_decode_vps_cni (&cni, sliced[i].data);
+			if (cni_changed (vps, cni))
+				flags |= _VBI_SLICED_INDEX_CHANNEL_SWITCH;
+		} else if (sliced[i].id & VBI_SLICED_TELETEXT_B) {
+			mpag = vbi_unham16p (sliced[i].data);
+			if (mpag < 0)
+				continue;
+
+			switch ((mpag >> 3) & 31) {
+			case 0:
+				flags |= _VBI_SLICED_INDEX_PAGE_HEADER;
+				break;
+
+			case 30:
+				/* Packet 8/30 format 1. */
+				if (0 != (mpag & 7)
+				    || (vbi_unham8 (sliced[i].data[2])
+					& 0x0E) != 0)
+					break;
+
+				vbi_decode_teletext_8301_cni
+					(&cni, sliced[i].data);
+				if (cni_changed (p830, cni))
+					flags |= _VBI_SLICED_INDEX_CHANNEL_SWITCH;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	return flags;
+}
+
+/* Loads the index the writer stored at the end of a compact
+   recording. Returns FALSE with errno 0 if there is none. */
+static vbi_bool
+load_index_compact		(_vbi_sliced_file *	sf,
+				 _vbi_sliced_index *	idx)
+{
+	int64_t index_offset;
+	unsigned int n_entries;
+	unsigned int i;
+
+	if (idx->file_size < (sf->data_offset + 8
+			      + COMPACT_FOOTER_SIZE))
+		goto no_index;
+
+	if (!seek_to (sf, idx->file_size - COMPACT_FOOTER_SIZE)
+	    || !need (sf, COMPACT_FOOTER_SIZE))
+		goto failure;
+
+	if (0 != memcmp (sf->bp + 8, COMPACT_FOOTER_MAGIC, 8))
+		goto no_index;
+
+	index_offset = (int64_t) r64 (sf->bp);
+	if (index_offset < sf->data_offset
+	    || index_offset > idx->file_size - COMPACT_FOOTER_SIZE - 8)
+		goto no_index;
+
+	if (!seek_to (sf, index_offset)
+	    || !need (sf, 8))
+		goto failure;
+
+	n_entries = r32 (sf->bp + 4);
+
+	if (0 != memcmp (sf->bp, COMPACT_INDEX_MAGIC, 4)
+	    || (idx->file_size - index_offset
+		!= 8 + (int64_t) n_entries * INDEX_ENTRY_SIZE
+		+ COMPACT_FOOTER_SIZE))
+		goto no_index;
+
+	sf->bp += 8;
+
+	for (i = 0; i < n_entries; ++i) {
+		_vbi_sliced_index_entry e;
+
+		if (!need (sf, INDEX_ENTRY_SIZE))
+			goto failure;
+
+		get_index_entry (&e, sf->bp);
+		sf->bp += INDEX_ENTRY_SIZE;
+
+		if (e.offset >= index_offset
+		    || (0 == i && e.offset != sf->data_offset)
+		    || (i > 0 && e.offset
+			<= idx->entries[idx->n_entries - 1].offset)) {
+			idx->n_entries = 0;
+			goto no_index;
+		}
+
+		if (!append_entry (idx, &e)) {
+			no_mem_error (sf);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+
+ no_index:
+	errno = 0;
+	return FALSE;
+
+ failure:
+	if (0 == errno) {
+		set_errstr (sf, _("Premature end of file."));
+		errno = EINVAL;
+	}
+	return FALSE;
+}
+
+static vbi_bool
+build_index_compact		(_vbi_sliced_file *	sf,
+				 _vbi_sliced_index *	idx)
+{
+	struct stat st;
+
+	if (0 != fstat (sf->fd, &st)) {
+		io_error (sf);
+		return FALSE;
+	}
+
+	if (!S_ISREG (st.st_mode)) {
+		set_errstr (sf, _("Cannot index a pipe."));
+		errno = ESPIPE;
+		return FALSE;
+	}
+
+	idx->file_size = st.st_size;
+
+	if (load_index_compact (sf, idx))
+		return TRUE;
+	else if (0 != errno)
+		return FALSE;
+
+	/* The recording was truncated, we scan the block headers
+	   instead. */
+	if (!seek_to (sf, sf->data_offset))
+		return FALSE;
+
+	for (;;) {
+		_vbi_sliced_index_entry e;
+		unsigned int size;
+
+		e.offset = _vbi_sliced_file_tell (sf);
+
+		if (!need (sf, COMPACT_BLOCK_HEADER_SIZE)) {
+			if (0 != errno)
+				return FALSE;
+			break;
+		}
+
+		if (0 != memcmp (sf->bp, COMPACT_BLOCK_MAGIC, 4))
+			break;
+
+		size = parse_block_header (&e, sf->bp);
+
+		if (e.offset + COMPACT_BLOCK_HEADER_SIZE + size
+		    > idx->file_size)
+			break;
+
+		if (!append_entry (idx, &e)) {
+			no_mem_error (sf);
+			return FALSE;
+		}
+
+		if (!seek_to (sf, e.offset + COMPACT_BLOCK_HEADER_SIZE
+			      + size))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ * @param interval Approximate time between index entries in
+ *   seconds. Zero selects a default of one second.
+ *
+ * Reads the whole recording and builds an index of frame offsets
+ * and capture times for seeking and splitting the file into chunks
+ * which can be decoded independently.
+ *
+ * Besides the first frame and frames after a channel change, the
+ * index contains about one frame per @a interval. Frames with a
+ * Teletext page header are preferred because decoders can
+ * synchronize there.
+ *
+ * Compact recordings contain an index of their blocks which is
+ * loaded instead, @a interval is ignored then.
+ *
+ * The reader is positioned at the beginning of the file
+ * afterwards.
+ *
+ * @returns
+ * A new index which must be freed with _vbi_sliced_index_delete()
+ * when no longer needed. @c NULL on error.
+ */
+_vbi_sliced_index *
+_vbi_sliced_file_build_index	(_vbi_sliced_file *	sf,
+				 double			interval)
+{
+	_vbi_sliced_index *idx;
+	struct cni_state vps;
+	struct cni_state p830;
+	double last_entry_time;
+	double last_time;
+
+	assert (NULL != sf);
+
+	if (interval <= 0.0)
+		interval = 1.0;
+
+	idx = vbi_malloc (sizeof (*idx));
+	if (NULL == idx) {
+		no_mem_error (sf);
+		return NULL;
+	}
+
+	CLEAR (*idx);
+
+	idx->format = sf->format;
+
+	if (!rewind_file (sf))
+		goto failure;
+
+	if (_VBI_SLICED_FILE_FORMAT_COMPACT == sf->format) {
+		if (!build_index_compact (sf, idx))
+			goto failure;
+
+		if (!find_segments (idx)) {
+			no_mem_error (sf);
+			goto failure;
+		}
+
+		if (!rewind_file (sf))
+			goto failure;
+
+		return idx;
+	}
+
+	CLEAR (vps);
+	CLEAR (p830);
+
+	last_entry_time = 0.0;
+	last_time = 0.0;
+
+	for (;;) {
+		_vbi_sliced_index_entry entry;
+		unsigned int n_lines;
+
+		entry.offset = _vbi_sliced_file_tell (sf);
+		entry.frame_number = sf->frame_number;
+
+		if (!_vbi_sliced_file_read_frame (sf, sf->sliced, &n_lines,
+						 N_ELEMENTS (sf->sliced),
+						 &entry.sample_time,
+						 &entry.stream_time)) {
+			if (0 == errno)
+				break; /* EOF */
+			goto failure;
+		}
+
+		entry.flags = frame_flags (&vps, &p830,
+					   sf->sliced, n_lines);
+
+		if (0 == entry.frame_number
+		    || entry.sample_time < last_time
+		    || entry.sample_time - last_time > MAX_FRAME_GAP)
+			entry.flags |= _VBI_SLICED_INDEX_CHANNEL_SWITCH;
+
+		last_time = entry.sample_time;
+
+		if (0 == (entry.flags & _VBI_SLICED_INDEX_CHANNEL_SWITCH)) {
+			double dt = entry.sample_time - last_entry_time;
+
+			if (dt < interval)
+				continue;
+
+			/* Wait for a page header, but not forever. */
+			if (0 == (entry.flags & _VBI_SLICED_INDEX_PAGE_HEADER)
+			    && dt < interval * 2)
+				continue;
+		}
+
+		if (!append_entry (idx, &entry)) {
+			no_mem_error (sf);
+			goto failure;
+		}
+
+		last_entry_time = entry.sample_time;
+	}
+
+	idx->file_size = _vbi_sliced_file_tell (sf);
+
+	if (!find_segments (idx)) {
+		no_mem_error (sf);
+		goto failure;
+	}
+
+	if (!rewind_file (sf))
+		goto failure;
+
+	return idx;
+
+ failure:
+	_vbi_sliced_index_delete (idx);
+
+	return NULL;
+}
+
+/**
+ * @param idx Index allocated with _vbi_sliced_file_build_index() or
+ *   _vbi_sliced_file_load_index().
+ *
+ * @returns
+ * The number of entries in the index.
+ */
+unsigned int
+_vbi_sliced_index_get_n_entries	(const _vbi_sliced_index *idx)
+{
+	assert (NULL != idx);
+
+	return idx->n_entries;
+}
+
+/**
+ * @param idx Index allocated with _vbi_sliced_file_build_index() or
+ *   _vbi_sliced_file_load_index().
+ * @param n Number of the entry, zero up to
+ *   _vbi_sliced_index_get_n_entries() - 1.
+ *
+ * @returns
+ * Pointer to the entry, @c NULL if @a n is out of bounds.
+ */
+const _vbi_sliced_index_entry *
+_vbi_sliced_index_get_entry	(const _vbi_sliced_index *idx,
+				 unsigned int		n)
+{
+	assert (NULL != idx);
+
+	if (n >= idx->n_entries)
+		return NULL;
+
+	return &idx->entries[n];
+}
+
+/**
+ * @param idx Index allocated with _vbi_sliced_file_build_index() or
+ *   _vbi_sliced_file_load_index().
+ * @param sample_time Capture time in seconds.
+ *
+ * Finds the index entry with the largest capture time less than or
+ * equal to @a sample_time, the last one in the file if several
+ * qualify.
+ *
+ * Capture times can go backwards at channel switches, for example
+ * when the capture program was restarted. The index is divided into
+ * segments with non-decreasing capture times then. The function
+ * binary searches each segment starting at or before
+ * @a sample_time.
+ *
+ * @returns
+ * Pointer to the entry. The first entry if @a sample_time lies
+ * before the start of all segments, @c NULL if the index is empty.
+ */
+const _vbi_sliced_index_entry *
+_vbi_sliced_index_find		(const _vbi_sliced_index *idx,
+				 double			sample_time)
+{
+	const _vbi_sliced_index_entry *best;
+	unsigned int i;
+
+	assert (NULL != idx);
+
+	if (0 == idx->n_entries)
+		return NULL;
+
+	best = NULL;
+
+	/* There are few segments, and their start times are not
+	   sorted. */
+	for (i = 0; i < idx->n_segments; ++i) {
+		const _vbi_sliced_index_entry *e;
+		unsigned int lo;
+		unsigned int hi;
+
+		lo = idx->segments[i];
+		if (i + 1 < idx->n_segments)
+			hi = idx->segments[i + 1];
+		else
+			hi = idx->n_entries;
+
+		if (idx->entries[lo].sample_time > sample_time)
+			continue;
+
+		while (hi - lo > 1) {
+			unsigned int mid = (lo + hi) / 2;
+
+			if (idx->entries[mid].sample_time <= sample_time)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		e = &idx->entries[lo];
+		if (NULL == best || e->sample_time >= best->sample_time)
+			best = e;
+	}
+
+	if (NULL == best)
+		return &idx->entries[0];
+
+	return best;
+}
+
+/**
+ * @param idx Index allocated with _vbi_sliced_file_build_index() or
+ *   _vbi_sliced_file_load_index().
+ * @param starts The first entries of the chunks will be stored here.
+ * @param n_chunks Size of the @a starts array.
+ *
+ * Splits the indexed recording into at most @a n_chunks chunks of
+ * about equal size, starting at page headers or channel switches
+ * where possible. Chunk i extends from the offset of @a starts[i]
+ * to the offset of @a starts[i + 1], the last chunk to the end of
+ * the file. Each chunk can be read with its own _vbi_sliced_file
+ * and decoded concurrently with the others.
+ *
+ * @returns
+ * The number of chunks stored in @a starts.
+ */
+unsigned int
+_vbi_sliced_index_split		(const _vbi_sliced_index *idx,
+				 const _vbi_sliced_index_entry **starts,
+				 unsigned int		n_chunks)
+{
+	unsigned int n_starts;
+	unsigned int i;
+	unsigned int j;
+
+	assert (NULL != idx);
+	assert (NULL != starts);
+
+	if (0 == n_chunks || 0 == idx->n_entries)
+		return 0;
+
+	starts[0] = &idx->entries[0];
+	n_starts = 1;
+
+	j = 1;
+
+	for (i = 1; i < n_chunks; ++i) {
+		int64_t target;
+		unsigned int k;
+
+		target = idx->file_size * i / n_chunks;
+
+		while (j < idx->n_entries
+		       && idx->entries[j].offset < target)
+			++j;
+
+		if (j >= idx->n_entries)
+			break;
+
+		/* Prefer a synchronization point. */
+		for (k = j; k < idx->n_entries; ++k) {
+			if (0 != idx->entries[k].flags)
+				break;
+		}
+
+		if (k >= idx->n_entries)
+			k = j;
+
+		starts[n_starts++] = &idx->entries[k];
+
+		j = k + 1;
+	}
+
+	return n_starts;
+}
+
+/**
+ * @param idx Index allocated with _vbi_sliced_file_build_index().
+ * @param file_name Name of the index file, usually the name of the
+ *   recording with an added ".idx" suffix.
+ *
+ * Stores an index in a sidecar file, so it needs to be built only
+ * once. The file is overwritten if it exists.
+ *
+ * @returns
+ * @c FALSE on error, errno is set.
+ */
+vbi_bool
+_vbi_sliced_index_save		(const _vbi_sliced_index *idx,
+				 const char *		file_name)
+{
+	uint8_t *buffer;
+	uint8_t *p;
+	size_t size;
+	unsigned int i;
+	FILE *fp;
+	int saved_errno;
+
+	assert (NULL != idx);
+	assert (NULL != file_name);
+
+	size = INDEX_HEADER_SIZE + idx->n_entries * INDEX_ENTRY_SIZE;
+
+	buffer = vbi_malloc (size);
+	if (NULL == buffer) {
+		errno = ENOMEM;
+		return FALSE;
+	}
+
+	p = buffer;
+
+	memcpy (p, INDEX_MAGIC, 8);
+	w32 (p + 8, INDEX_VERSION);
+	w32 (p + 12, (unsigned int) idx->format);
+	w64 (p + 16, idx->file_size);
+	w32 (p + 24, idx->n_entries);
+	p += INDEX_HEADER_SIZE;
+
+	for (i = 0; i < idx->n_entries; ++i) {
+		put_index_entry (p, &idx->entries[i]);
+		p += INDEX_ENTRY_SIZE;
+	}
+
+	fp = fopen (file_name, "wb");
+	if (NULL == fp) {
+		saved_errno = errno;
+		vbi_free (buffer);
+		errno = saved_errno;
+		return FALSE;
+	}
+
+	if (size != fwrite (buffer, 1, size, fp)) {
+		saved_errno = errno;
+		fclose (fp);
+		vbi_free (buffer);
+		errno = saved_errno;
+		return FALSE;
+	}
+
+	vbi_free (buffer);
+
+	return (0 == fclose (fp));
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ * @param file_name Name of the index file.
+ *
+ * Loads an index stored with _vbi_sliced_index_save() and verifies
+ * it belongs to the recording read by @a sf.
+ *
+ * @returns
+ * A new index which must be freed with _vbi_sliced_index_delete()
+ * when no longer needed. @c NULL on error, in particular if the
+ * index file does not exist (errno ENOENT) or does not match the
+ * recording (errno EINVAL). The caller may build a new index with
+ * _vbi_sliced_file_build_index() then.
+ */
+_vbi_sliced_index *
+_vbi_sliced_file_load_index	(_vbi_sliced_file *	sf,
+				 const char *		file_name)
+{
+	uint8_t header[INDEX_HEADER_SIZE];
+	_vbi_sliced_index *idx;
+	struct stat st;
+	unsigned int n_entries;
+	unsigned int i;
+	FILE *fp;
+
+	assert (NULL != sf);
+	assert (NULL != file_name);
+
+	fp = fopen (file_name, "rb");
+	if (NULL == fp) {
+		set_errstr (sf, _("Cannot open '%s': %s."),
+			    file_name, strerror (errno));
+		return NULL;
+	}
+
+	idx = NULL;
+
+	if (sizeof (header) != fread (header, 1, sizeof (header), fp)
+	    || 0 != memcmp (header, INDEX_MAGIC, 8)
+	    || INDEX_VERSION != r32 (header + 8))
+		goto bad_index;
+
+	if (0 != fstat (sf->fd, &st)
+	    || (unsigned int) sf->format != r32 (header + 12)
+	    || (int64_t) st.st_size != (int64_t) r64 (header + 16))
+		goto bad_index;
+
+	n_entries = r32 (header + 24);
+
+	idx = vbi_malloc (sizeof (*idx));
+	if (NULL == idx)
+		goto no_mem;
+
+	CLEAR (*idx);
+
+	idx->format = sf->format;
+	idx->file_size = st.st_size;
+
+	if (n_entries > 0) {
+		idx->entries = vbi_malloc (n_entries
+					   * sizeof (*idx->entries));
+		if (NULL == idx->entries)
+			goto no_mem;
+
+		idx->capacity = n_entries;
+	}
+
+	for (i = 0; i < n_entries; ++i) {
+		_vbi_sliced_index_entry *e = &idx->entries[i];
+		uint8_t buffer[INDEX_ENTRY_SIZE];
+
+		if (sizeof (buffer) != fread (buffer, 1,
+					      sizeof (buffer), fp))
+			goto bad_index;
+
+		get_index_entry (e, buffer);
+
+		if (e->offset < 0 || e->offset >= idx->file_size
+		    || (i > 0 && e->offset <= e[-1].offset))
+			goto bad_index;
+
+		idx->n_entries = i + 1;
+	}
+
+	if (!find_segments (idx))
+		goto no_mem;
+
+	fclose (fp);
+
+	return idx;
+
+ no_mem:
+	fclose (fp);
+	_vbi_sliced_index_delete (idx);
+	no_mem_error (sf);
+	return NULL;
+
+ bad_index:
+	fclose (fp);
+	_vbi_sliced_index_delete (idx);
+	set_errstr (sf, _("Index file '%s' does not match "
+			  "the recording."), file_name);
+	errno = EINVAL;
+	return NULL;
+}
+
+/**
+ * @param idx Index allocated with _vbi_sliced_file_build_index() or
+ *   _vbi_sliced_file_load_index(), can be @c NULL.
+ *
+ * Frees all resources associated with @a idx.
+ */
+void
+_vbi_sliced_index_delete	(_vbi_sliced_index *	idx)
+{
+	if (NULL == idx)
+		return;
+
+	vbi_free (idx->segments);
+	vbi_free (idx->entries);
+
+	CLEAR (*idx);
+
+	vbi_free (idx);
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ *
+ * @returns
+ * The format of the recording.
+ */
+_vbi_sliced_file_format
+_vbi_sliced_file_get_format	(_vbi_sliced_file *	sf)
+{
+	assert (NULL != sf);
+
+	return sf->format;
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open().
+ *
+ * @returns
+ * A description of the last error, or @c NULL. The string is valid
+ * until the next call of a _vbi_sliced_file function.
+ */
+const char *
+_vbi_sliced_file_errstr		(_vbi_sliced_file *	sf)
+{
+	assert (NULL != sf);
+
+	return sf->errstr;
+}
+
+/**
+ * @param sf Recording reader allocated with _vbi_sliced_file_open(),
+ *   can be @c NULL.
+ *
+ * Closes the file and frees all resources associated with @a sf.
+ */
+void
+_vbi_sliced_file_delete		(_vbi_sliced_file *	sf)
+{
+	if (NULL == sf)
+		return;
+
+	if (0 != sf->map_size)
+		munmap (sf->buffer, sf->map_size);
+	else
+		vbi_free (sf->buffer);
+
+	if (sf->close_fd)
+		close (sf->fd);
+
+	vbi_free (sf->dict);
+	vbi_free (sf->errstr);
+
+	CLEAR (*sf);
+
+	vbi_free (sf);
+}
+
+static _vbi_sliced_file_format
+detect_format			(_vbi_sliced_file *	sf)
+{
+	const uint8_t *s;
+	unsigned int i;
+
+	if (!need (sf, 8))
+		return _VBI_SLICED_FILE_FORMAT_UNKNOWN;
+
+	s = sf->bp;
+
+	if (0 == memcmp (s, COMPACT_MAGIC, 8))
+		return _VBI_SLICED_FILE_FORMAT_COMPACT;
+
+	if ('0' == s[0] && '.' == s[1]) {
+		for (i = 2; i < 8; ++i) {
+			if (!isdigit (s[i]))
+				break;
+		}
+
+		if (8 == i)
+			return _VBI_SLICED_FILE_FORMAT_OLD_SLICED;
+	}
+
+	/* Works only if the packets are aligned. */
+	if (0x00 == s[0] && 0x00 == s[1]
+	    && 0x01 == s[2] && 0xBD == s[3])
+		return _VBI_SLICED_FILE_FORMAT_DVB_PES;
+
+	return _VBI_SLICED_FILE_FORMAT_UNKNOWN;
+}
+
+/* Maps a regular file into memory, so we can parse frames in place
+   without read() calls and copying. */
+static vbi_bool
+map_file			(_vbi_sliced_file *	sf)
+{
+	struct stat st;
+	void *p;
+
+	if (0 != fstat (sf->fd, &st)
+	    || !S_ISREG (st.st_mode)
+	    || st.st_size <= 0
+	    || (uint64_t) st.st_size > (size_t) -1)
+		return FALSE;
+
+	p = mmap (NULL, (size_t) st.st_size, PROT_READ,
+		  MAP_PRIVATE, sf->fd, 0);
+	if (MAP_FAILED == p)
+		return FALSE;
+
+#ifdef MADV_SEQUENTIAL
+	/* Error ignored. */
+	madvise (p, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+
+	sf->buffer = p;
+	sf->map_size = (size_t) st.st_size;
+
+	sf->bp = sf->buffer;
+	sf->end = sf->buffer + sf->map_size;
+
+	return TRUE;
+}
+
+/**
+ * @param fd File descriptor of the recording, open for reading.
+ * @param format Format of the recording,
+ *   @c _VBI_SLICED_FILE_FORMAT_UNKNOWN to detect it.
+ * @param close_fd If @c TRUE _vbi_sliced_file_delete() closes @a fd.
+ *
+ * Like _vbi_sliced_file_open(), but reads from an open file, for
+ * example standard input. If @a fd refers to a regular file, the
+ * reader maps the file into memory. Otherwise it reads through a
+ * buffer, and seeking and indexing will fail. The reader starts at
+ * the beginning of the file (or the current position, if the file
+ * cannot be mapped).
+ *
+ * @returns
+ * A new reader which must be freed with _vbi_sliced_file_delete()
+ * when done. @c NULL on error, errno is set. If the format is
+ * unknown errno is EINVAL.
+ */
+_vbi_sliced_file *
+_vbi_sliced_file_open_fd	(int			fd,
+				 _vbi_sliced_file_format format,
+				 vbi_bool		close_fd)
+{
+	_vbi_sliced_file *sf;
+	int saved_errno;
+
+	assert (-1 != fd);
+
+	sf = vbi_malloc (sizeof (*sf));
+	if (NULL == sf) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	CLEAR (*sf);
+
+	sf->fd = fd;
+	sf->close_fd = close_fd;
+
+	if (!map_file (sf)) {
+		sf->buffer = vbi_malloc (BUFFER_SIZE);
+		if (NULL == sf->buffer) {
+			saved_errno = ENOMEM;
+			goto failure;
+		}
+
+		sf->bp = sf->buffer;
+		sf->end = sf->buffer;
+	}
+
+	if (_VBI_SLICED_FILE_FORMAT_UNKNOWN == format) {
+		format = detect_format (sf);
+		if (_VBI_SLICED_FILE_FORMAT_UNKNOWN == format) {
+			saved_errno = (0 == errno) ? EINVAL : errno;
+			goto failure;
+		}
+	}
+
+	switch (format) {
+	case _VBI_SLICED_FILE_FORMAT_OLD_SLICED:
+	case _VBI_SLICED_FILE_FORMAT_DVB_PES:
+		break;
+
+	case _VBI_SLICED_FILE_FORMAT_COMPACT:
+		if (!need (sf, 8)
+		    || 0 != memcmp (sf->bp, COMPACT_MAGIC, 8)) {
+			saved_errno = (0 == errno) ? EINVAL : errno;
+			goto failure;
+		}
+
+		sf->bp += 8;
+		sf->data_offset = _vbi_sliced_file_tell (sf);
+
+		sf->dict = vbi_malloc (DICT_SIZE * sizeof (*sf->dict));
+		if (NULL == sf->dict) {
+			saved_errno = ENOMEM;
+			goto failure;
+		}
+
+		break;
+
+	default:
+		saved_errno = EINVAL;
+		goto failure;
+	}
+
+	sf->format = format;
+
+	return sf;
+
+ failure:
+	/* Caller closes fd. */
+	sf->close_fd = FALSE;
+
+	_vbi_sliced_file_delete (sf);
+
+	errno = saved_errno;
+
+	return NULL;
+}
+
+/**
+ * @param file_name Name of the recording.
+ * @param format Format of the recording,
+ *   @c _VBI_SLICED_FILE_FORMAT_UNKNOWN to detect it.
+ *
+ * Opens a sliced VBI recording for reading. The file is mapped into
+ * memory if possible.
+ *
+ * @returns
+ * A new reader which must be freed with _vbi_sliced_file_delete()
+ * when done. @c NULL on error, errno is set. If the format is
+ * unknown errno is EINVAL.
+ */
+_vbi_sliced_file *
+_vbi_sliced_file_open		(const char *		file_name,
+				 _vbi_sliced_file_format format)
+{
+	_vbi_sliced_file *sf;
+	int saved_errno;
+	int fd;
+
+	assert (NULL != file_name);
+
+	fd = open (file_name, O_RDONLY, 0);
+	if (-1 == fd)
+		return NULL;
+
+	sf = _vbi_sliced_file_open_fd (fd, format, /* close_fd */ TRUE);
+	if (NULL == sf) {
+		saved_errno = errno;
+		close (fd);
+		errno = saved_errno;
+	}
+
+	return sf;
+}
+
+struct _vbi_sliced_writer {
+	int			fd;
+	vbi_bool		close_fd;
+
+	/* The block being assembled, without header. */
+	uint8_t *		block;
+	size_t			block_size;
+	size_t			block_capacity;
+
+	/* The index entry of the block. */
+	_vbi_sliced_index_entry	block_entry;
+	unsigned int		n_block_frames;
+
+	/* Time and PTS of the previous frame, relative to the
+	   block. */
+	int64_t			prev_us;
+	int64_t			prev_pts;
+
+	/* Capture time of the previous frame. */
+	double			last_time;
+
+	/* File offset of the next block. */
+	int64_t			offset;
+
+	unsigned int		frame_number;
+	double			interval;
+
+	struct cni_state	vps;
+	struct cni_state	p830;
+
+	/* Index of the blocks written so far. */
+	_vbi_sliced_index	idx;
+
+	/* Dictionary of lines stored in this block, and a hash table
+	   mapping line contents to their serial number + 1. */
+	struct dict_entry	dict[DICT_SIZE];
+	uint32_t		hash[HASH_SIZE];
+	uint32_t		serial;
+	uint32_t		block_serial;
+
+	vbi_bool		finished;
+};
+
+static vbi_bool
+write_all			(_vbi_sliced_writer *	w,
+				 const uint8_t *	data,
+				 size_t			size)
+{
+	while (size > 0) {
+		ssize_t actual;
+
+		actual = write (w->fd, data, size);
+		if (actual < 0) {
+			if (EINTR == errno)
+				continue;
+			return FALSE;
+		}
+
+		data += actual;
+		size -= actual;
+
+		w->offset += actual;
+	}
+
+	return TRUE;
+}
+
+static vbi_bool
+flush_block			(_vbi_sliced_writer *	w)
+{
+	uint8_t header[COMPACT_BLOCK_HEADER_SIZE];
+	const _vbi_sliced_index_entry *e = &w->block_entry;
+	uint64_t t;
+
+	if (0 == w->n_block_frames)
+		return TRUE;
+
+	memcpy (&t, &e->sample_time, sizeof (t));
+
+	memcpy (header, COMPACT_BLOCK_MAGIC, 4);
+	w32 (header + 4, (uint32_t) w->block_size);
+	w32 (header + 8, w->n_block_frames);
+	w32 (header + 12, e->flags);
+	w64 (header + 16, t);
+	w64 (header + 24, e->stream_time);
+	w32 (header + 32, e->frame_number);
+
+	if (!write_all (w, header, sizeof (header))
+	    || !write_all (w, w->block, w->block_size))
+		return FALSE;
+
+	w->block_size = 0;
+	w->n_block_frames = 0;
+
+	return TRUE;
+}
+
+static void
+put_varint			(_vbi_sliced_writer *	w,
+				 uint64_t		value)
+{
+	uint8_t *p = w->block + w->block_size;
+
+	while (value >= 0x80) {
+		*p++ = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+
+	*p++ = value;
+
+	w->block_size = p - w->block;
+}
+
+static uint64_t
+zigzag				(int64_t		value)
+{
+	return ((uint64_t) value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static unsigned int
+line_hash			(vbi_service_set	id,
+				 const uint8_t *	data,
+				 unsigned int		n_bytes)
+{
+	uint32_t h;
+	unsigned int i;
+
+	/* FNV-1a. */
+	h = 2166136261u ^ id;
+
+	for (i = 0; i < n_bytes; ++i)
+		h = (h ^ data[i]) * 16777619u;
+
+	return h % HASH_SIZE;
+}
+
+static void
+put_line			(_vbi_sliced_writer *	w,
+				 const vbi_sliced *	s,
+				 unsigned int		prev_line)
+{
+	struct dict_entry *e;
+	unsigned int next_line;
+	unsigned int index;
+	unsigned int n_bytes;
+	unsigned int h;
+	uint32_t dist;
+
+	h = 0;
+
+	next_line = (s->line == prev_line + 1) ? TAG_NEXT_LINE : 0;
+
+	for (index = 0; index < N_ELEMENTS (old_sliced_services); ++index)
+		if (0 != old_sliced_services[index].n_bytes
+		    && s->id == old_sliced_services[index].id)
+			break;
+
+	if (index < N_ELEMENTS (old_sliced_services)) {
+		n_bytes = old_sliced_services[index].n_bytes;
+	} else {
+		index = TAG_OTHER_SERVICE;
+		n_bytes = sizeof (s->data);
+	}
+
+	if (n_bytes >= DICT_MIN_BYTES) {
+		h = line_hash (s->id, s->data, n_bytes);
+
+		if (0 != w->hash[h]) {
+			dist = w->serial - (w->hash[h] - 1);
+			e = &w->dict[(w->hash[h] - 1) % DICT_SIZE];
+
+			if (dist > 0 && dist <= DICT_SIZE
+			    && dist <= w->serial - w->block_serial
+			    && e->id == s->id
+			    && 0 == memcmp (e->data, s->data, n_bytes)) {
+				w->block[w->block_size++] =
+					TAG_REF | next_line;
+				if (!next_line)
+					put_varint (w, s->line);
+				put_varint (w, dist);
+				goto enter;
+			}
+		}
+	}
+
+	w->block[w->block_size++] = index | next_line;
+	if (!next_line)
+		put_varint (w, s->line);
+	if (TAG_OTHER_SERVICE == index)
+		put_varint (w, s->id);
+
+	memcpy (w->block + w->block_size, s->data, n_bytes);
+	w->block_size += n_bytes;
+
+	if (n_bytes < DICT_MIN_BYTES)
+		return;
+
+ enter:
+	/* Like the reader we enter references too. */
+	e = &w->dict[w->serial % DICT_SIZE];
+	e->id = s->id;
+	e->n_bytes = n_bytes;
+	memcpy (e->data, s->data, n_bytes);
+
+	w->hash[h] = ++w->serial;
+}
+
+static vbi_bool
+is_null_caption			(const vbi_sliced *	s)
+{
+	/* Two NUL characters with odd parity. */
+	return (0 != (s->id & (VBI_SLICED_CAPTION_525
+			       | VBI_SLICED_CAPTION_625))
+		&& 0x80 == s->data[0] && 0x80 == s->data[1]);
+}
+
+/**
+ * @param w Recording writer allocated with _vbi_sliced_writer_new().
+ * @param sliced Sliced VBI data of the frame.
+ * @param n_lines Number of lines in the @a sliced array,
+ *   at most 255.
+ * @param sample_time Capture time of the frame in seconds.
+ *   The compact format stores the time with microsecond
+ *   resolution relative to the start of the block.
+ * @param stream_time Presentation time stamp of the frame, 90 kHz.
+ *
+ * Adds a frame to the compact recording. Caption lines containing
+ * only NUL characters carry no information and are not stored.
+ *
+ * @returns
+ * @c FALSE on error, errno is set.
+ */
+vbi_bool
+_vbi_sliced_writer_write_frame	(_vbi_sliced_writer *	w,
+				 const vbi_sliced *	sliced,
+				 unsigned int		n_lines,
+				 double			sample_time,
+				 int64_t		stream_time)
+{
+	unsigned int flags;
+	unsigned int count;
+	unsigned int prev_line;
+	unsigned int i;
+	int64_t us;
+
+	assert (NULL != w);
+	assert (NULL != sliced);
+
+	if (n_lines > 255 || w->finished) {
+		errno = EINVAL;
+		return FALSE;
+	}
+
+	flags = frame_flags (&w->vps, &w->p830, sliced, n_lines);
+
+	if (0 == w->frame_number
+	    || sample_time < w->last_time
+	    || sample_time - w->last_time > MAX_FRAME_GAP)
+		flags |= _VBI_SLICED_INDEX_CHANNEL_SWITCH;
+
+	w->last_time = sample_time;
+
+	/* Start a new block at a channel switch, and about once per
+	   interval, preferably at a Teletext page header. */
+	if (0 == w->n_block_frames
+	    || (flags & _VBI_SLICED_INDEX_CHANNEL_SWITCH)
+	    || w->block_size >= COMPACT_MAX_BLOCK_SIZE
+	    || (sample_time - w->block_entry.sample_time >= w->interval
+		&& ((flags & _VBI_SLICED_INDEX_PAGE_HEADER)
+		    || (sample_time - w->block_entry.sample_time
+			>= w->interval * 2)))) {
+		if (!flush_block (w))
+			return FALSE;
+
+		w->block_entry.offset = w->offset;
+		w->block_entry.sample_time = sample_time;
+		w->block_entry.stream_time = stream_time;
+		w->block_entry.frame_number = w->frame_number;
+		w->block_entry.flags = flags;
+
+		if (!append_entry (&w->idx, &w->block_entry)) {
+			errno = ENOMEM;
+			return FALSE;
+		}
+
+		w->prev_us = 0;
+		w->prev_pts = stream_time;
+		w->block_serial = w->serial;
+	}
+
+	/* Largest encoded frame: three 64 bit varints, then tag,
+	   line number, service ID and payload of each line. */
+	if (w->block_capacity - w->block_size < 3 * 10 + 255 * 72) {
+		size_t capacity;
+		uint8_t *block;
+
+		capacity = w->block_capacity + 3 * 10 + 255 * 72;
+		capacity = MAX (capacity, (size_t) COMPACT_MAX_BLOCK_SIZE / 4);
+		capacity = MAX (capacity, w->block_capacity * 2);
+
+		block = vbi_realloc (w->block, capacity);
+		if (NULL == block) {
+			errno = ENOMEM;
+			return FALSE;
+		}
+
+		w->block = block;
+		w->block_capacity = capacity;
+	}
+
+	count = 0;
+	for (i = 0; i < n_lines; ++i)
+		count += !is_null_caption (&sliced[i]);
+
+	us = llrint ((sample_time - w->block_entry.sample_time) * 1e6);
+
+	put_varint (w, zigzag (us - w->prev_us));
+	put_varint (w, zigzag (stream_time - w->prev_pts));
+	put_varint (w, count);
+
+	w->prev_us = us;
+	w->prev_pts = stream_time;
+
+	prev_line = 0;
+
+	for (i = 0; i < n_lines; ++i) {
+		if (is_null_caption (&sliced[i]))
+			continue;
+
+		put_line (w, &sliced[i], prev_line);
+		prev_line = sliced[i].line;
+	}
+
+	++w->n_block_frames;
+	++w->frame_number;
+
+	return TRUE;
+}
+
+/**
+ * @param w Recording writer allocated with _vbi_sliced_writer_new().
+ * @param interval Approximate time between blocks in seconds,
+ *   the default is one second.
+ *
+ * Blocks are the units of seeking and splitting a compact
+ * recording. Shorter blocks permit more precise seeking, longer
+ * blocks compress better because lines repeated within a block
+ * are stored only once.
+ */
+void
+_vbi_sliced_writer_set_block_interval
+				(_vbi_sliced_writer *	w,
+				 double			interval)
+{
+	assert (NULL != w);
+
+	w->interval = (interval > 0.0) ? interval : 1.0;
+}
+
+/**
+ * @param w Recording writer allocated with _vbi_sliced_writer_new().
+ *
+ * Writes the last block and the index of the blocks. No frames
+ * can be added afterwards.
+ *
+ * @returns
+ * @c FALSE on error, errno is set.
+ */
+vbi_bool
+_vbi_sliced_writer_finish	(_vbi_sliced_writer *	w)
+{
+	uint8_t buffer[INDEX_ENTRY_SIZE];
+	int64_t index_offset;
+	unsigned int i;
+
+	assert (NULL != w);
+
+	if (w->finished)
+		return TRUE;
+
+	w->finished = TRUE;
+
+	if (!flush_block (w))
+		return FALSE;
+
+	index_offset = w->offset;
+
+	memcpy (buffer, COMPACT_INDEX_MAGIC, 4);
+	w32 (buffer + 4, w->idx.n_entries);
+
+	if (!write_all (w, buffer, 8))
+		return FALSE;
+
+	for (i = 0; i < w->idx.n_entries; ++i) {
+		put_index_entry (buffer, &w->idx.entries[i]);
+		if (!write_all (w, buffer, INDEX_ENTRY_SIZE))
+			return FALSE;
+	}
+
+	w64 (buffer, index_offset);
+	memcpy (buffer + 8, COMPACT_FOOTER_MAGIC, 8);
+
+	return write_all (w, buffer, COMPACT_FOOTER_SIZE);
+}
+
+/**
+ * @param w Recording writer allocated with _vbi_sliced_writer_new(),
+ *   can be @c NULL.
+ *
+ * Finishes the recording if _vbi_sliced_writer_finish() was not
+ * called, ignoring errors, and frees all resources associated
+ * with @a w.
+ */
+void
+_vbi_sliced_writer_delete	(_vbi_sliced_writer *	w)
+{
+	if (NULL == w)
+		return;
+
+	_vbi_sliced_writer_finish (w);
+
+	if (w->close_fd)
+		close (w->fd);
+
+	vbi_free (w->block);
+	vbi_free (w->idx.entries);
+
+	CLEAR (*w);
+
+	vbi_free (w);
+}
+
+/**
+ * @param fd File descriptor open for writing. Need not be
+ *   seekable.
+ * @param close_fd If @c TRUE _vbi_sliced_writer_delete() closes @a fd.
+ *
+ * Like _vbi_sliced_writer_new(), but writes to an open file.
+ *
+ * @returns
+ * A new writer which must be freed with _vbi_sliced_writer_delete()
+ * when done. @c NULL on error, errno is set.
+ */
+_vbi_sliced_writer *
+_vbi_sliced_writer_new_fd	(int			fd,
+				 vbi_bool		close_fd)
+{
+	_vbi_sliced_writer *w;
+
+	assert (-1 != fd);
+
+	w = vbi_malloc (sizeof (*w));
+	if (NULL == w) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	CLEAR (*w);
+
+	w->fd = fd;
+	w->close_fd = close_fd;
+	w->interval = 1.0;
+	w->idx.format = _VBI_SLICED_FILE_FORMAT_COMPACT;
+
+	if (!write_all (w, (const uint8_t *) COMPACT_MAGIC, 8)) {
+		int saved_errno = errno;
+
+		/* Caller closes fd. */
+		w->close_fd = FALSE;
+		w->finished = TRUE;
+		_vbi_sliced_writer_delete (w);
+		errno = saved_errno;
+		return NULL;
+	}
+
+	return w;
+}
+
+/**
+ * @param file_name Name of the recording. The file is overwritten
+ *   if it exists.
+ *
+ * Creates a sliced VBI recording in the compact format. This format
+ * stores frames in blocks which can be decoded independently. Lines
+ * repeated within a block, as Teletext pages are, are stored as
+ * references to the earlier copy, and capture times as differences.
+ * An index of the blocks at the end of the file permits seeking and
+ * splitting without reading the whole recording.
+ *
+ * @returns
+ * A new writer which must be freed with _vbi_sliced_writer_delete()
+ * when done. @c NULL on error, errno is set.
+ */
+_vbi_sliced_writer *
+_vbi_sliced_writer_new		(const char *		file_name)
+{
+	_vbi_sliced_writer *w;
+	int saved_errno;
+	int fd;
+
+	assert (NULL != file_name);
+
+	fd = open (file_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (-1 == fd)
+		return NULL;
+
+	w = _vbi_sliced_writer_new_fd (fd, /* close_fd */ TRUE);
+	if (NULL == w) {
+		saved_errno = errno;
+		close (fd);
+		errno = saved_errno;
+	}
+
+	return w;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
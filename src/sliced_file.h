@@ -0,0 +1,208 @@
+/*
+ *  libzvbi - Sliced VBI recording reader, writer and index
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* This code is experimental and not yet part of the library API. */
+
+#ifndef __ZVBI_SLICED_FILE_H__
+#define __ZVBI_SLICED_FILE_H__
+
+#include "macros.h"
+#include "sliced.h"		/* vbi_sliced */
+
+VBI_BEGIN_DECLS
+
+/** First eight bytes of a _VBI_SLICED_FILE_FORMAT_COMPACT file. */
+#define _VBI_SLICED_FILE_COMPACT_MAGIC "ZVBICSF1"
+
+/** Recording file formats. */
+typedef enum {
+	_VBI_SLICED_FILE_FORMAT_UNKNOWN = 0,
+
+	/**
+	 * The "old sliced" format written by the test/capture tool
+	 * with the --sliced option. Raw VBI data in the file is
+	 * skipped.
+	 */
+	_VBI_SLICED_FILE_FORMAT_OLD_SLICED,
+
+	/**
+	 * MPEG-2 PES packets with VBI data as defined in EN 301 775,
+	 * starting at a packet boundary.
+	 */
+	_VBI_SLICED_FILE_FORMAT_DVB_PES,
+
+	/**
+	 * Compact binary format written by _vbi_sliced_writer, with
+	 * an index of independently decodable blocks.
+	 */
+	_VBI_SLICED_FILE_FORMAT_COMPACT
+} _vbi_sliced_file_format;
+
+/** Properties of an index entry. */
+typedef enum {
+	/**
+	 * The frame contains a Teletext page header. A Teletext
+	 * decoder starting here can synchronize without prior state.
+	 */
+	_VBI_SLICED_INDEX_PAGE_HEADER		= (1 << 0),
+
+	/**
+	 * The frame follows a channel change: it is the first frame
+	 * in the file, the network ID transmitted in VPS or Teletext
+	 * packet 8/30 changed, or the capture time jumped. Decoder
+	 * state from earlier frames is invalid here.
+	 */
+	_VBI_SLICED_INDEX_CHANNEL_SWITCH	= (1 << 1)
+} _vbi_sliced_index_flags;
+
+/** An entry in a _vbi_sliced_index. */
+typedef struct {
+	/** Offset of the frame in the recording, in bytes. */
+	int64_t			offset;
+
+	/** Capture time of the frame in seconds. */
+	double			sample_time;
+
+	/** Presentation time stamp of the frame, 90 kHz. */
+	int64_t			stream_time;
+
+	/** Number of the frame, counting from zero. */
+	unsigned int		frame_number;
+
+	/** A set of _vbi_sliced_index_flags. */
+	unsigned int		flags;
+} _vbi_sliced_index_entry;
+
+typedef struct _vbi_sliced_index _vbi_sliced_index;
+
+extern unsigned int
+_vbi_sliced_index_get_n_entries	(const _vbi_sliced_index *idx)
+  _vbi_nonnull ((1));
+extern const _vbi_sliced_index_entry *
+_vbi_sliced_index_get_entry	(const _vbi_sliced_index *idx,
+				 unsigned int		n)
+  _vbi_nonnull ((1));
+extern const _vbi_sliced_index_entry *
+_vbi_sliced_index_find		(const _vbi_sliced_index *idx,
+				 double			sample_time)
+  _vbi_nonnull ((1));
+extern unsigned int
+_vbi_sliced_index_split		(const _vbi_sliced_index *idx,
+				 const _vbi_sliced_index_entry **starts,
+				 unsigned int		n_chunks)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+_vbi_sliced_index_save		(const _vbi_sliced_index *idx,
+				 const char *		file_name)
+  _vbi_nonnull ((1, 2));
+extern void
+_vbi_sliced_index_delete	(_vbi_sliced_index *	idx);
+
+typedef struct _vbi_sliced_file _vbi_sliced_file;
+
+extern vbi_bool
+_vbi_sliced_file_read_frame	(_vbi_sliced_file *	sf,
+				 vbi_sliced *		sliced,
+				 unsigned int *		n_lines,
+				 unsigned int		max_lines,
+				 double *		sample_time,
+				 int64_t *		stream_time)
+  _vbi_nonnull ((1, 2, 3, 5, 6));
+extern vbi_bool
+_vbi_sliced_file_get_frame	(_vbi_sliced_file *	sf,
+				 const vbi_sliced **	sliced,
+				 unsigned int *		n_lines,
+				 double *		sample_time,
+				 int64_t *		stream_time)
+  _vbi_nonnull ((1, 2, 3, 4, 5));
+extern int64_t
+_vbi_sliced_file_tell		(_vbi_sliced_file *	sf)
+  _vbi_nonnull ((1));
+extern vbi_bool
+_vbi_sliced_file_seek		(_vbi_sliced_file *	sf,
+				 const _vbi_sliced_index_entry *entry)
+  _vbi_nonnull ((1, 2));
+extern vbi_bool
+_vbi_sliced_file_seek_time	(_vbi_sliced_file *	sf,
+				 const _vbi_sliced_index *idx,
+				 double			sample_time)
+  _vbi_nonnull ((1, 2));
+extern _vbi_sliced_index *
+_vbi_sliced_file_build_index	(_vbi_sliced_file *	sf,
+				 double			interval)
+  _vbi_nonnull ((1));
+extern _vbi_sliced_index *
+_vbi_sliced_file_load_index	(_vbi_sliced_file *	sf,
+				 const char *		file_name)
+  _vbi_nonnull ((1, 2));
+extern _vbi_sliced_file_format
+_vbi_sliced_file_get_format	(_vbi_sliced_file *	sf)
+  _vbi_nonnull ((1));
+extern const char *
+_vbi_sliced_file_errstr		(_vbi_sliced_file *	sf)
+  _vbi_nonnull ((1));
+extern void
+_vbi_sliced_file_delete		(_vbi_sliced_file *	sf);
+extern _vbi_sliced_file *
+_vbi_sliced_file_open_fd	(int			fd,
+				 _vbi_sliced_file_format format,
+				 vbi_bool		close_fd);
+extern _vbi_sliced_file *
+_vbi_sliced_file_open		(const char *		file_name,
+				 _vbi_sliced_file_format format)
+  _vbi_nonnull ((1));
+
+typedef struct _vbi_sliced_writer _vbi_sliced_writer;
+
+extern vbi_bool
+_vbi_sliced_writer_write_frame	(_vbi_sliced_writer *	w,
+				 const vbi_sliced *	sliced,
+				 unsigned int		n_lines,
+				 double			sample_time,
+				 int64_t		stream_time)
+  _vbi_nonnull ((1, 2));
+extern void
+_vbi_sliced_writer_set_block_interval
+				(_vbi_sliced_writer *	w,
+				 double			interval)
+  _vbi_nonnull ((1));
+extern vbi_bool
+_vbi_sliced_writer_finish	(_vbi_sliced_writer *	w)
+  _vbi_nonnull ((1));
+extern void
+_vbi_sliced_writer_delete	(_vbi_sliced_writer *	w);
+extern _vbi_sliced_writer *
+_vbi_sliced_writer_new_fd	(int			fd,
+				 vbi_bool		close_fd);
+extern _vbi_sliced_writer *
+_vbi_sliced_writer_new		(const char *		file_name)
+  _vbi_nonnull ((1));
+
+VBI_END_DECLS
+
+#endif /* __ZVBI_SLICED_FILE_H__ */
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -412,6 +412,8 @@ current_time(void)
  * starts a resynchronization cycle, eventually a channel switch may be assumed
  * which resets even more decoder state. So even if a frame did not contain
  * any useful data this function must be called, with @a lines set to zero.
+ * If the capture driver counts frames vbi_decode_frame() detects
+ * dropped frames more reliably.
  * 
  * @note This is one of the few not reentrant libzvbi functions. If multiple
  * threads call this with the same @a vbi context you must implement your
@@ -420,11 +422,51 @@ current_time(void)
 void
 vbi_decode(vbi_decoder *vbi, vbi_sliced *sliced, int lines, double time)
 {
+	vbi_decode_frame(vbi, sliced, lines, time, /* sequence */ -1);
+}
+
+/**
+ * @param vbi Initialized vbi decoding context as returned by vbi_decoder_new().
+ * @param sliced Array of vbi_sliced data packets to be decoded.
+ * @param lines Number of vbi_sliced data packets, i. e. VBI lines.
+ * @param time Timestamp associated with <em>all</em> sliced data packets,
+ *   as in vbi_decode().
+ * @param sequence Frame counter, for example from the @a sequence
+ *   field of a vbi_capture_buffer, or -1 if unknown.
+ *
+ * @brief Decodes one frame, detecting dropped frames by a frame counter.
+ *
+ * Like vbi_decode(), but when @a sequence and the counter of the
+ * previous frame are not negative the decoder assumes frames were
+ * dropped if and only if @a sequence did not advance by one. Jumps of
+ * the system time, for instance when NTP sets the clock, then no
+ * longer start a resynchronization cycle or even a channel switch.
+ * When the counter is unknown the function checks the @a time
+ * difference like vbi_decode().
+ *
+ * @note This is one of the few not reentrant libzvbi functions. If multiple
+ * threads call this with the same @a vbi context you must implement your
+ * own locking mechanism. Never call this function from an event handler.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_decode_frame(vbi_decoder *vbi, vbi_sliced *sliced, int lines,
+		 double time, int64_t sequence)
+{
+	vbi_bool dropped;
 	double d;
 
 	d = time - vbi->time;
 
-	if (vbi->time > 0 && (d < 0.025 || d > 0.050)) {
+	if (sequence >= 0 && vbi->sequence >= 0)
+		dropped = (sequence - vbi->sequence != 1);
+	else
+		dropped = (vbi->time > 0 && (d < 0.025 || d > 0.050));
+
+	vbi->sequence = sequence;
+
+	if (dropped) {
 	  /*
 	   *  Since (dropped >= channel switch) we give
 	   *  ~1.5 s, then assume a switch.
@@ -892,6 +934,7 @@ vbi_decoder_new(void)
 	pthread_mutex_init(&vbi->prog_info_mutex, NULL);
 
 	vbi->time = 0.0;
+	vbi->sequence = -1;
 
 	vbi->brightness	= 128;
 	vbi->contrast	= 64;
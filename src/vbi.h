@@ -47,6 +47,7 @@ struct event_handler {
 
 struct vbi_decoder {
 	double			time;
+	int64_t			sequence;
 
 	pthread_mutex_t		chswcd_mutex;
         int                     chswcd;
@@ -178,6 +179,9 @@ extern vbi_decoder *	vbi_decoder_new(void);
 extern void		vbi_decoder_delete(vbi_decoder *vbi);
 extern void		vbi_decode(vbi_decoder *vbi, vbi_sliced *sliced,
 				   int lines, double timestamp);
+extern void		vbi_decode_frame(vbi_decoder *vbi, vbi_sliced *sliced,
+					 int lines, double timestamp,
+					 int64_t sequence);
 extern void             vbi_channel_switched(vbi_decoder *vbi, vbi_nuid nuid);
 extern vbi_page_type	vbi_classify_page(vbi_decoder *vbi, vbi_pgno pgno,
 					  vbi_subno *subno, char **language);
@@ -808,6 +808,17 @@ _vbi_xds_packet_dump		(const vbi_xds_packet *	xp,
 	fputc ('\n', fp);
 }
 
+static void
+forget_last_packets		(vbi_xds_demux *	xd)
+{
+	unsigned int i;
+	unsigned int j;
+
+	for (i = 0; i < N_ELEMENTS (xd->subpacket); ++i)
+		for (j = 0; j < N_ELEMENTS (xd->subpacket[0]); ++j)
+			xd->subpacket[i][j].last.buffer_size = 0;
+}
+
 /**
  * @param xd XDS demultiplexer context allocated with vbi_xds_demux_new().
  *
@@ -828,9 +839,59 @@ vbi_xds_demux_reset		(vbi_xds_demux *	xd)
 	for (i = 0; i < n; ++i)
 		xd->subpacket[0][i].count = 0;
 
+	forget_last_packets (xd);
+
 	xd->curr_sp = NULL;
 }
 
+/**
+ * @param xd XDS demultiplexer context allocated with vbi_xds_demux_new().
+ *
+ * @returns
+ * The current set of vbi_xds_demux_flags.
+ *
+ * @since 0.2.36
+ */
+unsigned int
+vbi_xds_demux_get_flags		(vbi_xds_demux *	xd)
+{
+	assert (NULL != xd);
+
+	return xd->flags;
+}
+
+/**
+ * @param xd XDS demultiplexer context allocated with vbi_xds_demux_new().
+ * @param flags A set of vbi_xds_demux_flags.
+ *
+ * Changes the operating mode of the XDS demux. With
+ * @c VBI_XDS_DEMUX_CHANGES_ONLY the demux passes a packet to the
+ * callback function only when its contents changed. Repeated packets
+ * still pass the parity and checksum tests, but the callback function
+ * is not called. To compare packets the demux keeps a copy of the
+ * last packet delivered for each class and subclass. This copy is
+ * passed to the callback function, it remains valid until the next
+ * changed packet of the same class and subclass arrives or the demux
+ * is reset.
+ *
+ * Enabling or disabling the mode forgets all packets received
+ * earlier, so the next packet of each class and subclass will be
+ * delivered.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_xds_demux_set_flags		(vbi_xds_demux *	xd,
+				 unsigned int		flags)
+{
+	assert (NULL != xd);
+
+	if ((flags ^ xd->flags) & VBI_XDS_DEMUX_CHANGES_ONLY)
+		forget_last_packets (xd);
+
+	xd->flags = flags;
+}
+
 /**
  * @param xd XDS demultiplexer context allocated with vbi_xds_demux_new().
  * @param buffer Closed Caption character pair, as in struct vbi_sliced.
@@ -951,6 +1012,32 @@ vbi_xds_demux_feed		(vbi_xds_demux *	xd,
 		} else if (sp->count <= 2) {
 			log ("XDS ignore empty packet 0x%x/0x%02x\n",
 			     xd->curr.xds_class, xd->curr.xds_subclass);
+		} else if (xd->flags & VBI_XDS_DEMUX_CHANGES_ONLY) {
+			vbi_xds_packet *xp;
+			unsigned int size;
+
+			/* Deliver the packet only if it differs from
+			   the copy of the one delivered before. */
+			xp = &sp->last;
+			size = sp->count - 2;
+
+			if (size == xp->buffer_size
+			    && 0 == memcmp (xp->buffer, sp->buffer, size)) {
+				log ("XDS packet 0x%x/0x%02x unchanged\n",
+				     xd->curr.xds_class,
+				     xd->curr.xds_subclass);
+			} else {
+				xp->xds_class = xd->curr.xds_class;
+				xp->xds_subclass = xd->curr.xds_subclass;
+				xp->buffer_size = size;
+				memcpy (xp->buffer, sp->buffer, size);
+				xp->buffer[size] = 0;
+
+				if (XDS_DEMUX_LOG)
+					_vbi_xds_packet_dump (xp, stderr);
+
+				r = xd->callback (xd, xp, xd->user_data);
+			}
 		} else {
 			memcpy (xd->curr.buffer, sp->buffer, 32);
 
@@ -1096,6 +1183,8 @@ _vbi_xds_demux_init		(vbi_xds_demux *	xd,
 
 	vbi_xds_demux_reset (xd);
 
+	xd->flags = 0;
+
 	xd->callback = callback;
 	xd->user_data = user_data;
 
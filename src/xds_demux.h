@@ -186,6 +186,26 @@ vbi_xds_demux_cb		(vbi_xds_demux *	xd,
 				 const vbi_xds_packet *	xp,
 				 void *			user_data);
 
+/**
+ * @brief XDS demultiplexer flags.
+ * @since 0.2.36
+ */
+typedef enum {
+	/**
+	 * Call the callback function only when the contents of a
+	 * packet differ from those of the packet of the same class
+	 * and subclass received before, for example when the
+	 * program name or rating changes. Repeated packets are
+	 * validated and discarded.
+	 */
+	VBI_XDS_DEMUX_CHANGES_ONLY = (1 << 0)
+} vbi_xds_demux_flags;
+
+extern void
+vbi_xds_demux_set_flags		(vbi_xds_demux *	xd,
+				 unsigned int		flags);
+extern unsigned int
+vbi_xds_demux_get_flags		(vbi_xds_demux *	xd);
 extern void
 vbi_xds_demux_reset		(vbi_xds_demux *	xd);
 extern vbi_bool
@@ -213,6 +233,10 @@ typedef struct {
 	uint8_t			buffer[32];
 	unsigned int		count;
 	unsigned int		checksum;
+
+	/* Last packet delivered in VBI_XDS_DEMUX_CHANGES_ONLY mode,
+	   buffer_size zero if none. */
+	vbi_xds_packet		last;
 } _vbi_xds_subpacket;
 
 /**
@@ -227,6 +251,9 @@ struct _vbi_xds_demux {
 
 	vbi_xds_demux_cb *	callback;
 	void *			user_data;
+
+	/* vbi_xds_demux_flags. */
+	unsigned int		flags;
 };
 
 extern void
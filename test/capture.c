@@ -447,6 +447,7 @@ Device options:\n\
 -x | --proxy           Capture through the VBI proxy daemon\n\
 Output options:\n\
 -j | --dump            Sliced VBI data (text)\n\
+-k | --compact         Sliced VBI data (compact binary with index)\n\
 -l | --sliced          Sliced VBI data (binary)\n\
 -o | --output name     Write the VBI data to this file instead of\n\
                        standard output\n"
@@ -460,7 +461,7 @@ Output options:\n\
 		 option_dev_name);
 }
 
-static const char short_options[] = "c:d:hi:jlmno:pqr:suvwxPT:V";
+static const char short_options[] = "c:d:hi:jklmno:pqr:suvwxPT:V";
 
 #ifdef HAVE_GETOPT_LONG
 static const struct option
@@ -471,6 +472,7 @@ long_options[] = {
 	{ "usage",	no_argument,		NULL,		'h' },
 	{ "pid",	required_argument,	NULL,		'i' },
 	{ "dump",	no_argument,		NULL,		'j' },
+	{ "compact",	no_argument,		NULL,		'k' },
 	{ "sliced",	no_argument,		NULL,		'l' },
 	{ "sim-laced",	no_argument,		NULL,		'm' },
 	{ "ntsc",	no_argument,		NULL,		'n' },
@@ -647,6 +649,13 @@ main				(int			argc,
 			option_sliced_output = FALSE;
 			break;
 
+		case 'k':
+			option_sliced_output = TRUE;
+			option_dump_sliced = FALSE;
+			option_dump_wss = FALSE;
+			option_out_file_format = FILE_FORMAT_NEW_SLICED;
+			break;
+
 		case 'l':
 			option_sliced_output = TRUE;
 			option_dump_sliced = FALSE;
@@ -0,0 +1,379 @@
+/*
+ *  libzvbi -- Closed Caption decoder benchmark
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef HAVE_GETOPT_LONG
+#  include <getopt.h>
+#endif
+
+#include "sliced.h"
+
+#include "src/misc.h"
+#include "src/hamm.h"
+#include "src/cc608_decoder.h"
+
+#define PROGRAM_NAME "cc608bench"
+
+/* One byte pair as received, with parity. */
+struct pair {
+	double			capture_time;
+	unsigned int		line;
+	uint8_t			buffer[2];
+};
+
+static struct pair *		pairs;
+static unsigned int		n_pairs;
+static unsigned int		max_pairs;
+
+static unsigned int		option_repeat;
+static double			option_hours;
+static const char *		option_in_file_name;
+static enum file_format		option_in_file_format;
+static unsigned int		option_in_ts_pid;
+
+static struct pair *
+add_pair			(void)
+{
+	if (n_pairs >= max_pairs) {
+		struct pair *new_pairs;
+		unsigned int new_max;
+
+		new_max = (0 == max_pairs) ? 1 << 16 : max_pairs * 2;
+
+		new_pairs = realloc (pairs, new_max * sizeof (*pairs));
+		if (NULL == new_pairs)
+			no_mem_exit ();
+
+		pairs = new_pairs;
+		max_pairs = new_max;
+	}
+
+	return &pairs[n_pairs++];
+}
+
+static void
+put_pair			(double			capture_time,
+				 unsigned int		c1,
+				 unsigned int		c2)
+{
+	struct pair *p;
+
+	p = add_pair ();
+
+	p->capture_time = capture_time;
+	p->line = 21;
+	p->buffer[0] = vbi_par8 (c1);
+	p->buffer[1] = vbi_par8 (c2);
+}
+
+/* Roll-up captions with repeated control codes and filler, the
+   typical live captioning stream. */
+static void
+synthesize			(double			hours)
+{
+	static const char text[] =
+		"THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG, "
+		"AND 42 MORE THINGS. ";
+	unsigned int n_frames;
+	unsigned int i;
+
+	n_frames = (unsigned int)(hours * 3600 * 30000 / 1001);
+
+	i = 0;
+
+	while (i < n_frames) {
+		static const uint8_t ctrl[3][2] = {
+			{ 0x14, 0x25 },		/* RU2 */
+			{ 0x14, 0x2D },		/* CR */
+			{ 0x14, 0x70 },		/* PAC row 15 */
+		};
+		unsigned int j;
+
+		for (j = 0; j < N_ELEMENTS (ctrl); ++j) {
+			put_pair (i++ * 1001 / 30000.0,
+				  ctrl[j][0], ctrl[j][1]);
+			put_pair (i++ * 1001 / 30000.0,
+				  ctrl[j][0], ctrl[j][1]);
+		}
+
+		for (j = 0; j < 32; j += 2) {
+			put_pair (i * 1001 / 30000.0,
+				  text[(i + j) % (sizeof (text) - 1)],
+				  text[(i + j + 1) % (sizeof (text) - 1)]);
+			++i;
+		}
+
+		for (j = 0; j < 40; ++j) {
+			put_pair (i++ * 1001 / 30000.0, 0x00, 0x00);
+		}
+	}
+}
+
+static vbi_bool
+read_function			(const vbi_sliced *	sliced,
+				 unsigned int		n_lines,
+				 const uint8_t *	raw,
+				 const vbi_sampling_par *sp,
+				 double			sample_time,
+				 int64_t		stream_time)
+{
+	raw = raw; /* unused */
+	sp = sp;
+	stream_time = stream_time;
+
+	for (; n_lines > 0; ++sliced, --n_lines) {
+		struct pair *p;
+
+		if (0 == (sliced->id & VBI_SLICED_CAPTION_525))
+			continue;
+
+		p = add_pair ();
+
+		p->capture_time = sample_time;
+		p->line = sliced->line;
+		p->buffer[0] = sliced->data[0];
+		p->buffer[1] = sliced->data[1];
+	}
+
+	return TRUE;
+}
+
+static double
+now				(void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, /* tz */ NULL);
+
+	return tv.tv_sec + tv.tv_usec * (1 / 1e6);
+}
+
+static void
+benchmark			(void)
+{
+	_vbi_cc608_decoder *cd;
+	unsigned int n_errors;
+	unsigned int i;
+	double start;
+	double elapsed;
+	double total;
+
+	cd = _vbi_cc608_decoder_new ();
+	if (NULL == cd)
+		no_mem_exit ();
+
+	n_errors = 0;
+
+	start = now ();
+
+	for (i = 0; i < option_repeat; ++i) {
+		const struct pair *p;
+		const struct pair *end;
+
+		_vbi_cc608_decoder_reset (cd);
+
+		end = pairs + n_pairs;
+
+		for (p = pairs; p < end; ++p) {
+			if (!_vbi_cc608_decoder_feed (cd, p->buffer,
+						      p->line,
+						      p->capture_time,
+						      /* pts */ -1))
+				++n_errors;
+		}
+	}
+
+	elapsed = now () - start;
+
+	_vbi_cc608_decoder_delete (cd);
+	cd = NULL;
+
+	total = (double) n_pairs * option_repeat;
+
+	if (option_log_mask & VBI_LOG_NOTICE) {
+		printf ("%u byte pairs (%.1f h) x %u: %.3f s, "
+			"%.1f ns/pair, %.0f pairs/s, %u errors\n",
+			n_pairs, n_pairs * 1001 / 30000.0 / 3600,
+			option_repeat, elapsed,
+			(total > 0) ? elapsed * 1e9 / total : 0.0,
+			(elapsed > 0) ? total / elapsed : 0.0,
+			n_errors);
+	}
+}
+
+static void
+usage				(FILE *			fp)
+{
+	fprintf (fp, "\
+%s %s -- Closed Caption decoder benchmark\n\n\
+Copyright (C) 2026 agent <agent@local>\n\
+This program is licensed under GPLv2+. NO WARRANTIES.\n\n\
+Usage: %s [options] < sliced VBI data\n\
+-h | --help | --usage  Print this message and exit\n\
+-q | --quiet           Suppress progress and error messages\n\
+-v | --verbose         Increase verbosity\n\
+-V | --version         Print the program version and exit\n\
+Input options:\n\
+-i | --input name      Read the VBI data from this file instead of\n\
+                       standard input\n\
+-P | --pes             Source is a DVB PES stream\n\
+-T | --ts pid          Source is a DVB TS stream\n\
+-s | --synthetic hours Decode a generated roll-up caption stream of\n\
+                       this length instead of reading VBI data\n\
+Benchmark options:\n\
+-r | --repeat n        Decode the data n times (default 10)\n\
+",
+		 PROGRAM_NAME, VERSION, program_invocation_name);
+}
+
+static const char short_options [] = "hi:qr:s:vPT:V";
+
+#ifdef HAVE_GETOPT_LONG
+
+static const struct option
+long_options [] = {
+	{ "help",	no_argument,		NULL,		'h' },
+	{ "usage",	no_argument,		NULL,		'h' },
+	{ "input",	required_argument,	NULL,		'i' },
+	{ "quiet",	no_argument,		NULL,		'q' },
+	{ "repeat",	required_argument,	NULL,		'r' },
+	{ "synthetic",	required_argument,	NULL,		's' },
+	{ "verbose",	no_argument,		NULL,		'v' },
+	{ "pes",	no_argument,		NULL,		'P' },
+	{ "ts",		required_argument,	NULL,		'T' },
+	{ "version",	no_argument,		NULL,		'V' },
+	{ NULL, 0, 0, 0 }
+};
+
+#else
+#  define getopt_long(ac, av, s, l, i) getopt(ac, av, s)
+#endif
+
+static int			option_index;
+
+int
+main				(int			argc,
+				 char **		argv)
+{
+	init_helpers (argc, argv);
+
+	option_repeat = 10;
+	option_in_file_format = FILE_FORMAT_SLICED;
+
+	for (;;) {
+		int c;
+
+		c = getopt_long (argc, argv, short_options,
+				 long_options, &option_index);
+		if (-1 == c)
+			break;
+
+		switch (c) {
+		case 0: /* getopt_long() flag */
+			break;
+
+		case 'h':
+			usage (stdout);
+			exit (EXIT_SUCCESS);
+
+		case 'i':
+			assert (NULL != optarg);
+			option_in_file_name = optarg;
+			break;
+
+		case 'q':
+			parse_option_quiet ();
+			break;
+
+		case 'r':
+			assert (NULL != optarg);
+			option_repeat = strtoul (optarg, NULL, 0);
+			if (0 == option_repeat)
+				error_exit ("Invalid repeat count.");
+			break;
+
+		case 's':
+			assert (NULL != optarg);
+			option_hours = strtod (optarg, NULL);
+			if (option_hours <= 0 || option_hours > 1000)
+				error_exit ("Invalid stream length.");
+			break;
+
+		case 'v':
+			parse_option_verbose ();
+			break;
+
+		case 'P':
+			option_in_file_format = FILE_FORMAT_DVB_PES;
+			break;
+
+		case 'T':
+			option_in_ts_pid = parse_option_ts ();
+			option_in_file_format = FILE_FORMAT_DVB_TS;
+			break;
+
+		case 'V':
+			printf (PROGRAM_NAME " " VERSION "\n");
+			exit (EXIT_SUCCESS);
+
+		default:
+			usage (stderr);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	if (option_hours > 0) {
+		synthesize (option_hours);
+	} else {
+		struct stream *rst;
+
+		/* Read everything first so we measure only the
+		   decoder. */
+		rst = read_stream_new (option_in_file_name,
+				       option_in_file_format,
+				       option_in_ts_pid,
+				       read_function);
+
+		stream_loop (rst);
+
+		stream_delete (rst);
+		rst = NULL;
+	}
+
+	benchmark ();
+
+	free (pairs);
+	pairs = NULL;
+
+	exit (EXIT_SUCCESS);
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
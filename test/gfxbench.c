@@ -0,0 +1,221 @@
+/*
+ *  libzvbi -- Teletext and Closed Caption renderer benchmark
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+/* Measures vbi_draw_vt_page_region() and vbi_draw_cc_page_region()
+   on synthetic pages, for comparing changes to the renderer. */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "src/misc.h"
+#include "src/format.h"
+#include "src/lang.h"
+#include "src/exp-gfx.h"
+
+#define PROGRAM_NAME "gfxbench"
+
+static unsigned int		option_repeat;
+
+static vbi_page			vt_page;
+static vbi_page			cc_page;
+
+/* Large enough for both pages in RGBA32 format. */
+static uint8_t			canvas[34 * 16 * 15 * 26 * 4];
+
+static double
+now				(void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, /* tz */ NULL);
+
+	return tv.tv_sec + tv.tv_usec * (1 / 1e6);
+}
+
+/* A Teletext page with a typical mix of text, colors and double
+   height rows, and a Closed Caption page of four rows. */
+static void
+init_pages			(void)
+{
+	unsigned int i;
+
+	CLEAR (vt_page);
+
+	vt_page.pgno = 0x100;
+	vt_page.rows = 25;
+	vt_page.columns = 40;
+	vt_page.font[0] = &vbi_font_descriptors[0];
+	vt_page.font[1] = &vbi_font_descriptors[0];
+
+	for (i = 0; i < 40 * 25; ++i) {
+		vbi_char *ac = &vt_page.text[i];
+
+		ac->unicode = 0x20 + (i * 7) % 95;
+		ac->foreground = 1 + (i / 13) % 7;
+		ac->background = (i / 40) % 3 ? VBI_BLACK : VBI_BLUE;
+		ac->opacity = VBI_OPAQUE;
+		ac->size = VBI_NORMAL_SIZE;
+	}
+
+	for (i = 0; i < 40; ++i) {
+		vt_page.text[2 * 40 + i].size = VBI_DOUBLE_HEIGHT;
+		vt_page.text[3 * 40 + i].size = VBI_DOUBLE_HEIGHT2;
+	}
+
+	for (i = 0; i < 40; ++i)
+		vt_page.color_map[i] = i * 0x050301;
+
+	CLEAR (cc_page);
+
+	cc_page.rows = 15;
+	cc_page.columns = 34;
+
+	for (i = 0; i < 34 * 15; ++i) {
+		vbi_char *ac = &cc_page.text[i];
+
+		ac->unicode = 0x20;
+		ac->foreground = VBI_WHITE;
+		ac->background = VBI_BLACK;
+		ac->opacity = VBI_TRANSPARENT_SPACE;
+
+		if (i / 34 >= 11) {
+			ac->unicode = 0x20 + (i * 7) % 95;
+			ac->opacity = VBI_OPAQUE;
+			ac->italic = (0 == i % 5);
+			ac->underline = (0 == i % 7);
+		}
+	}
+
+	for (i = 0; i < 40; ++i)
+		cc_page.color_map[i] = i * 0x050301;
+}
+
+static void
+benchmark			(const char *		name,
+				 vbi_page *		pg,
+				 vbi_pixfmt		fmt,
+				 vbi_bool		caption)
+{
+	double start;
+	double elapsed;
+	unsigned int i;
+
+	start = now ();
+
+	for (i = 0; i < option_repeat; ++i) {
+		if (caption) {
+			vbi_draw_cc_page_region (pg, fmt, canvas,
+						 /* rowstride */ -1,
+						 0, 0, pg->columns,
+						 pg->rows);
+		} else {
+			vbi_draw_vt_page_region (pg, fmt, canvas,
+						 /* rowstride */ -1,
+						 0, 0, pg->columns,
+						 pg->rows,
+						 /* reveal */ TRUE,
+						 /* flash_on */ TRUE);
+		}
+	}
+
+	elapsed = now () - start;
+
+	printf ("%-12s %u pages: %.3f s, %.1f us/page\n",
+		name, option_repeat, elapsed,
+		elapsed * 1e6 / option_repeat);
+}
+
+static void
+usage				(FILE *			fp)
+{
+	fprintf (fp, "\
+%s %s -- Teletext and Closed Caption renderer benchmark\n\n\
+Copyright (C) 2026 agent <agent@local>\n\
+This program is licensed under GPLv2+. NO WARRANTIES.\n\n\
+Usage: %s [options]\n\
+-h         Print this message and exit\n\
+-r n       Draw each page n times (default 20000)\n\
+-V         Print the program version and exit\n\
+",
+		 PROGRAM_NAME, VERSION, PROGRAM_NAME);
+}
+
+int
+main				(int			argc,
+				 char **		argv)
+{
+	option_repeat = 20000;
+
+	for (;;) {
+		int c;
+
+		c = getopt (argc, argv, "hr:V");
+		if (-1 == c)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage (stdout);
+			exit (EXIT_SUCCESS);
+
+		case 'r':
+			assert (NULL != optarg);
+			option_repeat = strtoul (optarg, NULL, 0);
+			if (0 == option_repeat) {
+				fprintf (stderr, "Invalid repeat count.\n");
+				exit (EXIT_FAILURE);
+			}
+			break;
+
+		case 'V':
+			printf (PROGRAM_NAME " " VERSION "\n");
+			exit (EXIT_SUCCESS);
+
+		default:
+			usage (stderr);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	init_pages ();
+
+	benchmark ("vt RGBA32", &vt_page, VBI_PIXFMT_RGBA32_LE, FALSE);
+	benchmark ("vt PAL8", &vt_page, VBI_PIXFMT_PAL8, FALSE);
+	benchmark ("cc RGBA32", &cc_page, VBI_PIXFMT_RGBA32_LE, TRUE);
+	benchmark ("cc PAL8", &cc_page, VBI_PIXFMT_PAL8, TRUE);
+
+	exit (EXIT_SUCCESS);
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
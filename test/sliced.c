@@ -51,6 +51,7 @@
 #include "src/io-sim.h"
 #include "src/raw_decoder.h"
 #include "src/vbi.h"
+#include "src/sliced_file.h"
 #include "sliced.h"
 
 #if 2 == VBI_VERSION_MINOR
@@ -103,6 +104,8 @@ struct stream {
 
 	vbi_dvb_mux *		mx;
 	vbi_dvb_demux *	dx;
+	_vbi_sliced_writer *	writer;
+	_vbi_sliced_file *	sf;
 #if 2 == VBI_VERSION_MINOR
         vbi_proxy_client *	proxy;
 #endif
@@ -219,6 +222,14 @@ stream_delete			(struct stream *	st)
 	if (NULL == st)
 		return;
 
+	if (NULL != st->writer) {
+		if (!_vbi_sliced_writer_finish (st->writer))
+			write_error_exit (/* msg: errno */ NULL);
+		_vbi_sliced_writer_delete (st->writer);
+	}
+
+	_vbi_sliced_file_delete (st->sf);
+
 	if (st->close_fd) {
 		if (-1 == close (st->fd)) {
 			if (NULL != st->write_func)
@@ -648,6 +659,28 @@ write_func_old_sliced		(struct stream *	st,
 	return TRUE;
 }
 
+static vbi_bool
+write_func_new_sliced		(struct stream *	st,
+				 const vbi_sliced *	sliced,
+				 unsigned int		n_lines,
+				 const uint8_t *	raw,
+				 const vbi_sampling_par *sp,
+				 double			sample_time,
+				 int64_t		stream_time)
+{
+	raw = raw; /* unused */
+	sp = sp;
+
+	if (NULL == sliced)
+		return TRUE;
+
+	if (!_vbi_sliced_writer_write_frame (st->writer, sliced, n_lines,
+					    sample_time, stream_time))
+		write_error_exit (/* msg: errno */ NULL);
+
+	return TRUE;
+}
+
 vbi_bool
 write_stream_sliced		(struct stream *	st,
 				 const vbi_sliced *	sliced,
@@ -754,6 +787,16 @@ write_stream_new		(const char *		file_name,
 
 		break;
 
+	case FILE_FORMAT_NEW_SLICED:
+		st->write_func = write_func_new_sliced;
+
+		st->writer = _vbi_sliced_writer_new_fd (st->fd,
+						       /* close_fd */ FALSE);
+		if (NULL == st->writer)
+			write_error_exit (/* msg: errno */ NULL);
+
+		break;
+
 	default:
 		error_exit (_("Unknown output file format."));
 		break;
@@ -851,6 +894,32 @@ read_loop_pes_ts		(struct stream *	st)
 	return TRUE;
 }
 
+static vbi_bool
+read_loop_new_sliced		(struct stream *	st)
+{
+	for (;;) {
+		const vbi_sliced *sliced;
+		unsigned int n_lines;
+		double sample_time;
+		int64_t pts;
+
+		if (!_vbi_sliced_file_get_frame (st->sf, &sliced, &n_lines,
+						&sample_time, &pts)) {
+			if (0 == errno)
+				break; /* EOF */
+			error_exit ("%s", _vbi_sliced_file_errstr (st->sf));
+		}
+
+		if (!st->callback (sliced, n_lines,
+				   /* raw */ NULL,
+				   /* sp */ NULL,
+				   sample_time, pts))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static vbi_bool
 next_byte			(struct stream *	st,
 				 int *			c)
@@ -1226,6 +1295,9 @@ detect_file_format		(struct stream *	st)
 	if (!look_ahead (st, 8))
 		return 0; /* unknown format */
 
+	if (0 == memcmp (st->bp, _VBI_SLICED_FILE_COMPACT_MAGIC, 8))
+		return FILE_FORMAT_NEW_SLICED;
+
 	if (is_old_sliced_format (st->bp))
 		return FILE_FORMAT_SLICED;
 
@@ -1310,6 +1382,26 @@ read_stream_new			(const char *		file_name,
 
 		break;
 
+	case FILE_FORMAT_NEW_SLICED:
+		st->loop = read_loop_new_sliced;
+
+		/* Give the reader the bytes we looked at. */
+		if (st->end > st->buffer
+		    && (off_t) -1 == lseek (st->fd, 0, SEEK_SET)) {
+			error_exit (_("Cannot detect the format of "
+				      "compact sliced VBI data on a pipe."));
+		}
+
+		st->sf = _vbi_sliced_file_open_fd
+			(st->fd, _VBI_SLICED_FILE_FORMAT_COMPACT,
+			 /* close_fd */ FALSE);
+		if (NULL == st->sf) {
+			error_exit (_("Cannot read compact sliced VBI "
+				      "data: %s."), strerror (errno));
+		}
+
+		break;
+
 	default:
 		error_exit (_("Unknown input file format."));
 		break;
@@ -0,0 +1,714 @@
+/*
+ *  libzvbi -- ATSC caption decoder unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/hamm.h"
+#include "src/cc608_decoder.h"
+#include "src/dtvcc_decoder.h"
+#include "src/atsc_cc_demux.h"
+
+/* Events received, per program. */
+struct received {
+	unsigned int		program_number;
+	unsigned int		n_cc608_stream;
+	unsigned int		n_dtvcc_stream;
+	char			cc608_text[64];
+	char			dtvcc_text[64];
+	int			dtvcc_service;
+	int64_t			dtvcc_pts;
+};
+
+static struct received		received[4];
+
+static void
+text_to_ascii			(char *			buffer,
+				 unsigned int		buffer_size,
+				 const vbi_char *	text,
+				 unsigned int		length)
+{
+	unsigned int i;
+	unsigned int n;
+
+	n = 0;
+
+	for (i = 0; i < length && n + 1 < buffer_size; ++i) {
+		if (VBI_TRANSPARENT_SPACE == text[i].opacity)
+			continue;
+		buffer[n++] = text[i].unicode;
+	}
+
+	/* Remove trailing spaces. */
+	while (n > 0 && ' ' == buffer[n - 1])
+		--n;
+
+	buffer[n] = 0;
+}
+
+static void
+record_event			(struct received *	r,
+				 const vbi_event *	ev)
+{
+	switch (ev->type) {
+	case _VBI_EVENT_CC608_STREAM:
+		++r->n_cc608_stream;
+		text_to_ascii (r->cc608_text, sizeof (r->cc608_text),
+			       ev->ev._cc608_stream->text,
+			       N_ELEMENTS (ev->ev._cc608_stream->text));
+		break;
+
+	case _VBI_EVENT_DTVCC_STREAM:
+		++r->n_dtvcc_stream;
+		text_to_ascii (r->dtvcc_text, sizeof (r->dtvcc_text),
+			       ev->ev._dtvcc_stream->text,
+			       ev->ev._dtvcc_stream->length);
+		r->dtvcc_service = ev->ev._dtvcc_stream->service;
+		r->dtvcc_pts = ev->ev._dtvcc_stream->pts;
+		break;
+
+	default:
+		assert (0);
+	}
+}
+
+static void
+event_handler			(vbi_event *		ev,
+				 void *			user_data)
+{
+	user_data = user_data; /* unused */
+
+	record_event (&received[0], ev);
+}
+
+/* A CEA 708-C Caption Channel Packet for service 1 which defines a
+   visible window, prints "HI" and a carriage return. */
+static const uint8_t
+dtvcc_packet [12] = {
+	/* sequence_number 0, packet_size_code 6 */
+	0x06,
+	/* service_number 1, block_size 10 */
+	0x2A,
+	/* DefineWindow 0: visible, one row, 32 columns,
+	   window and pen style 1 */
+	0x98, 0x20, 0x00, 0x00, 0x00, 31, 0x09,
+	'H', 'I',
+	/* CR */
+	0x0D
+};
+
+/* Stores a cc_data() structure with the given byte triplets
+   (cc_valid and cc_type, cc_data_1, cc_data_2) in buf. */
+static unsigned int
+make_cc_data			(uint8_t *		buf,
+				 const uint8_t *	triplets,
+				 unsigned int		cc_count)
+{
+	unsigned int i;
+
+	/* process_em_data_flag, process_cc_data_flag,
+	   additional_data_flag, cc_count [5], em_data [8] */
+	buf[0] = 0x40 | cc_count;
+	buf[1] = 0xFF;
+
+	for (i = 0; i < cc_count; ++i) {
+		buf[2 + i * 3] = 0xF8 | triplets[i * 3];
+		buf[3 + i * 3] = triplets[i * 3 + 1];
+		buf[4 + i * 3] = triplets[i * 3 + 2];
+	}
+
+	return 2 + cc_count * 3;
+}
+
+/* Packs dtvcc_packet into cc_data triplets, followed by one
+   invalid DTVCC_START to terminate the packet. */
+static unsigned int
+make_dtvcc_triplets		(uint8_t *		triplets)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof (dtvcc_packet); i += 2) {
+		/* cc_valid, cc_type DTVCC_START or DTVCC_DATA */
+		triplets[i / 2 * 3] = 4 | ((0 == i) ? 3 : 2);
+		triplets[i / 2 * 3 + 1] = dtvcc_packet[i];
+		triplets[i / 2 * 3 + 2] = dtvcc_packet[i + 1];
+	}
+
+	i /= 2;
+
+	triplets[i * 3] = 0 | 3;
+	triplets[i * 3 + 1] = 0;
+	triplets[i * 3 + 2] = 0;
+
+	return i + 1;
+}
+
+static void
+test_cc_data_decoder		(void)
+{
+	static const uint8_t cc608[4][2] = {
+		{ 0x14, 0x20 },		/* RCL */
+		{ 'H', 'i' },
+		{ '!', 0x00 },
+		{ 0x14, 0x2F },		/* EOC */
+	};
+	_vbi_cc_data_decoder *cd;
+	uint8_t triplets[31 * 3];
+	uint8_t buf[2 + 31 * 3];
+	unsigned int cc_count;
+	unsigned int n;
+	unsigned int i;
+
+	cd = _vbi_cc_data_decoder_new ();
+	assert (NULL != cd);
+
+	assert (_vbi_cc_data_decoder_add_event_handler
+		(cd, _VBI_EVENT_CC608_STREAM | _VBI_EVENT_DTVCC_STREAM,
+		 event_handler, NULL));
+
+	CLEAR (received);
+
+	/* One NTSC field 1 pair per picture. */
+	for (i = 0; i < N_ELEMENTS (cc608); ++i) {
+		triplets[0] = 4 | 0;
+		triplets[1] = vbi_par8 (cc608[i][0]);
+		triplets[2] = vbi_par8 (cc608[i][1]);
+
+		n = make_cc_data (buf, triplets, 1);
+		assert (_vbi_cc_data_decoder_feed (cd, buf, n,
+						   1.0 + i, /* pts */ -1));
+	}
+
+	assert (1 == received[0].n_cc608_stream);
+	assert (0 == strcmp (received[0].cc608_text, "Hi!"));
+	assert (0 == received[0].n_dtvcc_stream);
+
+	cc_count = make_dtvcc_triplets (triplets);
+	n = make_cc_data (buf, triplets, cc_count);
+	assert (_vbi_cc_data_decoder_feed (cd, buf, n,
+					   5.0, /* pts */ 12345));
+
+	assert (1 == received[0].n_dtvcc_stream);
+	assert (1 == received[0].dtvcc_service);
+	assert (12345 == received[0].dtvcc_pts);
+	assert (0 == strcmp (received[0].dtvcc_text, "HI"));
+
+	/* Truncated cc_data. */
+	assert (!_vbi_cc_data_decoder_feed (cd, buf, n - 1,
+					    6.0, /* pts */ -1));
+
+	/* process_cc_data_flag not set. */
+	buf[0] &= ~0x40;
+	assert (_vbi_cc_data_decoder_feed (cd, buf, n,
+					   6.0, /* pts */ -1));
+	assert (1 == received[0].n_dtvcc_stream);
+
+	/* Removing the handler stops all events. */
+	_vbi_cc_data_decoder_remove_event_handler (cd, event_handler, NULL);
+
+	_vbi_cc_data_decoder_reset (cd);
+
+	buf[0] |= 0x40;
+	assert (_vbi_cc_data_decoder_feed (cd, buf, n,
+					   7.0, /* pts */ -1));
+	assert (1 == received[0].n_dtvcc_stream);
+
+	_vbi_cc_data_decoder_delete (cd);
+}
+
+static void
+test_dtvcc_decoder		(void)
+{
+	_vbi_dtvcc_decoder *dc;
+	uint8_t packet[sizeof (dtvcc_packet)];
+
+	dc = _vbi_dtvcc_decoder_new ();
+	assert (NULL != dc);
+
+	assert (_vbi_dtvcc_decoder_add_event_handler
+		(dc, _VBI_EVENT_DTVCC_STREAM, event_handler, NULL));
+
+	CLEAR (received);
+
+	assert (_vbi_dtvcc_decoder_feed (dc, dtvcc_packet,
+					 sizeof (dtvcc_packet),
+					 1.0, /* pts */ 1));
+	assert (1 == received[0].n_dtvcc_stream);
+	assert (0 == strcmp (received[0].dtvcc_text, "HI"));
+
+	/* Sequence number out of order, a packet was lost. */
+	memcpy (packet, dtvcc_packet, sizeof (packet));
+	packet[0] |= 0x80;
+	assert (!_vbi_dtvcc_decoder_feed (dc, packet, sizeof (packet),
+					  2.0, /* pts */ 2));
+
+	/* Incomplete packet. */
+	_vbi_dtvcc_decoder_reset (dc);
+	assert (!_vbi_dtvcc_decoder_feed (dc, dtvcc_packet,
+					  sizeof (dtvcc_packet) - 2,
+					  3.0, /* pts */ 3));
+
+	/* Invalid DefineWindow parameters. */
+	_vbi_dtvcc_decoder_reset (dc);
+	memcpy (packet, dtvcc_packet, sizeof (packet));
+	packet[7] = 63;
+	assert (!_vbi_dtvcc_decoder_feed (dc, packet, sizeof (packet),
+					  4.0, /* pts */ 4));
+
+	assert (1 == received[0].n_dtvcc_stream);
+
+	_vbi_dtvcc_decoder_delete (dc);
+}
+
+/* Defines window 1 with window and pen style 1 and prints "HELLO",
+   defines a 16 x 41 window 0 with window and pen style 7 (print
+   direction top to bottom, scroll direction right to left), prints
+   'X' in the last column and sends a Horizontal Carriage Return,
+   then a carriage return in window 1. */
+static const uint8_t
+dtvcc_wide_packet [28] = {
+	/* sequence_number 0, packet_size_code 14 */
+	0x0E,
+	/* service_number 1, block_size 26 */
+	0x3A,
+	/* DefineWindow 1: visible, priority 1, one row, 41 columns,
+	   window and pen style 1 */
+	0x99, 0x21, 0x00, 0x00, 0x00, 40, 0x09,
+	'H', 'E', 'L', 'L', 'O',
+	/* DefineWindow 0: visible, priority 0, 16 rows, 41 columns,
+	   window and pen style 7 */
+	0x98, 0x20, 0x00, 0x00, 0x0F, 40, 0x3F,
+	/* SetPenLocation row 0, column 40 */
+	0x92, 0, 40,
+	'X',
+	/* HCR */
+	0x0E,
+	/* SetCurrentWindow 1, CR */
+	0x81, 0x0D
+};
+
+static void
+test_dtvcc_styles		(void)
+{
+	_vbi_dtvcc_decoder *dc;
+	uint8_t packet[sizeof (dtvcc_packet)];
+
+	dc = _vbi_dtvcc_decoder_new ();
+	assert (NULL != dc);
+
+	assert (_vbi_dtvcc_decoder_add_event_handler
+		(dc, _VBI_EVENT_DTVCC_STREAM, event_handler, NULL));
+
+	/* Window style 6 prints left to right and scrolls up, style
+	   7 prints top to bottom and is not streamed. */
+	CLEAR (received);
+	memcpy (packet, dtvcc_packet, sizeof (packet));
+	packet[8] = (6 << 3) | 7;
+	assert (_vbi_dtvcc_decoder_feed (dc, packet, sizeof (packet),
+					 1.0, /* pts */ 1));
+	assert (1 == received[0].n_dtvcc_stream);
+	assert (0 == strcmp (received[0].dtvcc_text, "HI"));
+
+	_vbi_dtvcc_decoder_reset (dc);
+	packet[8] = (7 << 3) | 7;
+	assert (_vbi_dtvcc_decoder_feed (dc, packet, sizeof (packet),
+					 2.0, /* pts */ 2));
+	assert (1 == received[0].n_dtvcc_stream);
+
+	/* A vertical window has more columns than rows, and the
+	   HCR must not clear any other window. Window 0 has the
+	   higher priority but cannot be streamed. */
+	_vbi_dtvcc_decoder_reset (dc);
+	assert (_vbi_dtvcc_decoder_feed (dc, dtvcc_wide_packet,
+					 sizeof (dtvcc_wide_packet),
+					 3.0, /* pts */ 3));
+	assert (2 == received[0].n_dtvcc_stream);
+	assert (0 == strcmp (received[0].dtvcc_text, "HELLO"));
+
+	_vbi_dtvcc_decoder_delete (dc);
+}
+
+/* Transport stream generator. */
+
+static uint8_t			ts[1 << 16];
+static unsigned int		ts_size;
+static unsigned int		ts_cc[0x2000];
+
+static unsigned int
+mpeg2_crc			(const uint8_t *	buf,
+				 unsigned int		n_bytes)
+{
+	unsigned int crc;
+	unsigned int i;
+
+	crc = 0xFFFFFFFF;
+
+	for (i = 0; i < n_bytes; ++i) {
+		unsigned int j;
+
+		crc ^= (unsigned int) buf[i] << 24;
+		for (j = 0; j < 8; ++j) {
+			if (crc & 0x80000000)
+				crc = (crc << 1) ^ 0x04C11DB7;
+			else
+				crc <<= 1;
+		}
+	}
+
+	return crc & 0xFFFFFFFF;
+}
+
+/* Stores a TS packet with the given payload, stuffing the
+   adaptation field if the payload is shorter than 184 bytes. */
+static void
+put_ts_packet			(unsigned int		pid,
+				 vbi_bool		unit_start,
+				 const uint8_t *	payload,
+				 unsigned int		payload_size)
+{
+	uint8_t *p;
+
+	assert (payload_size > 0 && payload_size <= 184);
+	assert (ts_size + 188 <= sizeof (ts));
+
+	p = ts + ts_size;
+	ts_size += 188;
+
+	p[0] = 0x47;
+	p[1] = (unit_start ? 0x40 : 0x00) | (pid >> 8);
+	p[2] = pid;
+
+	if (184 == payload_size) {
+		p[3] = 0x10 | (ts_cc[pid]++ & 0x0F);
+		memcpy (p + 4, payload, 184);
+	} else {
+		unsigned int adaptation_field_length;
+
+		p[3] = 0x30 | (ts_cc[pid]++ & 0x0F);
+
+		adaptation_field_length = 183 - payload_size;
+		p[4] = adaptation_field_length;
+		if (adaptation_field_length > 0) {
+			p[5] = 0x00;
+			memset (p + 6, 0xFF, adaptation_field_length - 1);
+		}
+
+		memcpy (p + 5 + adaptation_field_length,
+			payload, payload_size);
+	}
+}
+
+static void
+put_section			(unsigned int		pid,
+				 uint8_t *		section,
+				 unsigned int		size)
+{
+	uint8_t payload[184];
+	unsigned int crc;
+
+	/* section_length */
+	section[1] = 0xB0 | ((size + 4 - 3) >> 8);
+	section[2] = size + 4 - 3;
+
+	crc = mpeg2_crc (section, size);
+	section[size + 0] = crc >> 24;
+	section[size + 1] = crc >> 16;
+	section[size + 2] = crc >> 8;
+	section[size + 3] = crc;
+
+	/* pointer_field */
+	payload[0] = 0;
+	memcpy (payload + 1, section, size + 4);
+	memset (payload + 1 + size + 4, 0xFF, 184 - 1 - size - 4);
+
+	put_ts_packet (pid, TRUE, payload, 184);
+}
+
+static void
+put_pat				(const unsigned int *	program_numbers,
+				 unsigned int		n_programs)
+{
+	uint8_t section[184];
+	unsigned int i;
+
+	section[0] = 0x00; /* table_id */
+	section[3] = 0x00; /* transport_stream_id */
+	section[4] = 0x01;
+	section[5] = 0xC1; /* version 0, current */
+	section[6] = 0x00; /* section_number */
+	section[7] = 0x00; /* last_section_number */
+
+	for (i = 0; i < n_programs; ++i) {
+		unsigned int pmt_pid = 0x100 * program_numbers[i];
+
+		section[8 + i * 4] = program_numbers[i] >> 8;
+		section[9 + i * 4] = program_numbers[i];
+		section[10 + i * 4] = 0xE0 | (pmt_pid >> 8);
+		section[11 + i * 4] = pmt_pid;
+	}
+
+	put_section (0x0000, section, 8 + n_programs * 4);
+}
+
+static void
+put_pmt				(unsigned int		program_number)
+{
+	uint8_t section[184];
+	unsigned int video_pid = 0x100 * program_number + 1;
+
+	section[0] = 0x02; /* table_id */
+	section[3] = program_number >> 8;
+	section[4] = program_number;
+	section[5] = 0xC1; /* version 0, current */
+	section[6] = 0x00;
+	section[7] = 0x00;
+	section[8] = 0xE0 | (video_pid >> 8); /* PCR_PID */
+	section[9] = video_pid;
+	section[10] = 0xF0; /* program_info_length */
+	section[11] = 0x00;
+
+	/* AC-3 audio. */
+	section[12] = 0x81;
+	section[13] = 0xE0 | ((video_pid + 1) >> 8);
+	section[14] = video_pid + 1;
+	section[15] = 0xF0;
+	section[16] = 0x00;
+
+	/* MPEG-2 video. */
+	section[17] = 0x02;
+	section[18] = 0xE0 | (video_pid >> 8);
+	section[19] = video_pid;
+	section[20] = 0xF0;
+	section[21] = 0x00;
+
+	put_section (0x100 * program_number, section, 22);
+}
+
+/* Appends an MPEG-2 I frame with the given cc_data to the video
+   elementary stream buffer. */
+static unsigned int
+put_picture			(uint8_t *		es,
+				 int64_t		pts,
+				 const uint8_t *	cc_data,
+				 unsigned int		cc_data_size)
+{
+	static const uint8_t picture[] = {
+		/* picture_header, I frame */
+		0x00, 0x00, 0x01, 0x00, 0x00, 0x0F, 0xFF, 0xF8,
+		/* picture_coding_extension, frame picture */
+		0x00, 0x00, 0x01, 0xB5, 0x8F, 0xFF, 0xF3, 0x80, 0x80,
+	};
+	static const uint8_t slice[] = {
+		0x00, 0x00, 0x01, 0x01, 0x12, 0x34, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x02, 0x56,
+	};
+	unsigned int n;
+
+	/* PES packet header with PTS, PES_packet_length zero. */
+	es[0] = 0x00;
+	es[1] = 0x00;
+	es[2] = 0x01;
+	es[3] = 0xE0;
+	es[4] = 0x00;
+	es[5] = 0x00;
+	es[6] = 0x80;
+	es[7] = 0x80;
+	es[8] = 5;
+	es[9] = 0x21 | ((pts >> 29) & 0x0E);
+	es[10] = pts >> 22;
+	es[11] = ((pts >> 14) & 0xFE) | 1;
+	es[12] = pts >> 7;
+	es[13] = (pts << 1) | 1;
+	n = 14;
+
+	memcpy (es + n, picture, sizeof (picture));
+	n += sizeof (picture);
+
+	/* ATSC A/53 picture user data. */
+	memcpy (es + n, "\x00\x00\x01\xB2GA94\x03", 9);
+	n += 9;
+	memcpy (es + n, cc_data, cc_data_size);
+	n += cc_data_size;
+	es[n++] = 0xFF; /* marker_bits */
+
+	memcpy (es + n, slice, sizeof (slice));
+	n += sizeof (slice);
+
+	return n;
+}
+
+static void
+put_video			(unsigned int		program_number,
+				 const uint8_t *	es,
+				 unsigned int		es_size,
+				 unsigned int		chunk_size)
+{
+	unsigned int video_pid = 0x100 * program_number + 1;
+	unsigned int i;
+
+	for (i = 0; i < es_size; i += chunk_size) {
+		put_ts_packet (video_pid, 0 == i,
+			       es + i, MIN (chunk_size, es_size - i));
+	}
+}
+
+static void
+demux_callback			(_vbi_atsc_cc_demux *	dx,
+				 void *			user_data,
+				 unsigned int		program_number,
+				 vbi_event *		ev)
+{
+	dx = dx; /* unused */
+
+	assert (&received == user_data);
+	assert (program_number < N_ELEMENTS (received));
+
+	received[program_number].program_number = program_number;
+	record_event (&received[program_number], ev);
+}
+
+static void
+test_atsc_cc_demux		(unsigned int		chunk_size,
+				 unsigned int		feed_size)
+{
+	static const uint8_t cc608[4][2] = {
+		{ 0x14, 0x20 },		/* RCL */
+		{ 'O', 'K' },
+		{ 0x14, 0x2F },		/* EOC */
+		{ 0x80, 0x80 },		/* filler */
+	};
+	static const unsigned int programs[2] = { 1, 3 };
+	_vbi_atsc_cc_demux *dx;
+	uint8_t es[2][4096];
+	unsigned int es_size[2];
+	unsigned int program_numbers[4];
+	unsigned int i;
+
+	CLEAR (received);
+	CLEAR (ts_cc);
+	ts_size = 0;
+
+	put_pat (programs, N_ELEMENTS (programs));
+	put_pmt (1);
+	put_pmt (3);
+
+	/* Program 1 carries EIA 608, program 3 DTVCC captions.
+	   The last picture flushes the reorder buffer. */
+	es_size[0] = 0;
+	es_size[1] = 0;
+
+	for (i = 0; i < N_ELEMENTS (cc608); ++i) {
+		uint8_t triplets[31 * 3];
+		uint8_t cc_data[2 + 31 * 3];
+		unsigned int cc_count;
+		unsigned int n;
+
+		triplets[0] = 4 | 0;
+		triplets[1] = vbi_par8 (cc608[i][0]);
+		triplets[2] = vbi_par8 (cc608[i][1]);
+
+		n = make_cc_data (cc_data, triplets, 1);
+		es_size[0] += put_picture (es[0] + es_size[0],
+					   3003 * i, cc_data, n);
+
+		if (0 == i) {
+			cc_count = make_dtvcc_triplets (triplets);
+		} else {
+			/* Filler. */
+			triplets[0] = 0 | 2;
+			triplets[1] = 0;
+			triplets[2] = 0;
+			cc_count = 1;
+		}
+
+		n = make_cc_data (cc_data, triplets, cc_count);
+		es_size[1] += put_picture (es[1] + es_size[1],
+					   90000 + 3003 * i, cc_data, n);
+	}
+
+	put_video (1, es[0], es_size[0], chunk_size);
+	put_video (3, es[1], es_size[1], chunk_size);
+
+	dx = _vbi_atsc_cc_demux_new (_VBI_EVENT_CC608_STREAM
+				     | _VBI_EVENT_DTVCC_STREAM,
+				     demux_callback, &received);
+	assert (NULL != dx);
+
+	for (i = 0; i < ts_size; i += feed_size) {
+		assert (_vbi_atsc_cc_demux_feed
+			(dx, ts + i, MIN (feed_size, ts_size - i),
+			 /* capture_time */ 1.0));
+	}
+
+	assert (2 == _vbi_atsc_cc_demux_get_programs
+		(dx, program_numbers, N_ELEMENTS (program_numbers)));
+	assert ((1 == program_numbers[0] && 3 == program_numbers[1])
+		|| (3 == program_numbers[0] && 1 == program_numbers[1]));
+
+	assert (1 == received[1].n_cc608_stream);
+	assert (0 == strcmp (received[1].cc608_text, "OK"));
+	assert (0 == received[1].n_dtvcc_stream);
+
+	assert (0 == received[3].n_cc608_stream);
+	assert (1 == received[3].n_dtvcc_stream);
+	assert (0 == strcmp (received[3].dtvcc_text, "HI"));
+	assert (1 == received[3].dtvcc_service);
+	assert (90000 == received[3].dtvcc_pts);
+
+	/* After a reset the demultiplexer must see a new PAT. */
+	_vbi_atsc_cc_demux_reset (dx);
+	assert (0 == _vbi_atsc_cc_demux_get_programs
+		(dx, program_numbers, N_ELEMENTS (program_numbers)));
+
+	_vbi_atsc_cc_demux_delete (dx);
+}
+
+int
+main				(void)
+{
+	test_cc_data_decoder ();
+	test_dtvcc_decoder ();
+	test_dtvcc_styles ();
+
+	/* Whole packets, start codes across TS packets, TS packets
+	   across _vbi_atsc_cc_demux_feed() calls. */
+	test_atsc_cc_demux (184, 188 * 10);
+	test_atsc_cc_demux (7, 188);
+	test_atsc_cc_demux (2, 100);
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
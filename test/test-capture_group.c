@@ -0,0 +1,265 @@
+/*
+ *  libzvbi -- Capture group unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "src/misc.h"
+#include "src/io.h"
+#include "src/io-sim.h"
+#include "src/dvb_mux.h"
+
+static vbi_capture *
+new_sim				(void)
+{
+	vbi_capture *cap;
+	unsigned int services;
+
+	services = (VBI_SLICED_TELETEXT_B | VBI_SLICED_VPS
+		    | VBI_SLICED_CAPTION_625 | VBI_SLICED_WSS_625);
+
+	cap = vbi_capture_sim_new (625, &services,
+				   /* interlaced */ FALSE,
+				   /* synchronous */ TRUE);
+	assert (NULL != cap);
+
+	return cap;
+}
+
+static void
+test_priorities			(void)
+{
+	vbi_capture_group_frame frames[4];
+	vbi_capture_group *g;
+	vbi_capture *cap[3];
+	struct timeval tv;
+	unsigned int i;
+
+	g = vbi_capture_group_new ();
+	assert (NULL != g);
+
+	for (i = 0; i < 3; ++i)
+		cap[i] = new_sim ();
+
+	/* cap[0] has the highest priority. */
+	assert (vbi_capture_group_add (g, cap[1], 0, FALSE, &cap[1]));
+	assert (vbi_capture_group_add (g, cap[2], 0, TRUE, &cap[2]));
+	assert (vbi_capture_group_add (g, cap[0], 1, FALSE, &cap[0]));
+	assert (!vbi_capture_group_add (g, cap[0], 1, FALSE, NULL));
+
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+
+	assert (3 == vbi_capture_group_pull (g, frames, 4, &tv));
+	assert (cap[0] == frames[0].capture);
+	assert (&cap[0] == frames[0].user_data);
+	assert (NULL == frames[0].raw);
+	assert (NULL != frames[0].sliced);
+	assert (frames[0].sliced->size > 0);
+
+	/* Raw data only on request. */
+	for (i = 1; i < 3; ++i) {
+		if (cap[1] == frames[i].capture) {
+			assert (&cap[1] == frames[i].user_data);
+			assert (NULL == frames[i].raw);
+		} else {
+			assert (cap[2] == frames[i].capture);
+			assert (&cap[2] == frames[i].user_data);
+			assert (NULL != frames[i].raw);
+		}
+	}
+
+	/* The source of higher priority always comes first, the
+	   others take turns. */
+	for (i = 0; i < 4; ++i) {
+		assert (2 == vbi_capture_group_pull (g, frames, 2, &tv));
+		assert (cap[0] == frames[0].capture);
+		assert (cap[1 + (i & 1)] == frames[1].capture);
+	}
+
+	assert (vbi_capture_group_remove (g, cap[0]));
+	assert (!vbi_capture_group_remove (g, cap[0]));
+
+	assert (1 == vbi_capture_group_pull (g, frames, 1, &tv));
+	assert (cap[1] == frames[0].capture);
+
+	vbi_capture_group_delete (g);
+
+	for (i = 0; i < 3; ++i)
+		vbi_capture_delete (cap[i]);
+}
+
+#ifdef ENABLE_DVB
+
+static uint8_t			stream[65536];
+static unsigned int		stream_size;
+
+static vbi_bool
+pes_callback			(vbi_dvb_mux *		mx,
+				 void *			user_data,
+				 const uint8_t *	packet,
+				 unsigned int		packet_size)
+{
+	mx = mx; /* unused */
+	user_data = user_data;
+
+	assert (stream_size + packet_size <= sizeof (stream));
+
+	memcpy (stream + stream_size, packet, packet_size);
+	stream_size += packet_size;
+
+	return TRUE;
+}
+
+/* Returns the PES packets of one frame. */
+static void
+make_frame			(unsigned int		frame)
+{
+	vbi_dvb_mux *mx;
+	vbi_sliced s;
+
+	mx = vbi_dvb_pes_mux_new (pes_callback, /* user_data */ NULL);
+	assert (NULL != mx);
+
+	CLEAR (s);
+
+	s.id = VBI_SLICED_TELETEXT_B;
+	s.line = 7;
+
+	stream_size = 0;
+	assert (vbi_dvb_mux_feed (mx, &s, 1, VBI_SLICED_TELETEXT_B,
+				  /* raw */ NULL, /* sp */ NULL,
+				  /* pts */ frame * 3600));
+
+	vbi_dvb_mux_delete (mx);
+}
+
+static void
+test_wait			(void)
+{
+	vbi_capture_group_frame frames[4];
+	vbi_capture_group *g;
+	vbi_capture *dvb;
+	vbi_capture *sim;
+	char dev_name[40];
+	char *errstr;
+	struct timeval start;
+	struct timeval tv;
+	unsigned int i;
+	int fds[2];
+
+	assert (0 == pipe (fds));
+
+	snprintf (dev_name, sizeof (dev_name), "/dev/fd/%d", fds[0]);
+	dvb = vbi_capture_dvb_new2 (dev_name, /* pid */ 0,
+				    &errstr, /* trace */ FALSE);
+	assert (NULL != dvb);
+	close (fds[0]);
+
+	g = vbi_capture_group_new ();
+	assert (NULL != g);
+
+	assert (vbi_capture_group_add (g, dvb, 0, FALSE, NULL));
+
+	/* No data, times out. */
+	gettimeofday (&start, NULL);
+	tv.tv_sec = 0;
+	tv.tv_usec = 50000;
+	assert (0 == vbi_capture_group_pull (g, frames, 4, &tv));
+	gettimeofday (&tv, NULL);
+	assert ((tv.tv_sec - start.tv_sec) * 1000000
+		+ tv.tv_usec - start.tv_usec >= 50000);
+
+	/* A source which cannot be waited on does not block
+	   others. */
+	sim = new_sim ();
+	assert (vbi_capture_group_add (g, sim, 1, FALSE, NULL));
+
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	assert (1 == vbi_capture_group_pull (g, frames, 4, &tv));
+	assert (sim == frames[0].capture);
+
+	assert (vbi_capture_group_remove (g, sim));
+	vbi_capture_delete (sim);
+
+	/* A frame is complete when the next one starts. */
+	for (i = 0; i < 2; ++i) {
+		make_frame (i);
+		assert ((ssize_t) stream_size
+			== write (fds[1], stream, stream_size));
+	}
+
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	assert (1 == vbi_capture_group_pull (g, frames, 4, &tv));
+	assert (dvb == frames[0].capture);
+	assert (NULL != frames[0].sliced);
+	assert (sizeof (vbi_sliced) == (size_t) frames[0].sliced->size);
+
+	/* End of file. */
+	close (fds[1]);
+
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	assert (1 == vbi_capture_group_pull (g, frames, 4, &tv));
+	assert (dvb == frames[0].capture);
+	assert (NULL == frames[0].sliced);
+	assert (0 == frames[0].error);
+
+	/* The group stops reading from a failed source. */
+	tv.tv_sec = 0;
+	tv.tv_usec = 10000;
+	assert (0 == vbi_capture_group_pull (g, frames, 4, &tv));
+
+	vbi_capture_group_delete (g);
+
+	vbi_capture_delete (dvb);
+}
+
+#endif /* ENABLE_DVB */
+
+int
+main				(void)
+{
+	test_priorities ();
+#ifdef ENABLE_DVB
+	test_wait ();
+#endif
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -0,0 +1,192 @@
+/*
+ *  libzvbi -- Character set conversion unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>		/* mrand48() */
+#include <string.h>
+#ifdef HAVE_ICONV
+#  include <iconv.h>
+#endif
+
+#include "src/misc.h"
+#include "src/conv.h"
+
+static uint16_t			ucs2[0x10000];
+
+/* Converts src_length characters of src with iconv(). Returns the
+   number of bytes stored in dst or -1. */
+static long
+iconv_ucs2			(char *			dst,
+				 unsigned long		dst_size,
+				 const char *		dst_codeset,
+				 const uint16_t *	src,
+				 unsigned long		src_length)
+{
+#ifdef HAVE_ICONV
+	iconv_t cd;
+	char *s;
+	char *d;
+	size_t s_left;
+	size_t d_left;
+	size_t r;
+
+	cd = iconv_open (dst_codeset, "UCS-2");
+	if ((iconv_t) -1 == cd)
+		return -1;
+
+	s = (char *) src;
+	s_left = src_length * 2;
+	d = dst;
+	d_left = dst_size;
+
+	r = iconv (cd, &s, &s_left, &d, &d_left);
+
+	iconv_close (cd);
+
+	if ((size_t) -1 == r)
+		return -1;
+
+	return d - dst;
+#else
+	return -1;
+#endif
+}
+
+static void
+test_codeset			(const char *		name,
+				 _vbi_codeset		codeset,
+				 unsigned int		max_char)
+{
+	static char buffer1[0x10000 * 4];
+	static char buffer2[0x10000 * 4];
+	unsigned long max_size;
+	unsigned long i;
+	long size1;
+	long size2;
+
+	assert (codeset == _vbi_codeset_from_name (name));
+
+	max_size = _vbi_convert_ucs2_max_size (codeset, 1);
+	assert (max_size <= 4);
+
+	/* All representable characters, except surrogates which
+	   iconv() rejects. */
+	for (i = 0; i <= max_char && i < 0xD800; ++i)
+		ucs2[i] = i;
+
+	size1 = _vbi_convert_ucs2 (buffer1, codeset, ucs2, i, 0);
+	assert (size1 > 0);
+	assert ((unsigned long) size1
+		<= _vbi_convert_ucs2_max_size (codeset, i));
+
+	size2 = iconv_ucs2 (buffer2, sizeof (buffer2), name, ucs2, i);
+	if (size2 >= 0) {
+		assert (size1 == size2);
+		assert (0 == memcmp (buffer1, buffer2, size1));
+	}
+
+	/* Random strings. */
+	for (i = 0; i < 1000; ++i) {
+		unsigned long length;
+		unsigned long j;
+		char *s;
+
+		length = mrand48 () & 63;
+
+		for (j = 0; j < length; ++j) {
+			unsigned int c;
+
+			switch (mrand48 () & 3) {
+			case 0:
+				c = mrand48 () & 0xFFFF;
+				break;
+			default:
+				c = (mrand48 () & 0x7F) | 1;
+				break;
+			}
+
+			if (c >= 0xD800 && c <= 0xDFFF)
+				c = 0x20;
+
+			ucs2[j] = c;
+		}
+
+		size1 = _vbi_convert_ucs2 (buffer1, codeset,
+					   ucs2, length, '?');
+		assert (size1 >= 0);
+		assert ((unsigned long) size1
+			<= _vbi_convert_ucs2_max_size (codeset, length));
+
+		s = vbi_strndup_iconv_ucs2 (name, ucs2, length, '?');
+		assert (NULL != s);
+		assert (0 == memcmp (s, buffer1, size1));
+		assert (0 == s[size1]);
+		free (s);
+
+		if (max_char < 0xFFFF) {
+			for (j = 0; j < length; ++j)
+				if (ucs2[j] > max_char)
+					break;
+
+			size1 = _vbi_convert_ucs2 (buffer1, codeset,
+						   ucs2, length, 0);
+			if (j < length) {
+				assert (-1 == size1);
+				assert (EILSEQ == errno);
+			} else {
+				assert (size1 == (long) length);
+			}
+		}
+	}
+}
+
+int
+main				(void)
+{
+	assert (_VBI_CODESET_UTF8 == _vbi_codeset_from_name (NULL));
+	assert (_VBI_CODESET_UTF8 == _vbi_codeset_from_name ("utf8"));
+	assert (_VBI_CODESET_LATIN1 == _vbi_codeset_from_name ("iso8859-1"));
+	assert (_VBI_CODESET_UNKNOWN == _vbi_codeset_from_name ("ISO-8859-15"));
+	assert (_VBI_CODESET_UNKNOWN == _vbi_codeset_from_name ("UTF-16"));
+
+	test_codeset ("UTF-8", _VBI_CODESET_UTF8, 0xFFFF);
+	test_codeset ("ASCII", _VBI_CODESET_ASCII, 0x7F);
+	test_codeset ("ISO-8859-1", _VBI_CODESET_LATIN1, 0xFF);
+	test_codeset ("UCS-2", _VBI_CODESET_UCS2, 0xFFFF);
+	test_codeset ("UTF-16LE", _VBI_CODESET_UTF16LE, 0xFFFF);
+	test_codeset ("UTF-16BE", _VBI_CODESET_UTF16BE, 0xFFFF);
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -0,0 +1,322 @@
+/*
+ *  libzvbi -- Teletext page renderer unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/format.h"
+#include "src/lang.h"
+#include "src/exp-gfx.h"
+
+#define WIDTH (40 * 12)
+#define HEIGHT (25 * 10)
+
+static vbi_page			old_page;
+static vbi_page			new_page;
+static uint8_t			drcs_font[64 * 60];
+static uint8_t			old_clut[64];
+static uint8_t			new_clut[64];
+
+static void
+init_page			(vbi_page *		pg)
+{
+	unsigned int i;
+
+	CLEAR (*pg);
+
+	pg->pgno = 0x100;
+	pg->rows = 25;
+	pg->columns = 40;
+	pg->font[0] = &vbi_font_descriptors[0];
+	pg->font[1] = &vbi_font_descriptors[0];
+
+	for (i = 0; i < 40 * 25; ++i) {
+		vbi_char *ac = &pg->text[i];
+
+		ac->unicode = 0x20 + (i * 7) % 95;
+		ac->foreground = (i / 3) % 8;
+		ac->background = (i / 40) % 2 ? VBI_BLACK : VBI_BLUE;
+		ac->opacity = VBI_OPAQUE;
+		ac->size = VBI_NORMAL_SIZE;
+	}
+
+	for (i = 0; i < 40; ++i)
+		pg->color_map[i] = i * 0x050301;
+
+	/* A DRCS character in row 5. */
+	pg->text[5 * 40 + 10].unicode = 0xF000 + 3;
+	pg->text[5 * 40 + 10].drcs_clut_offs = 2;
+	pg->drcs[0] = drcs_font;
+	pg->drcs_clut = old_clut;
+}
+
+static void
+init_drcs			(void)
+{
+	unsigned int i;
+
+	/* Four bit pixels, all colors. */
+	for (i = 0; i < sizeof (drcs_font); ++i)
+		drcs_font[i] = (i & 15) * 0x11 + 1;
+
+	for (i = 0; i < 64; ++i) {
+		old_clut[i] = 8 + i % 16;
+		new_clut[i] = old_clut[i];
+	}
+}
+
+static void
+draw_page			(vbi_page *		pg,
+				 vbi_pixfmt		fmt,
+				 uint8_t *		canvas,
+				 int			reveal,
+				 int			flash_on)
+{
+	vbi_draw_vt_page_region (pg, fmt, canvas, /* rowstride */ -1,
+				 0, 0, pg->columns, pg->rows,
+				 reveal, flash_on);
+}
+
+/* Updates the image of old_page to new_page and compares the result
+   against a complete redraw. Returns the number of damaged
+   rectangles. */
+static int
+update				(vbi_pixfmt		fmt,
+				 int			old_flash_on,
+				 int			flash_on,
+				 vbi_rect *		rects)
+{
+	size_t size = WIDTH * HEIGHT * ((VBI_PIXFMT_PAL8 == fmt) ? 1 : 4);
+	uint8_t *canvas1;
+	uint8_t *canvas2;
+	int n_rects;
+
+	canvas1 = malloc (size);
+	assert (NULL != canvas1);
+	canvas2 = malloc (size);
+	assert (NULL != canvas2);
+
+	draw_page (&old_page, fmt, canvas1, TRUE, old_flash_on);
+
+	n_rects = vbi_draw_vt_page_update (&old_page, TRUE, old_flash_on,
+					   &new_page, fmt,
+					   canvas1, /* rowstride */ -1,
+					   TRUE, flash_on, rects, 8);
+	assert (n_rects >= 0 && n_rects <= 8);
+
+	draw_page (&new_page, fmt, canvas2, TRUE, flash_on);
+	assert (0 == memcmp (canvas1, canvas2,
+			     size / 25 * new_page.rows));
+
+	free (canvas2);
+	free (canvas1);
+
+	return n_rects;
+}
+
+static void
+test_update			(vbi_pixfmt		fmt)
+{
+	vbi_rect rects[8];
+	unsigned int i;
+
+	init_drcs ();
+	init_page (&old_page);
+	init_page (&new_page);
+
+	/* Nothing changed. */
+	assert (0 == update (fmt, TRUE, TRUE, rects));
+
+	/* One character changed. */
+	new_page.text[3 * 40 + 5].unicode = 'A';
+	old_page.text[3 * 40 + 5].unicode = 'B';
+	assert (1 == update (fmt, TRUE, TRUE, rects));
+	assert (5 * 12 == rects[0].x);
+	assert (3 * 10 == rects[0].y);
+	assert (12 == rects[0].width);
+	assert (10 == rects[0].height);
+
+	/* Double height characters cover the row below. */
+	new_page.text[3 * 40 + 5].size = VBI_DOUBLE_HEIGHT;
+	new_page.text[4 * 40 + 5].size = VBI_DOUBLE_HEIGHT2;
+	assert (1 == update (fmt, TRUE, TRUE, rects));
+	assert (3 * 10 == rects[0].y);
+	assert (20 == rects[0].height);
+	init_page (&new_page);
+	init_page (&old_page);
+
+	/* Flashing characters change with flash_on only. */
+	new_page.text[7 * 40 + 1].flash = TRUE;
+	old_page.text[7 * 40 + 1].flash = TRUE;
+	assert (0 == update (fmt, TRUE, TRUE, rects));
+	assert (1 == update (fmt, TRUE, FALSE, rects));
+	assert (1 * 12 == rects[0].x);
+	assert (7 * 10 == rects[0].y);
+
+	/* Two CLUT entries of the same color. In PAL8 images the
+	   DRCS pixels are the CLUT entries, so only these change. */
+	old_page.color_map[30] = old_page.color_map[8];
+	new_page.color_map[30] = new_page.color_map[8];
+	for (i = 0; i < 64; ++i) {
+		if (8 == old_clut[i])
+			new_clut[i] = 30;
+	}
+	new_page.drcs_clut = new_clut;
+
+	if (VBI_PIXFMT_PAL8 == fmt) {
+		assert (1 == update (fmt, TRUE, TRUE, rects));
+		assert (10 * 12 == rects[0].x);
+		assert (5 * 10 == rects[0].y);
+	} else {
+		assert (0 == update (fmt, TRUE, TRUE, rects));
+	}
+
+	/* A different color. */
+	new_clut[2] = 31;
+	assert (1 == update (fmt, TRUE, TRUE, rects));
+
+	/* Size changed, everything is redrawn. */
+	new_page.rows = 24;
+	assert (1 == update (fmt, TRUE, TRUE, rects));
+	assert (0 == rects[0].x && 0 == rects[0].y);
+	assert (WIDTH == rects[0].width);
+	assert (24 * 10 == rects[0].height);
+}
+
+/* Draws new_page with and without the glyph atlas and compares
+   the images. */
+static void
+compare_cached			(vbi_glyph_atlas *	atlas,
+				 vbi_pixfmt		fmt,
+				 int			reveal,
+				 int			flash_on)
+{
+	size_t size = WIDTH * HEIGHT * ((VBI_PIXFMT_PAL8 == fmt) ? 1 : 4);
+	uint8_t *canvas1;
+	uint8_t *canvas2;
+
+	canvas1 = malloc (size);
+	assert (NULL != canvas1);
+	canvas2 = malloc (size);
+	assert (NULL != canvas2);
+
+	draw_page (&new_page, fmt, canvas1, reveal, flash_on);
+
+	/* A region, then the entire page. */
+	memset (canvas2, 0xAA, size);
+	vbi_draw_vt_page_region_cached (atlas, &new_page, canvas2,
+					/* rowstride */ -1,
+					3, 2, 20, 10, reveal, flash_on);
+	vbi_draw_vt_page_region_cached (atlas, &new_page, canvas2,
+					/* rowstride */ -1,
+					0, 0, 40, 25, reveal, flash_on);
+	assert (0 == memcmp (canvas1, canvas2, size));
+
+	free (canvas2);
+	free (canvas1);
+}
+
+static void
+test_atlas			(vbi_pixfmt		fmt)
+{
+	vbi_glyph_atlas *atlas;
+	unsigned int n_tiles;
+
+	init_drcs ();
+	init_page (&new_page);
+
+	/* All attributes the atlas distinguishes or bypasses. */
+	new_page.text[1 * 40 + 2].bold = TRUE;
+	new_page.text[1 * 40 + 3].underline = TRUE;
+	new_page.text[1 * 40 + 4].italic = TRUE;
+	new_page.text[1 * 40 + 5].conceal = TRUE;
+	new_page.text[1 * 40 + 6].flash = TRUE;
+	new_page.text[2 * 40 + 7].size = VBI_DOUBLE_HEIGHT;
+	new_page.text[3 * 40 + 7].size = VBI_DOUBLE_HEIGHT2;
+	new_page.text[2 * 40 + 9].size = VBI_DOUBLE_WIDTH;
+	new_page.text[2 * 40 + 10].size = VBI_OVER_TOP;
+	new_page.text[4 * 40 + 0].opacity = VBI_TRANSPARENT_SPACE;
+	new_page.text[4 * 40 + 1].opacity = VBI_SEMI_TRANSPARENT;
+	new_page.text[4 * 40 + 2].unicode = 0xEE20; /* mosaic */
+
+	atlas = vbi_glyph_atlas_new (fmt, 0);
+	assert (NULL != atlas);
+	assert (0 == vbi_glyph_atlas_num_tiles (atlas));
+
+	compare_cached (atlas, fmt, TRUE, TRUE);
+	n_tiles = vbi_glyph_atlas_num_tiles (atlas);
+	assert (n_tiles > 0);
+
+	/* Now from the atlas. */
+	compare_cached (atlas, fmt, TRUE, TRUE);
+	assert (n_tiles == vbi_glyph_atlas_num_tiles (atlas));
+
+	compare_cached (atlas, fmt, FALSE, FALSE);
+
+	/* Colors are part of the key. */
+	new_page.color_map[3] ^= 0xFFFFFF;
+	compare_cached (atlas, fmt, TRUE, TRUE);
+
+	vbi_glyph_atlas_delete (atlas);
+
+	/* Atlas full. */
+	atlas = vbi_glyph_atlas_new (fmt, 5);
+	assert (NULL != atlas);
+	compare_cached (atlas, fmt, TRUE, TRUE);
+	assert (5 == vbi_glyph_atlas_num_tiles (atlas));
+	vbi_glyph_atlas_delete (atlas);
+
+	/* Read-only. */
+	atlas = vbi_glyph_atlas_new (fmt, 0);
+	assert (NULL != atlas);
+	vbi_glyph_atlas_set_read_only (atlas, TRUE);
+	compare_cached (atlas, fmt, TRUE, TRUE);
+	assert (0 == vbi_glyph_atlas_num_tiles (atlas));
+	vbi_glyph_atlas_delete (atlas);
+}
+
+int
+main				(void)
+{
+	test_update (VBI_PIXFMT_RGBA32_LE);
+	test_update (VBI_PIXFMT_PAL8);
+
+	test_atlas (VBI_PIXFMT_RGBA32_LE);
+	test_atlas (VBI_PIXFMT_PAL8);
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -0,0 +1,398 @@
+/*
+ *  libzvbi -- Subtitle export unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/export.h"
+#include "src/hamm.h"
+#include "src/cc608_decoder.h"
+
+static FILE *			fp;
+static vbi_export *		ex;
+
+static void
+begin				(const char *		keyword)
+{
+	ex = vbi_export_new (keyword, NULL);
+	assert (NULL != ex);
+
+	fp = tmpfile ();
+	assert (NULL != fp);
+
+	assert (vbi_export_begin_stdio (ex, fp));
+}
+
+static void
+end				(const char *		expected)
+{
+	char buffer[4096];
+	size_t size;
+
+	assert (vbi_export_end (ex));
+
+	size = ftell (fp);
+	assert (size < sizeof (buffer));
+
+	rewind (fp);
+	assert (size == fread (buffer, 1, size, fp));
+	buffer[size] = 0;
+
+	if (0 != strcmp (buffer, expected)) {
+		fprintf (stderr, "Expected:\n%s\nGot:\n%s\n",
+			 expected, buffer);
+		assert (0);
+	}
+
+	fclose (fp);
+	fp = NULL;
+
+	vbi_export_delete (ex);
+	ex = NULL;
+}
+
+static void
+set_text			(vbi_char *		text,
+				 unsigned int		n_columns,
+				 unsigned int		column,
+				 const char *		s)
+{
+	unsigned int i;
+
+	for (i = 0; i < n_columns; ++i) {
+		CLEAR (text[i]);
+		text[i].unicode = 0x0020;
+		text[i].opacity = VBI_TRANSPARENT_SPACE;
+	}
+
+	for (i = column; 0 != *s && i < n_columns; ++i) {
+		if ('/' == *s) {
+			/* Italic toggle. */
+			++s;
+			text[i].italic = !text[i - 1].italic;
+		} else if (i > 0) {
+			text[i].italic = text[i - 1].italic;
+		}
+
+		text[i].unicode = *s++;
+		text[i].opacity = VBI_OPAQUE;
+	}
+}
+
+static void
+cc_event			(int			channel,
+				 double			capture_time,
+				 int64_t		pts,
+				 const char *		s)
+{
+	struct _vbi_event_cc608_stream cc;
+	vbi_event ev;
+
+	CLEAR (ev);
+	CLEAR (cc);
+
+	ev.type = _VBI_EVENT_CC608_STREAM;
+	ev.ev._cc608_stream = &cc;
+
+	cc.capture_time = capture_time;
+	cc.pts = pts;
+	cc.channel = channel;
+	cc.mode = _VBI_CC608_MODE_POP_ON;
+
+	set_text (cc.text, N_ELEMENTS (cc.text), 4, s);
+
+	assert (vbi_export_stream_event (ex, &ev));
+}
+
+static void
+cc_events			(void)
+{
+	/* Two rows of a pop-on caption, PTS unknown. */
+	cc_event (1, 100.0, -1, "HELLO");
+	cc_event (1, 100.0, -1, "WORLD");
+
+	/* Other channel. */
+	cc_event (3, 101.0, -1, "IGNORED");
+
+	cc_event (1, 102.5, -1, "/A/ < B & C");
+}
+
+static void
+test_cc_events			(void)
+{
+	vbi_event ev;
+
+	begin ("srt");
+	assert (vbi_export_option_set (ex, "channel", 1));
+	cc_events ();
+	end ("1\n"
+	     "00:00:00,000 --> 00:00:02,500\n"
+	     "HELLO\n"
+	     "WORLD\n"
+	     "\n"
+	     "2\n"
+	     "00:00:02,500 --> 00:00:12,500\n"
+	     "<i>A</i> < B & C\n"
+	     "\n");
+
+	begin ("webvtt");
+	assert (vbi_export_option_set (ex, "channel", 1));
+	assert (vbi_export_option_set (ex, "max_duration", 3));
+	cc_events ();
+	end ("WEBVTT\n"
+	     "\n"
+	     "00:00:00.000 --> 00:00:02.500\n"
+	     "HELLO\n"
+	     "WORLD\n"
+	     "\n"
+	     "00:00:02.500 --> 00:00:05.500\n"
+	     "<i>A</i> &lt; B &amp; C\n"
+	     "\n");
+
+	begin ("ttml");
+	assert (vbi_export_option_set (ex, "channel", 1));
+	cc_events ();
+	end ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	     "<tt xmlns=\"http://www.w3.org/ns/ttml\" "
+	     "xmlns:tts=\"http://www.w3.org/ns/ttml#styling\" "
+	     "xml:lang=\"\">\n"
+	     "<body>\n"
+	     "<div>\n"
+	     "<p begin=\"00:00:00.000\" end=\"00:00:02.500\">"
+	     "HELLO<br/>WORLD</p>\n"
+	     "<p begin=\"00:00:02.500\" end=\"00:00:12.500\">"
+	     "<span tts:fontStyle=\"italic\">A</span> "
+	     "&lt; B &amp; C</p>\n"
+	     "</div>\n"
+	     "</body>\n"
+	     "</tt>\n");
+
+	/* All channels, the last cue is cut short. PTS take
+	   precedence and wrap around. */
+	begin ("srt");
+	cc_event (1, 0.0, ((int64_t) 1 << 33) - 90000, "ONE");
+	cc_event (3, 0.0, 45000, "TWO");
+	end ("1\n"
+	     "00:00:00,000 --> 00:00:01,500\n"
+	     "ONE\n"
+	     "\n"
+	     "2\n"
+	     "00:00:01,500 --> 00:00:11,500\n"
+	     "TWO\n"
+	     "\n");
+
+	/* Other events are ignored. */
+	begin ("webvtt");
+	CLEAR (ev);
+	ev.type = VBI_EVENT_CAPTION;
+	assert (vbi_export_stream_event (ex, &ev));
+	end ("WEBVTT\n\n");
+
+	/* Not supported by this module. */
+	begin ("text");
+	assert (!vbi_export_stream_event (ex, &ev));
+	assert (NULL != vbi_export_errstr (ex));
+	end ("");
+}
+
+static vbi_page			page;
+
+static void
+set_page			(const char *		s1,
+				 const char *		s2)
+{
+	unsigned int row;
+
+	CLEAR (page);
+
+	page.rows = 25;
+	page.columns = 40;
+
+	for (row = 0; row < 25; ++row) {
+		const char *s = "";
+
+		if (22 == row && NULL != s1)
+			s = s1;
+		else if (23 == row && NULL != s2)
+			s = s2;
+
+		set_text (&page.text[row * 40], 40, 10, s);
+	}
+}
+
+static void
+test_pages			(void)
+{
+	void *buffer;
+	size_t size;
+	const char *expected;
+
+	begin ("srt");
+
+	set_page (NULL, NULL);
+	assert (vbi_export_stream_page (ex, &page, 3.0));
+
+	set_page ("First", NULL);
+	assert (vbi_export_stream_page (ex, &page, 5.0));
+
+	/* Repeated. */
+	assert (vbi_export_stream_page (ex, &page, 6.0));
+
+	set_page ("Second", "row");
+	assert (vbi_export_stream_page (ex, &page, 8.25));
+
+	/* Conceal. */
+	page.text[23 * 40 + 11].conceal = TRUE;
+	assert (vbi_export_stream_page (ex, &page, 9.0));
+
+	set_page (NULL, NULL);
+	assert (vbi_export_stream_page (ex, &page, 9.5));
+
+	set_page ("Third", NULL);
+	assert (vbi_export_stream_page (ex, &page, 4000.0));
+
+	end ("1\n"
+	     "00:00:00,000 --> 00:00:03,250\n"
+	     "First\n"
+	     "\n"
+	     "2\n"
+	     "00:00:03,250 --> 00:00:04,000\n"
+	     "Second\n"
+	     "row\n"
+	     "\n"
+	     "3\n"
+	     "00:00:04,000 --> 00:00:04,500\n"
+	     "Second\n"
+	     "r w\n"
+	     "\n"
+	     "4\n"
+	     "01:06:35,000 --> 01:06:45,000\n"
+	     "Third\n"
+	     "\n");
+
+	/* Single page export. */
+	ex = vbi_export_new ("webvtt", NULL);
+	assert (NULL != ex);
+
+	set_page ("Single", NULL);
+
+	buffer = vbi_export_alloc (ex, NULL, &size, &page);
+	assert (NULL != buffer);
+
+	expected = ("WEBVTT\n"
+		    "\n"
+		    "00:00:00.000 --> 00:00:10.000\n"
+		    "Single\n"
+		    "\n");
+	assert (size == strlen (expected));
+	assert (0 == memcmp (buffer, expected, size));
+
+	free (buffer);
+
+	vbi_export_delete (ex);
+	ex = NULL;
+}
+
+static void
+event_handler			(vbi_event *		ev,
+				 void *			user_data)
+{
+	user_data = user_data;
+
+	assert (vbi_export_stream_event (ex, ev));
+}
+
+static void
+feed				(_vbi_cc608_decoder *	cd,
+				 double			capture_time,
+				 unsigned int		c1,
+				 unsigned int		c2)
+{
+	uint8_t buffer[2];
+
+	buffer[0] = vbi_par8 (c1);
+	buffer[1] = vbi_par8 (c2);
+
+	assert (_vbi_cc608_decoder_feed (cd, buffer, 21,
+					 capture_time, /* pts */ -1));
+}
+
+static void
+test_decoder			(void)
+{
+	_vbi_cc608_decoder *cd;
+
+	cd = _vbi_cc608_decoder_new ();
+	assert (NULL != cd);
+
+	assert (_vbi_cc608_decoder_add_event_handler
+		(cd, _VBI_EVENT_CC608_STREAM, event_handler, NULL));
+
+	begin ("srt");
+
+	/* Resume caption loading, text, end of caption. */
+	feed (cd, 1.0, 0x14, 0x20);
+	feed (cd, 1.1, 'H', 'i');
+	feed (cd, 1.2, '!', 0);
+	feed (cd, 2.0, 0x14, 0x2F);
+
+	feed (cd, 2.1, 0x14, 0x20);
+	feed (cd, 2.2, 'B', 'y');
+	feed (cd, 2.3, 'e', 0);
+	feed (cd, 4.0, 0x14, 0x2F);
+
+	end ("1\n"
+	     "00:00:00,000 --> 00:00:02,000\n"
+	     "Hi!\n"
+	     "\n"
+	     "2\n"
+	     "00:00:02,000 --> 00:00:12,000\n"
+	     "Bye\n"
+	     "\n");
+
+	_vbi_cc608_decoder_delete (cd);
+}
+
+int
+main				(void)
+{
+	test_cc_events ();
+	test_pages ();
+	test_decoder ();
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -0,0 +1,229 @@
+/*
+ *  libzvbi -- Export session unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/export.h"
+#include "src/lang.h"
+#include "src/format.h"
+
+#define N_PAGES 5
+
+static vbi_page			pages[N_PAGES];
+
+static void
+init_pages			(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < N_PAGES; ++i) {
+		vbi_page *pg = &pages[i];
+		unsigned int j;
+
+		CLEAR (*pg);
+
+		pg->pgno = 0x100 + i;
+		pg->rows = 25;
+		pg->columns = 40;
+		pg->font[0] = &vbi_font_descriptors[0];
+		pg->font[1] = &vbi_font_descriptors[0];
+
+		for (j = 0; j < 40 * 25; ++j) {
+			vbi_char *ac = &pg->text[j];
+
+			ac->unicode = 0x20 + (j * 7 + i) % 95;
+			if (0 == j % 17)
+				ac->unicode = 0xE9; /* e acute */
+			ac->foreground = (j / 3) % 8;
+			ac->background = (j / 40) % 2 ? VBI_BLACK : VBI_BLUE;
+			ac->opacity = VBI_OPAQUE;
+			ac->size = VBI_NORMAL_SIZE;
+		}
+
+		for (j = 0; j < 40; ++j)
+			pg->color_map[j] = j * 0x050301;
+	}
+}
+
+static void
+test_module			(const char *		keyword)
+{
+	const vbi_page *pgv[N_PAGES];
+	char *expected;
+	size_t expected_size;
+	char *actual;
+	long actual_size;
+	vbi_export *e;
+	FILE *fp;
+	unsigned int i;
+
+	e = vbi_export_new (keyword, NULL);
+	assert (NULL != e);
+
+	/* Reference: each page exported separately. */
+
+	expected = NULL;
+	expected_size = 0;
+
+	for (i = 0; i < N_PAGES; ++i) {
+		void *buffer;
+		size_t size;
+
+		buffer = vbi_export_alloc (e, NULL, &size, &pages[i]);
+		assert (NULL != buffer);
+
+		expected = realloc (expected, expected_size + size);
+		assert (NULL != expected);
+		memcpy (expected + expected_size, buffer, size);
+		expected_size += size;
+
+		free (buffer);
+
+		pgv[i] = &pages[i];
+	}
+
+	fp = tmpfile ();
+	assert (NULL != fp);
+
+	assert (vbi_export_begin_stdio (e, fp));
+
+	/* Only one session at a time. */
+	assert (!vbi_export_begin_stdio (e, fp));
+	assert (-1 == vbi_export_mem (e, NULL, 0, &pages[0]));
+	assert (NULL == vbi_export_alloc (e, NULL, NULL, &pages[0]));
+
+	assert (vbi_export_pages (e, pgv, 2));
+	assert (vbi_export_pages (e, pgv + 2, 0));
+	assert (vbi_export_pages (e, pgv + 2, N_PAGES - 2));
+	assert (vbi_export_end (e));
+
+	assert (!vbi_export_end (e));
+	assert (!vbi_export_pages (e, pgv, 1));
+
+	actual_size = ftell (fp);
+	assert (actual_size == (long) expected_size);
+
+	actual = malloc (actual_size);
+	assert (NULL != actual);
+
+	rewind (fp);
+	assert (1 == fread (actual, actual_size, 1, fp));
+	assert (0 == memcmp (actual, expected, expected_size));
+
+	fclose (fp);
+
+	/* The one-shot functions still work after a session,
+	   and with the retained buffer. */
+	for (i = 0; i < 3; ++i) {
+		void *buffer;
+		size_t size;
+
+		buffer = vbi_export_alloc (e, NULL, &size, &pages[0]);
+		assert (NULL != buffer);
+		assert (0 == memcmp (buffer, expected, size));
+		free (buffer);
+	}
+
+	free (actual);
+	free (expected);
+
+	vbi_export_delete (e);
+}
+
+/* UCS-2 source strings need not be aligned. */
+static void
+test_puts_iconv			(void)
+{
+	char src[1 + 600 * 2];
+	char expected[600 * 2];
+	char actual[600 * 2 + 1];
+	unsigned int expected_size;
+	vbi_export *e;
+	FILE *fp;
+	unsigned int i;
+
+	expected_size = 0;
+
+	for (i = 0; i < 600; ++i) {
+		uint16_t c = (0 == i % 7) ? 0xE9 : 'A' + i % 26;
+
+		memcpy (src + 1 + i * 2, &c, 2);
+
+		if (c < 0x80) {
+			expected[expected_size++] = c;
+		} else {
+			expected[expected_size++] = 0xC0 | (c >> 6);
+			expected[expected_size++] = 0x80 | (c & 0x3F);
+		}
+	}
+
+	e = vbi_export_new ("text", NULL);
+	assert (NULL != e);
+
+	fp = tmpfile ();
+	assert (NULL != fp);
+
+	assert (vbi_export_begin_stdio (e, fp));
+	assert (vbi_export_puts_iconv (e, "UTF-8", "UCS-2",
+				       src + 1, 600 * 2, '?'));
+	assert (vbi_export_end (e));
+
+	assert ((long) expected_size == ftell (fp));
+
+	rewind (fp);
+	assert (expected_size == fread (actual, 1, sizeof (actual), fp));
+	assert (0 == memcmp (actual, expected, expected_size));
+
+	fclose (fp);
+
+	vbi_export_delete (e);
+}
+
+int
+main				(void)
+{
+	init_pages ();
+
+	test_puts_iconv ();
+
+	test_module ("text");
+	test_module ("html");
+	test_module ("ppm");
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
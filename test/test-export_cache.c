@@ -0,0 +1,248 @@
+/*
+ *  libzvbi -- Cache export unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/export.h"
+#include "src/hamm.h"
+#include "src/cache-priv.h"
+#include "src/vbi.h"
+
+/* Stored in reverse order, the export must sort them. */
+static const struct {
+	vbi_pgno		pgno;
+	vbi_subno		subno;
+} test_pages [] = {
+	{ 0x888, 0 },
+	{ 0x150, 2 },
+	{ 0x150, 1 },
+	{ 0x101, 0 },
+	{ 0x100, 0 },
+};
+
+static unsigned int		n_progress;
+static unsigned int		cancel_after;
+
+static void
+put_page			(vbi_decoder *		vbi,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno)
+{
+	static cache_page cp;
+	unsigned int row;
+
+	CLEAR (cp);
+
+	cp.function = PAGE_FUNCTION_LOP;
+	cp.pgno = pgno;
+	cp.subno = subno;
+	cp.lop_packets = (1 << 24) - 1;
+
+	for (row = 1; row < 24; ++row) {
+		/* Room for the whole string, we store the first
+		   40 characters. */
+		char buf[64];
+		unsigned int i;
+
+		snprintf (buf, sizeof (buf),
+			  "Page %03x.%04x row %2u "
+			  "ABCDEFGHIJKLMNOPQRSTUVW",
+			  pgno, subno, row);
+
+		for (i = 0; i < 40; ++i)
+			cp.data.lop.raw[row][i] = vbi_par8 (buf[i]);
+	}
+
+	assert (NULL != _vbi_cache_put_page (vbi->ca, vbi->cn, &cp));
+}
+
+static vbi_bool
+progress			(const vbi_page *	pg,
+				 unsigned int		n_pages_done,
+				 unsigned int		n_pages_total,
+				 void *			user_data)
+{
+	unsigned int i;
+
+	assert (&n_progress == user_data);
+	assert (n_pages_done == n_progress + 1);
+	assert (N_ELEMENTS (test_pages) == n_pages_total);
+
+	i = N_ELEMENTS (test_pages) - 1 - n_progress;
+	assert (test_pages[i].pgno == pg->pgno);
+	assert (test_pages[i].subno == pg->subno);
+
+	++n_progress;
+
+	return (n_progress != cancel_after);
+}
+
+/* Each page exported separately, in ascending order. */
+static char *
+reference			(vbi_decoder *		vbi,
+				 vbi_export *		e,
+				 size_t *		size)
+{
+	char *expected;
+	size_t expected_size;
+	int i;
+
+	expected = NULL;
+	expected_size = 0;
+
+	for (i = N_ELEMENTS (test_pages) - 1; i >= 0; --i) {
+		vbi_page pg;
+		void *buffer;
+		size_t buffer_size;
+
+		assert (vbi_fetch_vt_page (vbi, &pg,
+					   test_pages[i].pgno,
+					   test_pages[i].subno,
+					   vbi->vt.max_level,
+					   25, TRUE));
+
+		buffer = vbi_export_alloc (e, NULL, &buffer_size, &pg);
+		assert (NULL != buffer);
+
+		vbi_unref_page (&pg);
+
+		expected = realloc (expected, expected_size + buffer_size);
+		assert (NULL != expected);
+		memcpy (expected + expected_size, buffer, buffer_size);
+		expected_size += buffer_size;
+
+		free (buffer);
+	}
+
+	*size = expected_size;
+
+	return expected;
+}
+
+static void
+test_module			(vbi_decoder *		vbi,
+				 const char *		keyword)
+{
+	unsigned int n_threads;
+	char *expected;
+	size_t expected_size;
+	vbi_export *e;
+
+	e = vbi_export_new (keyword, NULL);
+	assert (NULL != e);
+
+	expected = reference (vbi, e, &expected_size);
+
+	for (n_threads = 0; n_threads <= 4; ++n_threads) {
+		char *actual;
+		long actual_size;
+		FILE *fp;
+
+		fp = tmpfile ();
+		assert (NULL != fp);
+
+		n_progress = 0;
+		cancel_after = 0;
+
+		assert (vbi_export_cache_stdio (e, vbi, fp, n_threads,
+						progress, &n_progress));
+		assert (N_ELEMENTS (test_pages) == n_progress);
+
+		actual_size = ftell (fp);
+		assert (actual_size == (long) expected_size);
+
+		actual = malloc (actual_size);
+		assert (NULL != actual);
+
+		rewind (fp);
+		assert (1 == fread (actual, actual_size, 1, fp));
+		assert (0 == memcmp (actual, expected, expected_size));
+
+		free (actual);
+
+		/* Cancellation. */
+		rewind (fp);
+
+		n_progress = 0;
+		cancel_after = 2;
+
+		assert (!vbi_export_cache_stdio (e, vbi, fp, n_threads,
+						 progress, &n_progress));
+		assert (2 == n_progress);
+		assert (NULL != vbi_export_errstr (e));
+
+		fclose (fp);
+	}
+
+	free (expected);
+
+	vbi_export_delete (e);
+}
+
+int
+main				(void)
+{
+	vbi_decoder *vbi;
+	vbi_export *e;
+	unsigned int i;
+
+	vbi = vbi_decoder_new ();
+	assert (NULL != vbi);
+
+	e = vbi_export_new ("text", NULL);
+	assert (NULL != e);
+
+	/* Empty cache. */
+	n_progress = 0;
+	assert (vbi_export_cache_stdio (e, vbi, stdout, 2,
+					progress, &n_progress));
+	assert (0 == n_progress);
+
+	vbi_export_delete (e);
+
+	for (i = 0; i < N_ELEMENTS (test_pages); ++i)
+		put_page (vbi, test_pages[i].pgno, test_pages[i].subno);
+
+	test_module (vbi, "text");
+	test_module (vbi, "html");
+	test_module (vbi, "ppm");
+
+	vbi_decoder_delete (vbi);
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -0,0 +1,256 @@
+/*
+ *  libzvbi -- DVB capture interface unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "src/misc.h"
+#include "src/io.h"
+#include "src/dvb_mux.h"
+
+#define N_FRAMES 50
+
+/* PES stream of N_FRAMES frames. */
+static uint8_t *		stream;
+static unsigned int		stream_size;
+static unsigned int		frame_offset[N_FRAMES];
+
+static vbi_bool
+pes_callback			(vbi_dvb_mux *		mx,
+				 void *			user_data,
+				 const uint8_t *	packet,
+				 unsigned int		packet_size)
+{
+	mx = mx; /* unused */
+	user_data = user_data;
+
+	stream = realloc (stream, stream_size + packet_size);
+	assert (NULL != stream);
+
+	memcpy (stream + stream_size, packet, packet_size);
+	stream_size += packet_size;
+
+	return TRUE;
+}
+
+static void
+make_sliced			(vbi_sliced *		s,
+				 unsigned int		frame)
+{
+	memset (s, 0, sizeof (*s));
+
+	s->id = VBI_SLICED_TELETEXT_B;
+	s->line = 7;
+	memset (s->data, 0x40 + frame, 42);
+}
+
+static void
+make_stream			(void)
+{
+	vbi_dvb_mux *mx;
+	vbi_sliced s;
+	unsigned int i;
+
+	mx = vbi_dvb_pes_mux_new (pes_callback, /* user_data */ NULL);
+	assert (NULL != mx);
+
+	for (i = 0; i < N_FRAMES; ++i) {
+		frame_offset[i] = stream_size;
+		make_sliced (&s, i);
+		assert (vbi_dvb_mux_feed (mx, &s, 1, VBI_SLICED_TELETEXT_B,
+					  /* raw */ NULL, /* sp */ NULL,
+					  /* pts */ i * 3600));
+	}
+
+	vbi_dvb_mux_delete (mx);
+}
+
+/* Reads frames first .. last - 1 and checks their contents,
+   capture times and frame counters. */
+static void
+read_frames			(vbi_capture *		cap,
+				 unsigned int		first,
+				 unsigned int		last,
+				 vbi_capture_buffer *	last_buffer)
+{
+	vbi_sliced s;
+	unsigned int i;
+
+	for (i = first; i < last; ++i) {
+		vbi_capture_buffer *b;
+		const vbi_sliced *data;
+		struct timeval tv;
+
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+
+		b = NULL;
+		assert (1 == vbi_capture_pull_sliced (cap, &b, &tv));
+		assert (NULL != b);
+		assert (sizeof (vbi_sliced) == (size_t) b->size);
+
+		data = (const vbi_sliced *) b->data;
+		make_sliced (&s, i);
+		assert (s.id == data[0].id);
+		assert (s.line == data[0].line);
+		assert (0 == memcmp (s.data, data[0].data, 42));
+
+		assert ((int64_t)(i * 3600) == vbi_capture_dvb_last_pts (cap));
+		assert ((int64_t)(i * 3600) == b->stream_time);
+
+		/* No frames are missing. */
+		if (i > 0)
+			assert (last_buffer->sequence + 1 == b->sequence);
+
+		/* Frames returned by one read() are timestamped
+		   along the PTS clock, but never later than the
+		   read() and never going backwards. */
+		assert (b->timestamp >= last_buffer->timestamp);
+		assert (b->monotonic_time >= last_buffer->monotonic_time);
+		assert (b->monotonic_time > 0);
+
+		*last_buffer = *b;
+	}
+}
+
+static void
+test_file			(void)
+{
+	char file_name[] = "/tmp/test-io_dvb.XXXXXX";
+	vbi_capture *cap;
+	char *errstr;
+	struct timeval tv;
+	vbi_capture_buffer last_buffer;
+	double timestamp;
+	vbi_sliced data[128];
+	int n_lines;
+	int fd;
+
+	fd = mkstemp (file_name);
+	assert (-1 != fd);
+	assert ((ssize_t) stream_size == write (fd, stream, stream_size));
+	close (fd);
+
+	cap = vbi_capture_dvb_new2 (file_name, /* pid */ 0,
+				    &errstr, /* trace */ FALSE);
+	assert (NULL != cap);
+
+	/* Not a device. */
+	assert (0 == (vbi_capture_get_fd_flags (cap) & VBI_FD_IS_DEVICE));
+
+	/* All frames in one read(). */
+	assert (0 == vbi_capture_dvb_set_buffer_size (cap, 1 << 20));
+
+	CLEAR (last_buffer);
+	read_frames (cap, 0, N_FRAMES - 1, &last_buffer);
+
+	/* The last frame is incomplete until the next one starts. */
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	errno = EINVAL;
+	assert (-1 == vbi_capture_read_sliced (cap, data, &n_lines,
+					       &timestamp, &tv));
+	assert (0 == errno); /* end of file */
+
+	vbi_capture_delete (cap);
+
+	unlink (file_name);
+}
+
+static void
+test_pipe			(void)
+{
+	char dev_name[40];
+	vbi_capture *cap;
+	char *errstr;
+	struct timeval tv;
+	vbi_capture_buffer last_buffer;
+	double timestamp;
+	vbi_sliced data[128];
+	unsigned int half;
+	int fds[2];
+	int n_lines;
+
+	assert (0 == pipe (fds));
+
+	/* Pipes hold at least 64 KiB on Linux, so this won't block. */
+	assert (stream_size < 65536);
+	half = frame_offset[N_FRAMES / 2];
+	assert ((ssize_t) half == write (fds[1], stream, half));
+
+	snprintf (dev_name, sizeof (dev_name), "/dev/fd/%d", fds[0]);
+	cap = vbi_capture_dvb_new2 (dev_name, /* pid */ 0,
+				    &errstr, /* trace */ FALSE);
+	assert (NULL != cap);
+	close (fds[0]);
+
+	CLEAR (last_buffer);
+	read_frames (cap, 0, N_FRAMES / 2 - 1, &last_buffer);
+
+	/* No more data but the writer is still connected. */
+	tv.tv_sec = 0;
+	tv.tv_usec = 20000;
+	assert (0 == vbi_capture_read_sliced (cap, data, &n_lines,
+					      &timestamp, &tv));
+
+	/* Resizing must keep data not demultiplexed yet. */
+	assert (0 == vbi_capture_dvb_set_buffer_size (cap, 1 << 16));
+
+	assert ((ssize_t)(stream_size - half)
+		== write (fds[1], stream + half, stream_size - half));
+	close (fds[1]);
+
+	read_frames (cap, N_FRAMES / 2 - 1, N_FRAMES - 1, &last_buffer);
+
+	vbi_capture_delete (cap);
+}
+
+int
+main				(void)
+{
+#ifdef ENABLE_DVB
+	make_stream ();
+
+	test_file ();
+	test_pipe ();
+
+	free (stream);
+#endif
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
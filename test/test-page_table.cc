@@ -0,0 +1,313 @@
+/*
+ *  libzvbi -- Teletext page number table unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>		/* mrand48() */
+#include <string.h>
+
+#include "src/page_table.h"
+
+#define N_ELEMENTS(array) (sizeof (array) / sizeof (*(array)))
+
+#define MAX_SUBNO 0x3F7E
+
+/* Subpage numbers 0 ... N_LOW_SUBNOS - 1 are modelled individually,
+   all higher subpage numbers share one flag. */
+#define N_LOW_SUBNOS 64
+
+/* Pages at the edges of the bitmap words. */
+static const vbi_pgno
+test_pgnos [] = {
+	0x100, 0x101, 0x11F, 0x120, 0x3FF, 0x500, 0x8FE, 0x8FF
+};
+
+struct ref_page {
+	bool			low[N_LOW_SUBNOS];
+	bool			high;
+};
+
+static ref_page			ref[N_ELEMENTS (test_pgnos)];
+
+static void
+ref_set				(unsigned int		n,
+				 vbi_subno		first_subno,
+				 vbi_subno		last_subno,
+				 bool			value)
+{
+	vbi_subno subno;
+
+	for (subno = first_subno; subno <= last_subno
+		     && subno < N_LOW_SUBNOS; ++subno)
+		ref[n].low[subno] = value;
+
+	if (last_subno >= N_LOW_SUBNOS)
+		ref[n].high = value;
+}
+
+static bool
+ref_all				(unsigned int		n)
+{
+	unsigned int i;
+
+	for (i = 0; i < N_LOW_SUBNOS; ++i)
+		if (!ref[n].low[i])
+			return false;
+
+	return ref[n].high;
+}
+
+static bool
+ref_any				(unsigned int		n)
+{
+	unsigned int i;
+
+	for (i = 0; i < N_LOW_SUBNOS; ++i)
+		if (ref[n].low[i])
+			return true;
+
+	return ref[n].high;
+}
+
+/* The iteration skipped subpages from_subno ... to_subno - 1 of
+   test page n. Asserts none of them are in the reference. */
+static void
+assert_no_subpages_from		(unsigned int		n,
+				 vbi_subno		from_subno,
+				 vbi_subno		to_subno = N_LOW_SUBNOS + 1)
+{
+	vbi_subno s;
+
+	for (s = from_subno; s < to_subno && s < N_LOW_SUBNOS; ++s)
+		assert (!ref[n].low[s]);
+
+	if (to_subno > N_LOW_SUBNOS && from_subno <= N_LOW_SUBNOS)
+		assert (!ref[n].high);
+}
+
+static void
+assert_consistent		(const vbi_page_table *pt)
+{
+	vbi_pgno pgno;
+	vbi_subno subno;
+	vbi_subno from_subno;
+	unsigned int n_pages;
+	unsigned int i;
+	int last_n;
+
+	n_pages = 0;
+
+	for (i = 0; i < N_ELEMENTS (test_pgnos); ++i) {
+		vbi_subno s;
+
+		pgno = test_pgnos[i];
+
+		assert (ref_any (i) == !!vbi_page_table_contains_page
+			(pt, pgno));
+		assert (ref_all (i) == !!vbi_page_table_contains_all_subpages
+			(pt, pgno));
+
+		for (s = 0; s < N_LOW_SUBNOS; ++s) {
+			assert (ref[i].low[s]
+				== !!vbi_page_table_contains_subpage
+				(pt, pgno, s));
+		}
+
+		assert (ref[i].high == !!vbi_page_table_contains_subpage
+			(pt, pgno, N_LOW_SUBNOS));
+		assert (ref[i].high == !!vbi_page_table_contains_subpage
+			(pt, pgno, MAX_SUBNO));
+
+		n_pages += ref_any (i);
+	}
+
+	assert (n_pages == vbi_page_table_num_pages (pt));
+
+	assert (!vbi_page_table_contains_page (pt, 0x0FF));
+	assert (!vbi_page_table_contains_page (pt, 0x900));
+
+	/* Iterate over all subpages and compare. */
+
+	pgno = 0;
+	subno = 0;
+	last_n = -1;
+	from_subno = 0;
+
+	while (vbi_page_table_next_subpage (pt, &pgno, &subno)) {
+		int n;
+
+		for (n = 0; n < (int) N_ELEMENTS (test_pgnos); ++n)
+			if (test_pgnos[n] == pgno)
+				break;
+
+		assert (n < (int) N_ELEMENTS (test_pgnos));
+		assert (n >= last_n);
+
+		if (n != last_n) {
+			if (last_n >= 0)
+				assert_no_subpages_from (last_n, from_subno);
+			while (++last_n < n)
+				assert (!ref_any (last_n));
+			from_subno = 0;
+		}
+
+		if (VBI_ANY_SUBNO == subno) {
+			assert (ref_all (n));
+			from_subno = N_LOW_SUBNOS + 1;
+		} else if (subno >= N_LOW_SUBNOS) {
+			assert (!ref_all (n));
+			assert (ref[n].high);
+			assert_no_subpages_from (n, from_subno, N_LOW_SUBNOS);
+			from_subno = N_LOW_SUBNOS + 1;
+
+			/* Skip to the next page. */
+			subno = VBI_ANY_SUBNO;
+		} else {
+			assert (!ref_all (n));
+			assert (ref[n].low[subno]);
+			assert_no_subpages_from (n, from_subno, subno);
+			from_subno = subno + 1;
+		}
+	}
+
+	if (last_n >= 0)
+		assert_no_subpages_from (last_n, from_subno);
+	while (++last_n < (int) N_ELEMENTS (test_pgnos))
+		assert (!ref_any (last_n));
+
+	pgno = 0;
+	n_pages = 0;
+
+	while (vbi_page_table_next_page (pt, &pgno))
+		++n_pages;
+
+	assert (n_pages == vbi_page_table_num_pages (pt));
+}
+
+static vbi_subno
+rand_subno			(void)
+{
+	switch (mrand48 () & 7) {
+	case 0:
+		return 0;
+	case 1:
+		return MAX_SUBNO;
+	default:
+		return (mrand48 () & 0x7FFFFFFF) % N_LOW_SUBNOS;
+	}
+}
+
+int
+main				(void)
+{
+	vbi_page_table *pt;
+	unsigned int i;
+
+	pt = vbi_page_table_new ();
+	assert (NULL != pt);
+
+	assert (0 == vbi_page_table_num_pages (pt));
+	assert_consistent (pt);
+
+	assert (!vbi_page_table_add_page (pt, 0x0FF));
+	assert (!vbi_page_table_add_page (pt, 0x900));
+	assert (!vbi_page_table_add_subpage (pt, 0x100, MAX_SUBNO + 2));
+
+	vbi_page_table_add_all_pages (pt);
+	assert (0x800 == vbi_page_table_num_pages (pt));
+
+	vbi_page_table_remove_all_pages (pt);
+	assert (0 == vbi_page_table_num_pages (pt));
+
+	vbi_page_table_add_all_displayable_pages (pt);
+	assert (800 == vbi_page_table_num_pages (pt));
+	assert (vbi_page_table_contains_page (pt, 0x899));
+	assert (!vbi_page_table_contains_page (pt, 0x1FF));
+
+	vbi_page_table_remove_all_pages (pt);
+
+	for (i = 0; i < 20000; ++i) {
+		vbi_subno first_subno;
+		vbi_subno last_subno;
+		unsigned int n;
+		vbi_pgno pgno;
+
+		n = (mrand48 () & 0x7FFFFFFF) % N_ELEMENTS (test_pgnos);
+		pgno = test_pgnos[n];
+
+		first_subno = rand_subno ();
+		last_subno = rand_subno ();
+
+		/* The reference cannot model single high subpages. */
+		if (MIN (first_subno, last_subno) >= N_LOW_SUBNOS)
+			first_subno = N_LOW_SUBNOS;
+
+		switch (mrand48 () & 7) {
+		case 0:
+			assert (vbi_page_table_add_page (pt, pgno));
+			ref_set (n, 0, MAX_SUBNO, true);
+			break;
+
+		case 1:
+			assert (vbi_page_table_remove_page (pt, pgno));
+			ref_set (n, 0, MAX_SUBNO, false);
+			break;
+
+		case 2:
+		case 3:
+		case 4:
+			assert (vbi_page_table_add_subpages
+				(pt, pgno, first_subno, last_subno));
+			if (first_subno > last_subno)
+				ref_set (n, last_subno, first_subno, true);
+			else
+				ref_set (n, first_subno, last_subno, true);
+			break;
+
+		default:
+			assert (vbi_page_table_remove_subpages
+				(pt, pgno, first_subno, last_subno));
+			if (first_subno > last_subno)
+				ref_set (n, last_subno, first_subno, false);
+			else
+				ref_set (n, first_subno, last_subno, false);
+			break;
+		}
+
+		assert_consistent (pt);
+	}
+
+	vbi_page_table_delete (pt);
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
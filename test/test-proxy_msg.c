@@ -0,0 +1,224 @@
+/*
+ *  libzvbi -- VBI proxy message encoding unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/vbi.h"
+#include "src/io.h"
+#include "src/proxy-msg.h"
+
+#define N_LINES 6
+#define RAW_SIZE 100
+
+static vbi_sliced		lines[N_LINES];
+static uint8_t			raw[RAW_SIZE];
+
+static VBIPROXY_SLICED_COMPACT_IND *msg;
+static uint32_t			msg_size;
+
+static void
+init_lines			(void)
+{
+	static const unsigned int ids[N_LINES] = {
+		VBI_SLICED_TELETEXT_B,
+		VBI_SLICED_VPS,
+		VBI_SLICED_CAPTION_525,
+		VBI_SLICED_WSS_625,
+		/* Not in the table of service codes. */
+		VBI_SLICED_VBI_625,
+		VBI_SLICED_TELETEXT_B,
+	};
+	unsigned int i;
+
+	for (i = 0; i < N_LINES; ++i) {
+		unsigned int bits;
+		unsigned int j;
+
+		CLEAR (lines[i]);
+
+		lines[i].id = ids[i];
+		lines[i].line = 7 + i * 51;
+
+		bits = vbi_sliced_payload_bits (ids[i]);
+		if (0 == bits)
+			bits = sizeof (lines[i].data) * 8;
+
+		/* The decoder clears the bytes beyond the payload. */
+		for (j = 0; j < (bits + 7) / 8; ++j)
+			lines[i].data[j] = i * 37 + j;
+	}
+
+	for (i = 0; i < RAW_SIZE; ++i)
+		raw[i] = i ^ 0x5A;
+}
+
+static void
+encode				(unsigned int		max_lines,
+				 unsigned int		services,
+				 const uint8_t *	raw_data,
+				 uint32_t		raw_size)
+{
+	msg_size = vbi_proxy_msg_encode_sliced (msg, lines, N_LINES,
+						max_lines, services,
+						raw_data, raw_size);
+
+	assert (msg_size >= VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE);
+	assert (msg_size <= VBIPROXY_SLICED_COMPACT_IND_MAX_SIZE
+		(N_LINES, RAW_SIZE));
+}
+
+static void
+test_round_trip			(void)
+{
+	vbi_sliced out[N_LINES];
+	const uint8_t *raw_data;
+	unsigned int n_lines;
+	unsigned int i;
+
+	encode (N_LINES, -1, raw, RAW_SIZE);
+	assert (N_LINES == msg->sliced_lines);
+	assert (RAW_SIZE == msg->raw_size);
+
+	assert (vbi_proxy_msg_decode_sliced (msg, msg_size, out, N_LINES,
+					     &n_lines, &raw_data));
+	assert (N_LINES == n_lines);
+	for (i = 0; i < N_LINES; ++i) {
+		assert (out[i].id == lines[i].id);
+		assert (out[i].line == lines[i].line);
+		assert (0 == memcmp (out[i].data, lines[i].data,
+				     sizeof (out[i].data)));
+	}
+	assert (NULL != raw_data);
+	assert (0 == memcmp (raw_data, raw, RAW_SIZE));
+
+	/* Lines beyond max_lines are skipped. */
+	assert (vbi_proxy_msg_decode_sliced (msg, msg_size, out, 2,
+					     &n_lines, &raw_data));
+	assert (2 == n_lines);
+	assert (0 == memcmp (raw_data, raw, RAW_SIZE));
+
+	/* Only the requested services, without raw data. */
+	encode (N_LINES, VBI_SLICED_TELETEXT_B, NULL, 0);
+	assert (2 == msg->sliced_lines);
+	assert (0 == msg->raw_size);
+
+	assert (vbi_proxy_msg_decode_sliced (msg, msg_size, out, N_LINES,
+					     &n_lines, &raw_data));
+	assert (2 == n_lines);
+	assert (out[0].line == lines[0].line);
+	assert (out[1].line == lines[5].line);
+	assert (NULL == raw_data);
+
+	encode (1, -1, NULL, 0);
+	assert (1 == msg->sliced_lines);
+
+	/* No lines at all. */
+	encode (N_LINES, 0, raw, RAW_SIZE);
+	assert (0 == msg->sliced_lines);
+	assert (VBIPROXY_SLICED_COMPACT_IND_HEAD_SIZE + RAW_SIZE == msg_size);
+	assert (vbi_proxy_msg_decode_sliced (msg, msg_size, out, N_LINES,
+					     &n_lines, &raw_data));
+	assert (0 == n_lines);
+	assert (0 == memcmp (raw_data, raw, RAW_SIZE));
+}
+
+static vbi_bool
+decode				(uint32_t		body_size)
+{
+	vbi_sliced out[N_LINES];
+	const uint8_t *raw_data;
+	unsigned int n_lines;
+
+	return vbi_proxy_msg_decode_sliced (msg, body_size, out, N_LINES,
+					    &n_lines, &raw_data);
+}
+
+static void
+test_malformed			(void)
+{
+	uint32_t size;
+	uint32_t saved;
+
+	encode (N_LINES, -1, raw, RAW_SIZE);
+
+	/* Truncated, with and without raw data. */
+	for (size = 0; size < msg_size; ++size)
+		assert (!decode (size));
+
+	encode (N_LINES, -1, NULL, 0);
+
+	for (size = 0; size < msg_size; ++size)
+		assert (!decode (size));
+
+	/* Oversized. */
+	assert (!decode (msg_size + 1));
+
+	saved = msg->raw_size;
+	msg->raw_size = 0xFFFFFFFF;
+	assert (!decode (msg_size));
+	msg->raw_size = saved;
+
+	saved = msg->sliced_lines;
+	msg->sliced_lines = saved + 1;
+	assert (!decode (msg_size));
+	msg->sliced_lines = 0xFFFFFFFF;
+	assert (!decode (msg_size));
+	msg->sliced_lines = saved;
+
+	/* Invalid service code. */
+	msg->data[0] = 0xFF;
+	assert (!decode (msg_size));
+}
+
+int
+main				(void)
+{
+	msg = malloc (VBIPROXY_SLICED_COMPACT_IND_MAX_SIZE
+		      (N_LINES, RAW_SIZE));
+	assert (NULL != msg);
+
+	init_lines ();
+
+	test_round_trip ();
+	test_malformed ();
+
+	free (msg);
+	msg = NULL;
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
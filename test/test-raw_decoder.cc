@@ -395,6 +395,174 @@ compare_sliced			(const vbi_sampling_par *sp,
 	in1 = NULL;
 }
 
+/* Returns the number of samples examined in search of a CRI. */
+static uint64_t
+cri_samples			(const vbi3_raw_decoder *rd,
+				 const vbi_sampling_par *sp)
+{
+	vbi3_raw_decoder_line_stats stats;
+	unsigned int scan_lines;
+	uint64_t sum;
+	unsigned int i;
+
+	scan_lines = sp->count[0] + sp->count[1];
+
+	sum = 0;
+
+	for (i = 0; i < scan_lines; ++i) {
+		assert (vbi3_raw_decoder_get_line_stats (rd, &stats, i));
+		sum += stats.cri_samples;
+	}
+
+	assert (!vbi3_raw_decoder_get_line_stats (rd, &stats, scan_lines));
+
+	return sum;
+}
+
+/* Adaptive mode must not change the result, and once it knows
+   where the CRI is it must search less. */
+static void
+test_adaptive			(const vbi_sampling_par *sp,
+				 const block *		b,
+				 const uint8_t *	raw,
+				 const vbi_sliced *	ref,
+				 unsigned int		ref_lines,
+				 unsigned int		strict)
+{
+	vbi_sliced out[50];
+	vbi3_raw_decoder *rd;
+	uint64_t full;
+	unsigned int i;
+
+	rd = create_decoder (sp, b, strict);
+
+	/* Learn. */
+	assert (ref_lines == vbi3_raw_decoder_decode (rd, out, 40, raw));
+	full = cri_samples (rd, sp);
+
+	vbi3_raw_decoder_set_adaptive (rd, TRUE);
+	vbi3_raw_decoder_reset_stats (rd);
+
+	assert (ref_lines == vbi3_raw_decoder_decode (rd, out, 40, raw));
+
+	for (i = 0; i < ref_lines; ++i) {
+		assert (ref[i].id == out[i].id);
+		assert (ref[i].line == out[i].line);
+		compare_payload (&ref[i], &out[i]);
+	}
+
+	assert (cri_samples (rd, sp) <= full);
+
+	vbi3_raw_decoder_delete (rd);
+}
+
+static void
+test_metrics			(const vbi_sampling_par *sp,
+				 const block *		b,
+				 const uint8_t *	raw,
+				 const vbi_sliced *	ref,
+				 unsigned int		ref_lines,
+				 unsigned int		strict)
+{
+	vbi3_raw_decoder_metrics m;
+	vbi_sliced out[50];
+	vbi3_raw_decoder *rd;
+	uint8_t *blank;
+	unsigned int n_rows;
+	unsigned int rows[50];
+	unsigned int row;
+	unsigned int i;
+
+	if (!sp->synchronous)
+		return;
+
+	n_rows = sp->count[0] + sp->count[1];
+
+	rd = create_decoder (sp, b, strict);
+
+	assert (!vbi3_raw_decoder_get_metrics (rd, &m, 0, ~0));
+	assert (vbi3_raw_decoder_set_metrics (rd, TRUE));
+
+	for (i = 0; i < 3; ++i) {
+		assert (ref_lines
+			== vbi3_raw_decoder_decode (rd, out, 40, raw));
+	}
+
+	for (i = 0; i < ref_lines; ++i) {
+		unsigned int n_eye;
+		unsigned int n_amplitude;
+		unsigned int n_jitter;
+		unsigned int j;
+
+		if (sp->count[1] > 0
+		    && ref[i].line >= (unsigned int) sp->start[1])
+			row = ref[i].line - sp->start[1] + sp->count[0];
+		else
+			row = ref[i].line - sp->start[0];
+
+		rows[i] = row;
+
+		assert (vbi3_raw_decoder_get_metrics (rd, &m, row,
+						      ref[i].id));
+		assert (3 == m.n_frames);
+		assert (0 == m.n_lost);
+
+		n_eye = 0;
+		n_amplitude = 0;
+		n_jitter = 0;
+
+		for (j = 0; j < VBI3_RAW_DECODER_HIST_BINS; ++j) {
+			n_eye += m.eye[j];
+			n_amplitude += m.amplitude[j];
+			n_jitter += m.jitter[j];
+		}
+
+		/* The CRI position of the first frame is not
+		   compared. */
+		assert (2 == n_jitter);
+
+		/* Not measured in all sample formats. */
+		assert (0 == n_eye || 3 == n_eye);
+		assert (n_eye == n_amplitude);
+	}
+
+	blank = (uint8_t *) calloc (n_rows, sp->bytes_per_line);
+	assert (NULL != blank);
+
+	/* Data lost. Only the first frame without data counts. */
+	for (i = 0; i < 2; ++i)
+		assert (0 == vbi3_raw_decoder_decode (rd, out, 40, blank));
+
+	for (i = 0; i < ref_lines; ++i) {
+		assert (vbi3_raw_decoder_get_metrics (rd, &m, rows[i],
+						      ref[i].id));
+		assert (1 == m.n_lost);
+	}
+
+	vbi3_raw_decoder_delete (rd);
+
+	/* No losses on rows which never contained data. */
+	rd = create_decoder (sp, b, strict);
+	assert (vbi3_raw_decoder_set_metrics (rd, TRUE));
+
+	for (i = 0; i < 2; ++i)
+		assert (0 == vbi3_raw_decoder_decode (rd, out, 40, blank));
+
+	for (row = 0; row < n_rows; ++row) {
+		vbi_service_set service;
+
+		for (service = 1; 0 != service; service <<= 1) {
+			if (vbi3_raw_decoder_get_metrics (rd, &m, row,
+							  service))
+				assert (0 == m.n_lost);
+		}
+	}
+
+	free (blank);
+
+	vbi3_raw_decoder_delete (rd);
+}
+
 static void
 test_cycle			(const vbi_sampling_par *sp,
 				 const block *		b,
@@ -447,6 +615,9 @@ test_cycle			(const vbi_sampling_par *sp,
 
 	vbi3_raw_decoder_delete (rd);
 
+	test_adaptive (sp, b, raw, out, out_lines, strict);
+	test_metrics (sp, b, raw, out, out_lines, strict);
+
 	free (in);
 	free (raw);
 }
@@ -0,0 +1,744 @@
+/*
+ *  libzvbi -- Sliced VBI recording reader and writer unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "src/misc.h"
+#include "src/hamm.h"
+#include "src/dvb_mux.h"
+#include "src/sliced_file.h"
+
+#define N_FRAMES 600
+
+/* The network changes here. */
+#define SWITCH_FRAME 300
+
+/* Every nth frame contains a Teletext page header. */
+#define HEADER_INTERVAL 10
+
+static char			file_name[] = "test-sliced_file-XXXXXX";
+static char			index_file_name[64];
+
+static double			frame_time[N_FRAMES];
+
+/* Offset of the first frame. */
+static int64_t			data_offset;
+
+/* Read with _vbi_sliced_file_get_frame() instead of
+   _vbi_sliced_file_read_frame(). */
+static vbi_bool			get_frame;
+
+static unsigned int
+make_frame			(vbi_sliced *		sliced,
+				 unsigned int		frame)
+{
+	unsigned int packet;
+	unsigned int cni;
+	unsigned int i;
+
+	/* Teletext, carrying the frame number. */
+	packet = (0 == frame % HEADER_INTERVAL) ? 0 : 1 + frame % 20;
+
+	CLEAR (sliced[0]);
+	sliced[0].id = VBI_SLICED_TELETEXT_B;
+	sliced[0].line = 7;
+	sliced[0].data[0] = vbi_ham8 (1 | ((packet & 1) << 3));
+	sliced[0].data[1] = vbi_ham8 (packet >> 1);
+	for (i = 2; i < 42; ++i)
+		sliced[0].data[i] = vbi_par8 (0x20 + (frame + i) % 0x5F);
+	sliced[0].data[2] = frame & 0xFF;
+	sliced[0].data[3] = frame >> 8;
+
+	/* VPS with the CNI of the current network. */
+	cni = (frame < SWITCH_FRAME) ? 0x0DC1 : 0x0D75;
+
+	CLEAR (sliced[1]);
+	sliced[1].id = VBI_SLICED_VPS;
+	sliced[1].line = 16;
+	sliced[1].data[8] = cni & 0xC0;
+	sliced[1].data[10] = (cni >> 10) & 0x03;
+	sliced[1].data[11] = ((cni >> 2) & 0xC0) | (cni & 0x3F);
+
+	return 2;
+}
+
+static void
+write_old_sliced		(int			fd)
+{
+	FILE *fp;
+	unsigned int frame;
+	double t;
+
+	fp = fdopen (fd, "wb");
+	assert (NULL != fp);
+
+	t = 0.0;
+
+	for (frame = 0; frame < N_FRAMES; ++frame) {
+		vbi_sliced sliced[2];
+		unsigned int n_lines;
+		unsigned int i;
+		double dt;
+		char buf[32];
+
+		n_lines = make_frame (sliced, frame);
+
+		/* A time gap, and a negative time delta as written
+		   by some versions of the capture tool. */
+		if (450 == frame)
+			dt = 5.0;
+		else if (frame & 1)
+			dt = -0.04;
+		else
+			dt = 0.04;
+
+		/* The reader must see the same rounded value. */
+		snprintf (buf, sizeof (buf), "%f", dt);
+		t += fabs (strtod (buf, NULL));
+		frame_time[frame] = t;
+
+		fprintf (fp, "%s\n%c", buf,
+			 n_lines + (0 == frame % 7));
+
+		for (i = 0; i < n_lines; ++i) {
+			putc ((sliced[i].id == VBI_SLICED_VPS) ? 2 : 0, fp);
+			putc (sliced[i].line & 0xFF, fp);
+			putc (sliced[i].line >> 8, fp);
+			fwrite (sliced[i].data, 1,
+				(sliced[i].id == VBI_SLICED_VPS) ? 13 : 42,
+				fp);
+		}
+
+		if (0 == frame % 7) {
+			static const uint8_t sp[22] = {
+				0x71, 0x02,		/* 625 */
+				0, 0, 0, 0,		/* sampling_rate */
+				4, 0,			/* samples */
+				4, 0,			/* bytes_per_line */
+				0, 0, 6, 0, 0x3F, 1,	/* offset, start */
+				2, 0, 1, 0,		/* count */
+				1, 0 };
+
+			/* Raw data, three lines of four bytes. */
+			putc (255, fp);
+			putc (0, fp);
+			putc (0, fp);
+			fwrite (sp, 1, sizeof (sp), fp);
+			fwrite ("0123456789AB", 1, 12, fp);
+		}
+	}
+
+	assert (0 == fclose (fp));
+}
+
+static vbi_bool
+pes_cb				(vbi_dvb_mux *		mx,
+				 void *			user_data,
+				 const uint8_t *	packet,
+				 unsigned int		packet_size)
+{
+	FILE *fp = user_data;
+
+	mx = mx; /* unused */
+
+	assert (packet_size == fwrite (packet, 1, packet_size, fp));
+
+	return TRUE;
+}
+
+static void
+write_pes			(int			fd)
+{
+	vbi_dvb_mux *mx;
+	FILE *fp;
+	unsigned int frame;
+
+	fp = fdopen (fd, "wb");
+	assert (NULL != fp);
+
+	mx = vbi_dvb_pes_mux_new (pes_cb, fp);
+	assert (NULL != mx);
+
+	for (frame = 0; frame < N_FRAMES; ++frame) {
+		vbi_sliced sliced[2];
+		unsigned int n_lines;
+		int64_t pts;
+
+		n_lines = make_frame (sliced, frame);
+		pts = 3600 * (int64_t) frame + 90000;
+		frame_time[frame] = pts * (1 / 90000.0);
+
+		assert (vbi_dvb_mux_feed (mx, sliced, n_lines,
+					  (vbi_service_set) -1,
+					  /* raw */ NULL,
+					  /* sp */ NULL, pts));
+	}
+
+	vbi_dvb_mux_delete (mx);
+
+	assert (0 == fclose (fp));
+}
+
+static void
+write_compact			(int			fd)
+{
+	_vbi_sliced_writer *w;
+	unsigned int frame;
+	double t;
+
+	w = _vbi_sliced_writer_new_fd (fd, /* close_fd */ TRUE);
+	assert (NULL != w);
+
+	_vbi_sliced_writer_set_block_interval (w, 0.5);
+
+	/* Times with microsecond resolution are stored exactly. */
+	t = 1000.0;
+
+	for (frame = 0; frame < N_FRAMES; ++frame) {
+		vbi_sliced sliced[3];
+		unsigned int n_lines;
+
+		n_lines = make_frame (sliced, frame);
+
+		/* Not stored. */
+		CLEAR (sliced[n_lines]);
+		sliced[n_lines].id = VBI_SLICED_CAPTION_525;
+		sliced[n_lines].line = 21;
+		sliced[n_lines].data[0] = 0x80;
+		sliced[n_lines].data[1] = 0x80;
+		++n_lines;
+
+		t += (450 == frame) ? 5.0 : 1 / 64.0;
+		frame_time[frame] = t;
+
+		assert (_vbi_sliced_writer_write_frame
+			(w, sliced, n_lines, t, (int64_t)(t * 90000)));
+	}
+
+	assert (_vbi_sliced_writer_finish (w));
+	_vbi_sliced_writer_delete (w);
+}
+
+/* Reads frames up to the end offset or the end of the file and
+   checks their contents, returning the number of frames read. */
+static unsigned int
+read_frames			(_vbi_sliced_file *	sf,
+				 unsigned int		first_frame,
+				 int64_t		end_offset)
+{
+	unsigned int frame;
+
+	for (frame = first_frame;; ++frame) {
+		vbi_sliced buffer[256];
+		const vbi_sliced *sliced;
+		vbi_sliced expected[2];
+		unsigned int n_lines;
+		int64_t stream_time;
+		vbi_bool success;
+		double t;
+
+		if (end_offset >= 0
+		    && _vbi_sliced_file_tell (sf) >= end_offset)
+			break;
+
+		if (get_frame) {
+			success = _vbi_sliced_file_get_frame
+				(sf, &sliced, &n_lines, &t, &stream_time);
+		} else {
+			sliced = buffer;
+			success = _vbi_sliced_file_read_frame
+				(sf, buffer, &n_lines, N_ELEMENTS (buffer),
+				 &t, &stream_time);
+		}
+
+		if (!success) {
+			assert (0 == errno);
+			break;
+		}
+
+		assert (frame < N_FRAMES);
+		assert (t == frame_time[frame]);
+		assert (2 == make_frame (expected, frame));
+		assert (2 == n_lines);
+		assert (sliced[0].id == expected[0].id);
+		assert (sliced[0].line == expected[0].line);
+		assert (0 == memcmp (sliced[0].data, expected[0].data, 42));
+		assert (sliced[1].id == expected[1].id);
+		assert (0 == memcmp (sliced[1].data, expected[1].data, 13));
+	}
+
+	return frame - first_frame;
+}
+
+static void
+test_index			(_vbi_sliced_file *	sf,
+				 vbi_bool		time_gap)
+{
+	const _vbi_sliced_index_entry *starts[4];
+	const _vbi_sliced_index_entry *e;
+	_vbi_sliced_index *idx;
+	_vbi_sliced_index *idx2;
+	unsigned int n_switches;
+	unsigned int n_chunks;
+	unsigned int n_frames;
+	unsigned int i;
+
+	idx = _vbi_sliced_file_build_index (sf, 0.5);
+	assert (NULL != idx);
+	assert (_vbi_sliced_index_get_n_entries (idx) > 4);
+	assert (NULL == _vbi_sliced_index_get_entry
+		(idx, _vbi_sliced_index_get_n_entries (idx)));
+
+	e = _vbi_sliced_index_get_entry (idx, 0);
+	assert (data_offset == e->offset);
+	assert (0 == e->frame_number);
+	assert (e->flags & _VBI_SLICED_INDEX_CHANNEL_SWITCH);
+
+	n_switches = 0;
+
+	for (i = 1; i < _vbi_sliced_index_get_n_entries (idx); ++i) {
+		e = _vbi_sliced_index_get_entry (idx, i);
+		assert (e->offset > e[-1].offset);
+		assert (e->sample_time == frame_time[e->frame_number]);
+
+		if (e->flags & _VBI_SLICED_INDEX_PAGE_HEADER)
+			assert (0 == e->frame_number % HEADER_INTERVAL);
+
+		if (e->flags & _VBI_SLICED_INDEX_CHANNEL_SWITCH) {
+			/* The CNI must be received twice. */
+			assert (SWITCH_FRAME + 1 == e->frame_number
+				|| (time_gap && 450 == e->frame_number));
+			++n_switches;
+		}
+	}
+
+	assert (n_switches == (time_gap ? 2u : 1u));
+
+	/* The reader is back at the start. */
+	assert (N_FRAMES == read_frames (sf, 0, -1));
+
+	/* Seeking. */
+	for (i = 0; i < N_FRAMES; i += 37) {
+		assert (_vbi_sliced_file_seek_time (sf, idx, frame_time[i]));
+		assert (N_FRAMES - i == read_frames (sf, i, -1));
+
+		/* Between two frames. */
+		if (i > 0) {
+			double t = (frame_time[i - 1] + frame_time[i]) / 2;
+
+			assert (_vbi_sliced_file_seek_time (sf, idx, t));
+			assert (N_FRAMES - i == read_frames (sf, i, -1));
+		}
+	}
+
+	assert (_vbi_sliced_file_seek_time (sf, idx, -1.0));
+	assert (N_FRAMES == read_frames (sf, 0, -1));
+
+	assert (_vbi_sliced_file_seek_time (sf, idx, 1e9));
+	assert (0 == read_frames (sf, N_FRAMES, -1));
+
+	/* Splitting. The chunks together must contain all frames. */
+	n_chunks = _vbi_sliced_index_split (idx, starts, N_ELEMENTS (starts));
+	assert (N_ELEMENTS (starts) == n_chunks);
+
+	n_frames = 0;
+
+	for (i = 0; i < n_chunks; ++i) {
+		int64_t end_offset;
+
+		assert (starts[i]->frame_number == n_frames);
+
+		if (i + 1 < n_chunks) {
+			assert (starts[i + 1]->offset > starts[i]->offset);
+			assert (0 != starts[i + 1]->flags);
+			end_offset = starts[i + 1]->offset;
+		} else {
+			end_offset = -1;
+		}
+
+		assert (_vbi_sliced_file_seek (sf, starts[i]));
+		n_frames += read_frames (sf, starts[i]->frame_number,
+					 end_offset);
+	}
+
+	assert (N_FRAMES == n_frames);
+
+	/* Sidecar file. */
+	snprintf (index_file_name, sizeof (index_file_name),
+		  "%s.idx", file_name);
+
+	assert (_vbi_sliced_index_save (idx, index_file_name));
+
+	idx2 = _vbi_sliced_file_load_index (sf, index_file_name);
+	assert (NULL != idx2);
+	assert (_vbi_sliced_index_get_n_entries (idx)
+		== _vbi_sliced_index_get_n_entries (idx2));
+
+	for (i = 0; i < _vbi_sliced_index_get_n_entries (idx); ++i) {
+		const _vbi_sliced_index_entry *e1, *e2;
+
+		e1 = _vbi_sliced_index_get_entry (idx, i);
+		e2 = _vbi_sliced_index_get_entry (idx2, i);
+		assert (e1->offset == e2->offset);
+		assert (e1->sample_time == e2->sample_time);
+		assert (e1->stream_time == e2->stream_time);
+		assert (e1->frame_number == e2->frame_number);
+		assert (e1->flags == e2->flags);
+	}
+
+	assert (_vbi_sliced_file_seek_time (sf, idx2, frame_time[123]));
+	assert (N_FRAMES - 123 == read_frames (sf, 123, -1));
+
+	_vbi_sliced_index_delete (idx2);
+
+	/* An index of a different file must be rejected. */
+	assert (0 == truncate (file_name, 1000));
+	idx2 = _vbi_sliced_file_load_index (sf, index_file_name);
+	assert (NULL == idx2);
+	assert (EINVAL == errno);
+	assert (NULL != _vbi_sliced_file_errstr (sf));
+
+	unlink (index_file_name);
+
+	idx2 = _vbi_sliced_file_load_index (sf, index_file_name);
+	assert (NULL == idx2);
+	assert (ENOENT == errno);
+
+	_vbi_sliced_index_delete (idx);
+}
+
+/* Regular files are mapped into memory, pipes are read through
+   a buffer. */
+static void
+test_pipe			(_vbi_sliced_file_format format)
+{
+	_vbi_sliced_file *sf;
+	char command[128];
+	FILE *fp;
+
+	snprintf (command, sizeof (command), "cat %s", file_name);
+	fp = popen (command, "r");
+	assert (NULL != fp);
+
+	sf = _vbi_sliced_file_open_fd (fileno (fp),
+				      _VBI_SLICED_FILE_FORMAT_UNKNOWN,
+				      /* close_fd */ FALSE);
+	assert (NULL != sf);
+	assert (format == _vbi_sliced_file_get_format (sf));
+
+	assert (N_FRAMES == read_frames (sf, 0, -1));
+
+	/* Cannot seek in a pipe. */
+	assert (NULL == _vbi_sliced_file_build_index (sf, 0));
+
+	_vbi_sliced_file_delete (sf);
+
+	assert (0 == pclose (fp));
+}
+
+static void
+test_format			(_vbi_sliced_file_format format)
+{
+	_vbi_sliced_file *sf;
+	vbi_sliced sliced[1];
+	unsigned int n_lines;
+	int64_t stream_time;
+	double t;
+	int fd;
+
+	strcpy (file_name, "test-sliced_file-XXXXXX");
+	fd = mkstemp (file_name);
+	assert (-1 != fd);
+
+	data_offset = 0;
+
+	switch (format) {
+	case _VBI_SLICED_FILE_FORMAT_OLD_SLICED:
+		write_old_sliced (fd);
+		break;
+
+	case _VBI_SLICED_FILE_FORMAT_DVB_PES:
+		write_pes (fd);
+		break;
+
+	case _VBI_SLICED_FILE_FORMAT_COMPACT:
+		write_compact (fd);
+		data_offset = 8;
+		break;
+
+	default:
+		assert (0);
+	}
+
+	sf = _vbi_sliced_file_open (file_name,
+				   _VBI_SLICED_FILE_FORMAT_UNKNOWN);
+	assert (NULL != sf);
+	assert (format == _vbi_sliced_file_get_format (sf));
+
+	assert (N_FRAMES == read_frames (sf, 0, -1));
+
+	_vbi_sliced_file_delete (sf);
+
+	/* Without copying. */
+	sf = _vbi_sliced_file_open (file_name, format);
+	assert (NULL != sf);
+	get_frame = TRUE;
+	assert (N_FRAMES == read_frames (sf, 0, -1));
+	get_frame = FALSE;
+
+	test_pipe (format);
+
+	/* Buffer too small, nothing consumed. */
+	if (_VBI_SLICED_FILE_FORMAT_DVB_PES != format) {
+		_vbi_sliced_index *idx;
+
+		idx = _vbi_sliced_file_build_index (sf, 0);
+		assert (NULL != idx);
+		assert (!_vbi_sliced_file_read_frame (sf, sliced, &n_lines,
+						     N_ELEMENTS (sliced),
+						     &t, &stream_time));
+		assert (ENOSPC == errno);
+		assert (N_FRAMES == read_frames (sf, 0, -1));
+		_vbi_sliced_index_delete (idx);
+	}
+
+	test_index (sf, _VBI_SLICED_FILE_FORMAT_DVB_PES != format);
+
+	_vbi_sliced_file_delete (sf);
+
+	unlink (file_name);
+}
+
+/* Teletext pages repeat, the compact format must store repeated
+   packets only once per block. */
+static void
+test_compact_size		(void)
+{
+	_vbi_sliced_writer *w;
+	_vbi_sliced_file *sf;
+	_vbi_sliced_index *idx;
+	vbi_sliced packets[32];
+	struct stat st;
+	unsigned int frame;
+	unsigned int i;
+	int fd;
+
+	for (i = 0; i < N_ELEMENTS (packets); ++i) {
+		unsigned int j;
+
+		CLEAR (packets[i]);
+		packets[i].id = VBI_SLICED_TELETEXT_B;
+		for (j = 0; j < 42; ++j)
+			packets[i].data[j] = vbi_par8 (0x20 + (i * 7 + j) % 0x5F);
+	}
+
+	strcpy (file_name, "test-sliced_file-XXXXXX");
+	fd = mkstemp (file_name);
+	assert (-1 != fd);
+
+	w = _vbi_sliced_writer_new_fd (fd, /* close_fd */ TRUE);
+	assert (NULL != w);
+
+	for (frame = 0; frame < 1000; ++frame) {
+		vbi_sliced sliced[16];
+
+		for (i = 0; i < 16; ++i) {
+			sliced[i] = packets[(frame * 3 + i) % 32];
+			sliced[i].line = 7 + i;
+		}
+
+		assert (_vbi_sliced_writer_write_frame
+			(w, sliced, 16, frame / 25.0, frame * 3600));
+	}
+
+	_vbi_sliced_writer_delete (w);
+
+	assert (0 == stat (file_name, &st));
+	assert (st.st_size < 1000 * 16 * 42 / 8);
+
+	sf = _vbi_sliced_file_open (file_name,
+				   _VBI_SLICED_FILE_FORMAT_COMPACT);
+	assert (NULL != sf);
+
+	idx = _vbi_sliced_file_build_index (sf, 0);
+	assert (NULL != idx);
+	assert (_vbi_sliced_index_get_n_entries (idx) >= 20);
+
+	for (frame = 0;; ++frame) {
+		const vbi_sliced *sliced;
+		unsigned int n_lines;
+		int64_t stream_time;
+		double t;
+
+		if (!_vbi_sliced_file_get_frame (sf, &sliced, &n_lines,
+						&t, &stream_time)) {
+			assert (0 == errno);
+			break;
+		}
+
+		assert (16 == n_lines);
+		assert (fabs (t - frame / 25.0) < 1e-6);
+		assert (frame * 3600 == stream_time);
+
+		for (i = 0; i < 16; ++i) {
+			const vbi_sliced *s = &packets[(frame * 3 + i) % 32];
+
+			assert (VBI_SLICED_TELETEXT_B == sliced[i].id);
+			assert (7 + i == sliced[i].line);
+			assert (0 == memcmp (sliced[i].data, s->data, 42));
+		}
+	}
+
+	assert (1000 == frame);
+
+	_vbi_sliced_index_delete (idx);
+	_vbi_sliced_file_delete (sf);
+
+	unlink (file_name);
+}
+
+/* Capture times going backwards, as when the capture program was
+   restarted. Seeking must find the frame in the right segment. */
+static void
+test_time_restart		(void)
+{
+	static const struct {
+		double		sample_time;
+		unsigned int	frame;
+	} seeks[] = {
+		{ 1005.0, 125 },
+		{ 503.0, 275 },
+		{ 1000.0, 0 },
+		{ 500.0, 200 },
+		/* After the end of a segment. */
+		{ 1007.98, 200 },
+		{ 100.0, 0 },
+	};
+	_vbi_sliced_writer *w;
+	_vbi_sliced_file *sf;
+	_vbi_sliced_index *idx;
+	const _vbi_sliced_index_entry *e;
+	unsigned int frame;
+	unsigned int i;
+	int fd;
+
+	strcpy (file_name, "test-sliced_file-XXXXXX");
+	fd = mkstemp (file_name);
+	assert (-1 != fd);
+
+	w = _vbi_sliced_writer_new_fd (fd, /* close_fd */ TRUE);
+	assert (NULL != w);
+
+	_vbi_sliced_writer_set_block_interval (w, 0.5);
+
+	for (frame = 0; frame < 400; ++frame) {
+		vbi_sliced sliced[2];
+		unsigned int n_lines;
+
+		n_lines = make_frame (sliced, frame);
+
+		if (frame < 200)
+			frame_time[frame] = 1000.0 + frame / 25.0;
+		else
+			frame_time[frame] = 500.0 + (frame - 200) / 25.0;
+
+		assert (_vbi_sliced_writer_write_frame
+			(w, sliced, n_lines, frame_time[frame],
+			 frame * 3600));
+	}
+
+	assert (_vbi_sliced_writer_finish (w));
+	_vbi_sliced_writer_delete (w);
+
+	sf = _vbi_sliced_file_open (file_name,
+				   _VBI_SLICED_FILE_FORMAT_COMPACT);
+	assert (NULL != sf);
+
+	idx = _vbi_sliced_file_build_index (sf, 0.5);
+	assert (NULL != idx);
+
+	e = _vbi_sliced_index_find (idx, 1005.0);
+	assert (e->frame_number < 200);
+	assert (e->sample_time <= 1005.0);
+
+	e = _vbi_sliced_index_find (idx, 503.0);
+	assert (e->frame_number >= 200);
+	assert (e->sample_time <= 503.0);
+
+	e = _vbi_sliced_index_find (idx, 100.0);
+	assert (e == _vbi_sliced_index_get_entry (idx, 0));
+
+	for (i = 0; i < N_ELEMENTS (seeks); ++i) {
+		vbi_sliced sliced[2];
+		unsigned int n_lines;
+		int64_t stream_time;
+		double t;
+
+		assert (_vbi_sliced_file_seek_time
+			(sf, idx, seeks[i].sample_time));
+		assert (_vbi_sliced_file_read_frame
+			(sf, sliced, &n_lines, N_ELEMENTS (sliced),
+			 &t, &stream_time));
+		assert (fabs (t - frame_time[seeks[i].frame]) < 1e-6);
+		assert (seeks[i].frame * 3600 == stream_time);
+	}
+
+	_vbi_sliced_index_delete (idx);
+	_vbi_sliced_file_delete (sf);
+
+	unlink (file_name);
+}
+
+int
+main				(void)
+{
+	test_format (_VBI_SLICED_FILE_FORMAT_OLD_SLICED);
+	test_format (_VBI_SLICED_FILE_FORMAT_DVB_PES);
+	test_format (_VBI_SLICED_FILE_FORMAT_COMPACT);
+	test_compact_size ();
+	test_time_restart ();
+
+	assert (NULL == _vbi_sliced_file_open ("/nonexistent/file",
+					      _VBI_SLICED_FILE_FORMAT_UNKNOWN));
+	assert (ENOENT == errno);
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
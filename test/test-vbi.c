@@ -0,0 +1,157 @@
+/*
+ *  libzvbi -- VBI decoder unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/vbi.h"
+
+/* vbi_decode_frame() starts the channel switch countdown when it
+   assumes frames were dropped. */
+static vbi_bool
+desync				(vbi_decoder *		vbi)
+{
+	return (40 == vbi->chswcd);
+}
+
+static void
+decode				(vbi_decoder *		vbi,
+				 double			time,
+				 int64_t		sequence)
+{
+	vbi_sliced sliced[1];
+
+	vbi_decode_frame (vbi, sliced, /* lines */ 0, time, sequence);
+}
+
+static void
+test_counter			(void)
+{
+	vbi_decoder *vbi;
+	unsigned int i;
+
+	vbi = vbi_decoder_new ();
+	assert (NULL != vbi);
+
+	/* Counter advances by one. */
+	for (i = 0; i < 10; ++i) {
+		decode (vbi, 1000.0 + i / 25.0, 1000 + i);
+		assert (!desync (vbi));
+	}
+
+	/* Gap. */
+	decode (vbi, 1000.0 + 11 / 25.0, 1011);
+	assert (desync (vbi));
+
+	decode (vbi, 1000.0 + 12 / 25.0, 1012);
+	assert (39 == vbi->chswcd);
+
+	vbi_decoder_delete (vbi);
+}
+
+static void
+test_time_jump			(void)
+{
+	vbi_decoder *vbi;
+	unsigned int i;
+
+	vbi = vbi_decoder_new ();
+	assert (NULL != vbi);
+
+	for (i = 0; i < 10; ++i)
+		decode (vbi, 1000.0 + i / 25.0, i);
+
+	/* The system time was set back and forth, the counter
+	   is continuous. */
+	decode (vbi, 1000.0 - 3600.0, 10);
+	assert (!desync (vbi));
+
+	decode (vbi, 1000.0 + 3600.0, 11);
+	assert (!desync (vbi));
+
+	decode (vbi, 1000.0 + 3600.0 + 1 / 25.0, 12);
+	assert (!desync (vbi));
+
+	vbi_decoder_delete (vbi);
+}
+
+/* Without a counter the decoder checks the time like vbi_decode(). */
+static void
+test_no_counter			(void)
+{
+	vbi_decoder *vbi;
+	unsigned int i;
+
+	vbi = vbi_decoder_new ();
+	assert (NULL != vbi);
+
+	for (i = 0; i < 10; ++i) {
+		decode (vbi, 1000.0 + i / 25.0, -1);
+		assert (!desync (vbi));
+	}
+
+	decode (vbi, 1000.0 + 3600.0, -1);
+	assert (desync (vbi));
+
+	vbi_decoder_delete (vbi);
+
+	/* A counter in one of two frames only. */
+	vbi = vbi_decoder_new ();
+	assert (NULL != vbi);
+
+	decode (vbi, 1000.0, 5);
+	decode (vbi, 1000.0 + 1 / 25.0, -1);
+	assert (!desync (vbi));
+
+	decode (vbi, 1000.0 + 2 / 25.0, 7);
+	assert (!desync (vbi));
+
+	decode (vbi, 1000.0 + 5 / 25.0, -1);
+	assert (desync (vbi));
+
+	vbi_decoder_delete (vbi);
+}
+
+int
+main				(void)
+{
+	test_counter ();
+	test_time_jump ();
+	test_no_counter ();
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
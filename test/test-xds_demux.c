@@ -0,0 +1,218 @@
+/*
+ *  libzvbi -- XDS demultiplexer unit test
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/misc.h"
+#include "src/hamm.h"
+#include "src/xds_demux.h"
+
+static unsigned int		n_packets;
+static vbi_xds_packet		last_packet;
+
+static vbi_bool
+xds_callback			(vbi_xds_demux *	xd,
+				 const vbi_xds_packet *	xp,
+				 void *			user_data)
+{
+	xd = xd; /* unused */
+
+	assert (&n_packets == user_data);
+
+	++n_packets;
+	last_packet = *xp;
+
+	return TRUE;
+}
+
+static void
+feed_pair			(vbi_xds_demux *	xd,
+				 unsigned int		c1,
+				 unsigned int		c2)
+{
+	uint8_t buffer[2];
+
+	buffer[0] = vbi_par8 (c1);
+	buffer[1] = vbi_par8 (c2);
+
+	assert (vbi_xds_demux_feed (xd, buffer));
+}
+
+/* Sends a complete XDS packet, optionally with an invalid
+   checksum. Interleaved Caption data must not disturb the
+   assembly of a packet which is continued later. */
+static void
+send_packet			(vbi_xds_demux *	xd,
+				 vbi_xds_class		xds_class,
+				 vbi_xds_subclass	xds_subclass,
+				 const char *		text,
+				 vbi_bool		bad_checksum)
+{
+	unsigned int sum;
+	unsigned int len;
+	unsigned int i;
+
+	len = strlen (text);
+
+	sum = xds_class * 2 + 1 + xds_subclass;
+	feed_pair (xd, xds_class * 2 + 1, xds_subclass);
+
+	for (i = 0; i < len; i += 2) {
+		unsigned int c2 = (i + 1 < len) ? text[i + 1] : 0;
+
+		if (2 == i) {
+			/* Caption, then continue the packet. Continue
+			   headers are not part of the checksum. */
+			feed_pair (xd, 0x14, 0x2C);
+			feed_pair (xd, xds_class * 2 + 2, xds_subclass);
+		}
+
+		sum += text[i] + c2;
+		feed_pair (xd, text[i], c2);
+	}
+
+	sum += 0x0F;
+	feed_pair (xd, 0x0F, ((0x80 - (sum & 0x7F)) & 0x7F)
+		   ^ (bad_checksum ? 1 : 0));
+}
+
+static void
+test_all_packets		(void)
+{
+	vbi_xds_demux *xd;
+
+	xd = vbi_xds_demux_new (xds_callback, &n_packets);
+	assert (NULL != xd);
+	assert (0 == vbi_xds_demux_get_flags (xd));
+
+	n_packets = 0;
+
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEWS", FALSE);
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEWS", FALSE);
+	assert (2 == n_packets);
+	assert (4 == last_packet.buffer_size);
+	assert (0 == memcmp (last_packet.buffer, "NEWS", 5));
+
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEWS", TRUE);
+	assert (2 == n_packets);
+
+	vbi_xds_demux_delete (xd);
+}
+
+static void
+test_changes_only		(void)
+{
+	vbi_xds_demux *xd;
+
+	xd = vbi_xds_demux_new (xds_callback, &n_packets);
+	assert (NULL != xd);
+
+	vbi_xds_demux_set_flags (xd, VBI_XDS_DEMUX_CHANGES_ONLY);
+	assert (VBI_XDS_DEMUX_CHANGES_ONLY == vbi_xds_demux_get_flags (xd));
+
+	n_packets = 0;
+
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEWS", FALSE);
+	assert (1 == n_packets);
+	assert (VBI_XDS_CLASS_CURRENT == last_packet.xds_class);
+	assert (VBI_XDS_PROGRAM_NAME == last_packet.xds_subclass);
+	assert (0 == memcmp (last_packet.buffer, "NEWS", 5));
+
+	/* Repeated packets, and packets of other subclasses
+	   do not affect change detection. */
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEWS", FALSE);
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_RATING, "AB", FALSE);
+	assert (2 == n_packets);
+	assert (VBI_XDS_PROGRAM_RATING == last_packet.xds_subclass);
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_RATING, "AB", FALSE);
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEWS", FALSE);
+	assert (2 == n_packets);
+
+	/* A corrupted packet must not count as a change, nor
+	   replace the last valid packet. */
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "MOVIE", TRUE);
+	assert (2 == n_packets);
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEWS", FALSE);
+	assert (2 == n_packets);
+
+	/* Same length, different contents. */
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "NEXT", FALSE);
+	assert (3 == n_packets);
+	assert (0 == memcmp (last_packet.buffer, "NEXT", 5));
+
+	/* Different length, odd number of characters. */
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "MOVIE", FALSE);
+	assert (4 == n_packets);
+	assert (5 == last_packet.buffer_size);
+	assert (0 == memcmp (last_packet.buffer, "MOVIE", 6));
+
+	/* After a reset all packets are new. */
+	vbi_xds_demux_reset (xd);
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "MOVIE", FALSE);
+	assert (5 == n_packets);
+
+	/* Likewise after switching modes. */
+	vbi_xds_demux_set_flags (xd, 0);
+	vbi_xds_demux_set_flags (xd, VBI_XDS_DEMUX_CHANGES_ONLY);
+	send_packet (xd, VBI_XDS_CLASS_CURRENT,
+		     VBI_XDS_PROGRAM_NAME, "MOVIE", FALSE);
+	assert (6 == n_packets);
+
+	vbi_xds_demux_delete (xd);
+}
+
+int
+main				(void)
+{
+	test_all_packets ();
+	test_changes_only ();
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
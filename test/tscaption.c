@@ -0,0 +1,301 @@
+/*
+ *  libzvbi -- ATSC transport stream caption decoder
+ *
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef HAVE_GETOPT_LONG
+#  include <getopt.h>
+#endif
+
+#include "sliced.h"
+
+#include "src/misc.h"
+#include "src/conv.h"
+#include "src/cc608_decoder.h"
+#include "src/dtvcc_decoder.h"
+#include "src/atsc_cc_demux.h"
+
+#define PROGRAM_NAME "tscaption"
+
+static const char *		option_in_file_name;
+static vbi_bool			option_dtvcc_only;
+static vbi_bool			option_cc608_only;
+
+static const char *		locale_codeset;
+
+static void
+print_text			(unsigned int		program_number,
+				 const char *		service,
+				 unsigned int		channel,
+				 const vbi_char *	text,
+				 unsigned int		length)
+{
+	uint16_t ucs2[64];
+	unsigned int end;
+	unsigned int i;
+
+	for (end = length; end > 0; --end) {
+		if (VBI_TRANSPARENT_SPACE != text[end - 1].opacity
+		    && 0x20 != text[end - 1].unicode)
+			break;
+	}
+
+	if (0 == end)
+		return;
+
+	end = MIN (end, (unsigned int) N_ELEMENTS (ucs2));
+
+	for (i = 0; i < end; ++i)
+		ucs2[i] = text[i].unicode;
+
+	printf ("%u %s%u ", program_number, service, channel);
+	vbi_fputs_iconv_ucs2 (stdout, locale_codeset,
+			      ucs2, end, /* repl_char */ '?');
+	putchar ('\n');
+}
+
+static void
+event_handler			(_vbi_atsc_cc_demux *	dx,
+				 void *			user_data,
+				 unsigned int		program_number,
+				 vbi_event *		ev)
+{
+	dx = dx; /* unused */
+	user_data = user_data;
+
+	switch (ev->type) {
+	case _VBI_EVENT_CC608_STREAM:
+	{
+		const struct _vbi_event_cc608_stream *cc;
+
+		cc = ev->ev._cc608_stream;
+		print_text (program_number,
+			    (cc->channel <= 4) ? "CC" : "T",
+			    (cc->channel - 1) % 4 + 1,
+			    cc->text, N_ELEMENTS (cc->text));
+		break;
+	}
+
+	case _VBI_EVENT_DTVCC_STREAM:
+	{
+		const struct _vbi_event_dtvcc_stream *dtvcc;
+
+		dtvcc = ev->ev._dtvcc_stream;
+		print_text (program_number, "DTVCC", dtvcc->service,
+			    dtvcc->text, dtvcc->length);
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	fflush (stdout);
+}
+
+static void
+decode				(FILE *			fp)
+{
+	_vbi_atsc_cc_demux *dx;
+	unsigned int event_mask;
+	unsigned int n_sync_errors;
+
+	event_mask = _VBI_EVENT_CC608_STREAM | _VBI_EVENT_DTVCC_STREAM;
+	if (option_dtvcc_only)
+		event_mask = _VBI_EVENT_DTVCC_STREAM;
+	else if (option_cc608_only)
+		event_mask = _VBI_EVENT_CC608_STREAM;
+
+	dx = _vbi_atsc_cc_demux_new (event_mask, event_handler,
+				     /* user_data */ NULL);
+	if (NULL == dx)
+		no_mem_exit ();
+
+	n_sync_errors = 0;
+
+	for (;;) {
+		uint8_t buffer[188 * 64];
+		struct timeval tv;
+		size_t actual;
+
+		actual = fread (buffer, 1, sizeof (buffer), fp);
+		if (0 == actual) {
+			if (ferror (fp))
+				read_error_exit (/* msg: errno */ NULL);
+			break;
+		}
+
+		gettimeofday (&tv, /* tz */ NULL);
+
+		if (!_vbi_atsc_cc_demux_feed (dx, buffer, actual,
+					      tv.tv_sec
+					      + tv.tv_usec * (1 / 1e6)))
+			++n_sync_errors;
+	}
+
+	if (n_sync_errors > 0 && (option_log_mask & VBI_LOG_WARNING)) {
+		fprintf (stderr, "%s: Lost TS synchronization "
+			 "%u times.\n",
+			 program_invocation_name, n_sync_errors);
+	}
+
+	_vbi_atsc_cc_demux_delete (dx);
+	dx = NULL;
+}
+
+static void
+usage				(FILE *			fp)
+{
+	fprintf (fp, "\
+%s %s -- ATSC transport stream caption decoder\n\n\
+Copyright (C) 2026 agent <agent@local>\n\
+This program is licensed under GPLv2+. NO WARRANTIES.\n\n\
+Decodes the EIA 608 and CEA 708 captions of all programs in an\n\
+MPEG-2 transport stream and prints them on standard output.\n\n\
+Usage: %s [options] < transport stream\n\
+-h | --help | --usage  Print this message and exit\n\
+-q | --quiet           Suppress progress and error messages\n\
+-v | --verbose         Increase verbosity\n\
+-V | --version         Print the program version and exit\n\
+Input options:\n\
+-i | --input name      Read the transport stream from this file\n\
+                       instead of standard input\n\
+Decoding options:\n\
+-c | --cc              Decode only EIA 608 captions\n\
+-d | --dtvcc           Decode only CEA 708 captions\n\
+",
+		 PROGRAM_NAME, VERSION, program_invocation_name);
+}
+
+static const char short_options [] = "cdhi:qvV";
+
+#ifdef HAVE_GETOPT_LONG
+
+static const struct option
+long_options [] = {
+	{ "cc",		no_argument,		NULL,		'c' },
+	{ "dtvcc",	no_argument,		NULL,		'd' },
+	{ "help",	no_argument,		NULL,		'h' },
+	{ "usage",	no_argument,		NULL,		'h' },
+	{ "input",	required_argument,	NULL,		'i' },
+	{ "quiet",	no_argument,		NULL,		'q' },
+	{ "verbose",	no_argument,		NULL,		'v' },
+	{ "version",	no_argument,		NULL,		'V' },
+	{ NULL, 0, 0, 0 }
+};
+
+#else
+#  define getopt_long(ac, av, s, l, i) getopt(ac, av, s)
+#endif
+
+static int			option_index;
+
+int
+main				(int			argc,
+				 char **		argv)
+{
+	FILE *fp;
+
+	init_helpers (argc, argv);
+
+	for (;;) {
+		int c;
+
+		c = getopt_long (argc, argv, short_options,
+				 long_options, &option_index);
+		if (-1 == c)
+			break;
+
+		switch (c) {
+		case 0: /* getopt_long() flag */
+			break;
+
+		case 'c':
+			option_cc608_only = TRUE;
+			option_dtvcc_only = FALSE;
+			break;
+
+		case 'd':
+			option_dtvcc_only = TRUE;
+			option_cc608_only = FALSE;
+			break;
+
+		case 'h':
+			usage (stdout);
+			exit (EXIT_SUCCESS);
+
+		case 'i':
+			assert (NULL != optarg);
+			option_in_file_name = optarg;
+			break;
+
+		case 'q':
+			parse_option_quiet ();
+			break;
+
+		case 'v':
+			parse_option_verbose ();
+			break;
+
+		case 'V':
+			printf (PROGRAM_NAME " " VERSION "\n");
+			exit (EXIT_SUCCESS);
+
+		default:
+			usage (stderr);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	locale_codeset = vbi_locale_codeset ();
+
+	fp = stdin;
+
+	if (NULL != option_in_file_name
+	    && 0 != strcmp (option_in_file_name, "-")) {
+		fp = fopen (option_in_file_name, "rb");
+		if (NULL == fp) {
+			error_exit ("Cannot open '%s': %s.",
+				    option_in_file_name,
+				    strerror (errno));
+		}
+	} else if (isatty (STDIN_FILENO)) {
+		error_exit ("No transport stream on standard input.");
+	}
+
+	decode (fp);
+
+	if (stdin != fp)
+		fclose (fp);
+
+	exit (EXIT_SUCCESS);
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/